@@ -0,0 +1,145 @@
+/*
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+/* Times the SHA1 block functions on a buffer in memory and the
+ * hashing of a file with the one selected for this CPU.
+ *
+ * Usage: bench_sha1 [MiB] */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include "sha1.h"
+
+#define BENCH_RUNS 5
+
+static const guint32 bench_iv[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+static void bench_print(const gchar *name, gsize bytes, gint64 usecs) {
+    printf("%-16s %8.1f ms %8.1f MiB/s\n", name, usecs / 1000.0,
+            usecs > 0 ? (gdouble) bytes * G_USEC_PER_SEC / usecs / (1024 * 1024) : 0);
+}
+
+/* Best time out of BENCH_RUNS runs of @blocks over @data. The state
+ * after the last run is left in @H. Returns -1 if @blocks is not
+ * supported. */
+static gint64 bench_blocks(Sha1Blocks blocks, const guint8 *data, gsize nblocks, guint32 H[5]) {
+    gint64 best = -1;
+    gint i;
+
+    for (i = 0; i < BENCH_RUNS; ++i) {
+        gint64 start;
+
+        memcpy(H, bench_iv, sizeof(bench_iv));
+        start = g_get_monotonic_time();
+        if (!sha1_blocks_with(blocks, H, data, nblocks))
+            return -1;
+        start = g_get_monotonic_time() - start;
+        if ((best < 0) || (start < best))
+            best = start;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    gsize mib = 64, nblocks, i;
+    guint8 *data;
+    guint32 H_generic[5], H_shani[5];
+    gint64 usecs;
+    gchar *filename, *hash = NULL;
+    gint fd;
+    GError *error = NULL;
+
+    if (argc > 1)
+        mib = MAX(1, atoi(argv[1]));
+
+    nblocks = mib * 1024 * 1024 / 64;
+    data = g_malloc(nblocks * 64);
+    for (i = 0; i < nblocks * 64; ++i)
+        data[i] = (guint8) g_random_int();
+
+    printf("%" G_GSIZE_FORMAT " MiB, best of %d runs\n", mib, BENCH_RUNS);
+
+    usecs = bench_blocks(SHA1_BLOCKS_GENERIC, data, nblocks, H_generic);
+    bench_print("generic", nblocks * 64, usecs);
+
+    usecs = bench_blocks(SHA1_BLOCKS_SHANI, data, nblocks, H_shani);
+    if (usecs < 0) {
+        printf("%-16s not supported by this CPU\n", "sha-ni");
+    }
+    else {
+        bench_print("sha-ni", nblocks * 64, usecs);
+        if (memcmp(H_generic, H_shani, sizeof(H_generic)) != 0) {
+            fprintf(stderr, "sha-ni and generic results differ\n");
+            g_free(data);
+            return 1;
+        }
+    }
+
+    /* the whole path used when importing, from the page cache */
+    fd = g_file_open_tmp("gtkpod-sha1-XXXXXX", &filename, &error);
+    if (fd < 0) {
+        fprintf(stderr, "%s\n", error->message);
+        g_error_free(error);
+        g_free(data);
+        return 1;
+    }
+    close(fd);
+    if (!g_file_set_contents(filename, (const gchar *) data, nblocks * 64, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        g_error_free(error);
+    }
+    else {
+        gint64 best = -1;
+
+        for (i = 0; i < BENCH_RUNS; ++i) {
+            gint64 start = g_get_monotonic_time();
+
+            g_free(hash);
+            hash = sha1_hash_on_filename_with_mode(filename, TRUE, SHA1_MODE_FULL);
+            start = g_get_monotonic_time() - start;
+            if ((best < 0) || (start < best))
+                best = start;
+        }
+        bench_print("file (full)", nblocks * 64, best);
+    }
+
+    g_unlink(filename);
+    g_free(filename);
+    g_free(hash);
+    g_free(data);
+
+    return 0;
+}
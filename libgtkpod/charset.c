@@ -41,8 +41,9 @@
 /* If Japanese auto-conversion is being used, this variable is being
    set with each call of charset_to_utf8(). You can get a copy of its
    value by calling charset_get_auto().
-   This variable will only be reset by calling charset_reset_auto(). */
-static gchar *auto_charset = NULL;
+   This variable will only be reset by calling charset_reset_auto().
+   It is kept per thread so that files can be imported in parallel. */
+static GPrivate auto_charset = G_PRIVATE_INIT (g_free);
 
 typedef struct {
 	const gchar *descr;
@@ -366,16 +367,16 @@ static gchar *charset_check_auto (const gchar *str)
     return result;
 }
 
-/* See description at the definition of gchar *auto_charset; for
+/* See description at the definition of auto_charset for
    details */
 gchar *charset_get_auto (void)
 {
-    return g_strdup (auto_charset);
+    return g_strdup (g_private_get (&auto_charset));
 }
 
 void charset_reset_auto (void)
 {
-    auto_charset = NULL;
+    g_private_replace (&auto_charset, NULL);
 }
 
 
@@ -393,8 +394,7 @@ gchar *charset_to_utf8 (const gchar *str)
     charset = charset_check_auto (str);
     if (charset)
     {
-	g_free(auto_charset);
-	auto_charset = g_strdup(charset);
+	g_private_replace (&auto_charset, g_strdup(charset));
     }
     else
     {
@@ -55,6 +55,22 @@ static GIOChannel *channel = NULL;
 static struct sockaddr_un *saddr = NULL;
 static guint inp_handler;
 
+/* Plays reported through the socket are read and hashed on a worker
+ thread and collected in @pending, plays of the same file being added
+ up. They are applied on the main loop in one go PLAYCOUNT_BATCH_DELAY
+ ms after the first play of a batch arrived. */
+#define PLAYCOUNT_BATCH_DELAY 250
+
+typedef struct {
+    GMutex mutex;
+    GThreadPool *pool; /* reads the accepted client sockets */
+    GHashTable *pending; /* filename -> PlaycountUpdate */
+    GList *order; /* pending PlaycountUpdates, most recent first */
+    guint timeout_id;
+} PlaycountQueue;
+
+static PlaycountQueue plyc_queue;
+
 const gchar *SOCKET_TEST = "TEST:";
 const gchar *SOCKET_PLYC = "PLYC:";
 
@@ -111,75 +127,183 @@ static gboolean socket_used() {
     return result;
 }
 
-/* append the filename <file> to ~/.gtkpod/offline_playcount */
-static gboolean register_playcount(gchar *file) {
-    if (file && *file) {
-        gchar *cfgdir = prefs_get_cfgdir();
-
-        if (cfgdir) {
-            gchar *offlplyc = g_strdup_printf("%s%c%s", cfgdir, G_DIR_SEPARATOR, "offline_playcount");
-            int fd = open(offlplyc, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH
-                    |S_IWOTH);
-            if (fd != -1) {
-                if (flock(fd, LOCK_EX) == 0) {
-                    gchar *sha1 = sha1_hash_on_filename(file, TRUE);
-                    write(fd, SOCKET_PLYC, strlen(SOCKET_PLYC));
-                    if (sha1)
-                        write(fd, sha1, strlen(sha1));
-                    write(fd, " ", 1);
-                    write(fd, file, strlen(file));
-                    write(fd, "\n", 1);
-                    g_free(sha1);
-                }
-                else {
-                    fprintf(stderr, "couldn't lock %s\n", file);
-                }
-                close(fd);
+/* append the PlaycountUpdates in @updates to
+ ~/.gtkpod/offline_playcount, one line per play */
+static void register_playcounts(GList *updates) {
+    gchar *cfgdir;
+    GString *lines;
+    GList *gl;
+
+    if (!updates)
+        return;
+
+    lines = g_string_sized_new(PATH_MAX);
+    for (gl = updates; gl; gl = gl->next) {
+        PlaycountUpdate *update = gl->data;
+        gint i;
+
+        if (!update->file || !*update->file)
+            continue;
+        for (i = 0; i < update->num; ++i)
+            g_string_append_printf(lines, "%s%s %s\n", SOCKET_PLYC, update->sha1 ? update->sha1 : "", update->file);
+    }
+
+    cfgdir = prefs_get_cfgdir();
+    if (cfgdir && (lines->len != 0)) {
+        gchar *offlplyc = g_strdup_printf("%s%c%s", cfgdir, G_DIR_SEPARATOR, "offline_playcount");
+        int fd = open(offlplyc, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH
+                |S_IWOTH);
+        if (fd != -1) {
+            if (flock(fd, LOCK_EX) == 0) {
+                if (write(fd, lines->str, lines->len) != (ssize_t) lines->len)
+                    fprintf(stderr, "couldn't write %s\n", offlplyc);
             }
             else {
-                fprintf(stderr, "couldn't open %s\n", file);
+                fprintf(stderr, "couldn't lock %s\n", offlplyc);
             }
-            g_free(offlplyc);
-            g_free(cfgdir);
+            close(fd);
+        }
+        else {
+            fprintf(stderr, "couldn't open %s\n", offlplyc);
         }
+        g_free(offlplyc);
+    }
+    g_free(cfgdir);
+    g_string_free(lines, TRUE);
+}
+
+/* append the filename <file> to ~/.gtkpod/offline_playcount */
+static gboolean register_playcount(gchar *file) {
+    if (file && *file) {
+        PlaycountUpdate *update = gp_playcount_update_new(NULL, file, 1);
+        GList *updates;
+
+        if (prefs_get_int("sha1"))
+            update->sha1 = sha1_hash_on_filename(file, TRUE);
+        updates = g_list_append(NULL, update);
+        register_playcounts(updates);
+        g_list_free(updates);
+        gp_playcount_update_free(update);
     }
     return TRUE;
 }
 
-gboolean received_message(GIOChannel *channel, GIOCondition condition, gpointer data) {
-    gint source = g_io_channel_unix_get_fd(channel);
-    gint csock, rval;
-    gchar *buf;
-    /*    printf("received message\n");*/
+/* Remove and return all pending PlaycountUpdates in the order they
+ were received. */
+static GList *playcount_queue_steal(void) {
+    GList *updates;
 
-    buf = g_malloc(PATH_MAX);
-    while ((csock = accept(source, 0, 0)) != -1) {
-        do {
-            bzero(buf, PATH_MAX);
-            if ((rval = read(csock, buf, PATH_MAX)) < 0) {
-                fprintf(stderr, "server: read error: %s", strerror(errno));
+    g_mutex_lock(&plyc_queue.mutex);
+    updates = g_list_reverse(plyc_queue.order);
+    plyc_queue.order = NULL;
+    if (plyc_queue.pending)
+        g_hash_table_remove_all(plyc_queue.pending);
+    if (plyc_queue.timeout_id != 0) {
+        g_source_remove(plyc_queue.timeout_id);
+        plyc_queue.timeout_id = 0;
+    }
+    g_mutex_unlock(&plyc_queue.mutex);
+
+    return updates;
+}
+
+/* Apply the pending plays (called on the main loop). Plays of tracks
+ that could not be found on the iPod are written to
+ offline_playcount. */
+static gboolean playcount_queue_apply(gpointer data) {
+    GList *updates, *unmatched;
+
+    g_mutex_lock(&plyc_queue.mutex);
+    plyc_queue.timeout_id = 0; /* this source is removed by returning FALSE */
+    g_mutex_unlock(&plyc_queue.mutex);
+
+    updates = playcount_queue_steal();
+    unmatched = gp_increase_playcounts(updates);
+    register_playcounts(unmatched);
+
+    g_list_free(unmatched);
+    g_list_free_full(updates, (GDestroyNotify) gp_playcount_update_free);
+    return FALSE;
+}
+
+/* Add one play of @file to the pending plays (called on the worker
+ thread). The file is only hashed the first time it is seen in a
+ batch, and only if SHA1 hashing is turned on. */
+static void playcount_queue_add(const gchar *file) {
+    PlaycountUpdate *update;
+    gchar *sha1 = NULL;
+
+    g_mutex_lock(&plyc_queue.mutex);
+    update = g_hash_table_lookup(plyc_queue.pending, file);
+    g_mutex_unlock(&plyc_queue.mutex);
+
+    if (!update && prefs_get_int("sha1"))
+        sha1 = sha1_hash_on_filename((gchar *) file, TRUE);
+
+    g_mutex_lock(&plyc_queue.mutex);
+    /* the batch may have been applied in the meantime */
+    update = g_hash_table_lookup(plyc_queue.pending, file);
+    if (update) {
+        ++update->num;
+    }
+    else {
+        update = gp_playcount_update_new(NULL, file, 1);
+        update->sha1 = sha1;
+        sha1 = NULL;
+        g_hash_table_insert(plyc_queue.pending, update->file, update);
+        plyc_queue.order = g_list_prepend(plyc_queue.order, update);
+    }
+    if (plyc_queue.timeout_id == 0)
+        plyc_queue.timeout_id = gdk_threads_add_timeout(PLAYCOUNT_BATCH_DELAY, playcount_queue_apply, NULL);
+    g_mutex_unlock(&plyc_queue.mutex);
+
+    g_free(sha1);
+}
+
+/* Read the message from the accepted client socket @data (fd + 1) on
+ the worker thread. A client sends a single message and closes the
+ connection. */
+static void playcount_client_read(gpointer data, gpointer user_data) {
+    gint csock = GPOINTER_TO_INT (data) - 1;
+    GString *msg = g_string_sized_new(PATH_MAX);
+    gchar *buf = g_malloc(PATH_MAX);
+    ssize_t rval;
+
+    /* the listening socket is non-blocking, some systems pass that
+     on to the accepted sockets */
+    fcntl(csock, F_SETFL, fcntl(csock, F_GETFL) & ~O_NONBLOCK);
+
+    while ((msg->len <= 2 * PATH_MAX) && ((rval = read(csock, buf, PATH_MAX)) != 0)) {
+        if (rval < 0) {
+            if (errno == EINTR)
                 continue;
-            }
-            else if (rval == 0) {
-                /* forget about it */
-            }
-            else {
-                if (strncmp(buf, SOCKET_TEST, strlen(SOCKET_TEST)) == 0) {
-                    continue; /* skip socket tests */
-                }
-                if (strncmp(buf, SOCKET_PLYC, strlen(SOCKET_PLYC)) == 0) {
-                    gchar *file = buf + strlen(SOCKET_PLYC);
-                    if (gp_increase_playcount(NULL, file, 1) == FALSE) { /* didn't find the track --> write to
-                     offline_playcount */
-                        register_playcount(file);
-                    }
-                }
-            }
+            fprintf(stderr, "server: read error: %s", strerror(errno));
+            break;
         }
-        while (rval > 0);
-        close(csock);
+        g_string_append_len(msg, buf, rval);
     }
+    close(csock);
+
+    if (strncmp(msg->str, SOCKET_PLYC, strlen(SOCKET_PLYC)) == 0) {
+        gchar *file = msg->str + strlen(SOCKET_PLYC);
+        if (*file)
+            playcount_queue_add(file);
+    }
+    /* anything else (e.g. socket tests) is ignored */
+
     g_free(buf);
+    g_string_free(msg, TRUE);
+}
+
+gboolean received_message(GIOChannel *channel, GIOCondition condition, gpointer data) {
+    gint source = g_io_channel_unix_get_fd(channel);
+    gint csock;
+
+    /* hand the connections over to the worker thread -- reading them
+     and hashing the files would block the UI */
+    while ((csock = accept(source, 0, 0)) != -1) {
+        g_thread_pool_push(plyc_queue.pool, GINT_TO_POINTER (csock + 1), NULL);
+    }
 
     return TRUE;
 }
@@ -205,6 +329,9 @@ void server_setup(void) {
             /* socket must be non-blocking -- otherwise
              received_message() will block */
             fcntl(ssock, F_SETFL, O_NONBLOCK);
+            g_mutex_init(&plyc_queue.mutex);
+            plyc_queue.pending = g_hash_table_new(g_str_hash, g_str_equal);
+            plyc_queue.pool = g_thread_pool_new(playcount_client_read, NULL, 1, FALSE, NULL);
             channel = g_io_channel_unix_new(ssock);
             inp_handler = g_io_add_watch(channel, G_IO_IN, received_message, NULL);
         }
@@ -221,11 +348,26 @@ void server_setup(void) {
 
 void server_shutdown(void) {
     if (ssock != -1) {
+        GList *updates;
+
+        g_source_remove(inp_handler);
         if (channel != NULL)
             g_io_channel_unref(channel);
+        channel = NULL;
         
         close(ssock);
         ssock = -1;
+
+        /* finish reading the accepted connections and keep the plays
+         not applied yet for the next time the iPod is loaded */
+        g_thread_pool_free(plyc_queue.pool, FALSE, TRUE);
+        plyc_queue.pool = NULL;
+        updates = playcount_queue_steal();
+        register_playcounts(updates);
+        g_list_free_full(updates, (GDestroyNotify) gp_playcount_update_free);
+        g_hash_table_destroy(plyc_queue.pending);
+        plyc_queue.pending = NULL;
+        g_mutex_clear(&plyc_queue.mutex);
     }
     if (saddr) {
         if (strlen(saddr->sun_path) != 0)
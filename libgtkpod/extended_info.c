@@ -0,0 +1,1194 @@
+/*
+ |  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+/* This file reads and writes the extended information file kept next
+ * to each iTunesDB ("iTunesDB.ext").
+ *
+ * The file is written in a binary format: an 8 byte header followed
+ * by records consisting of a one byte field tag, the length of the
+ * data as 32 bit little endian integer and the data itself. Strings
+ * are stored without terminating zero, numbers as 64 bit little
+ * endian integers. Readers skip records with unknown tags in the
+ * first segment.
+ *
+ * The records form one or more segments, each starting with the
+ * checksum of the iTunesDB and ending with an END record. The first
+ * segment holds all tracks. When the iTunesDB is saved again, only
+ * the tracks that changed since (identified by their dbid) are
+ * appended as a new segment, together with the dbids of the tracks
+ * that were removed. A segment is only applied once its END record
+ * has been read, so a save that was interrupted leaves the
+ * information of the previous one intact. The file is rewritten
+ * from scratch once the appended segments grow too large.
+ *
+ * Files written by older versions consist of "key=value" lines and
+ * can still be read. Both formats are parsed straight from a mapped
+ * file, and nothing in here touches the GUI, so that the file can be
+ * read by a worker thread while the iTunesDB is parsed. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n-lib.h>
+#include "gp_itdb.h"
+#include "gp_private.h"
+#include "sha1.h"
+#include "extended_info.h"
+
+#define XI_MAGIC "GPXI"
+#define XI_FORMAT_VERSION 2
+#define XI_HEADER_SIZE 8
+#define XI_RECORD_HEADER_SIZE 5
+/* records are written to disk in chunks of this size */
+#define XI_WRITE_BUFFER_SIZE (64 * 1024)
+
+/* Field tags of the binary format -- they are stored in the file and
+ * must not be changed */
+typedef enum {
+    XI_FIELD_UNKNOWN = 0,
+    XI_FIELD_ITUNESDB_HASH = 1, /* starts a segment */
+    XI_FIELD_VERSION = 2,
+    XI_FIELD_ID = 3, /* starts a new track, 0 for pending deletion */
+    XI_FIELD_END = 4, /* ends a segment */
+    XI_FIELD_HOSTNAME = 5,
+    XI_FIELD_CONVERTED_FILE = 6,
+    XI_FIELD_FILENAME_LOCALE = 7,
+    XI_FIELD_FILENAME_UTF8 = 8,
+    XI_FIELD_THUMBNAIL_LOCALE = 9,
+    XI_FIELD_THUMBNAIL_UTF8 = 10,
+    XI_FIELD_FILENAME_IPOD = 11,
+    XI_FIELD_SHA1_HASH = 12,
+    XI_FIELD_SHA1_SIGNATURE = 13,
+    XI_FIELD_CHARSET = 14,
+    XI_FIELD_PC_MTIME = 15,
+    XI_FIELD_LOCAL_ITDB_ID = 16,
+    XI_FIELD_LOCAL_TRACK_DBID = 17,
+    XI_FIELD_TRANSFERRED = 18,
+    XI_FIELD_DBID = 19, /* dbid of the track, since format 2 */
+    XI_FIELD_REMOVED = 20, /* dbid of a track removed, since format 2 */
+    XI_FIELD_LAST = XI_FIELD_REMOVED
+} XiField;
+
+/* Keys of the text format */
+static const struct {
+    const gchar *key;
+    XiField field;
+} xi_text_keys[] = {
+    { "itunesdb_hash", XI_FIELD_ITUNESDB_HASH },
+    { "version", XI_FIELD_VERSION },
+    { "id", XI_FIELD_ID },
+    { "hostname", XI_FIELD_HOSTNAME },
+    { "converted_file", XI_FIELD_CONVERTED_FILE },
+    { "filename_locale", XI_FIELD_FILENAME_LOCALE },
+    { "filename_utf8", XI_FIELD_FILENAME_UTF8 },
+    { "thumbnail_locale", XI_FIELD_THUMBNAIL_LOCALE },
+    { "thumbnail_utf8", XI_FIELD_THUMBNAIL_UTF8 },
+    { "filename_ipod", XI_FIELD_FILENAME_IPOD },
+    { "md5_hash", XI_FIELD_SHA1_HASH },
+    { "sha1_hash", XI_FIELD_SHA1_HASH },
+    { "sha1_signature", XI_FIELD_SHA1_SIGNATURE },
+    { "charset", XI_FIELD_CHARSET },
+    { "pc_mtime", XI_FIELD_PC_MTIME },
+    { "local_itdb_id", XI_FIELD_LOCAL_ITDB_ID },
+    { "local_track_dbid", XI_FIELD_LOCAL_TRACK_DBID },
+    { "transferred", XI_FIELD_TRANSFERRED },
+    { NULL, XI_FIELD_UNKNOWN } };
+
+/* State while reading a file */
+typedef struct {
+    const gchar *name; /* file read */
+    const gchar *sha1; /* hash of the iTunesDB */
+    gboolean binary; /* binary format? */
+    gboolean expect_hash; /* next field must be the iTunesDB hash */
+    ExtendedInfo *info;
+    ExtendedTrackInfo *sei; /* track being read */
+    const guchar *sei_data; /* binary format: records of @sei following
+			       its id */
+    /* segment being read, applied once it is complete */
+    gchar *seg_hash;
+    gdouble seg_version;
+    GList *seg_tracks;
+    GArray *seg_removed; /* dbids */
+    GList *seg_pending;
+    /* result of the segments read completely */
+    gboolean committed;
+    gchar *hash; /* hash of the iTunesDB */
+    GHashTable *tracks; /* dbid -> ExtendedTrackInfo */
+    GList *plain_tracks; /* tracks without dbid */
+    gsize size; /* end of the last segment */
+    gsize base_size; /* end of the first segment */
+} XiParser;
+
+struct _ExtendedInfoLoader {
+    GThread *thread;
+    gchar *name;
+    gchar *itunes;
+    ExtendedInfo *info;
+    GError *error;
+};
+
+/* What has been written to a file, used to append only the tracks
+ * that changed */
+struct _ExtendedInfoJournal {
+    gchar *name; /* file written */
+    GHashTable *records; /* dbid -> XiRecord of each track */
+    gsize size; /* end of the last complete segment */
+    gsize base_size; /* end of the first segment */
+    /* size and modification time of the file, to notice changes by
+     * others */
+    goffset stat_size;
+    time_t mtime;
+};
+
+typedef struct {
+    guint64 dbid;
+    guint64 checksum; /* see xi_checksum() */
+} XiRecord;
+
+static void extended_track_info_free(gpointer data) {
+    ExtendedTrackInfo *sei = data;
+
+    if (sei) {
+        g_free(sei->pc_path_locale);
+        g_free(sei->pc_path_utf8);
+        g_free(sei->thumb_path_locale);
+        g_free(sei->thumb_path_utf8);
+        g_free(sei->sha1_hash);
+        g_free(sei->sha1_signature);
+        g_free(sei->charset);
+        g_free(sei->hostname);
+        g_free(sei->converted_file);
+        g_free(sei->ipod_path);
+        g_free(sei);
+    }
+}
+
+void extended_info_free(ExtendedInfo *info) {
+    if (!info)
+        return;
+
+    if (info->by_id)
+        g_hash_table_destroy(info->by_id);
+    if (info->by_dbid)
+        g_hash_table_destroy(info->by_dbid);
+    if (info->by_sha1)
+        g_hash_table_destroy(info->by_sha1);
+    g_list_free_full(info->pending_deletion, g_free);
+    g_string_free(info->warnings, TRUE);
+    extended_info_journal_free(info->journal);
+    g_free(info);
+}
+
+static ExtendedInfoJournal *xi_journal_new(const gchar *name) {
+    ExtendedInfoJournal *journal = g_new0(ExtendedInfoJournal, 1);
+
+    journal->name = g_strdup(name);
+    journal->records = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+    return journal;
+}
+
+static void xi_journal_add(GHashTable *records, guint64 dbid, guint64 checksum) {
+    XiRecord *record = g_new(XiRecord, 1);
+
+    record->dbid = dbid;
+    record->checksum = checksum;
+    g_hash_table_replace(records, &record->dbid, record);
+}
+
+void extended_info_journal_free(ExtendedInfoJournal *journal) {
+    if (journal) {
+        g_free(journal->name);
+        g_hash_table_destroy(journal->records);
+        g_free(journal);
+    }
+}
+
+/* 64 bit FNV-1a hash of @len bytes at @data, used to notice changes
+ * to the records of a track */
+static guint64 xi_checksum(const guchar *data, gsize len) {
+    guint64 hash = G_GUINT64_CONSTANT(14695981039346656037);
+    gsize i;
+
+    for (i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= G_GUINT64_CONSTANT(1099511628211);
+    }
+    return hash;
+}
+
+/* Index @sei according to the iTunesDB hash read */
+static void xi_info_add_track(ExtendedInfo *info, ExtendedTrackInfo *sei) {
+    if (info->hash_matched && sei->dbid) {
+        if (!info->by_dbid)
+            info->by_dbid = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, extended_track_info_free);
+        g_hash_table_replace(info->by_dbid, &sei->dbid, sei);
+    }
+    else if (info->hash_matched) {
+        if (!info->by_id)
+            info->by_id = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, extended_track_info_free);
+        g_hash_table_replace(info->by_id, &sei->ipod_id, sei);
+    }
+    else if (sei->sha1_hash) {
+        if (!info->by_sha1)
+            info->by_sha1 = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, extended_track_info_free);
+        g_hash_table_replace(info->by_sha1, sei->sha1_hash, sei);
+    }
+    else {
+        extended_track_info_free(sei);
+    }
+}
+
+/* Add the track read last, if any, to the current segment. @record
+ * is the record following its data (binary format only). */
+static void xi_parser_end_track(XiParser *parser, const guchar *record) {
+    ExtendedTrackInfo *sei = parser->sei;
+
+    if (!sei)
+        return;
+    parser->sei = NULL;
+
+    if (parser->sei_data && record)
+        sei->record_checksum = xi_checksum(parser->sei_data, record - parser->sei_data);
+    parser->sei_data = NULL;
+
+    if (sei->ipod_id == 0) {
+        /* a deleted track that hasn't yet been removed from the
+         * iPod's hard drive */
+        if (sei->ipod_path)
+            parser->seg_pending = g_list_prepend(parser->seg_pending, g_strdup(sei->ipod_path));
+        extended_track_info_free(sei);
+    }
+    else {
+        parser->seg_tracks = g_list_prepend(parser->seg_tracks, sei);
+    }
+}
+
+/* Forget the segment being read */
+static void xi_parser_discard(XiParser *parser) {
+    extended_track_info_free(parser->sei);
+    parser->sei = NULL;
+    parser->sei_data = NULL;
+    g_free(parser->seg_hash);
+    parser->seg_hash = NULL;
+    g_list_free_full(parser->seg_tracks, extended_track_info_free);
+    parser->seg_tracks = NULL;
+    g_array_set_size(parser->seg_removed, 0);
+    g_list_free_full(parser->seg_pending, g_free);
+    parser->seg_pending = NULL;
+}
+
+/* Apply the segment read, ending with @record (binary format only) */
+static void xi_parser_commit(XiParser *parser, const guchar *record) {
+    GList *gl;
+    guint i;
+
+    xi_parser_end_track(parser, record);
+
+    g_free(parser->hash);
+    parser->hash = parser->seg_hash;
+    parser->seg_hash = NULL;
+    parser->info->version = parser->seg_version;
+
+    /* each segment lists all tracks pending deletion */
+    g_list_free_full(parser->info->pending_deletion, g_free);
+    parser->info->pending_deletion = g_list_reverse(parser->seg_pending);
+    parser->seg_pending = NULL;
+
+    for (i = 0; i < parser->seg_removed->len; ++i)
+        g_hash_table_remove(parser->tracks, &g_array_index(parser->seg_removed, guint64, i));
+    g_array_set_size(parser->seg_removed, 0);
+
+    parser->seg_tracks = g_list_reverse(parser->seg_tracks);
+    for (gl = parser->seg_tracks; gl; gl = gl->next) {
+        ExtendedTrackInfo *sei = gl->data;
+        if (sei->dbid)
+            g_hash_table_replace(parser->tracks, &sei->dbid, sei);
+        else
+            parser->plain_tracks = g_list_prepend(parser->plain_tracks, sei);
+    }
+    g_list_free(parser->seg_tracks);
+    parser->seg_tracks = NULL;
+
+    parser->committed = TRUE;
+    /* only the binary format has more than one segment */
+    parser->expect_hash = parser->binary;
+}
+
+static void xi_set_format_error(XiParser *parser, GError **error, const gchar *what) {
+    g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("%s:\nFormat error: %s\n"), parser->name, what);
+}
+
+/* Handle the start of a new track. @record is the id record and
+ * @data the records following it (binary format only). */
+static gboolean xi_parser_next_track(XiParser *parser, guint ipod_id, const guchar *record, const guchar *data, GError **error) {
+    if (parser->expect_hash) {
+        xi_set_format_error(parser, error, "id");
+        return FALSE;
+    }
+
+    xi_parser_end_track(parser, record);
+
+    parser->sei = g_new0(ExtendedTrackInfo, 1);
+    parser->sei->ipod_id = ipod_id;
+    parser->sei_data = data;
+    return TRUE;
+}
+
+/* Handle the string field @field of length @len */
+static gboolean xi_parser_set_string(XiParser *parser, XiField field, const gchar *value, gsize len, GError **error) {
+    ExtendedTrackInfo *sei = parser->sei;
+    gchar **target = NULL;
+
+    if (parser->expect_hash) {
+        if (field != XI_FIELD_ITUNESDB_HASH) {
+            g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("%s:\nExpected \"itunesdb_hash=\" but got:\"%.*s\"\n"), parser->name, (gint) len, value);
+            return FALSE;
+        }
+        parser->seg_hash = g_strndup(value, len);
+        parser->expect_hash = FALSE;
+        return TRUE;
+    }
+
+    if (field == XI_FIELD_VERSION) {
+        gchar *version = g_strndup(value, len);
+        parser->seg_version = g_ascii_strtod(version, NULL);
+        g_free(version);
+        return TRUE;
+    }
+
+    if (!sei) {
+        gchar *what = g_strndup(value, len);
+        xi_set_format_error(parser, error, what);
+        g_free(what);
+        return FALSE;
+    }
+
+    switch (field) {
+    case XI_FIELD_HOSTNAME:
+        target = &sei->hostname;
+        break;
+    case XI_FIELD_CONVERTED_FILE:
+        target = &sei->converted_file;
+        break;
+    case XI_FIELD_FILENAME_LOCALE:
+        target = &sei->pc_path_locale;
+        break;
+    case XI_FIELD_FILENAME_UTF8:
+        target = &sei->pc_path_utf8;
+        break;
+    case XI_FIELD_THUMBNAIL_LOCALE:
+        target = &sei->thumb_path_locale;
+        break;
+    case XI_FIELD_THUMBNAIL_UTF8:
+        target = &sei->thumb_path_utf8;
+        break;
+    case XI_FIELD_FILENAME_IPOD:
+        target = &sei->ipod_path;
+        break;
+    case XI_FIELD_SHA1_HASH:
+        /* only accept hash value if version is >= 0.53 or PATH_MAX
+         * is 4096 -- in 0.53 the MD5 hash routine was changed to
+         * using blocks of 4096 Bytes in length. Before it was
+         * PATH_MAX, which might be different on different
+         * architectures. */
+        if ((parser->seg_version >= 0.53) || (PATH_MAX == 4096))
+            target = &sei->sha1_hash;
+        break;
+    case XI_FIELD_SHA1_SIGNATURE:
+        target = &sei->sha1_signature;
+        break;
+    case XI_FIELD_CHARSET:
+        target = &sei->charset;
+        break;
+    default:
+        break;
+    }
+
+    if (target) {
+        g_free(*target);
+        *target = g_strndup(value, len);
+    }
+    return TRUE;
+}
+
+/* Handle the numeric field @field */
+static gboolean xi_parser_set_number(XiParser *parser, XiField field, guint64 value, GError **error) {
+    ExtendedTrackInfo *sei = parser->sei;
+
+    if (field == XI_FIELD_REMOVED) {
+        if (parser->expect_hash) {
+            xi_set_format_error(parser, error, _("field outside of a segment"));
+            return FALSE;
+        }
+        g_array_append_val(parser->seg_removed, value);
+        return TRUE;
+    }
+
+    if (parser->expect_hash || !sei) {
+        xi_set_format_error(parser, error, _("field outside of a track"));
+        return FALSE;
+    }
+
+    switch (field) {
+    case XI_FIELD_DBID:
+        sei->dbid = value;
+        break;
+    case XI_FIELD_PC_MTIME:
+        sei->mtime = (time_t) value;
+        break;
+    case XI_FIELD_LOCAL_ITDB_ID:
+        sei->local_itdb_id = value;
+        break;
+    case XI_FIELD_LOCAL_TRACK_DBID:
+        sei->local_track_dbid = value;
+        break;
+    case XI_FIELD_TRANSFERRED:
+        sei->transferred = (value != 0);
+        break;
+    default:
+        break;
+    }
+    return TRUE;
+}
+
+static gboolean xi_field_is_number(XiField field) {
+    switch (field) {
+    case XI_FIELD_ID:
+    case XI_FIELD_PC_MTIME:
+    case XI_FIELD_LOCAL_ITDB_ID:
+    case XI_FIELD_LOCAL_TRACK_DBID:
+    case XI_FIELD_TRANSFERRED:
+    case XI_FIELD_DBID:
+    case XI_FIELD_REMOVED:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* Parse the binary format. Once a segment has been read completely,
+ * anything that cannot be parsed after it is taken to be the remains
+ * of an append that was interrupted (torn writes, a tail filled with
+ * zeros after a crash): it is ignored and parser->size stays at the
+ * end of the last complete segment, so that the next append
+ * overwrites it. */
+static gboolean xi_parse_binary(XiParser *parser, const guchar *data, gsize length, GError **error) {
+    const guchar *end = data + length;
+    const guchar *p = data + XI_HEADER_SIZE;
+    GError *record_error = NULL;
+
+    if (data[4] > XI_FORMAT_VERSION) {
+        g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("%s:\nThe extended information was written by a newer version of gtkpod.\n"), parser->name);
+        return FALSE;
+    }
+
+    while (p < end) {
+        const guchar *record = p;
+        XiField field;
+        guint32 len;
+
+        if ((gsize) (end - p) < XI_RECORD_HEADER_SIZE)
+            break;
+        field = p[0];
+        memcpy(&len, p + 1, sizeof(len));
+        len = GUINT32_FROM_LE(len);
+        p += XI_RECORD_HEADER_SIZE;
+        if ((gsize) (end - p) < len)
+            break;
+
+        if ((field == XI_FIELD_UNKNOWN) || (field > XI_FIELD_LAST)) {
+            /* skipped within the first segment only, tag 0 is never
+             * written */
+            if (parser->committed) {
+                xi_set_format_error(parser, &record_error, _("unknown field"));
+                break;
+            }
+        }
+        else if (field == XI_FIELD_END) {
+            if (parser->expect_hash) {
+                xi_set_format_error(parser, &record_error, _("empty segment"));
+                break;
+            }
+            xi_parser_commit(parser, record);
+            parser->size = p + len - data;
+            if (parser->base_size == 0)
+                parser->base_size = parser->size;
+        }
+        else if (xi_field_is_number(field)) {
+            guint64 value;
+
+            if (len != sizeof(value)) {
+                xi_set_format_error(parser, &record_error, _("invalid number"));
+                break;
+            }
+            memcpy(&value, p, sizeof(value));
+            value = GUINT64_FROM_LE(value);
+            if (field == XI_FIELD_ID) {
+                if (!xi_parser_next_track(parser, (guint) value, record, p + len, &record_error))
+                    break;
+            }
+            else {
+                if (field == XI_FIELD_REMOVED)
+                    xi_parser_end_track(parser, record);
+                if (!xi_parser_set_number(parser, field, value, &record_error))
+                    break;
+            }
+        }
+        else if (!xi_parser_set_string(parser, field, (const gchar *) p, len, &record_error)) {
+            break;
+        }
+        p += len;
+    }
+
+    if (!parser->committed) {
+        if (record_error)
+            g_propagate_error(error, record_error);
+        else
+            xi_set_format_error(parser, error, _("truncated record"));
+        return FALSE;
+    }
+    /* keep the segments read so far, drop the incomplete one */
+    if (record_error)
+        g_error_free(record_error);
+    xi_parser_discard(parser);
+    return TRUE;
+}
+
+/* Parse the "key=value" format used by older versions */
+static gboolean xi_parse_text(XiParser *parser, const gchar *data, gsize length, GError **error) {
+    const gchar *end = data + length;
+    const gchar *p = data;
+
+    while (p < end) {
+        const gchar *eol, *key, *arg;
+        XiField field = XI_FIELD_UNKNOWN;
+        gsize keylen, arglen;
+        gint i;
+
+        eol = memchr(p, '\n', end - p);
+        if (!eol)
+            eol = end;
+        key = p;
+        p = eol + 1;
+
+        /* allow comments */
+        if ((key == eol) || (*key == ';') || (*key == '#'))
+            continue;
+        arg = memchr(key, '=', eol - key);
+        if (!arg || (arg == key)) {
+            g_string_append_printf(parser->info->warnings, _("Error while reading extended info: %.*s\n"), (gint) (eol - key), key);
+            continue;
+        }
+        /* skip whitespace (isblank() is a GNU extension... */
+        while ((*key == ' ') || (*key == 0x09))
+            ++key;
+        keylen = arg - key;
+        ++arg;
+        arglen = eol - arg;
+
+        for (i = 0; xi_text_keys[i].key; ++i) {
+            if ((strlen(xi_text_keys[i].key) == keylen) && (g_ascii_strncasecmp(key, xi_text_keys[i].key, keylen) == 0)) {
+                field = xi_text_keys[i].field;
+                break;
+            }
+        }
+
+        if (parser->expect_hash && (field != XI_FIELD_ITUNESDB_HASH)) {
+            g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("%s:\nExpected \"itunesdb_hash=\" but got:\"%.*s\"\n"), parser->name, (gint) (eol - key), key);
+            return FALSE;
+        }
+
+        if (field == XI_FIELD_ID) {
+            gchar buf[32];
+
+            if ((arglen == 3) && (strncmp(arg, "xxx", 3) == 0)) {
+                xi_parser_commit(parser, NULL);
+                continue;
+            }
+            g_strlcpy(buf, arg, MIN(arglen + 1, sizeof(buf)));
+            if (!xi_parser_next_track(parser, atoi(buf), NULL, NULL, error))
+                return FALSE;
+        }
+        else if (xi_field_is_number(field)) {
+            gchar buf[32];
+
+            if (!parser->sei) {
+                gchar *what = g_strndup(key, eol - key);
+                xi_set_format_error(parser, error, what);
+                g_free(what);
+                return FALSE;
+            }
+            g_strlcpy(buf, arg, MIN(arglen + 1, sizeof(buf)));
+            if (field == XI_FIELD_TRANSFERRED)
+                parser->sei->transferred = atoi(buf);
+            else if (!xi_parser_set_number(parser, field, g_ascii_strtoull(buf, NULL, 10), error))
+                return FALSE;
+        }
+        else if (field != XI_FIELD_UNKNOWN) {
+            if (!xi_parser_set_string(parser, field, arg, arglen, error))
+                return FALSE;
+        }
+        else if (!parser->sei) {
+            /* unknown keys are ignored, but only within a track */
+            gchar *what = g_strndup(key, eol - key);
+            xi_set_format_error(parser, error, what);
+            g_free(what);
+            return FALSE;
+        }
+    }
+
+    /* older versions did not always end the file with "id=xxx". A
+     * track not terminated by another id is incomplete, though. */
+    extended_track_info_free(parser->sei);
+    parser->sei = NULL;
+    if (!parser->committed)
+        xi_parser_commit(parser, NULL);
+    return TRUE;
+}
+
+/* Index the tracks of the segments read. If @journal is not NULL, the
+ * tracks are also recorded there, see extended_info_write(). */
+static void xi_parser_finish(XiParser *parser, ExtendedInfoJournal *journal) {
+    ExtendedInfo *info = parser->info;
+    GHashTableIter iter;
+    gpointer value;
+    GList *gl;
+
+    info->hash_matched = (strcmp(parser->hash, parser->sha1) == 0);
+
+    g_hash_table_iter_init(&iter, parser->tracks);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        ExtendedTrackInfo *sei = value;
+        if (journal)
+            xi_journal_add(journal->records, sei->dbid, sei->record_checksum);
+        g_hash_table_iter_steal(&iter);
+        xi_info_add_track(info, sei);
+    }
+    for (gl = parser->plain_tracks; gl; gl = gl->next)
+        xi_info_add_track(info, gl->data);
+    g_list_free(parser->plain_tracks);
+    parser->plain_tracks = NULL;
+}
+
+/**
+ * extended_info_read:
+ *
+ * Read the extended information file @name and check if @itunes is
+ * the corresponding iTunesDB (using the itunesdb_hash stored in
+ * @name). The information is indexed by dbid (or ipod_id for files
+ * written by older versions) if @itunes matches, otherwise by the
+ * SHA1 checksums of the tracks.
+ *
+ * May be called from any thread.
+ *
+ * Returns the information read or NULL on failure. @error is in the
+ * G_FILE_ERROR domain if @name could not be read.
+ */
+ExtendedInfo *extended_info_read(const gchar *name, const gchar *itunes, GError **error) {
+    GMappedFile *map;
+    const gchar *data;
+    gsize length;
+    XiParser parser;
+    gchar *sha1;
+    gboolean success;
+
+    g_return_val_if_fail (name, NULL);
+    g_return_val_if_fail (itunes, NULL);
+
+    map = g_mapped_file_new(name, FALSE, error);
+    if (!map)
+        return NULL;
+
+    /* independent of "sha1_mode" so that changing the mode does not
+     * invalidate the extended information */
+    sha1 = sha1_hash_on_filename_with_mode((gchar *) itunes, TRUE, SHA1_MODE_QUICK);
+    if (!sha1) {
+        g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("Could not create hash value from itunesdb\n"));
+        g_mapped_file_unref(map);
+        return NULL;
+    }
+
+    memset(&parser, 0, sizeof(parser));
+    parser.name = name;
+    parser.sha1 = sha1;
+    parser.expect_hash = TRUE; /* first we expect the hash value (checksum) */
+    parser.info = g_new0(ExtendedInfo, 1);
+    parser.info->warnings = g_string_new("");
+    parser.seg_removed = g_array_new(FALSE, FALSE, sizeof(guint64));
+    parser.tracks = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, extended_track_info_free);
+
+    data = g_mapped_file_get_contents(map);
+    length = g_mapped_file_get_length(map);
+    parser.binary = (length >= XI_HEADER_SIZE) && (memcmp(data, XI_MAGIC, strlen(XI_MAGIC)) == 0);
+    if (parser.binary)
+        success = xi_parse_binary(&parser, (const guchar *) data, length, error);
+    else
+        success = xi_parse_text(&parser, data, length, error);
+
+    if (success && !parser.hash) {
+        xi_set_format_error(&parser, error, _("no itunesdb_hash"));
+        success = FALSE;
+    }
+    if (success) {
+        ExtendedInfoJournal *journal = NULL;
+        struct stat statbuf;
+
+        /* further saves can append to the file if it can be matched
+         * to the iTunesDB by dbid */
+        if (parser.binary && !parser.plain_tracks && (strcmp(parser.hash, sha1) == 0) && (g_stat(name, &statbuf) == 0)) {
+            journal = xi_journal_new(name);
+            journal->size = parser.size;
+            journal->base_size = parser.base_size;
+            journal->stat_size = statbuf.st_size;
+            journal->mtime = statbuf.st_mtime;
+        }
+        xi_parser_finish(&parser, journal);
+        parser.info->journal = journal;
+    }
+
+    xi_parser_discard(&parser);
+    g_array_free(parser.seg_removed, TRUE);
+    g_hash_table_destroy(parser.tracks);
+    g_list_free_full(parser.plain_tracks, extended_track_info_free);
+    g_free(parser.hash);
+    g_mapped_file_unref(map);
+    g_free(sha1);
+
+    if (success && !parser.info->hash_matched && !parser.info->by_sha1) {
+        g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("No SHA1 checksums on individual tracks are available.\n\nTo avoid this situation in the future either switch on duplicate detection (will provide SHA1 checksums) or avoid using the iPod with programs other than gtkpod.\n\n"));
+        success = FALSE;
+    }
+    if (!success) {
+        extended_info_free(parser.info);
+        return NULL;
+    }
+    return parser.info;
+}
+
+static gpointer extended_info_read_thread(gpointer data) {
+    ExtendedInfoLoader *loader = data;
+
+    loader->info = extended_info_read(loader->name, loader->itunes, &loader->error);
+    return NULL;
+}
+
+/**
+ * extended_info_read_async:
+ *
+ * Start reading the extended information file @name in a background
+ * thread, see extended_info_read(). The result must be collected
+ * with extended_info_read_finish().
+ */
+ExtendedInfoLoader *extended_info_read_async(const gchar *name, const gchar *itunes) {
+    ExtendedInfoLoader *loader;
+
+    g_return_val_if_fail (name, NULL);
+    g_return_val_if_fail (itunes, NULL);
+
+    loader = g_new0(ExtendedInfoLoader, 1);
+    loader->name = g_strdup(name);
+    loader->itunes = g_strdup(itunes);
+    loader->thread = g_thread_new("extended-info", extended_info_read_thread, loader);
+
+    return loader;
+}
+
+/* Wait for @loader to finish and return its result. @loader is
+ * freed. */
+ExtendedInfo *extended_info_read_finish(ExtendedInfoLoader *loader, GError **error) {
+    ExtendedInfo *info;
+
+    g_return_val_if_fail (loader, NULL);
+
+    g_thread_join(loader->thread);
+    info = loader->info;
+    if (loader->error)
+        g_propagate_error(error, loader->error);
+
+    g_free(loader->name);
+    g_free(loader->itunes);
+    g_free(loader);
+
+    return info;
+}
+
+static void xi_append_record(GByteArray *buf, XiField field, gconstpointer data, guint32 len) {
+    guint8 tag = field;
+    guint32 len_le = GUINT32_TO_LE(len);
+
+    g_byte_array_append(buf, &tag, 1);
+    g_byte_array_append(buf, (const guint8 *) &len_le, sizeof(len_le));
+    if (len > 0)
+        g_byte_array_append(buf, data, len);
+}
+
+/* Append @value unless it is NULL or empty */
+static void xi_append_string(GByteArray *buf, XiField field, const gchar *value) {
+    if (value && *value)
+        xi_append_record(buf, field, value, strlen(value));
+}
+
+static void xi_append_number(GByteArray *buf, XiField field, guint64 value) {
+    guint64 value_le = GUINT64_TO_LE(value);
+
+    xi_append_record(buf, field, &value_le, sizeof(value_le));
+}
+
+/* Append the records of @track to @buf. The dbid is only written if
+ * @with_dbid is TRUE.
+ *
+ * Returns the checksum of the records following the id, which is
+ * what the reader computes for the track. */
+static guint64 xi_append_track(GByteArray *buf, Track *track, gboolean with_dbid) {
+    ExtraTrackData *etr = track->userdata;
+    guint start;
+
+    xi_append_number(buf, XI_FIELD_ID, track->id);
+    start = buf->len;
+    if (with_dbid)
+        xi_append_number(buf, XI_FIELD_DBID, track->dbid);
+    xi_append_string(buf, XI_FIELD_HOSTNAME, etr->hostname);
+    xi_append_string(buf, XI_FIELD_CONVERTED_FILE, etr->converted_file);
+    xi_append_string(buf, XI_FIELD_FILENAME_LOCALE, etr->pc_path_locale);
+    xi_append_string(buf, XI_FIELD_FILENAME_UTF8, etr->pc_path_utf8);
+    xi_append_string(buf, XI_FIELD_THUMBNAIL_LOCALE, etr->thumb_path_locale);
+    xi_append_string(buf, XI_FIELD_THUMBNAIL_UTF8, etr->thumb_path_utf8);
+    /* this is just for convenience for people looking for a track
+     on the ipod away from gktpod/itunes etc. */
+    xi_append_string(buf, XI_FIELD_FILENAME_IPOD, track->ipod_path);
+    if (etr->sha1_hash && *etr->sha1_hash) {
+        xi_append_string(buf, XI_FIELD_SHA1_HASH, etr->sha1_hash);
+        xi_append_string(buf, XI_FIELD_SHA1_SIGNATURE, etr->sha1_signature);
+    }
+    xi_append_string(buf, XI_FIELD_CHARSET, etr->charset);
+    if (etr->mtime)
+        xi_append_number(buf, XI_FIELD_PC_MTIME, etr->mtime);
+    if (etr->local_itdb_id)
+        xi_append_number(buf, XI_FIELD_LOCAL_ITDB_ID, etr->local_itdb_id);
+    if (etr->local_track_dbid)
+        xi_append_number(buf, XI_FIELD_LOCAL_TRACK_DBID, etr->local_track_dbid);
+    xi_append_number(buf, XI_FIELD_TRANSFERRED, track->transferred);
+
+    return xi_checksum(buf->data + start, buf->len - start);
+}
+
+/* Append the start of a segment */
+static void xi_append_segment_start(GByteArray *buf, const gchar *sha1) {
+    xi_append_string(buf, XI_FIELD_ITUNESDB_HASH, sha1);
+    xi_append_string(buf, XI_FIELD_VERSION, VERSION);
+}
+
+/* Append the tracks pending deletion and the end of a segment */
+static void xi_append_segment_end(GByteArray *buf, GList *pending_deletion) {
+    GList *gl;
+
+    for (gl = pending_deletion; gl; gl = gl->next) {
+        Track *track = gl->data;
+
+        xi_append_number(buf, XI_FIELD_ID, 0); /* our sign for tracks pending deletion */
+        xi_append_string(buf, XI_FIELD_FILENAME_IPOD, track->ipod_path);
+    }
+    xi_append_record(buf, XI_FIELD_END, NULL, 0);
+}
+
+/* Tracks can only be identified by dbid if all of them have a
+ * unique one */
+static gboolean xi_dbids_usable(iTunesDB *itdb) {
+    GHashTable *dbids = g_hash_table_new(g_int64_hash, g_int64_equal);
+    gboolean usable = TRUE;
+    GList *gl;
+
+    for (gl = itdb->tracks; gl && usable; gl = gl->next) {
+        Track *track = gl->data;
+
+        if ((track->dbid == 0) || g_hash_table_lookup(dbids, &track->dbid))
+            usable = FALSE;
+        else
+            g_hash_table_insert(dbids, &track->dbid, track);
+    }
+    g_hash_table_destroy(dbids);
+    return usable;
+}
+
+static void xi_set_write_error(GError **error, const gchar *name, gint errsv) {
+    gchar *name_utf8 = g_filename_display_name(name);
+    g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("Error writing to '%s' (%s)\n"), name_utf8, g_strerror(errsv));
+    g_free(name_utf8);
+}
+
+/* TRUE if a new segment can be appended to @journal->name, i.e. if
+ * the file is still the one written or read last and the segments
+ * appended so far don't take up too much space */
+static gboolean xi_journal_usable(ExtendedInfoJournal *journal, const gchar *name) {
+    struct stat statbuf;
+
+    if (strcmp(journal->name, name) != 0)
+        return FALSE;
+    if (g_stat(name, &statbuf) != 0)
+        return FALSE;
+    if ((statbuf.st_size != journal->stat_size) || (statbuf.st_mtime != journal->mtime))
+        return FALSE;
+    /* compact the file once it has grown by half */
+    return (journal->size - journal->base_size) <= journal->base_size / 2;
+}
+
+/* Remember the size and modification time of @journal->name */
+static gboolean xi_journal_stat(ExtendedInfoJournal *journal) {
+    struct stat statbuf;
+
+    if (g_stat(journal->name, &statbuf) != 0)
+        return FALSE;
+    journal->stat_size = statbuf.st_size;
+    journal->mtime = statbuf.st_mtime;
+    return TRUE;
+}
+
+/* Append the tracks of @itdb that changed since @journal was written
+ * as a new segment. The segment is written at the end of the last
+ * complete segment, overwriting the remains of an interrupted one. */
+static gboolean xi_write_segment(ExtendedInfoJournal *journal, iTunesDB *itdb, const gchar *sha1, GList *pending_deletion, GError **error) {
+    GHashTable *records;
+    GHashTableIter iter;
+    gpointer value;
+    GByteArray *buf, *track_buf;
+    gint fd, errsv = 0;
+    guint written = 0;
+    GList *gl;
+
+    buf = g_byte_array_new();
+    track_buf = g_byte_array_new();
+    records = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+
+    xi_append_segment_start(buf, sha1);
+    for (gl = itdb->tracks; gl; gl = gl->next) {
+        Track *track = gl->data;
+        XiRecord *old;
+        guint64 checksum;
+
+        g_byte_array_set_size(track_buf, 0);
+        checksum = xi_append_track(track_buf, track, TRUE);
+        old = g_hash_table_lookup(journal->records, &track->dbid);
+        if (!old || (old->checksum != checksum))
+            g_byte_array_append(buf, track_buf->data, track_buf->len);
+        xi_journal_add(records, track->dbid, checksum);
+    }
+    g_hash_table_iter_init(&iter, journal->records);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        XiRecord *old = value;
+        if (!g_hash_table_lookup(records, &old->dbid))
+            xi_append_number(buf, XI_FIELD_REMOVED, old->dbid);
+    }
+    xi_append_segment_end(buf, pending_deletion);
+    g_byte_array_free(track_buf, TRUE);
+
+    fd = g_open(journal->name, O_WRONLY, 0);
+    if ((fd == -1) || (lseek(fd, journal->size, SEEK_SET) == (off_t) -1)) {
+        errsv = errno;
+    }
+    else {
+        while (written < buf->len) {
+            ssize_t n = write(fd, buf->data + written, buf->len - written);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                errsv = errno;
+                break;
+            }
+            written += n;
+        }
+        if ((errsv == 0) && (ftruncate(fd, journal->size + buf->len) != 0))
+            errsv = errno;
+        if ((errsv == 0) && (fsync(fd) != 0) && (errno != EINVAL))
+            errsv = errno;
+    }
+    if ((fd != -1) && (close(fd) != 0) && (errsv == 0))
+        errsv = errno;
+
+    if (errsv == 0) {
+        journal->size += buf->len;
+        g_hash_table_destroy(journal->records);
+        journal->records = records;
+        if (!xi_journal_stat(journal))
+            errsv = errno;
+    }
+    else {
+        g_hash_table_destroy(records);
+    }
+    g_byte_array_free(buf, TRUE);
+
+    if (errsv != 0) {
+        xi_set_write_error(error, journal->name, errsv);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Write all tracks of @itdb into a new file, which then replaces
+ * @name. Returns a journal for the file if @with_dbid is TRUE. */
+static gboolean xi_write_full(const gchar *name, iTunesDB *itdb, const gchar *sha1, GList *pending_deletion, gboolean with_dbid, ExtendedInfoJournal **journal, GError **error) {
+    guchar header[XI_HEADER_SIZE] = { 0 };
+    ExtendedInfoJournal *new_journal = NULL;
+    GByteArray *buf;
+    gchar *tmpname;
+    gsize size = 0;
+    GList *gl;
+    FILE *fp;
+    gint errsv;
+
+    tmpname = g_strdup_printf("%s.new", name);
+    fp = fopen(tmpname, "wb");
+    if (!fp) {
+        g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("Could not open \"%s\" for writing extended info.\n"), tmpname);
+        g_free(tmpname);
+        return FALSE;
+    }
+    if (with_dbid && journal)
+        new_journal = xi_journal_new(name);
+
+    buf = g_byte_array_new();
+    memcpy(header, XI_MAGIC, strlen(XI_MAGIC));
+    header[4] = XI_FORMAT_VERSION;
+    g_byte_array_append(buf, header, sizeof(header));
+    xi_append_segment_start(buf, sha1);
+
+    for (gl = itdb->tracks; gl; gl = gl->next) {
+        Track *track = gl->data;
+        guint64 checksum;
+
+        checksum = xi_append_track(buf, track, with_dbid);
+        if (new_journal)
+            xi_journal_add(new_journal->records, track->dbid, checksum);
+        if (buf->len >= XI_WRITE_BUFFER_SIZE) {
+            fwrite(buf->data, buf->len, 1, fp);
+            size += buf->len;
+            g_byte_array_set_size(buf, 0);
+        }
+    }
+    xi_append_segment_end(buf, pending_deletion);
+    fwrite(buf->data, buf->len, 1, fp);
+    size += buf->len;
+    g_byte_array_free(buf, TRUE);
+
+    errsv = ferror(fp) ? (errno ? errno : EIO) : 0;
+    if ((errsv == 0) && ((fflush(fp) != 0) || ((fsync(fileno(fp)) != 0) && (errno != EINVAL))))
+        errsv = errno;
+    if ((fclose(fp) != 0) && (errsv == 0))
+        errsv = errno;
+    if ((errsv == 0) && (g_rename(tmpname, name) != 0))
+        errsv = errno;
+    if (errsv != 0)
+        g_unlink(tmpname);
+    g_free(tmpname);
+
+    if (errsv != 0) {
+        xi_set_write_error(error, name, errsv);
+        extended_info_journal_free(new_journal);
+        return FALSE;
+    }
+
+    if (new_journal) {
+        new_journal->size = size;
+        new_journal->base_size = size;
+        if (!xi_journal_stat(new_journal)) {
+            extended_info_journal_free(new_journal);
+            new_journal = NULL;
+        }
+    }
+    if (journal)
+        *journal = new_journal;
+    return TRUE;
+}
+
+/**
+ * extended_info_write:
+ *
+ * Write the extended information (sha1 hash, PC-filename...) of the
+ * tracks of @itdb into @name. @itdb->filename is used to calculate
+ * the checksum of the corresponding iTunesDB. @pending_deletion lists
+ * the tracks that are still to be removed from the iPod.
+ *
+ * @journal: if not NULL, describes what has been written to @name
+ * before (it is returned by extended_info_read() or by a previous
+ * call). If possible only the tracks that changed since are appended
+ * to @name. Otherwise the file is written from scratch. *@journal is
+ * updated accordingly and may be set to NULL.
+ *
+ * Returns FALSE and sets @error on failure.
+ */
+gboolean extended_info_write(const gchar *name, iTunesDB *itdb, GList *pending_deletion, ExtendedInfoJournal **journal, GError **error) {
+    gboolean with_dbid, result;
+    gchar *sha1;
+    GList *gl;
+
+    g_return_val_if_fail (name, FALSE);
+    g_return_val_if_fail (itdb, FALSE);
+    g_return_val_if_fail (itdb->filename, FALSE);
+
+    for (gl = itdb->tracks; gl; gl = gl->next) {
+        Track *track = gl->data;
+        g_return_val_if_fail (track, FALSE);
+        g_return_val_if_fail (track->userdata, FALSE);
+    }
+    for (gl = pending_deletion; gl; gl = gl->next) {
+        g_return_val_if_fail (gl->data, FALSE);
+    }
+
+    sha1 = sha1_hash_on_filename_with_mode(itdb->filename, FALSE, SHA1_MODE_QUICK);
+    if (!sha1) {
+        g_set_error(error, GTKPOD_GENERAL_ERROR, GTKPOD_GENERAL_ERROR_FAILED, _("Aborted writing of extended info.\n"));
+        return FALSE;
+    }
+
+    with_dbid = xi_dbids_usable(itdb);
+    if (journal && *journal && with_dbid && xi_journal_usable(*journal, name)) {
+        /* if appending fails the file is written from scratch */
+        if (xi_write_segment(*journal, itdb, sha1, pending_deletion, NULL)) {
+            g_free(sha1);
+            return TRUE;
+        }
+    }
+    if (journal) {
+        extended_info_journal_free(*journal);
+        *journal = NULL;
+    }
+
+    result = xi_write_full(name, itdb, sha1, pending_deletion, with_dbid, journal, error);
+    g_free(sha1);
+    return result;
+}
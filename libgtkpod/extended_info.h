@@ -0,0 +1,95 @@
+/*
+|  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+|  Part of the gtkpod project.
+|
+|  URL: http://www.gtkpod.org/
+|  URL: http://gtkpod.sourceforge.net/
+|
+|  This program is free software; you can redistribute it and/or modify
+|  it under the terms of the GNU General Public License as published by
+|  the Free Software Foundation; either version 2 of the License, or
+|  (at your option) any later version.
+|
+|  This program is distributed in the hope that it will be useful,
+|  but WITHOUT ANY WARRANTY; without even the implied warranty of
+|  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+|  GNU General Public License for more details.
+|
+|  You should have received a copy of the GNU General Public License
+|  along with this program; if not, write to the Free Software
+|  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+|
+|  iTunes and iPod are trademarks of Apple
+|
+|  This product is not supported/written/published by Apple!
+|
+|  $Id$
+*/
+
+#ifndef __EXTENDED_INFO_H__
+#define __EXTENDED_INFO_H__
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+#include "itdb.h"
+
+/* Information gtkpod keeps about a track in the extended information
+ * file next to the iTunesDB. See ExtraTrackData in gp_itdb.h for
+ * explanations. */
+typedef struct {
+    guint ipod_id;
+    guint64 dbid; /* 0 if not known */
+    gchar *pc_path_locale;
+    gchar *pc_path_utf8;
+    time_t mtime;
+    gchar *thumb_path_locale;
+    gchar *thumb_path_utf8;
+    gchar *converted_file;
+    gchar *sha1_hash;
+    gchar *sha1_signature;
+    gchar *charset;
+    gchar *hostname;
+    gchar *ipod_path;
+    guint64 local_itdb_id;
+    guint64 local_track_dbid;
+    gboolean transferred;
+    guint64 record_checksum; /* used to notice changes when saving */
+} ExtendedTrackInfo;
+
+typedef struct _ExtendedInfoJournal ExtendedInfoJournal;
+
+/* Contents of an extended information file */
+typedef struct {
+    gdouble version; /* version of gtkpod that wrote the file */
+    gboolean hash_matched; /* file belongs to the iTunesDB read */
+    GHashTable *by_dbid; /* dbid -> ExtendedTrackInfo if
+			    @hash_matched */
+    GHashTable *by_id; /* ipod_id -> ExtendedTrackInfo if
+			  @hash_matched and the dbid is not known */
+    GHashTable *by_sha1; /* sha1_hash -> ExtendedTrackInfo
+			    otherwise */
+    GList *pending_deletion; /* ipod_path of the tracks still to be
+				removed from the iPod */
+    GString *warnings; /* problems that did not stop reading */
+    ExtendedInfoJournal *journal; /* for extended_info_write(), may be
+				     NULL */
+} ExtendedInfo;
+
+typedef struct _ExtendedInfoLoader ExtendedInfoLoader;
+
+ExtendedInfo *extended_info_read (const gchar *name, const gchar *itunes,
+				  GError **error);
+ExtendedInfoLoader *extended_info_read_async (const gchar *name,
+					      const gchar *itunes);
+ExtendedInfo *extended_info_read_finish (ExtendedInfoLoader *loader,
+					 GError **error);
+void extended_info_free (ExtendedInfo *info);
+
+gboolean extended_info_write (const gchar *name, iTunesDB *itdb,
+			      GList *pending_deletion,
+			      ExtendedInfoJournal **journal, GError **error);
+void extended_info_journal_free (ExtendedInfoJournal *journal);
+#endif
@@ -53,6 +53,7 @@
 #include "misc_conversion.h"
 #include "filetype_iface.h"
 #include "gp_private.h"
+#include "thumbnail_cache.h"
 
 #define UNKNOWN_ERROR _("Unknown error")
 
@@ -61,12 +62,13 @@ static const gchar *imageext[] =
     { ".jpg", ".jpeg", ".png", ".pbm", ".pgm", ".ppm", ".tif", ".tiff", ".gif", NULL };
 
 /*
- * Struct to hold the track added signal and
+ * Struct to hold the track added signals and
  * hashtable of itdb to count of tracks added
  * so far
  */
 typedef struct {
     gulong file_added_signal_id;
+    gulong files_added_signal_id;
     GHashTable *itdb_tracks_count;
 } TrackMonitor;
 
@@ -79,35 +81,37 @@ typedef struct {
     gint count;
 } TrackMonitorPair;
 
+static Track *read_track_info_from_file(gchar *name, Track *orig_track, GError **error);
+static gboolean add_new_track_by_filename(iTunesDB *itdb, gchar *fname, Track *track, Playlist *plitem, AddTrackFunc addtrackfunc, gpointer data, GError **error);
+
 /* Single TrackMonitor instance */
 static TrackMonitor *trkmonitor = NULL;
 
+/* Serialises get_file_info() of filetypes that are not reentrant */
+static GMutex file_info_mutex;
+
 /**
- * Callback fired when a new track is added to an itdb.
- * Will be fired from playlist, directory and file functions
+ * Count @n_tracks newly added to @itdb and save the itdb once
+ * the saving threshold has been reached.
  */
-static void file_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data) {
-    Track *track = tk;
-    if (!track)
-        return;
-
-    g_return_if_fail(track->itdb);
+static void file_tracks_added_count(iTunesDB *itdb, gint n_tracks) {
+    g_return_if_fail(itdb);
     g_return_if_fail(trkmonitor);
 
-    guint64 *key = &track->itdb->id;
+    guint64 *key = &itdb->id;
     TrackMonitorPair *value = g_hash_table_lookup(trkmonitor->itdb_tracks_count, key);
     if (!value) {
         value = g_new0(TrackMonitorPair, 1);
         value->id = key;
-        value->count = 1;
+        value->count = n_tracks;
     } else {
-        value->count++;
+        value->count += n_tracks;
     }
 
     /* save every ${file_threshold} files but do at least ${file_theshold} first*/
     int threshold = prefs_get_int("file_saving_threshold");
     if (value->count >= threshold) {
-        gp_save_itdb(track->itdb);
+        gp_save_itdb(itdb);
         gtkpod_tracks_statusbar_update();
         // Reset the count
         value->count = 0;
@@ -116,6 +120,47 @@ static void file_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data) {
     g_hash_table_replace(trkmonitor->itdb_tracks_count, key, value);
 }
 
+/**
+ * Callback fired when a new track is added to an itdb.
+ * Will be fired from playlist, directory and file functions
+ */
+static void file_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data) {
+    Track *track = tk;
+    if (!track)
+        return;
+
+    g_return_if_fail(track->itdb);
+
+    file_tracks_added_count(track->itdb, 1);
+}
+
+/**
+ * Callback fired when a batch of tracks has been added. The tracks
+ * are counted per itdb so that each itdb is saved at most once per
+ * batch.
+ */
+static void file_tracks_added_cb(GtkPodApp *app, gpointer tks, gpointer data) {
+    GList *gl;
+    iTunesDB *itdb = NULL;
+    gint n_tracks = 0;
+
+    for (gl = tks; gl; gl = gl->next) {
+        Track *track = gl->data;
+        g_return_if_fail(track && track->itdb);
+
+        if (track->itdb != itdb) {
+            if (n_tracks > 0)
+                file_tracks_added_count(itdb, n_tracks);
+            itdb = track->itdb;
+            n_tracks = 0;
+        }
+        n_tracks++;
+    }
+
+    if (n_tracks > 0)
+        file_tracks_added_count(itdb, n_tracks);
+}
+
 /**
  * Initialise the file added signal with the callback
  */
@@ -124,6 +169,7 @@ static void init_file_added_signal() {
         trkmonitor = g_new0(TrackMonitor, 1);
         trkmonitor->itdb_tracks_count = g_hash_table_new (g_int64_hash, g_int64_equal);
         trkmonitor->file_added_signal_id = g_signal_connect (gtkpod_app, SIGNAL_TRACK_ADDED, G_CALLBACK (file_track_added_cb), NULL);
+        trkmonitor->files_added_signal_id = g_signal_connect (gtkpod_app, SIGNAL_TRACKS_ADDED, G_CALLBACK (file_tracks_added_cb), NULL);
     }
 }
 
@@ -256,6 +302,7 @@ add_playlist_by_filename(iTunesDB *itdb, gchar *plfile, Playlist *plitem, gint p
      playlist files */
     line = -1; /* nr of line being read */
     errstatus = FALSE;
+    gtkpod_freeze_tracks_added();
     while (!errstatus && fgets(buf, PATH_MAX, fp)) {
         gchar *bufp = buf;
         gchar *filename = NULL;
@@ -341,6 +388,7 @@ add_playlist_by_filename(iTunesDB *itdb, gchar *plfile, Playlist *plitem, gint p
             g_free(filename);
         }
     }
+    gtkpod_thaw_tracks_added();
     fclose(fp);
     C_FREE (dirname);
 
@@ -461,6 +509,100 @@ static void recurse_directories_with_history(gchar *dir, GSList **trknames, gboo
     g_hash_table_destroy(directories);
 }
 
+/*
+ * One file handled by add_directory_by_name(). Files that need their
+ * track information read are handed to the import worker threads,
+ * everything else (playlists, tracks already in the database, ...)
+ * goes through add_track_by_filename() on the main loop.
+ */
+typedef struct {
+    gchar *name; /* filename in local charset */
+    gboolean parallel; /* information is read by a worker thread */
+    gboolean done; /* worker has finished, track and error are set */
+    Track *track;
+    GError *error;
+} ImportItem;
+
+typedef struct {
+    GMutex mutex; /* protects the done flags of all items */
+    GCond done_cond; /* signalled whenever an item is done */
+} ImportPipeline;
+
+/* Number of tracks committed to the database between GUI updates */
+#define IMPORT_BATCH_SIZE 25
+/* Wait this long for a worker before processing GUI events (µs) */
+#define IMPORT_WAIT_TIMEOUT (20 * G_TIME_SPAN_MILLISECOND)
+
+/*
+ * Decide whether @name can be read by a worker thread: it has to be a
+ * new audio or video file that is not excluded by the preferences.
+ * Anything else is left to add_track_by_filename() which will also
+ * produce the appropriate messages.
+ */
+static gboolean import_item_is_parallel(iTunesDB *itdb, gchar *name) {
+    FileType *filetype;
+    gchar *basename;
+    gboolean excluded;
+
+    filetype = determine_filetype(name);
+    if (!filetype_is_audio_filetype(filetype) && !filetype_is_video_filetype(filetype))
+        return FALSE;
+
+    basename = g_path_get_basename(name);
+    excluded = excludefile(basename);
+    g_free(basename);
+    if (excluded)
+        return FALSE;
+
+    return gp_track_by_filename(itdb, name) == NULL;
+}
+
+/*
+ * Thread pool function: read the tags, soundcheck and SHA1 checksum of
+ * one file.
+ */
+static void import_item_read(gpointer data, gpointer user_data) {
+    ImportItem *item = data;
+    ImportPipeline *pipeline = user_data;
+    GError *error = NULL;
+    Track *track;
+
+    track = read_track_info_from_file(item->name, NULL, &error);
+    if (track && (track->size > 0) && prefs_get_int("sha1")) {
+        ExtraTrackData *etr = track->userdata;
+        /* picked up by sha1_track_exists_insert() in gp_track_add() */
+        if (etr && !etr->sha1_hash) {
+            etr->sha1_signature = sha1_file_signature(item->name);
+            etr->sha1_hash = sha1_hash_on_filename(item->name, TRUE);
+        }
+    }
+
+    g_mutex_lock(&pipeline->mutex);
+    item->track = track;
+    item->error = error;
+    item->done = TRUE;
+    g_cond_broadcast(&pipeline->done_cond);
+    g_mutex_unlock(&pipeline->mutex);
+}
+
+/*
+ * Wait until a worker has finished with @item while keeping the GUI
+ * alive.
+ */
+static void import_item_wait(ImportPipeline *pipeline, ImportItem *item) {
+    g_mutex_lock(&pipeline->mutex);
+    while (!item->done) {
+        gint64 end_time = g_get_monotonic_time() + IMPORT_WAIT_TIMEOUT;
+        if (!g_cond_wait_until(&pipeline->done_cond, &pipeline->mutex, end_time)) {
+            g_mutex_unlock(&pipeline->mutex);
+            while (widgets_blocked && gtk_events_pending())
+                gtk_main_iteration();
+            g_mutex_lock(&pipeline->mutex);
+        }
+    }
+    g_mutex_unlock(&pipeline->mutex);
+}
+
 /*
  * Add all files in directory and subdirectories.
  *
@@ -473,6 +615,10 @@ static void recurse_directories_with_history(gchar *dir, GSList **trknames, gboo
  *                      "add_track_to_playlist () -- used for dropping
  *                      tracks at a specific position in the track view
  *
+ * The track information of new files is read by a pool of
+ * "import_threads" worker threads. The tracks are added to the
+ * database on the main loop in the sorted order of the filenames.
+ *
  * return:
  *              value indicating number of added tracks.
  */
@@ -482,21 +628,78 @@ gint add_directory_by_name(iTunesDB *itdb, gchar *name, Playlist *plitem, gboole
     GString *errors = g_string_new("");
     GSList *trknames = NULL;
     GSList *tkn = NULL;
+    ImportPipeline pipeline;
+    ImportItem *items;
+    GThreadPool *pool;
+    guint i, n_items, committed = 0;
 
     g_return_val_if_fail (itdb, 0);
     g_return_val_if_fail (name, 0);
 
     block_widgets();
 
+    init_file_added_signal();
+
+    /* announce all imported tracks to the displays in one go */
+    gtkpod_freeze_tracks_added();
+
     recurse_directories_with_history(name, &trknames, descend);
 
     trknames = sort_tracknames_list(trknames);
 
-    tkn = trknames;
-    while (tkn) {
+    g_mutex_init(&pipeline.mutex);
+    g_cond_init(&pipeline.done_cond);
+    pool = g_thread_pool_new(import_item_read, &pipeline, get_worker_thread_count("import_threads"), FALSE, NULL);
+
+    n_items = g_slist_length(trknames);
+    items = g_new0(ImportItem, n_items);
+    for (i = 0, tkn = trknames; tkn; ++i, tkn = tkn->next) {
+        items[i].name = tkn->data;
+        items[i].parallel = pool && import_item_is_parallel(itdb, items[i].name);
+        if (items[i].parallel)
+            g_thread_pool_push(pool, &items[i], NULL);
+    }
+
+    for (i = 0; i < n_items; ++i) {
+        ImportItem *item = &items[i];
         GError *trkerror = NULL;
-        if (add_track_by_filename(itdb, tkn->data, plitem, descend, addtrackfunc, data, &trkerror)) {
-            result++;
+
+        if (!item->parallel) {
+            if (add_track_by_filename(itdb, item->name, plitem, descend, addtrackfunc, data, &trkerror)) {
+                result++;
+            }
+        }
+        else {
+            import_item_wait(&pipeline, item);
+            trkerror = item->error;
+            item->error = NULL;
+            if (item->track && gp_track_by_filename(itdb, item->name)) {
+                /* added in the meantime, e.g. by a playlist file in
+                 * the same directory */
+                gp_track_free(item->track);
+                item->track = NULL;
+                g_clear_error(&trkerror);
+                if (add_track_by_filename(itdb, item->name, plitem, descend, addtrackfunc, data, &trkerror)) {
+                    result++;
+                }
+            }
+            else if (item->track) {
+                if (add_new_track_by_filename(itdb, item->name, item->track, plitem, addtrackfunc, data, &trkerror)) {
+                    result++;
+                }
+                item->track = NULL;
+            }
+
+            /* print a message about which file is being processed */
+            if ((++committed % IMPORT_BATCH_SIZE) == 0) {
+                gchar *basename = g_path_get_basename(item->name);
+                gchar *bn_utf8 = charset_to_utf8(basename);
+                gtkpod_statusbar_message(_("Processing '%s'..."), bn_utf8);
+                g_free(bn_utf8);
+                g_free(basename);
+                while (widgets_blocked && gtk_events_pending())
+                    gtk_main_iteration();
+            }
         }
 
         if (trkerror) {
@@ -506,10 +709,16 @@ gint add_directory_by_name(iTunesDB *itdb, gchar *name, Playlist *plitem, gboole
             g_error_free(trkerror);
             trkerror = NULL;
         }
-
-        tkn = tkn->next;
     }
 
+    if (pool)
+        g_thread_pool_free(pool, FALSE, TRUE);
+    g_cond_clear(&pipeline.done_cond);
+    g_mutex_clear(&pipeline.mutex);
+    g_free(items);
+
+    gtkpod_thaw_tracks_added();
+
     release_widgets();
 
     if (errors->len > 0) {
@@ -902,6 +1111,7 @@ static gboolean copy_new_info(Track *from, Track *to) {
         changed = TRUE; /* FIXME: probably should actually compare chapters for changes */
     }
 
+    thumbnail_cache_invalidate_track(to);
     itdb_artwork_free(to->artwork);
     to->artwork = itdb_artwork_duplicate(from->artwork);
     if ((to->artwork_size != from->artwork_size) || (to->artwork_count != from->artwork_count) || (to->has_artwork
@@ -1140,12 +1350,9 @@ static void add_coverart(Track *tr) {
     g_free(dirname);
 }
 
-/* Fills the supplied @orig_track with data from the file @name. If
- * @orig_track is NULL, a new track struct is created. The entries
- * pc_path_utf8 and pc_path_locale are not changed if an entry already
- * exists. time_added is not modified if already set. */
-/* Returns NULL on error, a pointer to the Track otherwise */
-Track *get_track_info_from_file(gchar *name, Track *orig_track, GError **error) {
+/* Worker part of get_track_info_from_file(). Does not touch the GUI
+ * and may therefore be called from the import worker threads. */
+static Track *read_track_info_from_file(gchar *name, Track *orig_track, GError **error) {
     Track *track = NULL;
     Track *nti = NULL;
     FileType *filetype;
@@ -1182,7 +1389,14 @@ Track *get_track_info_from_file(gchar *name, Track *orig_track, GError **error)
     }
 
     GError *info_error = NULL;
-    nti = filetype_get_file_info(filetype, name, &info_error);
+    if (filetype_is_reentrant(filetype)) {
+        nti = filetype_get_file_info(filetype, name, &info_error);
+    }
+    else {
+        g_mutex_lock(&file_info_mutex);
+        nti = filetype_get_file_info(filetype, name, &info_error);
+        g_mutex_unlock(&file_info_mutex);
+    }
     if (info_error && !nti) {
         gtkpod_log_error_printf(error, _("No track information could be retrieved from the file %s due to the following error:\n\n%s"), name_utf8, info_error->message);
         g_error_free(info_error);
@@ -1275,11 +1489,22 @@ Track *get_track_info_from_file(gchar *name, Track *orig_track, GError **error)
         nti = NULL;
     }
 
+    g_free(name_utf8);
+
+    return track;
+}
+
+/* Fills the supplied @orig_track with data from the file @name. If
+ * @orig_track is NULL, a new track struct is created. The entries
+ * pc_path_utf8 and pc_path_locale are not changed if an entry already
+ * exists. time_added is not modified if already set. */
+/* Returns NULL on error, a pointer to the Track otherwise */
+Track *get_track_info_from_file(gchar *name, Track *orig_track, GError **error) {
+    Track *track = read_track_info_from_file(name, orig_track, error);
+
     while (widgets_blocked && gtk_events_pending())
         gtk_main_iteration();
 
-    g_free(name_utf8);
-
     return track;
 }
 
@@ -1564,6 +1789,7 @@ void update_track_from_file(iTunesDB *itdb, Track *track) {
                 new_track->ipod_path = track->ipod_path;
                 track->ipod_path = g_strdup("");
                 track->transferred = FALSE;
+                gp_itdb_ipod_path_hash_update_track(track);
 
                 /* cancel conversion/transfer of track */
                 file_convert_cancel_track(track);
@@ -1612,6 +1838,114 @@ void update_track_from_file(iTunesDB *itdb, Track *track) {
  *                                                                  *
  \*------------------------------------------------------------------*/
 
+/* Add @track, just read from the file @fname, to @itdb and to
+ * @plitem. If an identical track (SHA1 checksum) already exists, that
+ * one is used instead and @track is freed. */
+/* @addtrackfunc: if != NULL this will be called instead of
+ "add_track_to_playlist () -- used for dropping tracks at a specific
+ position in the track view */
+static gboolean add_new_track_by_filename(iTunesDB *itdb, gchar *fname, Track *track, Playlist *plitem, AddTrackFunc addtrackfunc, gpointer data, GError **error) {
+    gchar str[PATH_MAX];
+    Playlist *mpl;
+    Track *added_track = NULL;
+    ExtraTrackData *etr;
+
+    g_return_val_if_fail (itdb, FALSE);
+    g_return_val_if_fail (track, FALSE);
+    etr = track->userdata;
+    g_return_val_if_fail (etr, FALSE);
+    mpl = itdb_playlist_mpl(itdb);
+    g_return_val_if_fail (mpl, FALSE);
+
+    if (!plitem)
+        plitem = mpl;
+
+    track->id = 0;
+    track->transferred = FALSE;
+
+    /* is 'fname' on the iPod? -- if yes mark as transfered, if
+     * it's in the music directory */
+    if (itdb->usertype & GP_ITDB_TYPE_IPOD) {
+        const gchar *mountpoint = itdb_get_mountpoint(itdb);
+        g_return_val_if_fail (mountpoint, FALSE);
+        if (strstr(fname, mountpoint) == fname) { /* Yes */
+            /* is 'fname' in the iPod's Music directory? */
+            gchar *music_dir = itdb_get_music_dir(mountpoint);
+            if (music_dir) {
+                gchar *cdir = g_strdup_printf("%s%c", music_dir, G_DIR_SEPARATOR);
+                /* TODO: Use GIO for file/directory operations */
+                if (g_ascii_strncasecmp(fname, cdir, strlen(cdir)) == 0) { /* Yes */
+                    gchar *fname_i = fname + strlen(mountpoint);
+                    if (*fname_i == G_DIR_SEPARATOR)
+                        ++fname_i;
+                    track->transferred = TRUE;
+                    track->ipod_path = g_strdup_printf("%c%s", G_DIR_SEPARATOR, fname_i);
+                    itdb_filename_fs2ipod(track->ipod_path);
+                }
+                g_free(music_dir);
+                g_free(cdir);
+            }
+        }
+    }
+
+    if (gethostname(str, PATH_MAX - 2) == 0) {
+        str[PATH_MAX - 1] = 0;
+        etr->hostname = g_strdup(str);
+    }
+    /* add_track may return pointer to a different track if an
+     identical one (SHA1 checksum) was found */
+    added_track = gp_track_add(itdb, track);
+    g_return_val_if_fail (added_track, FALSE);
+
+    /* set flags to 'podcast' if adding to podcast list */
+    if (itdb_playlist_is_podcasts(plitem))
+        gp_track_set_flags_podcast(added_track);
+
+    if (itdb_playlist_is_mpl(plitem)) { /* add track to master playlist if it wasn't a
+     duplicate */
+        if (added_track == track) {
+            if (addtrackfunc)
+                addtrackfunc(plitem, added_track, data);
+            else
+                gp_playlist_add_track(plitem, added_track, TRUE);
+        }
+    }
+    else {
+#if 0 /* initially iTunes didn't add podcasts to the MPL */
+        /* add track to master playlist if it wasn't a
+         * duplicate and plitem is not the podcasts playlist
+         */
+        if (added_track == track)
+        {
+            if (!itdb_playlist_is_podcasts (plitem))
+            gp_playlist_add_track (mpl, added_track, TRUE);
+        }
+#else
+        if (added_track == track) {
+            gp_playlist_add_track(mpl, added_track, TRUE);
+        }
+#endif
+        /* add track to specified playlist -- unless adding
+         * to podcasts list and track already exists there */
+        if (itdb_playlist_is_podcasts(plitem) && g_list_find(plitem->members, added_track)) {
+            gchar *buf = get_track_info(added_track, FALSE);
+            gtkpod_log_error_printf(error, _("Podcast already present: '%s'\n\n"), buf);
+            g_free(buf);
+        }
+        else {
+            if (addtrackfunc)
+                addtrackfunc(plitem, added_track, data);
+            else
+                gp_playlist_add_track(plitem, added_track, TRUE);
+        }
+    }
+
+    /* indicate that non-transferred files exist */
+    data_changed(itdb);
+
+    return TRUE;
+}
+
 /* Append file @fname to the list of tracks.
  @fname is in the current locale
  @plitem: if != NULL, add track to plitem as well (unless it's the MPL)
@@ -1623,7 +1957,6 @@ void update_track_from_file(iTunesDB *itdb, Track *track) {
  position in the track view */
 gboolean add_track_by_filename(iTunesDB *itdb, gchar *fname, Playlist *plitem, gboolean descend, AddTrackFunc addtrackfunc, gpointer data, GError **error) {
     Track *oldtrack;
-    gchar str[PATH_MAX];
     gchar *basename;
     Playlist *mpl;
     gboolean result = TRUE;
@@ -1697,92 +2030,7 @@ gboolean add_track_by_filename(iTunesDB *itdb, gchar *fname, Playlist *plitem, g
     { /* OK, the same filename does not already exist */
         Track *track = get_track_info_from_file(fname, NULL, error);
         if (track) {
-            Track *added_track = NULL;
-            ExtraTrackData *etr = track->userdata;
-            g_return_val_if_fail (etr, FALSE);
-
-            track->id = 0;
-            track->transferred = FALSE;
-
-            /* is 'fname' on the iPod? -- if yes mark as transfered, if
-             * it's in the music directory */
-            if (itdb->usertype & GP_ITDB_TYPE_IPOD) {
-                const gchar *mountpoint = itdb_get_mountpoint(itdb);
-                g_return_val_if_fail (mountpoint, FALSE);
-                if (strstr(fname, mountpoint) == fname) { /* Yes */
-                    /* is 'fname' in the iPod's Music directory? */
-                    gchar *music_dir = itdb_get_music_dir(mountpoint);
-                    if (music_dir) {
-                        gchar *cdir = g_strdup_printf("%s%c", music_dir, G_DIR_SEPARATOR);
-                        /* TODO: Use GIO for file/directory operations */
-                        if (g_ascii_strncasecmp(fname, cdir, strlen(cdir)) == 0) { /* Yes */
-                            gchar *fname_i = fname + strlen(mountpoint);
-                            if (*fname_i == G_DIR_SEPARATOR)
-                                ++fname_i;
-                            track->transferred = TRUE;
-                            track->ipod_path = g_strdup_printf("%c%s", G_DIR_SEPARATOR, fname_i);
-                            itdb_filename_fs2ipod(track->ipod_path);
-                        }
-                        g_free(music_dir);
-                        g_free(cdir);
-                    }
-                }
-            }
-
-            if (gethostname(str, PATH_MAX - 2) == 0) {
-                str[PATH_MAX - 1] = 0;
-                etr->hostname = g_strdup(str);
-            }
-            /* add_track may return pointer to a different track if an
-             identical one (SHA1 checksum) was found */
-            added_track = gp_track_add(itdb, track);
-            g_return_val_if_fail (added_track, FALSE);
-
-            /* set flags to 'podcast' if adding to podcast list */
-            if (itdb_playlist_is_podcasts(plitem))
-                gp_track_set_flags_podcast(added_track);
-
-            if (itdb_playlist_is_mpl(plitem)) { /* add track to master playlist if it wasn't a
-             duplicate */
-                if (added_track == track) {
-                    if (addtrackfunc)
-                        addtrackfunc(plitem, added_track, data);
-                    else
-                        gp_playlist_add_track(plitem, added_track, TRUE);
-                }
-            }
-            else {
-#if 0 /* initially iTunes didn't add podcasts to the MPL */
-                /* add track to master playlist if it wasn't a
-                 * duplicate and plitem is not the podcasts playlist
-                 */
-                if (added_track == track)
-                {
-                    if (!itdb_playlist_is_podcasts (plitem))
-                    gp_playlist_add_track (mpl, added_track, TRUE);
-                }
-#else
-                if (added_track == track) {
-                    gp_playlist_add_track(mpl, added_track, TRUE);
-                }
-#endif
-                /* add track to specified playlist -- unless adding
-                 * to podcasts list and track already exists there */
-                if (itdb_playlist_is_podcasts(plitem) && g_list_find(plitem->members, added_track)) {
-                    gchar *buf = get_track_info(added_track, FALSE);
-                    gtkpod_log_error_printf(error, _("Podcast already present: '%s'\n\n"), buf);
-                    g_free(buf);
-                }
-                else {
-                    if (addtrackfunc)
-                        addtrackfunc(plitem, added_track, data);
-                    else
-                        gp_playlist_add_track(plitem, added_track, TRUE);
-                }
-            }
-
-            /* indicate that non-transferred files exist */
-            data_changed(itdb);
+            result = add_new_track_by_filename(itdb, fname, track, plitem, addtrackfunc, data, error);
         }
         else { /* !track */
             result = FALSE;
@@ -1951,6 +2199,7 @@ void parse_offline_playcount(void) {
         size_t len = 0; /* how many bytes are written */
         gchar *buf;
         GString *gstr, *gstr_filenames;
+        GList *updates, *unmatched, *gl;
         if (!file) {
             gtkpod_warning(_("Could not open '%s' for reading and writing.\n"), offlplyc);
             g_free(offlplyc);
@@ -1965,6 +2214,7 @@ void parse_offline_playcount(void) {
         buf = g_malloc(2 * PATH_MAX);
         gstr = g_string_sized_new(PATH_MAX);
         gstr_filenames = g_string_sized_new(PATH_MAX);
+        updates = NULL;
         while (fgets(buf, 2 * PATH_MAX, file)) {
             gchar *buf_utf8 = charset_to_utf8(buf);
             gchar *sha1 = NULL;
@@ -2000,17 +2250,25 @@ void parse_offline_playcount(void) {
                 gtkpod_warning(_("Malformed line in '%s': %s\n"), offlplyc, buf_utf8);
                 goto cont;
             }
-            if (gp_increase_playcount(sha1, filename, 1) == FALSE) { /* didn't find the track -> store */
-                gchar *filename_utf8 = charset_to_utf8(filename);
-                g_string_append(gstr_filenames, filename_utf8);
-                g_string_append(gstr_filenames, "\n");
-                g_free(filename_utf8);
-                g_string_append(gstr, buf);
-            }
+            updates = g_list_prepend(updates, gp_playcount_update_new(sha1, filename, 1));
             cont: g_free(buf_utf8);
             g_free(sha1);
             g_free(filename);
         }
+        updates = g_list_reverse(updates);
+
+        /* apply all playcounts at once */
+        unmatched = gp_increase_playcounts(updates);
+        for (gl = unmatched; gl; gl = gl->next) { /* didn't find the track -> store */
+            PlaycountUpdate *update = gl->data;
+            gchar *filename_utf8 = charset_to_utf8(update->file);
+            g_string_append(gstr_filenames, filename_utf8);
+            g_string_append(gstr_filenames, "\n");
+            g_free(filename_utf8);
+            g_string_append_printf(gstr, "%s%s %s\n", SOCKET_PLYC, update->sha1 ? update->sha1 : "", update->file);
+        }
+        g_list_free(unmatched);
+        g_list_free_full(updates, (GDestroyNotify) gp_playcount_update_free);
 
         /* rewind file pointer to beginning */
         rewind(file);
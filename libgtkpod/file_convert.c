@@ -34,6 +34,8 @@
 
 #include "gp_itdb.h"
 #include "file_convert.h"
+#include "file_copy.h"
+#include "file_transcode.h"
 #include "misc.h"
 #include "misc_track.h"
 #include "prefs.h"
@@ -121,12 +123,15 @@ const gchar *FILE_CONVERT_DISPLAY_LOG = "file_convert_display_log";
 const gchar *FILE_CONVERT_LOG_SIZE_X = "file_convert_log_size.x";
 const gchar *FILE_CONVERT_LOG_SIZE_Y = "file_convert_log_size.y";
 const gchar *FILE_CONVERT_BACKGROUND_TRANSFER = "file_convert_background_transfer";
+const gchar *FILE_CONVERT_MAX_TRANSFER_THREADS_NUM = "file_convert_max_transfer_threads_num";
+const gchar *FILE_CONVERT_DIRECT = "file_convert_direct";
 
 typedef struct _Conversion Conversion;
 typedef struct _ConvTrack ConvTrack;
 typedef struct _TransferItdb TransferItdb;
 
-static gboolean conversion_scheduler(gpointer data);
+static void conversion_wakeup(Conversion *conv);
+static gboolean conversion_log_watch(GIOChannel *source, GIOCondition condition, gpointer data);
 static void conversion_update_default_sizes(Conversion *conv);
 static gboolean conversion_log_window_delete(Conversion *conv);
 static gpointer conversion_thread(gpointer data);
@@ -137,6 +142,7 @@ static gchar *conversion_get_fname_extension(Conversion *conv, ConvTrack *ctr);
 static gboolean conversion_setup_cachedir(Conversion *conv);
 static void conversion_log_add_pages(Conversion *conv, gint threads);
 static gboolean conversion_add_track(Conversion *conv, Track *track);
+static gboolean conversion_can_stream(ConvTrack *ctr);
 static void conversion_prefs_changed(Conversion *conv);
 static void conversion_itdb_first(Conversion *conv, iTunesDB *itdb);
 static void conversion_cancel_itdb(Conversion *conv, iTunesDB *itdb);
@@ -146,9 +152,11 @@ static void conversion_continue(Conversion *conv);
 static TransferItdb *transfer_get_tri(Conversion *conv, iTunesDB *itdb);
 static void transfer_free_transfer_itdb(TransferItdb *tri);
 static gpointer transfer_thread(gpointer data);
+static gboolean transfer_has_streams(GList *list);
 static GList *transfer_get_failed_tracks(Conversion *conv, iTunesDB *itdb);
+static void transfer_update_counts(Conversion *conv);
 static FileTransferStatus
-        transfer_get_status(Conversion *conv, iTunesDB *itdb, gint *to_convert_num, gint *converting_num, gint *to_transfer_num, gint *transferred_num, gint *failed_num);
+        transfer_get_status(Conversion *conv, iTunesDB *itdb, gint *to_convert_num, gint *converting_num, gint *to_transfer_num, gint *transferred_num, gint *failed_num, gint *queue_depth, gdouble *bytes_per_sec);
 static void transfer_ack_itdb(Conversion *conv, iTunesDB *itdb);
 static void transfer_continue(Conversion *conv, iTunesDB *itdb);
 static void transfer_activate(Conversion *conv, iTunesDB *itdb, gboolean active);
@@ -179,6 +187,8 @@ struct _Conversion {
     gchar *cachedir; /* directory for converted files            */
     gchar *template; /* name template to use for converted files */
     gint max_threads_num; /* maximum number of allowed threads        */
+    gint max_transfer_threads_num; /* maximum number of copies per iPod    */
+    GHashTable *track_refs; /* number of ConvTracks for each Track   */
     GList *threads; /* list of threads                          */
     gint threads_num; /* number of threads currently running      */
     gboolean conversion_force; /* force a new thread to start even if the dirsize is too large           */
@@ -187,7 +197,8 @@ struct _Conversion {
     gboolean dirsize_in_progress; /* currently determining dirsize      */
     gboolean prune_in_progress; /* currently pruning directory        */
     gboolean force_prune_in_progress; /* do another prune right after the current process finishes   */
-    guint timeout_id;
+    guint wakeup_id; /* idle source to run the scheduler     */
+    gboolean counts_dirty; /* TransferItdb counts need updating */
 
     /* data for log display */
     GtkWidget *log_window; /* display log window                       */
@@ -224,7 +235,7 @@ struct _ConvTrack {
     gint threadnum; /* number of thread working on this track   */
     Conversion *conv; /* pointer back to the conversion struct    */
     GIOChannel *gio_channel;
-    guint source_id;
+    guint source_id; /* watch appending gio_channel to the log */
     gchar *artist;
     gchar *album;
     gchar *track_nr;
@@ -236,20 +247,36 @@ struct _ConvTrack {
     /* needed for transfering */
     gchar *dest_filename;
     gchar *mountpoint;
+    gint64 transfer_size; /* size of the file to transfer           */
+    gboolean stream; /* transcode while transferring, bypassing the cache */
 };
 
+/* Number of tracks in each stage for one iPod */
+typedef struct {
+    gint to_convert;
+    gint converting;
+    gint to_transfer;
+    gint transferred;
+    gint failed;
+    gint queue_depth;
+} TransferCounts;
+
 struct _TransferItdb {
     gboolean valid; /* TRUE if still valid                  */
     iTunesDB *itdb; /* for reference                        */
     Conversion *conv; /* pointer back to conv                 */
     gboolean transfer; /* OK to transfer in the background?    */
     FileTransferStatus status; /* current status                       */
-    GThread *thread; /* thread working on transfer           */
+    gint threads_num; /* number of threads transferring       */
     GList *scheduled; /* ConvTracks scheduled for transfer    */
     GList *processing; /* ConvTracks currently transferring    */
     GList *transferred; /* ConvTracks copied to the iPod        */
     GList *finished; /* ConvTracks copied to the iPod        */
     GList *failed; /* ConvTracks failed to transfer/convert*/
+    guint64 transferred_bytes; /* bytes copied to the iPod so far      */
+    gint64 transfer_usecs; /* time spent transferring so far       */
+    gint64 transfer_start; /* start of the current transfer        */
+    TransferCounts counts; /* valid unless conv->counts_dirty      */
 };
 
 enum {
@@ -267,10 +294,6 @@ static void _create_mutex(Conversion *c) {
     g_mutex_init(&c->mutex);
 }
 
-static gboolean _try_lock(Conversion *c) {
-    return g_mutex_trylock(&c->mutex);
-}
-
 static void _lock_mutex(Conversion *c) {
     g_mutex_lock (&c->mutex);
 }
@@ -315,6 +338,7 @@ void file_convert_init() {
 
     conversion = g_new0 (Conversion, 1);
     _create_mutex(conversion);
+    conversion->track_refs = g_hash_table_new(g_direct_hash, g_direct_equal);
 
     _create_cond(conversion);
     conversion_setup_cachedir(conversion);
@@ -331,6 +355,14 @@ void file_convert_init() {
         prefs_set_int(FILE_CONVERT_BACKGROUND_TRANSFER, TRUE);
     }
 
+    if (!prefs_get_string_value(FILE_CONVERT_MAX_TRANSFER_THREADS_NUM, NULL)) {
+        prefs_set_int(FILE_CONVERT_MAX_TRANSFER_THREADS_NUM, 2);
+    }
+
+    if (!prefs_get_string_value(FILE_CONVERT_DIRECT, NULL)) {
+        prefs_set_int(FILE_CONVERT_DIRECT, FALSE);
+    }
+
     conversion->dirsize = CONV_DIRSIZE_INVALID;
 
     /* setup log window */
@@ -372,10 +404,10 @@ void file_convert_init() {
     /* initialize values from the preferences */
     file_convert_prefs_changed();
 
-    /* start timeout function for the scheduler */
-    conversion->timeout_id = gdk_threads_add_timeout(   100, /* every 100 ms */
-                                                                                            conversion_scheduler,
-                                                                                            conversion);
+    /* there is no timeout for the scheduler -- everything changing
+     the lists, the size of the cache directory or the preferences
+     wakes it up, and the output of the conversion scripts is picked
+     up by conversion_log_watch() */
     g_object_unref(G_OBJECT (log_builder));
 }
 
@@ -451,9 +483,15 @@ void file_convert_continue() {
 
  ---------------------------------------------------------------- */
 
-/* return current status of transfer process */
-FileTransferStatus file_transfer_get_status(iTunesDB *itdb, gint *to_convert_num, gint *converting_num, gint *to_transfer_num, gint *transferred_num, gint *failed_num) {
-    return transfer_get_status(conversion, itdb, to_convert_num, converting_num, to_transfer_num, transferred_num, failed_num);
+/* return current status of transfer process
+
+ @queue_depth: number of tracks waiting for a free copy slot
+ @bytes_per_sec: rate at which tracks have been copied to the iPod
+ while the transfer was active, 0 if nothing has been copied yet
+
+ Any of the arguments may be NULL. */
+FileTransferStatus file_transfer_get_status(iTunesDB *itdb, gint *to_convert_num, gint *converting_num, gint *to_transfer_num, gint *transferred_num, gint *failed_num, gint *queue_depth, gdouble *bytes_per_sec) {
+    return transfer_get_status(conversion, itdb, to_convert_num, converting_num, to_transfer_num, transferred_num, failed_num, queue_depth, bytes_per_sec);
 }
 
 /* This has to be called after all tracks have been transferred and the
@@ -665,6 +703,11 @@ static void conversion_prefs_changed(Conversion *conv) {
         }
     }
 
+    conv->max_transfer_threads_num = prefs_get_int(FILE_CONVERT_MAX_TRANSFER_THREADS_NUM);
+    if (conv->max_transfer_threads_num <= 0) {
+        conv->max_transfer_threads_num = 1;
+    }
+
     g_free(conv->template);
     conv->template = prefs_get_string(FILE_CONVERT_TEMPLATE);
 
@@ -686,6 +729,9 @@ static void conversion_prefs_changed(Conversion *conv) {
 
     conversion_display_hide_log_window(conv);
 
+    /* more threads may be allowed now */
+    conversion_wakeup(conv);
+
     file_convert_unlock(conv);
 }
 
@@ -833,8 +879,8 @@ static void conversion_log_append(Conversion *conv, const gchar *text, gint thre
 }
 
 /*
- * Called by scheduler for all running processes. Lock 'conv->mutex'
- * before calling this function.
+ * Called by conversion_log_watch() whenever a running process has
+ * written something. Lock 'conv->mutex' before calling this function.
  */
 static void conversion_display_log(ConvTrack *ctr) {
     gchar buf[PATH_MAX];
@@ -869,6 +915,47 @@ static void conversion_display_log(ConvTrack *ctr) {
     return;
 }
 
+/* io watch installed by the conversion threads: append the output of
+ the conversion script to the log as it arrives */
+static gboolean conversion_log_watch(GIOChannel *source, GIOCondition condition, gpointer data) {
+    ConvTrack *ctr = data;
+    gboolean keep = FALSE;
+
+    gdk_threads_enter();
+    file_convert_lock(conversion);
+
+    /* @ctr is freed together with the watch, possibly while we were
+     waiting for the lock */
+    if (!g_source_is_destroyed(g_main_current_source())) {
+        conversion_display_log(ctr);
+        if (condition & (G_IO_HUP | G_IO_ERR | G_IO_NVAL))
+            ctr->source_id = 0;
+        else
+            keep = TRUE;
+    }
+
+    file_convert_unlock(conversion);
+    gdk_threads_leave();
+
+    return keep;
+}
+
+/* Count the ConvTracks referring to @track, so that tracks that are
+ not being converted or transferred can be skipped quickly when they
+ are cancelled. conv->mutex must be locked. */
+static void conversion_ref_track(Conversion *conv, Track *track) {
+    gint refs = GPOINTER_TO_INT (g_hash_table_lookup(conv->track_refs, track));
+    g_hash_table_insert(conv->track_refs, track, GINT_TO_POINTER (refs + 1));
+}
+
+static void conversion_unref_track(Conversion *conv, Track *track) {
+    gint refs = GPOINTER_TO_INT (g_hash_table_lookup(conv->track_refs, track));
+    if (refs > 1)
+        g_hash_table_insert(conv->track_refs, track, GINT_TO_POINTER (refs - 1));
+    else
+        g_hash_table_remove(conv->track_refs, track);
+}
+
 static void conversion_cancel_mark_track(ConvTrack *ctr) {
     g_return_if_fail (ctr && ctr->track);
 
@@ -946,6 +1033,8 @@ static void conversion_cancel_itdb(Conversion *conv, iTunesDB *itdb) {
     conversion_cancel_itdb_sub(&itr->failed, TRUE);
     itr->valid = FALSE;
 
+    conversion_wakeup(conv);
+
     file_convert_unlock(conv);
 }
 
@@ -993,6 +1082,11 @@ static void conversion_cancel_track(Conversion *conv, Track *track) {
 
     file_convert_lock(conv);
 
+    if (!g_hash_table_lookup(conv->track_refs, track)) { /* nothing scheduled for @track */
+        file_convert_unlock(conv);
+        return;
+    }
+
     conversion_cancel_track_sub(&conv->scheduled, track, FALSE);
     conversion_cancel_track_sub(&conv->processing, track, FALSE);
     conversion_cancel_track_sub(&conv->failed, track, FALSE);
@@ -1006,6 +1100,7 @@ static void conversion_cancel_track(Conversion *conv, Track *track) {
         conversion_cancel_track_sub(&itr->finished, track, TRUE);
         conversion_cancel_track_sub(&itr->failed, track, TRUE);
     }
+    conversion_wakeup(conv);
     file_convert_unlock(conv);
 }
 
@@ -1018,6 +1113,7 @@ static void conversion_continue(Conversion *conv) {
     if (conv->threads_num == 0) { /* make sure at least one conversion is started even if
      directory is full */
         conv->conversion_force = TRUE;
+        conversion_wakeup(conv);
     }
     file_convert_unlock(conv);
 }
@@ -1059,6 +1155,9 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
     ctr->track = track;
     ctr->itdb = track->itdb;
     ctr->conv = conv;
+    file_convert_lock(conv);
+    conversion_ref_track(conv, track);
+    file_convert_unlock(conv);
     ctr->orig_file = g_strdup(etr->pc_path_locale);
     ctr->converted_file = g_strdup(etr->converted_file);
     ctr->artist = g_strdup(track->artist);
@@ -1079,6 +1178,7 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
         /* add to failed list */
         file_convert_lock(conv);
         conv->failed = g_list_prepend(conv->failed, ctr);
+        conversion_wakeup(conv);
         file_convert_unlock(conv);
         debug ("added track to failed %p\n", track);
         return FALSE;
@@ -1095,6 +1195,7 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
         /* add to failed list */
         file_convert_lock(conv);
         conv->failed = g_list_prepend(conv->failed, ctr);
+        conversion_wakeup(conv);
         file_convert_unlock(conv);
         debug ("added track to failed %p\n", track);
         return FALSE;
@@ -1107,6 +1208,7 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
         /* add to finished */
         file_convert_lock(conv);
         conv->finished = g_list_prepend(conv->finished, ctr);
+        conversion_wakeup(conv);
         file_convert_unlock(conv);
         debug ("added track to finished %p\n", track);
         return TRUE;
@@ -1128,11 +1230,28 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
 
         ctr->fname_root = get_string_from_template(track, template, TRUE, TRUE);
         ctr->fname_extension = conversion_get_fname_extension(NULL, ctr);
-        if (ctr->fname_extension) {
+        if (ctr->fname_extension && conversion_can_stream(ctr)) {
+            /* transcode straight to the iPod when the track is
+             transferred, see transfer_transfer_track() */
+            ctr->stream = TRUE;
+            g_free(ctr->converted_file);
+            ctr->converted_file = NULL;
+            etr->conversion_status = FILE_CONVERT_SCHEDULED;
+            /* add to finished */
+            file_convert_lock(conv);
+            conv->finished = g_list_prepend(conv->finished, ctr);
+            conversion_wakeup(conv);
+            file_convert_unlock(conv);
+
+            result = TRUE;
+            debug ("added track to finished for streaming %p\n", track);
+        }
+        else if (ctr->fname_extension) {
             etr->conversion_status = FILE_CONVERT_SCHEDULED;
             /* add to scheduled list */
             file_convert_lock(conv);
             conv->scheduled = g_list_prepend(conv->scheduled, ctr);
+            conversion_wakeup(conv);
             file_convert_unlock(conv);
 
             result = TRUE;
@@ -1153,6 +1272,7 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
             /* add to failed list */
             file_convert_lock(conv);
             conv->failed = g_list_prepend(conv->failed, ctr);
+            conversion_wakeup(conv);
             file_convert_unlock(conv);
             result = FALSE;
             debug ("added track to failed %p\n", track);
@@ -1169,6 +1289,7 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
         /* add to failed list */
         file_convert_lock(conv);
         conv->failed = g_list_prepend(conv->failed, ctr);
+        conversion_wakeup(conv);
         file_convert_unlock(conv);
         result = FALSE;
         debug ("added track to failed %p\n", track);
@@ -1183,6 +1304,7 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
         /* add to finished */
         file_convert_lock(conv);
         conv->finished = g_list_prepend(conv->finished, ctr);
+        conversion_wakeup(conv);
         file_convert_unlock(conv);
         debug ("added track to finished %p\n", track);
     }
@@ -1190,6 +1312,17 @@ static gboolean conversion_add_track(Conversion *conv, Track *track) {
     return result;
 }
 
+/* TRUE if @ctr can be transcoded in-process while it is transferred
+ instead of being converted into the cache by the conversion script
+ first. A file already converted by the script is used instead. */
+static gboolean conversion_can_stream(ConvTrack *ctr) {
+    if (!prefs_get_int(FILE_CONVERT_DIRECT))
+        return FALSE;
+    if (ctr->converted_file && g_file_test(ctr->converted_file, G_FILE_TEST_EXISTS))
+        return FALSE;
+    return file_transcode_supported(ctr->fname_extension);
+}
+
 /* free the memory taken by @ctr */
 static void conversion_convtrack_free(ConvTrack *ctr) {
     g_return_if_fail (ctr);
@@ -1206,6 +1339,9 @@ static void conversion_convtrack_free(ConvTrack *ctr) {
     g_free(ctr->genre);
     g_free(ctr->year);
     g_free(ctr->comment);
+    if (ctr->source_id) {
+        g_source_remove(ctr->source_id);
+    }
     if (ctr->gio_channel) {
         g_io_channel_unref(ctr->gio_channel);
     }
@@ -1217,6 +1353,10 @@ static void conversion_convtrack_free(ConvTrack *ctr) {
     g_free(ctr->dest_filename);
     g_free(ctr->mountpoint);
 
+    if (ctr->conv && ctr->track) {
+        conversion_unref_track(ctr->conv, ctr->track);
+    }
+
     g_free(ctr);
 }
 
@@ -1295,6 +1435,10 @@ static void conversion_free_resources(ConvTrack *ctr) {
         g_spawn_close_pid(ctr->pid);
         ctr->pid = 0;
     }
+    if (ctr->source_id) {
+        g_source_remove(ctr->source_id);
+        ctr->source_id = 0;
+    }
     if (ctr->gio_channel) {
         conversion_display_log(ctr);
         g_io_channel_unref(ctr->gio_channel);
@@ -1304,10 +1448,7 @@ static void conversion_free_resources(ConvTrack *ctr) {
 
 /*
  * The scheduler code without the locking mechanism -- has to be
- * called with conv->mutex locked.
- *
- * Should always return TRUE to avoid killing the timeout function.
- * If the timeout function dies then saving itdb will produce a deadlock.
+ * called with conv->mutex locked. Runs from conversion_wakeup().
  */
 static gboolean conversion_scheduler_unlocked(Conversion *conv) {
     GList *gli, *nextgli;
@@ -1325,9 +1466,13 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
     }
 
     if (conv->scheduled) {
+        /* start as many threads as there are tracks waiting, so that
+         all idle slots are filled at once */
+        gint scheduled_num = g_list_length(conv->scheduled);
+
         debug("Conversion scheduled. Setting up thread\n");
-        if ((conv->threads_num < conv->max_threads_num) && ((conv->dirsize <= conv->max_dirsize)
-                || conv->conversion_force)) {
+        while ((conv->threads_num < conv->max_threads_num) && (conv->threads_num < scheduled_num)
+                && ((conv->dirsize <= conv->max_dirsize) || conv->conversion_force)) {
             GList *gl;
             GThread *thread;
 
@@ -1349,18 +1494,6 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
         conv->conversion_force = FALSE;
     }
 
-    if (conv->processing) {
-        debug("Conversion is processing\n");
-        GList *gl;
-        for (gl = conv->processing; gl; gl = gl->next) {
-            ConvTrack *ctr = gl->data;
-            g_return_val_if_fail (ctr, TRUE);
-            if (ctr->valid && ctr->gio_channel) {
-                conversion_display_log(ctr);
-            }
-        }
-    }
-
     if (conv->failed) {
         debug("Conversion has failed\n");
         GList *gl;
@@ -1484,6 +1617,10 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
                 switch (etr->conversion_status) {
                 case FILE_CONVERT_INACTIVE:
                 case FILE_CONVERT_CONVERTED:
+                    if (ctr->converted_file)
+                        ctr->transfer_size = ctr->converted_size;
+                    else
+                        ctr->transfer_size = tr->size;
                     tri->scheduled = g_list_prepend(tri->scheduled, ctr);
                     break;
                 case FILE_CONVERT_FAILED:
@@ -1491,8 +1628,14 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
                 case FILE_CONVERT_REQUIRED:
                     tri->failed = g_list_prepend(tri->failed, ctr);
                     break;
-                case FILE_CONVERT_KILLED:
                 case FILE_CONVERT_SCHEDULED:
+                    if (ctr->stream) { /* transcoded while transferring */
+                        ctr->transfer_size = tr->size;
+                        tri->scheduled = g_list_prepend(tri->scheduled, ctr);
+                        break;
+                    }
+                    /* fall through */
+                case FILE_CONVERT_KILLED:
                     fprintf(stderr, "Programming error: conversion type %d not expected in conversion_scheduler()\n", etr->conversion_status);
                     conversion_convtrack_free(ctr);
                     break;
@@ -1511,9 +1654,22 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
         nextgli = gli->next;
 
         g_return_val_if_fail (tri, TRUE);
-        if (tri->scheduled) {
-            if ((tri->thread == NULL) && (tri->transfer == TRUE) && (tri->status != FILE_TRANSFER_DISK_FULL)) { /* start new thread */
-                tri->thread = _create_thread(transfer_thread, tri);
+        if (tri->scheduled && (tri->transfer == TRUE) && (tri->status != FILE_TRANSFER_DISK_FULL)) {
+            gint scheduled_num = g_list_length(tri->scheduled);
+            gint max_threads_num = conv->max_transfer_threads_num;
+            /* transcoding is limited by the CPU rather than by the
+             iPod -- run one transcoder per processor */
+            if (transfer_has_streams(tri->scheduled)) {
+                max_threads_num = MAX (max_threads_num, conv->max_threads_num);
+            }
+            /* start new threads -- no more than there are tracks to
+             transfer */
+            while ((tri->threads_num < max_threads_num) && (tri->threads_num < scheduled_num)) {
+                if (tri->threads_num == 0) {
+                    tri->transfer_start = g_get_monotonic_time();
+                }
+                ++tri->threads_num;
+                _create_thread(transfer_thread, tri);
             }
         }
 
@@ -1526,7 +1682,20 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
 
                 if (tri->valid && ctr->valid) {
                     if (itdb_cp_finalize(ctr->track, NULL, ctr->dest_filename, &error)) { /* everything's fine */
+                        if (ctr->stream) { /* the track was transcoded on its
+                         way to the iPod */
+                            ExtraTrackData *etr = ctr->track->userdata;
+                            etr->conversion_status = FILE_CONVERT_CONVERTED;
+                            ctr->track->size = ctr->converted_size;
+                            ctr->track->pregap = ctr->gapless.pregap;
+                            ctr->track->samplecount = ctr->gapless.samplecount;
+                            ctr->track->postgap = ctr->gapless.postgap;
+                            ctr->track->gapless_data = ctr->gapless.gapless_data;
+                            ctr->track->gapless_track_flag = ctr->gapless.gapless_track_flag;
+                        }
                         tri->finished = g_list_prepend(tri->finished, ctr);
+                        /* itdb_cp_finalize() set the ipod_path */
+                        gp_itdb_ipod_path_hash_update_track(ctr->track);
                         /* otherwise new free space status from iPod
                          is never read and free space keeps
                          increasing while we copy more and more
@@ -1570,6 +1739,10 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
                         g_free(ctr->errormessage);
                         ctr->errormessage = NULL;
                     }
+                    if (ctr->stream) { /* the transcoding failed */
+                        ExtraTrackData *etr = ctr->track->userdata;
+                        etr->conversion_status = FILE_CONVERT_FAILED;
+                    }
                     g_free(ctr->dest_filename);
                     ctr->dest_filename = NULL;
                     tri->finished = g_list_prepend(tri->finished, ctr);
@@ -1586,13 +1759,15 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
          * have been removed */
         if (!tri->valid) {
             if (!!tri->scheduled && !tri->processing && !tri->transferred && !tri->finished && !tri->failed
-                    && !tri->thread) {
+                    && (tri->threads_num == 0)) {
                 transfer_free_transfer_itdb(tri);
                 conv->transfer_itdbs = g_list_delete_link(conv->transfer_itdbs, gli);
             }
         }
     }
 
+    transfer_update_counts(conv);
+
     /* update the log window */
     if (conv->log_window_shown) {
         conversion_log_set_status(conv);
@@ -1601,27 +1776,28 @@ static gboolean conversion_scheduler_unlocked(Conversion *conv) {
     return TRUE;
 }
 
-/* timeout function, add new threads if unscheduled tracks are in the
- queue and maximum number of threads hasn't been reached */
-static gboolean conversion_scheduler(gpointer data) {
+/* idle function installed by conversion_wakeup() */
+static gboolean conversion_scheduler_wakeup(gpointer data) {
     Conversion *conv = data;
-    gboolean result;
     g_return_val_if_fail (data, FALSE);
 
-//    debug ("conversion_scheduler enter\n");
-
-    if (!_try_lock(conv)) {
-        /* Do not destroy the timeout function by returning FALSE */
-        return TRUE;
-    }
-
-    result = conversion_scheduler_unlocked(conv);
-
+    file_convert_lock(conv);
+    conv->wakeup_id = 0;
+    conversion_scheduler_unlocked(conv);
     file_convert_unlock(conv);
 
-    debug ("conversion_scheduler exit\n");
+    return FALSE;
+}
 
-    return result;
+/* Run the scheduler from the main loop as soon as possible. Called
+ whenever the lists, the size of the cache directory or the
+ preferences have changed, e.g. by the threads whenever a track is
+ ready to move on to the next stage. conv->mutex must be locked. */
+static void conversion_wakeup(Conversion *conv) {
+    conv->counts_dirty = TRUE;
+    if (conv->wakeup_id == 0) {
+        conv->wakeup_id = gdk_threads_add_idle(conversion_scheduler_wakeup, conv);
+    }
 }
 
 /* Calculate the size of the directory */
@@ -1665,6 +1841,8 @@ static gpointer conversion_update_dirsize(gpointer data) {
      broadcast to all threads waiting to wake them up. */
     conv->dirsize_in_progress = FALSE;
     _broadcast_dirsize_cond(conv);
+    /* the scheduler waits for a valid dirsize */
+    conversion_wakeup(conv);
     file_convert_unlock(conv);
 
     debug ("%p update_dirsize exit\n", g_thread_self ());
@@ -1851,6 +2029,8 @@ static gpointer conversion_prune_dir(gpointer data) {
     file_convert_lock(conv);
     conv->prune_in_progress = FALSE;
     _broadcast_prune_cond(conv);
+    /* threads may be started again if the cache shrunk */
+    conversion_wakeup(conv);
     file_convert_unlock(conv);
 
     debug ("%p prune_dir exit\n", g_thread_self ());
@@ -2137,6 +2317,7 @@ static gboolean conversion_convert_track(Conversion *conv, ConvTrack *ctr) {
                 ctr->gio_channel = g_io_channel_unix_new(ctr->child_stderr);
                 g_io_channel_set_flags(ctr->gio_channel, G_IO_FLAG_NONBLOCK, NULL);
                 g_io_channel_set_close_on_unref(ctr->gio_channel, TRUE);
+                ctr->source_id = g_io_add_watch(ctr->gio_channel, G_IO_IN | G_IO_HUP | G_IO_ERR, conversion_log_watch, ctr);
 
                 file_convert_unlock(conv);
 
@@ -2203,10 +2384,12 @@ static gboolean conversion_convert_track(Conversion *conv, ConvTrack *ctr) {
 
         filetype = determine_filetype(ctr->converted_file);
         if (filetype) {
-            file_convert_lock(conv);
+            /* read the file without holding the lock -- ctr->converted_file
+             is only changed by this thread */
             track = gp_track_new();
             retval = filetype_read_gapless(filetype, ctr->converted_file, track, NULL);
 
+            file_convert_lock(conv);
             if (ctr->valid && (retval == TRUE)) {
                 ctr->gapless.pregap = track->pregap;
                 ctr->gapless.samplecount = track->samplecount;
@@ -2243,7 +2426,8 @@ static gpointer conversion_thread(gpointer data) {
 
     if (conv->scheduled) {
         do {
-            gboolean conversion_ok;
+            gboolean conversion_ok, prune;
+            gint64 converted_size;
             ConvTrack *ctr;
 
             debug ("%p thread deep\n", g_thread_self ());
@@ -2254,6 +2438,7 @@ static gpointer conversion_thread(gpointer data) {
             ctr = gl->data;
             conv->scheduled = g_list_remove_link(conv->scheduled, gl);
             g_return_val_if_fail (ctr, (file_convert_unlock(conv), NULL));
+            conv->counts_dirty = TRUE;
             if (ctr->valid) { /* attach to processing queue */
                 conv->processing = g_list_concat(gl, conv->processing);
                 /* indicate thread number processing this track */
@@ -2284,6 +2469,8 @@ static gpointer conversion_thread(gpointer data) {
 
             file_convert_lock(conv);
 
+            converted_size = ctr->converted_size;
+
             /* remove from processing queue */
             gl = g_list_find(conv->processing, ctr);
             g_return_val_if_fail (gl, (file_convert_unlock(conv), NULL));
@@ -2307,12 +2494,27 @@ static gpointer conversion_thread(gpointer data) {
                 conversion_convtrack_free(ctr);
             }
 
-            file_convert_unlock(conv);
+            conversion_wakeup(conv);
+
+            /* Account for the new file instead of rescanning the
+             directory after every track: pruning serializes all
+             conversion threads. The size may be overestimated (the
+             file could have been in the cache already), which only
+             causes the next prune to happen a little earlier. */
+            prune = TRUE;
+            if (conversion_ok && (conv->dirsize != CONV_DIRSIZE_INVALID)) {
+                conv->dirsize += converted_size;
+                prune = (conv->dirsize > conv->max_dirsize);
+            }
 
-            /* clean up directory and recalculate dirsize */
-            conversion_prune_dir(conv);
+            if (prune) {
+                file_convert_unlock(conv);
 
-            file_convert_lock(conv);
+                /* clean up directory and recalculate dirsize */
+                conversion_prune_dir(conv);
+
+                file_convert_lock(conv);
+            }
 
         }
         while (((conv->dirsize <= conv->max_dirsize) || conv->conversion_force) && (conv->threads_num
@@ -2349,23 +2551,93 @@ static gpointer conversion_thread(gpointer data) {
  *
  * ------------------------------------------------------------*/
 
-/* Count the number of ConvTracks in @list that belong to @itdb */
-static gint transfer_get_status_count(iTunesDB *itdb, GList *list) {
+/* Add the valid ConvTracks in @list to the counter at @offset of the
+ TransferCounts of their iPod, or of @tri if given. */
+static void transfer_update_counts_list(Conversion *conv, TransferItdb *tri, GList *list, gsize offset) {
     GList *gl;
-    gint count = 0;
     for (gl = list; gl; gl = gl->next) {
         ConvTrack *ctr = gl->data;
-        g_return_val_if_fail (ctr, 0);
-        if (ctr->valid && (ctr->itdb == itdb)) {
-            ++count;
+        TransferItdb *ctri = tri;
+        g_return_if_fail (ctr);
+        if (!ctr->valid)
+            continue;
+        if (!ctri) {
+            GList *link;
+            for (link = conv->transfer_itdbs; link; link = link->next) {
+                TransferItdb *other = link->data;
+                if (other->valid && (other->itdb == ctr->itdb)) {
+                    ctri = other;
+                    break;
+                }
+            }
+            if (!ctri)
+                continue;
         }
+        ++G_STRUCT_MEMBER (gint, &ctri->counts, offset);
     }
-    return count;
+}
+
+/* Recount the tracks in each stage for all iPods in one pass over the
+ lists, so that transfer_get_status() doesn't have to walk them on
+ every call. conv->mutex must be locked. */
+static void transfer_update_counts(Conversion *conv) {
+    GList *gl;
+
+    for (gl = conv->transfer_itdbs; gl; gl = gl->next) {
+        TransferItdb *tri = gl->data;
+        memset(&tri->counts, 0, sizeof(tri->counts));
+    }
+
+    transfer_update_counts_list(conv, NULL, conv->scheduled, G_STRUCT_OFFSET (TransferCounts, to_convert));
+    transfer_update_counts_list(conv, NULL, conv->processing, G_STRUCT_OFFSET (TransferCounts, converting));
+    transfer_update_counts_list(conv, NULL, conv->converted, G_STRUCT_OFFSET (TransferCounts, to_transfer));
+    transfer_update_counts_list(conv, NULL, conv->finished, G_STRUCT_OFFSET (TransferCounts, to_transfer));
+    transfer_update_counts_list(conv, NULL, conv->failed, G_STRUCT_OFFSET (TransferCounts, failed));
+
+    for (gl = conv->transfer_itdbs; gl; gl = gl->next) {
+        TransferItdb *tri = gl->data;
+        GList *glf;
+
+        if (!tri->valid)
+            continue;
+
+        transfer_update_counts_list(conv, tri, tri->scheduled, G_STRUCT_OFFSET (TransferCounts, to_transfer));
+        transfer_update_counts_list(conv, tri, tri->scheduled, G_STRUCT_OFFSET (TransferCounts, queue_depth));
+        transfer_update_counts_list(conv, tri, tri->processing, G_STRUCT_OFFSET (TransferCounts, to_transfer));
+        transfer_update_counts_list(conv, tri, tri->transferred, G_STRUCT_OFFSET (TransferCounts, transferred));
+        transfer_update_counts_list(conv, tri, tri->failed, G_STRUCT_OFFSET (TransferCounts, failed));
+
+        for (glf = tri->finished; glf; glf = glf->next) {
+            ConvTrack *ctr = glf->data;
+            g_return_if_fail (ctr);
+
+            if (ctr->valid) {
+                if (ctr->track->transferred)
+                    ++tri->counts.transferred;
+                else
+                    ++tri->counts.failed;
+            }
+        }
+    }
+
+    conv->counts_dirty = FALSE;
+}
+
+/* TRUE if @list contains a track to be transcoded while transferring */
+static gboolean transfer_has_streams(GList *list) {
+    GList *gl;
+    for (gl = list; gl; gl = gl->next) {
+        ConvTrack *ctr = gl->data;
+        if (ctr && ctr->stream) {
+            return TRUE;
+        }
+    }
+    return FALSE;
 }
 
 /* return the status of the current transfer process or -1 when an
  * assertion fails. */
-static FileTransferStatus transfer_get_status(Conversion *conv, iTunesDB *itdb, gint *to_convert_num, gint *converting_num, gint *to_transfer_num, gint *transferred_num, gint *failed_num) {
+static FileTransferStatus transfer_get_status(Conversion *conv, iTunesDB *itdb, gint *to_convert_num, gint *converting_num, gint *to_transfer_num, gint *transferred_num, gint *failed_num, gint *queue_depth, gdouble *bytes_per_sec) {
     TransferItdb *tri;
     FileTransferStatus status;
 
@@ -2377,45 +2649,42 @@ static FileTransferStatus transfer_get_status(Conversion *conv, iTunesDB *itdb,
     g_return_val_if_fail (tri, (file_convert_unlock(conv), -1));
     status = tri->status;
 
+    /* the counts are kept up to date by the scheduler, only recount if
+     something changed since it last ran */
+    if (conv->counts_dirty) {
+        transfer_update_counts(conv);
+    }
+
     if (to_convert_num) {
-        *to_convert_num = transfer_get_status_count(itdb, conv->scheduled);
+        *to_convert_num = tri->counts.to_convert;
     }
 
     if (converting_num) {
-        *converting_num = transfer_get_status_count(itdb, conv->processing);
+        *converting_num = tri->counts.converting;
     }
 
     if (to_transfer_num) {
-        *to_transfer_num = transfer_get_status_count(itdb, conv->converted)
-                + transfer_get_status_count(itdb, conv->finished) + transfer_get_status_count(itdb, tri->scheduled)
-                + transfer_get_status_count(itdb, tri->processing);
+        *to_transfer_num = tri->counts.to_transfer;
     }
 
-    if (transferred_num || failed_num) {
-        GList *gl;
-        gint transferred = 0;
-        gint failed = 0;
-
-        for (gl = tri->finished; gl; gl = gl->next) {
-            ConvTrack *ctr = gl->data;
-            g_return_val_if_fail (ctr, (file_convert_unlock(conv), -1));
+    if (transferred_num) {
+        *transferred_num = tri->counts.transferred;
+    }
 
-            if (ctr->valid) {
-                if (ctr->track->transferred)
-                    ++transferred;
-                else
-                    ++failed;
-            }
-        }
+    if (failed_num) {
+        *failed_num = tri->counts.failed;
+    }
 
-        if (transferred_num) {
-            *transferred_num = transferred + transfer_get_status_count(itdb, tri->transferred);
-        }
+    if (queue_depth) {
+        *queue_depth = tri->counts.queue_depth;
+    }
 
-        if (failed_num) {
-            *failed_num = failed + transfer_get_status_count(itdb, conv->failed)
-                    + transfer_get_status_count(itdb, tri->failed);
+    if (bytes_per_sec) {
+        gint64 usecs = tri->transfer_usecs;
+        if (tri->threads_num > 0) {
+            usecs += g_get_monotonic_time() - tri->transfer_start;
         }
+        *bytes_per_sec = (usecs > 0) ? ((gdouble) tri->transferred_bytes * G_USEC_PER_SEC / usecs) : 0;
     }
 
     file_convert_unlock(conv);
@@ -2455,6 +2724,7 @@ static void transfer_ack_itdb(Conversion *conv, iTunesDB *itdb) {
     }
     g_list_free(tri->finished);
     tri->finished = NULL;
+    conv->counts_dirty = TRUE;
 
     file_convert_unlock(conv);
 }
@@ -2549,6 +2819,8 @@ static void transfer_reschedule(Conversion *conv, iTunesDB *itdb) {
         }
     }
 
+    conversion_wakeup(conv);
+
     file_convert_unlock(conv);
 
     /* reschedule all failed conversion tracks */
@@ -2586,6 +2858,8 @@ static void transfer_continue(Conversion *conv, iTunesDB *itdb) {
     if (conv->threads_num == 0)
         conv->conversion_force = TRUE;
 
+    conversion_wakeup(conv);
+
     file_convert_unlock(conv);
 }
 
@@ -2608,6 +2882,8 @@ static void transfer_activate(Conversion *conv, iTunesDB *itdb, gboolean active)
 
     /* signal to continue transfer even if disk was full previously */
     tri->transfer = active;
+    if (active)
+        conversion_wakeup(conv);
 
     file_convert_unlock(conv);
 }
@@ -2628,6 +2904,8 @@ static void transfer_reset(Conversion *conv, iTunesDB *itdb) {
 
     /* signal to continue transfer even if disk was full previously */
     tri->transfer = prefs_get_int(FILE_CONVERT_BACKGROUND_TRANSFER);
+    if (tri->transfer)
+        conversion_wakeup(conv);
 
     file_convert_unlock(conv);
 }
@@ -2638,7 +2916,7 @@ static void transfer_free_transfer_itdb(TransferItdb *tri) {
     g_return_if_fail (!tri->scheduled && !tri->processing &&
             !tri->transferred && !tri->finished &&
             !tri->failed);
-    g_return_if_fail (tri->thread);
+    g_return_if_fail (tri->threads_num == 0);
 
     g_free(tri);
 }
@@ -2656,6 +2934,8 @@ static TransferItdb *transfer_add_itdb(Conversion *conv, iTunesDB *itdb) {
     tri->conv = conv;
     tri->itdb = itdb;
     conv->transfer_itdbs = g_list_prepend(conv->transfer_itdbs, tri);
+    /* tracks of @itdb may be converting already */
+    conv->counts_dirty = TRUE;
 
     return tri;
 }
@@ -2715,15 +2995,79 @@ static gpointer transfer_force_prune_dir(gpointer data) {
     return conversion_prune_dir(conv);
 }
 
+/* FileTranscodeCancelled callback: abort once the track was removed */
+static gboolean transfer_stream_cancelled(gpointer data) {
+    ConvTrack *ctr = data;
+    gboolean cancelled;
+
+    file_convert_lock(ctr->conv);
+    cancelled = !ctr->valid;
+    file_convert_unlock(ctr->conv);
+    return cancelled;
+}
+
+/* Transcode @ctr->orig_file to @dest_file on the iPod and fill in
+ the size and gapless info of the result. Does not lock. */
+static gboolean transfer_stream_track(ConvTrack *ctr, const gchar *dest_file, FileCopyBatch *batch, GError **error) {
+    FileTranscodeTags tags;
+    struct stat statbuf;
+    FileType *filetype;
+    gint64 start;
+
+    memset(&tags, 0, sizeof(tags));
+    tags.artist = ctr->artist;
+    tags.album = ctr->album;
+    tags.title = ctr->title;
+    tags.genre = ctr->genre;
+    tags.comment = ctr->comment;
+    if (ctr->track_nr)
+        tags.track_nr = g_ascii_strtoull(ctr->track_nr, NULL, 10);
+    if (ctr->year)
+        tags.year = g_ascii_strtoull(ctr->year, NULL, 10);
+
+    start = g_get_monotonic_time();
+
+    if (!file_transcode(ctr->orig_file, dest_file, ctr->fname_extension, &tags, transfer_stream_cancelled, ctr, error))
+        return FALSE;
+
+    if (g_stat(dest_file, &statbuf) != 0) {
+        gchar *buf = g_filename_display_name(dest_file);
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), _("Could not stat the transcoded file '%s'\n"), buf);
+        g_free(buf);
+        return FALSE;
+    }
+    ctr->converted_size = statbuf.st_size;
+
+    /* sync it together with the files copied by this thread */
+    file_copy_batch_add(batch, dest_file, statbuf.st_size, g_get_monotonic_time() - start);
+
+    /* Fill in additional info (currently only gapless info for MP3s */
+    filetype = determine_filetype(dest_file);
+    if (filetype) {
+        Track *track = gp_track_new();
+        if (filetype_read_gapless(filetype, dest_file, track, NULL)) {
+            ctr->gapless.pregap = track->pregap;
+            ctr->gapless.samplecount = track->samplecount;
+            ctr->gapless.postgap = track->postgap;
+            ctr->gapless.gapless_data = track->gapless_data;
+            ctr->gapless.gapless_track_flag = track->gapless_track_flag;
+        }
+        itdb_track_free(track);
+    }
+
+    return TRUE;
+}
+
 /* return value:
  FILE_TRANSFER_DISK_FULL: file could not be copied because the iPod
  is full. tri->status is set as well.
  FILE_TRANSFER_ERROR: another error occurred
  FILE_TRANSFER_ACTIVE: copy went fine.
  */
-static FileTransferStatus transfer_transfer_track(TransferItdb *tri, ConvTrack *ctr) {
+static FileTransferStatus transfer_transfer_track(TransferItdb *tri, ConvTrack *ctr, FileCopyBatch *batch) {
     FileTransferStatus result = FILE_TRANSFER_ERROR;
     gboolean copy_success;
+    gboolean stream;
     const gchar *source_file = NULL;
     gchar *dest_file = NULL;
     gchar *mountpoint = NULL;
@@ -2745,12 +3089,20 @@ static FileTransferStatus transfer_transfer_track(TransferItdb *tri, ConvTrack *
     }
 
     mountpoint = g_strdup(ctr->mountpoint);
+    stream = ctr->stream;
 
     file_convert_unlock(conv);
 
     g_return_val_if_fail (source_file && mountpoint, FALSE);
 
-    dest_file = itdb_cp_get_dest_filename(NULL, mountpoint, source_file, &error);
+    if (stream) { /* the iPod filename must carry the new extension */
+        gchar *fname = g_strdup_printf("%s.%s", ctr->fname_root, ctr->fname_extension);
+        dest_file = itdb_cp_get_dest_filename(NULL, mountpoint, fname, &error);
+        g_free(fname);
+    }
+    else {
+        dest_file = itdb_cp_get_dest_filename(NULL, mountpoint, source_file, &error);
+    }
 
     /* an error occurred */
     if (!dest_file) {
@@ -2764,7 +3116,10 @@ static FileTransferStatus transfer_transfer_track(TransferItdb *tri, ConvTrack *
         return result;
     }
 
-    copy_success = itdb_cp(source_file, dest_file, &error);
+    if (stream)
+        copy_success = transfer_stream_track(ctr, dest_file, batch, &error);
+    else
+        copy_success = file_copy(source_file, dest_file, batch, &error);
 
     file_convert_lock(conv);
 
@@ -2810,13 +3165,95 @@ static FileTransferStatus transfer_transfer_track(TransferItdb *tri, ConvTrack *
     return result;
 }
 
+/* Return the link of the smallest track in @scheduled. Of tracks of
+ equal size the one scheduled first is returned. */
+static GList *transfer_get_next_scheduled(GList *scheduled) {
+    GList *gl, *next = NULL;
+    gint64 size = G_MAXINT64;
+
+    for (gl = scheduled; gl; gl = gl->next) {
+        ConvTrack *ctr = gl->data;
+        /* tracks are prepended when scheduled */
+        if (ctr && (ctr->transfer_size <= size)) {
+            next = gl;
+            size = ctr->transfer_size;
+        }
+    }
+    return next;
+}
+
+/* Take the tracks of @unsynced whose files @batch has synced (or
+ failed to sync) out of tri->processing and report them as
+ transferred (or failed). Tracks are only reported as transferred
+ once their file is on the iPod. Must be called with the lock
+ held. */
+static void transfer_sync_results(TransferItdb *tri, FileCopyBatch *batch, GList **unsynced) {
+    GList *synced, *failed, *gl;
+    gint pass;
+
+    file_copy_batch_take_results(batch, &synced, &failed);
+
+    for (pass = 0; pass < 2; ++pass) {
+        for (gl = pass ? failed : synced; gl; gl = gl->next) {
+            const gchar *filename = gl->data;
+            ConvTrack *ctr = NULL;
+            GList *ctrgl;
+
+            for (ctrgl = *unsynced; ctrgl; ctrgl = ctrgl->next) {
+                ConvTrack *uctr = ctrgl->data;
+                if (g_strcmp0(uctr->dest_filename, filename) == 0) {
+                    ctr = uctr;
+                    break;
+                }
+            }
+            if (!ctr) /* not copied by this thread */
+                continue;
+            *unsynced = g_list_delete_link(*unsynced, ctrgl);
+
+            ctrgl = g_list_find(tri->processing, ctr);
+            g_return_if_fail (ctrgl);
+            tri->processing = g_list_remove_link(tri->processing, ctrgl);
+
+            if (!ctr->valid) { /* remove the copied file and drop the track */
+                g_list_free(ctrgl);
+                g_unlink(ctr->dest_filename);
+                conversion_convtrack_free(ctr);
+            }
+            else if (pass == 0) {
+                tri->transferred = g_list_concat(ctrgl, tri->transferred);
+            }
+            else {
+                gchar *buf = conversion_get_track_info(ctr);
+                ctr->errormessage
+                        = g_strdup_printf(_("Transfer of '%s' failed. %s\n\n"), buf, _("The file could not be synced to the iPod."));
+                debug("Conversion error: %s\n", ctr->errormessage);
+                g_free(buf);
+                g_unlink(ctr->dest_filename);
+                g_free(ctr->dest_filename);
+                ctr->dest_filename = NULL;
+                tri->failed = g_list_concat(ctrgl, tri->failed);
+            }
+        }
+    }
+
+    g_list_free_full(synced, g_free);
+    g_list_free_full(failed, g_free);
+}
+
+/* Transfer thread. Up to conv->max_transfer_threads_num of these run
+ for each iPod, taking the smallest tracks first, so that tracks are
+ available to be written to the database as soon as possible. */
 static gpointer transfer_thread(gpointer data) {
     TransferItdb *tri = data;
     Conversion *conv;
+    FileCopyBatch *batch;
+    GList *unsynced = NULL; /* copied, but not yet synced */
 
     g_return_val_if_fail (tri && tri->conv, NULL);
     conv = tri->conv;
 
+    batch = file_copy_batch_new();
+
     file_convert_lock(conv);
 
     debug ("%p transfer thread enter\n", tri->itdb);
@@ -2825,17 +3262,19 @@ static gpointer transfer_thread(gpointer data) {
         GList *gl;
         ConvTrack *ctr;
         FileTransferStatus status;
+        guint64 copied;
 
         /* reset transfer force flag */
         tri->status = FILE_TRANSFER_ACTIVE;
 
-        /* remove first scheduled entry and add it to processing */
-        gl = g_list_last(tri->scheduled);
+        /* remove next scheduled entry and add it to processing */
+        gl = transfer_get_next_scheduled(tri->scheduled);
         g_return_val_if_fail (gl, (file_convert_unlock(conv), NULL));
 
         ctr = gl->data;
         tri->scheduled = g_list_remove_link(tri->scheduled, gl);
         g_return_val_if_fail (ctr, (file_convert_unlock(conv), NULL));
+        conv->counts_dirty = TRUE;
         if (tri->valid && ctr->valid) { /* attach to processing queue */
             tri->processing = g_list_concat(gl, tri->processing);
             /* indicate thread number processing this track */
@@ -2853,7 +3292,9 @@ static gpointer transfer_thread(gpointer data) {
 
         debug ("%p thread transfer\n", ctr->itdb);
 
-        status = transfer_transfer_track(tri, ctr);
+        copied = file_copy_batch_get_bytes(batch);
+        status = transfer_transfer_track(tri, ctr, batch);
+        copied = file_copy_batch_get_bytes(batch) - copied;
 
         debug ("%p thread transfer finished (%d:%s)\n",
                 ctr->itdb,
@@ -2862,16 +3303,24 @@ static gpointer transfer_thread(gpointer data) {
 
         file_convert_lock(conv);
 
-        /* remove from processing queue */
-        gl = g_list_find(tri->processing, ctr);
-        g_return_val_if_fail (gl, (file_convert_unlock(conv), NULL));
-        tri->processing = g_list_remove_link(tri->processing, gl);
+        tri->transferred_bytes += copied;
 
-        if (ctr->valid) { /* track is still valid */
-            if (status == FILE_TRANSFER_ACTIVE) { /* add to converted */
-                tri->transferred = g_list_concat(gl, tri->transferred);
-            }
-            else if (status == FILE_TRANSFER_DISK_FULL) { /* reschedule */
+        if (status == FILE_TRANSFER_ACTIVE) { /* leave it in the processing
+         queue until the file is synced */
+            unsynced = g_list_prepend(unsynced, ctr);
+            gl = NULL;
+        }
+        else { /* remove from processing queue */
+            gl = g_list_find(tri->processing, ctr);
+            g_return_val_if_fail (gl, (file_convert_unlock(conv), NULL));
+            tri->processing = g_list_remove_link(tri->processing, gl);
+        }
+
+        if (!gl) {
+            /* handled by transfer_sync_results() */
+        }
+        else if (ctr->valid) { /* track is still valid */
+            if (status == FILE_TRANSFER_DISK_FULL) { /* reschedule */
                 tri->scheduled = g_list_concat(tri->scheduled, gl);
             }
             else /* status == -1 */
@@ -2888,6 +3337,17 @@ static gpointer transfer_thread(gpointer data) {
             conversion_convtrack_free(ctr);
         }
 
+        /* make sure all files copied by this thread are on the iPod
+         before its last track is reported as transferred */
+        if (!tri->scheduled && unsynced) {
+            file_convert_unlock(conv);
+            file_copy_batch_flush(batch, NULL);
+            file_convert_lock(conv);
+        }
+        transfer_sync_results(tri, batch, &unsynced);
+
+        conversion_wakeup(conv);
+
         if (conv->dirsize > conv->max_dirsize) { /* we just transferred a track -- there should be space
          available again -> force a directory prune */
             _create_thread(transfer_force_prune_dir, conv);
@@ -2895,12 +3355,28 @@ static gpointer transfer_thread(gpointer data) {
 
     }
 
-    tri->thread = NULL;
-    if (tri->status != FILE_TRANSFER_DISK_FULL)
-        tri->status = FILE_TRANSFER_IDLE;
+    file_convert_unlock(conv);
+
+    /* tracks of an interrupted transfer are synced here */
+    file_copy_batch_flush(batch, NULL);
+
+    file_convert_lock(conv);
+
+    transfer_sync_results(tri, batch, &unsynced);
+    g_warn_if_fail (unsynced == NULL);
+    conversion_wakeup(conv);
+
+    --tri->threads_num;
+    if (tri->threads_num == 0) {
+        tri->transfer_usecs += g_get_monotonic_time() - tri->transfer_start;
+        if (tri->status != FILE_TRANSFER_DISK_FULL)
+            tri->status = FILE_TRANSFER_IDLE;
+    }
 
     file_convert_unlock(conv);
 
+    file_copy_batch_free(batch);
+
     debug ("%p transfer thread exit\n", tri->itdb);
 
     return NULL;
@@ -45,6 +45,8 @@ extern const gchar *FILE_CONVERT_TEMPLATE;
 extern const gchar *FILE_CONVERT_MAX_THREADS_NUM;
 extern const gchar *FILE_CONVERT_DISPLAY_LOG;
 extern const gchar *FILE_CONVERT_BACKGROUND_TRANSFER;
+extern const gchar *FILE_CONVERT_MAX_TRANSFER_THREADS_NUM;
+extern const gchar *FILE_CONVERT_DIRECT;
 
 void file_convert_init (void);
 void file_convert_shutdown (void);
@@ -62,7 +64,9 @@ FileTransferStatus file_transfer_get_status (iTunesDB *itdb,
 					     gint *converting_num,
 					     gint *to_transfer_num,
 					     gint *transferred_num,
-					     gint *failed_num);
+					     gint *failed_num,
+					     gint *queue_depth,
+					     gdouble *bytes_per_sec);
 void file_transfer_ack_itdb (iTunesDB *itdb);
 void file_transfer_continue (iTunesDB *itdb);
 void file_transfer_activate (iTunesDB *itdb, gboolean active);
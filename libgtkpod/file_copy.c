@@ -0,0 +1,445 @@
+/*
+ |  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+/* This file provides the functions used to copy tracks to the iPod
+ * and to export them. Data is moved inside the kernel with
+ * copy_file_range() or sendfile() where possible, falling back on
+ * read()/write() with a large buffer. Instead of syncing every file
+ * on its own, the files copied are collected in a FileCopyBatch and
+ * synced together with the directories they were written to. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE /* copy_file_range() */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#  include <sys/sendfile.h>
+#endif
+#include <glib/gstdio.h>
+#include <glib/gi18n-lib.h>
+#include "file_copy.h"
+
+/* size of the buffer used when the data can't be copied by the
+ * kernel */
+#define FILE_COPY_BUFFER_SIZE (1024 * 1024)
+/* alignment of that buffer -- page aligned buffers can be handed to
+ * the kernel without bouncing them through another copy */
+#define FILE_COPY_BUFFER_ALIGN 4096
+/* number of bytes passed to copy_file_range() / sendfile() at a
+ * time */
+#define FILE_COPY_CHUNK_SIZE (8 * 1024 * 1024)
+/* a batch is flushed automatically once this many bytes are
+ * pending */
+#define FILE_COPY_BATCH_SIZE (64 * 1024 * 1024)
+
+struct _FileCopyBatch {
+    GMutex mutex; /* protects the statistics */
+    GList *files; /* files copied but not yet synced */
+    GHashTable *dirs; /* directories of @files */
+    GList *synced; /* files synced, see file_copy_batch_take_results() */
+    GList *failed; /* files that could not be synced */
+    guint64 pending_bytes; /* number of bytes in @files */
+    guint64 bytes; /* number of bytes copied so far */
+    gint64 usecs; /* time spent copying and syncing */
+};
+
+static void file_copy_set_error(GError **error, gint errsv, const gchar *format, const gchar *filename) {
+    gchar *filename_utf8 = g_filename_display_name(filename);
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errsv), format, filename_utf8, g_strerror(errsv));
+    g_free(filename_utf8);
+}
+
+/* TRUE if @errsv tells us that the kernel can't copy between the
+ * files in question, so we should use the next method instead */
+static gboolean file_copy_unsupported(gint errsv) {
+    switch (errsv) {
+    case EINVAL:
+    case ENOSYS:
+    case EXDEV:
+#if defined(EOPNOTSUPP)
+    case EOPNOTSUPP:
+#endif
+#if defined(ENOTSUP) && (!defined(EOPNOTSUPP) || (ENOTSUP != EOPNOTSUPP))
+    case ENOTSUP:
+#endif
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* Copy the remaining data from @from to @to. All methods used write
+ * at the current file positions, so one method can take over where
+ * the other one stopped.
+ *
+ * @copied: number of bytes copied so far, updated
+ * @errsv: errno in case of failure
+ *
+ * Returns TRUE on success. */
+static gboolean file_copy_fd(gint from, gint to, guint64 size, guint64 *copied, gint *errsv) {
+    gchar *buf;
+    ssize_t n;
+
+#ifdef HAVE_COPY_FILE_RANGE
+    while (*copied < size) {
+        n = copy_file_range(from, NULL, to, NULL, MIN(size - *copied, FILE_COPY_CHUNK_SIZE), 0);
+        if (n > 0)
+            *copied += n;
+        else if (n == 0)
+            return TRUE; /* file was truncated while copying */
+        else if (errno == EINTR)
+            continue;
+        else if (file_copy_unsupported(errno))
+            break;
+        else {
+            *errsv = errno;
+            return FALSE;
+        }
+    }
+#endif
+
+#ifdef HAVE_SENDFILE
+    while (*copied < size) {
+        n = sendfile(to, from, NULL, MIN(size - *copied, FILE_COPY_CHUNK_SIZE));
+        if (n > 0)
+            *copied += n;
+        else if (n == 0)
+            return TRUE;
+        else if (errno == EINTR)
+            continue;
+        else if (file_copy_unsupported(errno))
+            break;
+        else {
+            *errsv = errno;
+            return FALSE;
+        }
+    }
+#endif
+
+    /* copy whatever is left -- this also catches files whose size
+     * is not known in advance */
+    if (posix_memalign((void **) &buf, FILE_COPY_BUFFER_ALIGN, FILE_COPY_BUFFER_SIZE) != 0) {
+        *errsv = ENOMEM;
+        return FALSE;
+    }
+    for (;;) {
+        ssize_t written = 0;
+
+        n = read(from, buf, FILE_COPY_BUFFER_SIZE);
+        if (n == 0)
+            break;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            *errsv = errno;
+            break;
+        }
+        while (written < n) {
+            ssize_t w = write(to, buf + written, n - written);
+            if (w < 0) {
+                if (errno == EINTR)
+                    continue;
+                *errsv = errno;
+                break;
+            }
+            written += w;
+        }
+        if (written < n)
+            break;
+        *copied += n;
+    }
+    free(buf);
+
+    return (*errsv == 0);
+}
+
+/* fsync() @filename. Filesystems which can't sync are ignored. */
+static gboolean file_copy_sync_path(const gchar *filename, GError **error) {
+    gint fd, errsv = 0;
+
+    fd = g_open(filename, O_RDONLY, 0);
+    if (fd == -1) {
+        errsv = errno;
+    }
+    else {
+        if ((fsync(fd) != 0) && (errno != EINVAL))
+            errsv = errno;
+        close(fd);
+    }
+
+    if (errsv != 0) {
+        file_copy_set_error(error, errsv, _("Could not sync '%s' to disk (%s)\n"), filename);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Create a new batch for file_copy(). Free it with
+ * file_copy_batch_free(), which syncs all files still pending.
+ */
+FileCopyBatch *file_copy_batch_new(void) {
+    FileCopyBatch *batch = g_new0 (FileCopyBatch, 1);
+
+    g_mutex_init(&batch->mutex);
+    batch->dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    return batch;
+}
+
+/**
+ * Sync all files copied into @batch since the last flush, followed
+ * by the directories they were written to. The files are moved to the
+ * lists returned by file_copy_batch_take_results(). A file counts as
+ * failed if it or its directory could not be synced.
+ *
+ * Returns FALSE and sets @error if one of them could not be synced.
+ */
+gboolean file_copy_batch_flush(FileCopyBatch *batch, GError **error) {
+    GHashTableIter iter;
+    gpointer dir;
+    gboolean result = TRUE;
+    gint64 start;
+    GList *gl;
+
+    g_return_val_if_fail (batch, FALSE);
+
+    if (!batch->files)
+        return TRUE;
+
+    start = g_get_monotonic_time();
+
+    for (gl = batch->files; gl; gl = gl->next) {
+        if (!file_copy_sync_path(gl->data, result ? error : NULL)) {
+            result = FALSE;
+            batch->failed = g_list_prepend(batch->failed, gl->data);
+            gl->data = NULL;
+        }
+    }
+
+    g_hash_table_iter_init(&iter, batch->dirs);
+    while (g_hash_table_iter_next(&iter, &dir, NULL)) {
+        if (!file_copy_sync_path(dir, result ? error : NULL)) {
+            result = FALSE;
+            /* mark the directory as failed */
+            g_hash_table_iter_replace(&iter, GINT_TO_POINTER (TRUE));
+        }
+    }
+
+    for (gl = batch->files; gl; gl = gl->next) {
+        if (gl->data) {
+            gchar *dirname = g_path_get_dirname(gl->data);
+            if (g_hash_table_lookup(batch->dirs, dirname))
+                batch->failed = g_list_prepend(batch->failed, gl->data);
+            else
+                batch->synced = g_list_prepend(batch->synced, gl->data);
+            g_free(dirname);
+        }
+    }
+    g_list_free(batch->files);
+    batch->files = NULL;
+    g_hash_table_remove_all(batch->dirs);
+    batch->pending_bytes = 0;
+
+    g_mutex_lock(&batch->mutex);
+    batch->usecs += g_get_monotonic_time() - start;
+    g_mutex_unlock(&batch->mutex);
+
+    return result;
+}
+
+void file_copy_batch_free(FileCopyBatch *batch) {
+    g_return_if_fail (batch);
+
+    file_copy_batch_flush(batch, NULL);
+    g_hash_table_destroy(batch->dirs);
+    g_list_free_full(batch->synced, g_free);
+    g_list_free_full(batch->failed, g_free);
+    g_mutex_clear(&batch->mutex);
+    g_free(batch);
+}
+
+/**
+ * Hand over the names of the files synced by @batch, and of those
+ * that could not be synced, since the last call. This includes the
+ * files synced automatically by file_copy(). Free the lists with
+ * g_list_free_full(list, g_free).
+ */
+void file_copy_batch_take_results(FileCopyBatch *batch, GList **synced, GList **failed) {
+    g_return_if_fail (batch);
+
+    if (synced)
+        *synced = batch->synced;
+    else
+        g_list_free_full(batch->synced, g_free);
+    batch->synced = NULL;
+
+    if (failed)
+        *failed = batch->failed;
+    else
+        g_list_free_full(batch->failed, g_free);
+    batch->failed = NULL;
+}
+
+/**
+ * Add @filename, which was written by other means than file_copy(),
+ * to @batch so that it is synced together with the other files.
+ *
+ * @size: number of bytes written
+ * @usecs: time spent writing them
+ *
+ * If this flushes @batch automatically, the files that could not be
+ * synced (which may or may not include @filename) are reported by
+ * file_copy_batch_take_results() like those of any other flush.
+ */
+void file_copy_batch_add(FileCopyBatch *batch, const gchar *filename, guint64 size, gint64 usecs) {
+    gchar *dir;
+
+    g_return_if_fail (batch && filename);
+
+    dir = g_path_get_dirname(filename);
+    batch->files = g_list_prepend(batch->files, g_strdup(filename));
+    if (g_hash_table_lookup_extended(batch->dirs, dir, NULL, NULL))
+        g_free(dir);
+    else
+        g_hash_table_insert(batch->dirs, dir, NULL);
+    batch->pending_bytes += size;
+
+    g_mutex_lock(&batch->mutex);
+    batch->bytes += size;
+    batch->usecs += usecs;
+    g_mutex_unlock(&batch->mutex);
+
+    if (batch->pending_bytes >= FILE_COPY_BATCH_SIZE)
+        file_copy_batch_flush(batch, NULL);
+}
+
+/* Number of bytes copied using @batch */
+guint64 file_copy_batch_get_bytes(FileCopyBatch *batch) {
+    guint64 bytes;
+
+    g_return_val_if_fail (batch, 0);
+
+    g_mutex_lock(&batch->mutex);
+    bytes = batch->bytes;
+    g_mutex_unlock(&batch->mutex);
+    return bytes;
+}
+
+/* Throughput achieved by @batch in bytes per second, including the
+ * time needed to sync the data to disk. */
+gdouble file_copy_batch_get_rate(FileCopyBatch *batch) {
+    gdouble rate = 0;
+
+    g_return_val_if_fail (batch, 0);
+
+    g_mutex_lock(&batch->mutex);
+    if (batch->usecs > 0)
+        rate = (gdouble) batch->bytes * G_USEC_PER_SEC / batch->usecs;
+    g_mutex_unlock(&batch->mutex);
+    return rate;
+}
+
+/**
+ * Copy @src to @dest, overwriting @dest if it exists.
+ *
+ * @batch: if not NULL, @dest is synced to disk together with the
+ * other files in @batch, either with file_copy_batch_flush() or
+ * automatically once enough data is pending. If NULL, @dest is
+ * synced before returning.
+ *
+ * Returns TRUE on success. In case of failure @error is set (in the
+ * G_FILE_ERROR domain) and @dest is removed. Only errors reading
+ * @src or writing @dest count: if syncing @batch fails, the files
+ * concerned are reported by file_copy_batch_take_results() instead,
+ * even if @batch was flushed automatically by this call.
+ */
+gboolean file_copy(const gchar *src, const gchar *dest, FileCopyBatch *batch, GError **error) {
+    struct stat statbuf;
+    gint from, to, errsv = 0;
+    guint64 copied = 0;
+    gint64 start;
+    gboolean result;
+
+    g_return_val_if_fail (src && dest, FALSE);
+
+    start = g_get_monotonic_time();
+
+    from = g_open(src, O_RDONLY, 0);
+    if (from == -1) {
+        file_copy_set_error(error, errno, _("Could not open '%s' for reading (%s)\n"), src);
+        return FALSE;
+    }
+    if (fstat(from, &statbuf) != 0) {
+        file_copy_set_error(error, errno, _("Could not open '%s' for reading (%s)\n"), src);
+        close(from);
+        return FALSE;
+    }
+#ifdef HAVE_POSIX_FADVISE
+    posix_fadvise(from, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    to = g_open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (to == -1) {
+        file_copy_set_error(error, errno, _("Could not open '%s' for writing (%s)\n"), dest);
+        close(from);
+        return FALSE;
+    }
+
+    result = file_copy_fd(from, to, statbuf.st_size, &copied, &errsv);
+    if (result && !batch && (fsync(to) != 0) && (errno != EINVAL)) {
+        errsv = errno;
+        result = FALSE;
+    }
+    if ((close(to) != 0) && result) {
+        errsv = errno;
+        result = FALSE;
+    }
+    close(from);
+
+    if (!result) {
+        file_copy_set_error(error, errsv, _("Error writing to '%s' (%s)\n"), dest);
+        g_unlink(dest);
+        return FALSE;
+    }
+
+    if (batch)
+        file_copy_batch_add(batch, dest, copied, g_get_monotonic_time() - start);
+
+    return TRUE;
+}
@@ -0,0 +1,56 @@
+/*
+|  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+|  Part of the gtkpod project.
+|
+|  URL: http://www.gtkpod.org/
+|  URL: http://gtkpod.sourceforge.net/
+|
+|  This program is free software; you can redistribute it and/or modify
+|  it under the terms of the GNU General Public License as published by
+|  the Free Software Foundation; either version 2 of the License, or
+|  (at your option) any later version.
+|
+|  This program is distributed in the hope that it will be useful,
+|  but WITHOUT ANY WARRANTY; without even the implied warranty of
+|  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+|  GNU General Public License for more details.
+|
+|  You should have received a copy of the GNU General Public License
+|  along with this program; if not, write to the Free Software
+|  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+|
+|  iTunes and iPod are trademarks of Apple
+|
+|  This product is not supported/written/published by Apple!
+|
+|  $Id$
+*/
+
+#ifndef __FILE_COPY_H__
+#define __FILE_COPY_H__
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+/* A FileCopyBatch collects the files written by file_copy() so that
+ * they can be flushed to disk together, and keeps track of the
+ * throughput achieved. A batch must only be used by one thread at a
+ * time, the statistics may be read from any thread. */
+typedef struct _FileCopyBatch FileCopyBatch;
+
+FileCopyBatch *file_copy_batch_new (void);
+gboolean file_copy_batch_flush (FileCopyBatch *batch, GError **error);
+void file_copy_batch_take_results (FileCopyBatch *batch, GList **synced,
+				   GList **failed);
+void file_copy_batch_add (FileCopyBatch *batch, const gchar *filename,
+			  guint64 size, gint64 usecs);
+void file_copy_batch_free (FileCopyBatch *batch);
+guint64 file_copy_batch_get_bytes (FileCopyBatch *batch);
+gdouble file_copy_batch_get_rate (FileCopyBatch *batch);
+
+gboolean file_copy (const gchar *src, const gchar *dest,
+		    FileCopyBatch *batch, GError **error);
+#endif
@@ -34,6 +34,7 @@
 #include <string.h>
 #include <glib/gstdio.h>
 #include "charset.h"
+#include "extended_info.h"
 #include "file.h"
 #include "itdb.h"
 #include "sha1.h"
@@ -63,26 +64,6 @@
  *                                                                  *
  \*------------------------------------------------------------------*/
 
-/* only used when reading extended info from file */
-/* see definition of ExtraTrackData in display_itdb.h for explanations */
-struct track_extended_info {
-    guint ipod_id;
-    gchar *pc_path_locale;
-    gchar *pc_path_utf8;
-    time_t mtime;
-    gchar *thumb_path_locale;
-    gchar *thumb_path_utf8;
-    gchar *converted_file;
-    gchar *sha1_hash;
-    gchar *charset;
-    gchar *hostname;
-    gchar *ipod_path;
-    guint64 local_itdb_id;
-    guint64 local_track_dbid;
-    gboolean transferred;
-    gchar *lyrics;
-};
-
 typedef struct {
     GMutex mutex; /* mutex for this struct          */
     GCond finished_cond; /* used to signal end of thread   */
@@ -95,10 +76,7 @@ typedef struct {
 } TransferData;
 
 /* Used to keep the "extended information" until the iTunesDB is loaded */
-static GHashTable *extendedinfohash = NULL;
-static GHashTable *extendedinfohash_sha1 = NULL;
-static GList *extendeddeletion = NULL;
-static float extendedinfoversion = 0.0;
+static ExtendedInfo *extendedinfo = NULL;
 
 /* Some declarations */
 static gboolean gp_write_itdb(iTunesDB *itdb);
@@ -145,18 +123,24 @@ static void _clear_cond(TransferData *td) {
 void fill_in_extended_info(Track *track, gint32 total, gint32 num) {
     gint ipod_id = 0;
     ExtraTrackData *etr;
-    struct track_extended_info *sei = NULL;
+    ExtendedTrackInfo *sei = NULL;
 
     g_return_if_fail (track);
     etr = track->userdata;
     g_return_if_fail (etr);
 
-    if (extendedinfohash && track->id) {
+    if (!extendedinfo)
+        return;
+
+    if (extendedinfo->by_dbid && track->dbid) {
+        sei = g_hash_table_lookup(extendedinfo->by_dbid, &track->dbid);
+    }
+    if (!sei && extendedinfo->by_id && track->id) {
         /* copy id to gint value -- needed for the hash table functions */
         ipod_id = track->id;
-        sei = g_hash_table_lookup(extendedinfohash, &ipod_id);
+        sei = g_hash_table_lookup(extendedinfo->by_id, &ipod_id);
     }
-    if (!sei && extendedinfohash_sha1) {
+    if (!sei && extendedinfo->by_sha1) {
         gtkpod_statusbar_message(_("Matching SHA1 checksum for file %d/%d"), num, total);
         while (widgets_blocked && gtk_events_pending())
             gtk_main_iteration();
@@ -167,13 +151,12 @@ void fill_in_extended_info(Track *track, gint32 total, gint32 num) {
             g_free(filename);
         }
         if (etr->sha1_hash) {
-            sei = g_hash_table_lookup(extendedinfohash_sha1, etr->sha1_hash);
+            sei = g_hash_table_lookup(extendedinfo->by_sha1, etr->sha1_hash);
         }
     }
     if (sei) /* found info for this id! */
     {
         etr->lyrics = NULL;
-        sei->lyrics = NULL;
         if (sei->pc_path_locale && !etr->pc_path_locale) {
             etr->pc_path_locale = g_strdup(sei->pc_path_locale);
             etr->mtime = sei->mtime;
@@ -184,8 +167,10 @@ void fill_in_extended_info(Track *track, gint32 total, gint32 num) {
             etr->thumb_path_locale = g_strdup(sei->thumb_path_locale);
         if (sei->thumb_path_utf8 && !etr->thumb_path_utf8)
             etr->thumb_path_utf8 = g_strdup(sei->thumb_path_utf8);
-        if (sei->sha1_hash && !etr->sha1_hash)
+        if (sei->sha1_hash && !etr->sha1_hash) {
             etr->sha1_hash = g_strdup(sei->sha1_hash);
+            etr->sha1_signature = g_strdup(sei->sha1_signature);
+        }
         if (sei->charset && !etr->charset)
             etr->charset = g_strdup(sei->charset);
         if (sei->hostname && !etr->hostname)
@@ -196,212 +181,65 @@ void fill_in_extended_info(Track *track, gint32 total, gint32 num) {
         etr->local_track_dbid = sei->local_track_dbid;
         track->transferred = sei->transferred;
         /* don't remove the sha1-hash -- there may be duplicates... */
-        if (extendedinfohash)
-            g_hash_table_remove(extendedinfohash, &ipod_id);
+        if (extendedinfo->by_dbid && track->dbid)
+            g_hash_table_remove(extendedinfo->by_dbid, &track->dbid);
+        if (extendedinfo->by_id)
+            g_hash_table_remove(extendedinfo->by_id, &ipod_id);
     }
 }
 
-/* Used to free the memory of hash data */
-static void hash_delete(gpointer data) {
-    struct track_extended_info *sei = data;
-
-    if (sei) {
-        g_free(sei->pc_path_locale);
-        g_free(sei->pc_path_utf8);
-        g_free(sei->thumb_path_locale);
-        g_free(sei->thumb_path_utf8);
-        g_free(sei->sha1_hash);
-        g_free(sei->charset);
-        g_free(sei->hostname);
-        g_free(sei->converted_file);
-        g_free(sei->ipod_path);
-        g_free(sei);
-    }
+static void destroy_extendedinfo(void) {
+    extended_info_free(extendedinfo);
+    extendedinfo = NULL;
 }
 
-static void destroy_extendedinfohash(void) {
-    if (extendedinfohash) {
-        g_hash_table_destroy(extendedinfohash);
-        extendedinfohash = NULL;
-    }
-    if (extendedinfohash_sha1) {
-        g_hash_table_destroy(extendedinfohash_sha1);
-        extendedinfohash_sha1 = NULL;
-    }
-    if (extendeddeletion) {
-        g_list_foreach(extendeddeletion, (GFunc) itdb_track_free, NULL);
-        g_list_free(extendeddeletion);
-        extendeddeletion = NULL;
+/* Start reading extended info from "name" in the background while
+ "itunes" is parsed. Returns NULL if "name" does not exist (it can be
+ NULL if it does not exist on the iPod). */
+static ExtendedInfoLoader *read_extended_info_start(gchar *name, gchar *itunes) {
+    g_return_val_if_fail (itunes, NULL);
+
+    destroy_extendedinfo();
+    if (!name || !g_file_test(name, G_FILE_TEST_EXISTS)) {
+        /* Ideally, we'd only warn when we know we've written the extended info
+         * previously...
+         gtkpod_warning (_("Could not open \"%s\" for reading extended info.\n"),
+         name);
+         */
+        return NULL;
     }
-    extendedinfoversion = 0.0;
+
+    return extended_info_read_async(name, itunes);
 }
 
-/* Read extended info from "name" and check if "itunes" is the
- corresponding iTunesDB (using the itunes_hash value in "name").
- The data is stored in a hash table with the ipod_id as key.  This
- hash table is used by fill_in_extended_info() (called from
+/* Collect the extended info read by @loader and check if "itunes" is
+ the corresponding iTunesDB (using the itunes_hash value in "name").
+ The information is used by fill_in_extended_info() (called from
  gp_import_itdb()) to fill in missing information */
 /* Return TRUE on success, FALSE otherwise */
-static gboolean read_extended_info(gchar *name, gchar *itunes) {
-    gchar *sha1, buf[PATH_MAX];
-    gboolean success = TRUE;
-    gboolean expect_hash, hash_matched = FALSE;
-    gint len;
-    struct track_extended_info *sei = NULL;
-    FILE *fp;
-
-    g_return_val_if_fail (itunes, FALSE);
+static gboolean read_extended_info_finish(ExtendedInfoLoader *loader, gchar *name, gchar *itunes) {
+    GError *error = NULL;
 
-    if (!name) { /* name can be NULL if it does not exist on the iPod */
+    if (!loader)
         return FALSE;
-    }
-
-    fp = fopen(name, "r");
 
-    if (!fp) {
-        /* Ideally, we'd only warn when we know we've written the extended info
-         * previously...
-         gtkpod_warning (_("Could not open \"%s\" for reading extended info.\n"),
-         name);
-         */
-        return FALSE;
+    extendedinfo = extended_info_read_finish(loader, &error);
+    if (error) {
+        if (error->domain != G_FILE_ERROR)
+            gtkpod_warning("%s", error->message);
+        g_error_free(error);
     }
-    sha1 = sha1_hash_on_filename(itunes, FALSE);
-    if (!sha1) {
-        gtkpod_warning(_("Could not create hash value from itunesdb\n"));
-        fclose(fp);
+    if (!extendedinfo)
         return FALSE;
+
+    if (extendedinfo->warnings->len > 0)
+        gtkpod_warning("%s", extendedinfo->warnings->str);
+    if (!extendedinfo->hash_matched) {
+        gtkpod_warning(_("iTunesDB '%s' does not match checksum in extended information file '%s'\ngtkpod will try to match the information using SHA1 checksums. This may take a long time.\n\n"), itunes, name);
+        while (widgets_blocked && gtk_events_pending())
+            gtk_main_iteration();
     }
-    /* Create hash table */
-    destroy_extendedinfohash();
-    expect_hash = TRUE; /* next we expect the hash value (checksum) */
-    while (success && fgets(buf, PATH_MAX, fp)) {
-        gchar *line, *arg, *bufp;
-
-        /* allow comments */
-        if ((buf[0] == ';') || (buf[0] == '#'))
-            continue;
-        arg = strchr(buf, '=');
-        if (!arg || (arg == buf)) {
-            gtkpod_warning(_("Error while reading extended info: %s\n"), buf);
-            continue;
-        }
-        /* skip whitespace (isblank() is a GNU extension... */
-        bufp = buf;
-        while ((*bufp == ' ') || (*bufp == 0x09))
-            ++bufp;
-        line = g_strndup(buf, arg - bufp);
-        ++arg;
-        len = strlen(arg); /* remove newline */
-        if ((len > 0) && (arg[len - 1] == 0x0a))
-            arg[len - 1] = 0;
-        if (expect_hash) {
-            if (g_ascii_strcasecmp(line, "itunesdb_hash") == 0) {
-                if (strcmp(arg, sha1) != 0) {
-                    hash_matched = FALSE;
-                    gtkpod_warning(_("iTunesDB '%s' does not match checksum in extended information file '%s'\ngtkpod will try to match the information using SHA1 checksums. This may take a long time.\n\n"), itunes, name);
-                    while (widgets_blocked && gtk_events_pending())
-                        gtk_main_iteration();
-                }
-                else {
-                    hash_matched = TRUE;
-                }
-                expect_hash = FALSE;
-            }
-            else {
-                gtkpod_warning(_("%s:\nExpected \"itunesdb_hash=\" but got:\"%s\"\n"), name, buf);
-                success = FALSE;
-                g_free(line);
-                break;
-            }
-        }
-        else if (g_ascii_strcasecmp(line, "id") == 0) { /* found new id */
-            if (sei) {
-                if (sei->ipod_id != 0) { /* normal extended information */
-                    sei->lyrics = NULL;
-                    if (hash_matched) {
-                        if (!extendedinfohash) {
-                            extendedinfohash = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, hash_delete);
-                        }
-                        g_hash_table_insert(extendedinfohash, &sei->ipod_id, sei);
-                    }
-                    else if (sei->sha1_hash) {
-                        if (!extendedinfohash_sha1) {
-                            extendedinfohash_sha1 = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, hash_delete);
-                        }
-                        g_hash_table_insert(extendedinfohash_sha1, sei->sha1_hash, sei);
-                    }
-                    else {
-                        hash_delete((gpointer) sei);
-                    }
-                }
-                else { /* this is a deleted track that hasn't yet been
-                 removed from the iPod's hard drive */
-                    Track *track = gp_track_new();
-                    track->ipod_path = g_strdup(sei->ipod_path);
-                    extendeddeletion = g_list_append(extendeddeletion, track);
-                    hash_delete((gpointer) sei); /* free sei */
-                }
-                sei = NULL;
-            }
-            if (strcmp(arg, "xxx") != 0) {
-                sei = g_malloc0(sizeof(struct track_extended_info));
-                sei->ipod_id = atoi(arg);
-                sei->lyrics = NULL;
-            }
-        }
-        else if (g_ascii_strcasecmp(line, "version") == 0) { /* found version */
-            extendedinfoversion = g_ascii_strtod(arg, NULL);
-        }
-        else if (sei == NULL) {
-            gtkpod_warning(_("%s:\nFormat error: %s\n"), name, buf);
-            success = FALSE;
-            g_free(line);
-            break;
-        }
-        else if (g_ascii_strcasecmp(line, "hostname") == 0)
-            sei->hostname = g_strdup(arg);
-        else if (g_ascii_strcasecmp(line, "converted_file") == 0)
-            sei->converted_file = g_strdup(arg);
-        else if (g_ascii_strcasecmp(line, "filename_locale") == 0)
-            sei->pc_path_locale = g_strdup(arg);
-        else if (g_ascii_strcasecmp(line, "filename_utf8") == 0)
-            sei->pc_path_utf8 = g_strdup(arg);
-        else if (g_ascii_strcasecmp(line, "thumbnail_locale") == 0)
-            sei->thumb_path_locale = g_strdup(arg);
-        else if (g_ascii_strcasecmp(line, "thumbnail_utf8") == 0)
-            sei->thumb_path_utf8 = g_strdup(arg);
-        else if ((g_ascii_strcasecmp(line, "md5_hash") == 0) || (g_ascii_strcasecmp(line, "sha1_hash") == 0)) { /* only accept hash value if version is >= 0.53 or
-         PATH_MAX is 4096 -- in 0.53 I changed the MD5 hash
-         routine to using blocks of 4096 Bytes in
-         length. Before it was PATH_MAX, which might be
-         different on different architectures. */
-            if ((extendedinfoversion >= 0.53) || (PATH_MAX == 4096))
-                sei->sha1_hash = g_strdup(arg);
-        }
-        else if (g_ascii_strcasecmp(line, "charset") == 0)
-            sei->charset = g_strdup(arg);
-        else if (g_ascii_strcasecmp(line, "transferred") == 0)
-            sei->transferred = atoi(arg);
-        else if (g_ascii_strcasecmp(line, "filename_ipod") == 0)
-            sei->ipod_path = g_strdup(arg);
-        else if (g_ascii_strcasecmp(line, "pc_mtime") == 0)
-            sei->mtime = (time_t) g_ascii_strtoull(arg, NULL, 10);
-        else if (g_ascii_strcasecmp(line, "local_itdb_id") == 0)
-            sei->local_itdb_id = (guint64) g_ascii_strtoull(arg, NULL, 10);
-        else if (g_ascii_strcasecmp(line, "local_track_dbid") == 0)
-            sei->local_track_dbid = (guint64) g_ascii_strtoull(arg, NULL, 10);
-        g_free(line);
-    }
-    g_free(sha1);
-    fclose(fp);
-    if (success && !hash_matched && !extendedinfohash_sha1) {
-        gtkpod_warning(_("No SHA1 checksums on individual tracks are available.\n\nTo avoid this situation in the future either switch on duplicate detection (will provide SHA1 checksums) or avoid using the iPod with programs other than gtkpod.\n\n"), itunes, name);
-        success = FALSE;
-    }
-    if (!success)
-        destroy_extendedinfohash();
-    return success;
+    return TRUE;
 }
 
 /**
@@ -461,8 +299,10 @@ iTunesDB *gp_import_itdb(iTunesDB *old_itdb, const gint type, const gchar *mp, c
     iTunesDB *itdb = NULL;
     GString *errors = g_string_new(""); /* Errors generated during the import */
     GError *error = NULL;
+    ExtendedInfoLoader *loader = NULL;
     gint32 total, num;
     gboolean offline;
+    gdouble extendedinfoversion;
 
     g_return_val_if_fail (!(type & GP_ITDB_TYPE_LOCAL) || name_loc, NULL);
     g_return_val_if_fail (!(type & GP_ITDB_TYPE_IPOD) ||
@@ -491,8 +331,12 @@ iTunesDB *gp_import_itdb(iTunesDB *old_itdb, const gint type, const gchar *mp, c
         }
 
         if (g_file_test(name_db, G_FILE_TEST_EXISTS)) {
+            /* the extended info is read while the iTunesDB is parsed */
+            if (WRITE_EXTENDED_INFO)
+                loader = read_extended_info_start(name_ext, name_db);
+            itdb = itdb_parse_file(name_db, &error);
             if (WRITE_EXTENDED_INFO) {
-                if (!read_extended_info(name_ext, name_db)) {
+                if (!read_extended_info_finish(loader, name_ext, name_db)) {
                     gchar
                             *msg =
                                     g_strdup_printf(_("The repository %s does not have a readable extended database.\n"), name_db);
@@ -501,7 +345,6 @@ iTunesDB *gp_import_itdb(iTunesDB *old_itdb, const gint type, const gchar *mp, c
                     g_string_append(errors, msg);
                 }
             }
-            itdb = itdb_parse_file(name_db, &error);
             if (itdb && !error) {
                 if (type & GP_ITDB_TYPE_IPOD)
                     gtkpod_statusbar_message(_("Offline iPod database successfully imported"));
@@ -538,12 +381,15 @@ iTunesDB *gp_import_itdb(iTunesDB *old_itdb, const gint type, const gchar *mp, c
         if (name_db) {
             name_ext = g_strdup_printf("%s.ext", name_db);
 
+            /* the extended info is read while the iTunesDB is parsed */
+            if (WRITE_EXTENDED_INFO)
+                loader = read_extended_info_start(name_ext, name_db);
+            itdb = itdb_parse(mp, &error);
             if (WRITE_EXTENDED_INFO) {
-                if (!read_extended_info(name_ext, name_db)) {
+                if (!read_extended_info_finish(loader, name_ext, name_db)) {
                     g_string_append(errors, _("Extended info will not be used.\n\n"));
                 }
             }
-            itdb = itdb_parse(mp, &error);
             if (itdb && !error) {
                 gtkpod_statusbar_message(_("iPod Database Successfully Imported\n\n"));
             }
@@ -568,6 +414,7 @@ iTunesDB *gp_import_itdb(iTunesDB *old_itdb, const gint type, const gchar *mp, c
     g_free(cfgdir);
 
     if (!itdb) {
+        destroy_extendedinfo();
         release_widgets();
         return NULL;
     }
@@ -591,6 +438,7 @@ iTunesDB *gp_import_itdb(iTunesDB *old_itdb, const gint type, const gchar *mp, c
         eitdb->offline_filename = g_strdup(name_off);
     }
 
+    extendedinfoversion = extendedinfo ? extendedinfo->version : 0.0;
     total = g_list_length(itdb->tracks);
     num = 1;
     /* validate all tracks and fill in extended info */
@@ -633,15 +481,25 @@ iTunesDB *gp_import_itdb(iTunesDB *old_itdb, const gint type, const gchar *mp, c
         ++num;
     }
     /* take over the pending deletion information */
-    while (extendeddeletion) {
-        Track *track = extendeddeletion->data;
-        g_return_val_if_fail (track, (release_widgets(), NULL));
-        mark_track_for_deletion(itdb, track);
-        extendeddeletion = g_list_delete_link(extendeddeletion, extendeddeletion);
+    if (extendedinfo) {
+        for (gl = extendedinfo->pending_deletion; gl; gl = gl->next) {
+            /* this track has been marked for deletion but not yet
+             removed from the iPod's hard drive */
+            Track *track = gp_track_new();
+            track->ipod_path = g_strdup(gl->data);
+            mark_track_for_deletion(itdb, track);
+        }
+    }
+
+    /* keep track of what is in the extended info file so that the
+     next save only needs to append the changes */
+    if (extendedinfo) {
+        eitdb->extended_info_journal = extendedinfo->journal;
+        extendedinfo->journal = NULL;
     }
 
     /* delete hash information (if present) */
-    destroy_extendedinfohash();
+    destroy_extendedinfo();
 
     /* find duplicates and create sha1 hash*/
     gp_sha1_hash_tracks_itdb(itdb);
@@ -1112,9 +970,8 @@ void mark_track_for_deletion(iTunesDB *itdb, Track *track) {
  * calculate the sha1 checksum of the corresponding iTunesDB */
 static gboolean write_extended_info(iTunesDB *itdb) {
     ExtraiTunesDBData *eitdb;
-    FILE *fp;
-    gchar *sha1;
-    GList *gl;
+    GError *error = NULL;
+    gboolean success;
     gchar *name;
 
     g_return_val_if_fail (itdb, FALSE);
@@ -1123,78 +980,15 @@ static gboolean write_extended_info(iTunesDB *itdb) {
     g_return_val_if_fail (eitdb, FALSE);
 
     name = g_strdup_printf("%s.ext", itdb->filename);
-    fp = fopen(name, "w");
-    if (!fp) {
-        gtkpod_warning(_("Could not open \"%s\" for writing extended info.\n"), name);
-        g_free(name);
-        return FALSE;
+    /* if we are offline we also need to export the list of tracks
+     that are to be deleted */
+    success = extended_info_write(name, itdb, get_offline(itdb) ? eitdb->pending_deletion : NULL, &eitdb->extended_info_journal, &error);
+    if (!success) {
+        gtkpod_warning("%s", error->message);
+        g_error_free(error);
     }
     g_free(name);
-    name = NULL;
-    sha1 = sha1_hash_on_filename(itdb->filename, FALSE);
-    if (sha1) {
-        fprintf(fp, "itunesdb_hash=%s\n", sha1);
-        g_free(sha1);
-    }
-    else {
-        gtkpod_warning(_("Aborted writing of extended info.\n"));
-        fclose(fp);
-        return FALSE;
-    }
-    fprintf(fp, "version=%s\n", VERSION);
-    for (gl = itdb->tracks; gl; gl = gl->next) {
-        Track *track = gl->data;
-        ExtraTrackData *etr;
-        g_return_val_if_fail (track, (fclose (fp), FALSE));
-        etr = track->userdata;
-        g_return_val_if_fail (etr, (fclose (fp), FALSE));
-        fprintf(fp, "id=%d\n", track->id);
-        if (etr->hostname)
-            fprintf(fp, "hostname=%s\n", etr->hostname);
-        if (etr->converted_file)
-            fprintf(fp, "converted_file=%s\n", etr->converted_file);
-        if (etr->pc_path_locale && *etr->pc_path_locale)
-            fprintf(fp, "filename_locale=%s\n", etr->pc_path_locale);
-        if (etr->pc_path_utf8 && *etr->pc_path_utf8)
-            fprintf(fp, "filename_utf8=%s\n", etr->pc_path_utf8);
-        if (etr->thumb_path_locale && *etr->thumb_path_locale)
-            fprintf(fp, "thumbnail_locale=%s\n", etr->thumb_path_locale);
-        if (etr->thumb_path_utf8 && *etr->thumb_path_utf8)
-            fprintf(fp, "thumbnail_utf8=%s\n", etr->thumb_path_utf8);
-        /* this is just for convenience for people looking for a track
-         on the ipod away from gktpod/itunes etc. */
-        if (track->ipod_path && strlen(track->ipod_path) != 0)
-            fprintf(fp, "filename_ipod=%s\n", track->ipod_path);
-        if (etr->sha1_hash && *etr->sha1_hash)
-            fprintf(fp, "sha1_hash=%s\n", etr->sha1_hash);
-        if (etr->charset && *etr->charset)
-            fprintf(fp, "charset=%s\n", etr->charset);
-        if (etr->mtime)
-            fprintf(fp, "pc_mtime=%llu\n", (unsigned long long) etr->mtime);
-        if (etr->local_itdb_id)
-            fprintf(fp, "local_itdb_id=%" G_GUINT64_FORMAT "\n", etr->local_itdb_id);
-        if (etr->local_track_dbid)
-            fprintf(fp, "local_track_dbid=%" G_GUINT64_FORMAT "\n", etr->local_track_dbid);
-        fprintf(fp, "transferred=%d\n", track->transferred);
-        while (widgets_blocked && gtk_events_pending())
-            gtk_main_iteration();
-    }
-    if (get_offline(itdb)) { /* we are offline and also need to export the list of tracks that
-     are to be deleted */
-        for (gl = eitdb->pending_deletion; gl; gl = gl->next) {
-            Track *track = gl->data;
-            g_return_val_if_fail (track, (fclose (fp), FALSE));
-
-            fprintf(fp, "id=000\n"); /* our sign for tracks pending
-             deletion */
-            fprintf(fp, "filename_ipod=%s\n", track->ipod_path);
-            while (widgets_blocked && gtk_events_pending())
-                gtk_main_iteration();
-        }
-    }
-    fprintf(fp, "id=xxx\n");
-    fclose(fp);
-    return TRUE;
+    return success;
 }
 
 gboolean gp_create_extended_info(iTunesDB *itdb) {
@@ -1544,7 +1338,7 @@ static gboolean transfer_tracks(iTunesDB *itdb, TransferData *td) {
     file_transfer_reschedule(itdb);
 
     /* find out how many tracks have already been processed */
-    file_transfer_get_status(itdb, &to_convert_num, &converting_num, &to_transfer_num, &transferred_num, &failed_num);
+    file_transfer_get_status(itdb, &to_convert_num, &converting_num, &to_transfer_num, &transferred_num, &failed_num, NULL, NULL);
 
     /* Reset the progress bar to the total number of tracks to be transferred */
     gtkpod_statusbar_reset_progress(to_convert_num + converting_num + to_transfer_num + failed_num + transferred_num);
@@ -1555,12 +1349,19 @@ static gboolean transfer_tracks(iTunesDB *itdb, TransferData *td) {
 
     do {
         gchar *buf;
+        gint queue_depth;
+        gdouble rate;
 
         status
-                = file_transfer_get_status(itdb, &to_convert_num, &converting_num, &to_transfer_num, &transferred_num, &failed_num);
+                = file_transfer_get_status(itdb, &to_convert_num, &converting_num, &to_transfer_num, &transferred_num, &failed_num, &queue_depth, &rate);
 
         if (to_transfer_num > 0) {
-            buf = g_strdup_printf(_("Saving: waiting for %d tracks to be copied"), to_transfer_num);
+            if (rate > 0) {
+                buf = g_strdup_printf(_("Saving: waiting for %d tracks to be copied, %d queued (%.1f MB/s)"), to_transfer_num, queue_depth, rate / (1024 * 1024));
+            }
+            else {
+                buf = g_strdup_printf(_("Saving: waiting for %d tracks to be copied"), to_transfer_num);
+            }
         }
         else {
             if ((to_convert_num + converting_num) > 0) {
@@ -0,0 +1,309 @@
+/*
+ |  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+
+/* In-process transcoding for the background transfer. The source
+ * file is decoded and re-encoded by a GStreamer pipeline that writes
+ * straight to its destination on the iPod, so no converted copy has
+ * to be written to the conversion cache and copied afterwards.
+ *
+ * Only the target formats listed in transcode_profiles[] are
+ * supported, and only if GStreamer provides an encoder and a muxer
+ * for them. Without GStreamer file_transcode_supported() returns
+ * FALSE and the conversion scripts are used as before. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n-lib.h>
+#include "file_transcode.h"
+
+#ifdef HAVE_GSTREAMER
+#include <gst/gst.h>
+
+/* how often the cancel callback is polled while transcoding */
+#define TRANSCODE_POLL_INTERVAL (100 * GST_MSECOND)
+
+typedef struct
+{
+    const gchar *extension; /* extension of the transcoded file    */
+    const gchar *encoders[5]; /* the first one available is used   */
+    const gchar *filter; /* optional element after the encoder      */
+    const gchar *muxers[3]; /* the first one available is used     */
+} TranscodeProfile;
+
+static const TranscodeProfile transcode_profiles[] = {
+    /* xingmux adds the header needed to read the gapless info */
+    { "mp3", { "lamemp3enc", NULL }, "xingmux", { "id3v2mux", "id3mux", NULL } },
+    { "m4a", { "fdkaacenc", "voaacenc", "avenc_aac", "faac", NULL }, "aacparse", { "mp4mux", NULL } }
+};
+
+static gboolean transcode_init(void) {
+    static gsize initialized = 0;
+    static gboolean available = FALSE;
+
+    if (g_once_init_enter(&initialized)) {
+        available = gst_init_check(NULL, NULL, NULL);
+        g_once_init_leave(&initialized, 1);
+    }
+    return available;
+}
+
+/* Return the first of @names GStreamer has a factory for, or NULL */
+static const gchar *transcode_find_factory(const gchar * const *names) {
+    for (; *names; ++names) {
+        GstElementFactory *factory = gst_element_factory_find(*names);
+        if (factory) {
+            gst_object_unref(factory);
+            return *names;
+        }
+    }
+    return NULL;
+}
+
+static const TranscodeProfile *transcode_get_profile(const gchar *extension) {
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (transcode_profiles); ++i) {
+        const TranscodeProfile *profile = &transcode_profiles[i];
+        if (g_ascii_strcasecmp(profile->extension, extension) == 0) {
+            if (transcode_find_factory(profile->encoders) && transcode_find_factory(profile->muxers))
+                return profile;
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/* Create an element from @factory and add it to @pipeline. Returns
+ * NULL if @factory is NULL or not available. */
+static GstElement *transcode_add_element(GstElement *pipeline, const gchar *factory) {
+    GstElement *element;
+
+    if (!factory)
+        return NULL;
+    element = gst_element_factory_make(factory, NULL);
+    if (element)
+        gst_bin_add(GST_BIN (pipeline), element);
+    return element;
+}
+
+/* link the audio stream of the decoder to @data (audioconvert) */
+static void transcode_pad_added(GstElement *decoder, GstPad *pad, gpointer data) {
+    GstElement *convert = data;
+    GstPad *sinkpad;
+    GstCaps *caps;
+
+    sinkpad = gst_element_get_static_pad(convert, "sink");
+    caps = gst_pad_query_caps(pad, NULL);
+
+    if (!gst_pad_is_linked(sinkpad) && !gst_caps_is_empty(caps)) {
+        const gchar *name = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+        if (g_str_has_prefix(name, "audio/"))
+            gst_pad_link(pad, sinkpad);
+    }
+
+    gst_caps_unref(caps);
+    gst_object_unref(sinkpad);
+}
+
+static void transcode_add_string_tag(GstTagSetter *setter, const gchar *tag, const gchar *value) {
+    if (value && value[0])
+        gst_tag_setter_add_tags(setter, GST_TAG_MERGE_REPLACE, tag, value, NULL);
+}
+
+/* Tags set on the muxer take precedence over the tags of the source
+ * file, which are passed on as well. */
+static void transcode_set_tags(GstElement *muxer, const FileTranscodeTags *tags) {
+    GstTagSetter *setter;
+
+    if (!tags || !GST_IS_TAG_SETTER (muxer))
+        return;
+
+    setter = GST_TAG_SETTER (muxer);
+    transcode_add_string_tag(setter, GST_TAG_ARTIST, tags->artist);
+    transcode_add_string_tag(setter, GST_TAG_ALBUM, tags->album);
+    transcode_add_string_tag(setter, GST_TAG_TITLE, tags->title);
+    transcode_add_string_tag(setter, GST_TAG_GENRE, tags->genre);
+    transcode_add_string_tag(setter, GST_TAG_COMMENT, tags->comment);
+    if (tags->track_nr)
+        gst_tag_setter_add_tags(setter, GST_TAG_MERGE_REPLACE, GST_TAG_TRACK_NUMBER, tags->track_nr, NULL);
+    if (tags->year) {
+        GstDateTime *date = gst_date_time_new_y(tags->year);
+        gst_tag_setter_add_tags(setter, GST_TAG_MERGE_REPLACE, GST_TAG_DATE_TIME, date, NULL);
+        gst_date_time_unref(date);
+    }
+}
+
+/* Set @error from the error reported by the pipeline. A full disk is
+ * reported as G_FILE_ERROR_NOSPC, just like file_copy() does. */
+static void transcode_set_error(GError **error, const GError *gst_error, const gchar *src) {
+    gint code = G_FILE_ERROR_FAILED;
+    gchar *src_utf8;
+
+    if ((gst_error->domain == GST_RESOURCE_ERROR) && (gst_error->code == GST_RESOURCE_ERROR_NO_SPACE_LEFT))
+        code = G_FILE_ERROR_NOSPC;
+
+    src_utf8 = g_filename_display_name(src);
+    g_set_error(error, G_FILE_ERROR, code, _("Could not transcode '%s' (%s)\n"), src_utf8, gst_error->message);
+    g_free(src_utf8);
+}
+#endif
+
+/**
+ * TRUE if file_transcode() can produce files with @extension
+ * ("mp3", "m4a").
+ */
+gboolean file_transcode_supported(const gchar *extension) {
+#ifdef HAVE_GSTREAMER
+    g_return_val_if_fail (extension, FALSE);
+
+    return transcode_init() && transcode_get_profile(extension);
+#else
+    return FALSE;
+#endif
+}
+
+/**
+ * Decode @src and encode it into @dest in the format given by
+ * @extension, writing @tags into @dest. Blocks until done, so call
+ * it from a worker thread.
+ *
+ * @cancelled: if not NULL, called every 100 ms with @user_data. The
+ * transcoding is aborted if it returns TRUE.
+ *
+ * Returns TRUE on success. In case of failure @error is set (in the
+ * G_FILE_ERROR domain, G_FILE_ERROR_NOSPC if the disk is full) and
+ * @dest is removed.
+ */
+gboolean file_transcode(const gchar *src, const gchar *dest, const gchar *extension, const FileTranscodeTags *tags, FileTranscodeCancelled cancelled, gpointer user_data, GError **error) {
+#ifdef HAVE_GSTREAMER
+    const TranscodeProfile *profile = NULL;
+    GstElement *pipeline, *source, *decoder, *convert, *resample;
+    GstElement *encoder, *filter, *muxer, *sink;
+    GstStateChangeReturn state;
+    GstBus *bus;
+    gboolean linked, done = FALSE, result = FALSE;
+    gchar *src_utf8;
+
+    g_return_val_if_fail (src && dest && extension, FALSE);
+
+    if (transcode_init())
+        profile = transcode_get_profile(extension);
+    if (!profile) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, _("Transcoding to '%s' files is not supported\n"), extension);
+        return FALSE;
+    }
+
+    src_utf8 = g_filename_display_name(src);
+
+    pipeline = gst_pipeline_new("transcode");
+    source = transcode_add_element(pipeline, "filesrc");
+    decoder = transcode_add_element(pipeline, "decodebin");
+    convert = transcode_add_element(pipeline, "audioconvert");
+    resample = transcode_add_element(pipeline, "audioresample");
+    encoder = transcode_add_element(pipeline, transcode_find_factory(profile->encoders));
+    filter = transcode_add_element(pipeline, profile->filter);
+    muxer = transcode_add_element(pipeline, transcode_find_factory(profile->muxers));
+    sink = transcode_add_element(pipeline, "filesink");
+
+    linked = source && decoder && convert && resample && encoder && muxer && sink;
+    linked = linked && gst_element_link(source, decoder) && gst_element_link_many(convert, resample, encoder, NULL);
+    /* the filter is optional */
+    if (linked && filter)
+        linked = gst_element_link(encoder, filter) && gst_element_link(filter, muxer);
+    else if (linked)
+        linked = gst_element_link(encoder, muxer);
+    linked = linked && gst_element_link(muxer, sink);
+
+    if (!linked) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, _("Could not transcode '%s' (%s)\n"), src_utf8, _("GStreamer pipeline could not be set up"));
+        gst_object_unref(pipeline);
+        g_free(src_utf8);
+        return FALSE;
+    }
+
+    g_object_set(source, "location", src, NULL);
+    g_object_set(sink, "location", dest, NULL);
+    g_signal_connect(decoder, "pad-added", G_CALLBACK (transcode_pad_added), convert);
+    transcode_set_tags(muxer, tags);
+
+    bus = gst_element_get_bus(pipeline);
+    state = gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+    while (!done) {
+        GstMessage *msg;
+
+        /* if the pipeline didn't start, only pick up the error it
+         posted */
+        msg = gst_bus_timed_pop_filtered(bus, (state == GST_STATE_CHANGE_FAILURE) ? 0 : TRANSCODE_POLL_INTERVAL, GST_MESSAGE_EOS
+                | GST_MESSAGE_ERROR);
+
+        if (!msg) {
+            if (state == GST_STATE_CHANGE_FAILURE) {
+                g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, _("Could not transcode '%s' (%s)\n"), src_utf8, _("GStreamer pipeline could not be started"));
+                done = TRUE;
+            }
+            else if (cancelled && cancelled(user_data)) {
+                g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INTR, _("Transcoding of '%s' was cancelled\n"), src_utf8);
+                done = TRUE;
+            }
+            continue;
+        }
+
+        if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+            result = TRUE;
+        }
+        else {
+            GError *gst_error = NULL;
+            gst_message_parse_error(msg, &gst_error, NULL);
+            transcode_set_error(error, gst_error, src);
+            g_error_free(gst_error);
+        }
+        gst_message_unref(msg);
+        done = TRUE;
+    }
+
+    /* closes @dest */
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(bus);
+    gst_object_unref(pipeline);
+    g_free(src_utf8);
+
+    if (!result)
+        g_unlink(dest);
+
+    return result;
+#else
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED, _("Transcoding to '%s' files is not supported\n"), extension);
+    return FALSE;
+#endif
+}
@@ -0,0 +1,61 @@
+/*
+ |  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+
+#ifndef __FILE_TRANSCODE_H__
+#define __FILE_TRANSCODE_H__
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+/* Tags written into the transcoded file. Strings may be NULL or
+ * empty, numbers 0 if unknown. */
+typedef struct
+{
+    const gchar *artist;
+    const gchar *album;
+    const gchar *title;
+    const gchar *genre;
+    const gchar *comment;
+    guint track_nr;
+    guint year;
+} FileTranscodeTags;
+
+/* Called regularly while transcoding. Return TRUE to abort. */
+typedef gboolean (* FileTranscodeCancelled) (gpointer user_data);
+
+gboolean file_transcode_supported (const gchar *extension);
+gboolean file_transcode (const gchar *src, const gchar *dest,
+			 const gchar *extension,
+			 const FileTranscodeTags *tags,
+			 FileTranscodeCancelled cancelled,
+			 gpointer user_data, GError **error);
+#endif
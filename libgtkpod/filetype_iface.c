@@ -42,6 +42,7 @@ static void filetype_iface_base_init(FileTypeInterface *klass) {
         klass->name = NULL;
         klass->description = NULL;
         klass->suffixes = NULL;
+        klass->reentrant = FALSE;
         klass->get_file_info = NULL;
         klass->write_file_info = NULL;
         klass->read_soundcheck = NULL;
@@ -97,6 +98,12 @@ GList *filetype_get_suffixes(FileType *filetype) {
     return FILE_TYPE_GET_INTERFACE(filetype)->suffixes;
 }
 
+gboolean filetype_is_reentrant(FileType *filetype) {
+    if (!FILE_IS_TYPE(filetype))
+        return FALSE;
+    return FILE_TYPE_GET_INTERFACE(filetype)->reentrant;
+}
+
 Track *filetype_get_file_info(FileType *filetype, const gchar *filename, GError **error) {
     if (!FILE_IS_TYPE(filetype))
         return NULL;
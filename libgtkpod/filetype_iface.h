@@ -58,6 +58,7 @@ struct _FileTypeInterface {
     gchar *description;
     GList *suffixes;
     filetype_category category;
+    gboolean reentrant; /* get_file_info may be called from several threads at once */
     Track * (* get_file_info) (const gchar *filename, GError **error);
     gboolean (* write_file_info) (const gchar *filename, Track *track, GError **error);
     gboolean (* read_soundcheck) (const gchar *filename, Track *track, GError **error);
@@ -129,6 +130,8 @@ gboolean filetype_read_gapless(FileType *filetype, const gchar *filename, Track
 gboolean filetype_can_convert(FileType *filetype);
 gchar *filetype_get_conversion_cmd(FileType *filetype);
 
+gboolean filetype_is_reentrant(FileType *filetype);
+
 gboolean filetype_is_playlist_filetype(FileType *filetype);
 gboolean filetype_is_video_filetype(FileType *filetype);
 gboolean filetype_is_audio_filetype(FileType *filetype);
@@ -44,6 +44,7 @@
 #include "misc_track.h"
 #include "prefs.h"
 #include "syncdir.h"
+#include "thumbnail_cache.h"
 #include "autodetection.h"
 #include "clientserver.h"
 #include "gtkpod_app_iface.h"
@@ -62,8 +63,19 @@ void gp_itdb_extra_destroy(ExtraiTunesDBData *eitdb) {
     if (eitdb) {
         sha1_free_eitdb(eitdb);
         gp_itdb_pc_path_hash_destroy(eitdb);
+        if (eitdb->ipod_path_hash)
+            g_hash_table_destroy(eitdb->ipod_path_hash);
+        if (eitdb->pc_path_locale_hash) {
+            GHashTableIter iter;
+            gpointer tracks;
+            g_hash_table_iter_init(&iter, eitdb->pc_path_locale_hash);
+            while (g_hash_table_iter_next(&iter, NULL, &tracks))
+                g_list_free(tracks);
+            g_hash_table_destroy(eitdb->pc_path_locale_hash);
+        }
         g_free(eitdb->offline_filename);
         itdb_photodb_free(eitdb->photodb);
+        extended_info_journal_free(eitdb->extended_info_journal);
         g_free(eitdb);
     }
 }
@@ -103,8 +115,11 @@ void gp_track_extra_destroy(ExtraTrackData *etrack) {
         g_free(etrack->thumb_path_utf8);
         g_free(etrack->hostname);
         g_free(etrack->sha1_hash);
+        g_free(etrack->sha1_signature);
         g_free(etrack->charset);
         g_free(etrack->lyrics);
+        g_free(etrack->ipod_path_key);
+        g_free(etrack->pc_path_locale_key);
         g_free(etrack);
     }
 }
@@ -124,10 +139,13 @@ ExtraTrackData *gp_track_extra_duplicate(ExtraTrackData *etr) {
         etr_dup->thumb_path_utf8 = g_strdup(etr->thumb_path_utf8);
         etr_dup->hostname = g_strdup(etr->hostname);
         etr_dup->sha1_hash = g_strdup(etr->sha1_hash);
+        etr_dup->sha1_signature = g_strdup(etr->sha1_signature);
         etr_dup->charset = g_strdup(etr->charset);
         etr_dup->lyrics = g_strdup(etr->lyrics);
         /* clear the pc_path_hashed flag */
         etr_dup->pc_path_hashed = FALSE;
+        etr_dup->ipod_path_key = NULL;
+        etr_dup->pc_path_locale_key = NULL;
     }
     return etr_dup;
 }
@@ -143,6 +161,8 @@ iTunesDB *gp_itdb_new(void) {
 void gp_itdb_free(iTunesDB *itdb) {
     /* cancel all pending conversions */
     file_convert_cancel_itdb (itdb);
+    /* drop thumbnails and stop decoding artwork from its device */
+    thumbnail_cache_cancel_itdb (itdb);
     itdb_free(itdb);
 }
 
@@ -247,8 +267,10 @@ Track *gp_track_add(iTunesDB *itdb, Track *track) {
         /* exception: sha1_hash, hostname, charset: these may be NULL. */
         gp_track_validate_entries(track);
         itdb_track_add(itdb, track, -1);
-        /* add to filename hash */
+        /* add to filename hashes */
         gp_itdb_pc_path_hash_add_track(track);
+        gp_itdb_ipod_path_hash_add_track(track);
+        gp_itdb_pc_path_locale_hash_add_track(track);
         /* add to background conversion if necessary */
         if (! file_convert_add_track (track)) {
             g_idle_add((GSourceFunc) gp_remove_track_cb, track);
@@ -283,8 +305,12 @@ void gp_track_unlink(Track *track) {
     file_convert_cancel_track(track);
     /* remove from SHA1 hash */
     sha1_track_remove(track);
-    /* remove from pc_path_hash */
+    /* remove from pc_path_hash, ipod_path_hash and pc_path_locale_hash */
     gp_itdb_pc_path_hash_remove_track(track);
+    gp_itdb_ipod_path_hash_remove_track(track);
+    gp_itdb_pc_path_locale_hash_remove_track(track);
+    /* remove from thumbnail cache */
+    thumbnail_cache_remove_track(track);
     /* remove from database */
     itdb_track_unlink(track);
 }
@@ -299,6 +325,9 @@ static gboolean gp_track_set_thumbnails_internal(Track *track, const gchar *file
     etr = track->userdata;
     g_return_val_if_fail (etr, FALSE);
 
+    thumbnail_cache_invalidate_track(track);
+    etr->artwork_from_file = FALSE;
+
     if (filename) {
         result = itdb_track_set_thumbnails(track, filename);
     }
@@ -352,7 +381,9 @@ gboolean gp_track_remove_thumbnails(Track *track) {
     if (itdb_track_has_thumbnails(track))
         changed = TRUE;
 
+    thumbnail_cache_invalidate_track(track);
     itdb_track_remove_thumbnails(track);
+    etr->artwork_from_file = FALSE;
     g_free(etr->thumb_path_locale);
     g_free(etr->thumb_path_utf8);
     etr->thumb_path_locale = g_strdup("");
@@ -979,6 +1010,112 @@ iTunesDB *setup_itdb_n(gint i) {
     return itdb;
 }
 
+/* Create a new playcount update of @num plays of @file. @sha1 may be
+ NULL if the hash of the file is not known. */
+PlaycountUpdate *gp_playcount_update_new(const gchar *sha1, const gchar *file, gint num) {
+    PlaycountUpdate *update = g_new0 (PlaycountUpdate, 1);
+
+    update->sha1 = g_strdup(sha1);
+    update->file = g_strdup(file);
+    update->num = num;
+    return update;
+}
+
+void gp_playcount_update_free(PlaycountUpdate *update) {
+    if (update) {
+        g_free(update->sha1);
+        g_free(update->file);
+        g_free(update);
+    }
+}
+
+/* Find the track @update refers to in @itdb: by the sha1 hash if
+ known, by the filename otherwise. */
+static Track *playcount_update_find_track(iTunesDB *itdb, PlaycountUpdate *update) {
+    Track *track = NULL;
+
+    if (update->sha1)
+        track = sha1_sha1_exists(itdb, update->sha1);
+    if (!track && update->file)
+        track = gp_track_by_filename(itdb, update->file);
+    return track;
+}
+
+/* Apply the list of PlaycountUpdates @updates in one go. Plays of the
+ same track are added up first, so every track is updated and every
+ repository is marked as changed only once, and a single statusbar
+ message is displayed for the whole list.
+
+ Return value: a list of the members of @updates whose track could
+ not be found in a GP_ITDB_TYPE_IPOD repository. The members
+ themselves remain owned by the caller, free the list with
+ g_list_free(). */
+GList *gp_increase_playcounts(GList *updates) {
+    GHashTable *counts; /* Track * -> number of plays */
+    GHashTable *changed_itdbs;
+    GHashTableIter iter;
+    gpointer key, value;
+    GList *unmatched = NULL;
+    GList *gl, *glu;
+    Track *last_track = NULL;
+    gint tracks = 0;
+
+    if (!itdbs_head) /* no repositories loaded (yet) */
+        return g_list_copy(updates);
+
+    counts = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (glu = updates; glu; glu = glu->next) {
+        PlaycountUpdate *update = glu->data;
+        gboolean found = FALSE;
+        g_return_val_if_fail (update, unmatched);
+
+        for (gl = itdbs_head->itdbs; gl; gl = gl->next) {
+            iTunesDB *itdb = gl->data;
+            Track *track;
+            g_return_val_if_fail (itdb, unmatched);
+
+            track = playcount_update_find_track(itdb, update);
+            if (track) {
+                gint num = GPOINTER_TO_INT (g_hash_table_lookup (counts, track));
+                g_hash_table_insert(counts, track, GINT_TO_POINTER (num + update->num));
+                if (itdb->usertype & GP_ITDB_TYPE_IPOD)
+                    found = TRUE;
+            }
+        }
+        if (!found)
+            unmatched = g_list_prepend(unmatched, update);
+    }
+
+    changed_itdbs = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_iter_init(&iter, counts);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        Track *track = key;
+
+        track->playcount += GPOINTER_TO_INT (value);
+        gtkpod_track_updated(track);
+        g_hash_table_insert(changed_itdbs, track->itdb, track->itdb);
+        last_track = track;
+        ++tracks;
+    }
+    g_hash_table_iter_init(&iter, changed_itdbs);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+        data_changed(key);
+
+    if (tracks == 1) {
+        gchar *buf = get_track_info(last_track, TRUE);
+        gtkpod_statusbar_message(_("Increased playcount for '%s'"), buf);
+        g_free(buf);
+    }
+    else if (tracks > 1) {
+        gtkpod_statusbar_message(ngettext ("Increased playcount for %d track",
+                "Increased playcount for %d tracks", tracks), tracks);
+    }
+
+    g_hash_table_destroy(changed_itdbs);
+    g_hash_table_destroy(counts);
+    return g_list_reverse(unmatched);
+}
+
 /* Increase playcount of filename <file> by <num>. If sha1 is activated,
  use sha1 to find the track. Otherwise use the filename. If @sha1 is
  set, this value is used directly to look up the track in the
@@ -988,34 +1125,23 @@ iTunesDB *setup_itdb_n(gint i) {
  TRUE: OK (playcount increased in GP_ITDB_TYPE_IPOD)
  FALSE: file could not be found in the GP_ITDB_TYPE_IPOD */
 gboolean gp_increase_playcount(gchar *sha1, gchar *file, gint num) {
-    gboolean result = FALSE;
-    Track *track = NULL;
-    GList *gl;
+    PlaycountUpdate *update;
+    GList *updates, *unmatched;
+    gboolean result;
 
     g_return_val_if_fail (itdbs_head, FALSE);
 
-    for (gl = itdbs_head->itdbs; gl; gl = gl->next) {
-        iTunesDB *itdb = gl->data;
-        g_return_val_if_fail (itdb, FALSE);
+    update = gp_playcount_update_new(sha1, file, num);
+    if (!update->sha1 && file && prefs_get_int("sha1"))
+        update->sha1 = sha1_hash_on_filename(file, TRUE);
 
-        if (sha1)
-            track = sha1_sha1_exists(itdb, sha1);
-        else
-            track = sha1_file_exists(itdb, file, TRUE);
-        if (!track)
-            track = gp_track_by_filename(itdb, file);
-        if (track) {
-            gchar *buf1;
-            track->playcount += num;
-            data_changed(itdb);
-            gtkpod_track_updated(track);
-            buf1 = get_track_info(track, TRUE);
-            gtkpod_statusbar_message(_("Increased playcount for '%s'"), buf1);
-            g_free(buf1);
-            if (itdb->usertype & GP_ITDB_TYPE_IPOD)
-                result = TRUE;
-        }
-    }
+    updates = g_list_append(NULL, update);
+    unmatched = gp_increase_playcounts(updates);
+    result = (unmatched == NULL);
+
+    g_list_free(unmatched);
+    g_list_free(updates);
+    gp_playcount_update_free(update);
     return result;
 }
 
@@ -35,6 +35,7 @@
 
 #include <gtk/gtk.h>
 #include "itdb.h"
+#include "extended_info.h"
 #include "file_convert_info.h"
 #include "gtkpod_app_iface.h"
 
@@ -48,6 +49,11 @@ typedef struct
     struct itdbs_head *itdbs_head; /* pointer to the master itdbs_head     */
     GHashTable *sha1hash;          /* sha1 hash information                */
     GHashTable *pc_path_hash;      /* hash with local filenames            */
+    GHashTable *ipod_path_hash;    /* hash with iPod filenames, see
+				      gp_itdb_ipod_path_hash_find_track() */
+    GHashTable *pc_path_locale_hash; /* hash with local filenames in the
+				      locale's encoding, see
+				      gp_itdb_pc_path_locale_hash_find_track() */
     GList *pending_deletion;       /* tracks marked for removal from
 				      media                                */
     gchar *offline_filename;       /* filename for offline database
@@ -58,6 +64,8 @@ typedef struct
     gboolean itdb_imported;        /* has in iTunesDB been imported?       */
     gboolean ipod_ejected;         /* if iPod was ejected                  */
     PhotoDB *photodb;            /* Photo DB reference used if the ipod supports photos */
+    ExtendedInfoJournal *extended_info_journal; /* what was written to
+				      the extended info file last      */
 } ExtraiTunesDBData;
 
 typedef struct
@@ -73,6 +81,8 @@ typedef struct
   time_t  mtime;            /* modification date of PC file                */
   gboolean pc_path_hashed;  /* for programming error detection (see
 			       gp_itdb_local_path_hash_add_track()         */
+  gchar   *ipod_path_key;   /* key in the iPod path hash or NULL         */
+  gchar   *pc_path_locale_key; /* key in the locale path hash or NULL    */
   gchar   *converted_file;  /* if converted file exists: name in utf8      */
   gint32  orig_filesize;    /* size of original file (if converted)        */
   FileConvertStatus conversion_status; /* current status of conversion     */
@@ -80,10 +90,15 @@ typedef struct
   gchar   *thumb_path_utf8;  /* same for thumbnail                         */
   gchar   *hostname;        /* name of host this file has been imported on */
   gchar   *sha1_hash;       /* sha1 hash of file (or NULL)                 */
+  gchar   *sha1_signature;  /* mode, size, mtime, inode and path of the
+			       file sha1_hash was computed from (or NULL),
+			       see sha1_file_signature()                   */
   gchar   *charset;         /* charset used for ID3 tags                   */
   gint32  sortindex;        /* used for stable sorting (current order)     */
   gboolean tchanged;        /* temporary use, e.g. in detail.c             */
   gboolean tartwork_changed;			/* temporary use for artwork, eg. in detail.c          */
+  gboolean artwork_from_file; /* thumbnail is the picture embedded in the
+			       file, unchanged since it was read           */
   guint64 local_itdb_id;    /* when using DND from local to iPod:
 			       original itdb                               */
   guint64 local_track_dbid; /* when using DND from local to iPod:
@@ -164,6 +179,19 @@ void gp_playlist_add_track (Playlist *pl, Track *track, gboolean display);
 
 void gp_playlist_add_extra (Playlist *pl);
 
+/* A number of plays of a file reported by an external player, see
+   gp_increase_playcounts() */
+typedef struct
+{
+    gchar *sha1;  /* sha1 hash of the file, may be NULL */
+    gchar *file;  /* filename as reported by the player */
+    gint num;     /* number of plays */
+} PlaycountUpdate;
+
+PlaycountUpdate *gp_playcount_update_new (const gchar *sha1,
+					  const gchar *file, gint num);
+void gp_playcount_update_free (PlaycountUpdate *update);
+GList *gp_increase_playcounts (GList *updates);
 gboolean gp_increase_playcount (gchar *sha1, gchar *file, gint num);
 iTunesDB *gp_get_selected_itdb (void);
 iTunesDB *gp_get_ipod_itdb (void);
@@ -37,6 +37,14 @@
 #include "context_menus.h"
 #include "prefs.h"
 
+/* Tracks added while gtkpod_freeze_tracks_added() is in effect */
+static gint tracks_added_freeze_count = 0;
+static GList *tracks_added_pending = NULL;
+static GHashTable *tracks_added_pending_hash = NULL;
+
+/* Set by gtkpod_statusbar_cancel_progress() */
+static gboolean progress_cancelled = FALSE;
+
 static void gtkpod_app_base_init(GtkPodAppInterface* klass) {
     static gboolean initialized = FALSE;
 
@@ -78,6 +86,9 @@ static void gtkpod_app_base_init(GtkPodAppInterface* klass) {
         gtkpod_app_signals[TRACKS_DISPLAYED]
                 = g_signal_new(SIGNAL_TRACKS_DISPLAYED, G_OBJECT_CLASS_TYPE (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
 
+        gtkpod_app_signals[DISPLAYED_TRACKS_ADDED]
+                = g_signal_new(SIGNAL_DISPLAYED_TRACKS_ADDED, G_OBJECT_CLASS_TYPE (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
+
         gtkpod_app_signals[TRACKS_SELECTED]
                 = g_signal_new(SIGNAL_TRACKS_SELECTED, G_OBJECT_CLASS_TYPE (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
 
@@ -90,6 +101,9 @@ static void gtkpod_app_base_init(GtkPodAppInterface* klass) {
         gtkpod_app_signals[TRACK_ADDED]
                 = g_signal_new(SIGNAL_TRACK_ADDED, G_OBJECT_CLASS_TYPE (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
 
+        gtkpod_app_signals[TRACKS_ADDED]
+                = g_signal_new(SIGNAL_TRACKS_ADDED, G_OBJECT_CLASS_TYPE (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
+
         gtkpod_app_signals[SORT_ENABLEMENT]
                 = g_signal_new(SIGNAL_SORT_ENABLEMENT, G_OBJECT_CLASS_TYPE (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_VOID__BOOLEAN, G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
 
@@ -171,14 +185,45 @@ gint gtkpod_cleanup_quit() {
         gtkpod_shutdown();
         return TRUE; // Already to carry on quitting
     }
+    /* ask the operation keeping the widgets blocked to stop early */
+    gtkpod_statusbar_cancel_progress();
     return FALSE; // dont quit!
 }
 
 void gtkpod_statusbar_reset_progress(gint total) {
     g_return_if_fail (GTKPOD_IS_APP(gtkpod_app));
+    progress_cancelled = FALSE;
     GTKPOD_APP_GET_INTERFACE (gtkpod_app)->statusbar_reset_progress(gtkpod_app, total);
 }
 
+/**
+ * Request the operation whose progress is currently shown in the
+ * statusbar to stop. Operations supporting this poll
+ * gtkpod_statusbar_progress_cancelled() between steps. The request
+ * is cleared by the next gtkpod_statusbar_reset_progress().
+ */
+void gtkpod_statusbar_cancel_progress() {
+    progress_cancelled = TRUE;
+}
+
+gboolean gtkpod_statusbar_progress_cancelled() {
+    return progress_cancelled;
+}
+
+/**
+ * Show (@cancellable TRUE) or hide a control in the statusbar that
+ * lets the user stop the current operation through
+ * gtkpod_statusbar_cancel_progress(). Call it after
+ * gtkpod_statusbar_reset_progress() from operations polling
+ * gtkpod_statusbar_progress_cancelled(), and hide it again when the
+ * operation is done.
+ */
+void gtkpod_statusbar_set_cancellable(gboolean cancellable) {
+    g_return_if_fail (GTKPOD_IS_APP(gtkpod_app));
+    if (GTKPOD_APP_GET_INTERFACE (gtkpod_app)->statusbar_set_cancellable)
+        GTKPOD_APP_GET_INTERFACE (gtkpod_app)->statusbar_set_cancellable(gtkpod_app, cancellable);
+}
+
 /**
  * Increments the current progress bar value by the
  * given number of ticks.
@@ -300,13 +345,63 @@ void gtkpod_set_current_playlist(Playlist* playlist) {
     gtkpod_set_displayed_tracks(tracks);
 }
 
+/**
+ * Announce a track newly added to a playlist.
+ *
+ * While track additions are frozen the track is only queued and is
+ * announced together with the rest of the batch by the
+ * SIGNAL_TRACKS_ADDED emission in gtkpod_thaw_tracks_added().
+ */
 void gtkpod_track_added(Track *track) {
     g_return_if_fail (GTKPOD_IS_APP(gtkpod_app));
     g_return_if_fail (track);
 
+    if (tracks_added_freeze_count > 0) {
+        if (!g_hash_table_lookup(tracks_added_pending_hash, track)) {
+            g_hash_table_insert(tracks_added_pending_hash, track, track);
+            tracks_added_pending = g_list_prepend(tracks_added_pending, track);
+        }
+        return;
+    }
+
     g_signal_emit(gtkpod_app, gtkpod_app_signals[TRACK_ADDED], 0, track);
 }
 
+/**
+ * Start collecting added tracks instead of announcing each one
+ * individually. Calls may be nested; each must be paired with
+ * gtkpod_thaw_tracks_added().
+ */
+void gtkpod_freeze_tracks_added() {
+    if (tracks_added_freeze_count++ == 0 && !tracks_added_pending_hash)
+        tracks_added_pending_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+/**
+ * Undo one gtkpod_freeze_tracks_added(). When the outermost freeze is
+ * released all tracks collected in the meantime are announced by a
+ * single emission of SIGNAL_TRACKS_ADDED, passing a GList of the
+ * tracks in the order they were added. The list is owned by gtkpod
+ * and only valid for the duration of the emission.
+ */
+void gtkpod_thaw_tracks_added() {
+    GList *tracks;
+
+    g_return_if_fail (tracks_added_freeze_count > 0);
+
+    if (--tracks_added_freeze_count > 0)
+        return;
+
+    tracks = g_list_reverse(tracks_added_pending);
+    tracks_added_pending = NULL;
+    g_hash_table_remove_all(tracks_added_pending_hash);
+
+    if (tracks && GTKPOD_IS_APP(gtkpod_app))
+        g_signal_emit(gtkpod_app, gtkpod_app_signals[TRACKS_ADDED], 0, tracks);
+
+    g_list_free(tracks);
+}
+
 void gtkpod_track_removed(Track *track) {
     g_return_if_fail (GTKPOD_IS_APP(gtkpod_app));
     g_return_if_fail (track);
@@ -317,6 +412,9 @@ void gtkpod_track_removed(Track *track) {
     GList *displayed_tracks = GTKPOD_APP_GET_INTERFACE (gtkpod_app)->displayed_tracks;
     GTKPOD_APP_GET_INTERFACE (gtkpod_app)->displayed_tracks = g_list_remove(displayed_tracks, track);
 
+    if (tracks_added_pending_hash && g_hash_table_remove(tracks_added_pending_hash, track))
+        tracks_added_pending = g_list_remove(tracks_added_pending, track);
+
     g_signal_emit(gtkpod_app, gtkpod_app_signals[TRACK_REMOVED], 0, track);
 }
 
@@ -360,6 +458,28 @@ void gtkpod_set_displayed_tracks(GList *tracks) {
     g_signal_emit(gtkpod_app, gtkpod_app_signals[TRACKS_DISPLAYED], 0, tracks);
 }
 
+/**
+ * Add @tracks to the tracks displayed, e.g. tracks newly added to the
+ * current playlist that pass the sort tab filters. Unlike
+ * gtkpod_set_displayed_tracks() the views only insert @tracks into
+ * what they show. The list remains owned by the caller.
+ */
+void gtkpod_add_displayed_tracks(GList *tracks) {
+    GtkPodAppInterface *gp_iface;
+
+    g_return_if_fail (GTKPOD_IS_APP(gtkpod_app));
+    if (!tracks)
+        return;
+
+    gp_iface = GTKPOD_APP_GET_INTERFACE (gtkpod_app);
+    /* if no tracks are set, the members of the current playlist are
+     * displayed, which already include @tracks */
+    if (gp_iface->displayed_tracks)
+        gp_iface->displayed_tracks = g_list_concat(gp_iface->displayed_tracks, g_list_copy(tracks));
+
+    g_signal_emit(gtkpod_app, gtkpod_app_signals[DISPLAYED_TRACKS_ADDED], 0, tracks);
+}
+
 GList *gtkpod_get_selected_tracks() {
     g_return_val_if_fail (GTKPOD_IS_APP(gtkpod_app), NULL);
     GList *selected_tracks = GTKPOD_APP_GET_INTERFACE (gtkpod_app)->selected_tracks;
@@ -54,10 +54,12 @@
 #define GTKPOD_APP_GET_INTERFACE(inst) (G_TYPE_INSTANCE_GET_INTERFACE ((inst), GTKPOD_APP_TYPE, GtkPodAppInterface))
 
 #define SIGNAL_TRACKS_DISPLAYED "signal_tracks_displayed"
+#define SIGNAL_DISPLAYED_TRACKS_ADDED "signal_displayed_tracks_added"
 #define SIGNAL_TRACKS_SELECTED "signal_tracks_selected"
 #define SIGNAL_TRACK_REMOVED "signal_track_removed"
 #define SIGNAL_TRACK_UPDATED "signal_track_updated"
 #define SIGNAL_TRACK_ADDED "signal_track_added"
+#define SIGNAL_TRACKS_ADDED "signal_tracks_added"
 #define SIGNAL_PLAYLIST_SELECTED "signal_playlist_selected"
 #define SIGNAL_PLAYLIST_ADDED "signal_playlist_added"
 #define SIGNAL_PLAYLIST_REMOVED "signal_playlist_removed"
@@ -94,8 +96,10 @@ void CONF_NULL_HANDLER (gpointer d1, gpointer d2);
 enum
 {
     TRACKS_DISPLAYED,
+    DISPLAYED_TRACKS_ADDED,
     TRACKS_SELECTED,
     TRACK_ADDED,
+    TRACKS_ADDED,
     TRACK_REMOVED,
     TRACK_UPDATED,
     PLAYLIST_SELECTED,
@@ -146,6 +150,7 @@ struct _GtkPodAppInterface {
     void (*itdb_updated)(GtkPodApp *obj, iTunesDB *oldItdb, iTunesDB *newItbd);
     void (*statusbar_reset_progress)(GtkPodApp *obj, gint total);
     void (*statusbar_increment_progress_ticks)(GtkPodApp *obj, gint ticks, gchar* text);
+    void (*statusbar_set_cancellable)(GtkPodApp *obj, gboolean cancellable);
     void (*statusbar_message)(GtkPodApp *obj, gchar* message, ...);
     void (*gtkpod_warning)(GtkPodApp *obj, gchar *message, ...);
     void (*gtkpod_warning_hig)(GtkPodApp *obj, GtkMessageType icon, const gchar *primary_text, const gchar *secondary_text);
@@ -169,6 +174,9 @@ gint gtkpod_cleanup_quit();
 
 void gtkpod_statusbar_reset_progress(gint total);
 void gtkpod_statusbar_increment_progress_ticks(gint ticks, gchar* text);
+void gtkpod_statusbar_cancel_progress();
+void gtkpod_statusbar_set_cancellable(gboolean cancellable);
+gboolean gtkpod_statusbar_progress_cancelled();
 void gtkpod_statusbar_message(gchar* message, ...);
 void gtkpod_statusbar_busy_push();
 void gtkpod_statusbar_busy_pop();
@@ -194,9 +202,12 @@ void gtkpod_playlist_added(iTunesDB *itdb, Playlist *playlist, gint32 pos);
 
 GList *gtkpod_get_displayed_tracks();
 void gtkpod_set_displayed_tracks(GList *tracks);
+void gtkpod_add_displayed_tracks(GList *tracks);
 GList *gtkpod_get_selected_tracks();
 void gtkpod_set_selected_tracks(GList *tracks);
 void gtkpod_track_added(Track *track);
+void gtkpod_freeze_tracks_added();
+void gtkpod_thaw_tracks_added();
 void gtkpod_track_removed(Track *track);
 void gtkpod_track_updated(Track *track);
 
@@ -0,0 +1,482 @@
+/*
+ |  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+/* Integrated loudness of a track as defined by ITU-R BS.1770 and
+ * EBU R128: the samples are K-weighted (a high shelf followed by a
+ * high pass), the weighted mean square is taken over blocks of
+ * 400 ms overlapping by 75%, and the blocks quieter than -70 LUFS and
+ * then those more than 10 LU below the mean of the rest are
+ * discarded. The ReplayGain of the track is its distance to
+ * LOUDNESS_REFERENCE_LUFS.
+ *
+ * The analyzer does not decode anything itself, the filetype plugins
+ * feed it through a LoudnessDecoder. Samples are converted to float
+ * in chunks of planar buffers, the conversion and the sum of squares
+ * are plain loops over contiguous arrays the compiler can vectorize.
+ * Nothing in here touches the GUI, so tracks can be analyzed on
+ * worker threads. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <glib/gi18n-lib.h>
+#include "charset.h"
+#include "gp_private.h"
+#include "misc.h"
+#include "prefs.h"
+#include "loudness.h"
+
+/* number of frames converted to float at a time */
+#define LA_CHUNK_FRAMES 4096
+
+/* blocks below this loudness are silence (absolute gate) */
+#define LA_ABSOLUTE_GATE_LUFS (-70.0)
+/* blocks this far below the mean are ignored (relative gate) */
+#define LA_RELATIVE_GATE_LU (-10.0)
+
+/* Coefficients of a biquad filter (a0 normalized to 1) */
+typedef struct {
+    gdouble b0, b1, b2, a1, a2;
+} LaBiquad;
+
+/* Filter state of one channel (transposed direct form II) */
+typedef struct {
+    gdouble shelf_z1, shelf_z2;
+    gdouble highpass_z1, highpass_z2;
+} LaChannel;
+
+struct _LoudnessAnalyzer {
+    guint channels;
+    guint rate;
+    LaBiquad shelf; /* stage 1 of the K-weighting */
+    LaBiquad highpass; /* stage 2 of the K-weighting */
+    LaChannel channel[LOUDNESS_MAX_CHANNELS];
+    gdouble weight[LOUDNESS_MAX_CHANNELS];
+    gsize subblock_frames; /* frames in 100 ms */
+    gsize subblock_pos; /* frames in the current 100 ms */
+    gdouble subblock_energy; /* weighted sum of squares of the
+				current 100 ms */
+    gdouble last_energy[3]; /* the three 100 ms before */
+    guint subblocks; /* number of 100 ms completed */
+    GArray *blocks; /* mean square of every 400 ms block */
+    gdouble total_energy; /* for tracks shorter than one block */
+    guint64 total_frames;
+    gfloat *scratch; /* @channels planes of LA_CHUNK_FRAMES */
+};
+
+/* Compute the K-weighting filters for @rate (ITU-R BS.1770, the
+ * coefficients given there for 48 kHz derived for any rate). */
+static void la_init_filters(LoudnessAnalyzer *la) {
+    gdouble f0, gain, q, k, vh, vb, a0;
+
+    f0 = 1681.974450955533;
+    gain = 3.999843853973347;
+    q = 0.7071752369554196;
+    k = tan(G_PI * f0 / la->rate);
+    vh = pow(10.0, gain / 20.0);
+    vb = pow(vh, 0.4996667741545416);
+    a0 = 1.0 + k / q + k * k;
+    la->shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    la->shelf.b1 = 2.0 * (k * k - vh) / a0;
+    la->shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    la->shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    la->shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(G_PI * f0 / la->rate);
+    a0 = 1.0 + k / q + k * k;
+    la->highpass.b0 = 1.0;
+    la->highpass.b1 = -2.0;
+    la->highpass.b2 = 1.0;
+    la->highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+    la->highpass.a2 = (1.0 - k / q + k * k) / a0;
+}
+
+/* Channel weights for the WAV/FLAC channel order (L R C LFE Ls Rs):
+ * the surround channels count 1.41 times, the LFE channel not at
+ * all. */
+static void la_init_weights(LoudnessAnalyzer *la) {
+    guint i;
+
+    for (i = 0; i < la->channels; ++i) {
+        if ((la->channels >= 5) && (i >= 3))
+            la->weight[i] = 1.41;
+        else
+            la->weight[i] = 1.0;
+    }
+    if (la->channels >= 6)
+        la->weight[3] = 0.0;
+}
+
+/**
+ * Create an analyzer for audio with @channels channels sampled at
+ * @rate Hz. Returns NULL if the format is not supported.
+ */
+LoudnessAnalyzer *loudness_analyzer_new(guint channels, guint rate) {
+    LoudnessAnalyzer *la;
+
+    if ((channels == 0) || (channels > LOUDNESS_MAX_CHANNELS) || (rate < 1000))
+        return NULL;
+
+    la = g_new0 (LoudnessAnalyzer, 1);
+    la->channels = channels;
+    la->rate = rate;
+    la->subblock_frames = rate / 10;
+    la->blocks = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    la->scratch = g_new (gfloat, (gsize) channels * LA_CHUNK_FRAMES);
+    la_init_filters(la);
+    la_init_weights(la);
+
+    return la;
+}
+
+void loudness_analyzer_free(LoudnessAnalyzer *la) {
+    if (la) {
+        g_array_free(la->blocks, TRUE);
+        g_free(la->scratch);
+        g_free(la);
+    }
+}
+
+/**
+ * Change the weight of @channel. The defaults assume the WAV/FLAC
+ * channel order (L R C LFE Ls Rs), decoders delivering a different
+ * order set the weights of the surround and LFE channels themselves.
+ */
+void loudness_analyzer_set_channel_weight(LoudnessAnalyzer *la, guint channel, gdouble weight) {
+    g_return_if_fail (la);
+    g_return_if_fail (channel < la->channels);
+
+    la->weight[channel] = weight;
+}
+
+/* K-weight @frames samples of channel @c and return the sum of their
+ * squares. */
+static gdouble la_filter(LoudnessAnalyzer *la, guint c, const gfloat *samples, gsize frames) {
+    const LaBiquad *s = &la->shelf;
+    const LaBiquad *h = &la->highpass;
+    LaChannel *ch = &la->channel[c];
+    gdouble sz1 = ch->shelf_z1, sz2 = ch->shelf_z2;
+    gdouble hz1 = ch->highpass_z1, hz2 = ch->highpass_z2;
+    gdouble sum = 0;
+    gsize i;
+
+    for (i = 0; i < frames; ++i) {
+        gdouble x = samples[i];
+        gdouble y = s->b0 * x + sz1;
+        gdouble z;
+        sz1 = s->b1 * x - s->a1 * y + sz2;
+        sz2 = s->b2 * x - s->a2 * y;
+        z = h->b0 * y + hz1;
+        hz1 = h->b1 * y - h->a1 * z + hz2;
+        hz2 = h->b2 * y - h->a2 * z;
+        sum += z * z;
+    }
+
+    /* don't let the state decay into denormals during silence */
+    ch->shelf_z1 = (fabs(sz1) < 1e-30) ? 0 : sz1;
+    ch->shelf_z2 = (fabs(sz2) < 1e-30) ? 0 : sz2;
+    ch->highpass_z1 = (fabs(hz1) < 1e-30) ? 0 : hz1;
+    ch->highpass_z2 = (fabs(hz2) < 1e-30) ? 0 : hz2;
+
+    return sum;
+}
+
+/* A 100 ms sub-block is complete: the four last ones make up the
+ * next 400 ms block */
+static void la_subblock_done(LoudnessAnalyzer *la) {
+    gdouble energy = la->subblock_energy;
+
+    if (la->subblocks >= 3) {
+        gdouble block = (la->last_energy[0] + la->last_energy[1] + la->last_energy[2] + energy) / (4.0
+                * la->subblock_frames);
+        g_array_append_val(la->blocks, block);
+    }
+    la->last_energy[0] = la->last_energy[1];
+    la->last_energy[1] = la->last_energy[2];
+    la->last_energy[2] = energy;
+    ++la->subblocks;
+    la->subblock_energy = 0;
+    la->subblock_pos = 0;
+}
+
+/* Analyze @frames frames given as one float array per channel */
+static void la_process(LoudnessAnalyzer *la, const gfloat * const *planes, gsize frames) {
+    gsize done = 0;
+
+    while (done < frames) {
+        gsize n = MIN (frames - done, la->subblock_frames - la->subblock_pos);
+        gdouble energy = 0;
+        guint c;
+
+        for (c = 0; c < la->channels; ++c) {
+            gdouble sum = la_filter(la, c, planes[c] + done, n);
+            energy += la->weight[c] * sum;
+        }
+        la->subblock_energy += energy;
+        la->total_energy += energy;
+        la->total_frames += n;
+        la->subblock_pos += n;
+        done += n;
+
+        if (la->subblock_pos == la->subblock_frames)
+            la_subblock_done(la);
+    }
+}
+
+/* Return the planes of the scratch buffer */
+static void la_scratch_planes(LoudnessAnalyzer *la, const gfloat *planes[]) {
+    guint c;
+
+    for (c = 0; c < la->channels; ++c)
+        planes[c] = la->scratch + (gsize) c * LA_CHUNK_FRAMES;
+}
+
+/**
+ * Analyze @frames frames of interleaved float samples in the range
+ * -1..1.
+ */
+void loudness_analyzer_add_float(LoudnessAnalyzer *la, const gfloat *samples, gsize frames) {
+    const gfloat *planes[LOUDNESS_MAX_CHANNELS];
+
+    g_return_if_fail (la);
+    g_return_if_fail (samples || (frames == 0));
+
+    la_scratch_planes(la, planes);
+    while (frames > 0) {
+        gsize n = MIN (frames, LA_CHUNK_FRAMES);
+        guint c;
+
+        for (c = 0; c < la->channels; ++c) {
+            gfloat *out = la->scratch + (gsize) c * LA_CHUNK_FRAMES;
+            const gfloat *in = samples + c;
+            gsize i;
+            for (i = 0; i < n; ++i)
+                out[i] = in[i * la->channels];
+        }
+        la_process(la, planes, n);
+        samples += n * la->channels;
+        frames -= n;
+    }
+}
+
+/**
+ * Analyze @frames frames given as one array of float samples in the
+ * range -1..1 per channel.
+ */
+void loudness_analyzer_add_planar_float(LoudnessAnalyzer *la, gfloat * const *planes, gsize frames) {
+    g_return_if_fail (la);
+    g_return_if_fail (planes || (frames == 0));
+
+    la_process(la, (const gfloat * const *) planes, frames);
+}
+
+/**
+ * Analyze @frames frames of interleaved integer samples with @bits
+ * significant bits (right aligned).
+ */
+void loudness_analyzer_add_int(LoudnessAnalyzer *la, const gint32 *samples, gsize frames, guint bits) {
+    const gfloat *planes[LOUDNESS_MAX_CHANNELS];
+    gfloat scale;
+
+    g_return_if_fail (la);
+    g_return_if_fail (samples || (frames == 0));
+    g_return_if_fail ((bits > 0) && (bits <= 32));
+
+    scale = 1.0 / (gdouble) (G_GINT64_CONSTANT (1) << (bits - 1));
+    la_scratch_planes(la, planes);
+    while (frames > 0) {
+        gsize n = MIN (frames, LA_CHUNK_FRAMES);
+        guint c;
+
+        for (c = 0; c < la->channels; ++c) {
+            gfloat *out = la->scratch + (gsize) c * LA_CHUNK_FRAMES;
+            const gint32 *in = samples + c;
+            gsize i;
+            for (i = 0; i < n; ++i)
+                out[i] = in[i * la->channels] * scale;
+        }
+        la_process(la, planes, n);
+        samples += n * la->channels;
+        frames -= n;
+    }
+}
+
+/**
+ * Analyze @frames frames given as one array of integer samples with
+ * @bits significant bits (right aligned) per channel.
+ */
+void loudness_analyzer_add_planar_int(LoudnessAnalyzer *la, const gint32 * const *planes, gsize frames, guint bits) {
+    const gfloat *out_planes[LOUDNESS_MAX_CHANNELS];
+    gsize done = 0;
+    gfloat scale;
+
+    g_return_if_fail (la);
+    g_return_if_fail (planes || (frames == 0));
+    g_return_if_fail ((bits > 0) && (bits <= 32));
+
+    scale = 1.0 / (gdouble) (G_GINT64_CONSTANT (1) << (bits - 1));
+    la_scratch_planes(la, out_planes);
+    while (done < frames) {
+        gsize n = MIN (frames - done, LA_CHUNK_FRAMES);
+        guint c;
+
+        for (c = 0; c < la->channels; ++c) {
+            gfloat *out = la->scratch + (gsize) c * LA_CHUNK_FRAMES;
+            const gint32 *in = planes[c] + done;
+            gsize i;
+            for (i = 0; i < n; ++i)
+                out[i] = in[i] * scale;
+        }
+        la_process(la, out_planes, n);
+        done += n;
+    }
+}
+
+static gdouble la_energy_to_lufs(gdouble energy) {
+    return -0.691 + 10.0 * log10(energy);
+}
+
+static gdouble la_lufs_to_energy(gdouble lufs) {
+    return pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+/**
+ * Get the gated integrated loudness in LUFS of everything analyzed
+ * so far. Tracks shorter than one block are measured ungated.
+ *
+ * Return value: FALSE if nothing audible was analyzed.
+ */
+gboolean loudness_analyzer_get_loudness(LoudnessAnalyzer *la, gdouble *lufs) {
+    gdouble absolute_gate, relative_gate, sum;
+    guint i, count;
+
+    g_return_val_if_fail (la, FALSE);
+    g_return_val_if_fail (lufs, FALSE);
+
+    absolute_gate = la_lufs_to_energy(LA_ABSOLUTE_GATE_LUFS);
+
+    if (la->blocks->len == 0) {
+        gdouble energy;
+        if (la->total_frames == 0)
+            return FALSE;
+        energy = la->total_energy / la->total_frames;
+        if (energy <= absolute_gate)
+            return FALSE;
+        *lufs = la_energy_to_lufs(energy);
+        return TRUE;
+    }
+
+    sum = 0;
+    count = 0;
+    for (i = 0; i < la->blocks->len; ++i) {
+        gdouble block = g_array_index (la->blocks, gdouble, i);
+        if (block > absolute_gate) {
+            sum += block;
+            ++count;
+        }
+    }
+    if (count == 0)
+        return FALSE;
+
+    relative_gate = MAX (absolute_gate, sum / count * pow(10.0, LA_RELATIVE_GATE_LU / 10.0));
+    sum = 0;
+    count = 0;
+    for (i = 0; i < la->blocks->len; ++i) {
+        gdouble block = g_array_index (la->blocks, gdouble, i);
+        if (block > relative_gate) {
+            sum += block;
+            ++count;
+        }
+    }
+    if (count == 0)
+        return FALSE;
+
+    *lufs = la_energy_to_lufs(sum / count);
+    return TRUE;
+}
+
+/**
+ * Measure the loudness of @filename decoded by @decoder and set the
+ * soundcheck value of @track from it (taking "replaygain_offset" into
+ * account like the ReplayGain tags read by the filetype plugins).
+ *
+ * Return value: TRUE if the soundcheck value could be set.
+ */
+gboolean loudness_read_soundcheck(const LoudnessDecoder *decoder, const gchar *filename, Track *track, GError **error) {
+    LoudnessAnalyzer *la;
+    gpointer handle;
+    guint channels = 0, rate = 0;
+    gdouble lufs;
+    gint result;
+    gboolean success = FALSE;
+    gchar *fn;
+
+    g_return_val_if_fail (decoder, FALSE);
+    g_return_val_if_fail (filename, FALSE);
+    g_return_val_if_fail (track, FALSE);
+
+    handle = decoder->open(filename, &channels, &rate, error);
+    if (!handle)
+        return FALSE;
+
+    fn = charset_to_utf8(filename);
+    la = loudness_analyzer_new(channels, rate);
+    if (!la) {
+        decoder->close(handle);
+        gtkpod_log_error_printf(error, _("Could not analyze the loudness of '%s': %d channels at %d Hz are not supported.\n"), fn, channels, rate);
+        g_free(fn);
+        return FALSE;
+    }
+
+    while ((result = decoder->decode(handle, la, error)) > 0)
+        ;
+    decoder->close(handle);
+
+    if (result == 0) {
+        if (loudness_analyzer_get_loudness(la, &lufs)) {
+            gdouble replaygain = LOUDNESS_REFERENCE_LUFS - lufs;
+            track->soundcheck = replaygain_to_soundcheck(replaygain + prefs_get_int("replaygain_offset"));
+            success = TRUE;
+        }
+        else {
+            gtkpod_log_error_printf(error, _("Could not analyze the loudness of '%s': the file contains no audible sound.\n"), fn);
+        }
+    }
+    else if (error && !*error) {
+        gtkpod_log_error_printf(error, _("Could not analyze the loudness of '%s': decoding failed.\n"), fn);
+    }
+
+    loudness_analyzer_free(la);
+    g_free(fn);
+    return success;
+}
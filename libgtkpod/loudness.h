@@ -0,0 +1,85 @@
+/*
+ |  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+#ifndef __LOUDNESS_H__
+#define __LOUDNESS_H__
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+#include "itdb.h"
+
+/* Loudness the ReplayGain of a track refers to (ReplayGain 2.0) */
+#define LOUDNESS_REFERENCE_LUFS (-18.0)
+
+/* Largest number of channels the analyzer accepts */
+#define LOUDNESS_MAX_CHANNELS 8
+
+typedef struct _LoudnessAnalyzer LoudnessAnalyzer;
+
+LoudnessAnalyzer *loudness_analyzer_new (guint channels, guint rate);
+void loudness_analyzer_free (LoudnessAnalyzer *analyzer);
+void loudness_analyzer_set_channel_weight (LoudnessAnalyzer *analyzer,
+					   guint channel, gdouble weight);
+void loudness_analyzer_add_float (LoudnessAnalyzer *analyzer,
+				  const gfloat *samples, gsize frames);
+void loudness_analyzer_add_planar_float (LoudnessAnalyzer *analyzer,
+					 gfloat * const *planes,
+					 gsize frames);
+void loudness_analyzer_add_int (LoudnessAnalyzer *analyzer,
+				const gint32 *samples, gsize frames,
+				guint bits);
+void loudness_analyzer_add_planar_int (LoudnessAnalyzer *analyzer,
+				       const gint32 * const *planes,
+				       gsize frames, guint bits);
+gboolean loudness_analyzer_get_loudness (LoudnessAnalyzer *analyzer,
+					 gdouble *lufs);
+
+/* Decodes a file for loudness_read_soundcheck(). Filetype plugins
+ * provide one for each format they can decode. */
+typedef struct
+{
+    /* Open @filename for decoding and return a handle, the number
+     * of channels and the sample rate. Returns NULL on error. */
+    gpointer (* open) (const gchar *filename, guint *channels,
+		       guint *rate, GError **error);
+    /* Decode the next part of the file and pass the samples to
+     * @analyzer with one of the loudness_analyzer_add_...()
+     * functions. Returns 1 if there is more to decode, 0 at the end
+     * of the file and -1 on error. */
+    gint (* decode) (gpointer handle, LoudnessAnalyzer *analyzer,
+		     GError **error);
+    void (* close) (gpointer handle);
+} LoudnessDecoder;
+
+gboolean loudness_read_soundcheck (const LoudnessDecoder *decoder,
+				   const gchar *filename, Track *track,
+				   GError **error);
+#endif
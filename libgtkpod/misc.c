@@ -1196,6 +1196,28 @@ gint64 get_size_of_directory(const gchar *dir) {
     return tsize;
 }
 
+/**
+ * get_worker_thread_count
+ *
+ * Determine how many worker threads a parallel job should use. The
+ * integer preference @prefs_key overrides the default of one thread
+ * per online CPU if it is set to a value greater than 0.
+ */
+gint get_worker_thread_count(const gchar *prefs_key) {
+    gint count = 0;
+    glong cpus;
+
+    if (prefs_key)
+        count = prefs_get_int(prefs_key);
+
+    if (count <= 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        count = (cpus > 0) ? (gint) cpus : 1;
+    }
+
+    return count;
+}
+
 GtkBuilder *gtkpod_builder_xml_new(const gchar *filepath) {
     GtkBuilder *builder;
     GError *error = NULL;
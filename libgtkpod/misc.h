@@ -148,6 +148,7 @@ void check_db (iTunesDB *db);
 gboolean mkdirhier(const gchar *dirname, gboolean silent);
 gboolean mkdirhierfile(const gchar *filename);
 gint64 get_size_of_directory (const gchar *dir);
+gint get_worker_thread_count (const gchar *prefs_key);
 gchar *convert_filename (const gchar *filename);
 
 guint32 replaygain_to_soundcheck (gdouble gain);
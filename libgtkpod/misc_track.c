@@ -50,13 +50,77 @@
  |                                                                |
  \* ------------------------------------------------------------ */
 
+/* Number of tracks merged into the sha1 hash between statusbar updates */
+#define SHA1_BATCH_SIZE 20
+
+/* One track whose file is hashed on the thread pool */
+typedef struct {
+    Track *track;
+    gchar *filename; /* file to hash or NULL to hash on the main thread */
+    gchar *sha1_hash; /* cached hash on input, hash of @filename after */
+    gchar *sha1_signature; /* signature belonging to @sha1_hash */
+    gboolean hashed; /* @sha1_hash is valid */
+    gboolean done;
+} Sha1Job;
+
+typedef struct {
+    GMutex mutex;
+    GCond done_cond;
+    gboolean cancelled; /* skip jobs not yet started */
+} Sha1Pipeline;
+
+/* Thread pool function: validate or compute the hash of one file */
+static void sha1_job_run(gpointer data, gpointer user_data) {
+    Sha1Job *job = data;
+    Sha1Pipeline *pipeline = user_data;
+    gboolean cancelled;
+
+    g_mutex_lock(&pipeline->mutex);
+    cancelled = pipeline->cancelled;
+    g_mutex_unlock(&pipeline->mutex);
+
+    /* failures are left to the main thread which reports them */
+    if (!cancelled)
+        job->hashed = sha1_hash_on_filename_cached(job->filename, TRUE, &job->sha1_hash, &job->sha1_signature);
+
+    g_mutex_lock(&pipeline->mutex);
+    job->done = TRUE;
+    g_cond_broadcast(&pipeline->done_cond);
+    g_mutex_unlock(&pipeline->mutex);
+}
+
+/* Wait for @job to finish while keeping the GUI alive */
+static void sha1_job_wait(Sha1Pipeline *pipeline, Sha1Job *job) {
+    g_mutex_lock(&pipeline->mutex);
+    while (!job->done) {
+        gint64 end_time = g_get_monotonic_time() + 20 * G_TIME_SPAN_MILLISECOND;
+        g_cond_wait_until(&pipeline->done_cond, &pipeline->mutex, end_time);
+        if (!job->done) {
+            g_mutex_unlock(&pipeline->mutex);
+            while (widgets_blocked && gtk_events_pending())
+                gtk_main_iteration();
+            g_mutex_lock(&pipeline->mutex);
+        }
+    }
+    g_mutex_unlock(&pipeline->mutex);
+}
+
 /**
  * Register all tracks in the sha1 hash and remove duplicates (while
  * preserving playlists)
+ *
+ * The files are read and hashed on a thread pool ("sha1_threads"),
+ * the results are merged into the sha1 hash on the main thread in the
+ * order of the tracks. Hashing can be stopped with
+ * gtkpod_statusbar_cancel_progress(), in which case the remaining
+ * tracks are not registered.
  */
 void gp_sha1_hash_tracks_itdb(iTunesDB *itdb) {
-    gint ns, count;
+    gint ns, count, ticked, i;
     GList *gl;
+    Sha1Pipeline pipeline;
+    Sha1Job *jobs;
+    GThreadPool *pool;
 
     g_return_if_fail (itdb);
 
@@ -69,29 +133,93 @@ void gp_sha1_hash_tracks_itdb(iTunesDB *itdb) {
     block_widgets(); /* block widgets -- this might take a while,
      so we'll do refreshs */
     sha1_free(itdb); /* release sha1 hash */
-    count = 0;
-    /* populate the hash table */
-    gl = itdb->tracks;
-    while (gl) {
+
+    g_mutex_init(&pipeline.mutex);
+    g_cond_init(&pipeline.done_cond);
+    pipeline.cancelled = FALSE;
+    pool = g_thread_pool_new(sha1_job_run, &pipeline, get_worker_thread_count("sha1_threads"), FALSE, NULL);
+
+    /* snapshot the track list -- duplicates are removed from
+     itdb->tracks while merging */
+    jobs = g_new0(Sha1Job, ns);
+    for (gl = itdb->tracks, i = 0; gl && (i < ns); gl = gl->next, ++i) {
         Track *track = gl->data;
-        Track *oldtrack = sha1_track_exists_insert(itdb, track);
+        ExtraTrackData *etr = track->userdata;
+
+        jobs[i].track = track;
+        if (pool && etr)
+            jobs[i].filename = get_file_name_from_source(track, SOURCE_PREFER_LOCAL);
+        if (jobs[i].filename) {
+            jobs[i].sha1_hash = g_strdup(etr->sha1_hash);
+            jobs[i].sha1_signature = g_strdup(etr->sha1_signature);
+            g_thread_pool_push(pool, &jobs[i], NULL);
+        }
+    }
+    ns = i;
 
-        /* need to get next track now because it might be a duplicate and
-         thus be removed when we call gp_duplicate_remove() */
-        gl = gl->next;
+    gtkpod_statusbar_reset_progress(ns);
+    count = ticked = 0;
+    /* populate the hash table */
+    for (i = 0; i < ns; ++i) {
+        Sha1Job *job = &jobs[i];
+        Track *track = job->track;
+        Track *oldtrack;
+
+        if (gtkpod_statusbar_progress_cancelled())
+            break;
+
+        if (job->filename)
+            sha1_job_wait(&pipeline, job);
+
+        if (job->hashed) {
+            ExtraTrackData *etr = track->userdata;
+            g_free(etr->sha1_hash);
+            etr->sha1_hash = job->sha1_hash;
+            g_free(etr->sha1_signature);
+            etr->sha1_signature = job->sha1_signature;
+            job->sha1_hash = NULL;
+            job->sha1_signature = NULL;
+            oldtrack = sha1_track_exists_insert_hashed(itdb, track);
+        }
+        else {
+            /* no file or it could not be read on the thread pool */
+            oldtrack = sha1_track_exists_insert(itdb, track);
+        }
 
         if (oldtrack) {
             gp_duplicate_remove(oldtrack, track);
         }
 
         ++count;
-        if (((count % 20) == 1) || (count == ns)) { /* update for count == 1, 21, 41 ... and for count == n */
+        if (((count % SHA1_BATCH_SIZE) == 1) || (count == ns)) { /* update for count == 1, 21, 41 ... and for count == n */
             gtkpod_statusbar_message(ngettext ("Hashed %d of %d track.",
                     "Hashed %d of %d tracks.", ns), count, ns);
+            gtkpod_statusbar_increment_progress_ticks(count - ticked, NULL);
+            ticked = count;
             while (widgets_blocked && gtk_events_pending())
                 gtk_main_iteration();
         }
     }
+
+    if (count < ns) {
+        g_mutex_lock(&pipeline.mutex);
+        pipeline.cancelled = TRUE;
+        g_mutex_unlock(&pipeline.mutex);
+        gtkpod_statusbar_message(_("SHA1 hashing cancelled after %d of %d tracks."), count, ns);
+    }
+
+    if (pool)
+        g_thread_pool_free(pool, TRUE, TRUE);
+    for (i = 0; i < ns; ++i) {
+        g_free(jobs[i].filename);
+        g_free(jobs[i].sha1_hash);
+        g_free(jobs[i].sha1_signature);
+    }
+    g_free(jobs);
+    g_cond_clear(&pipeline.done_cond);
+    g_mutex_clear(&pipeline.mutex);
+
+    gtkpod_statusbar_reset_progress(100);
     gp_duplicate_remove(NULL, NULL); /* show info dialogue */
     release_widgets(); /* release widgets again */
 }
@@ -120,6 +248,7 @@ static void rm_sha1(gpointer track, gpointer user_data) {
     etr = ((Track *) track)->userdata;
     g_return_if_fail (etr);
     C_FREE (etr->sha1_hash);
+    C_FREE (etr->sha1_signature);
 }
 
 /**
@@ -267,6 +396,7 @@ void gp_duplicate_remove(Track *oldtrack, Track *track) {
                 g_free(oldetr->pc_path_utf8);
                 oldetr->pc_path_locale = g_strdup(etr->pc_path_locale);
                 oldetr->pc_path_utf8 = g_strdup(etr->pc_path_utf8);
+                gp_itdb_pc_path_locale_hash_update_track(oldtrack);
             }
         }
         if (itdb_playlist_contains_track(itdb_playlist_mpl(itdb), track)) { /* track is already added to memory -> replace with "oldtrack" */
@@ -345,8 +475,10 @@ void gp_itdb_hash(iTunesDB *itdb) {
  \* ------------------------------------------------------------ */
 
 /* Returns the track with the filename @name or NULL, if none can be
- * found. This function also works if @filename is on the iPod. */
+ * found. This function also works if @filename is on the iPod. Tracks
+ * are looked up in the iPod path hash or the locale path hash. */
 Track *gp_track_by_filename(iTunesDB *itdb, gchar *filename) {
+    gchar *mountpoint = NULL;
     gchar *musicdir = NULL;
     Track *result = NULL;
 
@@ -354,45 +486,31 @@ Track *gp_track_by_filename(iTunesDB *itdb, gchar *filename) {
     g_return_val_if_fail (filename, NULL);
 
     if (itdb->usertype & GP_ITDB_TYPE_IPOD) {
-        gchar *mountpoint = get_itdb_prefs_string(itdb, KEY_MOUNTPOINT);
+        mountpoint = get_itdb_prefs_string(itdb, KEY_MOUNTPOINT);
         g_return_val_if_fail (mountpoint, NULL);
         musicdir = itdb_get_music_dir(mountpoint);
         if (!musicdir) {
             /* FIXME: guess */
             musicdir = g_build_filename(mountpoint, "iPod_Control", "Music", NULL);
         }
-        g_free(mountpoint);
     }
     if ((itdb->usertype & GP_ITDB_TYPE_IPOD) && (musicdir != NULL) && (strncmp(filename, musicdir, strlen(musicdir))
             == 0)) { /* handle track on iPod (in music dir) */
-        GList *gl;
-        for (gl = itdb->tracks; gl && !result; gl = gl->next) {
-            Track *track = gl->data;
+        if (strncmp(filename, mountpoint, strlen(mountpoint)) == 0) {
+            const gchar *fname_i = filename + strlen(mountpoint);
             gchar *ipod_path;
-            g_return_val_if_fail (track, NULL);
-            ipod_path = itdb_filename_on_ipod(track);
-            if (ipod_path) {
-                if (strcasecmp(ipod_path, filename) == 0) {
-                    result = track;
-                }
-                g_free(ipod_path);
-            }
+            while (*fname_i == G_DIR_SEPARATOR)
+                ++fname_i;
+            ipod_path = g_strdup_printf("%c%s", G_DIR_SEPARATOR, fname_i);
+            itdb_filename_fs2ipod(ipod_path);
+            result = gp_itdb_ipod_path_hash_find_track(itdb, ipod_path);
+            g_free(ipod_path);
         }
     }
     else { /* handle track on local filesystem */
-        GList *gl;
-        for (gl = itdb->tracks; gl && !result; gl = gl->next) {
-            Track *track = gl->data;
-            ExtraTrackData *etr;
-            g_return_val_if_fail (track, NULL);
-            etr = track->userdata;
-            g_return_val_if_fail (etr, NULL);
-            if (etr->pc_path_locale) {
-                if (strcmp(etr->pc_path_locale, filename) == 0)
-                    result = track;
-            }
-        }
+        result = gp_itdb_pc_path_locale_hash_find_track(itdb, filename);
     }
+    g_free(mountpoint);
     g_free(musicdir);
     return result;
 }
@@ -663,6 +781,283 @@ GList *gp_itdb_pc_path_hash_find_tracks(iTunesDB *itdb, const gchar *filename) {
     return g_list_copy(tracks);
 }
 
+/* ------------------------------------------------------------ *\
+|                                                                |
+ |         functions for iPod path hashtable                      |
+ |                                                                |
+ \* ------------------------------------------------------------ */
+
+/* The iPod path hash maps the ipod_path of each track (with ASCII
+ * characters in lower case, as the iPod's file system does not care
+ * about case) to the track. It is only built once it is needed by
+ * gp_track_by_filename(). The key a track is hashed under is kept in
+ * etr->ipod_path_key, so the track can be removed even after its
+ * ipod_path changed. */
+
+/* Add track to the iPod path hash if the hash has been built. If more
+ * than one track uses the same path, the first one added is kept. */
+void gp_itdb_ipod_path_hash_add_track(Track *track) {
+    ExtraiTunesDBData *eitdb;
+    ExtraTrackData *etr;
+
+    g_return_if_fail (track);
+    etr = track->userdata;
+    g_return_if_fail (etr);
+    g_return_if_fail (track->itdb);
+    eitdb = track->itdb->userdata;
+    g_return_if_fail (eitdb);
+
+    if (!eitdb->ipod_path_hash || etr->ipod_path_key)
+        return;
+    if (!track->ipod_path || !*track->ipod_path)
+        return;
+
+    etr->ipod_path_key = g_ascii_strdown(track->ipod_path, -1);
+    if (!g_hash_table_lookup(eitdb->ipod_path_hash, etr->ipod_path_key))
+        g_hash_table_insert(eitdb->ipod_path_hash, g_strdup(etr->ipod_path_key), track);
+}
+
+/* Remove track from the iPod path hash */
+void gp_itdb_ipod_path_hash_remove_track(Track *track) {
+    ExtraiTunesDBData *eitdb;
+    ExtraTrackData *etr;
+
+    g_return_if_fail (track);
+    etr = track->userdata;
+    g_return_if_fail (etr);
+
+    if (!etr->ipod_path_key)
+        return;
+
+    g_return_if_fail (track->itdb);
+    eitdb = track->itdb->userdata;
+    g_return_if_fail (eitdb);
+
+    if (eitdb->ipod_path_hash && (g_hash_table_lookup(eitdb->ipod_path_hash, etr->ipod_path_key) == track))
+        g_hash_table_remove(eitdb->ipod_path_hash, etr->ipod_path_key);
+    g_free(etr->ipod_path_key);
+    etr->ipod_path_key = NULL;
+}
+
+/* Call after track->ipod_path of a track in the database has been
+ * changed */
+void gp_itdb_ipod_path_hash_update_track(Track *track) {
+    gp_itdb_ipod_path_hash_remove_track(track);
+    gp_itdb_ipod_path_hash_add_track(track);
+}
+
+/* free all memory associated with the ipod_path_hash */
+void gp_itdb_ipod_path_hash_destroy(iTunesDB *itdb) {
+    ExtraiTunesDBData *eitdb;
+    GList *gl;
+
+    g_return_if_fail (itdb);
+    eitdb = itdb->userdata;
+    g_return_if_fail (eitdb);
+
+    if (!eitdb->ipod_path_hash)
+        return;
+
+    for (gl = itdb->tracks; gl; gl = gl->next) {
+        Track *track = gl->data;
+        ExtraTrackData *etr = track->userdata;
+        if (etr) {
+            g_free(etr->ipod_path_key);
+            etr->ipod_path_key = NULL;
+        }
+    }
+    g_hash_table_destroy(eitdb->ipod_path_hash);
+    eitdb->ipod_path_hash = NULL;
+}
+
+/* (Re)build the iPod path hash of @itdb */
+static void ipod_path_hash_build(iTunesDB *itdb) {
+    ExtraiTunesDBData *eitdb = itdb->userdata;
+    GList *gl;
+
+    gp_itdb_ipod_path_hash_destroy(itdb);
+    eitdb->ipod_path_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (gl = itdb->tracks; gl; gl = gl->next)
+        gp_itdb_ipod_path_hash_add_track(gl->data);
+}
+
+/* ------------------------------------------------------------ *\
+|                                                                |
+ |         functions for locale path hashtable                    |
+ |                                                                |
+ \* ------------------------------------------------------------ */
+
+/* The locale path hash maps the pc_path_locale of each track to the
+ * list of tracks using it. Unlike pc_path_hash it does not depend on
+ * the charset a track was imported with. It is only built once it is
+ * needed by gp_track_by_filename(). The key a track is hashed under
+ * is kept in etr->pc_path_locale_key, so the track can be removed
+ * even after its pc_path_locale changed. */
+
+/* Add track to the locale path hash if the hash has been built */
+void gp_itdb_pc_path_locale_hash_add_track(Track *track) {
+    ExtraiTunesDBData *eitdb;
+    ExtraTrackData *etr;
+    GList *tracks;
+
+    g_return_if_fail (track);
+    etr = track->userdata;
+    g_return_if_fail (etr);
+    g_return_if_fail (track->itdb);
+    eitdb = track->itdb->userdata;
+    g_return_if_fail (eitdb);
+
+    if (!eitdb->pc_path_locale_hash || etr->pc_path_locale_key)
+        return;
+    if (!etr->pc_path_locale || !*etr->pc_path_locale)
+        return;
+
+    etr->pc_path_locale_key = g_strdup(etr->pc_path_locale);
+    tracks = g_hash_table_lookup(eitdb->pc_path_locale_hash, etr->pc_path_locale_key);
+    tracks = g_list_append(tracks, track);
+    g_hash_table_replace(eitdb->pc_path_locale_hash, g_strdup(etr->pc_path_locale_key), tracks);
+}
+
+/* Remove track from the locale path hash */
+void gp_itdb_pc_path_locale_hash_remove_track(Track *track) {
+    ExtraiTunesDBData *eitdb;
+    ExtraTrackData *etr;
+
+    g_return_if_fail (track);
+    etr = track->userdata;
+    g_return_if_fail (etr);
+
+    if (!etr->pc_path_locale_key)
+        return;
+
+    g_return_if_fail (track->itdb);
+    eitdb = track->itdb->userdata;
+    g_return_if_fail (eitdb);
+
+    if (eitdb->pc_path_locale_hash) {
+        GList *tracks = g_hash_table_lookup(eitdb->pc_path_locale_hash, etr->pc_path_locale_key);
+        tracks = g_list_remove(tracks, track);
+        if (tracks) /* still tracks left under this filename */
+            g_hash_table_replace(eitdb->pc_path_locale_hash, g_strdup(etr->pc_path_locale_key), tracks);
+        else
+            g_hash_table_remove(eitdb->pc_path_locale_hash, etr->pc_path_locale_key);
+    }
+    g_free(etr->pc_path_locale_key);
+    etr->pc_path_locale_key = NULL;
+}
+
+/* Call after etr->pc_path_locale of a track has been changed */
+void gp_itdb_pc_path_locale_hash_update_track(Track *track) {
+    g_return_if_fail (track);
+
+    /* not (yet) part of a database */
+    if (!track->itdb)
+        return;
+    gp_itdb_pc_path_locale_hash_remove_track(track);
+    gp_itdb_pc_path_locale_hash_add_track(track);
+}
+
+/* free all memory associated with the pc_path_locale_hash */
+void gp_itdb_pc_path_locale_hash_destroy(iTunesDB *itdb) {
+    ExtraiTunesDBData *eitdb;
+    GList *gl;
+
+    g_return_if_fail (itdb);
+    eitdb = itdb->userdata;
+    g_return_if_fail (eitdb);
+
+    if (!eitdb->pc_path_locale_hash)
+        return;
+
+    for (gl = itdb->tracks; gl; gl = gl->next) {
+        Track *track = gl->data;
+        ExtraTrackData *etr = track->userdata;
+        if (etr) {
+            g_free(etr->pc_path_locale_key);
+            etr->pc_path_locale_key = NULL;
+        }
+    }
+    g_hash_table_foreach(eitdb->pc_path_locale_hash, pc_path_hash_free_value, NULL);
+    g_hash_table_destroy(eitdb->pc_path_locale_hash);
+    eitdb->pc_path_locale_hash = NULL;
+}
+
+/* (Re)build the locale path hash of @itdb */
+static void pc_path_locale_hash_build(iTunesDB *itdb) {
+    ExtraiTunesDBData *eitdb = itdb->userdata;
+    GList *gl;
+
+    gp_itdb_pc_path_locale_hash_destroy(itdb);
+    eitdb->pc_path_locale_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (gl = itdb->tracks; gl; gl = gl->next)
+        gp_itdb_pc_path_locale_hash_add_track(gl->data);
+}
+
+/* Return the first track in @tracks whose pc_path_locale is @filename */
+static Track *pc_path_locale_match(GList *tracks, const gchar *filename) {
+    GList *gl;
+
+    for (gl = tracks; gl; gl = gl->next) {
+        Track *track = gl->data;
+        ExtraTrackData *etr = track->userdata;
+        if (etr && etr->pc_path_locale && (strcmp(etr->pc_path_locale, filename) == 0))
+            return track;
+    }
+    return NULL;
+}
+
+/* Return the first track with @filename (in the locale's encoding)
+ * or NULL */
+Track *gp_itdb_pc_path_locale_hash_find_track(iTunesDB *itdb, const gchar *filename) {
+    ExtraiTunesDBData *eitdb;
+    GList *tracks;
+    Track *track;
+
+    g_return_val_if_fail (itdb, NULL);
+    g_return_val_if_fail (filename, NULL);
+    eitdb = itdb->userdata;
+    g_return_val_if_fail (eitdb, NULL);
+
+    if (!eitdb->pc_path_locale_hash)
+        pc_path_locale_hash_build(itdb);
+
+    tracks = g_hash_table_lookup(eitdb->pc_path_locale_hash, filename);
+    track = pc_path_locale_match(tracks, filename);
+    if (tracks && !track) {
+        /* the path was changed without updating the hash */
+        pc_path_locale_hash_build(itdb);
+        tracks = g_hash_table_lookup(eitdb->pc_path_locale_hash, filename);
+        track = pc_path_locale_match(tracks, filename);
+    }
+    return track;
+}
+
+/* Return the track with @ipod_path (in the iPod's notation, e.g.
+ ":iPod_Control:Music:F00:ABCD.mp3", case does not matter) or NULL */
+Track *gp_itdb_ipod_path_hash_find_track(iTunesDB *itdb, const gchar *ipod_path) {
+    ExtraiTunesDBData *eitdb;
+    Track *track;
+    gchar *key;
+
+    g_return_val_if_fail (itdb, NULL);
+    g_return_val_if_fail (ipod_path, NULL);
+    eitdb = itdb->userdata;
+    g_return_val_if_fail (eitdb, NULL);
+
+    if (!eitdb->ipod_path_hash)
+        ipod_path_hash_build(itdb);
+
+    key = g_ascii_strdown(ipod_path, -1);
+    track = g_hash_table_lookup(eitdb->ipod_path_hash, key);
+    if (track && (!track->ipod_path || (g_ascii_strcasecmp(track->ipod_path, ipod_path) != 0))) {
+        /* the path was changed without updating the hash */
+        ipod_path_hash_build(itdb);
+        track = g_hash_table_lookup(eitdb->ipod_path_hash, key);
+    }
+    g_free(key);
+    return track;
+}
+
 /* ------------------------------------------------------------ *\
 |                                                                |
  |         functions to retrieve information from tracks          |
@@ -888,6 +1283,7 @@ gboolean track_copy_item(Track *frtrack, Track *totrack, T_item item) {
             if ((etotr->pc_path_locale == NULL) || (strcmp(efrtr->pc_path_locale, etotr->pc_path_locale) != 0)) {
                 g_free(etotr->pc_path_locale);
                 etotr->pc_path_locale = g_strdup(efrtr->pc_path_locale);
+                gp_itdb_pc_path_locale_hash_update_track(totrack);
                 changed = TRUE;
             }
         }
@@ -1757,12 +2153,16 @@ static void add_tracks_to_playlist(Playlist *pl, gchar *string, GList *tracks) {
 
 /* DND: add a glist of tracks to Playlist @pl */
 void add_trackglist_to_playlist(Playlist *pl, GList *tracks) {
+    gtkpod_freeze_tracks_added();
     add_tracks_to_playlist(pl, NULL, tracks);
+    gtkpod_thaw_tracks_added();
 }
 
 /* DND: add a list of tracks to Playlist @pl */
 void add_tracklist_to_playlist(Playlist *pl, gchar *string) {
+    gtkpod_freeze_tracks_added();
     add_tracks_to_playlist(pl, string, NULL);
+    gtkpod_thaw_tracks_added();
 }
 
 /* DND: add a list of files to Playlist @pl.
@@ -1792,6 +2192,7 @@ Playlist *add_text_plain_to_playlist(iTunesDB *itdb, Playlist *pl, gchar *str, g
     /*   printf("pl: %x, pl_pos: %d\n%s\n", pl, pl_pos, str);*/
 
     block_widgets();
+    gtkpod_freeze_tracks_added();
 
     files = g_strsplit(str, "\n", -1);
     if (files) {
@@ -1863,6 +2264,7 @@ Playlist *add_text_plain_to_playlist(iTunesDB *itdb, Playlist *pl, gchar *str, g
     /* display log of detected duplicates */
     gp_duplicate_remove(NULL, NULL);
 
+    gtkpod_thaw_tracks_added();
     release_widgets();
 
     if (pl)
@@ -48,6 +48,16 @@ void gp_itdb_pc_path_hash_destroy (ExtraiTunesDBData *eitdb);
 void gp_itdb_pc_path_hash_add_track (Track *track);
 void gp_itdb_pc_path_hash_remove_track (Track *track);
 GList *gp_itdb_pc_path_hash_find_tracks (iTunesDB *itdb, const gchar *filename);
+void gp_itdb_ipod_path_hash_destroy (iTunesDB *itdb);
+void gp_itdb_ipod_path_hash_add_track (Track *track);
+void gp_itdb_ipod_path_hash_remove_track (Track *track);
+void gp_itdb_ipod_path_hash_update_track (Track *track);
+Track *gp_itdb_ipod_path_hash_find_track (iTunesDB *itdb, const gchar *ipod_path);
+void gp_itdb_pc_path_locale_hash_destroy (iTunesDB *itdb);
+void gp_itdb_pc_path_locale_hash_add_track (Track *track);
+void gp_itdb_pc_path_locale_hash_remove_track (Track *track);
+void gp_itdb_pc_path_locale_hash_update_track (Track *track);
+Track *gp_itdb_pc_path_locale_hash_find_track (iTunesDB *itdb, const gchar *filename);
 GList *gp_itdb_find_same_tracks (iTunesDB *itdb, Track *track);
 GList *gp_itdb_find_same_tracks_in_itdbs (Track *track);
 GList *gp_itdb_find_same_tracks_in_local_itdbs (Track *track);
@@ -32,6 +32,10 @@
  * The prefs module should be thread safe. The hash table is locked
  * before each read or write access.
  *
+ * Interned keys (PrefsKey) are read without taking the lock: each key
+ * points to an immutable snapshot of its parsed value, which is
+ * replaced atomically whenever the key is changed in the table.
+ *
  * The temp_prefs module is not thread-safe. If necessary a locking
  * mechanism can be implemented.
  *
@@ -132,6 +136,131 @@ static void unlock_prefs_table() {
     _unlock_mutex();
 }
 
+/* Parsed value of an interned key. Never changed once published. */
+typedef struct {
+    gboolean exists;
+    gchar *string; /* to notice changes of non-numeric values */
+    gint int_value;
+    gint64 int64_value;
+    gdouble double_value;
+} PrefsValue;
+
+typedef struct {
+    gulong id;
+    PrefsKeyNotify func;
+    gpointer user_data;
+} PrefsKeyHook;
+
+struct _PrefsKey {
+    gchar *name;
+    PrefsValue *value; /* current snapshot, read atomically */
+    GList *hooks; /* PrefsKeyHook */
+};
+
+/* Interned keys by name, protected by the prefs table lock. Keys are
+ * never freed. */
+static GHashTable *prefs_keys = NULL;
+/* Snapshots replaced while readers might still use them. They are
+ * only freed on shutdown -- values of interned keys are changed by
+ * the user, so there are few of them. */
+static GSList *prefs_retired_values = NULL;
+static gulong prefs_key_hook_id = 0;
+
+static PrefsValue *prefs_value_new(const gchar *string) {
+    PrefsValue *value = g_new0(PrefsValue, 1);
+
+    if (string) {
+        value->exists = TRUE;
+        value->string = g_strdup(string);
+        value->int_value = atoi(string);
+        value->int64_value = g_ascii_strtoull(string, NULL, 10);
+        value->double_value = g_ascii_strtod(string, NULL);
+    }
+    return value;
+}
+
+static void prefs_value_free(PrefsValue *value) {
+    g_free(value->string);
+    g_free(value);
+}
+
+/* Bring the snapshot of @pkey up to date with the prefs table. If the
+ * value has changed, @pkey is prepended to @changed, which is
+ * returned. Called with the prefs table locked. */
+static GSList *prefs_key_update_unlocked(PrefsKey *pkey, GSList *changed) {
+    PrefsValue *old_value = pkey->value;
+    PrefsValue *value;
+
+    value = prefs_value_new(prefs_table ? g_hash_table_lookup(prefs_table, pkey->name) : NULL);
+    if (g_strcmp0(value->string, old_value->string) == 0) {
+        prefs_value_free(value);
+        return changed;
+    }
+
+    g_atomic_pointer_set(&pkey->value, value);
+    prefs_retired_values = g_slist_prepend(prefs_retired_values, old_value);
+
+    if (pkey->hooks)
+        changed = g_slist_prepend(changed, pkey);
+    return changed;
+}
+
+/* Update the snapshot of interned key @key after it has been set or
+ * removed. Called with the prefs table locked. */
+static GSList *prefs_keys_changed_unlocked(const gchar *key) {
+    PrefsKey *pkey;
+
+    if (!prefs_keys)
+        return NULL;
+
+    pkey = g_hash_table_lookup(prefs_keys, key);
+    if (!pkey)
+        return NULL;
+    return prefs_key_update_unlocked(pkey, NULL);
+}
+
+/* Update the snapshots of all interned keys, after several keys may
+ * have changed. Called with the prefs table locked. */
+static GSList *prefs_keys_refresh_unlocked(void) {
+    GHashTableIter iter;
+    gpointer pkey;
+    GSList *changed = NULL;
+
+    if (!prefs_keys)
+        return NULL;
+
+    g_hash_table_iter_init(&iter, prefs_keys);
+    while (g_hash_table_iter_next(&iter, NULL, &pkey))
+        changed = prefs_key_update_unlocked(pkey, changed);
+    return changed;
+}
+
+/* Call the notify functions of the keys in @changed, which is freed.
+ * Must be called with the prefs table unlocked. */
+static void prefs_keys_notify(GSList *changed) {
+    GSList *gsl;
+
+    for (gsl = changed; gsl; gsl = gsl->next) {
+        PrefsKey *pkey = gsl->data;
+        GList *hooks, *gl;
+
+        /* call a copy of the hooks, so that they may be removed by
+         * the notify functions */
+        lock_prefs_table();
+        hooks = g_list_copy(pkey->hooks);
+        for (gl = hooks; gl; gl = gl->next)
+            gl->data = g_memdup(gl->data, sizeof(PrefsKeyHook));
+        unlock_prefs_table();
+
+        for (gl = hooks; gl; gl = gl->next) {
+            PrefsKeyHook *hook = gl->data;
+            hook->func(pkey, hook->user_data);
+        }
+        g_list_free_full(hooks, g_free);
+    }
+    g_slist_free(changed);
+}
+
 /* Set default preferences */
 static void set_default_preferences() {
     int i;
@@ -159,6 +288,42 @@ static void set_default_preferences() {
      */
     prefs_set_int("file_saving_threshold", 40);
 
+    /*
+     * Number of threads reading track information when adding
+     * directories. 0 means one thread per CPU.
+     */
+    prefs_set_int("import_threads", 0);
+
+    /*
+     * Number of threads computing SHA1 checksums for duplicate
+     * detection. 0 means one thread per CPU.
+     */
+    prefs_set_int("sha1_threads", 0);
+
+    /*
+     * Number of threads decoding cover art thumbnails for the
+     * cover displays. 0 means one thread per CPU.
+     */
+    prefs_set_int("thumbnail_threads", 0);
+
+    /*
+     * Number of threads reading directories when syncing playlists
+     * with directories. 0 means one thread per CPU.
+     */
+    prefs_set_int("sync_threads", 0);
+
+    /*
+     * Number of tracks whose volume is normalized at the same time.
+     * 0 means one thread per CPU.
+     */
+    prefs_set_int("normalization_threads", 0);
+
+    /*
+     * Maximum size in MB of the cover art thumbnails kept on disk
+     * between sessions. 0 disables the disk cache.
+     */
+    prefs_set_int("thumbnail_cache_size", 128);
+
     str = g_build_filename(get_script_dir(), CONVERT_TO_MP3_SCRIPT, NULL);
     prefs_set_string("path_conv_mp3", str);
     g_free(str);
@@ -239,6 +404,7 @@ static void set_default_preferences() {
     prefs_set_int("display_toolbar", TRUE);
     prefs_set_int("toolbar_style", GTK_TOOLBAR_BOTH);
     prefs_set_int("sha1", TRUE);
+    prefs_set_int("sha1_mode", 0);
     prefs_set_int("file_dialog_details_expanded", FALSE);
 
     /* Set last browsed directory */
@@ -842,6 +1008,8 @@ static void cleanup_keys() {
 
 /* Initialize the prefs table and read configuration */
 void prefs_init(int argc, char *argv[]) {
+    GSList *changed;
+
     lock_prefs_table();
 
     /* Create the prefs hash table */
@@ -860,6 +1028,12 @@ void prefs_init(int argc, char *argv[]) {
 
     /* Handle the results of command line parsing */
     handle_command_line_options();
+
+    /* Keys interned before the table was read */
+    lock_prefs_table();
+    changed = prefs_keys_refresh_unlocked();
+    unlock_prefs_table();
+    prefs_keys_notify(changed);
 }
 
 /* Delete the hash table */
@@ -875,6 +1049,9 @@ void prefs_shutdown() {
     g_hash_table_destroy(prefs_table);
     prefs_table = NULL;
 
+    g_slist_free_full(prefs_retired_values, (GDestroyNotify) prefs_value_free);
+    prefs_retired_values = NULL;
+
     unlock_prefs_table();
 
     /* We can't free the prefs_table_mutex in a thread-safe way */
@@ -1015,6 +1192,8 @@ gboolean temp_prefs_subkey_exists(TempPrefs *temp_prefs, const gchar *subkey) {
 
 /* Remove all keys that start with @subkey */
 void prefs_flush_subkey(const gchar *subkey) {
+    GSList *changed;
+
     lock_prefs_table();
 
     if (!prefs_table) {
@@ -1023,14 +1202,18 @@ void prefs_flush_subkey(const gchar *subkey) {
     }
 
     g_hash_table_foreach_remove(prefs_table, match_subkey, (gchar *) subkey);
+    changed = prefs_keys_refresh_unlocked();
 
     unlock_prefs_table();
+
+    prefs_keys_notify(changed);
 }
 
 /* Rename all keys that start with @subkey_old in such a way that they
  start with @subkey_new */
 void prefs_rename_subkey(const gchar *subkey_old, const gchar *subkey_new) {
     struct sub_data sub_data;
+    GSList *changed;
 
     g_return_if_fail (subkey_old);
     g_return_if_fail (subkey_new);
@@ -1052,8 +1235,11 @@ void prefs_rename_subkey(const gchar *subkey_old, const gchar *subkey_new) {
     }
 
     temp_prefs_destroy(sub_data.temp_prefs);
+    changed = prefs_keys_refresh_unlocked();
 
     unlock_prefs_table();
+
+    prefs_keys_notify(changed);
 }
 
 /* Rename all keys that start with @subkey_old in such a way that they
@@ -1077,11 +1263,137 @@ void temp_prefs_rename_subkey(TempPrefs *temp_prefs, const gchar *subkey_old, co
     temp_prefs_destroy(sub_data.temp_prefs);
 }
 
+/* Functions for interned pref keys */
+
+/* Get the interned key for @key. The key is never freed, so the
+ * result is best kept in a static variable. */
+PrefsKey *prefs_key_intern(const gchar *key) {
+    PrefsKey *pkey;
+
+    g_return_val_if_fail (key, NULL);
+
+    lock_prefs_table();
+
+    if (!prefs_keys)
+        prefs_keys = g_hash_table_new(g_str_hash, g_str_equal);
+
+    pkey = g_hash_table_lookup(prefs_keys, key);
+    if (!pkey) {
+        pkey = g_new0(PrefsKey, 1);
+        pkey->name = g_strdup(key);
+        pkey->value = prefs_value_new(prefs_table ? g_hash_table_lookup(prefs_table, key) : NULL);
+        g_hash_table_insert(prefs_keys, pkey->name, pkey);
+    }
+
+    unlock_prefs_table();
+
+    return pkey;
+}
+
+/* Same as prefs_key_intern() for numbered keys */
+PrefsKey *prefs_key_intern_index(const gchar *key, const guint index) {
+    gchar *full_key; /* Complete numbered key */
+    PrefsKey *pkey;
+
+    full_key = create_full_key(key, index);
+    pkey = prefs_key_intern(full_key);
+
+    g_free(full_key);
+
+    return pkey;
+}
+
+const gchar *prefs_key_get_name(PrefsKey *pkey) {
+    g_return_val_if_fail (pkey, NULL);
+
+    return pkey->name;
+}
+
+/* The following functions neither lock nor allocate and may be used
+ * from any thread. */
+
+gboolean prefs_key_exists(PrefsKey *pkey) {
+    const PrefsValue *value;
+
+    g_return_val_if_fail (pkey, FALSE);
+
+    value = g_atomic_pointer_get(&pkey->value);
+    return value->exists;
+}
+
+gint prefs_key_get_int(PrefsKey *pkey) {
+    const PrefsValue *value;
+
+    g_return_val_if_fail (pkey, 0);
+
+    value = g_atomic_pointer_get(&pkey->value);
+    return value->int_value;
+}
+
+gint64 prefs_key_get_int64(PrefsKey *pkey) {
+    const PrefsValue *value;
+
+    g_return_val_if_fail (pkey, 0);
+
+    value = g_atomic_pointer_get(&pkey->value);
+    return value->int64_value;
+}
+
+gdouble prefs_key_get_double(PrefsKey *pkey) {
+    const PrefsValue *value;
+
+    g_return_val_if_fail (pkey, 0);
+
+    value = g_atomic_pointer_get(&pkey->value);
+    return value->double_value;
+}
+
+/* Have @func called whenever the value of @pkey changes. @func is
+ * called in the thread that changed the value, after the new value
+ * has been published. Returns an id for prefs_key_remove_notify(). */
+gulong prefs_key_add_notify(PrefsKey *pkey, PrefsKeyNotify func, gpointer user_data) {
+    PrefsKeyHook *hook;
+    gulong id;
+
+    g_return_val_if_fail (pkey, 0);
+    g_return_val_if_fail (func, 0);
+
+    hook = g_new0(PrefsKeyHook, 1);
+    hook->func = func;
+    hook->user_data = user_data;
+
+    lock_prefs_table();
+    id = hook->id = ++prefs_key_hook_id;
+    pkey->hooks = g_list_append(pkey->hooks, hook);
+    unlock_prefs_table();
+
+    return id;
+}
+
+void prefs_key_remove_notify(PrefsKey *pkey, gulong id) {
+    GList *gl;
+
+    g_return_if_fail (pkey);
+
+    lock_prefs_table();
+    for (gl = pkey->hooks; gl; gl = gl->next) {
+        PrefsKeyHook *hook = gl->data;
+        if (hook->id == id) {
+            pkey->hooks = g_list_delete_link(pkey->hooks, gl);
+            g_free(hook);
+            break;
+        }
+    }
+    unlock_prefs_table();
+}
+
 /* Functions for non-numbered pref keys */
 
 /* Set a string value with the given key, or remove key if @value is
  NULL */
 void prefs_set_string(const gchar *key, const gchar *value) {
+    GSList *changed;
+
     g_return_if_fail (key);
 
     lock_prefs_table();
@@ -1095,13 +1407,17 @@ void prefs_set_string(const gchar *key, const gchar *value) {
         g_hash_table_insert(prefs_table, g_strdup(key), g_strdup(value));
     else
         g_hash_table_remove(prefs_table, key);
+    changed = prefs_keys_changed_unlocked(key);
 
     unlock_prefs_table();
+
+    prefs_keys_notify(changed);
 }
 
 /* Set a key value to a given integer */
 void prefs_set_int(const gchar *key, const gint value) {
     gchar *strvalue; /* String value converted from integer */
+    GSList *changed;
 
     lock_prefs_table();
 
@@ -1112,13 +1428,17 @@ void prefs_set_int(const gchar *key, const gint value) {
 
     strvalue = g_strdup_printf("%i", value);
     g_hash_table_insert(prefs_table, g_strdup(key), strvalue);
+    changed = prefs_keys_changed_unlocked(key);
 
     unlock_prefs_table();
+
+    prefs_keys_notify(changed);
 }
 
 /* Set a key to an int64 value */
 void prefs_set_int64(const gchar *key, const gint64 value) {
     gchar *strvalue; /* String value converted from int64 */
+    GSList *changed;
 
     lock_prefs_table();
 
@@ -1129,12 +1449,16 @@ void prefs_set_int64(const gchar *key, const gint64 value) {
 
     strvalue = g_strdup_printf("%" G_GINT64_FORMAT, value);
     g_hash_table_insert(prefs_table, g_strdup(key), strvalue);
+    changed = prefs_keys_changed_unlocked(key);
 
     unlock_prefs_table();
+
+    prefs_keys_notify(changed);
 }
 
 void prefs_set_double(const gchar *key, gdouble value) {
     gchar *strvalue; /* String value converted from integer */
+    GSList *changed;
 
     lock_prefs_table();
 
@@ -1145,8 +1469,11 @@ void prefs_set_double(const gchar *key, gdouble value) {
 
     strvalue = g_strdup_printf("%f", value);
     g_hash_table_insert(prefs_table, g_strdup(key), strvalue);
+    changed = prefs_keys_changed_unlocked(key);
 
     unlock_prefs_table();
+
+    prefs_keys_notify(changed);
 }
 
 /* Get a string value associated with a key. Free returned string. */
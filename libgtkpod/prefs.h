@@ -138,6 +138,23 @@ gdouble prefs_get_double_index(const gchar *key,
 			       guint index);
 gboolean prefs_get_double_value_index(const gchar *key, guint index,
 				      gdouble *value);
+/* Interned keys for code reading preferences frequently, e.g. per
+ * row of a view. Reading their values needs neither locks nor
+ * allocations. */
+typedef struct _PrefsKey PrefsKey;
+typedef void (*PrefsKeyNotify) (PrefsKey *pkey, gpointer user_data);
+
+PrefsKey *prefs_key_intern (const gchar *key);
+PrefsKey *prefs_key_intern_index (const gchar *key, const guint index);
+const gchar *prefs_key_get_name (PrefsKey *pkey);
+gboolean prefs_key_exists (PrefsKey *pkey);
+gint prefs_key_get_int (PrefsKey *pkey);
+gint64 prefs_key_get_int64 (PrefsKey *pkey);
+gdouble prefs_key_get_double (PrefsKey *pkey);
+gulong prefs_key_add_notify (PrefsKey *pkey, PrefsKeyNotify func,
+			     gpointer user_data);
+void prefs_key_remove_notify (PrefsKey *pkey, gulong id);
+
 /* Special functions */
 TempPrefs *prefs_create_subset (const gchar *subkey);
 void prefs_flush_subkey (const gchar *subkey);
@@ -43,37 +43,40 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && ((__GNUC__ > 4) || \
+			    ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))))
+#  define SHA1_HAVE_SHANI 1
+#  include <cpuid.h>
+#  include <immintrin.h>
+#  define SHA1_CPUID_SSSE3  (1 << 9)	/* cpuid 1, ecx */
+#  define SHA1_CPUID_SSE4_1 (1 << 19)	/* cpuid 1, ecx */
+#  define SHA1_CPUID_SHA    (1 << 29)	/* cpuid 7, ebx */
+#endif
 
-typedef guint32 chunk;
-union _block
-{
-   guint8 charblock[64];
-   chunk chunkblock[16];
-};
-typedef union _block block;
-
-union _hblock
-{
-   guint8 charblock[20];
-   chunk chunkblock[5];
-};
-typedef union _hblock hblock;
+/* sha1_blocks_func - feed @nblocks consecutive 64 byte blocks
+ * starting at @data into the state @H */
+typedef void (*sha1_blocks_func)(guint32 H[5], const guint8 *data,
+				 gsize nblocks);
 
-struct _sha1
+/* incremental SHA1 computation */
+struct _sha1_context
 {
-   block *blockdata;
-   hblock *H;
+   guint32 H[5];
+   guint8 blockdata[64];
+   guint64 len;			/* number of bytes hashed so far */
+   guint fill;			/* number of bytes in blockdata */
 };
-typedef struct _sha1 sha1;
+typedef struct _sha1_context sha1_context;
 
-static guint8 *sha1_hash(const guint8 * text, guint32 len);
-static void process_block_sha1(sha1 * message);
-
-#if BYTE_ORDER == LITTLE_ENDIAN
-static void little_endian(hblock * stupidblock, int blocks);
-#endif
+static void sha1_hash(const guint8 *text, guint32 len, guint8 digest[20]);
+static void sha1_init(sha1_context *ctx);
+static void sha1_update(sha1_context *ctx, const guint8 *data, gsize len);
+static void sha1_final(sha1_context *ctx, guint8 digest[20]);
 
 /**
  * Create and manage a string hash for files on disk
@@ -88,6 +91,14 @@ static void little_endian(hblock * stupidblock, int blocks);
 #define NR_PATH_MAX_BLOCKS 4
 #define PATH_MAX_SHA1 4096
 
+/**
+ * SHA1_SAMPLE_SIZE
+ * Number of bytes read from the start, the middle and the end of a
+ * file in SHA1_MODE_SAMPLED. Files of up to three times this size
+ * are hashed completely.
+ */
+#define SHA1_SAMPLE_SIZE 65536
+
 /* Set up or destory the sha1 hash table */
 void setup_sha1()
 {
@@ -129,13 +140,14 @@ get_filesize_for_file_descriptor(FILE *fp)
 }
 
 /**
- * sha1_hash_on_file - read PATH_MAX_SHA1 * NR_PATH_MAX_BLOCKS bytes
+ * sha1_hash_on_file - SHA1_MODE_QUICK:
+ * read PATH_MAX_SHA1 * NR_PATH_MAX_BLOCKS bytes
  * from the file and ask sha1 for a hash of it, convert this hash to a
  * string of hex output @fp - an open file descriptor to read from
  * Returns - A Hash String - you handle memory returned
  */
 static gchar *
-sha1_hash_on_file(FILE * fp)
+sha1_hash_on_file(FILE * fp, gboolean silent)
 {
    gchar *result = NULL;
 
@@ -151,7 +163,7 @@ sha1_hash_on_file(FILE * fp)
        if(fsize > 0)
        {
 	   guint32 fsize_normal;
-	   guint8 *hash = NULL;
+	   guint8 hash[20];
 	   int bread = 0, x = 0, last = 0;
 	   guchar file_chunk[chunk_size + sizeof(int)];
 
@@ -167,16 +179,13 @@ sha1_hash_on_file(FILE * fp)
 			    chunk_size, fp);
 
 	   /* create hash from our data */
-	   hash = sha1_hash(file_chunk, (bread + sizeof(int)));
+	   sha1_hash(file_chunk, (bread + sizeof(int)), hash);
 
 	   /* put it in a format we like */
 	   for (x = 0; x < 20; x++)
 	       last += snprintf(&result[last], 4, "%02x", hash[x]);
-
-	   /* free the hash value sha1_hash gave us */
-	   g_free(hash);
        }
-       else
+       else if (!silent)
        {
            gtkpod_warning(_("Hashed file is 0 bytes long\n"));
        }
@@ -184,41 +193,165 @@ sha1_hash_on_file(FILE * fp)
    return (result);
 }
 
+/**
+ * sha1_digest_to_string - convert a 20 byte digest into a string of
+ * hex output
+ * Returns - A Hash String - you handle memory returned
+ */
+static gchar *
+sha1_digest_to_string(const guint8 *digest)
+{
+   gchar *result = g_malloc0(sizeof(gchar) * 41);
+   int x, last = 0;
+
+   for (x = 0; x < 20; x++)
+       last += snprintf(&result[last], 4, "%02x", digest[x]);
+   return result;
+}
+
+/**
+ * sha1_update_from_file - feed @len bytes starting at @offset of
+ * @fp into @ctx
+ * Returns - FALSE if the data could not be read completely
+ */
+static gboolean
+sha1_update_from_file(sha1_context *ctx, FILE *fp, guint64 offset,
+		      guint64 len, guchar *buf, gsize buf_size)
+{
+   if (fseeko(fp, (off_t)offset, SEEK_SET) != 0)
+       return FALSE;
+
+   while (len > 0)
+   {
+       gsize bread = fread(buf, sizeof(guchar), MIN(len, buf_size), fp);
+       if (bread == 0)
+	   return FALSE;
+       sha1_update(ctx, buf, bread);
+       len -= bread;
+   }
+   return TRUE;
+}
+
+/**
+ * sha1_hash_on_file_strong - SHA1_MODE_SAMPLED and SHA1_MODE_FULL:
+ * hash the size of the file followed by either its complete content
+ * or SHA1_SAMPLE_SIZE bytes from its start, middle and end.
+ * Sampling the end as well catches tracks which only differ in
+ * their trailing tags or audio data.
+ * @fp - an open file descriptor to read from
+ * Returns - A Hash String - you handle memory returned
+ */
+static gchar *
+sha1_hash_on_file_strong(FILE *fp, Sha1Mode mode, gboolean silent)
+{
+   gchar *result = NULL;
+   struct stat stat_info;
+   guint64 fsize;
+
+   if (!fp || (fstat(fileno(fp), &stat_info) != 0))
+       return NULL;
+
+   fsize = stat_info.st_size;
+   if (fsize > 0)
+   {
+       sha1_context ctx;
+       guint64 fsize_normal = GUINT64_TO_LE (fsize);
+       guchar *buf = g_malloc(SHA1_SAMPLE_SIZE);
+       guint8 digest[20];
+       gboolean ok;
+
+       sha1_init(&ctx);
+       sha1_update(&ctx, (const guint8 *)&fsize_normal, sizeof(guint64));
+
+       if ((mode == SHA1_MODE_FULL) || (fsize <= 3 * SHA1_SAMPLE_SIZE))
+       {
+	   ok = sha1_update_from_file(&ctx, fp, 0, fsize,
+				      buf, SHA1_SAMPLE_SIZE);
+       }
+       else
+       {
+	   ok = sha1_update_from_file(&ctx, fp, 0, SHA1_SAMPLE_SIZE,
+				      buf, SHA1_SAMPLE_SIZE)
+	       && sha1_update_from_file(&ctx, fp,
+					(fsize - SHA1_SAMPLE_SIZE) / 2,
+					SHA1_SAMPLE_SIZE,
+					buf, SHA1_SAMPLE_SIZE)
+	       && sha1_update_from_file(&ctx, fp,
+					fsize - SHA1_SAMPLE_SIZE,
+					SHA1_SAMPLE_SIZE,
+					buf, SHA1_SAMPLE_SIZE);
+       }
+       g_free(buf);
+
+       sha1_final(&ctx, digest);
+       if (ok)
+	   result = sha1_digest_to_string(digest);
+   }
+   else if (!silent)
+   {
+       gtkpod_warning(_("Hashed file is 0 bytes long\n"));
+   }
+   return result;
+}
+
 /**
  * Generate a unique hash for the Track passed in
  * @s - The Track data structure, we want to hash based on the file on disk
+ * @validate - check that the cached hash of @s still belongs to the
+ * file on disk and recompute it if the file has changed since
  * Returns - an SHA1 hash in string format, is the hex output from the hash
  */
 static gchar *
-sha1_hash_track(Track * s)
+sha1_hash_track(Track * s, gboolean validate)
 {
    ExtraTrackData *etr;
-   gchar *result = NULL;
    gchar *filename;
+   gchar *oldhash;
 
    g_return_val_if_fail (s, NULL);
    etr = s->userdata;
    g_return_val_if_fail (etr, NULL);
 
-   if (etr->sha1_hash != NULL)
-   {
-       result = g_strdup(etr->sha1_hash);
+   if (etr->sha1_hash != NULL && !validate)
+       return g_strdup(etr->sha1_hash);
+
+   filename = get_file_name_from_source (s, SOURCE_PREFER_LOCAL);
+   if (!filename)
+   {   /* can't check -- trust the cached value */
+       return g_strdup(etr->sha1_hash);
    }
-   else
-   {
-       filename = get_file_name_from_source (s, SOURCE_PREFER_LOCAL);
-       if (filename)
-       {
-	   result = sha1_hash_on_filename (filename, FALSE);
-	   g_free(filename);
-       }
+
+   oldhash = g_strdup (etr->sha1_hash);
+   sha1_hash_on_filename_cached (filename, FALSE,
+				 &etr->sha1_hash, &etr->sha1_signature);
+   g_free (filename);
+
+   if (oldhash && s->itdb &&
+       (!etr->sha1_hash || (strcmp (oldhash, etr->sha1_hash) != 0)))
+   {   /* the file has changed -- don't leave the old value behind in
+	  the hash table */
+       ExtraiTunesDBData *eitdb = s->itdb->userdata;
+       if (eitdb && eitdb->sha1hash &&
+	   (g_hash_table_lookup (eitdb->sha1hash, oldhash) == s))
+	   g_hash_table_remove (eitdb->sha1hash, oldhash);
    }
-   return (result);
+   g_free (oldhash);
+
+   return g_strdup (etr->sha1_hash);
 }
 
 
-/* @silent: don't print any warning */
+/* Hash @name using the mode selected in the preferences.
+ * @silent: don't print any warning */
 gchar *sha1_hash_on_filename (gchar *name, gboolean silent)
+{
+    return sha1_hash_on_filename_with_mode (name, silent,
+					    prefs_get_int("sha1_mode"));
+}
+
+/* @silent: don't print any warning */
+gchar *sha1_hash_on_filename_with_mode (gchar *name, gboolean silent,
+					Sha1Mode mode)
 {
     gchar *result = NULL;
 
@@ -238,13 +371,96 @@ gchar *sha1_hash_on_filename (gchar *name, gboolean silent)
 	}
 	else
 	{
-	    result = sha1_hash_on_file (fpit);
+	    if ((mode == SHA1_MODE_SAMPLED) || (mode == SHA1_MODE_FULL))
+		result = sha1_hash_on_file_strong (fpit, mode, silent);
+	    else
+		result = sha1_hash_on_file (fpit, silent);
 	    fclose (fpit);
 	}
     }
     return result;
 }
 
+/**
+ * Make sure that *@hash is the hash of @name. *@hash and *@signature
+ * are the cached hash of @name and the signature (see
+ * sha1_file_signature()) it was computed with, both may be NULL.
+ * The cached hash is kept if the signature of @name is still the
+ * same, otherwise @name is hashed again and *@hash and *@signature
+ * are replaced. This function does not touch any track or preference
+ * other than "sha1_mode" and may be called from worker threads.
+ * @silent: don't print any warning
+ * Returns - TRUE if *@hash is valid, FALSE if @name could not be
+ * hashed (*@hash is set to NULL in that case)
+ */
+gboolean sha1_hash_on_filename_cached (gchar *name, gboolean silent,
+				       gchar **hash, gchar **signature)
+{
+    gchar *new_signature, *new_hash;
+
+    g_return_val_if_fail (name, FALSE);
+    g_return_val_if_fail (hash, FALSE);
+    g_return_val_if_fail (signature, FALSE);
+
+    new_signature = sha1_file_signature (name);
+    if (*hash)
+    {
+	gboolean valid;
+
+	if (!new_signature)  /* can't check -- trust the cached value */
+	    valid = TRUE;
+	else if (*signature)
+	    valid = (strcmp (new_signature, *signature) == 0);
+	else  /* hashes without signature predate the stronger modes */
+	    valid = (prefs_get_int("sha1_mode") == SHA1_MODE_QUICK);
+
+	if (valid)
+	{
+	    g_free (new_signature);
+	    return TRUE;
+	}
+    }
+
+    new_hash = sha1_hash_on_filename (name, silent);
+    if (!new_hash)
+    {
+	g_free (new_signature);
+	new_signature = NULL;
+    }
+    g_free (*hash);
+    *hash = new_hash;
+    g_free (*signature);
+    *signature = new_signature;
+
+    return (new_hash != NULL);
+}
+
+/**
+ * Describe the file a hash is computed from: the hash mode in use,
+ * size, modification time and inode of the file, and its path. As
+ * long as the signature of a file is unchanged the hash stored along
+ * with it can be reused without reading the file again.
+ * Returns - the signature or NULL if @name can't be stat()ed - you
+ * handle memory returned
+ */
+gchar *sha1_file_signature (gchar *name)
+{
+    struct stat stat_info;
+
+    g_return_val_if_fail (name, NULL);
+
+    if (g_stat (name, &stat_info) != 0)
+	return NULL;
+
+    return g_strdup_printf ("%d:%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT
+			    ":%" G_GUINT64_FORMAT ":%s",
+			    prefs_get_int("sha1_mode"),
+			    (guint64) stat_info.st_size,
+			    (gint64) stat_info.st_mtime,
+			    (guint64) stat_info.st_ino,
+			    name);
+}
+
 
 /**
  * Free up the dynamically allocated memory in @itdb's hash table
@@ -275,9 +491,11 @@ void sha1_free (iTunesDB *itdb)
  * Check to see if a track has already been added to the ipod
  * @s - the Track we want to know about. If the track does not exist, it
  * is inserted into the hash.
+ * @validate - see sha1_hash_track()
  * Returns a pointer to the duplicate track.
  */
-Track *sha1_track_exists_insert (iTunesDB *itdb, Track * s)
+static Track *
+sha1_track_insert (iTunesDB *itdb, Track * s, gboolean validate)
 {
     ExtraiTunesDBData *eitdb;
     ExtraTrackData *etr;
@@ -300,7 +518,7 @@ Track *sha1_track_exists_insert (iTunesDB *itdb, Track * s)
 						   g_str_equal,
 						   g_free, NULL);
 	}
-	val = sha1_hash_track (s);
+	val = sha1_hash_track (s, validate);
 	if (val != NULL)
 	{
 	    track = g_hash_table_lookup (eitdb->sha1hash, val);
@@ -321,6 +539,22 @@ Track *sha1_track_exists_insert (iTunesDB *itdb, Track * s)
     return track;
 }
 
+Track *sha1_track_exists_insert (iTunesDB *itdb, Track * s)
+{
+    return sha1_track_insert (itdb, s, TRUE);
+}
+
+/**
+ * Same as sha1_track_exists_insert() but the SHA1 hash already stored
+ * with @s is used without checking it against the file on disk,
+ * e.g. because it has just been computed by
+ * sha1_hash_on_filename_cached().
+ */
+Track *sha1_track_exists_insert_hashed (iTunesDB *itdb, Track * s)
+{
+    return sha1_track_insert (itdb, s, FALSE);
+}
+
 /**
  * Check to see if a track has already been added to the ipod
  * @s - the Track we want to know about.
@@ -337,7 +571,7 @@ Track *sha1_track_exists (iTunesDB *itdb, Track *s)
 
     if (prefs_get_int("sha1") && eitdb->sha1hash)
     {
-	gchar *val = sha1_hash_track (s);
+	gchar *val = sha1_hash_track (s, FALSE);
 	if (val)
 	{
 	    track = g_hash_table_lookup (eitdb->sha1hash, val);
@@ -414,7 +648,7 @@ void sha1_track_remove (Track *s)
 
     if (prefs_get_int("sha1") && eitdb->sha1hash)
     {
-	gchar *val = sha1_hash_track (s);
+	gchar *val = sha1_hash_track (s, FALSE);
 	if (val)
 	{
 	    Track *track = g_hash_table_lookup (eitdb->sha1hash, val);
@@ -428,135 +662,339 @@ void sha1_track_remove (Track *s)
     }
 }
 
-/* sha1_hash - hash value the input data with a given size.
- * @text - the data we're reading to seed sha1
- * @len - the length of the data for our seed
- * Returns a unique 20 char array.
+/*
+ * The block functions below are the only parts of the SHA1
+ * computation which depend on the CPU. sha1_blocks_generic() is
+ * portable C, sha1_blocks_shani() uses the SHA extensions of
+ * x86 CPUs (Goldmont, Zen, Ice Lake and later). The fastest
+ * function available is picked once at runtime.
+ */
+
+#define SHA1_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define SHA1_F1(b, c, d) ((d) ^ ((b) & ((c) ^ (d))))
+#define SHA1_F2(b, c, d) ((b) ^ (c) ^ (d))
+#define SHA1_F3(b, c, d) (((b) & (c)) | ((d) & ((b) | (c))))
+
+/* message schedule word @t, kept in a ring of 16 words */
+#define SHA1_W(t)							\
+   ((t) < 16 ? w[(t)] :							\
+    (w[(t) & 15] = SHA1_ROL (w[((t) + 13) & 15] ^ w[((t) + 8) & 15] ^	\
+			     w[((t) + 2) & 15] ^ w[(t) & 15], 1)))
+
+#define SHA1_ROUND(a, b, c, d, e, f, k, t)				\
+   do {									\
+      e += SHA1_ROL (a, 5) + f (b, c, d) + (k) + SHA1_W (t);		\
+      b = SHA1_ROL (b, 30);						\
+   } while (0)
+
+#define SHA1_ROUNDS5(f, k, t)						\
+   do {									\
+      SHA1_ROUND (A, B, C, D, E, f, k, (t));				\
+      SHA1_ROUND (E, A, B, C, D, f, k, (t) + 1);			\
+      SHA1_ROUND (D, E, A, B, C, f, k, (t) + 2);			\
+      SHA1_ROUND (C, D, E, A, B, f, k, (t) + 3);			\
+      SHA1_ROUND (B, C, D, E, A, f, k, (t) + 4);			\
+   } while (0)
+
+/*
+ * sha1_blocks_generic - process @nblocks 512-bit blocks of data
+ * @H - the intermediate hash value we're working on
+ * @data - the message, read as big endian words directly
  */
-static guint8 *
-sha1_hash(const guint8 * text, guint32 len)
+static void
+sha1_blocks_generic(guint32 H[5], const guint8 *data, gsize nblocks)
 {
-   chunk x;
-   chunk temp_len = len;
-   const guint8 *temp_text = text;
-   guint8 *digest;
-   sha1 *message;
-
-   digest = g_malloc0(sizeof(guint8) * 21);
-   message = g_malloc0(sizeof(sha1));
-   message->blockdata = g_malloc0(sizeof(block));
-   message->H = g_malloc(sizeof(hblock));
-
-   message->H->chunkblock[0] = 0x67452301;
-   message->H->chunkblock[1] = 0xefcdab89;
-   message->H->chunkblock[2] = 0x98badcfe;
-   message->H->chunkblock[3] = 0x10325476;
-   message->H->chunkblock[4] = 0xc3d2e1f0;
-   while (temp_len >= 64)
+   guint32 w[16];
+   guint32 A, B, C, D, E;
+   int t;
+
+   while (nblocks--)
    {
-      for (x = 0; x < 64; x++)
-         message->blockdata->charblock[x] = temp_text[x];
-#if BYTE_ORDER == LITTLE_ENDIAN
-      little_endian((hblock *) message->blockdata, 16);
-#endif
-      process_block_sha1(message);
-      temp_len -= 64;
-      temp_text += 64;
+      for (t = 0; t < 16; t++, data += 4)
+	 w[t] = ((guint32)data[0] << 24) | ((guint32)data[1] << 16) |
+	        ((guint32)data[2] << 8) | (guint32)data[3];
+
+      A = H[0];
+      B = H[1];
+      C = H[2];
+      D = H[3];
+      E = H[4];
+
+      for (t = 0; t < 20; t += 5)
+	 SHA1_ROUNDS5 (SHA1_F1, 0x5a827999, t);
+      for (; t < 40; t += 5)
+	 SHA1_ROUNDS5 (SHA1_F2, 0x6ed9eba1, t);
+      for (; t < 60; t += 5)
+	 SHA1_ROUNDS5 (SHA1_F3, 0x8f1bbcdc, t);
+      for (; t < 80; t += 5)
+	 SHA1_ROUNDS5 (SHA1_F2, 0xca62c1d6, t);
+
+      H[0] += A;
+      H[1] += B;
+      H[2] += C;
+      H[3] += D;
+      H[4] += E;
    }
-   for (x = 0; x < temp_len; x++)
-      message->blockdata->charblock[x] = temp_text[x];
-   message->blockdata->charblock[temp_len] = 0x80;
-   for (x = temp_len + 1; x < 64; x++)
-      message->blockdata->charblock[x] = 0x00;
-#if BYTE_ORDER == LITTLE_ENDIAN
-   little_endian((hblock *) message->blockdata, 16);
+}
+
+#ifdef SHA1_HAVE_SHANI
+/* four rounds from the middle of the computation: the message
+ * schedule for the following rounds is computed along the way */
+#define SHA1_SHANI_ROUNDS4(Ea, Eb, Mc, Mnext, Mprev, Mxor, f)		\
+   do {									\
+      Ea = _mm_sha1nexte_epu32 (Ea, Mc);				\
+      Eb = ABCD;							\
+      Mnext = _mm_sha1msg2_epu32 (Mnext, Mc);				\
+      ABCD = _mm_sha1rnds4_epu32 (ABCD, Ea, f);				\
+      Mprev = _mm_sha1msg1_epu32 (Mprev, Mc);				\
+      Mxor = _mm_xor_si128 (Mxor, Mc);					\
+   } while (0)
+
+/*
+ * sha1_blocks_shani - same as sha1_blocks_generic() using the x86
+ * SHA instructions
+ */
+__attribute__ ((target ("sha,sse4.1")))
+static void
+sha1_blocks_shani(guint32 H[5], const guint8 *data, gsize nblocks)
+{
+   const __m128i mask = _mm_set_epi64x (0x0001020304050607ULL,
+					0x08090a0b0c0d0e0fULL);
+   __m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+   __m128i MSG0, MSG1, MSG2, MSG3;
+
+   ABCD = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)H), 0x1b);
+   E0 = _mm_set_epi32 (H[4], 0, 0, 0);
+
+   while (nblocks--)
+   {
+      ABCD_SAVE = ABCD;
+      E0_SAVE = E0;
+
+      MSG0 = _mm_shuffle_epi8 (
+	 _mm_loadu_si128 ((const __m128i *)(data + 0)), mask);
+      MSG1 = _mm_shuffle_epi8 (
+	 _mm_loadu_si128 ((const __m128i *)(data + 16)), mask);
+      MSG2 = _mm_shuffle_epi8 (
+	 _mm_loadu_si128 ((const __m128i *)(data + 32)), mask);
+      MSG3 = _mm_shuffle_epi8 (
+	 _mm_loadu_si128 ((const __m128i *)(data + 48)), mask);
+
+      /* rounds 0-11 */
+      E0 = _mm_add_epi32 (E0, MSG0);
+      E1 = ABCD;
+      ABCD = _mm_sha1rnds4_epu32 (ABCD, E0, 0);
+
+      E1 = _mm_sha1nexte_epu32 (E1, MSG1);
+      E0 = ABCD;
+      ABCD = _mm_sha1rnds4_epu32 (ABCD, E1, 0);
+      MSG0 = _mm_sha1msg1_epu32 (MSG0, MSG1);
+
+      E0 = _mm_sha1nexte_epu32 (E0, MSG2);
+      E1 = ABCD;
+      ABCD = _mm_sha1rnds4_epu32 (ABCD, E0, 0);
+      MSG1 = _mm_sha1msg1_epu32 (MSG1, MSG2);
+      MSG0 = _mm_xor_si128 (MSG0, MSG2);
+
+      /* rounds 12-67 */
+      SHA1_SHANI_ROUNDS4 (E1, E0, MSG3, MSG0, MSG2, MSG1, 0);
+      SHA1_SHANI_ROUNDS4 (E0, E1, MSG0, MSG1, MSG3, MSG2, 0);
+      SHA1_SHANI_ROUNDS4 (E1, E0, MSG1, MSG2, MSG0, MSG3, 1);
+      SHA1_SHANI_ROUNDS4 (E0, E1, MSG2, MSG3, MSG1, MSG0, 1);
+      SHA1_SHANI_ROUNDS4 (E1, E0, MSG3, MSG0, MSG2, MSG1, 1);
+      SHA1_SHANI_ROUNDS4 (E0, E1, MSG0, MSG1, MSG3, MSG2, 1);
+      SHA1_SHANI_ROUNDS4 (E1, E0, MSG1, MSG2, MSG0, MSG3, 1);
+      SHA1_SHANI_ROUNDS4 (E0, E1, MSG2, MSG3, MSG1, MSG0, 2);
+      SHA1_SHANI_ROUNDS4 (E1, E0, MSG3, MSG0, MSG2, MSG1, 2);
+      SHA1_SHANI_ROUNDS4 (E0, E1, MSG0, MSG1, MSG3, MSG2, 2);
+      SHA1_SHANI_ROUNDS4 (E1, E0, MSG1, MSG2, MSG0, MSG3, 2);
+      SHA1_SHANI_ROUNDS4 (E0, E1, MSG2, MSG3, MSG1, MSG0, 2);
+      SHA1_SHANI_ROUNDS4 (E1, E0, MSG3, MSG0, MSG2, MSG1, 3);
+      SHA1_SHANI_ROUNDS4 (E0, E1, MSG0, MSG1, MSG3, MSG2, 3);
+
+      /* rounds 68-79 */
+      E1 = _mm_sha1nexte_epu32 (E1, MSG1);
+      E0 = ABCD;
+      MSG2 = _mm_sha1msg2_epu32 (MSG2, MSG1);
+      ABCD = _mm_sha1rnds4_epu32 (ABCD, E1, 3);
+      MSG3 = _mm_xor_si128 (MSG3, MSG1);
+
+      E0 = _mm_sha1nexte_epu32 (E0, MSG2);
+      E1 = ABCD;
+      MSG3 = _mm_sha1msg2_epu32 (MSG3, MSG2);
+      ABCD = _mm_sha1rnds4_epu32 (ABCD, E0, 3);
+
+      E1 = _mm_sha1nexte_epu32 (E1, MSG3);
+      E0 = ABCD;
+      ABCD = _mm_sha1rnds4_epu32 (ABCD, E1, 3);
+
+      E0 = _mm_sha1nexte_epu32 (E0, E0_SAVE);
+      ABCD = _mm_add_epi32 (ABCD, ABCD_SAVE);
+
+      data += 64;
+   }
+
+   _mm_storeu_si128 ((__m128i *)H, _mm_shuffle_epi32 (ABCD, 0x1b));
+   H[4] = _mm_extract_epi32 (E0, 3);
+}
 #endif
-   if (temp_len > 54)
+
+/* sha1_select_blocks - pick the fastest block function this CPU
+ * supports */
+static sha1_blocks_func
+sha1_select_blocks(void)
+{
+#ifdef SHA1_HAVE_SHANI
+   unsigned int eax, ebx, ecx, edx;
+
+   if (__get_cpuid (1, &eax, &ebx, &ecx, &edx) &&
+       (ecx & SHA1_CPUID_SSSE3) && (ecx & SHA1_CPUID_SSE4_1) &&
+       (__get_cpuid_max (0, NULL) >= 7))
    {
-      process_block_sha1(message);
-      for (x = 0; x < 60; x++)
-         message->blockdata->charblock[x] = 0x00;
+      __cpuid_count (7, 0, eax, ebx, ecx, edx);
+      if (ebx & SHA1_CPUID_SHA)
+	 return sha1_blocks_shani;
    }
-   message->blockdata->chunkblock[15] = len * 8;
-   process_block_sha1(message);
-#if BYTE_ORDER == LITTLE_ENDIAN
-   little_endian(message->H, 5);
 #endif
-   for (x = 0; x < 20; x++)
-      digest[x] = message->H->charblock[x];
-   digest[20] = 0x00;
-   g_free(message->blockdata);
-   g_free(message->H);
-   g_free(message);
-   return (digest);
+   return sha1_blocks_generic;
 }
 
-/*
- * process_block_sha1 - process one 512-bit block of data
- * @message - the sha1 struct we're doing working on
- */
+/* sha1_blocks - process @nblocks 512-bit blocks with the block
+ * function selected for this CPU */
 static void
-process_block_sha1(sha1 * message)
+sha1_blocks(guint32 H[5], const guint8 *data, gsize nblocks)
+{
+   static gsize blocks_func = 0;
+
+   if (g_once_init_enter (&blocks_func))
+      g_once_init_leave (&blocks_func, (gsize)sha1_select_blocks ());
+   ((sha1_blocks_func)blocks_func) (H, data, nblocks);
+}
+
+/* sha1_blocks_with - process @nblocks 512-bit blocks with the block
+ * function @blocks instead of the one selected for this CPU.
+ * Returns FALSE if this CPU does not support @blocks. Only meant for
+ * benchmarks and tests. */
+gboolean
+sha1_blocks_with(Sha1Blocks blocks, guint32 H[5], const guint8 *data,
+		 gsize nblocks)
 {
-   chunk x;
-   chunk w[80];                 /* test block */
-   chunk A;                     /* A - E: used for hash calc */
-   chunk B;
-   chunk C;
-   chunk D;
-   chunk E;
-   chunk T;                     /* temp guint32 */
-   chunk K[] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
-
-   for (x = 0; x < 16; x++)
-      w[x] = message->blockdata->chunkblock[x];
-   for (x = 16; x < 80; x++)
+   switch (blocks)
    {
-      w[x] = w[x - 3] ^ w[x - 8] ^ w[x - 14] ^ w[x - 16];
-      w[x] = (w[x] << 1) | (w[x] >> 31);
+   case SHA1_BLOCKS_GENERIC:
+      sha1_blocks_generic (H, data, nblocks);
+      return TRUE;
+   case SHA1_BLOCKS_SHANI:
+#ifdef SHA1_HAVE_SHANI
+      if (sha1_select_blocks () == sha1_blocks_shani)
+      {
+	 sha1_blocks_shani (H, data, nblocks);
+	 return TRUE;
+      }
+#endif
+      break;
    }
-   A = message->H->chunkblock[0];
-   B = message->H->chunkblock[1];
-   C = message->H->chunkblock[2];
-   D = message->H->chunkblock[3];
-   E = message->H->chunkblock[4];
-   for (x = 0; x < 80; x++)
+   return FALSE;
+}
+
+/* sha1_init - prepare @ctx for hashing a new message */
+static void
+sha1_init(sha1_context *ctx)
+{
+   ctx->H[0] = 0x67452301;
+   ctx->H[1] = 0xefcdab89;
+   ctx->H[2] = 0x98badcfe;
+   ctx->H[3] = 0x10325476;
+   ctx->H[4] = 0xc3d2e1f0;
+   ctx->len = 0;
+   ctx->fill = 0;
+}
+
+/* sha1_update - add @len bytes of @data to the message hashed by
+ * @ctx. Complete blocks are hashed straight from @data. */
+static void
+sha1_update(sha1_context *ctx, const guint8 *data, gsize len)
+{
+   ctx->len += len;
+   if (ctx->fill > 0)
    {
-      T = ((A << 5) | (A >> 27)) + E + w[x] + K[x / 20];
-      if (x < 20)
-         T += (B & C) | ((~B) & D);
-      else if (x < 40 || x >= 60)
-         T += B ^ C ^ D;
-      else
-         T += ((C | D) & B) | (C & D);
-      E = D;
-      D = C;
-      C = (B << 30) | (B >> 2);
-      B = A;
-      A = T;
+      gsize n = MIN(len, 64 - ctx->fill);
+
+      memcpy(&ctx->blockdata[ctx->fill], data, n);
+      ctx->fill += n;
+      data += n;
+      len -= n;
+      if (ctx->fill < 64)
+	 return;
+      sha1_blocks(ctx->H, ctx->blockdata, 1);
+      ctx->fill = 0;
    }
-   message->H->chunkblock[0] += A;
-   message->H->chunkblock[1] += B;
-   message->H->chunkblock[2] += C;
-   message->H->chunkblock[3] += D;
-   message->H->chunkblock[4] += E;
+   if (len >= 64)
+   {
+      sha1_blocks(ctx->H, data, len / 64);
+      data += len & ~(gsize)63;
+      len &= 63;
+   }
+   memcpy(ctx->blockdata, data, len);
+   ctx->fill = len;
 }
 
-#if BYTE_ORDER == LITTLE_ENDIAN
-/*
- * little_endian - swap the significants bits to cater to bigendian
- * @stupidblock - the block of data we're swapping
- * @blocks - the number of blocks we're swapping
- */
+/* sha1_pad - pad the message hashed by @ctx and write the resulting
+ * 20 byte digest to @digest. @legacy reproduces the padding of the
+ * original gtkpod implementation, which started a new block already
+ * when 55 bytes were left in the last one. */
 static void
-little_endian(hblock * stupidblock, int blocks)
+sha1_pad(sha1_context *ctx, guint8 digest[20], gboolean legacy)
 {
+   guint64 bits = ctx->len * 8;
    int x;
-   for (x = 0; x < blocks; x++)
+
+   if (legacy)
+      bits = (guint32)bits;
+
+   ctx->blockdata[ctx->fill++] = 0x80;
+   if (ctx->fill > (legacy ? 55 : 56))
    {
-  	stupidblock->chunkblock[x] = (stupidblock->charblock[x * 4] << 24 | stupidblock->charblock[x * 4 + 1] << 16 | stupidblock->charblock[x * 4 +2] << 8 | stupidblock->charblock[x * 4 + 3]);
+      memset(&ctx->blockdata[ctx->fill], 0, 64 - ctx->fill);
+      sha1_blocks(ctx->H, ctx->blockdata, 1);
+      ctx->fill = 0;
+   }
+   memset(&ctx->blockdata[ctx->fill], 0, 56 - ctx->fill);
+   for (x = 0; x < 8; x++)
+      ctx->blockdata[56 + x] = (guint8)(bits >> (56 - 8 * x));
+   sha1_blocks(ctx->H, ctx->blockdata, 1);
+
+   for (x = 0; x < 5; x++)
+   {
+      digest[4 * x] = (guint8)(ctx->H[x] >> 24);
+      digest[4 * x + 1] = (guint8)(ctx->H[x] >> 16);
+      digest[4 * x + 2] = (guint8)(ctx->H[x] >> 8);
+      digest[4 * x + 3] = (guint8)ctx->H[x];
    }
 }
-#endif
 
+/* sha1_final - pad the message hashed by @ctx and write the
+ * resulting 20 byte digest to @digest */
+static void
+sha1_final(sha1_context *ctx, guint8 digest[20])
+{
+   sha1_pad(ctx, digest, FALSE);
+}
+
+/* sha1_hash - hash value the input data with a given size.
+ * @text - the data we're reading to seed sha1
+ * @len - the length of the data for our seed
+ * @digest - where the 20 byte hash value is stored
+ * The result is the one of SHA1_MODE_QUICK hashes stored in older
+ * databases, which differs from a standard SHA1 for some lengths.
+ */
+static void
+sha1_hash(const guint8 *text, guint32 len, guint8 digest[20])
+{
+   sha1_context ctx;
 
+   sha1_init(&ctx);
+   sha1_update(&ctx, text, len);
+   sha1_pad(&ctx, digest, TRUE);
+}
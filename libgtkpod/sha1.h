@@ -33,16 +33,39 @@
 
 #include "gp_itdb.h"
 
+/* What part of a file is used to compute its hash ("sha1_mode") */
+typedef enum
+{
+    SHA1_MODE_QUICK = 0,   /* size and the first 16 KiB              */
+    SHA1_MODE_SAMPLED,     /* size and 64 KiB of start, middle, end  */
+    SHA1_MODE_FULL         /* size and the complete content          */
+} Sha1Mode;
+
+/* Block functions doing the SHA1 compression (see bench_sha1.c) */
+typedef enum
+{
+    SHA1_BLOCKS_GENERIC = 0, /* portable C                        */
+    SHA1_BLOCKS_SHANI        /* x86 SHA extensions                */
+} Sha1Blocks;
+
 void setup_sha1();
 gchar *sha1_hash_on_filename (gchar *name, gboolean silent);
+gchar *sha1_hash_on_filename_with_mode (gchar *name, gboolean silent,
+					Sha1Mode mode);
+gchar *sha1_file_signature (gchar *name);
+gboolean sha1_hash_on_filename_cached (gchar *name, gboolean silent,
+				       gchar **hash, gchar **signature);
 /* Any calls to the following functions immediately return if sha1sums
  * is not on */
 Track *sha1_file_exists (iTunesDB *itdb, gchar *file, gboolean silent);
 Track *sha1_sha1_exists (iTunesDB *itdb, gchar *sha1);
 Track *sha1_track_exists (iTunesDB *itdb, Track *s);
 Track *sha1_track_exists_insert (iTunesDB *itdb, Track *s);
+Track *sha1_track_exists_insert_hashed (iTunesDB *itdb, Track *s);
 void sha1_track_remove (Track *s);
 void sha1_free (iTunesDB *itdb);
 void sha1_free_eitdb (ExtraiTunesDBData *eitdb);
+gboolean sha1_blocks_with (Sha1Blocks blocks, guint32 H[5],
+			   const guint8 *data, gsize nblocks);
 
 #endif
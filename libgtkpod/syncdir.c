@@ -34,12 +34,16 @@
     #include <config.h>
 #endif
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 #include "gp_itdb.h"
+#include "charset.h"
 #include "file.h"
 #include "misc.h"
 #include "misc_track.h"
@@ -47,12 +51,6 @@
 #include "syncdir.h"
 #include "filetype_iface.h"
 
-struct add_files_data {
-    Playlist *playlist;
-    GList **tracks_updated;
-    GHashTable *filepath_hash;
-};
-
 /* Used in the callback after adding a new track to
  * to add to the filehash */
 struct added_file_data {
@@ -295,124 +293,287 @@ static GHashTable *get_itdb_filepath_hash(Playlist *pl) {
     return filepath_hash;
 }
 
-/**
- * add_files:
- *
- * add all music/video files to the playlist @userdata->playlist.
- * updated/newly added tracks are appended to @userdata->tracks_updated.
- */
-static void add_files(gpointer key, gpointer value, gpointer user_data) {
-    struct add_files_data *afd = user_data;
-    Playlist *pl;
-    gchar *dirname;
-
-    g_return_if_fail (key);
-    g_return_if_fail (afd);
-    g_return_if_fail (afd->playlist);
-    g_return_if_fail (afd->tracks_updated);
-    g_return_if_fail (afd->filepath_hash);
+/* One regular file found while scanning */
+typedef struct {
+    gchar *path; /* local encoding */
+    time_t mtime;
+    goffset size;
+} SyncFile;
+
+/* One directory to scan */
+typedef struct _SyncDir SyncDir;
+struct _SyncDir {
+    gchar *dirname; /* local encoding */
+    gboolean recurse; /* also scan subdirectories */
+    GPtrArray *files; /* SyncFile found in @dirname */
+    SyncDir *parent; /* directory @dirname was found in, or NULL */
+    dev_t dev; /* device and inode of @dirname */
+    ino_t ino;
+};
 
-    dirname = key;
-    pl = afd->playlist;
-
-    if (g_file_test(dirname, G_FILE_TEST_IS_DIR)) {
-        GDir *dir = g_dir_open(dirname, 0, NULL);
-        if (dir != NULL) {
-            const gchar *next;
-            while ((next = g_dir_read_name(dir))) {
-                gchar *filename = g_build_filename(dirname, next, NULL);
-                FileType *filetype = determine_filetype(filename);
-                gboolean updated = FALSE;
-                Track *tr = NULL;
-
-                if (filetype_is_audio_filetype(filetype) || filetype_is_video_filetype(filetype)) {
-                    tr = g_hash_table_lookup(afd->filepath_hash, filename);
-                    if (tr) { /* track is already present in playlist.
-                     Update if date stamp is different. */
-                        struct stat filestat;
-                        ExtraTrackData *etr = tr->userdata;
-                        g_return_if_fail (etr);
-
-                        stat(filename, &filestat);
-                        /*
-                         printf ("%ld %ld (%s)\n, %ld %d\n",
-                         filestat.st_mtime, etr->mtime,
-                         filename,
-                         filestat.st_size, tr->size);
-                         */
-                        if ((filestat.st_mtime != etr->mtime) || (filestat.st_size != tr->size)) {
-                            update_track_from_file(pl->itdb, tr);
-                            updated = TRUE;
-                        }
-                    }
-                    else { /* track is not known -- at least not by it's
-                     * filename -> add to playlist using the
-                     * standard function. Duplicate adding is
-                     * avoided by an addtrack function checking
-                     * for duplication */
-                        struct added_file_data data;
-                        data.filepath = filename;
-                        data.filepath_hash = afd->filepath_hash;
-
-                        add_track_by_filename(pl->itdb, filename, pl, FALSE, sync_addtrackfunc, &data, NULL);
-
-                        tr = g_hash_table_lookup(afd->filepath_hash, filename);
-                        updated = TRUE;
-                    }
-                }
+/* Directories are read on a thread pool ("sync_threads"). Each
+ * subdirectory found is scanned as a job of its own. */
+typedef struct {
+    GMutex mutex;
+    GCond done_cond;
+    GThreadPool *pool;
+    GPtrArray *dirs; /* all SyncDir queued */
+    gint pending; /* number of jobs not yet finished */
+    gint nfiles; /* number of files found */
+} SyncScan;
+
+static void sync_file_free(gpointer data) {
+    SyncFile *file = data;
+
+    g_free(file->path);
+    g_free(file);
+}
 
-                if (tr && updated) {
-                    *afd->tracks_updated = g_list_append(*afd->tracks_updated, tr);
-                }
-                g_free(filename);
+static void sync_dir_free(gpointer data) {
+    SyncDir *dir = data;
+
+    g_free(dir->dirname);
+    g_ptr_array_free(dir->files, TRUE);
+    g_free(dir);
+}
+
+static gint sync_dir_compare(gconstpointer a, gconstpointer b) {
+    const SyncDir *dir_a = *(SyncDir * const *) a;
+    const SyncDir *dir_b = *(SyncDir * const *) b;
+
+    return strcmp(dir_a->dirname, dir_b->dirname);
+}
+
+/* TRUE if the directory described by @st is @dir or one of its
+ * parents, so that following it would make us loop. A directory that
+ * can be reached through several paths (symlinks) is scanned under
+ * each of them, because tracks may be known under any of them. */
+static gboolean sync_dir_is_ancestor(const SyncDir *dir, const struct stat *st) {
+    for (; dir; dir = dir->parent) {
+        if ((dir->dev == st->st_dev) && (dir->ino == st->st_ino))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void sync_scan_dir(gpointer data, gpointer user_data);
+
+/* Queue @dirname, found in @parent and described by @st, for
+ * scanning. Must be called with @scan->mutex held. */
+static void sync_scan_queue(SyncScan *scan, gchar *dirname, gboolean recurse, SyncDir *parent, const struct stat *st) {
+    SyncDir *dir = g_new0(SyncDir, 1);
+
+    dir->dirname = dirname;
+    dir->recurse = recurse;
+    dir->parent = parent;
+    dir->dev = st->st_dev;
+    dir->ino = st->st_ino;
+    dir->files = g_ptr_array_new_with_free_func(sync_file_free);
+    g_ptr_array_add(scan->dirs, dir);
+    ++scan->pending;
+    if (scan->pool) {
+        g_thread_pool_push(scan->pool, dir, NULL);
+    }
+    else {
+        g_mutex_unlock(&scan->mutex);
+        sync_scan_dir(dir, scan);
+        g_mutex_lock(&scan->mutex);
+    }
+}
+
+/* Thread pool function: read the entries of one directory. Each
+ * entry is looked at only once with fstatat() relative to the
+ * directory. Entries we are not interested in are skipped without
+ * stat() if the file system reports their type. */
+static void sync_scan_dir(gpointer data, gpointer user_data) {
+    SyncDir *dir = data;
+    SyncScan *scan = user_data;
+    struct dirent *entry;
+    DIR *dirp;
+
+    dirp = opendir(dir->dirname);
+    if (dirp) {
+        gint fd = dirfd(dirp);
+
+        while ((entry = readdir(dirp))) {
+            const gchar *name = entry->d_name;
+            struct stat st;
+
+            if ((strcmp(name, ".") == 0) || (strcmp(name, "..") == 0))
+                continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+            /* the type of these can be told without stat() */
+            if ((entry->d_type != DT_UNKNOWN) && (entry->d_type != DT_LNK) && (entry->d_type != DT_REG) && (entry->d_type != DT_DIR))
+                continue;
+            if ((entry->d_type == DT_DIR) && !dir->recurse)
+                continue;
+#endif
+            /* follow symlinks like g_file_test() did */
+            if (fstatat(fd, name, &st, 0) != 0)
+                continue;
+
+            if (S_ISDIR(st.st_mode)) {
+                if (!dir->recurse || sync_dir_is_ancestor(dir, &st))
+                    continue;
+                g_mutex_lock(&scan->mutex);
+                sync_scan_queue(scan, g_build_filename(dir->dirname, name, NULL), TRUE, dir, &st);
+                g_mutex_unlock(&scan->mutex);
+            }
+            else if (S_ISREG(st.st_mode)) {
+                SyncFile *file = g_new(SyncFile, 1);
+
+                file->path = g_build_filename(dir->dirname, name, NULL);
+                file->mtime = st.st_mtime;
+                file->size = st.st_size;
+                g_ptr_array_add(dir->files, file);
             }
         }
-        g_dir_close(dir);
+        closedir(dirp);
     }
+
+    g_mutex_lock(&scan->mutex);
+    scan->nfiles += dir->files->len;
+    --scan->pending;
+    g_cond_broadcast(&scan->done_cond);
+    g_mutex_unlock(&scan->mutex);
 }
 
-/**
- * cache_directory:
- *
- * Add the given directory to the given hash table then recurse into the directory
- * and add all its sub-directories.
- *
- * @dir: top-level directory to recurse into and store subdirectories
- * @dirs_hash: pointer to a hash table that stores all directory paths
- *
- * Return value: none, dirs_hash stores all required paths
- *
- **/
-static void cache_directory(const gchar *dir, GHashTable *dirs_hash) {
-    GDir *dir_handle;
-    const gchar *filename;
-    gchar *path;
+static void sync_scan_init(SyncScan *scan) {
+    g_mutex_init(&scan->mutex);
+    g_cond_init(&scan->done_cond);
+    scan->dirs = g_ptr_array_new_with_free_func(sync_dir_free);
+    scan->pending = 0;
+    scan->nfiles = 0;
+    scan->pool = g_thread_pool_new(sync_scan_dir, scan, get_worker_thread_count("sync_threads"), FALSE, NULL);
+}
+
+/* Scan @dirname, including its subdirectories if @recurse is TRUE */
+static void sync_scan_add(SyncScan *scan, const gchar *dirname, gboolean recurse) {
+    struct stat st;
 
-    if (!g_file_test(dir, G_FILE_TEST_IS_DIR))
+    if ((g_stat(dirname, &st) != 0) || !S_ISDIR(st.st_mode))
         return;
 
-    /* dir represents a directory so store it in the hash table */
-    g_hash_table_insert(dirs_hash, g_strdup(dir), NULL);
+    g_mutex_lock(&scan->mutex);
+    sync_scan_queue(scan, g_strdup(dirname), recurse, NULL, &st);
+    g_mutex_unlock(&scan->mutex);
+}
 
-    dir_handle = g_dir_open(dir, 0, NULL);
-    if (dir_handle == NULL)
-        return;
+/* Wait for all directories to be scanned while keeping the GUI
+ * alive. The directories are sorted by name afterwards. */
+static void sync_scan_wait(SyncScan *scan) {
+    g_mutex_lock(&scan->mutex);
+    while (scan->pending > 0) {
+        gint64 end_time = g_get_monotonic_time() + 20 * G_TIME_SPAN_MILLISECOND;
+        g_cond_wait_until(&scan->done_cond, &scan->mutex, end_time);
+        if (scan->pending > 0) {
+            g_mutex_unlock(&scan->mutex);
+            while (widgets_blocked && gtk_events_pending())
+                gtk_main_iteration();
+            g_mutex_lock(&scan->mutex);
+        }
+    }
+    g_mutex_unlock(&scan->mutex);
+
+    g_ptr_array_sort(scan->dirs, sync_dir_compare);
+}
+
+static void sync_scan_clear(SyncScan *scan) {
+    if (scan->pool)
+        g_thread_pool_free(scan->pool, FALSE, TRUE);
+    g_ptr_array_free(scan->dirs, TRUE);
+    g_cond_clear(&scan->done_cond);
+    g_mutex_clear(&scan->mutex);
+}
+
+/* Determine the filetype of @filename from its suffix. The filetypes
+ * found are kept in @suffix_hash, so every suffix is only converted
+ * and looked up once. */
+static FileType *sync_get_filetype(GHashTable *suffix_hash, const gchar *filename) {
+    const gchar *basename, *suffix;
+    gpointer type = NULL;
+
+    basename = strrchr(filename, G_DIR_SEPARATOR);
+    basename = basename ? basename + 1 : filename;
+    suffix = strrchr(basename, '.');
+    if (!suffix)
+        return NULL;
+    ++suffix;
+
+    if (!g_hash_table_lookup_extended(suffix_hash, suffix, NULL, &type)) {
+        gchar *suffix_utf8 = charset_to_utf8(suffix);
+        type = gtkpod_get_filetype(suffix_utf8);
+        g_free(suffix_utf8);
+        g_hash_table_insert(suffix_hash, g_strdup(suffix), type);
+    }
+    return type;
+}
+
+/**
+ * add_files:
+ *
+ * add all music/video files found in the directories of @scan that
+ * are listed in @dirs_hash to @playlist. Updated/newly added tracks
+ * are prepended to @tracks_updated. All files found are entered into
+ * @found_files.
+ */
+static void add_files(SyncScan *scan, GHashTable *dirs_hash, Playlist *playlist, GHashTable *filepath_hash, GHashTable *found_files, GList **tracks_updated) {
+    GHashTable *suffix_hash;
+    guint i, j;
 
-    /* Loop through the filenames in the directory */
-    while ((filename = g_dir_read_name(dir_handle))) {
-        /* Construct absolute path from dir and filename */
-        path = g_build_filename(dir, filename, NULL);
+    suffix_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
-        /* If path is not directory then move on to next */
-        if (!g_file_test(path, G_FILE_TEST_IS_DIR))
+    for (i = 0; i < scan->dirs->len; ++i) {
+        SyncDir *dir = g_ptr_array_index(scan->dirs, i);
+
+        if (!g_hash_table_lookup_extended(dirs_hash, dir->dirname, NULL, NULL))
             continue;
 
-        /* recursively walk down into sub directory */
-        cache_directory(path, dirs_hash);
-        g_free(path);
+        for (j = 0; j < dir->files->len; ++j) {
+            SyncFile *file = g_ptr_array_index(dir->files, j);
+            FileType *filetype;
+            gboolean updated = FALSE;
+            Track *tr = NULL;
+
+            g_hash_table_insert(found_files, file->path, file);
+
+            filetype = sync_get_filetype(suffix_hash, file->path);
+            if (!filetype_is_audio_filetype(filetype) && !filetype_is_video_filetype(filetype))
+                continue;
+
+            tr = g_hash_table_lookup(filepath_hash, file->path);
+            if (tr) { /* track is already present in playlist.
+             Update if date stamp is different. */
+                ExtraTrackData *etr = tr->userdata;
+                g_return_if_fail (etr);
+
+                if ((file->mtime != etr->mtime) || (file->size != tr->size)) {
+                    update_track_from_file(playlist->itdb, tr);
+                    updated = TRUE;
+                }
+            }
+            else { /* track is not known -- at least not by it's
+             * filename -> add to playlist using the
+             * standard function. Duplicate adding is
+             * avoided by an addtrack function checking
+             * for duplication */
+                struct added_file_data data;
+                data.filepath = file->path;
+                data.filepath_hash = filepath_hash;
+
+                add_track_by_filename(playlist->itdb, file->path, playlist, FALSE, sync_addtrackfunc, &data, NULL);
+
+                tr = g_hash_table_lookup(filepath_hash, file->path);
+                updated = TRUE;
+            }
+
+            if (tr && updated) {
+                *tracks_updated = g_list_prepend(*tracks_updated, tr);
+            }
+        }
     }
 
-    g_dir_close(dir_handle);
+    g_hash_table_destroy(suffix_hash);
 }
 
 /**
@@ -458,12 +619,14 @@ static void cache_directory(const gchar *dir, GHashTable *dirs_hash) {
  * statusbar and information windows.
  **/
 void sync_playlist(Playlist *playlist, const gchar *syncdir, const gchar *key_sync_confirm_dirs, gboolean sync_confirm_dirs, const gchar *key_sync_delete_tracks, gboolean sync_delete_tracks, const gchar *key_sync_confirm_delete, gboolean sync_confirm_delete, const gchar *key_sync_show_summary, gboolean sync_show_summary) {
-    GHashTable *dirs_hash, *filepath_hash;
+    GHashTable *dirs_hash, *filepath_hash, *found_files;
     gboolean delete_tracks, is_mpl;
     GList *tracks_to_delete_from_ipod = NULL;
     GList *tracks_to_delete_from_playlist = NULL;
     GList *tracks_updated = NULL;
-    struct add_files_data afd;
+    SyncScan scan;
+    gint64 start;
+    guint i;
     GList *gl;
 
     g_return_if_fail (playlist);
@@ -473,6 +636,9 @@ void sync_playlist(Playlist *playlist, const gchar *syncdir, const gchar *key_sy
      value is dirname in utf8, if available */
     dirs_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 
+    start = g_get_monotonic_time();
+    sync_scan_init(&scan);
+
     /* If @syncdir is not NULL, put @syndir into the hash
      table. Otherwise put the dirs of all tracks in @playlist into
      the table. */
@@ -487,7 +653,15 @@ void sync_playlist(Playlist *playlist, const gchar *syncdir, const gchar *key_sy
                 dir[len - 1] = 0;
             }
         }
-        cache_directory(dir, dirs_hash);
+        /* the directory tree is walked only once -- all files found
+         are kept for add_files() */
+        sync_scan_add(&scan, dir, TRUE);
+        sync_scan_wait(&scan);
+        for (i = 0; i < scan.dirs->len; ++i) {
+            SyncDir *sdir = g_ptr_array_index(scan.dirs, i);
+            g_hash_table_insert(dirs_hash, g_strdup(sdir->dirname), NULL);
+        }
+        g_free(dir);
     }
     else {
         for (gl = playlist->members; gl; gl = gl->next) {
@@ -520,20 +694,32 @@ void sync_playlist(Playlist *playlist, const gchar *syncdir, const gchar *key_sy
     /* Confirm directories */
     if (key_sync_confirm_dirs || sync_confirm_dirs) {
         if (!confirm_sync_dirs(dirs_hash, key_sync_confirm_dirs)) { /* aborted */
+            sync_scan_clear(&scan);
             g_hash_table_destroy(dirs_hash);
             return;
         }
     }
 
+    if (!syncdir) {
+        GHashTableIter iter;
+        gpointer dirname;
+
+        g_hash_table_iter_init(&iter, dirs_hash);
+        while (g_hash_table_iter_next(&iter, &dirname, NULL))
+            sync_scan_add(&scan, dirname, FALSE);
+        sync_scan_wait(&scan);
+    }
+
+    gtkpod_statusbar_message(_("Scanned %d files in %d directories in %.1f seconds"), scan.nfiles, scan.dirs->len, (gdouble) (g_get_monotonic_time() - start) / G_USEC_PER_SEC);
+
     /* craete a hash with all files in the current playlist for faster
      * comparison with files in the directory */
     filepath_hash = get_itdb_filepath_hash(playlist);
+    found_files = g_hash_table_new(g_str_hash, g_str_equal);
 
-    afd.playlist = playlist;
-    afd.tracks_updated = &tracks_updated;
-    afd.filepath_hash = filepath_hash;
     /* Add all files in all directories present in dirs_hash */
-    g_hash_table_foreach(dirs_hash, add_files, &afd);
+    add_files(&scan, dirs_hash, playlist, filepath_hash, found_files, &tracks_updated);
+    tracks_updated = g_list_reverse(tracks_updated);
 
     /* we won't need this hash any more */
     g_hash_table_destroy(filepath_hash);
@@ -575,8 +761,10 @@ void sync_playlist(Playlist *playlist, const gchar *syncdir, const gchar *key_sy
             if (!g_hash_table_lookup_extended(dirs_hash, dirname_local, NULL, NULL)) { /* file is not in one of the specified directories */
                 remove = TRUE;
             }
-            else { /* check if file exists */
-                if (g_file_test(etr->pc_path_locale, G_FILE_TEST_EXISTS) == FALSE) { /* no -- remove */
+            else { /* check if file exists -- the scan only knows
+             about regular files named the way we build them */
+                if (!g_hash_table_lookup_extended(found_files, etr->pc_path_locale, NULL, NULL)
+                        && (g_file_test(etr->pc_path_locale, G_FILE_TEST_EXISTS) == FALSE)) { /* no -- remove */
                     remove = TRUE;
                 }
             }
@@ -588,15 +776,22 @@ void sync_playlist(Playlist *playlist, const gchar *syncdir, const gchar *key_sy
          * playlist (if delete_tracks is not set, no tracks are
          * removed from the MPL) */
             if (delete_tracks && (is_mpl || (itdb_playlist_contain_track_number(tr) == 1))) {
-                tracks_to_delete_from_ipod = g_list_append(tracks_to_delete_from_ipod, tr);
+                tracks_to_delete_from_ipod = g_list_prepend(tracks_to_delete_from_ipod, tr);
             }
             else {
                 if (!is_mpl) {
-                    tracks_to_delete_from_playlist = g_list_append(tracks_to_delete_from_playlist, tr);
+                    tracks_to_delete_from_playlist = g_list_prepend(tracks_to_delete_from_playlist, tr);
                 }
             }
         }
     }
+    tracks_to_delete_from_ipod = g_list_reverse(tracks_to_delete_from_ipod);
+    tracks_to_delete_from_playlist = g_list_reverse(tracks_to_delete_from_playlist);
+
+    /* the file lists are no longer needed */
+    g_hash_table_destroy(found_files);
+    sync_scan_clear(&scan);
+    g_hash_table_destroy(dirs_hash);
 
     if (tracks_to_delete_from_ipod && (key_sync_confirm_delete || sync_confirm_delete)
             && (confirm_delete_tracks(tracks_to_delete_from_ipod, key_sync_confirm_delete) == FALSE)) { /* User doesn't want us to remove those tracks from the
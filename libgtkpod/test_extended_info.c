@@ -0,0 +1,218 @@
+/*
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+/* Checks that an extended information file whose last append was
+ * interrupted still yields the segments written before. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <glib/gstdio.h>
+#include "gp_itdb.h"
+#include "extended_info.h"
+
+typedef struct {
+    gchar *dir;
+    gchar *ext_name;
+    iTunesDB *itdb;
+    Track *track;
+} XiFixture;
+
+static void xi_fixture_set_up(XiFixture *fix, gconstpointer data) {
+    ExtraTrackData *etr;
+    GError *error = NULL;
+    gint i;
+
+    fix->dir = g_dir_make_tmp("gtkpod-xi-XXXXXX", &error);
+    g_assert_no_error (error);
+    fix->ext_name = g_build_filename(fix->dir, "iTunesDB.ext", NULL);
+
+    fix->itdb = itdb_new();
+    fix->itdb->filename = g_build_filename(fix->dir, "iTunesDB", NULL);
+    g_file_set_contents(fix->itdb->filename, "not really an iTunesDB", -1, &error);
+    g_assert_no_error (error);
+
+    /* enough tracks for a segment with one of them to be appended
+     rather than the file to be compacted */
+    for (i = 0; i < 20; ++i) {
+        Track *track = itdb_track_new();
+        gp_track_add_extra(track);
+        track->dbid = 42 + i;
+        etr = track->userdata;
+        etr->pc_path_locale = i ? g_strdup_printf("/music/other%d.mp3", i) : g_strdup("/music/first.mp3");
+        itdb_track_add(fix->itdb, track, -1);
+        if (i == 0)
+            fix->track = track;
+    }
+}
+
+static void xi_fixture_tear_down(XiFixture *fix, gconstpointer data) {
+    gchar *itunes = g_strdup(fix->itdb->filename);
+
+    itdb_free(fix->itdb);
+    g_unlink(fix->ext_name);
+    g_unlink(itunes);
+    g_rmdir(fix->dir);
+    g_free(itunes);
+    g_free(fix->ext_name);
+    g_free(fix->dir);
+}
+
+static void xi_set_path(XiFixture *fix, const gchar *path) {
+    ExtraTrackData *etr = fix->track->userdata;
+
+    g_free(etr->pc_path_locale);
+    etr->pc_path_locale = g_strdup(path);
+}
+
+/* Append @len bytes of @data to the extended information file */
+static void xi_append_raw(XiFixture *fix, gconstpointer data, gsize len) {
+    FILE *fp = g_fopen(fix->ext_name, "ab");
+
+    g_assert (fp);
+    g_assert_cmpuint (fwrite(data, 1, len, fp), ==, len);
+    fclose(fp);
+}
+
+static gsize xi_file_size(XiFixture *fix) {
+    GStatBuf statbuf;
+
+    g_assert_cmpint (g_stat(fix->ext_name, &statbuf), ==, 0);
+    return statbuf.st_size;
+}
+
+/* Read the file and check the path stored for the track */
+static ExtendedInfo *xi_read_check(XiFixture *fix, const gchar *path) {
+    ExtendedInfo *info;
+    ExtendedTrackInfo *sei;
+    GError *error = NULL;
+
+    info = extended_info_read(fix->ext_name, fix->itdb->filename, &error);
+    g_assert_no_error (error);
+    g_assert (info);
+    g_assert (info->hash_matched);
+    g_assert (info->journal);
+    sei = g_hash_table_lookup(info->by_dbid, &fix->track->dbid);
+    g_assert (sei);
+    g_assert_cmpstr (sei->pc_path_locale, ==, path);
+    return info;
+}
+
+static void xi_write(XiFixture *fix, ExtendedInfoJournal **journal) {
+    GError *error = NULL;
+
+    g_assert (extended_info_write(fix->ext_name, fix->itdb, NULL, journal, &error));
+    g_assert_no_error (error);
+}
+
+/* A tail of zeros, as left behind by a crash while appending */
+static void test_zero_tail(XiFixture *fix, gconstpointer data) {
+    static const guchar zeros[64] = { 0 };
+    ExtendedInfo *info;
+    gsize size;
+
+    xi_write(fix, NULL);
+    size = xi_file_size(fix);
+    xi_append_raw(fix, zeros, sizeof(zeros));
+
+    info = xi_read_check(fix, "/music/first.mp3");
+
+    /* the next append overwrites the zeros */
+    xi_set_path(fix, "/music/second.mp3");
+    xi_write(fix, &info->journal);
+    g_assert_cmpuint (xi_file_size(fix), >, size);
+    extended_info_free(info);
+
+    info = xi_read_check(fix, "/music/second.mp3");
+    extended_info_free(info);
+}
+
+/* Records that cannot be parsed after a complete segment */
+static void test_garbage_tail(XiFixture *fix, gconstpointer data) {
+    /* an id record with a number of the wrong length */
+    static const guchar bad_number[] = { 3, 4, 0, 0, 0, 1, 2, 3, 4 };
+    /* a string where the start of a segment is expected */
+    static const guchar bad_start[] = { 7, 1, 0, 0, 0, 'x' };
+    /* a tag that is never written */
+    static const guchar bad_tag[] = { 0xfe, 0, 0, 0, 0 };
+    ExtendedInfo *info;
+
+    xi_write(fix, NULL);
+    xi_append_raw(fix, bad_number, sizeof(bad_number));
+    info = xi_read_check(fix, "/music/first.mp3");
+    extended_info_free(info);
+
+    xi_write(fix, NULL);
+    xi_append_raw(fix, bad_start, sizeof(bad_start));
+    info = xi_read_check(fix, "/music/first.mp3");
+    extended_info_free(info);
+
+    xi_write(fix, NULL);
+    xi_append_raw(fix, bad_tag, sizeof(bad_tag));
+    info = xi_read_check(fix, "/music/first.mp3");
+    extended_info_free(info);
+}
+
+/* A segment that was appended without its END record */
+static void test_torn_segment(XiFixture *fix, gconstpointer data) {
+    ExtendedInfo *info;
+    gchar *contents;
+    gsize size, full_size;
+
+    xi_write(fix, NULL);
+    info = xi_read_check(fix, "/music/first.mp3");
+    size = xi_file_size(fix);
+
+    xi_set_path(fix, "/music/second.mp3");
+    xi_write(fix, &info->journal);
+    extended_info_free(info);
+    full_size = xi_file_size(fix);
+
+    /* cut the END record and part of the track off */
+    g_assert (g_file_get_contents(fix->ext_name, &contents, NULL, NULL));
+    g_assert (g_file_set_contents(fix->ext_name, contents, full_size - 8, NULL));
+    g_free(contents);
+    g_assert_cmpuint (xi_file_size(fix), >, size);
+
+    info = xi_read_check(fix, "/music/first.mp3");
+    extended_info_free(info);
+}
+
+int main(int argc, char *argv[]) {
+#if !GLIB_CHECK_VERSION(2,35,0)
+    g_type_init();
+#endif
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/extended_info/zero_tail", XiFixture, NULL, xi_fixture_set_up, test_zero_tail, xi_fixture_tear_down);
+    g_test_add("/extended_info/garbage_tail", XiFixture, NULL, xi_fixture_set_up, test_garbage_tail, xi_fixture_tear_down);
+    g_test_add("/extended_info/torn_segment", XiFixture, NULL, xi_fixture_set_up, test_torn_segment, xi_fixture_tear_down);
+
+    return g_test_run();
+}
@@ -0,0 +1,815 @@
+/*
+ |  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+ |  Part of the gtkpod project.
+ |
+ |  URL: http://www.gtkpod.org/
+ |  URL: http://gtkpod.sourceforge.net/
+ |
+ |  This program is free software; you can redistribute it and/or modify
+ |  it under the terms of the GNU General Public License as published by
+ |  the Free Software Foundation; either version 2 of the License, or
+ |  (at your option) any later version.
+ |
+ |  This program is distributed in the hope that it will be useful,
+ |  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ |  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ |  GNU General Public License for more details.
+ |
+ |  You should have received a copy of the GNU General Public License
+ |  along with this program; if not, write to the Free Software
+ |  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ |
+ |  iTunes and iPod are trademarks of Apple
+ |
+ |  This product is not supported/written/published by Apple!
+ |
+ |  $Id$
+ */
+
+/* This file provides the thumbnail cache shared by the cover
+ * displays. Artwork is copied on the main thread and decoded on a
+ * thread pool; the finished thumbnails are handed back through the
+ * main loop, where they are added to the cache and passed on to
+ * whoever asked for them.
+ *
+ * Thumbnails are also stored as PNG files in the "thumbnail_cache"
+ * directory of the config dir, so that they need not be decoded again
+ * in the next session. The directory is kept below
+ * "thumbnail_cache_size" MB by removing the least recently used
+ * files.
+ *
+ * The mutex protects the cache entries and the jobs in flight. The
+ * requests waiting for a job are only touched from the main thread. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n-lib.h>
+#include <gdk/gdk.h>
+#include "gtkpod_app_iface.h"
+#include "misc.h"
+#include "prefs.h"
+#include "thumbnail_cache.h"
+
+/* number of bytes of pixel data kept in the cache */
+#define THUMBNAIL_CACHE_MAX_BYTES (48 * 1024 * 1024)
+/* bytes accounted for an entry without a thumbnail */
+#define THUMBNAIL_CACHE_ENTRY_BYTES 64
+/* when trimming the disk cache, remove files until it is down to
+ * this fraction of its limit, so that it is not trimmed again right
+ * away */
+#define THUMBNAIL_CACHE_DISK_LOW_WATER 0.75
+
+typedef struct {
+    gconstpointer artwork; /* track->artwork the thumbnail is made of */
+    gint size;
+} ThumbKey;
+
+typedef struct {
+    ThumbKey key;
+    iTunesDB *itdb;
+    GdkPixbuf *pixbuf; /* NULL if the artwork could not be decoded */
+    gsize bytes;
+} ThumbEntry;
+
+typedef struct {
+    ThumbKey key;
+    iTunesDB *itdb;
+    Itdb_Device *device;
+    Itdb_Artwork *artwork; /* private copy decoded by the worker */
+    gchar *filename; /* file in the disk cache or NULL */
+    GdkPixbuf *pixbuf; /* result */
+    gboolean stale; /* artwork changed or was removed meanwhile */
+    gboolean running;
+} ThumbJob;
+
+typedef struct {
+    Track *track;
+    ThumbnailCacheFunc func;
+    gpointer user_data;
+} ThumbRequest;
+
+typedef struct {
+    GMutex mutex;
+    GCond running_cond; /* signalled when a job stops running */
+    GThreadPool *pool;
+    GHashTable *entries; /* ThumbKey -> link in @lru */
+    GQueue lru; /* ThumbEntry, most recently used first */
+    gsize bytes;
+    GHashTable *jobs; /* ThumbKey -> ThumbJob in flight */
+    GHashTable *requests; /* ThumbKey -> GList of ThumbRequest */
+    gchar *dir; /* disk cache, NULL if disabled */
+    goffset disk_limit; /* maximum size of @dir in bytes */
+    goffset disk_written; /* bytes written to @dir since last trimmed */
+    gboolean disk_trimming; /* @dir is being trimmed */
+} ThumbnailCache;
+
+static ThumbnailCache *cache = NULL;
+
+static gboolean thumb_job_done(gpointer data);
+
+static guint thumb_key_hash(gconstpointer v) {
+    const ThumbKey *key = v;
+    return g_direct_hash(key->artwork) ^ (guint) key->size;
+}
+
+static gboolean thumb_key_equal(gconstpointer a, gconstpointer b) {
+    const ThumbKey *key_a = a;
+    const ThumbKey *key_b = b;
+    return (key_a->artwork == key_b->artwork) && (key_a->size == key_b->size);
+}
+
+static void thumb_entry_free(ThumbEntry *entry) {
+    if (entry->pixbuf)
+        g_object_unref(entry->pixbuf);
+    g_free(entry);
+}
+
+static void thumb_job_free(ThumbJob *job) {
+    itdb_artwork_free(job->artwork);
+    g_free(job->filename);
+    if (job->pixbuf)
+        g_object_unref(job->pixbuf);
+    g_free(job);
+}
+
+/* Scale @pixbuf down to fit into @size x @size, keeping its aspect
+ * ratio. Takes over the reference to @pixbuf. */
+static GdkPixbuf *thumb_fit_pixbuf(GdkPixbuf *pixbuf, gint size) {
+    gint w = gdk_pixbuf_get_width(pixbuf);
+    gint h = gdk_pixbuf_get_height(pixbuf);
+    GdkPixbuf *scaled;
+
+    if ((w <= size) && (h <= size))
+        return pixbuf;
+
+    if (w >= h) {
+        h = MAX(1, h * size / w);
+        w = size;
+    }
+    else {
+        w = MAX(1, w * size / h);
+        h = size;
+    }
+
+    scaled = gdk_pixbuf_scale_simple(pixbuf, w, h, GDK_INTERP_BILINEAR);
+    g_object_unref(pixbuf);
+    return scaled;
+}
+
+/* Remove entries from the end of the LRU list until the cache fits
+ * into its limit. Called with the mutex locked. */
+static void thumb_cache_trim(void) {
+    while (cache->bytes > THUMBNAIL_CACHE_MAX_BYTES) {
+        ThumbEntry *entry = g_queue_pop_tail(&cache->lru);
+        if (!entry)
+            break;
+        g_hash_table_remove(cache->entries, &entry->key);
+        cache->bytes -= entry->bytes;
+        thumb_entry_free(entry);
+    }
+}
+
+/* Add the result of @job to the cache. Called with the mutex locked. */
+static void thumb_cache_insert(ThumbJob *job) {
+    ThumbEntry *entry;
+
+    if (g_hash_table_lookup(cache->entries, &job->key))
+        return;
+
+    entry = g_new0(ThumbEntry, 1);
+    entry->key = job->key;
+    entry->itdb = job->itdb;
+    entry->bytes = THUMBNAIL_CACHE_ENTRY_BYTES;
+    if (job->pixbuf) {
+        entry->pixbuf = g_object_ref(job->pixbuf);
+        entry->bytes += gdk_pixbuf_get_rowstride(entry->pixbuf) * gdk_pixbuf_get_height(entry->pixbuf);
+    }
+
+    g_queue_push_head(&cache->lru, entry);
+    g_hash_table_insert(cache->entries, &entry->key, cache->lru.head);
+    cache->bytes += entry->bytes;
+    thumb_cache_trim();
+}
+
+/* Drop all entries for which @func returns TRUE. Called with the
+ * mutex locked. */
+static void thumb_cache_remove_matching(GHRFunc func, gpointer user_data) {
+    GList *gl = cache->lru.head;
+
+    while (gl) {
+        GList *next = gl->next;
+        ThumbEntry *entry = gl->data;
+
+        if (func(&entry->key, entry, user_data)) {
+            g_hash_table_remove(cache->entries, &entry->key);
+            g_queue_delete_link(&cache->lru, gl);
+            cache->bytes -= entry->bytes;
+            thumb_entry_free(entry);
+        }
+        gl = next;
+    }
+}
+
+/* Name of the file holding the thumbnail of @track at @size in the
+ * disk cache, or NULL if it can't be stored there.
+ *
+ * libgpod gives no access to the image data itself, so the file is
+ * named after a hash of the fields identifying the artwork of the
+ * track. They stay the same from one session to the next and for
+ * copies of the track, and change when new artwork is set. */
+static gchar *thumb_disk_filename(Track *track, gint size) {
+    Itdb_Artwork *artwork = track->artwork;
+    gchar *signature, *hash, *name, *filename;
+
+    if (!cache->dir || (track->dbid == 0) || (artwork->artwork_size == 0))
+        return NULL;
+
+    signature = g_strdup_printf("%" G_GINT64_MODIFIER "x %u %ld %ld", track->dbid, artwork->artwork_size, (glong) artwork->creation_date, (glong) artwork->digitized_date);
+    hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, signature, -1);
+    name = g_strdup_printf("%s-%d.png", hash, size);
+    filename = g_build_filename(cache->dir, name, NULL);
+
+    g_free(signature);
+    g_free(hash);
+    g_free(name);
+    return filename;
+}
+
+/* Load a thumbnail from the disk cache. The file is touched so that
+ * it counts as recently used when trimming. */
+static GdkPixbuf *thumb_disk_load(const gchar *filename) {
+    GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file(filename, NULL);
+
+    if (pixbuf)
+        g_utime(filename, NULL);
+    return pixbuf;
+}
+
+typedef struct {
+    gchar *filename;
+    goffset size;
+    time_t mtime;
+} ThumbDiskFile;
+
+static gint thumb_disk_file_compare(gconstpointer a, gconstpointer b) {
+    const ThumbDiskFile *file_a = a;
+    const ThumbDiskFile *file_b = b;
+
+    if (file_a->mtime < file_b->mtime)
+        return -1;
+    return (file_a->mtime > file_b->mtime);
+}
+
+/* Thread function: remove the least recently used files from the disk
+ * cache until it fits into its limit */
+static gpointer thumb_disk_trim(gpointer data) {
+    GArray *files = g_array_new(FALSE, FALSE, sizeof(ThumbDiskFile));
+    goffset total = 0;
+    const gchar *name;
+    GDir *dir;
+    guint i;
+
+    dir = g_dir_open(cache->dir, 0, NULL);
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            ThumbDiskFile file;
+            struct stat statbuf;
+
+            file.filename = g_build_filename(cache->dir, name, NULL);
+            if ((g_stat(file.filename, &statbuf) != 0) || !S_ISREG(statbuf.st_mode)) {
+                g_free(file.filename);
+                continue;
+            }
+            file.size = statbuf.st_size;
+            file.mtime = statbuf.st_mtime;
+            g_array_append_val(files, file);
+            total += file.size;
+        }
+        g_dir_close(dir);
+    }
+
+    if (total > cache->disk_limit) {
+        g_array_sort(files, thumb_disk_file_compare);
+        for (i = 0; (i < files->len) && (total > cache->disk_limit * THUMBNAIL_CACHE_DISK_LOW_WATER); ++i) {
+            ThumbDiskFile *file = &g_array_index(files, ThumbDiskFile, i);
+            if (g_unlink(file->filename) == 0)
+                total -= file->size;
+        }
+    }
+
+    for (i = 0; i < files->len; ++i)
+        g_free(g_array_index(files, ThumbDiskFile, i).filename);
+    g_array_free(files, TRUE);
+
+    g_mutex_lock(&cache->mutex);
+    cache->disk_trimming = FALSE;
+    g_mutex_unlock(&cache->mutex);
+
+    return NULL;
+}
+
+/* Trim the disk cache in the background unless that is already
+ * happening. Called with the mutex locked. */
+static void thumb_disk_trim_start(void) {
+    if (cache->disk_trimming)
+        return;
+
+    cache->disk_trimming = TRUE;
+    cache->disk_written = 0;
+    g_thread_unref(g_thread_new("thumbnail-cache-trim", thumb_disk_trim, NULL));
+}
+
+/* Store @pixbuf in the disk cache. It is written to a temporary file
+ * first, so that other threads never see a partial thumbnail. */
+static void thumb_disk_save(const gchar *filename, GdkPixbuf *pixbuf) {
+    gchar *buf, *tmpname;
+    gsize len, written = 0;
+    gint fd;
+
+    if (!gdk_pixbuf_save_to_buffer(pixbuf, &buf, &len, "png", NULL, NULL))
+        return;
+
+    tmpname = g_strconcat(filename, ".XXXXXX", NULL);
+    fd = g_mkstemp(tmpname);
+    if (fd != -1) {
+        while (written < len) {
+            ssize_t n = write(fd, buf + written, len - written);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            written += n;
+        }
+        if ((close(fd) != 0) || (written < len) || (g_rename(tmpname, filename) != 0)) {
+            g_unlink(tmpname);
+            written = 0;
+        }
+    }
+    g_free(tmpname);
+    g_free(buf);
+
+    if (written > 0) {
+        g_mutex_lock(&cache->mutex);
+        cache->disk_written += written;
+        /* trim after an eighth of the cache has been written anew */
+        if (cache->disk_written > (cache->disk_limit / 8))
+            thumb_disk_trim_start();
+        g_mutex_unlock(&cache->mutex);
+    }
+}
+
+/* Get the thumbnail of @artwork at @size from @filename in the disk
+ * cache if possible. Otherwise decode it and store the result there. */
+static GdkPixbuf *thumb_create(Itdb_Device *device, Itdb_Artwork *artwork, gint size, const gchar *filename) {
+    GdkPixbuf *pixbuf = NULL;
+
+    if (filename)
+        pixbuf = thumb_disk_load(filename);
+
+    if (!pixbuf) {
+        pixbuf = itdb_artwork_get_pixbuf(device, artwork, size, size);
+        if (pixbuf) {
+            pixbuf = thumb_fit_pixbuf(pixbuf, size);
+            if (filename)
+                thumb_disk_save(filename, pixbuf);
+        }
+    }
+
+    return pixbuf;
+}
+
+/* Thread pool function: decode the artwork of one job */
+static void thumb_job_run(gpointer data, gpointer user_data) {
+    ThumbJob *job = data;
+    GdkPixbuf *pixbuf = NULL;
+
+    g_mutex_lock(&cache->mutex);
+    job->running = !job->stale;
+    g_mutex_unlock(&cache->mutex);
+
+    if (job->running) {
+        pixbuf = thumb_create(job->device, job->artwork, job->key.size, job->filename);
+
+        g_mutex_lock(&cache->mutex);
+        job->pixbuf = pixbuf;
+        job->running = FALSE;
+        g_cond_broadcast(&cache->running_cond);
+        g_mutex_unlock(&cache->mutex);
+    }
+
+    gdk_threads_add_idle(thumb_job_done, job);
+}
+
+/* Set up the disk cache in the config dir. Returns its path or NULL
+ * if it is disabled or can't be created. */
+static gchar *thumb_disk_setup(void) {
+    gchar *cfgdir, *dir;
+
+    if (prefs_get_int("thumbnail_cache_size") <= 0)
+        return NULL;
+
+    cfgdir = prefs_get_cfgdir();
+    if (!cfgdir)
+        return NULL;
+
+    dir = g_build_filename(cfgdir, "thumbnail_cache", NULL);
+    g_free(cfgdir);
+
+    if (!g_file_test(dir, G_FILE_TEST_IS_DIR) && (g_mkdir(dir, 0777) == -1)) {
+        gtkpod_warning(_("Could not create '%s'"), dir);
+        g_free(dir);
+        dir = NULL;
+    }
+
+    return dir;
+}
+
+static void thumb_cache_init(void) {
+    ThumbnailCache *new_cache;
+
+    if (cache)
+        return;
+
+    new_cache = g_new0(ThumbnailCache, 1);
+    g_mutex_init(&new_cache->mutex);
+    g_cond_init(&new_cache->running_cond);
+    g_queue_init(&new_cache->lru);
+    new_cache->entries = g_hash_table_new(thumb_key_hash, thumb_key_equal);
+    new_cache->jobs = g_hash_table_new(thumb_key_hash, thumb_key_equal);
+    new_cache->requests = g_hash_table_new_full(thumb_key_hash, thumb_key_equal, g_free, NULL);
+    new_cache->pool = g_thread_pool_new(thumb_job_run, NULL, get_worker_thread_count("thumbnail_threads"), FALSE, NULL);
+    /* thumbnail_cache_invalidate_track() may look at the cache from
+     another thread, so only publish it once it is set up */
+    g_atomic_pointer_set(&cache, new_cache);
+
+    cache->dir = thumb_disk_setup();
+    if (cache->dir) {
+        cache->disk_limit = (goffset) prefs_get_int("thumbnail_cache_size") * 1024 * 1024;
+        g_mutex_lock(&cache->mutex);
+        thumb_disk_trim_start();
+        g_mutex_unlock(&cache->mutex);
+    }
+}
+
+/* Queue a job decoding the artwork of @track unless there is one
+ * already. Called with the mutex locked. */
+static void thumb_job_submit(Track *track, const ThumbKey *key) {
+    ThumbJob *job;
+
+    if (g_hash_table_lookup(cache->jobs, key))
+        return;
+
+    job = g_new0(ThumbJob, 1);
+    job->key = *key;
+    job->itdb = track->itdb;
+    job->device = track->itdb ? track->itdb->device : NULL;
+    job->artwork = itdb_artwork_duplicate(track->artwork);
+    job->filename = thumb_disk_filename(track, key->size);
+    g_hash_table_insert(cache->jobs, &job->key, job);
+    g_thread_pool_push(cache->pool, job, NULL);
+}
+
+/* Look up the thumbnail of @track at @size and queue a job creating
+ * it if it is not cached. Returns TRUE if the lookup is complete, in
+ * which case @pixbuf is set to a new reference or to NULL if the
+ * track has no usable artwork. */
+static gboolean thumb_cache_lookup(Track *track, gint size, GdkPixbuf **pixbuf) {
+    ThumbKey key;
+    GList *link;
+
+    *pixbuf = NULL;
+    if (!track->artwork || !itdb_track_has_thumbnails(track))
+        return TRUE;
+
+    thumb_cache_init();
+    key.artwork = track->artwork;
+    key.size = size;
+
+    g_mutex_lock(&cache->mutex);
+    link = g_hash_table_lookup(cache->entries, &key);
+    if (link) {
+        ThumbEntry *entry = link->data;
+        /* move to the front of the LRU list */
+        g_queue_unlink(&cache->lru, link);
+        g_queue_push_head_link(&cache->lru, link);
+        if (entry->pixbuf)
+            *pixbuf = g_object_ref(entry->pixbuf);
+    }
+    else {
+        thumb_job_submit(track, &key);
+    }
+    g_mutex_unlock(&cache->mutex);
+
+    return (link != NULL);
+}
+
+/* Let @request wait for the thumbnail of its track at @size, or
+ * answer it right away if the lookup is complete */
+static void thumb_request_add(ThumbRequest *request, gint size) {
+    GdkPixbuf *pixbuf;
+    ThumbKey key;
+    GList *requests;
+
+    if (thumb_cache_lookup(request->track, size, &pixbuf)) {
+        request->func(request->track, pixbuf, request->user_data);
+        if (pixbuf)
+            g_object_unref(pixbuf);
+        g_free(request);
+        return;
+    }
+
+    key.artwork = request->track->artwork;
+    key.size = size;
+
+    requests = g_hash_table_lookup(cache->requests, &key);
+    if (requests)
+        requests = g_list_append(requests, request);
+    else
+        g_hash_table_insert(cache->requests, g_memdup(&key, sizeof(key)), g_list_append(NULL, request));
+}
+
+/* Main loop callback: cache the result of a finished job and pass it
+ * on to the requests waiting for it */
+static gboolean thumb_job_done(gpointer data) {
+    ThumbJob *job = data;
+    GList *requests, *gl;
+
+    g_mutex_lock(&cache->mutex);
+    g_hash_table_remove(cache->jobs, &job->key);
+    if (!job->stale)
+        thumb_cache_insert(job);
+    g_mutex_unlock(&cache->mutex);
+
+    requests = g_hash_table_lookup(cache->requests, &job->key);
+    if (requests) {
+        g_hash_table_remove(cache->requests, &job->key);
+        for (gl = requests; gl; gl = gl->next) {
+            ThumbRequest *request = gl->data;
+
+            if (job->stale) {
+                /* the artwork has changed since the job was queued,
+                 * start over with the current one */
+                thumb_request_add(request, job->key.size);
+            }
+            else {
+                request->func(request->track, job->pixbuf, request->user_data);
+                g_free(request);
+            }
+        }
+        g_list_free(requests);
+    }
+
+    thumb_job_free(job);
+    return FALSE;
+}
+
+/**
+ * thumbnail_cache_get:
+ *
+ * Get the artwork of @track scaled to fit into @size x @size.
+ *
+ * Returns a new reference to the thumbnail if it is cached. If not,
+ * NULL is returned and the thumbnail is created in the background
+ * and passed to @func. NULL is also returned, without calling @func,
+ * for tracks without artwork and for artwork that could not be
+ * decoded before.
+ */
+GdkPixbuf *thumbnail_cache_get(Track *track, gint size, ThumbnailCacheFunc func, gpointer user_data) {
+    GdkPixbuf *pixbuf;
+    ThumbRequest *request;
+
+    g_return_val_if_fail (track, NULL);
+    g_return_val_if_fail (func, NULL);
+
+    if (thumb_cache_lookup(track, size, &pixbuf))
+        return pixbuf;
+
+    request = g_new0(ThumbRequest, 1);
+    request->track = track;
+    request->func = func;
+    request->user_data = user_data;
+    thumb_request_add(request, size);
+
+    return NULL;
+}
+
+/**
+ * thumbnail_cache_prefetch:
+ *
+ * Create the thumbnail of @track at @size in the background if it is
+ * not cached yet, e.g. for covers just outside the visible area.
+ */
+void thumbnail_cache_prefetch(Track *track, gint size) {
+    GdkPixbuf *pixbuf;
+
+    g_return_if_fail (track);
+
+    if (thumb_cache_lookup(track, size, &pixbuf) && pixbuf)
+        g_object_unref(pixbuf);
+}
+
+/**
+ * thumbnail_cache_get_sync:
+ *
+ * Get the artwork of @track scaled to fit into @size x @size right
+ * away, from the disk cache if possible. Meant for single covers
+ * shown in full, which are not kept in memory. @device is used to
+ * decode the artwork, so @track need not belong to a database (e.g. a
+ * copy being edited).
+ *
+ * Returns a new reference to the thumbnail, or NULL if the artwork
+ * could not be decoded.
+ */
+GdkPixbuf *thumbnail_cache_get_sync(Track *track, Itdb_Device *device, gint size) {
+    GdkPixbuf *pixbuf;
+    gchar *filename;
+
+    g_return_val_if_fail (track, NULL);
+
+    if (!track->artwork)
+        return NULL;
+
+    thumb_cache_init();
+    filename = thumb_disk_filename(track, size);
+    pixbuf = thumb_create(device, track->artwork, size, filename);
+    g_free(filename);
+
+    return pixbuf;
+}
+
+/* Describes the requests, entries and jobs to drop */
+typedef struct {
+    Track *track;
+    iTunesDB *itdb;
+    ThumbnailCacheFunc func;
+    gpointer user_data;
+} ThumbMatch;
+
+static gboolean thumb_request_matches(ThumbRequest *request, ThumbMatch *match) {
+    if (match->func)
+        return (request->func == match->func) && (request->user_data == match->user_data);
+    if (match->track)
+        return (request->track == match->track);
+    return (request->track->itdb == match->itdb);
+}
+
+/* Forget all requests described by @match */
+static void thumb_requests_remove(ThumbMatch *match) {
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, cache->requests);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        GList *requests = value, *gl = requests;
+
+        while (gl) {
+            GList *next = gl->next;
+
+            if (thumb_request_matches(gl->data, match)) {
+                g_free(gl->data);
+                requests = g_list_delete_link(requests, gl);
+            }
+            gl = next;
+        }
+
+        if (!requests)
+            g_hash_table_iter_remove(&iter);
+        else if (requests != value)
+            g_hash_table_iter_replace(&iter, requests);
+    }
+}
+
+static gboolean thumb_entry_matches(gpointer key, gpointer value, gpointer user_data) {
+    ThumbEntry *entry = value;
+    ThumbMatch *match = user_data;
+
+    if (match->track)
+        return (entry->key.artwork == match->track->artwork);
+    return (entry->itdb == match->itdb);
+}
+
+/* Drop the cache entries described by @match and make sure that jobs
+ * in flight for them don't add their result. Called with the mutex
+ * locked. */
+static void thumb_entries_remove(ThumbMatch *match) {
+    GHashTableIter iter;
+    gpointer value;
+
+    thumb_cache_remove_matching(thumb_entry_matches, match);
+
+    g_hash_table_iter_init(&iter, cache->jobs);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        ThumbJob *job = value;
+
+        if (match->track ? (job->key.artwork == match->track->artwork) : (job->itdb == match->itdb))
+            job->stale = TRUE;
+    }
+}
+
+/**
+ * thumbnail_cache_cancel:
+ *
+ * Forget all thumbnails requested with @func and @user_data. To be
+ * called before @user_data is freed.
+ */
+void thumbnail_cache_cancel(ThumbnailCacheFunc func, gpointer user_data) {
+    ThumbMatch match = { NULL, NULL, func, user_data };
+
+    g_return_if_fail (func);
+
+    if (!cache)
+        return;
+
+    thumb_requests_remove(&match);
+}
+
+/**
+ * thumbnail_cache_invalidate_track:
+ *
+ * Drop the thumbnails of @track. Must be called before the artwork of
+ * @track is changed, replaced or freed. Thumbnails requested for
+ * @track are created again from the new artwork.
+ *
+ * Unlike the other functions this one may be called from any thread,
+ * e.g. by the import workers setting artwork, by the thread owning
+ * @track at that time. It only touches the entries and jobs, which
+ * are guarded by the mutex, never the requests.
+ */
+void thumbnail_cache_invalidate_track(Track *track) {
+    ThumbMatch match = { track, NULL, NULL, NULL };
+    ThumbnailCache *current = g_atomic_pointer_get(&cache);
+
+    g_return_if_fail (track);
+
+    if (!current || !track->artwork)
+        return;
+
+    g_mutex_lock(&current->mutex);
+    thumb_entries_remove(&match);
+    g_mutex_unlock(&current->mutex);
+}
+
+/**
+ * thumbnail_cache_remove_track:
+ *
+ * Drop the thumbnails of @track and the requests waiting for them,
+ * as @track is removed from its database.
+ */
+void thumbnail_cache_remove_track(Track *track) {
+    ThumbMatch match = { track, NULL, NULL, NULL };
+
+    g_return_if_fail (track);
+
+    if (!cache)
+        return;
+
+    thumbnail_cache_invalidate_track(track);
+    thumb_requests_remove(&match);
+}
+
+/* TRUE if a job working on @itdb is decoding. Called with the mutex
+ * locked. */
+static gboolean thumb_jobs_running(iTunesDB *itdb) {
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, cache->jobs);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        ThumbJob *job = value;
+        if (job->running && (job->itdb == itdb))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * thumbnail_cache_cancel_itdb:
+ *
+ * Drop all thumbnails and requests belonging to @itdb and wait until
+ * no worker thread accesses its device anymore. To be called before
+ * @itdb is freed.
+ */
+void thumbnail_cache_cancel_itdb(iTunesDB *itdb) {
+    ThumbMatch match = { NULL, itdb, NULL, NULL };
+
+    g_return_if_fail (itdb);
+
+    if (!cache)
+        return;
+
+    thumb_requests_remove(&match);
+
+    g_mutex_lock(&cache->mutex);
+    thumb_entries_remove(&match);
+    while (thumb_jobs_running(itdb))
+        g_cond_wait(&cache->running_cond, &cache->mutex);
+    g_mutex_unlock(&cache->mutex);
+}
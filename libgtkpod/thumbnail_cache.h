@@ -0,0 +1,62 @@
+/*
+|  Copyright (C) 2002-2005 Jorg Schuler <jcsjcs at users sourceforge net>
+|  Part of the gtkpod project.
+|
+|  URL: http://www.gtkpod.org/
+|  URL: http://gtkpod.sourceforge.net/
+|
+|  This program is free software; you can redistribute it and/or modify
+|  it under the terms of the GNU General Public License as published by
+|  the Free Software Foundation; either version 2 of the License, or
+|  (at your option) any later version.
+|
+|  This program is distributed in the hope that it will be useful,
+|  but WITHOUT ANY WARRANTY; without even the implied warranty of
+|  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+|  GNU General Public License for more details.
+|
+|  You should have received a copy of the GNU General Public License
+|  along with this program; if not, write to the Free Software
+|  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+|
+|  iTunes and iPod are trademarks of Apple
+|
+|  This product is not supported/written/published by Apple!
+|
+|  $Id$
+*/
+
+#ifndef __THUMBNAIL_CACHE_H__
+#define __THUMBNAIL_CACHE_H__
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "itdb.h"
+
+/* The thumbnail cache decodes and scales track artwork on a pool of
+ * worker threads ("thumbnail_threads") and keeps the results in a
+ * memory-bounded LRU list keyed by the track's artwork and the size
+ * requested. Thumbnails are also kept on disk from one session to
+ * the next. All functions must be called from the main thread,
+ * except thumbnail_cache_invalidate_track() which takes the cache's
+ * mutex and may be called from any thread.
+ *
+ * Callbacks are invoked from the main loop with the track the
+ * thumbnail was requested for. @pixbuf is NULL if the artwork could
+ * not be decoded and must be referenced if it is kept. */
+typedef void (*ThumbnailCacheFunc) (Track *track, GdkPixbuf *pixbuf,
+				    gpointer user_data);
+
+GdkPixbuf *thumbnail_cache_get (Track *track, gint size,
+				ThumbnailCacheFunc func, gpointer user_data);
+GdkPixbuf *thumbnail_cache_get_sync (Track *track, Itdb_Device *device,
+				     gint size);
+void thumbnail_cache_prefetch (Track *track, gint size);
+void thumbnail_cache_cancel (ThumbnailCacheFunc func, gpointer user_data);
+void thumbnail_cache_invalidate_track (Track *track);
+void thumbnail_cache_remove_track (Track *track);
+void thumbnail_cache_cancel_itdb (iTunesDB *itdb);
+#endif
@@ -45,14 +45,6 @@
 #include <unistd.h>
 #include <glib/gi18n-lib.h>
 
-#define TOOLS_THREAD "Tools Thread"
-
-/* Structure to keep all necessary information */
-struct nm {
-    Track *track; /* track to be normalised */
-    GError *error; /* Errors generated during the normalisation */
-};
-
 /*pipe's definition*/
 enum {
     READ = 0, WRITE = 1
@@ -68,32 +60,136 @@ enum {
 
  ------------------------------------------------------------ */
 
-#ifdef G_THREADS_ENABLED
-
-static GMutex mutex;
-static GCond cond;
-
-static gboolean mutex_data = FALSE;
-#endif
+/* update the statusbar after every NM_BATCH_SIZE tracks */
+#define NM_BATCH_SIZE 20
 
-static GThread *_create_thread(GThreadFunc func, gpointer userdata) {
-    return g_thread_new (TOOLS_THREAD, func, userdata);
+/* One track normalised on the thread pool */
+typedef struct {
+    Track *track; /* track to be normalised */
+    guint32 old_soundcheck; /* soundcheck before the normalisation */
+    GError *error; /* Errors generated during the normalisation */
+    gboolean success;
+    gboolean done;
+} NmJob;
+
+typedef struct {
+    GMutex mutex;
+    GCond done_cond;
+    gboolean cancelled; /* skip jobs not yet started */
+} NmPipeline;
+
+/* A track normalised before nm_tracks_list() was cancelled, as it
+ was at the time */
+typedef struct {
+    gchar *pc_path; /* local file */
+    gchar *ipod_path; /* file on the iPod */
+    time_t mtime; /* of the local file */
+    guint32 size;
+    guint32 soundcheck; /* value set by the normalisation */
+} NmResumeEntry;
+
+/* When nm_tracks_list() is cancelled, the dbids of the tracks it was
+ given are kept in nm_resume_list and those of the tracks normalised
+ so far in nm_resume_done. Normalising the same list again skips the
+ latter unless their file changed in the meantime. Any other list, or
+ a run to the end, forgets them. */
+static GHashTable *nm_resume_list = NULL;
+static GHashTable *nm_resume_done = NULL;
+
+static void nm_resume_entry_free(gpointer data) {
+    NmResumeEntry *entry = data;
+
+    g_free(entry->pc_path);
+    g_free(entry->ipod_path);
+    g_free(entry);
 }
 
-static void _cond_signal() {
-    g_cond_signal (&cond);
+static void nm_resume_clear(void) {
+    if (nm_resume_list) {
+        g_hash_table_destroy(nm_resume_list);
+        nm_resume_list = NULL;
+    }
+    if (nm_resume_done) {
+        g_hash_table_destroy(nm_resume_done);
+        nm_resume_done = NULL;
+    }
 }
 
-static void _cond_timed_wait(glong timeout) {
-    g_cond_wait_until (&cond, &mutex, (gint64) timeout);
+/* Keep the resume information if it was recorded for the same tracks
+ as in @list, otherwise start recording it for @list */
+static void nm_resume_start(GList *list) {
+    GHashTable *dbids;
+    GList *gl;
+
+    dbids = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+    for (gl = list; gl; gl = gl->next) {
+        Track *track = gl->data;
+        if (track->dbid != 0) {
+            guint64 *dbid = g_new (guint64, 1);
+            *dbid = track->dbid;
+            g_hash_table_add(dbids, dbid);
+        }
+    }
+
+    if (nm_resume_list && (g_hash_table_size(nm_resume_list) == g_hash_table_size(dbids))) {
+        GHashTableIter iter;
+        gpointer dbid;
+        gboolean same = TRUE;
+
+        g_hash_table_iter_init(&iter, dbids);
+        while (same && g_hash_table_iter_next(&iter, &dbid, NULL))
+            same = g_hash_table_contains(nm_resume_list, dbid);
+        if (same) {
+            g_hash_table_destroy(dbids);
+            return;
+        }
+    }
+
+    nm_resume_clear();
+    nm_resume_list = dbids;
+    nm_resume_done = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, nm_resume_entry_free);
 }
 
-static void _lock_mutex() {
-    g_mutex_lock (&mutex);
+/* Remember that @track was normalised */
+static void nm_resume_add(Track *track) {
+    ExtraTrackData *etr = track->userdata;
+    NmResumeEntry *entry;
+    guint64 *dbid;
+
+    if (!nm_resume_done || (track->dbid == 0) || !etr)
+        return;
+
+    entry = g_new0 (NmResumeEntry, 1);
+    entry->pc_path = g_strdup(etr->pc_path_locale);
+    entry->ipod_path = g_strdup(track->ipod_path);
+    entry->mtime = etr->mtime;
+    entry->size = track->size;
+    entry->soundcheck = track->soundcheck;
+    dbid = g_new (guint64, 1);
+    *dbid = track->dbid;
+    g_hash_table_insert(nm_resume_done, dbid, entry);
 }
 
-static void _unlock_mutex() {
-    g_mutex_unlock (&mutex);
+/* TRUE if @track was normalised by the cancelled run and neither its
+ file nor its soundcheck changed since. Entries of tracks that did
+ change are dropped. */
+static gboolean nm_resume_skip(Track *track) {
+    ExtraTrackData *etr = track->userdata;
+    NmResumeEntry *entry;
+
+    if (!nm_resume_done || (track->dbid == 0) || !etr)
+        return FALSE;
+
+    entry = g_hash_table_lookup(nm_resume_done, &track->dbid);
+    if (!entry)
+        return FALSE;
+
+    if ((g_strcmp0(entry->pc_path, etr->pc_path_locale) == 0) && (g_strcmp0(entry->ipod_path, track->ipod_path) == 0)
+            && (entry->mtime == etr->mtime) && (entry->size == track->size) && (entry->soundcheck == track->soundcheck))
+        return TRUE;
+
+    g_hash_table_remove(nm_resume_done, &track->dbid);
+    return FALSE;
 }
 
 /* Run @command on @track_path.
@@ -302,18 +398,69 @@ static gboolean nm_get_soundcheck(Track *track, GError **error) {
     return FALSE;
 }
 
-#ifdef G_THREADS_ENABLED
-/* Threaded getTrackGain*/
-static gpointer th_nm_get_soundcheck(gpointer data) {
-    struct nm *nm = data;
-    gboolean success = nm_get_soundcheck(nm->track, &(nm->error));
-    _lock_mutex();
-    mutex_data = TRUE; /* signal that thread will end */
-    _cond_signal();
-    _unlock_mutex();
-    return GUINT_TO_POINTER(success);
+/* Thread pool function: normalise one track */
+static void nm_job_run(gpointer data, gpointer user_data) {
+    NmJob *job = data;
+    NmPipeline *pipeline = user_data;
+    gboolean cancelled;
+
+    g_mutex_lock(&pipeline->mutex);
+    cancelled = pipeline->cancelled;
+    g_mutex_unlock(&pipeline->mutex);
+
+    if (!cancelled)
+        job->success = nm_get_soundcheck(job->track, &job->error);
+
+    g_mutex_lock(&pipeline->mutex);
+    job->done = !cancelled;
+    g_cond_broadcast(&pipeline->done_cond);
+    g_mutex_unlock(&pipeline->mutex);
+}
+
+/* Wait for @job to finish while keeping the GUI alive */
+static void nm_job_wait(NmPipeline *pipeline, NmJob *job) {
+    g_mutex_lock(&pipeline->mutex);
+    while (!job->done) {
+        gint64 end_time = g_get_monotonic_time() + 20 * G_TIME_SPAN_MILLISECOND;
+        g_cond_wait_until(&pipeline->done_cond, &pipeline->mutex, end_time);
+        if (!job->done) {
+            g_mutex_unlock(&pipeline->mutex);
+            while (widgets_blocked && gtk_events_pending())
+                gtk_main_iteration();
+            g_mutex_lock(&pipeline->mutex);
+        }
+    }
+    g_mutex_unlock(&pipeline->mutex);
+}
+
+/* Take over the result of the finished @job on the main thread.
+ * Return value: TRUE if the track was normalised */
+static gboolean nm_job_apply(NmJob *job, GString *errors) {
+    Track *track = job->track;
+
+    if (!job->success) {
+        gchar *path = get_file_name_from_source(track, SOURCE_PREFER_LOCAL);
+
+        if (job->error) {
+            g_string_append_printf(errors, _("'%s-%s' (%s) could not be normalized. %s\n"), track->artist, track->title,
+                    path ? path : "", job->error->message);
+        }
+        else {
+            g_string_append_printf(errors, _("'%s-%s' (%s) could not be normalized. Unknown error.\n"), track->artist, track->title,
+                    path ? path : "");
+        }
+
+        g_free(path);
+        return FALSE;
+    }
+
+    nm_resume_add(track);
+    if (job->old_soundcheck != track->soundcheck) {
+        gtkpod_track_updated(track);
+        data_changed(track->itdb);
+    }
+    return TRUE;
 }
-#endif
 
 /* normalize the newly inserted tracks (i.e. non-transferred tracks) */
 void nm_new_tracks(iTunesDB *itdb) {
@@ -349,136 +496,148 @@ static void nm_report_errors_and_free(GString *errors) {
         NULL, /* cancel_handler,*/
         NULL, /* gpointer user_data1,*/
         NULL); /* gpointer user_data2,*/
-
-        g_string_free(errors, TRUE);
     }
+    if (errors)
+        g_string_free(errors, TRUE);
 }
 
+/**
+ * Normalise the tracks in @list.
+ *
+ * The gain of up to "normalization_threads" tracks is read or
+ * analysed concurrently on a thread pool, the results are taken over
+ * on the main thread in the order of @list. The normalisation can be
+ * stopped with the stop button of the statusbar. Normalising the
+ * same tracks again afterwards resumes where it was stopped, leaving
+ * out only the tracks whose file has not changed since.
+ */
 void nm_tracks_list(GList *list) {
-    gint count, succ_count, n;
-    gdouble fraction = 0;
-    gdouble old_fraction = 0;
-    guint32 old_soundcheck;
-    gboolean success;
-    gchar *progtext = NULL;
-    struct nm *nm;
+    gint count, succ_count, ticked, skipped, n, i, threads;
+    gint64 start_time;
+    gdouble seconds;
+    NmPipeline pipeline;
+    NmJob *jobs;
+    GThreadPool *pool;
+    GList *gl;
     GString *errors = g_string_new(""); /* Errors generated during the normalisation */
 
-#ifdef G_THREADS_ENABLED
-    GThread *thread = NULL;
-#endif
-
-    block_widgets();
-
-    while (widgets_blocked && gtk_events_pending())
-        gtk_main_iteration();
-
     /* count number of tracks to be normalized */
     n = g_list_length(list);
-    count = 0; /* tracks processed */
-    succ_count = 0; /* tracks normalized */
-
     if (n == 0) {
         // nothing to do
+        g_string_free(errors, TRUE);
         return;
     }
 
-    gtkpod_statusbar_reset_progress(100);
-
-    nm = g_malloc0(sizeof(struct nm));
-    while (list) {
-        nm->track = list->data;
-        nm->error = NULL;
+    block_widgets();
 
-        while (widgets_blocked && gtk_events_pending())
-            gtk_main_iteration();
+    while (widgets_blocked && gtk_events_pending())
+        gtk_main_iteration();
 
-        /* need to know so we can update the display when necessary */
-        old_soundcheck = nm->track->soundcheck;
-
-#ifdef G_THREADS_ENABLED
-        mutex_data = FALSE;
-
-        thread = _create_thread(th_nm_get_soundcheck, nm);
-        if (thread) {
-            _lock_mutex();
-            do {
-                while (widgets_blocked && gtk_events_pending())
-                    gtk_main_iteration();
-                /* wait a maximum of 20 ms */
-                _cond_timed_wait(20000);
-            }
-            while (!mutex_data);
-            success = GPOINTER_TO_UINT(g_thread_join (thread));
-            _unlock_mutex();
-        }
-        else {
-            g_warning("Thread creation failed, falling back to default.\n");
-            success = nm_get_soundcheck(nm->track, &(nm->error));
+    start_time = g_get_monotonic_time();
+    g_mutex_init(&pipeline.mutex);
+    g_cond_init(&pipeline.done_cond);
+    pipeline.cancelled = FALSE;
+    threads = get_worker_thread_count("normalization_threads");
+    pool = g_thread_pool_new(nm_job_run, &pipeline, threads, FALSE, NULL);
+    if (!pool)
+        g_warning("Thread pool creation failed, falling back to default.\n");
+
+    nm_resume_start(list);
+    jobs = g_new0(NmJob, n);
+    skipped = 0;
+    for (gl = list, i = 0; gl; gl = gl->next) {
+        Track *track = gl->data;
 
+        if (nm_resume_skip(track)) {
+            /* already normalised before the last run was cancelled */
+            ++skipped;
+            continue;
         }
-#else
-        success = nm_get_soundcheck (nm->track, nm->error);
-#endif
-
-        /*normalization part*/
-        if (!success) {
-            gchar *path = get_file_name_from_source(nm->track, SOURCE_PREFER_LOCAL);
+        jobs[i].track = track;
+        /* need to know so we can update the display when necessary */
+        jobs[i].old_soundcheck = track->soundcheck;
+        if (pool)
+            g_thread_pool_push(pool, &jobs[i], NULL);
+        ++i;
+    }
+    n = i;
+    if (skipped > 0)
+        gtkpod_statusbar_message(ngettext ("Resuming normalization, skipping %d track normalized before.",
+                "Resuming normalization, skipping %d tracks normalized before.", skipped), skipped);
+
+    gtkpod_statusbar_reset_progress(n);
+    gtkpod_statusbar_set_cancellable(TRUE);
+    count = ticked = 0; /* tracks processed */
+    succ_count = 0; /* tracks normalized */
+    for (i = 0; i < n; ++i) {
+        NmJob *job = &jobs[i];
 
-            if (nm->error) {
-                errors =
-                        g_string_append(errors, g_strdup_printf(_("'%s-%s' (%s) could not be normalized. %s\n"), nm->track->artist, nm->track->title,
-                                path ? path : "", nm->error->message));
-            }
-            else {
-                errors =
-                        g_string_append(errors, g_strdup_printf(_("'%s-%s' (%s) could not be normalized. Unknown error.\n"), nm->track->artist, nm->track->title,
-                                path ? path : ""));
-            }
+        if (gtkpod_statusbar_progress_cancelled())
+            break;
 
-            g_free(path);
+        if (pool) {
+            nm_job_wait(&pipeline, job);
         }
         else {
-            ++succ_count;
-            if (old_soundcheck != nm->track->soundcheck) {
-                gtkpod_track_updated(nm->track);
-                data_changed(nm->track->itdb);
-            }
+            job->success = nm_get_soundcheck(job->track, &job->error);
+            job->done = TRUE;
         }
-        /*end normalization*/
-
-        ++count;
-        fraction = (gdouble) count / (gdouble) n;
-        progtext = g_strdup_printf(_("%d%% (%d tracks left)"), count * 100 / n, n - count);
-
-        gdouble ticks = fraction - old_fraction;
-        gtkpod_statusbar_increment_progress_ticks(ticks * 100, progtext);
 
-        old_fraction = fraction;
-        g_free(progtext);
+        if (nm_job_apply(job, errors))
+            ++succ_count;
 
-        if (fraction == 1) {
-            /* All finished */
-            gtkpod_statusbar_reset_progress(100);
-            gtkpod_statusbar_message(ngettext ("Normalized %d of %d track.", "Normalized %d of %d tracks.", n), count, n);
+        ++count;
+        if (((count % NM_BATCH_SIZE) == 1) || (count == n)) { /* update for count == 1, 21, 41 ... and for count == n */
+            gchar *progtext = g_strdup_printf(_("%d%% (%d tracks left)"), count * 100 / n, n - count);
+            gtkpod_statusbar_increment_progress_ticks(count - ticked, progtext);
+            ticked = count;
+            g_free(progtext);
+            while (widgets_blocked && gtk_events_pending())
+                gtk_main_iteration();
         }
+    }
 
-        while (widgets_blocked && gtk_events_pending())
-            gtk_main_iteration();
-
-        list = g_list_next(list);
-
-        if (nm->error)
-            g_error_free(nm->error);
-
-    } /*end while*/
+    if (count < n) {
+        /* stop the jobs that have not started yet and take over the
+         ones that finished in the meantime */
+        g_mutex_lock(&pipeline.mutex);
+        pipeline.cancelled = TRUE;
+        g_mutex_unlock(&pipeline.mutex);
+    }
+    if (pool)
+        g_thread_pool_free(pool, FALSE, TRUE);
+    for (; i < n; ++i) {
+        if (jobs[i].done) {
+            if (nm_job_apply(&jobs[i], errors))
+                ++succ_count;
+            ++count;
+        }
+    }
+    for (i = 0; i < n; ++i) {
+        if (jobs[i].error)
+            g_error_free(jobs[i].error);
+    }
+    g_free(jobs);
+    g_cond_clear(&pipeline.done_cond);
+    g_mutex_clear(&pipeline.mutex);
 
-    g_free(nm);
+    seconds = (gdouble) (g_get_monotonic_time() - start_time) / G_USEC_PER_SEC;
+    gtkpod_statusbar_set_cancellable(FALSE);
+    gtkpod_statusbar_reset_progress(100);
 
     nm_report_errors_and_free(errors);
 
-    gtkpod_statusbar_message(ngettext ("Normalized %d of %d tracks.",
-            "Normalized %d of %d tracks.", n), count, n);
+    if (count < n) {
+        gtkpod_statusbar_message(ngettext ("Normalization cancelled after %d of %d track. Normalize again to resume.",
+                "Normalization cancelled after %d of %d tracks. Normalize again to resume.", count), count, n);
+    }
+    else {
+        nm_resume_clear();
+        gtkpod_statusbar_message(ngettext ("Normalized %d of %d track in %.1f seconds (%.1f tracks per second, %d threads).",
+                "Normalized %d of %d tracks in %.1f seconds (%.1f tracks per second, %d threads).", n), succ_count, n,
+                seconds, (seconds > 0) ? count / seconds : 0.0, pool ? threads : 1);
+    }
 
     release_widgets();
 }
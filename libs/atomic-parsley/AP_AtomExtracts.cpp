@@ -120,7 +120,7 @@ char* ExtractUTC(uint32_t total_secs) {
     //    + 1,468,800 (60 * 60 * 24 * 17 leap days in 01/01/1904 to 01/01/1970 duration)
     //= 2,082,844,800
     total_secs -= 2082844800;
-    static char utc_time[50];
+    static AP_THREAD_LOCAL char utc_time[50];
     memset(utc_time, 0, 50);
 
     strftime(*&utc_time, 50, "%a %b %e %k:%M:%S %Y", gmtime((time_t*) &total_secs));
@@ -146,7 +146,7 @@ char* secsTOtime(double seconds) {
     whole_secs -= time_duration.minutes * 60;
     time_duration.seconds = whole_secs;
 
-    static char hhmmss_time[20];
+    static AP_THREAD_LOCAL char hhmmss_time[20];
     memset(hhmmss_time, 0, 20);
     char milli[5];
     memset(milli, 0, 5);
@@ -792,12 +792,12 @@ void calculate_sample_size(char* uint32_buffer, FILE* isofile, short stsz_atom,
     uint32_t sample_count = 0;
     uint64_t total_size = 0;
 
-    sample_size = APar_read32(uint32_buffer, isofile, parsedAtoms[stsz_atom].AtomicStart + 12);
-    sample_count = APar_read32(uint32_buffer, isofile, parsedAtoms[stsz_atom].AtomicStart + 16);
+    sample_size = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[stsz_atom].AtomicStart + 12);
+    sample_count = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[stsz_atom].AtomicStart + 16);
 
     if (sample_size == 0) {
-        for (uint32_t atom_offset = 20; atom_offset < parsedAtoms[stsz_atom].AtomicLength; atom_offset += 4) {
-            total_size += (uint64_t) APar_read32(uint32_buffer, isofile, parsedAtoms[stsz_atom].AtomicStart
+        for (uint32_t atom_offset = 20; atom_offset < ap_ctx->parsedAtoms[stsz_atom].AtomicLength; atom_offset += 4) {
+            total_size += (uint64_t) APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[stsz_atom].AtomicStart
                     + atom_offset);
         }
     }
@@ -821,9 +821,9 @@ void APar_TrackLevelInfo(Trackage* track, const char* track_search_atom_name) {
     uint8_t track_tally = 0;
     short iter = 0;
 
-    while (parsedAtoms[iter].NextAtomNumber != 0) {
+    while (ap_ctx->parsedAtoms[iter].NextAtomNumber != 0) {
 
-        if (strncmp(parsedAtoms[iter].AtomicName, "trak", 4) == 0) {
+        if (strncmp(ap_ctx->parsedAtoms[iter].AtomicName, "trak", 4) == 0) {
             track_tally += 1;
             if (track->track_num == 0) {
                 track->total_tracks += 1;
@@ -831,24 +831,24 @@ void APar_TrackLevelInfo(Trackage* track, const char* track_search_atom_name) {
             }
             else if (track->track_num == track_tally) {
 
-                short next_atom = parsedAtoms[iter].NextAtomNumber;
-                while (parsedAtoms[next_atom].AtomicLevel > parsedAtoms[iter].AtomicLevel) {
+                short next_atom = ap_ctx->parsedAtoms[iter].NextAtomNumber;
+                while (ap_ctx->parsedAtoms[next_atom].AtomicLevel > ap_ctx->parsedAtoms[iter].AtomicLevel) {
 
-                    if (strncmp(parsedAtoms[next_atom].AtomicName, track_search_atom_name, 4) == 0) {
+                    if (strncmp(ap_ctx->parsedAtoms[next_atom].AtomicName, track_search_atom_name, 4) == 0) {
 
-                        track->track_atom = parsedAtoms[next_atom].AtomicNumber;
+                        track->track_atom = ap_ctx->parsedAtoms[next_atom].AtomicNumber;
                         return;
                     }
                     else {
-                        next_atom = parsedAtoms[next_atom].NextAtomNumber;
+                        next_atom = ap_ctx->parsedAtoms[next_atom].NextAtomNumber;
                     }
-                    if (parsedAtoms[next_atom].AtomicLevel == parsedAtoms[iter].AtomicLevel) {
+                    if (ap_ctx->parsedAtoms[next_atom].AtomicLevel == ap_ctx->parsedAtoms[iter].AtomicLevel) {
                         track->track_atom = 0;
                     }
                 }
             }
         }
-        iter = parsedAtoms[iter].NextAtomNumber;
+        iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
     }
     return;
 }
@@ -906,9 +906,9 @@ void APar_Extract_iods_Info(FILE* isofile, AtomicInfo* iods_atom) {
  ----------------------*/
 void APar_Extract_AMR_Info(char* uint32_buffer, FILE* isofile, short track_level_atom, TrackInfo* track_info) {
     uint32_t amr_specific_offet = 8;
-    APar_readX(track_info->encoder_name, isofile, parsedAtoms[track_level_atom].AtomicStart + amr_specific_offet, 4);
+    APar_readX(track_info->encoder_name, isofile, ap_ctx->parsedAtoms[track_level_atom].AtomicStart + amr_specific_offet, 4);
     if (track_info->track_codec == 0x73616D72 || track_info->track_codec == 0x73617762) { //samr or sawb contain modes only
-        track_info->amr_modes = APar_read16(uint32_buffer, isofile, parsedAtoms[track_level_atom].AtomicStart
+        track_info->amr_modes = APar_read16(uint32_buffer, isofile, ap_ctx->parsedAtoms[track_level_atom].AtomicStart
                 + amr_specific_offet + 4 + 1);
     }
     return;
@@ -925,9 +925,9 @@ void APar_Extract_AMR_Info(char* uint32_buffer, FILE* isofile, short track_level
  ----------------------*/
 void APar_Extract_d263_Info(char* uint32_buffer, FILE* isofile, short track_level_atom, TrackInfo* track_info) {
     uint32_t offset_into_d263 = 8;
-    APar_readX(track_info->encoder_name, isofile, parsedAtoms[track_level_atom].AtomicStart + offset_into_d263, 4);
-    track_info->level = APar_read8(isofile, parsedAtoms[track_level_atom].AtomicStart + offset_into_d263 + 4 + 1);
-    track_info->profile = APar_read8(isofile, parsedAtoms[track_level_atom].AtomicStart + offset_into_d263 + 4 + 2);
+    APar_readX(track_info->encoder_name, isofile, ap_ctx->parsedAtoms[track_level_atom].AtomicStart + offset_into_d263, 4);
+    track_info->level = APar_read8(isofile, ap_ctx->parsedAtoms[track_level_atom].AtomicStart + offset_into_d263 + 4 + 1);
+    track_info->profile = APar_read8(isofile, ap_ctx->parsedAtoms[track_level_atom].AtomicStart + offset_into_d263 + 4 + 2);
     //possible 'bitr' bitrate box afterwards
     return;
 }
@@ -947,13 +947,13 @@ void APar_Extract_d263_Info(char* uint32_buffer, FILE* isofile, short track_leve
 void APar_Extract_esds_Info(char* uint32_buffer, FILE* isofile, short track_level_atom, TrackInfo* track_info) {
     uint32_t offset_into_stsd = 0;
 
-    while (offset_into_stsd < parsedAtoms[track_level_atom].AtomicLength) {
+    while (offset_into_stsd < ap_ctx->parsedAtoms[track_level_atom].AtomicLength) {
         offset_into_stsd++;
-        if (APar_read32(uint32_buffer, isofile, parsedAtoms[track_level_atom].AtomicStart + offset_into_stsd)
+        if (APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track_level_atom].AtomicStart + offset_into_stsd)
                 == 0x65736473) {
             track_info->contains_esds = true;
 
-            uint32_t esds_start = parsedAtoms[track_level_atom].AtomicStart + offset_into_stsd - 4;
+            uint32_t esds_start = ap_ctx->parsedAtoms[track_level_atom].AtomicStart + offset_into_stsd - 4;
             uint32_t esds_length = APar_read32(uint32_buffer, isofile, esds_start);
             uint32_t offset_into_esds = 12; //4bytes length + 4 bytes name + 4bytes null
 
@@ -1038,12 +1038,12 @@ void APar_Extract_esds_Info(char* uint32_buffer, FILE* isofile, short track_leve
             }
 
         }
-        if (offset_into_stsd > parsedAtoms[track_level_atom].AtomicLength) {
+        if (offset_into_stsd > ap_ctx->parsedAtoms[track_level_atom].AtomicLength) {
             break;
         }
     }
     if (track_info->section5_length == 0 && (track_info->type_of_track & AUDIO_TRACK)) {
-        track_info->channels = APar_read16(uint32_buffer, isofile, parsedAtoms[track_level_atom].AtomicStart + 40);
+        track_info->channels = APar_read16(uint32_buffer, isofile, ap_ctx->parsedAtoms[track_level_atom].AtomicStart + 40);
     }
     return;
 }
@@ -1062,19 +1062,19 @@ void APar_ExtractTrackDetails(char* uint32_buffer, FILE* isofile, Trackage* trac
     uint32_t _offset = 0;
 
     APar_TrackLevelInfo(track, "tkhd");
-    if (APar_read8(isofile, parsedAtoms[track->track_atom].AtomicStart + 8) == 0) {
-        if (APar_read8(isofile, parsedAtoms[track->track_atom].AtomicStart + 11) & 1) {
+    if (APar_read8(isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 8) == 0) {
+        if (APar_read8(isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 11) & 1) {
             track_info->track_enabled = true;
         }
-        track_info->creation_time = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart
+        track_info->creation_time = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart
                 + 12);
-        track_info->modified_time = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart
+        track_info->modified_time = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart
                 + 16);
-        track_info->track_id = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 20);
-        track_info->duration = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 28);
+        track_info->track_id = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 20);
+        track_info->duration = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 28);
     }
-    else if (APar_read8(isofile, parsedAtoms[track->track_atom].AtomicStart + 8) == 1) {
-        if (APar_read8(isofile, parsedAtoms[track->track_atom].AtomicStart + 11) & 1) {
+    else if (APar_read8(isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 8) == 1) {
+        if (APar_read8(isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 11) & 1) {
             track_info->track_enabled = true;
         }
         //version 1 has 64-bit creation/modified times which AP currently doesn't support
@@ -1082,22 +1082,22 @@ void APar_ExtractTrackDetails(char* uint32_buffer, FILE* isofile, Trackage* trac
         //        + 12);
         //track_info->modified_time = APar_read32(uint64_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart
         //        + 20);
-        track_info->track_id = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 28);
-        track_info->duration = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 36);
+        track_info->track_id = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 28);
+        track_info->duration = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 36);
     }
 
     //language code
     APar_TrackLevelInfo(track, "mdhd");
-    track_info->media_sample_rate = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 20);
+    track_info->media_sample_rate = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 20);
     memset(uint32_buffer, 0, 5);
-    uint16_t packed_language = APar_read16(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 28);
+    uint16_t packed_language = APar_read16(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 28);
     memset(track_info->unpacked_lang, 0, 4);
     APar_UnpackLanguage(track_info->unpacked_lang, packed_language); //http://www.w3.org/WAI/ER/IG/ert/iso639.htm
 
     //track handler type
     APar_TrackLevelInfo(track, "hdlr");
     memset(uint32_buffer, 0, 5);
-    track_info->track_type = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 16);
+    track_info->track_type = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 16);
     switch (track_info->track_type)
     {
     case 0x736F756E: //soun
@@ -1112,21 +1112,21 @@ void APar_ExtractTrackDetails(char* uint32_buffer, FILE* isofile, Trackage* trac
     default:
         break;
     }
-    if (parsedAtoms[track->track_atom].AtomicLength > 34) {
+    if (ap_ctx->parsedAtoms[track->track_atom].AtomicLength > 34) {
         memset(track_info->track_hdlr_name, 0, 100);
-        APar_readX(track_info->track_hdlr_name, isofile, parsedAtoms[track->track_atom].AtomicStart + 32, parsedAtoms[track->track_atom].AtomicLength
+        APar_readX(track_info->track_hdlr_name, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 32, ap_ctx->parsedAtoms[track->track_atom].AtomicLength
                 - 32);
     }
 
     //codec section
     APar_TrackLevelInfo(track, "stsd");
     memset(uint32_buffer, 0, 5);
-    track_info->track_codec = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart + 20);
+    track_info->track_codec = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 20);
 
     if (track_info->type_of_track & VIDEO_TRACK) { //vide
-        track_info->video_width = APar_read16(uint32_buffer, isofile, parsedAtoms[track->track_atom + 1].AtomicStart
+        track_info->video_width = APar_read16(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom + 1].AtomicStart
                 + 32);
-        track_info->video_height = APar_read16(uint32_buffer, isofile, parsedAtoms[track->track_atom + 1].AtomicStart
+        track_info->video_height = APar_read16(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom + 1].AtomicStart
                 + 34);
         track_info->macroblocks = (track_info->video_width / 16) * (track_info->video_height / 16);
 
@@ -1136,25 +1136,25 @@ void APar_ExtractTrackDetails(char* uint32_buffer, FILE* isofile, Trackage* trac
             APar_TrackLevelInfo(track, "avcC");
             //get avc1 profile/level; atom 'avcC' is :
             //byte 1	configurationVersion    byte 2	AVCProfileIndication    byte 3  profile_compatibility    byte 4	AVCLevelIndication
-            track_info->avc_version = APar_read8(isofile, parsedAtoms[track->track_atom].AtomicStart + 8);
+            track_info->avc_version = APar_read8(isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 8);
             if (track_info->avc_version == 1) {
-                track_info->profile = APar_read8(isofile, parsedAtoms[track->track_atom].AtomicStart + 9);
+                track_info->profile = APar_read8(isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 9);
                 //uint8_t profile_compatibility = APar_read8(isofile, parsedAtoms[track.track_atom].AtomicStart + 10); /* is this reserved ?? */
-                track_info->level = APar_read8(isofile, parsedAtoms[track->track_atom].AtomicStart + 11);
+                track_info->level = APar_read8(isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + 11);
             }
 
             //avc1 doesn't have a hardcoded bitrate, so calculate it (off of stsz table summing) later
         }
         else if (track_info->track_codec == 0x73323633) { //s263
             APar_TrackLevelInfo(track, "d263");
-            if (memcmp(parsedAtoms[track->track_atom].AtomicName, "d263", 4) == 0) {
+            if (memcmp(ap_ctx->parsedAtoms[track->track_atom].AtomicName, "d263", 4) == 0) {
                 APar_Extract_d263_Info(uint32_buffer, isofile, track->track_atom, track_info);
             }
 
         }
         else { //mp4v
             APar_TrackLevelInfo(track, "esds");
-            if (memcmp(parsedAtoms[track->track_atom].AtomicName, "esds", 4) == 0) {
+            if (memcmp(ap_ctx->parsedAtoms[track->track_atom].AtomicName, "esds", 4) == 0) {
                 APar_Extract_esds_Info(uint32_buffer, isofile, track->track_atom - 1, track_info); //right, backtrack to the atom before 'esds' so we can offset_into_stsd++
             }
             else if (track_info->track_codec == 0x73323633) { //s263
@@ -1184,13 +1184,13 @@ void APar_ExtractTrackDetails(char* uint32_buffer, FILE* isofile, Trackage* trac
     if (((track_info->type_of_track & AUDIO_TRACK) || (track_info->type_of_track & VIDEO_TRACK))
             && track_info->avg_bitrate == 0) {
         if (track_info->track_codec == 0x616C6163) { //alac
-            track_info->channels = APar_read16(uint32_buffer, isofile, parsedAtoms[track->track_atom + 1].AtomicStart
+            track_info->channels = APar_read16(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom + 1].AtomicStart
                     + 24);
         }
     }
 
     APar_TrackLevelInfo(track, "stsz");
-    if (memcmp(parsedAtoms[track->track_atom].AtomicName, "stsz", 4) == 0) {
+    if (memcmp(ap_ctx->parsedAtoms[track->track_atom].AtomicName, "stsz", 4) == 0) {
         calculate_sample_size(uint32_buffer, isofile, track->track_atom, track_info);
     }
 
@@ -1199,7 +1199,7 @@ void APar_ExtractTrackDetails(char* uint32_buffer, FILE* isofile, Trackage* trac
         track_info->type_of_track += DRM_PROTECTED_TRACK;
         APar_TrackLevelInfo(track, "frma");
         memset(uint32_buffer, 0, 5);
-        track_info->protected_codec = APar_read32(uint32_buffer, isofile, parsedAtoms[track->track_atom].AtomicStart
+        track_info->protected_codec = APar_read32(uint32_buffer, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart
                 + 8);
     }
 
@@ -1210,10 +1210,10 @@ void APar_ExtractTrackDetails(char* uint32_buffer, FILE* isofile, Trackage* trac
         //technically, user_data_start_code should be tested aginst 0x000001B2; TODO: it should only be read up to section 3's length too
         _offset = APar_FindValueInAtom(uint32_buffer, isofile, track->track_atom, 24, 0x01B2);
 
-        if (_offset > 0 && _offset < parsedAtoms[track->track_atom].AtomicLength) {
+        if (_offset > 0 && _offset < ap_ctx->parsedAtoms[track->track_atom].AtomicLength) {
             _offset += 2;
-            memset(track_info->encoder_name, 0, parsedAtoms[track->track_atom].AtomicLength - _offset);
-            APar_readX(track_info->encoder_name, isofile, parsedAtoms[track->track_atom].AtomicStart + _offset, parsedAtoms[track->track_atom].AtomicLength
+            memset(track_info->encoder_name, 0, ap_ctx->parsedAtoms[track->track_atom].AtomicLength - _offset);
+            APar_readX(track_info->encoder_name, isofile, ap_ctx->parsedAtoms[track->track_atom].AtomicStart + _offset, ap_ctx->parsedAtoms[track->track_atom].AtomicLength
                     - _offset);
         }
     }
@@ -1252,9 +1252,9 @@ void APar_ExtractMovieDetails(char* uint32_buffer, FILE* isofile, MovieInfo *mov
 
     movie_info->seconds = (float) movie_info->duration / (float) movie_info->timescale;
 #if defined (_MSC_VER)
-    __int64 media_bits = (__int64)mdatData * 8;
+    __int64 media_bits = (__int64)ap_ctx->mdatData * 8;
 #else
-    uint64_t media_bits = (uint64_t) mdatData * 8;
+    uint64_t media_bits = (uint64_t) ap_ctx->mdatData * 8;
 #endif
     movie_info->simple_bitrate_calc = ((double) media_bits / movie_info->seconds) / 1000.0;
 }
@@ -1434,7 +1434,7 @@ void APar_ExtractBrands(char* filepath) {
     }
 
     fprintf(stdout, " Tagging schemes available:\n");
-    switch (metadata_style) {
+    switch (ap_ctx->metadata_style) {
     case ITUNES_STYLE: {
         fprintf(stdout, "   iTunes-style metadata allowed.\n");
         break;
@@ -84,22 +84,22 @@ void APar_readX(char* buffer, FILE* m4afile, uint32_t pos, uint32_t length) {
 uint32_t APar_FindValueInAtom(char* uint32_buffer, FILE* m4afile, short an_atom, uint32_t start_position, uint32_t eval_number) {
     uint32_t current_pos = start_position;
     memset(uint32_buffer, 0, 5);
-    while (current_pos <= parsedAtoms[an_atom].AtomicLength) {
+    while (current_pos <= ap_ctx->parsedAtoms[an_atom].AtomicLength) {
         current_pos++;
         if (eval_number > 65535) {
             //current_pos +=4;
-            if (APar_read32(uint32_buffer, m4afile, parsedAtoms[an_atom].AtomicStart + current_pos) == eval_number) {
+            if (APar_read32(uint32_buffer, m4afile, ap_ctx->parsedAtoms[an_atom].AtomicStart + current_pos) == eval_number) {
                 break;
             }
         }
         else {
             //current_pos +=2;
-            if (APar_read16(uint32_buffer, m4afile, parsedAtoms[an_atom].AtomicStart + current_pos)
+            if (APar_read16(uint32_buffer, m4afile, ap_ctx->parsedAtoms[an_atom].AtomicStart + current_pos)
                     == (uint16_t) eval_number) {
                 break;
             }
         }
-        if (current_pos >= parsedAtoms[an_atom].AtomicLength) {
+        if (current_pos >= ap_ctx->parsedAtoms[an_atom].AtomicLength) {
             current_pos = 0;
             break;
         }
@@ -50,63 +50,21 @@
 //                               Global Variables                                    //
 ///////////////////////////////////////////////////////////////////////////////////////
 
-static bool inited = false;
+// Everything describing the file being worked on lives in an
+// AtomicContext (see AtomicParsley.h), so that several files can be
+// handled at the same time from different threads.
+AP_THREAD_LOCAL AtomicContext *ap_ctx = NULL;
 
-int metadata_style;
-uint32_t mdatData;
-AtomicInfo parsedAtoms[MAX_ATOMS];
+// shared by all contexts; these never change while files are processed
+static bool svn_build = false; //controls which type of versioning - release number
 
-static bool modified_atoms;
-static bool alter_original;
-
-static bool svn_build; //controls which type of versioning - release number
-
-static FILE* source_file;
-static uint32_t file_size;
-
-static short atom_number;
-static uint8_t generalAtomicLevel;
-
-static bool file_opened;
-static bool parsedfile;
-static bool move_moov_atom;
-static bool moov_atom_was_mooved;
-static AtomicInfo* hdlrAtom;
-static AtomicInfo* udtaAtom;
-static bool complete_free_space_erasure;
-static bool initial_optimize_pass;
-static bool psp_brand;
-static bool prevent_update_using_padding;
-static bool tree_display_only;
-
-static uint32_t max_buffer;
-
-static uint32_t bytes_before_mdat;
-static uint32_t bytes_into_mdat;
-static uint64_t mdat_supplemental_offset;
-static uint32_t removed_bytes_tally;
-static uint32_t new_file_size; //used for the progressbar
-static uint32_t brand;
-
-static uint32_t gapless_void_padding; //possibly used in the context of gapless playback support by Apple
-
-static struct udta_stats udta_dynamics;
-static struct padding_preferences pad_prefs;
-
-static bool contains_unsupported_64_bit_atom; //reminder that there are some 64-bit files that aren't yet supported (and where that limit is set)
-
-static short max_display_width;
-static char* file_progress_buffer;
-
-static struct PicPrefs myPicturePrefs;
-static bool parsed_prefs;
-static char* twenty_byte_buffer;
-
-static EmployedCodecs track_codecs;
-
-static uint8_t UnicodeOutputStatus; //on windows, controls whether input/output strings are utf16 or raw utf8; reset in wmain()
+#if defined (WIN32) || defined (__CYGWIN__)
+static short max_display_width = 45;
+#else
+static short max_display_width = 75;
+#endif
 
-static uint8_t forced_suffix_type;
+static uint8_t UnicodeOutputStatus = UNIVERSAL_UTF8; //on windows, controls whether input/output strings are utf16 or raw utf8; reset in wmain()
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //                                Versioning                                         //
@@ -196,65 +154,65 @@ off_t findFileSize(const char *utf8_filepath) {
 }
 
 static void APar_Init() {
-    if (inited)
+    if (ap_ctx->inited)
         return;
 
     // Init only need to be called once
-    inited = true;
+    ap_ctx->inited = true;
 
-    modified_atoms = false;
-    alter_original = false;
+    ap_ctx->modified_atoms = false;
+    ap_ctx->alter_original = false;
 
-    svn_build = false;
+    ap_ctx->source_file = NULL;
 
-    source_file = NULL;
+    ap_ctx->atom_number = 0;
+    ap_ctx->generalAtomicLevel = 1;
 
-    atom_number = 0;
-    generalAtomicLevel = 1;
+    ap_ctx->file_opened = false;
+    ap_ctx->parsedfile = false;
+    ap_ctx->move_moov_atom = true;
+    ap_ctx->moov_atom_was_mooved = false;
+    ap_ctx->hdlrAtom = NULL;
+    ap_ctx->udtaAtom = NULL;
+    ap_ctx->complete_free_space_erasure = false;
+    ap_ctx->initial_optimize_pass = true;
+    ap_ctx->psp_brand = false;
+    ap_ctx->prevent_update_using_padding = false;
+    ap_ctx->metadata_style = UNDEFINED_STYLE;
+    ap_ctx->tree_display_only = false;
 
-    file_opened = false;
-    parsedfile = false;
-    move_moov_atom = true;
-    moov_atom_was_mooved = false;
-    hdlrAtom = NULL;
-    udtaAtom = NULL;
-    complete_free_space_erasure = false;
-    initial_optimize_pass = true;
-    psp_brand = false;
-    prevent_update_using_padding = false;
-    metadata_style = UNDEFINED_STYLE;
-    tree_display_only = false;
+    ap_ctx->max_buffer = 4096 * 125; // increased to 512KB
 
-    max_buffer = 4096 * 125; // increased to 512KB
+    ap_ctx->bytes_before_mdat = 0;
+    ap_ctx->bytes_into_mdat = 0;
+    ap_ctx->mdat_supplemental_offset = 0;
+    ap_ctx->removed_bytes_tally = 0;
+    ap_ctx->new_file_size = 0;
+    ap_ctx->brand = 0;
+    ap_ctx->mdatData = 0;
 
-    bytes_before_mdat = 0;
-    bytes_into_mdat = 0;
-    mdat_supplemental_offset = 0;
-    removed_bytes_tally = 0;
-    new_file_size = 0;
-    brand = 0;
-    mdatData = 0;
+    ap_ctx->gapless_void_padding = 0;
 
-    gapless_void_padding = 0;
+    ap_ctx->contains_unsupported_64_bit_atom = false;
 
-    contains_unsupported_64_bit_atom = false;
+    ap_ctx->file_progress_buffer = (char*) calloc(1, sizeof(char) * (max_display_width + 50));
 
-#if defined (WIN32) || defined (__CYGWIN__)
-    max_display_width = 45;
-#else
-    max_display_width = 75;
-#endif
+    ap_ctx->parsed_prefs = false;
+    ap_ctx->twenty_byte_buffer = (char *) malloc(sizeof(char) * 20);
 
-    file_progress_buffer = (char*) calloc(1, sizeof(char) * (max_display_width + 50));
+    ap_ctx->track_codecs = EmployedCodecs();
 
-    parsed_prefs = false;
-    twenty_byte_buffer = (char *) malloc(sizeof(char) * 20);
+    ap_ctx->forced_suffix_type = NO_TYPE_FORCING;
 
-    track_codecs = EmployedCodecs();
+    ap_ctx->pad_prefs.default_padding_size = DEFAULT_PADDING_LENGTH;
+    ap_ctx->pad_prefs.minimum_required_padding_size = MINIMUM_REQUIRED_PADDING_LENGTH;
+    ap_ctx->pad_prefs.maximum_present_padding_size = MAXIMUM_REQUIRED_PADDING_LENGTH;
 
-    UnicodeOutputStatus = UNIVERSAL_UTF8;
+    ap_ctx->passed_mdat = false;
 
-    forced_suffix_type = NO_TYPE_FORCING;
+    ap_ctx->tfhd_changed = false;
+    ap_ctx->tfhd_determined_offset = false;
+    ap_ctx->tfhd_base_offset = 0;
 }
 
 /*----------------------
@@ -302,17 +260,17 @@ FILE* APar_OpenFile(const char* utf8_filepath, const char* file_flags) {
 FILE* openSomeFile(const char* utf8file, bool open) {
     APar_Init();
 
-    if (open && !file_opened) {
-        source_file = APar_OpenFile(utf8file, "rb");
-        if (source_file != NULL) {
-            file_opened = true;
+    if (open && !ap_ctx->file_opened) {
+        ap_ctx->source_file = APar_OpenFile(utf8file, "rb");
+        if (ap_ctx->source_file != NULL) {
+            ap_ctx->file_opened = true;
         }
     }
     else {
-        fclose(source_file);
-        file_opened = false;
+        fclose(ap_ctx->source_file);
+        ap_ctx->file_opened = false;
     }
-    return source_file;
+    return ap_ctx->source_file;
 }
 
 void TestFileExistence(const char *filePath, bool errorOut) {
@@ -331,11 +289,28 @@ uint32_t APar_ReadFile(char* destination_buffer, FILE* a_file, uint32_t bytes_to
     if (destination_buffer != NULL) {
         fseeko(a_file, 0, SEEK_SET); // not that 2gb support is required - malloc would probably have a few issues
         bytes_read = (uint32_t) fread(destination_buffer, 1, (size_t) bytes_to_read, a_file);
-        file_size += bytes_read; //accommodate huge files embedded within small files for APar_Validate
+        ap_ctx->file_size += bytes_read; //accommodate huge files embedded within small files for APar_Validate
     }
     return bytes_read;
 }
 
+/*----------------------
+ APar_TestArtworkBinaryBuffer
+ pic_data - the start of a picture held in memory
+ pic_len - the number of bytes available at pic_data
+
+ returns the flags of the 'data' atom carrying the picture, or -1 if it is neither a jpg nor a png
+ ----------------------*/
+int APar_TestArtworkBinaryBuffer(const char* pic_data, uint32_t pic_len) {
+    if (pic_len >= 8 && memcmp(pic_data, "\x89\x50\x4E\x47\x0D\x0A\x1A\x0A", 8) == 0) {
+        return AtomFlags_Data_PNGBinary;
+    }
+    else if (pic_len >= 4 && (memcmp(pic_data, "\xFF\xD8\xFF\xE0", 4) == 0 || memcmp(pic_data, "\xFF\xD8\xFF\xE1", 4) == 0)) {
+        return AtomFlags_Data_JPEGBinary;
+    }
+    return -1;
+}
+
 int APar_TestArtworkBinaryData(const char* artworkPath) {
     int artwork_dataType = 0;
     FILE *artfile = APar_OpenFile(artworkPath, "rb");
@@ -343,16 +318,10 @@ int APar_TestArtworkBinaryData(const char* artworkPath) {
         char pic_data[10];
         memset(pic_data, 0, 10);
 
-        fread(&pic_data, 1, 8, artfile);
-        if (strncmp(&*pic_data, "\x89\x50\x4E\x47\x0D\x0A\x1A\x0A", 8) == 0) {
-            artwork_dataType = AtomFlags_Data_PNGBinary;
-        }
-        else if (strncmp(&*pic_data, "\xFF\xD8\xFF\xE0", 4) == 0 || memcmp(&*pic_data, "\xFF\xD8\xFF\xE1", 4) == 0) {
-            artwork_dataType = AtomFlags_Data_JPEGBinary;
-        }
-        else {
+        uint32_t pic_len = (uint32_t) fread(&pic_data, 1, 8, artfile);
+        artwork_dataType = APar_TestArtworkBinaryBuffer(pic_data, pic_len);
+        if (artwork_dataType == -1) {
             fprintf(stdout, "AtomicParsley error: %s\n\t image file is not jpg/png and cannot be embedded.\n", artworkPath);
-            artwork_dataType = -1;
         }
         fclose(artfile);
 
@@ -367,7 +336,7 @@ int APar_TestArtworkBinaryData(const char* artworkPath) {
 #if defined (DARWIN_PLATFORM)
 // enables writing out the contents of a single memory-resident atom out to a text file; for in-house testing purposes only - and unused in some time
 void APar_AtomicWriteTest(short AtomicNumber, bool binary) {
-    AtomicInfo anAtom = parsedAtoms[AtomicNumber];
+    AtomicInfo anAtom = ap_ctx->parsedAtoms[AtomicNumber];
 
     char* indy_atom_path = (char *)malloc(sizeof(char)*MAXPATHLEN); //this malloc can escape memset because its only for in-house testing
     strcat(indy_atom_path, "/Users/");
@@ -403,126 +372,165 @@ void APar_AtomicWriteTest(short AtomicNumber, bool binary) {
 
 char* extractAtomName(char *fileData, int name_position) {
 //name_position = 1 for normal atoms and needs to be done first; 2 for uuid atoms (which can only occur after we first find the atomName == "uuid")
-    memset(twenty_byte_buffer, 0, sizeof(char) * 20);
-    memcpy(twenty_byte_buffer, fileData + name_position * 4, 4);
+    memset(ap_ctx->twenty_byte_buffer, 0, sizeof(char) * 20);
+    memcpy(ap_ctx->twenty_byte_buffer, fileData + name_position * 4, 4);
 
-    return twenty_byte_buffer;
+    return ap_ctx->twenty_byte_buffer;
 }
 
 void APar_FreeMemory() {
-    for (int iter = 0; iter < atom_number; iter++) {
-        if (parsedAtoms[iter].AtomicData != NULL) {
-            free(parsedAtoms[iter].AtomicData);
-            parsedAtoms[iter].AtomicData = NULL;
+    for (int iter = 0; iter < ap_ctx->atom_number; iter++) {
+        if (ap_ctx->parsedAtoms[iter].AtomicData != NULL) {
+            free(ap_ctx->parsedAtoms[iter].AtomicData);
+            ap_ctx->parsedAtoms[iter].AtomicData = NULL;
         }
-        if (parsedAtoms[iter].ReverseDNSname != NULL) {
-            free(parsedAtoms[iter].ReverseDNSname);
-            parsedAtoms[iter].ReverseDNSname = NULL;
+        if (ap_ctx->parsedAtoms[iter].ReverseDNSname != NULL) {
+            free(ap_ctx->parsedAtoms[iter].ReverseDNSname);
+            ap_ctx->parsedAtoms[iter].ReverseDNSname = NULL;
         }
-        if (parsedAtoms[iter].uuid_ap_atomname != NULL) {
-            free(parsedAtoms[iter].uuid_ap_atomname);
-            parsedAtoms[iter].uuid_ap_atomname = NULL;
+        if (ap_ctx->parsedAtoms[iter].uuid_ap_atomname != NULL) {
+            free(ap_ctx->parsedAtoms[iter].uuid_ap_atomname);
+            ap_ctx->parsedAtoms[iter].uuid_ap_atomname = NULL;
         }
     }
-    free(twenty_byte_buffer);
-    twenty_byte_buffer = NULL;
-    free(file_progress_buffer);
-    file_progress_buffer = NULL;
+    free(ap_ctx->twenty_byte_buffer);
+    ap_ctx->twenty_byte_buffer = NULL;
+    free(ap_ctx->file_progress_buffer);
+    ap_ctx->file_progress_buffer = NULL;
 
-    if (source_file && file_opened) {
-        fclose(source_file);
-        file_opened = false;
+    if (ap_ctx->source_file && ap_ctx->file_opened) {
+        fclose(ap_ctx->source_file);
+        ap_ctx->file_opened = false;
     }
 
-    inited = false;
+    ap_ctx->inited = false;
 
     return;
 }
 
+/*----------------------
+ APar_NewContext
+
+ allocate the state needed to work on one file; attach it with APar_AttachContext before calling any other function
+ ----------------------*/
+AtomicContext* APar_NewContext() {
+    return new AtomicContext(); //value-initialized: everything starts out zeroed
+}
+
+/*----------------------
+ APar_FreeContext
+ context - a context returned by APar_NewContext
+
+ release a context together with whatever is still held by the parsed tree
+ ----------------------*/
+void APar_FreeContext(AtomicContext* context) {
+    if (context == NULL)
+        return;
+
+    if (context->inited) {
+        AtomicContext* previous = APar_AttachContext(context);
+        APar_FreeMemory();
+        APar_AttachContext(previous);
+    }
+    delete context;
+}
+
+/*----------------------
+ APar_AttachContext
+ context - the context the calling thread works on from now on (may be NULL)
+
+ only affects the calling thread; returns the context that was attached before
+ ----------------------*/
+AtomicContext* APar_AttachContext(AtomicContext* context) {
+    AtomicContext* previous = ap_ctx;
+    ap_ctx = context;
+    return previous;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //                        Picture Preferences Functions                              //
 ///////////////////////////////////////////////////////////////////////////////////////
 
 PicPrefs APar_ExtractPicPrefs(char* env_PicOptions) {
-    if (!parsed_prefs) {
+    if (!ap_ctx->parsed_prefs) {
 
-        parsed_prefs = true; //only set default values & parse once
+        ap_ctx->parsed_prefs = true; //only set default values & parse once
 
-        myPicturePrefs.max_dimension = 0; //dimensions won't be used to alter image
-        myPicturePrefs.dpi = 72;
-        myPicturePrefs.max_Kbytes = 0; //no target size to shoot for
-        myPicturePrefs.allJPEG = false;
-        myPicturePrefs.allPNG = false;
-        myPicturePrefs.addBOTHpix = false;
-        myPicturePrefs.force_dimensions = false;
-        myPicturePrefs.force_height = 0;
-        myPicturePrefs.force_width = 0;
-        myPicturePrefs.removeTempPix = true; //we'll just make this the default
+        ap_ctx->myPicturePrefs.max_dimension = 0; //dimensions won't be used to alter image
+        ap_ctx->myPicturePrefs.dpi = 72;
+        ap_ctx->myPicturePrefs.max_Kbytes = 0; //no target size to shoot for
+        ap_ctx->myPicturePrefs.allJPEG = false;
+        ap_ctx->myPicturePrefs.allPNG = false;
+        ap_ctx->myPicturePrefs.addBOTHpix = false;
+        ap_ctx->myPicturePrefs.force_dimensions = false;
+        ap_ctx->myPicturePrefs.force_height = 0;
+        ap_ctx->myPicturePrefs.force_width = 0;
+        ap_ctx->myPicturePrefs.removeTempPix = true; //we'll just make this the default
 
         char* unparsed_opts = env_PicOptions;
         if (env_PicOptions == NULL)
-            return myPicturePrefs;
+            return ap_ctx->myPicturePrefs;
 
         while (unparsed_opts[0] != 0) {
             if (memcmp(unparsed_opts, "MaxDimensions=", 14) == 0) {
                 unparsed_opts += 14;
-                myPicturePrefs.max_dimension = (int) strtol(unparsed_opts, NULL, 10);
+                ap_ctx->myPicturePrefs.max_dimension = (int) strtol(unparsed_opts, NULL, 10);
 
             }
             else if (memcmp(unparsed_opts, "DPI=", 4) == 0) {
                 unparsed_opts += 4;
-                myPicturePrefs.dpi = (int) strtol(unparsed_opts, NULL, 10);
+                ap_ctx->myPicturePrefs.dpi = (int) strtol(unparsed_opts, NULL, 10);
 
             }
             else if (memcmp(unparsed_opts, "MaxKBytes=", 10) == 0) {
                 unparsed_opts += 10;
-                myPicturePrefs.max_Kbytes = (int) strtol(unparsed_opts, NULL, 10) * 1024;
+                ap_ctx->myPicturePrefs.max_Kbytes = (int) strtol(unparsed_opts, NULL, 10) * 1024;
 
             }
             else if (memcmp(unparsed_opts, "AllPixJPEG=", 11) == 0) {
                 unparsed_opts += 11;
                 if (memcmp(unparsed_opts, "true", 4) == 0) {
-                    myPicturePrefs.allJPEG = true;
+                    ap_ctx->myPicturePrefs.allJPEG = true;
                 }
 
             }
             else if (memcmp(unparsed_opts, "AllPixPNG=", 10) == 0) {
                 unparsed_opts += 10;
                 if (memcmp(unparsed_opts, "true", 4) == 0) {
-                    myPicturePrefs.allPNG = true;
+                    ap_ctx->myPicturePrefs.allPNG = true;
                 }
 
             }
             else if (memcmp(unparsed_opts, "AddBothPix=", 11) == 0) {
                 unparsed_opts += 11;
                 if (memcmp(unparsed_opts, "true", 4) == 0) {
-                    myPicturePrefs.addBOTHpix = true;
+                    ap_ctx->myPicturePrefs.addBOTHpix = true;
                 }
 
             }
             else if (memcmp(unparsed_opts, "SquareUp", 7) == 0) {
                 unparsed_opts += 7;
-                myPicturePrefs.squareUp = true;
+                ap_ctx->myPicturePrefs.squareUp = true;
 
             }
             else if (strncmp(unparsed_opts, "removeTempPix", 13) == 0) {
                 unparsed_opts += 13;
-                myPicturePrefs.removeTempPix = true;
+                ap_ctx->myPicturePrefs.removeTempPix = true;
 
             }
             else if (memcmp(unparsed_opts, "keepTempPix", 11) == 0) { //NEW
                 unparsed_opts += 11;
-                myPicturePrefs.removeTempPix = false;
+                ap_ctx->myPicturePrefs.removeTempPix = false;
 
             }
             else if (memcmp(unparsed_opts, "ForceHeight=", 12) == 0) {
                 unparsed_opts += 12;
-                myPicturePrefs.force_height = strtol(unparsed_opts, NULL, 10);
+                ap_ctx->myPicturePrefs.force_height = strtol(unparsed_opts, NULL, 10);
 
             }
             else if (memcmp(unparsed_opts, "ForceWidth=", 11) == 0) {
                 unparsed_opts += 11;
-                myPicturePrefs.force_width = strtol(unparsed_opts, NULL, 10);
+                ap_ctx->myPicturePrefs.force_width = strtol(unparsed_opts, NULL, 10);
 
             }
             else {
@@ -531,9 +539,9 @@ PicPrefs APar_ExtractPicPrefs(char* env_PicOptions) {
         }
     }
 
-    if (myPicturePrefs.force_height > 0 && myPicturePrefs.force_width > 0)
-        myPicturePrefs.force_dimensions = true;
-    return myPicturePrefs;
+    if (ap_ctx->myPicturePrefs.force_height > 0 && ap_ctx->myPicturePrefs.force_width > 0)
+        ap_ctx->myPicturePrefs.force_dimensions = true;
+    return ap_ctx->myPicturePrefs;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -544,9 +552,9 @@ void APar_TrackInfo(uint8_t &total_tracks, uint8_t &track_num, short &codec_atom
     uint8_t track_tally = 0;
     short iter = 0;
 
-    while (parsedAtoms[iter].NextAtomNumber != 0) {
+    while (ap_ctx->parsedAtoms[iter].NextAtomNumber != 0) {
 
-        if (memcmp(parsedAtoms[iter].AtomicName, "trak", 4) == 0 && parsedAtoms[iter].AtomicLevel == 2) {
+        if (memcmp(ap_ctx->parsedAtoms[iter].AtomicName, "trak", 4) == 0 && ap_ctx->parsedAtoms[iter].AtomicLevel == 2) {
             track_tally += 1;
             if (track_num == 0) {
                 total_tracks += 1;
@@ -554,23 +562,23 @@ void APar_TrackInfo(uint8_t &total_tracks, uint8_t &track_num, short &codec_atom
             }
             else if (track_num == track_tally) {
                 //drill down into stsd
-                short next_atom = parsedAtoms[iter].NextAtomNumber;
-                while (parsedAtoms[next_atom].AtomicLevel > parsedAtoms[iter].AtomicLevel) {
+                short next_atom = ap_ctx->parsedAtoms[iter].NextAtomNumber;
+                while (ap_ctx->parsedAtoms[next_atom].AtomicLevel > ap_ctx->parsedAtoms[iter].AtomicLevel) {
 
-                    if (strncmp(parsedAtoms[next_atom].AtomicName, "stsd", 4) == 0) {
+                    if (strncmp(ap_ctx->parsedAtoms[next_atom].AtomicName, "stsd", 4) == 0) {
 
-                        codec_atom = parsedAtoms[next_atom].AtomicNumber;
+                        codec_atom = ap_ctx->parsedAtoms[next_atom].AtomicNumber;
                         //return with the stsd atom - its stsd_codec uint32_t holds the 4CC name of the codec for the trak
                         //(mp4v, avc1, drmi, mp4a, drms, alac, mp4s, text, tx3g or jpeg)
                         return;
                     }
                     else {
-                        next_atom = parsedAtoms[next_atom].NextAtomNumber;
+                        next_atom = ap_ctx->parsedAtoms[next_atom].NextAtomNumber;
                     }
                 }
             }
         }
-        iter = parsedAtoms[iter].NextAtomNumber;
+        iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
     }
     return;
 }
@@ -581,24 +589,24 @@ void APar_TrackInfo(uint8_t &total_tracks, uint8_t &track_num, short &codec_atom
 
 uint32_t APar_ProvideTallyForAtom(const char* atom_name) {
     uint32_t tally_for_atom = 0;
-    short iter = parsedAtoms[0].NextAtomNumber;
+    short iter = ap_ctx->parsedAtoms[0].NextAtomNumber;
     while (true) {
-        if (memcmp(parsedAtoms[iter].AtomicName, atom_name, 4) == 0) {
-            if (parsedAtoms[iter].AtomicLength == 0) {
-                tally_for_atom += (uint32_t) file_size - parsedAtoms[iter].AtomicStart;
+        if (memcmp(ap_ctx->parsedAtoms[iter].AtomicName, atom_name, 4) == 0) {
+            if (ap_ctx->parsedAtoms[iter].AtomicLength == 0) {
+                tally_for_atom += (uint32_t) ap_ctx->file_size - ap_ctx->parsedAtoms[iter].AtomicStart;
             }
-            else if (parsedAtoms[iter].AtomicLength == 1) {
-                tally_for_atom += (uint32_t) parsedAtoms[iter].AtomicLengthExtended;
+            else if (ap_ctx->parsedAtoms[iter].AtomicLength == 1) {
+                tally_for_atom += (uint32_t) ap_ctx->parsedAtoms[iter].AtomicLengthExtended;
             }
             else {
-                tally_for_atom += parsedAtoms[iter].AtomicLength;
+                tally_for_atom += ap_ctx->parsedAtoms[iter].AtomicLength;
             }
         }
         if (iter == 0) {
             break;
         }
         else {
-            iter = parsedAtoms[iter].NextAtomNumber;
+            iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
         }
     }
     return tally_for_atom;
@@ -607,13 +615,13 @@ uint32_t APar_ProvideTallyForAtom(const char* atom_name) {
 short APar_FindPrecedingAtom(short an_atom_num) {
     short precedingAtom = 0;
     short iter = 0;
-    while (parsedAtoms[iter].NextAtomNumber != 0) {
-        if (parsedAtoms[iter].NextAtomNumber == parsedAtoms[an_atom_num].NextAtomNumber) {
+    while (ap_ctx->parsedAtoms[iter].NextAtomNumber != 0) {
+        if (ap_ctx->parsedAtoms[iter].NextAtomNumber == ap_ctx->parsedAtoms[an_atom_num].NextAtomNumber) {
             break;
         }
         else {
             precedingAtom = iter;
-            iter = parsedAtoms[iter].NextAtomNumber;
+            iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
         }
     }
     return precedingAtom;
@@ -622,9 +630,9 @@ short APar_FindPrecedingAtom(short an_atom_num) {
 short APar_FindParentAtom(int order_in_tree, uint8_t this_atom_level) {
     short thisAtom = 0;
     short iter = order_in_tree;
-    while (parsedAtoms[iter].AtomicNumber != 0) {
+    while (ap_ctx->parsedAtoms[iter].AtomicNumber != 0) {
         iter = APar_FindPrecedingAtom(iter);
-        if (parsedAtoms[iter].AtomicLevel == this_atom_level - 1) {
+        if (ap_ctx->parsedAtoms[iter].AtomicLevel == this_atom_level - 1) {
             thisAtom = iter;
             break;
         }
@@ -645,31 +653,31 @@ short APar_FindParentAtom(int order_in_tree, uint8_t this_atom_level) {
  ----------------------*/
 void APar_ProvideAtomPath(short this_atom, char* &atom_path, bool fromFile) {
     short preceding_atom = this_atom;
-    uint8_t current_atomic_level = parsedAtoms[this_atom].AtomicLevel;
-    int str_offset = (parsedAtoms[this_atom].AtomicLevel - 1) * 5; //5 = 'atom" + '.'
-    if (parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
+    uint8_t current_atomic_level = ap_ctx->parsedAtoms[this_atom].AtomicLevel;
+    int str_offset = (ap_ctx->parsedAtoms[this_atom].AtomicLevel - 1) * 5; //5 = 'atom" + '.'
+    if (ap_ctx->parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
         str_offset += 5; //include a "uuid=" string;
     }
 
-    memcpy(atom_path + str_offset, parsedAtoms[preceding_atom].AtomicName, 4);
+    memcpy(atom_path + str_offset, ap_ctx->parsedAtoms[preceding_atom].AtomicName, 4);
     str_offset -= 5;
-    if (parsedAtoms[preceding_atom].AtomicLevel != 1) {
+    if (ap_ctx->parsedAtoms[preceding_atom].AtomicLevel != 1) {
         memcpy(atom_path + str_offset + 4, ".", 1);
     }
-    if (parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
+    if (ap_ctx->parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
         memcpy(atom_path + str_offset, "uuid=", 5);
         str_offset -= 5;
     }
 
-    while (parsedAtoms[preceding_atom].AtomicNumber != 0) {
+    while (ap_ctx->parsedAtoms[preceding_atom].AtomicNumber != 0) {
 
         if (fromFile) {
-            if (parsedAtoms[preceding_atom].AtomicStart < parsedAtoms[this_atom].AtomicStart
-                    && parsedAtoms[preceding_atom].AtomicLength > parsedAtoms[this_atom].AtomicLength
-                    && parsedAtoms[preceding_atom].AtomicStart + parsedAtoms[preceding_atom].AtomicLength
-                            >= parsedAtoms[this_atom].AtomicStart + parsedAtoms[this_atom].AtomicLength
-                    && parsedAtoms[preceding_atom].AtomicContainerState <= DUAL_STATE_ATOM) {
-                memcpy(atom_path + str_offset, parsedAtoms[preceding_atom].AtomicName, 4);
+            if (ap_ctx->parsedAtoms[preceding_atom].AtomicStart < ap_ctx->parsedAtoms[this_atom].AtomicStart
+                    && ap_ctx->parsedAtoms[preceding_atom].AtomicLength > ap_ctx->parsedAtoms[this_atom].AtomicLength
+                    && ap_ctx->parsedAtoms[preceding_atom].AtomicStart + ap_ctx->parsedAtoms[preceding_atom].AtomicLength
+                            >= ap_ctx->parsedAtoms[this_atom].AtomicStart + ap_ctx->parsedAtoms[this_atom].AtomicLength
+                    && ap_ctx->parsedAtoms[preceding_atom].AtomicContainerState <= DUAL_STATE_ATOM) {
+                memcpy(atom_path + str_offset, ap_ctx->parsedAtoms[preceding_atom].AtomicName, 4);
                 str_offset -= 5;
                 if (str_offset >= 0) {
                     memcpy(atom_path + str_offset + 4, ".", 1);
@@ -683,14 +691,14 @@ void APar_ProvideAtomPath(short this_atom, char* &atom_path, bool fromFile) {
             }
         }
         else {
-            if (parsedAtoms[preceding_atom].AtomicLevel < current_atomic_level) {
-                memcpy(atom_path + str_offset, parsedAtoms[preceding_atom].AtomicName, 4);
+            if (ap_ctx->parsedAtoms[preceding_atom].AtomicLevel < current_atomic_level) {
+                memcpy(atom_path + str_offset, ap_ctx->parsedAtoms[preceding_atom].AtomicName, 4);
                 str_offset -= 5;
                 if (str_offset >= 0) {
                     memcpy(atom_path + str_offset + 4, ".", 1);
                 }
 
-                current_atomic_level = parsedAtoms[preceding_atom].AtomicLevel;
+                current_atomic_level = ap_ctx->parsedAtoms[preceding_atom].AtomicLevel;
                 preceding_atom = APar_FindPrecedingAtom(preceding_atom); //preceding_atom--;
             }
             else {
@@ -711,14 +719,14 @@ bool APar_Eval_ChunkOffsetImpact(short an_atom_num) {
     uint8_t found_desired_atom = 0;
 
     while (true) {
-        if (strncmp(parsedAtoms[iter].AtomicName, "mdat", 4) == 0) {
+        if (strncmp(ap_ctx->parsedAtoms[iter].AtomicName, "mdat", 4) == 0) {
             if (found_desired_atom) {
                 impact_calculations_directly = true;
             }
             break;
         }
         else {
-            iter = parsedAtoms[iter].NextAtomNumber;
+            iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
         }
         if (iter == 0) {
             break;
@@ -732,8 +740,8 @@ bool APar_Eval_ChunkOffsetImpact(short an_atom_num) {
 
 short APar_FindLastAtom() {
     short this_atom_num = 0; //start our search with the first atom
-    while (parsedAtoms[this_atom_num].NextAtomNumber != 0) {
-        this_atom_num = parsedAtoms[this_atom_num].NextAtomNumber;
+    while (ap_ctx->parsedAtoms[this_atom_num].NextAtomNumber != 0) {
+        this_atom_num = ap_ctx->parsedAtoms[this_atom_num].NextAtomNumber;
     }
     return this_atom_num;
 }
@@ -741,25 +749,25 @@ short APar_FindLastAtom() {
 short APar_FindEndingAtom() {
     short end_atom_num = 0; //start our search with the first atom
     while (true) {
-        if ((parsedAtoms[end_atom_num].NextAtomNumber == 0) || (end_atom_num == atom_number - 1)) {
+        if ((ap_ctx->parsedAtoms[end_atom_num].NextAtomNumber == 0) || (end_atom_num == ap_ctx->atom_number - 1)) {
             break;
         }
         else {
-            end_atom_num = parsedAtoms[end_atom_num].NextAtomNumber;
+            end_atom_num = ap_ctx->parsedAtoms[end_atom_num].NextAtomNumber;
         }
     }
     return end_atom_num;
 }
 
 short APar_FindLastChild_of_ParentAtom(short thisAtom) {
-    short child_atom = parsedAtoms[thisAtom].NextAtomNumber;
+    short child_atom = ap_ctx->parsedAtoms[thisAtom].NextAtomNumber;
     short last_atom = thisAtom; //if there are no children, this will be the first and last atom in the hiearchy
     while (true) {
-        if (parsedAtoms[child_atom].AtomicLevel > parsedAtoms[thisAtom].AtomicLevel) {
+        if (ap_ctx->parsedAtoms[child_atom].AtomicLevel > ap_ctx->parsedAtoms[thisAtom].AtomicLevel) {
             last_atom = child_atom;
         }
-        child_atom = parsedAtoms[child_atom].NextAtomNumber;
-        if (child_atom == 0 || parsedAtoms[child_atom].AtomicLevel <= parsedAtoms[thisAtom].AtomicLevel) {
+        child_atom = ap_ctx->parsedAtoms[child_atom].NextAtomNumber;
+        if (child_atom == 0 || ap_ctx->parsedAtoms[child_atom].AtomicLevel <= ap_ctx->parsedAtoms[thisAtom].AtomicLevel) {
             break;
         }
     }
@@ -777,11 +785,11 @@ short APar_FindLastChild_of_ParentAtom(short thisAtom) {
 short APar_ReturnChildrenAtoms(short this_atom, uint8_t atom_index) {
     short child_atom = 0;
     uint8_t total_children = 0;
-    short iter = parsedAtoms[this_atom].NextAtomNumber;
+    short iter = ap_ctx->parsedAtoms[this_atom].NextAtomNumber;
 
     while (true) {
-        if ((parsedAtoms[iter].AtomicLevel == parsedAtoms[this_atom].AtomicLevel + 1 && this_atom > 0)
-                || (this_atom == 0 && parsedAtoms[iter].AtomicLevel == 1)) {
+        if ((ap_ctx->parsedAtoms[iter].AtomicLevel == ap_ctx->parsedAtoms[this_atom].AtomicLevel + 1 && this_atom > 0)
+                || (this_atom == 0 && ap_ctx->parsedAtoms[iter].AtomicLevel == 1)) {
             total_children++;
 
             if (atom_index == total_children) {
@@ -789,11 +797,11 @@ short APar_ReturnChildrenAtoms(short this_atom, uint8_t atom_index) {
                 break;
             }
         }
-        if (parsedAtoms[iter].AtomicLevel <= parsedAtoms[this_atom].AtomicLevel && this_atom != 0) {
+        if (ap_ctx->parsedAtoms[iter].AtomicLevel <= ap_ctx->parsedAtoms[this_atom].AtomicLevel && this_atom != 0) {
             break;
         }
         else {
-            iter = parsedAtoms[iter].NextAtomNumber;
+            iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
         }
         if (iter == 0) {
             break;
@@ -819,38 +827,38 @@ AtomicInfo* APar_AtomicComparison(AtomicInfo* proto_atom, short test_atom, bool
     AtomicInfo* return_atom = NULL;
     size_t ATOM_TEST_LEN = (match_full_uuids ? 16 : 4);
 
-    if (parsedAtoms[test_atom].AtomicClassification == EXTENDED_ATOM
-            && parsedAtoms[test_atom].uuid_style == UUID_DEPRECATED_FORM) { //accommodate deprecated form
-        if (memcmp(parsedAtoms[test_atom].uuid_ap_atomname, proto_atom->AtomicName, 4) == 0) {
-            return &parsedAtoms[test_atom];
+    if (ap_ctx->parsedAtoms[test_atom].AtomicClassification == EXTENDED_ATOM
+            && ap_ctx->parsedAtoms[test_atom].uuid_style == UUID_DEPRECATED_FORM) { //accommodate deprecated form
+        if (memcmp(ap_ctx->parsedAtoms[test_atom].uuid_ap_atomname, proto_atom->AtomicName, 4) == 0) {
+            return &ap_ctx->parsedAtoms[test_atom];
         }
     }
 
     //can't do AtomicVerFlags because lots of utilities don't write the proper iTunes flags for iTunes metadata
-    if (memcmp(proto_atom->AtomicName, parsedAtoms[test_atom].AtomicName, ATOM_TEST_LEN) == 0
-            && proto_atom->AtomicLevel == parsedAtoms[test_atom].AtomicLevel
-            && (proto_atom->AtomicClassification == parsedAtoms[test_atom].AtomicClassification
+    if (memcmp(proto_atom->AtomicName, ap_ctx->parsedAtoms[test_atom].AtomicName, ATOM_TEST_LEN) == 0
+            && proto_atom->AtomicLevel == ap_ctx->parsedAtoms[test_atom].AtomicLevel
+            && (proto_atom->AtomicClassification == ap_ctx->parsedAtoms[test_atom].AtomicClassification
                     || proto_atom->AtomicClassification == UNKNOWN_ATOM)) {
 
         if (proto_atom->AtomicClassification == PACKED_LANG_ATOM) {
             //0x05D9 = 'any' and will be used (internally) to match on name,class,container state alone, disregarding AtomicLanguage
-            if (proto_atom->AtomicLanguage == parsedAtoms[test_atom].AtomicLanguage
+            if (proto_atom->AtomicLanguage == ap_ctx->parsedAtoms[test_atom].AtomicLanguage
                     || proto_atom->AtomicLanguage == 0x05D9) {
-                return_atom = &parsedAtoms[test_atom];
+                return_atom = &ap_ctx->parsedAtoms[test_atom];
             }
 
         }
-        else if (proto_atom->ReverseDNSname != NULL && parsedAtoms[test_atom].ReverseDNSname != NULL) {
+        else if (proto_atom->ReverseDNSname != NULL && ap_ctx->parsedAtoms[test_atom].ReverseDNSname != NULL) {
             //match on moov.udta.meta.ilst.----.name:[something] (reverse DNS atom)
             size_t proto_rdns_len = strlen(proto_atom->ReverseDNSname) + 1;
-            size_t test_rdns_len = strlen(parsedAtoms[test_atom].ReverseDNSname) + 1;
+            size_t test_rdns_len = strlen(ap_ctx->parsedAtoms[test_atom].ReverseDNSname) + 1;
             size_t rdns_strlen = (proto_rdns_len > test_rdns_len ? proto_rdns_len : test_rdns_len);
-            if (memcmp(proto_atom->ReverseDNSname, parsedAtoms[test_atom].ReverseDNSname, rdns_strlen) == 0) {
-                return_atom = &parsedAtoms[test_atom];
+            if (memcmp(proto_atom->ReverseDNSname, ap_ctx->parsedAtoms[test_atom].ReverseDNSname, rdns_strlen) == 0) {
+                return_atom = &ap_ctx->parsedAtoms[test_atom];
             }
         }
         else {
-            return_atom = &parsedAtoms[test_atom];
+            return_atom = &ap_ctx->parsedAtoms[test_atom];
         }
     }
     return return_atom;
@@ -866,18 +874,18 @@ AtomicInfo* APar_AtomicComparison(AtomicInfo* proto_atom, short test_atom, bool
  ----------------------*/
 short APar_FindLastLikeNamedAtom(char* atom_name, short containing_hierarchy) {
     short last_identically_named_atom = APar_FindLastChild_of_ParentAtom(containing_hierarchy); //default returns the last atom in the parent, not the parent
-    short eval_atom = parsedAtoms[containing_hierarchy].NextAtomNumber;
+    short eval_atom = ap_ctx->parsedAtoms[containing_hierarchy].NextAtomNumber;
 
     while (true) {
-        if (parsedAtoms[eval_atom].AtomicLevel < parsedAtoms[containing_hierarchy].AtomicLevel + 1 || eval_atom == 0) {
+        if (ap_ctx->parsedAtoms[eval_atom].AtomicLevel < ap_ctx->parsedAtoms[containing_hierarchy].AtomicLevel + 1 || eval_atom == 0) {
             break;
         }
         else {
-            if (memcmp(parsedAtoms[eval_atom].AtomicName, atom_name, 4) == 0
-                    && parsedAtoms[eval_atom].AtomicLevel == parsedAtoms[containing_hierarchy].AtomicLevel + 1) {
+            if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, atom_name, 4) == 0
+                    && ap_ctx->parsedAtoms[eval_atom].AtomicLevel == ap_ctx->parsedAtoms[containing_hierarchy].AtomicLevel + 1) {
                 last_identically_named_atom = eval_atom;
             }
-            eval_atom = parsedAtoms[eval_atom].NextAtomNumber;
+            eval_atom = ap_ctx->parsedAtoms[eval_atom].NextAtomNumber;
         }
     }
     return last_identically_named_atom;
@@ -952,7 +960,7 @@ AtomicInfo* APar_FindAtom(const char* atom_name, bool createMissing, uint8_t ato
     uint8_t desired_index = 1;
     uint8_t search_atom_type = UNKNOWN_ATOM;
     int known_atom = -1;
-    short search_atom_start_num = parsedAtoms[0].NextAtomNumber; //don't test 'ftyp'; its atom_number[0] & will be used to know when we have hit the end of the tree; can't hardcode it to '1' because ftyp's following atom can change; only ftype as parsedAtoms[0] is guaranteed.
+    short search_atom_start_num = ap_ctx->parsedAtoms[0].NextAtomNumber; //don't test 'ftyp'; its atom_number[0] & will be used to know when we have hit the end of the tree; can't hardcode it to '1' because ftyp's following atom can change; only ftype as parsedAtoms[0] is guaranteed.
     uint8_t present_atomic_level = 1;
     AtomicInfo* last_known_present_parent = NULL;
     AtomicInfo atom_surrogate =
@@ -1008,14 +1016,14 @@ AtomicInfo* APar_FindAtom(const char* atom_name, bool createMissing, uint8_t ato
             AtomicInfo* result = NULL;
 
             //if iter == 0, that means test against 'ftyp' - and since its always 0, don't test it; its to know that the end of the tree is reached
-            if (iter != 0 && (parsedAtoms[iter].AtomicLevel == present_atomic_level || reverse_dns_name != NULL)) {
+            if (iter != 0 && (ap_ctx->parsedAtoms[iter].AtomicLevel == present_atomic_level || reverse_dns_name != NULL)) {
                 result = APar_AtomicComparison(&atom_surrogate, iter, (
                         search_atom_type == EXTENDED_ATOM ? match_full_uuids : false));
 #if defined(DEBUG_V)
-                fprintf(stdout, "debug: AP_FindAtom     compare  %s(%u)  against %s (wanted index=%u)\n", search_atom_name, atom_index, parsedAtoms[iter].AtomicName, desired_index);
+                fprintf(stdout, "debug: AP_FindAtom     compare  %s(%u)  against %s (wanted index=%u)\n", search_atom_name, atom_index, ap_ctx->parsedAtoms[iter].AtomicName, desired_index);
             }
             else {
-                fprintf(stdout, "debug: AP_FindAtom       %s  rejected against %s\n", search_atom_name, parsedAtoms[iter].AtomicName);
+                fprintf(stdout, "debug: AP_FindAtom       %s  rejected against %s\n", search_atom_name, ap_ctx->parsedAtoms[iter].AtomicName);
 #endif
             }
             if (result != NULL) { //something matched
@@ -1026,19 +1034,19 @@ AtomicInfo* APar_FindAtom(const char* atom_name, bool createMissing, uint8_t ato
                 if (search_atom_type != UNKNOWN_ATOM || (search_atom_type == UNKNOWN_ATOM && known_atom != -1)) {
                     thisAtom = result;
 #if defined(DEBUG_V)
-                    fprintf(stdout, "debug: AP_FindAtom         perfect match: %s(%u) == existing %s(%u)\n", search_atom_name, desired_index, parsedAtoms[iter].AtomicName, atom_index);
+                    fprintf(stdout, "debug: AP_FindAtom         perfect match: %s(%u) == existing %s(%u)\n", search_atom_name, desired_index, ap_ctx->parsedAtoms[iter].AtomicName, atom_index);
 #endif
                 }
                 else {
                     last_known_present_parent = result; //if not, then it isn't the last atom, and must be some form of parent
                 }
                 if (desired_index == atom_index) {
-                    search_atom_start_num = parsedAtoms[iter].NextAtomNumber;
+                    search_atom_start_num = ap_ctx->parsedAtoms[iter].NextAtomNumber;
                     break;
                 }
             }
 
-            if (parsedAtoms[iter].AtomicLevel < present_atomic_level && reverse_dns_name == NULL) {
+            if (ap_ctx->parsedAtoms[iter].AtomicLevel < present_atomic_level && reverse_dns_name == NULL) {
                 iter = 0; //force the ending determination of whether to make new atoms or not;
             }
 
@@ -1071,7 +1079,7 @@ AtomicInfo* APar_FindAtom(const char* atom_name, bool createMissing, uint8_t ato
                 search_atom_name = NULL; //force the break;
                 break;
             }
-            iter = parsedAtoms[iter].NextAtomNumber;
+            iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
         }
 
         if (iter == 0 && search_atom_name == NULL) {
@@ -1104,13 +1112,13 @@ AtomicInfo* APar_FindAtom(const char* atom_name, bool createMissing, uint8_t ato
 ///////////////////////////////////////////////////////////////////////////////////////
 
 void APar_AtomicRead(short this_atom_number) {
-    parsedAtoms[this_atom_number].AtomicData = (char*) malloc(sizeof(char)
-            * (size_t) (parsedAtoms[this_atom_number].AtomicLength));
-    memset(parsedAtoms[this_atom_number].AtomicData, 0, sizeof(char)
-            * (size_t) (parsedAtoms[this_atom_number].AtomicLength));
+    ap_ctx->parsedAtoms[this_atom_number].AtomicData = (char*) malloc(sizeof(char)
+            * (size_t) (ap_ctx->parsedAtoms[this_atom_number].AtomicLength));
+    memset(ap_ctx->parsedAtoms[this_atom_number].AtomicData, 0, sizeof(char)
+            * (size_t) (ap_ctx->parsedAtoms[this_atom_number].AtomicLength));
 
-    fseeko(source_file, parsedAtoms[this_atom_number].AtomicStart + 12, SEEK_SET);
-    fread(parsedAtoms[this_atom_number].AtomicData, 1, parsedAtoms[this_atom_number].AtomicLength - 12, source_file);
+    fseeko(ap_ctx->source_file, ap_ctx->parsedAtoms[this_atom_number].AtomicStart + 12, SEEK_SET);
+    fread(ap_ctx->parsedAtoms[this_atom_number].AtomicData, 1, ap_ctx->parsedAtoms[this_atom_number].AtomicLength - 12, ap_ctx->source_file);
     return;
 }
 
@@ -1278,30 +1286,30 @@ void APar_print_ISO_UserData_per_track() {
         fprintf(stdout, "Track %i:\n", i);
 
         if (trak_udtaAtom != NULL
-                && parsedAtoms[trak_udtaAtom->NextAtomNumber].AtomicLevel == trak_udtaAtom->AtomicLevel + 1) {
+                && ap_ctx->parsedAtoms[trak_udtaAtom->NextAtomNumber].AtomicLevel == trak_udtaAtom->AtomicLevel + 1) {
             a_trak_atom = trak_udtaAtom->NextAtomNumber;
-            while (parsedAtoms[a_trak_atom].AtomicLevel == trak_udtaAtom->AtomicLevel + 1) { //only work on moov.trak[i].udta's child atoms
+            while (ap_ctx->parsedAtoms[a_trak_atom].AtomicLevel == trak_udtaAtom->AtomicLevel + 1) { //only work on moov.trak[i].udta's child atoms
 
                 char bitpacked_lang[3];
                 memset(bitpacked_lang, 0, 3);
                 unsigned char unpacked_lang[3];
 
-                uint32_t box_length = parsedAtoms[a_trak_atom].AtomicLength;
+                uint32_t box_length = ap_ctx->parsedAtoms[a_trak_atom].AtomicLength;
                 char* box_data = (char*) malloc(sizeof(char) * box_length);
                 memset(box_data, 0, sizeof(char) * box_length);
 
-                if (memcmp(parsedAtoms[a_trak_atom].AtomicName, "cprt", 4) == 0) {
+                if (memcmp(ap_ctx->parsedAtoms[a_trak_atom].AtomicName, "cprt", 4) == 0) {
                     fprintf(stdout, " Copyright ");
                 }
                 else {
-                    fprintf(stdout, " Atom \"%s\" ", parsedAtoms[a_trak_atom].AtomicName);
+                    fprintf(stdout, " Atom \"%s\" ", ap_ctx->parsedAtoms[a_trak_atom].AtomicName);
                 }
 
-                uint16_t packed_lang = APar_read16(bitpacked_lang, source_file, parsedAtoms[a_trak_atom].AtomicStart
+                uint16_t packed_lang = APar_read16(bitpacked_lang, ap_ctx->source_file, ap_ctx->parsedAtoms[a_trak_atom].AtomicStart
                         + 12);
                 APar_UnpackLanguage(unpacked_lang, packed_lang);
 
-                APar_readX(box_data, source_file, parsedAtoms[a_trak_atom].AtomicStart + 14, box_length - 14); //4bytes length, 4 bytes name, 4 bytes flags, 2 bytes lang
+                APar_readX(box_data, ap_ctx->source_file, ap_ctx->parsedAtoms[a_trak_atom].AtomicStart + 14, box_length - 14); //4bytes length, 4 bytes name, 4 bytes flags, 2 bytes lang
                 fprintf(stdout, "[lang=%s", unpacked_lang);
                 APar_PrintUnicodeAssest(box_data, box_length);
                 fprintf(stdout, "\n");
@@ -1309,7 +1317,7 @@ void APar_print_ISO_UserData_per_track() {
                 free(box_data);
                 box_data = NULL;
 
-                a_trak_atom = parsedAtoms[a_trak_atom].NextAtomNumber;
+                a_trak_atom = ap_ctx->parsedAtoms[a_trak_atom].NextAtomNumber;
             }
         }
         else {
@@ -1335,19 +1343,19 @@ void APar_PrintUserDataAssests() { //3gp files
     if (udtaAtom == NULL)
         return;
 
-    for (int i = udtaAtom->NextAtomNumber; i < atom_number; i++) {
-        if (parsedAtoms[i].AtomicLevel <= udtaAtom->AtomicLevel) { //we've gone too far
+    for (int i = udtaAtom->NextAtomNumber; i < ap_ctx->atom_number; i++) {
+        if (ap_ctx->parsedAtoms[i].AtomicLevel <= udtaAtom->AtomicLevel) { //we've gone too far
             break;
         }
-        if (parsedAtoms[i].AtomicLevel == udtaAtom->AtomicLevel + 1) {
+        if (ap_ctx->parsedAtoms[i].AtomicLevel == udtaAtom->AtomicLevel + 1) {
 
-            uint32_t box = UInt32FromBigEndian(parsedAtoms[i].AtomicName);
+            uint32_t box = UInt32FromBigEndian(ap_ctx->parsedAtoms[i].AtomicName);
 
             char bitpacked_lang[3];
             memset(bitpacked_lang, 0, 3);
             unsigned char unpacked_lang[3];
 
-            uint32_t box_length = parsedAtoms[i].AtomicLength;
+            uint32_t box_length = ap_ctx->parsedAtoms[i].AtomicLength;
             char* box_data = (char*) malloc(sizeof(char) * box_length);
             memset(box_data, 0, sizeof(char) * box_length);
 
@@ -1360,12 +1368,12 @@ void APar_PrintUserDataAssests() { //3gp files
             case 0x676E7265: //'gnre'
             case 0x616C626D: //'albm'
             {
-                fprintf(stdout, "User data \"%s\" ", parsedAtoms[i].AtomicName);
+                fprintf(stdout, "User data \"%s\" ", ap_ctx->parsedAtoms[i].AtomicName);
 
-                uint16_t packed_lang = APar_read16(bitpacked_lang, source_file, parsedAtoms[i].AtomicStart + 12);
+                uint16_t packed_lang = APar_read16(bitpacked_lang, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 12);
                 APar_UnpackLanguage(unpacked_lang, packed_lang);
 
-                APar_readX(box_data, source_file, parsedAtoms[i].AtomicStart + 14, box_length - 14); //4bytes length, 4 bytes name, 4 bytes flags, 2 bytes lang
+                APar_readX(box_data, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 14, box_length - 14); //4bytes length, 4 bytes name, 4 bytes flags, 2 bytes lang
 
                 //get tracknumber *after* we read the whole tag; if we have a utf16 tag, it will have a BOM, indicating if we have to search for 2 NULLs or a utf8 single NULL, then the ****optional**** tracknumber
                 uint16_t track_num = 1000; //tracknum is a uint8_t, so setting it > 256 means a number wasn't found
@@ -1389,21 +1397,21 @@ void APar_PrintUserDataAssests() { //3gp files
 
             case 0x72746E67: //'rtng'
             {
-                fprintf(stdout, "User data \"%s\" ", parsedAtoms[i].AtomicName);
+                fprintf(stdout, "User data \"%s\" ", ap_ctx->parsedAtoms[i].AtomicName);
 
-                APar_readX(box_data, source_file, parsedAtoms[i].AtomicStart + 12, 4);
+                APar_readX(box_data, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 12, 4);
 
                 fprintf(stdout, "[Rating Entity=%s", box_data);
                 memset(box_data, 0, box_length);
-                APar_readX(box_data, source_file, parsedAtoms[i].AtomicStart + 16, 4);
+                APar_readX(box_data, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 16, 4);
                 fprintf(stdout, " | Criteria=%s", box_data);
 
-                uint16_t packed_lang = APar_read16(bitpacked_lang, source_file, parsedAtoms[i].AtomicStart + 20);
+                uint16_t packed_lang = APar_read16(bitpacked_lang, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 20);
                 APar_UnpackLanguage(unpacked_lang, packed_lang);
                 fprintf(stdout, " lang=%s", unpacked_lang);
 
                 memset(box_data, 0, box_length);
-                APar_readX(box_data, source_file, parsedAtoms[i].AtomicStart + 22, box_length - 8);
+                APar_readX(box_data, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 22, box_length - 8);
 
                 APar_PrintUnicodeAssest(box_data, box_length - 8);
                 fprintf(stdout, "\n");
@@ -1412,14 +1420,14 @@ void APar_PrintUserDataAssests() { //3gp files
 
             case 0x636C7366: //'clsf'
             {
-                fprintf(stdout, "User data \"%s\" ", parsedAtoms[i].AtomicName);
+                fprintf(stdout, "User data \"%s\" ", ap_ctx->parsedAtoms[i].AtomicName);
 
-                APar_readX(box_data, source_file, parsedAtoms[i].AtomicStart + 12, box_length - 12); //4bytes length, 4 bytes name, 4 bytes flags, 2 bytes lang
+                APar_readX(box_data, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 12, box_length - 12); //4bytes length, 4 bytes name, 4 bytes flags, 2 bytes lang
 
                 fprintf(stdout, "[Classification Entity=%s", box_data);
                 fprintf(stdout, " | Index=%u", UInt16FromBigEndian(box_data + 4));
 
-                uint16_t packed_lang = APar_read16(bitpacked_lang, source_file, parsedAtoms[i].AtomicStart + 18);
+                uint16_t packed_lang = APar_read16(bitpacked_lang, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 18);
                 APar_UnpackLanguage(unpacked_lang, packed_lang);
                 fprintf(stdout, " lang=%s", unpacked_lang);
 
@@ -1430,17 +1438,17 @@ void APar_PrintUserDataAssests() { //3gp files
 
             case 0x6B797764: //'kywd'
             {
-                fprintf(stdout, "User data \"%s\" ", parsedAtoms[i].AtomicName);
+                fprintf(stdout, "User data \"%s\" ", ap_ctx->parsedAtoms[i].AtomicName);
 
                 uint32_t box_offset = 12;
 
-                uint16_t packed_lang = APar_read16(bitpacked_lang, source_file, parsedAtoms[i].AtomicStart
+                uint16_t packed_lang = APar_read16(bitpacked_lang, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart
                         + box_offset);
                 box_offset += 2;
 
                 APar_UnpackLanguage(unpacked_lang, packed_lang);
 
-                uint8_t keyword_count = APar_read8(source_file, parsedAtoms[i].AtomicStart + box_offset);
+                uint8_t keyword_count = APar_read8(ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + box_offset);
                 box_offset++;
                 fprintf(stdout, "[Keyword count=%u", keyword_count);
                 fprintf(stdout, " lang=%s]", unpacked_lang);
@@ -1449,10 +1457,10 @@ void APar_PrintUserDataAssests() { //3gp files
 
                 for (uint8_t x = 1; x <= keyword_count; x++) {
                     memset(keyword_data, 0, box_length * 2);
-                    uint8_t keyword_length = APar_read8(source_file, parsedAtoms[i].AtomicStart + box_offset);
+                    uint8_t keyword_length = APar_read8(ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + box_offset);
                     box_offset++;
 
-                    APar_readX(keyword_data, source_file, parsedAtoms[i].AtomicStart + box_offset, (uint32_t) keyword_length);
+                    APar_readX(keyword_data, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + box_offset, (uint32_t) keyword_length);
                     box_offset += keyword_length;
                     APar_SimplePrintUnicodeAssest(keyword_data, keyword_length, true);
                 }
@@ -1465,16 +1473,16 @@ void APar_PrintUserDataAssests() { //3gp files
 
             case 0x6C6F6369: //'loci' aka The Most Heinous Metadata Atom Every Invented - decimal meters? fictional location? Astromical Body? Say I shoot it on the International Space Station? That isn't a Astronimical Body. And 16.16 alt only goes up to 20.3 miles (because of negatives, its really 15.15) & the ISS is at 230 miles. Oh, pish.... what ever shall I do? I fear I am on the horns of a dilema.
             {
-                fprintf(stdout, "User data \"%s\" ", parsedAtoms[i].AtomicName);
+                fprintf(stdout, "User data \"%s\" ", ap_ctx->parsedAtoms[i].AtomicName);
 
                 uint32_t box_offset = 12;
-                uint16_t packed_lang = APar_read16(bitpacked_lang, source_file, parsedAtoms[i].AtomicStart
+                uint16_t packed_lang = APar_read16(bitpacked_lang, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart
                         + box_offset);
                 box_offset += 2;
 
                 APar_UnpackLanguage(unpacked_lang, packed_lang);
 
-                APar_readX(box_data, source_file, parsedAtoms[i].AtomicStart + box_offset, box_length);
+                APar_readX(box_data, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + box_offset, box_length);
                 fprintf(stdout, "[lang=%s] ", unpacked_lang);
 
                 //the length of the location string is unknown (max is box lenth), but the long/lat/alt/body/notes needs to be retrieved.
@@ -1490,7 +1498,7 @@ void APar_PrintUserDataAssests() { //3gp files
                 fprintf(stdout, "Location: ");
                 APar_SimplePrintUnicodeAssest(box_data, box_length, false);
 
-                uint8_t location_role = APar_read8(source_file, parsedAtoms[i].AtomicStart + box_offset);
+                uint8_t location_role = APar_read8(ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + box_offset);
                 box_offset++;
                 switch (location_role) {
                 case 0: {
@@ -1514,13 +1522,13 @@ void APar_PrintUserDataAssests() { //3gp files
                 char* float_buffer = (char*) malloc(sizeof(char) * 5);
                 memset(float_buffer, 0, 5);
 
-                fprintf(stdout, "[Long %lf", fixed_point_16x16bit_to_double(APar_read32(float_buffer, source_file, parsedAtoms[i].AtomicStart
+                fprintf(stdout, "[Long %lf", fixed_point_16x16bit_to_double(APar_read32(float_buffer, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart
                         + box_offset)));
                 box_offset += 4;
-                fprintf(stdout, " Lat %lf", fixed_point_16x16bit_to_double(APar_read32(float_buffer, source_file, parsedAtoms[i].AtomicStart
+                fprintf(stdout, " Lat %lf", fixed_point_16x16bit_to_double(APar_read32(float_buffer, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart
                         + box_offset)));
                 box_offset += 4;
-                fprintf(stdout, " Alt %lf ", fixed_point_16x16bit_to_double(APar_read32(float_buffer, source_file, parsedAtoms[i].AtomicStart
+                fprintf(stdout, " Alt %lf ", fixed_point_16x16bit_to_double(APar_read32(float_buffer, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart
                         + box_offset)));
                 box_offset += 4;
                 free(float_buffer);
@@ -1549,9 +1557,9 @@ void APar_PrintUserDataAssests() { //3gp files
 
             case 0x79727263: //'yrrc'
             {
-                fprintf(stdout, "User data \"%s\" ", parsedAtoms[i].AtomicName);
+                fprintf(stdout, "User data \"%s\" ", ap_ctx->parsedAtoms[i].AtomicName);
 
-                uint16_t recording_year = APar_read16(bitpacked_lang, source_file, parsedAtoms[i].AtomicStart + 12);
+                uint16_t recording_year = APar_read16(bitpacked_lang, ap_ctx->source_file, ap_ctx->parsedAtoms[i].AtomicStart + 12);
                 fprintf(stdout, ": %u\n", recording_year);
                 break;
             }
@@ -1600,8 +1608,8 @@ void APar_Extract_uuid_binary_file(AtomicInfo* uuid_atom, const char* originatin
     }
     char* uuid_payload = (char*) calloc(1, sizeof(char) * (uuid_atom->AtomicLength - 36 + 1));
 
-    fseeko(source_file, uuid_atom->AtomicStart + 36, SEEK_SET);
-    fread(uuid_payload, 1, uuid_atom->AtomicLength - 36, source_file);
+    fseeko(ap_ctx->source_file, uuid_atom->AtomicStart + 36, SEEK_SET);
+    fread(uuid_payload, 1, uuid_atom->AtomicLength - 36, ap_ctx->source_file);
 
     uint32_t descrip_len = UInt32FromBigEndian(uuid_payload);
     atom_offsets += 4 + descrip_len;
@@ -1638,6 +1646,31 @@ void APar_Extract_uuid_binary_file(AtomicInfo* uuid_atom, const char* originatin
     return;
 }
 
+/**
+ * Read the picture carried by the given 'data' atom under 'covr'
+ * into memory. The number of bytes is stored in image_len.
+ *
+ * Returns the picture data, which must be freed, or NULL if the atom
+ * is empty.
+ */
+char* APar_ExtractAAC_ArtworkData(short this_atom_num, uint32_t* image_len) {
+    *image_len = 0;
+    if (!ap_ctx->source_file || ap_ctx->parsedAtoms[this_atom_num].AtomicLength <= 16)
+        return NULL;
+
+    uint32_t art_len = ap_ctx->parsedAtoms[this_atom_num].AtomicLength - 16;
+    char* art_payload = (char*) malloc(sizeof(char) * art_len + 1);
+    memset(art_payload, 0, art_len + 1);
+
+    fseeko(ap_ctx->source_file, ap_ctx->parsedAtoms[this_atom_num].AtomicStart + 16, SEEK_SET);
+    *image_len = (uint32_t) fread(art_payload, 1, art_len, ap_ctx->source_file);
+    if (*image_len == 0) {
+        free(art_payload);
+        return NULL;
+    }
+    return art_payload;
+}
+
 /**
  * Extract the artwork from the given atom to a file using the
  * pic_output_prefix as the basis of the returned artwork file.
@@ -1653,25 +1686,23 @@ char* APar_ExtractAAC_Artwork(short this_atom_num, char* pic_output_prefix, shor
     strcat(base_outpath, "_artwork");
     sprintf(base_outpath, "%s_%d", base_outpath, artwork_count);
 
-    char* art_payload = (char*) malloc(sizeof(char) * (parsedAtoms[this_atom_num].AtomicLength - 16) + 1);
-    memset(art_payload, 0, (parsedAtoms[this_atom_num].AtomicLength - 16) + 1);
-
-    fseeko(source_file, parsedAtoms[this_atom_num].AtomicStart + 16, SEEK_SET);
-    fread(art_payload, 1, parsedAtoms[this_atom_num].AtomicLength - 16, source_file);
+    uint32_t art_len;
+    char* art_payload = APar_ExtractAAC_ArtworkData(this_atom_num, &art_len);
+    if (art_payload == NULL)
+        return base_outpath;
 
-    const char* suffix = (char *) malloc(sizeof(char) * 5);
-    if (memcmp(art_payload, "\x89\x50\x4E\x47\x0D\x0A\x1A\x0A", 8) == 0) {
-        suffix = ".png";
-    }
-    else if (memcmp(art_payload, "\xFF\xD8\xFF\xE0", 4) == 0 || memcmp(art_payload, "\xFF\xD8\xFF\xE1", 4) == 0) {
-        suffix = ".jpg";
+    switch (APar_TestArtworkBinaryBuffer(art_payload, art_len)) {
+    case AtomFlags_Data_PNGBinary:
+        strcat(base_outpath, ".png");
+        break;
+    case AtomFlags_Data_JPEGBinary:
+        strcat(base_outpath, ".jpg");
+        break;
     }
 
-    strcat(base_outpath, suffix);
-
     FILE *outfile = APar_OpenFile(base_outpath, "wb");
     if (outfile != NULL) {
-        fwrite(art_payload, (size_t) (parsedAtoms[this_atom_num].AtomicLength - 16), 1, outfile);
+        fwrite(art_payload, (size_t) art_len, 1, outfile);
         fclose(outfile);
         fprintf(stdout, "Extracted artwork to file: ");
         APar_fprintf_UTF8_data(base_outpath);
@@ -1683,13 +1714,13 @@ char* APar_ExtractAAC_Artwork(short this_atom_num, char* pic_output_prefix, shor
 }
 
 char* APar_ExtractDataAtom(int this_atom_number) {
-    if (!source_file)
+    if (!ap_ctx->source_file)
         return NULL;
 
-    AtomicInfo* thisAtom = &parsedAtoms[this_atom_number];
+    AtomicInfo* thisAtom = &ap_ctx->parsedAtoms[this_atom_number];
     char* parent_atom_name;
 
-    AtomicInfo parent_atom_stats = parsedAtoms[this_atom_number - 1];
+    AtomicInfo parent_atom_stats = ap_ctx->parsedAtoms[this_atom_number - 1];
     parent_atom_name = parent_atom_stats.AtomicName;
 
     uint32_t min_atom_datasize = 12;
@@ -1712,8 +1743,8 @@ char* APar_ExtractDataAtom(int this_atom_number) {
     char* data_payload = (char*) malloc(sizeof(char) * (thisAtom->AtomicLength - atom_header_size + 1));
     memset(data_payload, 0, sizeof(char) * (thisAtom->AtomicLength - atom_header_size + 1));
 
-    fseeko(source_file, thisAtom->AtomicStart + atom_header_size, SEEK_SET);
-    fread(data_payload, 1, thisAtom->AtomicLength - atom_header_size, source_file);
+    fseeko(ap_ctx->source_file, thisAtom->AtomicStart + atom_header_size, SEEK_SET);
+    fread(data_payload, 1, thisAtom->AtomicLength - atom_header_size, ap_ctx->source_file);
 
     if (thisAtom->AtomicVerFlags == (uint32_t) AtomFlags_Data_Text) {
         if (thisAtom->AtomicLength < (atom_header_size + 4)) {
@@ -1925,20 +1956,20 @@ void APar_PrintDataAtoms(const char *path, char* output_path, uint8_t supplement
 
     short artwork_count = 0;
 
-    for (int i = 0; i < atom_number; i++) {
-        AtomicInfo* thisAtom = &parsedAtoms[i];
+    for (int i = 0; i < ap_ctx->atom_number; i++) {
+        AtomicInfo* thisAtom = &ap_ctx->parsedAtoms[i];
 
         if (strncmp(thisAtom->AtomicName, "data", 4) == 0) { //thisAtom->AtomicClassification == VERSIONED_ATOM) {
 
-            AtomicInfo* parent = &parsedAtoms[APar_FindParentAtom(i, thisAtom->AtomicLevel)];
+            AtomicInfo* parent = &ap_ctx->parsedAtoms[APar_FindParentAtom(i, thisAtom->AtomicLevel)];
 
             if ((thisAtom->AtomicVerFlags == (uint32_t) AtomFlags_Data_Binary
                     || thisAtom->AtomicVerFlags == (uint32_t) AtomFlags_Data_Text
                     || thisAtom->AtomicVerFlags == (uint32_t) AtomFlags_Data_UInt)
                     && target_information == PRINT_DATA) {
                 if (strncmp(parent->AtomicName, "----", 4) == 0) {
-                    if (memcmp(parsedAtoms[i - 1].AtomicName, "name", 4) == 0) {
-                        fprintf(stdout, "Atom \"%s\" [%s] contains: ", parent->AtomicName, parsedAtoms[i - 1].ReverseDNSname);
+                    if (memcmp(ap_ctx->parsedAtoms[i - 1].AtomicName, "name", 4) == 0) {
+                        fprintf(stdout, "Atom \"%s\" [%s] contains: ", parent->AtomicName, ap_ctx->parsedAtoms[i - 1].ReverseDNSname);
                         APar_ExtractDataAtom(i);
                     }
 
@@ -1949,16 +1980,16 @@ void APar_PrintDataAtoms(const char *path, char* output_path, uint8_t supplement
                 }
                 else {
                     //converts iso8859 � in '�ART' to a 2byte utf8 � glyph; replaces libiconv conversion
-                    memset(twenty_byte_buffer, 0, sizeof(char) * 20);
-                    isolat1ToUTF8((unsigned char*) twenty_byte_buffer, 10, (unsigned char*) parent->AtomicName, 4);
+                    memset(ap_ctx->twenty_byte_buffer, 0, sizeof(char) * 20);
+                    isolat1ToUTF8((unsigned char*) ap_ctx->twenty_byte_buffer, 10, (unsigned char*) parent->AtomicName, 4);
 
                     if (UnicodeOutputStatus == WIN32_UTF16) {
                         fprintf(stdout, "Atom \"");
-                        APar_fprintf_UTF8_data(twenty_byte_buffer);
+                        APar_fprintf_UTF8_data(ap_ctx->twenty_byte_buffer);
                         fprintf(stdout, "\" contains: ");
                     }
                     else {
-                        fprintf(stdout, "Atom \"%s\" contains: ", twenty_byte_buffer);
+                        fprintf(stdout, "Atom \"%s\" contains: ", ap_ctx->twenty_byte_buffer);
                     }
 
                     APar_ExtractDataAtom(i);
@@ -1977,19 +2008,19 @@ void APar_PrintDataAtoms(const char *path, char* output_path, uint8_t supplement
             }
         }
         else if (thisAtom->AtomicClassification == EXTENDED_ATOM && thisAtom->uuid_style == UUID_DEPRECATED_FORM) {
-            memset(twenty_byte_buffer, 0, sizeof(char) * 20);
+            memset(ap_ctx->twenty_byte_buffer, 0, sizeof(char) * 20);
             //converts iso8859 � in '�foo' to a 2byte utf8 � glyph; replaces libiconv conversion
-            isolat1ToUTF8((unsigned char*) twenty_byte_buffer, 10, (unsigned char*) thisAtom->AtomicName, 4);
+            isolat1ToUTF8((unsigned char*) ap_ctx->twenty_byte_buffer, 10, (unsigned char*) thisAtom->AtomicName, 4);
 
             if (thisAtom->AtomicVerFlags == (uint32_t) AtomFlags_Data_Text && target_information == PRINT_DATA) {
 
                 if (UnicodeOutputStatus == WIN32_UTF16) {
                     fprintf(stdout, "Atom uuid=\"");
-                    APar_fprintf_UTF8_data(twenty_byte_buffer);
+                    APar_fprintf_UTF8_data(ap_ctx->twenty_byte_buffer);
                     fprintf(stdout, "\" contains: ");
                 }
                 else {
-                    fprintf(stdout, "Atom uuid=\"%s\" contains: ", twenty_byte_buffer);
+                    fprintf(stdout, "Atom uuid=\"%s\" contains: ", ap_ctx->twenty_byte_buffer);
                 }
 
                 APar_ExtractDataAtom(i);
@@ -1997,14 +2028,14 @@ void APar_PrintDataAtoms(const char *path, char* output_path, uint8_t supplement
         }
         else if (thisAtom->AtomicClassification == EXTENDED_ATOM) {
             if (thisAtom->uuid_style == UUID_AP_SHA1_NAMESPACE) {
-                memset(twenty_byte_buffer, 0, sizeof(char) * 20);
+                memset(ap_ctx->twenty_byte_buffer, 0, sizeof(char) * 20);
                 if (target_information == PRINT_DATA) {
-                    isolat1ToUTF8((unsigned char*) twenty_byte_buffer, 10, (unsigned char*) thisAtom->uuid_ap_atomname, 4);
+                    isolat1ToUTF8((unsigned char*) ap_ctx->twenty_byte_buffer, 10, (unsigned char*) thisAtom->uuid_ap_atomname, 4);
 
                     fprintf(stdout, "Atom uuid=");
                     APar_print_uuid((ap_uuid_t*) thisAtom->AtomicName, false);
                     fprintf(stdout, " (AP uuid for \"");
-                    APar_fprintf_UTF8_data(twenty_byte_buffer);
+                    APar_fprintf_UTF8_data(ap_ctx->twenty_byte_buffer);
                     fprintf(stdout, "\") contains: ");
 
                     APar_ExtractDataAtom(i);
@@ -2030,7 +2061,7 @@ void APar_PrintDataAtoms(const char *path, char* output_path, uint8_t supplement
 
     if (supplemental_info) {
         fprintf(stdout, "---------------------------\n");
-        udta_dynamics.dynamic_updating = false;
+        ap_ctx->udta_dynamics.dynamic_updating = false;
         APar_DetermineDynamicUpdate(true); //gets the size of the padding
         APar_Optimize(true); //just to know if 'free' atoms can be considered padding, or (in the case of say a faac file) it's *just* 'free'
 
@@ -2038,15 +2069,15 @@ void APar_PrintDataAtoms(const char *path, char* output_path, uint8_t supplement
             fprintf(stdout, "free atom space: %u\n", APar_ProvideTallyForAtom("free"));
         }
         if (supplemental_info && 0x04) { //PRINT_PADDING_SPACE
-            if (!moov_atom_was_mooved) {
-                fprintf(stdout, "padding available: %u bytes\n", udta_dynamics.max_usable_free_space);
+            if (!ap_ctx->moov_atom_was_mooved) {
+                fprintf(stdout, "padding available: %u bytes\n", ap_ctx->udta_dynamics.max_usable_free_space);
             }
             else {
                 fprintf(stdout, "padding available: 0 (reorg)\n");
             }
         }
-        if (supplemental_info && 0x08 && udtaAtom != NULL) { //PRINT_USER_DATA_SPACE
-            fprintf(stdout, "user data space: %u\n", udtaAtom->AtomicLength);
+        if (supplemental_info && 0x08 && ap_ctx->udtaAtom != NULL) { //PRINT_USER_DATA_SPACE
+            fprintf(stdout, "user data space: %u\n", ap_ctx->udtaAtom->AtomicLength);
         }
         if (supplemental_info && 0x10) { //PRINT_USER_DATA_SPACE
             fprintf(stdout, "media data space: %u\n", APar_ProvideTallyForAtom("mdat"));
@@ -2078,15 +2109,15 @@ void APar_PrintAtomicTree() {
 
     //loop through each atom in the struct array (which holds the offset info/data)
     while (true) {
-        AtomicInfo* thisAtom = &parsedAtoms[thisAtomNumber];
+        AtomicInfo* thisAtom = &ap_ctx->parsedAtoms[thisAtomNumber];
         memset(tree_padding, 0, sizeof(char) * 126);
-        memset(twenty_byte_buffer, 0, sizeof(char) * 20);
+        memset(ap_ctx->twenty_byte_buffer, 0, sizeof(char) * 20);
 
         if (thisAtom->uuid_ap_atomname != NULL) {
-            isolat1ToUTF8((unsigned char*) twenty_byte_buffer, 10, (unsigned char*) thisAtom->uuid_ap_atomname, 4); //converts iso8859 � in '�ART' to a 2byte utf8 � glyph
+            isolat1ToUTF8((unsigned char*) ap_ctx->twenty_byte_buffer, 10, (unsigned char*) thisAtom->uuid_ap_atomname, 4); //converts iso8859 � in '�ART' to a 2byte utf8 � glyph
         }
         else {
-            isolat1ToUTF8((unsigned char*) twenty_byte_buffer, 10, (unsigned char*) thisAtom->AtomicName, 4); //converts iso8859 � in '�ART' to a 2byte utf8 � glyph
+            isolat1ToUTF8((unsigned char*) ap_ctx->twenty_byte_buffer, 10, (unsigned char*) thisAtom->AtomicName, 4); //converts iso8859 � in '�ART' to a 2byte utf8 � glyph
         }
 
         strcpy(tree_padding, "");
@@ -2098,13 +2129,13 @@ void APar_PrintAtomicTree() {
         }
 
         if (thisAtom->AtomicLength == 0) {
-            fprintf(stdout, "%sAtom %s @ %u of size: %u (%u*), ends @ %u\n", tree_padding, twenty_byte_buffer, thisAtom->AtomicStart, ((uint32_t) file_size
-                    - thisAtom->AtomicStart), thisAtom->AtomicLength, (uint32_t) file_size);
+            fprintf(stdout, "%sAtom %s @ %u of size: %u (%u*), ends @ %u\n", tree_padding, ap_ctx->twenty_byte_buffer, thisAtom->AtomicStart, ((uint32_t) ap_ctx->file_size
+                    - thisAtom->AtomicStart), thisAtom->AtomicLength, (uint32_t) ap_ctx->file_size);
             fprintf(stdout, "\t\t\t (*)denotes length of atom goes to End-of-File\n");
 
         }
         else if (thisAtom->AtomicLength == 1) {
-            fprintf(stdout, "%sAtom %s @ %u of size: %llu (^), ends @ %llu\n", tree_padding, twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLengthExtended, (thisAtom->AtomicStart
+            fprintf(stdout, "%sAtom %s @ %u of size: %llu (^), ends @ %llu\n", tree_padding, ap_ctx->twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLengthExtended, (thisAtom->AtomicStart
                     + thisAtom->AtomicLengthExtended));
             fprintf(stdout, "\t\t\t (^)denotes a 64-bit atom length\n");
 
@@ -2114,12 +2145,12 @@ void APar_PrintAtomicTree() {
 
             if (UnicodeOutputStatus == WIN32_UTF16) {
                 fprintf(stdout, "%sAtom uuid=", tree_padding);
-                APar_fprintf_UTF8_data(twenty_byte_buffer);
+                APar_fprintf_UTF8_data(ap_ctx->twenty_byte_buffer);
                 fprintf(stdout, " @ %u of size: %u, ends @ %u\n", thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
                         + thisAtom->AtomicLength));
             }
             else {
-                fprintf(stdout, "%sAtom uuid=%s @ %u of size: %u, ends @ %u\n", tree_padding, twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
+                fprintf(stdout, "%sAtom uuid=%s @ %u of size: %u, ends @ %u\n", tree_padding, ap_ctx->twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
                         + thisAtom->AtomicLength));
             }
 
@@ -2128,7 +2159,7 @@ void APar_PrintAtomicTree() {
             if (thisAtom->uuid_style == UUID_AP_SHA1_NAMESPACE) {
                 fprintf(stdout, "%sAtom uuid=", tree_padding);
                 APar_print_uuid((ap_uuid_t*) thisAtom->AtomicName, false);
-                fprintf(stdout, "(APuuid=%s) @ %u of size: %u, ends @ %u\n", twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
+                fprintf(stdout, "(APuuid=%s) @ %u of size: %u, ends @ %u\n", ap_ctx->twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
                         + thisAtom->AtomicLength));
             }
             else {
@@ -2146,12 +2177,12 @@ void APar_PrintAtomicTree() {
 
             if (UnicodeOutputStatus == WIN32_UTF16) {
                 fprintf(stdout, "%sAtom ", tree_padding);
-                APar_fprintf_UTF8_data(twenty_byte_buffer);
+                APar_fprintf_UTF8_data(ap_ctx->twenty_byte_buffer);
                 fprintf(stdout, " [%s] @ %u of size: %u, ends @ %u\n", unpacked_lang, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
                         + thisAtom->AtomicLength));
             }
             else {
-                fprintf(stdout, "%sAtom %s [%s] @ %u of size: %u, ends @ %u\n", tree_padding, twenty_byte_buffer, unpacked_lang, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
+                fprintf(stdout, "%sAtom %s [%s] @ %u of size: %u, ends @ %u\n", tree_padding, ap_ctx->twenty_byte_buffer, unpacked_lang, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
                         + thisAtom->AtomicLength));
             }
 
@@ -2161,12 +2192,12 @@ void APar_PrintAtomicTree() {
 
             if (UnicodeOutputStatus == WIN32_UTF16) {
                 fprintf(stdout, "%sAtom ", tree_padding);
-                APar_fprintf_UTF8_data(twenty_byte_buffer);
+                APar_fprintf_UTF8_data(ap_ctx->twenty_byte_buffer);
                 fprintf(stdout, " @ %u of size: %u, ends @ %u", thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
                         + thisAtom->AtomicLength));
             }
             else {
-                fprintf(stdout, "%sAtom %s @ %u of size: %u, ends @ %u", tree_padding, twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
+                fprintf(stdout, "%sAtom %s @ %u of size: %u, ends @ %u", tree_padding, ap_ctx->twenty_byte_buffer, thisAtom->AtomicStart, thisAtom->AtomicLength, (thisAtom->AtomicStart
                         + thisAtom->AtomicLength));
             }
 
@@ -2188,20 +2219,20 @@ void APar_PrintAtomicTree() {
         }
         //this is where the *raw* audio/video file is, the rest is container-related fluff.
         if ((memcmp(thisAtom->AtomicName, "mdat", 4) == 0) && (thisAtom->AtomicLength > 100)) {
-            mdatData += thisAtom->AtomicLength;
+            ap_ctx->mdatData += thisAtom->AtomicLength;
         }
         else if (memcmp(thisAtom->AtomicName, "mdat", 4) == 0 && thisAtom->AtomicLength == 0) { //mdat.length = 0 = ends at EOF
-            mdatData = (uint32_t) file_size - thisAtom->AtomicStart;
+            ap_ctx->mdatData = (uint32_t) ap_ctx->file_size - thisAtom->AtomicStart;
         }
         else if (memcmp(thisAtom->AtomicName, "mdat", 4) == 0 && thisAtom->AtomicLengthExtended != 0) {
-            mdatData += thisAtom->AtomicLengthExtended; //this is still adding a (limited) uint64_t into a uint32_t
+            ap_ctx->mdatData += thisAtom->AtomicLengthExtended; //this is still adding a (limited) uint64_t into a uint32_t
         }
 
-        if (parsedAtoms[thisAtomNumber].NextAtomNumber == 0) {
+        if (ap_ctx->parsedAtoms[thisAtomNumber].NextAtomNumber == 0) {
             break;
         }
         else {
-            thisAtomNumber = parsedAtoms[thisAtomNumber].NextAtomNumber;
+            thisAtomNumber = ap_ctx->parsedAtoms[thisAtomNumber].NextAtomNumber;
         }
     }
 
@@ -2210,23 +2241,23 @@ void APar_PrintAtomicTree() {
     }
 
     fprintf(stdout, "------------------------------------------------------\n");
-    fprintf(stdout, "Total size: %llu bytes; ", (uint64_t) file_size);
-    fprintf(stdout, "%i atoms total. ", atom_number - 1);
+    fprintf(stdout, "Total size: %llu bytes; ", (uint64_t) ap_ctx->file_size);
+    fprintf(stdout, "%i atoms total. ", ap_ctx->atom_number - 1);
     ShowVersionInfo();
-    fprintf(stdout, "Media data: %u bytes; %u bytes all other atoms (%2.3lf%% atom overhead).\n", mdatData, (uint32_t) (file_size
-            - mdatData), (double) (file_size - mdatData) / (double) file_size * 100.0);
+    fprintf(stdout, "Media data: %u bytes; %u bytes all other atoms (%2.3lf%% atom overhead).\n", ap_ctx->mdatData, (uint32_t) (ap_ctx->file_size
+            - ap_ctx->mdatData), (double) (ap_ctx->file_size - ap_ctx->mdatData) / (double) ap_ctx->file_size * 100.0);
     fprintf(stdout, "Total free atom space: %u bytes; %2.3lf%% waste.", freeSpace, (double) freeSpace
-            / (double) file_size * 100.0);
+            / (double) ap_ctx->file_size * 100.0);
     if (freeSpace) {
-        udta_dynamics.dynamic_updating = false;
+        ap_ctx->udta_dynamics.dynamic_updating = false;
         APar_DetermineDynamicUpdate(true); //gets the size of the padding
         APar_Optimize(true); //just to know if 'free' atoms can be considered padding, or (in the case of say a faac file) it's *just* 'free'
-        if (!moov_atom_was_mooved) {
-            fprintf(stdout, " Padding available: %u bytes.", udta_dynamics.max_usable_free_space);
+        if (!ap_ctx->moov_atom_was_mooved) {
+            fprintf(stdout, " Padding available: %u bytes.", ap_ctx->udta_dynamics.max_usable_free_space);
         }
     }
-    if (gapless_void_padding > 0) {
-        fprintf(stdout, "\nGapless playback null space at end of file: %u bytes.", gapless_void_padding);
+    if (ap_ctx->gapless_void_padding > 0) {
+        fprintf(stdout, "\nGapless playback null space at end of file: %u bytes.", ap_ctx->gapless_void_padding);
     }
     fprintf(stdout, "\n------------------------------------------------------\n");
 
@@ -2246,12 +2277,12 @@ void APar_SimpleAtomPrintout() { //loop through each atom in the struct array (w
     }
 #endif
 
-    for (int i = 0; i < atom_number; i++) {
-        AtomicInfo* thisAtom = &parsedAtoms[i];
+    for (int i = 0; i < ap_ctx->atom_number; i++) {
+        AtomicInfo* thisAtom = &ap_ctx->parsedAtoms[i];
 
         fprintf(stdout, "%i  -  Atom \"%s\" (level %u) has next atom at #%i\n", i, thisAtom->AtomicName, thisAtom->AtomicLevel, thisAtom->NextAtomNumber);
     }
-    fprintf(stdout, "Total of %i atoms.\n", atom_number - 1);
+    fprintf(stdout, "Total of %i atoms.\n", ap_ctx->atom_number - 1);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -2259,13 +2290,12 @@ void APar_SimpleAtomPrintout() { //loop through each atom in the struct array (w
 ///////////////////////////////////////////////////////////////////////////////////////
 
 void APar_AtomizeFileInfo(uint32_t Astart, uint32_t Alength, uint64_t Aextendedlength, char* Astring, uint8_t Alevel, uint8_t Acon_state, uint8_t Aclass, uint32_t Averflags, uint16_t Alang, uuid_vitals* uuid_info) {
-    static bool passed_mdat = false;
-    AtomicInfo* thisAtom = &parsedAtoms[atom_number];
+    AtomicInfo* thisAtom = &ap_ctx->parsedAtoms[ap_ctx->atom_number];
 
     thisAtom->AtomicStart = Astart;
     thisAtom->AtomicLength = Alength;
     thisAtom->AtomicLengthExtended = Aextendedlength;
-    thisAtom->AtomicNumber = atom_number;
+    thisAtom->AtomicNumber = ap_ctx->atom_number;
     thisAtom->AtomicLevel = Alevel;
     thisAtom->AtomicContainerState = Acon_state;
     thisAtom->AtomicClassification = Aclass;
@@ -2298,26 +2328,28 @@ void APar_AtomizeFileInfo(uint32_t Astart, uint32_t Alength, uint64_t Aextendedl
     thisAtom->stsd_codec = 0;
 
     //set the next atom number of the PREVIOUS atom (we didn't know there would be one until now); this is our default normal mode
-    parsedAtoms[atom_number - 1].NextAtomNumber = atom_number;
+    if (ap_ctx->atom_number > 0) { //the first atom has no predecessor; don't write in front of parsedAtoms
+        ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].NextAtomNumber = ap_ctx->atom_number;
+    }
     thisAtom->NextAtomNumber = 0; //this could be the end... (we just can't quite say until we find another atom)
 
     if (strncmp(Astring, "mdat", 4) == 0) {
-        passed_mdat = true;
+        ap_ctx->passed_mdat = true;
     }
 
-    if (!passed_mdat && Alevel == 1) {
-        bytes_before_mdat += Alength; //this value gets used during FreeFree (for removed_bytes_tally) & chunk offset calculations
+    if (!ap_ctx->passed_mdat && Alevel == 1) {
+        ap_ctx->bytes_before_mdat += Alength; //this value gets used during FreeFree (for removed_bytes_tally) & chunk offset calculations
     }
 
-    atom_number++; //increment to the next AtomicInfo array
+    ap_ctx->atom_number++; //increment to the next AtomicInfo array
 
     return;
 }
 
 uint8_t APar_GetCurrentAtomDepth(uint32_t atom_start, uint32_t atom_length) {
     short level = 1;
-    for (int i = 0; i < atom_number; i++) {
-        AtomicInfo* thisAtom = &parsedAtoms[i];
+    for (int i = 0; i < ap_ctx->atom_number; i++) {
+        AtomicInfo* thisAtom = &ap_ctx->parsedAtoms[i];
         if (atom_start == (thisAtom->AtomicStart + thisAtom->AtomicLength)) {
             return thisAtom->AtomicLevel;
         }
@@ -2331,8 +2363,8 @@ uint8_t APar_GetCurrentAtomDepth(uint32_t atom_start, uint32_t atom_length) {
 }
 
 void APar_IdentifyBrand(char* file_brand) {
-    brand = UInt32FromBigEndian(file_brand);
-    switch (brand) {
+    ap_ctx->brand = UInt32FromBigEndian(file_brand);
+    switch (ap_ctx->brand) {
     //what ISN'T supported
     case 0x71742020: //'qt  '  --this is listed at mp4ra, but there are features of the file that aren't supported (like the 4 NULL bytes after the last udta child atom
         fprintf(stdout, "AtomicParsley error: Quicktime movie files are not supported.\n");
@@ -2343,14 +2375,14 @@ void APar_IdentifyBrand(char* file_brand) {
     case 0x33673261: //'3g2a' 3GPP2 release 0
     case 0x33673262: //'3g2b' 3GPP2 release A
     case 0x6B646469: //'kddi' 3GPP2 EZmovie (optionally restricted) media
-        metadata_style = THIRD_GEN_PARTNER_VER2;
+        ap_ctx->metadata_style = THIRD_GEN_PARTNER_VER2;
         break;
 
     case 0x33677034: //'3gp4'
     case 0x33677035: //'3gp5' //'albm' album tag was added in Release6, so it shouldn't be added to a 3gp5 or 3gp4 branded file.
     case 0x6D6D7034: //'mmp4' probably does not support album; minor brands only go up to 3gp5, so.... I'm guessing not
 
-        metadata_style = THIRD_GEN_PARTNER;
+        ap_ctx->metadata_style = THIRD_GEN_PARTNER;
         break;
 
     case 0x33677036: //'3gp6'
@@ -2360,13 +2392,13 @@ void APar_IdentifyBrand(char* file_brand) {
     case 0x33676536: //'3ge6' extended presentations (jpeg images)
     case 0x33676736: //'3gg6' general (not yet suitable; superset)
 
-        metadata_style = THIRD_GEN_PARTNER_VER1_REL6;
+        ap_ctx->metadata_style = THIRD_GEN_PARTNER_VER1_REL6;
         break;
 
         //what IS supported for iTunes-style metadata
     case 0x4D534E56: //'MSNV'  (PSP) - this isn't actually listed at mp4ra, but since they are popular...
-        metadata_style = ITUNES_STYLE;
-        psp_brand = true;
+        ap_ctx->metadata_style = ITUNES_STYLE;
+        ap_ctx->psp_brand = true;
         break;
     case 0x4D344120: //'M4A '  -- these are all listed at http://www.mp4ra.org/filetype.html as registered brands
     case 0x4D344220: //'M4B '
@@ -2377,7 +2409,7 @@ void APar_IdentifyBrand(char* file_brand) {
     case 0x69736F6D: //'isom'
     case 0x69736F32: //'iso2'
     case 0x61766331: //'avc1'
-        metadata_style = ITUNES_STYLE;
+        ap_ctx->metadata_style = ITUNES_STYLE;
         break;
 
         //other lesser unsupported brands; http://www.mp4ra.org/filetype.html like dv, mjpeg200, mp21 & ... whatever mpeg7 brand is
@@ -2395,7 +2427,7 @@ void APar_Extract_stsd_codec(FILE* file, uint32_t midJump) {
     memset(codec_data, 0, 12 + 1);
     fseeko(file, midJump, SEEK_SET);
     fread(codec_data, 1, 12, file);
-    parsedAtoms[atom_number - 1].stsd_codec = UInt32FromBigEndian(extractAtomName(codec_data, 1));
+    ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].stsd_codec = UInt32FromBigEndian(extractAtomName(codec_data, 1));
 
     free(codec_data);
     codec_data = NULL;
@@ -2415,7 +2447,7 @@ uint64_t APar_64bitAtomRead(FILE *file, uint32_t jump_point) {
     //here's the problem: there can be some HUGE MPEG-4 files. They get specified by a 64-bit value. The specification says only use them when necessary - I've seen them on files about 700MB. So this will artificially place a limit on the maximum file size that would be supported under a 32-bit only AtomicParsley (but could still see & use smaller 64-bit values). For my 700MB file, moov was (rounded up) 4MB. So say 4MB x 6 +1MB give or take, and the biggest moov atom I would support is.... a heart stopping 30MB (rounded up). GADZOOKS!!! So, since I have no need to go greater than that EVER, I'm going to stik with uin32_t for filesizes and offsets & that sort. But a smaller 64-bit mdat (essentially a pseudo 32-bit traditional mdat) can be supported as long as its less than UINT32_T_MAX (minus our big fat moov allowance).
 
     if (extended_dataSize > 4294967295UL - 30000000) {
-        contains_unsupported_64_bit_atom = true;
+        ap_ctx->contains_unsupported_64_bit_atom = true;
         fprintf(stdout, "You must be off your block thinking I'm going to tag a file that is at LEAST %llu bytes long.\n", extended_dataSize);
         fprintf(stdout, "AtomicParsley doesn't have full 64-bit support");
     }
@@ -2454,10 +2486,10 @@ int APar_MatchToKnownAtom(const char* atom_name, const char* atom_container, boo
         memset(fullpath, 0, sizeof(char) * 200);
 
         if (fromFile) {
-            APar_ProvideAtomPath(parsedAtoms[atom_number - 1].AtomicNumber, fullpath, fromFile);
+            APar_ProvideAtomPath(ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].AtomicNumber, fullpath, fromFile);
         }
         else { //find_atom_path only is NULL in APar_ScanAtoms (where fromFile is true) and in APar_CreateSparseAtom, where atom_number was just filled
-            APar_ProvideAtomPath(parsedAtoms[atom_number].AtomicNumber, fullpath, fromFile);
+            APar_ProvideAtomPath(ap_ctx->parsedAtoms[ap_ctx->atom_number].AtomicNumber, fullpath, fromFile);
         }
 
         if (memcmp(fullpath, "moov.udta.meta.ilst.", 20) == 0) {
@@ -2472,7 +2504,7 @@ int APar_MatchToKnownAtom(const char* atom_name, const char* atom_container, boo
         char* fullpath = (char *) malloc(sizeof(char) * 300);
         memset(fullpath, 0, sizeof(char) * 200);
 
-        APar_ProvideAtomPath(parsedAtoms[atom_number - 1].AtomicNumber, fullpath, fromFile);
+        APar_ProvideAtomPath(ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].AtomicNumber, fullpath, fromFile);
 
         if (memcmp(fullpath, "moov.trak.mdia.minf.stbl.stsd.", 30) == 0) {
             return_known_atom = total_known_atoms - 3; //manually return the esds atom
@@ -2529,15 +2561,15 @@ int APar_MatchToKnownAtom(const char* atom_name, const char* atom_container, boo
  defined in KnownAtoms
  ----------------------*/
 void APar_Manually_Determine_Parent(uint32_t atom_start, uint32_t atom_length, char* container) {
-    short preceding_atom = atom_number - 1;
-    while (parsedAtoms[preceding_atom].AtomicNumber != 0) {
+    short preceding_atom = ap_ctx->atom_number - 1;
+    while (ap_ctx->parsedAtoms[preceding_atom].AtomicNumber != 0) {
 
-        if (parsedAtoms[preceding_atom].AtomicStart < atom_start
-                && parsedAtoms[preceding_atom].AtomicLength > atom_length
-                && parsedAtoms[preceding_atom].AtomicStart + parsedAtoms[preceding_atom].AtomicLength
+        if (ap_ctx->parsedAtoms[preceding_atom].AtomicStart < atom_start
+                && ap_ctx->parsedAtoms[preceding_atom].AtomicLength > atom_length
+                && ap_ctx->parsedAtoms[preceding_atom].AtomicStart + ap_ctx->parsedAtoms[preceding_atom].AtomicLength
                         >= atom_start + atom_length
-                && parsedAtoms[preceding_atom].AtomicContainerState <= DUAL_STATE_ATOM) {
-            memcpy(container, parsedAtoms[preceding_atom].AtomicName, 5);
+                && ap_ctx->parsedAtoms[preceding_atom].AtomicContainerState <= DUAL_STATE_ATOM) {
+            memcpy(container, ap_ctx->parsedAtoms[preceding_atom].AtomicName, 5);
             break;
 
         }
@@ -2574,8 +2606,8 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
 
     APar_Init();
 
-    if (!parsedfile) {
-        file_size = findFileSize(path);
+    if (!ap_ctx->parsedfile) {
+        ap_ctx->file_size = findFileSize(path);
 
         FILE *file = APar_OpenFile(path, "rb");
         if (file != NULL) {
@@ -2606,23 +2638,23 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
                 dataSize = UInt32FromBigEndian(data);
                 jump = dataSize;
 
-                APar_AtomizeFileInfo(0, jump, 0, atom, generalAtomicLevel, CHILD_ATOM, SIMPLE_ATOM, 0, 0, &uuid_info);
+                APar_AtomizeFileInfo(0, jump, 0, atom, ap_ctx->generalAtomicLevel, CHILD_ATOM, SIMPLE_ATOM, 0, 0, &uuid_info);
 
                 fseek(file, jump, SEEK_SET);
 
-                while (jump < (uint32_t) file_size) {
+                while (jump < (uint32_t) ap_ctx->file_size) {
                     uuid_info.uuid_form = UUID_DEPRECATED_FORM; //start with the assumption that any found atom is in the depracted uuid form
 
                     fread(data, 1, 12, file);
                     char *atom = extractAtomName(data, 1);
                     dataSize = UInt32FromBigEndian(data);
 
-                    if (dataSize > (uint64_t) file_size) {
-                        dataSize = (uint32_t) (file_size - jump);
+                    if (dataSize > (uint64_t) ap_ctx->file_size) {
+                        dataSize = (uint32_t) (ap_ctx->file_size - jump);
                     }
 
                     if (dataSize == 0 && (atom[0] == 0 && atom[1] == 0 && atom[2] == 0 && atom[3] == 0)) {
-                        gapless_void_padding = file_size - jump; //Apple has decided to add around 2k of NULL space outside of any atom structure starting with iTunes 7.0.0
+                        ap_ctx->gapless_void_padding = ap_ctx->file_size - jump; //Apple has decided to add around 2k of NULL space outside of any atom structure starting with iTunes 7.0.0
                         break; //its possible this is part of gapless playback - but then why would it come after the 'free' at the end of a file like gpac writes?
                     } //after actual tested its elimination, it doesn't seem to be required for gapless playback
 
@@ -2630,10 +2662,10 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
                     //typically, the length of this atom (dataSize) will exceeed it parent (which is reported as 17)
                     //true length ot this data will be 9 - impossible for iTunes-style 'data' atom.
                     if (memcmp(atom, "data", 4) == 0
-                            && parsedAtoms[atom_number - 1].AtomicContainerState == PARENT_ATOM) {
-                        if (dataSize > parsedAtoms[atom_number - 1].AtomicLength) {
-                            dataSize = parsedAtoms[atom_number - 1].AtomicLength - 8; //force its length to its true length
-                            fprintf(stdout, "AtomicParsley warning: the 'data' child of the '%s' atom seems to be corrupted.\n", parsedAtoms[atom_number
+                            && ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].AtomicContainerState == PARENT_ATOM) {
+                        if (dataSize > ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].AtomicLength) {
+                            dataSize = ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].AtomicLength - 8; //force its length to its true length
+                            fprintf(stdout, "AtomicParsley warning: the 'data' child of the '%s' atom seems to be corrupted.\n", ap_ctx->parsedAtoms[ap_ctx->atom_number
                                     - 1].AtomicName);
                             corrupted_data_atom = true;
                         }
@@ -2672,7 +2704,7 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
                                 APar_generate_uuid_from_atomname(uuid_info.uuid_AP_atom_name, uuid_of_foundname_in_AP_namesapce);
                                 if (memcmp(uuid_info.binary_uuid, uuid_of_foundname_in_AP_namesapce, 16) == 0) {
                                     uuid_info.uuid_form = UUID_AP_SHA1_NAMESPACE; //our own uuid ver5 atoms in the AtomicParsley.sf.net namespace
-                                    atom_verflags = APar_read32(twenty_byte_buffer, file, jump + 28);
+                                    atom_verflags = APar_read32(ap_ctx->twenty_byte_buffer, file, jump + 28);
                                 }
                             }
                             else {
@@ -2726,26 +2758,26 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
                     }
 
                     //mdat.length=1; and ONLY supported for mdat atoms - no idea if the spec says "only mdat", but that's what I'm doing for now
-                    if ((strncmp(atom, "mdat", 4) == 0) && (generalAtomicLevel == 1) && (dataSize == 1)) {
+                    if ((strncmp(atom, "mdat", 4) == 0) && (ap_ctx->generalAtomicLevel == 1) && (dataSize == 1)) {
                         uint64_t extended_dataSize = APar_64bitAtomRead(file, jump);
-                        APar_AtomizeFileInfo(jump, 1, extended_dataSize, atom, generalAtomicLevel, KnownAtoms[filtered_known_atom].container_state, KnownAtoms[filtered_known_atom].box_type, atom_verflags, atom_language, &uuid_info);
+                        APar_AtomizeFileInfo(jump, 1, extended_dataSize, atom, ap_ctx->generalAtomicLevel, KnownAtoms[filtered_known_atom].container_state, KnownAtoms[filtered_known_atom].box_type, atom_verflags, atom_language, &uuid_info);
 
                     }
                     else {
-                        APar_AtomizeFileInfo(jump, dataSize, 0, atom, generalAtomicLevel, KnownAtoms[filtered_known_atom].container_state,
+                        APar_AtomizeFileInfo(jump, dataSize, 0, atom, ap_ctx->generalAtomicLevel, KnownAtoms[filtered_known_atom].container_state,
                                 corrupted_data_atom ? SIMPLE_ATOM : KnownAtoms[filtered_known_atom].box_type, atom_verflags, atom_language, &uuid_info);
                     }
                     corrupted_data_atom = false;
 
                     //read in the name of an iTunes-style internal reverseDNS directly into parsedAtoms
-                    if (memcmp(atom, "name", 4) == 0 && memcmp(parsedAtoms[atom_number - 2].AtomicName, "mean", 4) == 0
-                            && memcmp(parsedAtoms[atom_number - 3].AtomicName, "----", 4) == 0) {
+                    if (memcmp(atom, "name", 4) == 0 && memcmp(ap_ctx->parsedAtoms[ap_ctx->atom_number - 2].AtomicName, "mean", 4) == 0
+                            && memcmp(ap_ctx->parsedAtoms[ap_ctx->atom_number - 3].AtomicName, "----", 4) == 0) {
 
-                        parsedAtoms[atom_number - 1].ReverseDNSname = (char *) malloc(sizeof(char) * dataSize);
-                        memset(parsedAtoms[atom_number - 1].ReverseDNSname, 0, sizeof(char) * dataSize);
+                        ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].ReverseDNSname = (char *) malloc(sizeof(char) * dataSize);
+                        memset(ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].ReverseDNSname, 0, sizeof(char) * dataSize);
 
                         fseeko(file, jump + 12, SEEK_SET); //'name' atom is the 2nd child
-                        fread(parsedAtoms[atom_number - 1].ReverseDNSname, 1, dataSize - 12, file);
+                        fread(ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].ReverseDNSname, 1, dataSize - 12, file);
                     }
 
                     if (dataSize == 0) { // length = 0 means it reaches to EOF
@@ -2757,14 +2789,14 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
                         jump += 8;
                         if (memcmp(atom, "udta", 4) == 0) {
                             if (memcmp(container, "moov", 4) == 0) {
-                                udta_dynamics.original_udta_size = parsedAtoms[atom_number - 1].AtomicLength;
+                                ap_ctx->udta_dynamics.original_udta_size = ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].AtomicLength;
                             }
                         }
                         break;
                     }
                     case CHILD_ATOM: {
-                        if ((generalAtomicLevel == 1) && (dataSize == 1)) { //mdat.length =1 64-bit length that is more of a cludge.
-                            jump += parsedAtoms[atom_number - 1].AtomicLengthExtended;
+                        if ((ap_ctx->generalAtomicLevel == 1) && (dataSize == 1)) { //mdat.length =1 64-bit length that is more of a cludge.
+                            jump += ap_ctx->parsedAtoms[ap_ctx->atom_number - 1].AtomicLengthExtended;
                         }
                         else {
                             jump += dataSize;
@@ -2844,10 +2876,10 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
                         break;
                     }
                     case UNKNOWN_ATOM_TYPE: {
-                        short parent_atom = APar_FindParentAtom(atom_number - 1, generalAtomicLevel);
+                        short parent_atom = APar_FindParentAtom(ap_ctx->atom_number - 1, ap_ctx->generalAtomicLevel);
                         //to accommodate the retarted utility that keeps putting in 'prjp' atoms in mpeg-4 files written QTstyle
-                        if (parsedAtoms[parent_atom].AtomicContainerState == DUAL_STATE_ATOM) {
-                            jump = parsedAtoms[parent_atom].AtomicStart + parsedAtoms[parent_atom].AtomicLength;
+                        if (ap_ctx->parsedAtoms[parent_atom].AtomicContainerState == DUAL_STATE_ATOM) {
+                            jump = ap_ctx->parsedAtoms[parent_atom].AtomicStart + ap_ctx->parsedAtoms[parent_atom].AtomicLength;
                         }
                         else {
                             jump += dataSize;
@@ -2856,9 +2888,9 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
                     }
                     } //end swtich
 
-                    generalAtomicLevel = APar_GetCurrentAtomDepth(jump, dataSize);
+                    ap_ctx->generalAtomicLevel = APar_GetCurrentAtomDepth(jump, dataSize);
 
-                    if ((jump > 8 ? jump : 8) >= (uint32_t) file_size) { //prevents jumping past EOF for the smallest of atoms
+                    if ((jump > 8 ? jump : 8) >= (uint32_t) ap_ctx->file_size) { //prevents jumping past EOF for the smallest of atoms
                         break;
                     }
 
@@ -2888,10 +2920,10 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
 
             fclose(file);
         }
-        parsedfile = true;
+        ap_ctx->parsedfile = true;
     }
 
-    if (!tree_display_only && !parsedfile && APar_FindAtom("moov", false, SIMPLE_ATOM, 0) == NULL) {
+    if (!ap_ctx->tree_display_only && !ap_ctx->parsedfile && APar_FindAtom("moov", false, SIMPLE_ATOM, 0) == NULL) {
         fprintf(stderr, "\nAtomicParsley error: bad mpeg4 file (no 'moov' atom).\n\n");
     }
     return;
@@ -2910,17 +2942,17 @@ void APar_ScanAtoms(const char *path, bool scan_for_tree_ONLY) {
  as a linked list & followed by NextAtomNumber, effectively, this atom (and atoms leading to resume_atom_number) are no longer considered part of the tree.
  ----------------------*/
 void APar_EliminateAtom(short this_atom_number, int resume_atom_number) {
-    if (this_atom_number > 0 && this_atom_number < atom_number && resume_atom_number >= 0
-            && resume_atom_number < atom_number) {
+    if (this_atom_number > 0 && this_atom_number < ap_ctx->atom_number && resume_atom_number >= 0
+            && resume_atom_number < ap_ctx->atom_number) {
         short preceding_atom_pos = APar_FindPrecedingAtom(this_atom_number);
         if (APar_Eval_ChunkOffsetImpact(this_atom_number)) {
-            removed_bytes_tally += parsedAtoms[this_atom_number].AtomicLength; //used in validation routine
+            ap_ctx->removed_bytes_tally += ap_ctx->parsedAtoms[this_atom_number].AtomicLength; //used in validation routine
         }
-        parsedAtoms[preceding_atom_pos].NextAtomNumber = resume_atom_number;
+        ap_ctx->parsedAtoms[preceding_atom_pos].NextAtomNumber = resume_atom_number;
 
-        memset(parsedAtoms[this_atom_number].AtomicName, 0, 4); //blank out the name of the parent atom name
-        parsedAtoms[this_atom_number].AtomicNumber = -1;
-        parsedAtoms[this_atom_number].NextAtomNumber = -1;
+        memset(ap_ctx->parsedAtoms[this_atom_number].AtomicName, 0, 4); //blank out the name of the parent atom name
+        ap_ctx->parsedAtoms[this_atom_number].AtomicNumber = -1;
+        ap_ctx->parsedAtoms[this_atom_number].NextAtomNumber = -1;
     }
     return;
 }
@@ -2944,7 +2976,7 @@ void APar_RemoveAtom(const char* atom_path, uint8_t atom_type, uint16_t UD_lang)
     if (desiredAtom->AtomicNumber == 0)
         return; //we got the default atom, ftyp - and since that can't be removed, it must not exist (or it was missed)
 
-    modified_atoms = true;
+    ap_ctx->modified_atoms = true;
     if (atom_type != EXTENDED_ATOM) {
         if (atom_type == PACKED_LANG_ATOM || desiredAtom->AtomicClassification == UNKNOWN_ATOM) {
             APar_EliminateAtom(desiredAtom->AtomicNumber, desiredAtom->NextAtomNumber);
@@ -2954,18 +2986,18 @@ void APar_RemoveAtom(const char* atom_path, uint8_t atom_type, uint16_t UD_lang)
         else if (desiredAtom->ReverseDNSname != NULL) {
             short parent_atom = APar_FindParentAtom(desiredAtom->AtomicNumber, desiredAtom->AtomicLevel);
             short last_elim_atom = APar_FindLastChild_of_ParentAtom(parent_atom);
-            APar_EliminateAtom(parent_atom, parsedAtoms[last_elim_atom].NextAtomNumber);
+            APar_EliminateAtom(parent_atom, ap_ctx->parsedAtoms[last_elim_atom].NextAtomNumber);
 
         }
         else if (memcmp(desiredAtom->AtomicName, "data", 4) == 0 && desiredAtom->AtomicLevel == 6) {
             short parent_atom = APar_FindParentAtom(desiredAtom->AtomicNumber, desiredAtom->AtomicLevel);
             short last_elim_atom = APar_FindLastChild_of_ParentAtom(parent_atom);
-            APar_EliminateAtom(parent_atom, parsedAtoms[last_elim_atom].NextAtomNumber);
+            APar_EliminateAtom(parent_atom, ap_ctx->parsedAtoms[last_elim_atom].NextAtomNumber);
 
         }
         else if (desiredAtom->AtomicContainerState <= DUAL_STATE_ATOM) {
             short last_elim_atom = APar_FindLastChild_of_ParentAtom(desiredAtom->AtomicNumber);
-            APar_EliminateAtom(desiredAtom->AtomicNumber, parsedAtoms[last_elim_atom].NextAtomNumber);
+            APar_EliminateAtom(desiredAtom->AtomicNumber, ap_ctx->parsedAtoms[last_elim_atom].NextAtomNumber);
 
         }
         else if (UD_lang == 1) { //yrrc
@@ -3000,41 +3032,41 @@ void APar_RemoveAtom(const char* atom_path, uint8_t atom_type, uint16_t UD_lang)
  removed. A value of >= 1 will eliminate 'free' atoms between those levels and level 1 (or file level).
  ----------------------*/
 void APar_freefree(int purge_level) {
-    modified_atoms = true;
+    ap_ctx->modified_atoms = true;
     short eval_atom = 0;
     short moov_atom = 0; //a moov atom has yet to be seen
     short mdat_atom = 0; //any ol' mdat
 
     if (purge_level == -1) {
-        complete_free_space_erasure = true; //prevent any in situ dynamic updating when trying to remove all free atoms. Also triggers a more efficient means of forcing padding
+        ap_ctx->complete_free_space_erasure = true; //prevent any in situ dynamic updating when trying to remove all free atoms. Also triggers a more efficient means of forcing padding
     }
 
     while (true) {
-        eval_atom = parsedAtoms[eval_atom].NextAtomNumber;
+        eval_atom = ap_ctx->parsedAtoms[eval_atom].NextAtomNumber;
         if (eval_atom == 0) { //we've hit the last atom
             break;
         }
 
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "free", 4) == 0
-                || memcmp(parsedAtoms[eval_atom].AtomicName, "skip", 4) == 0) {
-            if (purge_level == -1 || purge_level >= parsedAtoms[eval_atom].AtomicLevel
-                    || (purge_level == 0 && parsedAtoms[eval_atom].AtomicLevel == 1
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "free", 4) == 0
+                || memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "skip", 4) == 0) {
+            if (purge_level == -1 || purge_level >= ap_ctx->parsedAtoms[eval_atom].AtomicLevel
+                    || (purge_level == 0 && ap_ctx->parsedAtoms[eval_atom].AtomicLevel == 1
                             && (moov_atom == 0 || mdat_atom != 0))) {
                 short prev_atom = APar_FindPrecedingAtom(eval_atom);
-                if (parsedAtoms[eval_atom].NextAtomNumber == 0) { //we've hit the last atom
-                    APar_EliminateAtom(eval_atom, parsedAtoms[eval_atom].NextAtomNumber);
-                    parsedAtoms[prev_atom].NextAtomNumber = 0;
+                if (ap_ctx->parsedAtoms[eval_atom].NextAtomNumber == 0) { //we've hit the last atom
+                    APar_EliminateAtom(eval_atom, ap_ctx->parsedAtoms[eval_atom].NextAtomNumber);
+                    ap_ctx->parsedAtoms[prev_atom].NextAtomNumber = 0;
                 }
                 else {
-                    APar_EliminateAtom(eval_atom, parsedAtoms[eval_atom].NextAtomNumber);
+                    APar_EliminateAtom(eval_atom, ap_ctx->parsedAtoms[eval_atom].NextAtomNumber);
                 }
                 eval_atom = prev_atom; //go back to the previous atom and continue the search
             }
         }
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "moov", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "moov", 4) == 0) {
             moov_atom = eval_atom;
         }
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "mdat", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "mdat", 4) == 0) {
             mdat_atom = eval_atom;
         }
     }
@@ -3059,61 +3091,61 @@ void APar_MoveAtom(short this_atom_number, short new_position) {
     short iter = 0;
 
     //look for the preceding atom (either directly before of the same level, or moov's last nth level child
-    while (parsedAtoms[iter].NextAtomNumber != 0) {
-        if (parsedAtoms[iter].NextAtomNumber == this_atom_number) {
+    while (ap_ctx->parsedAtoms[iter].NextAtomNumber != 0) {
+        if (ap_ctx->parsedAtoms[iter].NextAtomNumber == this_atom_number) {
             precedingAtom = iter;
             break;
         }
         else {
-            if (parsedAtoms[iter].NextAtomNumber == 0) { //we found the last atom (which we end our search on)
+            if (ap_ctx->parsedAtoms[iter].NextAtomNumber == 0) { //we found the last atom (which we end our search on)
                 break;
             }
         }
-        iter = parsedAtoms[iter].NextAtomNumber;
+        iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
     }
 
     iter = 0;
 
     //search where to insert our new atom
-    while (parsedAtoms[iter].NextAtomNumber != 0) {
-        if (parsedAtoms[iter].NextAtomNumber == new_position) {
+    while (ap_ctx->parsedAtoms[iter].NextAtomNumber != 0) {
+        if (ap_ctx->parsedAtoms[iter].NextAtomNumber == new_position) {
             lastStationaryAtom = iter;
             break;
         }
-        iter = parsedAtoms[iter].NextAtomNumber;
-        if (parsedAtoms[iter].NextAtomNumber == 0) { //we found the last atom
+        iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
+        if (ap_ctx->parsedAtoms[iter].NextAtomNumber == 0) { //we found the last atom
             lastStationaryAtom = iter;
             break;
         }
 
     }
 
-    if (parsedAtoms[this_atom_number].AtomicContainerState <= DUAL_STATE_ATOM) {
-        if (parsedAtoms[new_position].AtomicContainerState <= DUAL_STATE_ATOM) {
+    if (ap_ctx->parsedAtoms[this_atom_number].AtomicContainerState <= DUAL_STATE_ATOM) {
+        if (ap_ctx->parsedAtoms[new_position].AtomicContainerState <= DUAL_STATE_ATOM) {
             short last_SwapChild = APar_FindLastChild_of_ParentAtom(this_atom_number);
             short last_WiredChild = APar_FindLastChild_of_ParentAtom(new_position);
 
-            short swap_resume = parsedAtoms[last_SwapChild].NextAtomNumber;
-            short wired_resume = parsedAtoms[last_WiredChild].NextAtomNumber;
+            short swap_resume = ap_ctx->parsedAtoms[last_SwapChild].NextAtomNumber;
+            short wired_resume = ap_ctx->parsedAtoms[last_WiredChild].NextAtomNumber;
 
-            parsedAtoms[precedingAtom].NextAtomNumber = swap_resume; //shunt the main tree (over the [this_atom_number] atom to be move) to other tween atoms,
-            parsedAtoms[lastStationaryAtom].NextAtomNumber = new_position; //pick up with the 2nd to last hierarchy
-            parsedAtoms[last_WiredChild].NextAtomNumber = this_atom_number; //and route the 2nd to last hierarchy to wrap around to the this_atom_number atom
-            parsedAtoms[last_SwapChild].NextAtomNumber = wired_resume; //and continue with whatever was after the [new_position] atom
+            ap_ctx->parsedAtoms[precedingAtom].NextAtomNumber = swap_resume; //shunt the main tree (over the [this_atom_number] atom to be move) to other tween atoms,
+            ap_ctx->parsedAtoms[lastStationaryAtom].NextAtomNumber = new_position; //pick up with the 2nd to last hierarchy
+            ap_ctx->parsedAtoms[last_WiredChild].NextAtomNumber = this_atom_number; //and route the 2nd to last hierarchy to wrap around to the this_atom_number atom
+            ap_ctx->parsedAtoms[last_SwapChild].NextAtomNumber = wired_resume; //and continue with whatever was after the [new_position] atom
 
         }
         else {
             short last_child = APar_FindLastChild_of_ParentAtom(this_atom_number);
-            parsedAtoms[lastStationaryAtom].NextAtomNumber = this_atom_number;
-            parsedAtoms[precedingAtom].NextAtomNumber = parsedAtoms[last_child].NextAtomNumber;
-            parsedAtoms[last_child].NextAtomNumber = new_position;
+            ap_ctx->parsedAtoms[lastStationaryAtom].NextAtomNumber = this_atom_number;
+            ap_ctx->parsedAtoms[precedingAtom].NextAtomNumber = ap_ctx->parsedAtoms[last_child].NextAtomNumber;
+            ap_ctx->parsedAtoms[last_child].NextAtomNumber = new_position;
         }
 
     }
     else {
-        parsedAtoms[lastStationaryAtom].NextAtomNumber = this_atom_number;
-        parsedAtoms[precedingAtom].NextAtomNumber = parsedAtoms[this_atom_number].NextAtomNumber;
-        parsedAtoms[this_atom_number].NextAtomNumber = new_position;
+        ap_ctx->parsedAtoms[lastStationaryAtom].NextAtomNumber = this_atom_number;
+        ap_ctx->parsedAtoms[precedingAtom].NextAtomNumber = ap_ctx->parsedAtoms[this_atom_number].NextAtomNumber;
+        ap_ctx->parsedAtoms[this_atom_number].NextAtomNumber = new_position;
     }
 
     return;
@@ -3138,12 +3170,12 @@ void APar_MoveAtom(short this_atom_number, short new_position) {
  ----------------------*/
 short APar_InterjectNewAtom(const char* atom_name, uint8_t cntr_state, uint8_t atom_class, uint32_t atom_length, uint32_t atom_verflags, uint16_t packed_lang, uint8_t atom_level, short preceding_atom) {
 
-    if (tree_display_only) {
+    if (ap_ctx->tree_display_only) {
         return 0;
     }
 
-    AtomicInfo* new_atom = &parsedAtoms[atom_number];
-    new_atom->AtomicNumber = atom_number;
+    AtomicInfo* new_atom = &ap_ctx->parsedAtoms[ap_ctx->atom_number];
+    new_atom->AtomicNumber = ap_ctx->atom_number;
     new_atom->AtomicName = (char*) malloc(sizeof(char) * 6);
     memset(new_atom->AtomicName, 0, sizeof(char) * 6);
     memcpy(new_atom->AtomicName, atom_name, 4);
@@ -3158,10 +3190,10 @@ short APar_InterjectNewAtom(const char* atom_name, uint8_t cntr_state, uint8_t a
     new_atom->AtomicData = (char*) malloc(sizeof(char) * atom_length); //puts a hard limit on the length of strings (the spec doesn't)
     memset(new_atom->AtomicData, 0, sizeof(char) * atom_length);
 
-    new_atom->NextAtomNumber = parsedAtoms[preceding_atom].NextAtomNumber;
-    parsedAtoms[preceding_atom].NextAtomNumber = atom_number;
+    new_atom->NextAtomNumber = ap_ctx->parsedAtoms[preceding_atom].NextAtomNumber;
+    ap_ctx->parsedAtoms[preceding_atom].NextAtomNumber = ap_ctx->atom_number;
 
-    atom_number++;
+    ap_ctx->atom_number++;
     return new_atom->AtomicNumber;
 }
 
@@ -3176,8 +3208,8 @@ short APar_InterjectNewAtom(const char* atom_name, uint8_t cntr_state, uint8_t a
  Create a single new atom (not carrying any data) copied from a template to follow preceding_atom
  ----------------------*/
 AtomicInfo* APar_CreateSparseAtom(AtomicInfo* surrogate_atom, AtomicInfo* parent_atom, short preceding_atom) {
-    AtomicInfo* new_atom = &parsedAtoms[atom_number];
-    new_atom->AtomicNumber = atom_number;
+    AtomicInfo* new_atom = &ap_ctx->parsedAtoms[ap_ctx->atom_number];
+    new_atom->AtomicNumber = ap_ctx->atom_number;
     new_atom->AtomicStart = 0;
     int known_atom = 0;
 
@@ -3192,8 +3224,8 @@ AtomicInfo* APar_CreateSparseAtom(AtomicInfo* surrogate_atom, AtomicInfo* parent
     new_atom->AtomicVerFlags = 0;
     new_atom->AtomicLength = 8;
 
-    new_atom->NextAtomNumber = parsedAtoms[preceding_atom].NextAtomNumber;
-    parsedAtoms[preceding_atom].NextAtomNumber = atom_number;
+    new_atom->NextAtomNumber = ap_ctx->parsedAtoms[preceding_atom].NextAtomNumber;
+    ap_ctx->parsedAtoms[preceding_atom].NextAtomNumber = ap_ctx->atom_number;
 
     //if 'uuid' atom, copy the info directly, otherwise use KnownAtoms to get the info
     if (surrogate_atom->AtomicClassification == EXTENDED_ATOM) {
@@ -3212,7 +3244,7 @@ AtomicInfo* APar_CreateSparseAtom(AtomicInfo* surrogate_atom, AtomicInfo* parent
         new_atom->AtomicClassification = KnownAtoms[known_atom].box_type;
     }
 
-    atom_number++;
+    ap_ctx->atom_number++;
 
     return new_atom;
 }
@@ -3237,34 +3269,34 @@ void APar_Unified_atom_Put(short atom_num, const char* unicode_data, uint8_t tex
     if (atom_num <= 0) {
         return; //although it should error out, because we aren't setting anything on ftyp; APar_MetaData_atom_Init on a 3gp file (for iTunes-style metadata) will give an atom_num=0, thus preventing the setting of non-compliant metadata onto 3gp files but will allow setting of data onto a non-0 atom
     }
-    uint32_t atom_data_pos = parsedAtoms[atom_num].AtomicLength
-            - (parsedAtoms[atom_num].AtomicClassification == EXTENDED_ATOM ? 32 : 12);
+    uint32_t atom_data_pos = ap_ctx->parsedAtoms[atom_num].AtomicLength
+            - (ap_ctx->parsedAtoms[atom_num].AtomicClassification == EXTENDED_ATOM ? 32 : 12);
     switch (anc_bit_width) {
     case 0: { //aye, 'twas a false alarm; arg (I'm a pirate), we just wanted to set a text string
         break;
     }
 
     case 8: { //compilation, podcast flag, advisory
-        parsedAtoms[atom_num].AtomicData[atom_data_pos] = (uint8_t) ancillary_data;
-        parsedAtoms[atom_num].AtomicLength++;
+        ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos] = (uint8_t) ancillary_data;
+        ap_ctx->parsedAtoms[atom_num].AtomicLength++;
         atom_data_pos++;
         break;
     }
 
     case 16: { //lang & its ilk
-        parsedAtoms[atom_num].AtomicData[atom_data_pos] = (ancillary_data & 0xff00) >> 8;
-        parsedAtoms[atom_num].AtomicData[atom_data_pos + 1] = (ancillary_data & 0xff) << 0;
-        parsedAtoms[atom_num].AtomicLength += 2;
+        ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos] = (ancillary_data & 0xff00) >> 8;
+        ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos + 1] = (ancillary_data & 0xff) << 0;
+        ap_ctx->parsedAtoms[atom_num].AtomicLength += 2;
         atom_data_pos += 2;
         break;
     }
 
     case 32: { //things like coordinates and.... stuff (ah, the prose)
-        parsedAtoms[atom_num].AtomicData[atom_data_pos] = (ancillary_data & 0xff000000) >> 24;
-        parsedAtoms[atom_num].AtomicData[atom_data_pos + 1] = (ancillary_data & 0xff0000) >> 16;
-        parsedAtoms[atom_num].AtomicData[atom_data_pos + 2] = (ancillary_data & 0xff00) >> 8;
-        parsedAtoms[atom_num].AtomicData[atom_data_pos + 3] = (ancillary_data & 0xff) << 0;
-        parsedAtoms[atom_num].AtomicLength += 4;
+        ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos] = (ancillary_data & 0xff000000) >> 24;
+        ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos + 1] = (ancillary_data & 0xff0000) >> 16;
+        ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos + 2] = (ancillary_data & 0xff00) >> 8;
+        ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos + 3] = (ancillary_data & 0xff) << 0;
+        ap_ctx->parsedAtoms[atom_num].AtomicLength += 4;
         atom_data_pos += 4;
         break;
     }
@@ -3283,20 +3315,20 @@ void APar_Unified_atom_Put(short atom_num, const char* unicode_data, uint8_t tex
 
             UTF8ToUTF16BE(utf16_conversion, glyphs_req_bytes, (unsigned char*) unicode_data, string_length);
 
-            parsedAtoms[atom_num].AtomicData[atom_data_pos] = 0xFE; //BOM
-            parsedAtoms[atom_num].AtomicData[atom_data_pos + 1] = 0xFF; //BOM
+            ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos] = 0xFE; //BOM
+            ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos + 1] = 0xFF; //BOM
             atom_data_pos += 2; //BOM
 
             /* copy the string directly onto AtomicData at the address of the start of AtomicData + the current length in atom_data_pos */
             /* in marked contrast to iTunes-style metadata where a string is a single string, 3gp tags like keyword & classification are more complex */
             /* directly putting the text into memory and being able to tack on more becomes a necessary accommodation */
-            memcpy(parsedAtoms[atom_num].AtomicData + atom_data_pos, utf16_conversion, glyphs_req_bytes);
-            parsedAtoms[atom_num].AtomicLength += glyphs_req_bytes;
+            memcpy(ap_ctx->parsedAtoms[atom_num].AtomicData + atom_data_pos, utf16_conversion, glyphs_req_bytes);
+            ap_ctx->parsedAtoms[atom_num].AtomicLength += glyphs_req_bytes;
 
             //double check terminating NULL (don't want to double add them - blush.... or have them missing - blushing on the.... other side)
-            if (parsedAtoms[atom_num].AtomicData[atom_data_pos + (glyphs_req_bytes - 1)]
-                    + parsedAtoms[atom_num].AtomicData[atom_data_pos + glyphs_req_bytes] != 0) {
-                parsedAtoms[atom_num].AtomicLength += 4; //+4 because add 2 bytes for the character we just found + 2bytes for the req. NULL
+            if (ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos + (glyphs_req_bytes - 1)]
+                    + ap_ctx->parsedAtoms[atom_num].AtomicData[atom_data_pos + glyphs_req_bytes] != 0) {
+                ap_ctx->parsedAtoms[atom_num].AtomicLength += 4; //+4 because add 2 bytes for the character we just found + 2bytes for the req. NULL
             }
             free(utf16_conversion);
             utf16_conversion = NULL;
@@ -3304,8 +3336,8 @@ void APar_Unified_atom_Put(short atom_num, const char* unicode_data, uint8_t tex
         }
         else if (text_tag_style == UTF8_iTunesStyle_Binary) { //because this will be 'binary' data (a misnomer for purl & egid), memcpy 4 bytes into AtomicData, not at the start of it
             uint32_t binary_bytes = strlen(unicode_data);
-            memcpy(parsedAtoms[atom_num].AtomicData + atom_data_pos, unicode_data, binary_bytes + 1);
-            parsedAtoms[atom_num].AtomicLength += binary_bytes;
+            memcpy(ap_ctx->parsedAtoms[atom_num].AtomicData + atom_data_pos, unicode_data, binary_bytes + 1);
+            ap_ctx->parsedAtoms[atom_num].AtomicLength += binary_bytes;
 
         }
         else {
@@ -3323,7 +3355,7 @@ void APar_Unified_atom_Put(short atom_num, const char* unicode_data, uint8_t tex
 
                 if (raw_bytes > total_bytes && total_bytes > 255) {
 
-                    fprintf(stdout, "AtomicParsley warning: %s was trimmed to 255 characters (%u characters over)\n", parsedAtoms[APar_FindParentAtom(atom_num, parsedAtoms[atom_num].AtomicLevel)].AtomicName, utf8_length(unicode_data
+                    fprintf(stdout, "AtomicParsley warning: %s was trimmed to 255 characters (%u characters over)\n", ap_ctx->parsedAtoms[APar_FindParentAtom(atom_num, ap_ctx->parsedAtoms[atom_num].AtomicLevel)].AtomicName, utf8_length(unicode_data
                             + total_bytes, 0));
                 }
                 else {
@@ -3335,19 +3367,19 @@ void APar_Unified_atom_Put(short atom_num, const char* unicode_data, uint8_t tex
                 total_bytes = strlen(unicode_data);
 
                 if (total_bytes > MAXDATA_PAYLOAD) {
-                    free(parsedAtoms[atom_num].AtomicData);
-                    parsedAtoms[atom_num].AtomicData = NULL;
+                    free(ap_ctx->parsedAtoms[atom_num].AtomicData);
+                    ap_ctx->parsedAtoms[atom_num].AtomicData = NULL;
 
-                    parsedAtoms[atom_num].AtomicData = (char*) malloc(sizeof(char) * (total_bytes + 1));
-                    memset(parsedAtoms[atom_num].AtomicData + atom_data_pos, 0, total_bytes + 1);
+                    ap_ctx->parsedAtoms[atom_num].AtomicData = (char*) malloc(sizeof(char) * (total_bytes + 1));
+                    memset(ap_ctx->parsedAtoms[atom_num].AtomicData + atom_data_pos, 0, total_bytes + 1);
 
                 }
             }
 
             //if we are setting iTunes-style metadata, add 0 to the pointer; for 3gp user data atoms - add in the (length-default bare atom lenth): account for language uint16_t (plus any other crap we will set); unicodeWin32 with wchar_t was converted right after program started, so do a direct copy
 
-            memcpy(parsedAtoms[atom_num].AtomicData + atom_data_pos, unicode_data, total_bytes + 1);
-            parsedAtoms[atom_num].AtomicLength += total_bytes;
+            memcpy(ap_ctx->parsedAtoms[atom_num].AtomicData + atom_data_pos, unicode_data, total_bytes + 1);
+            ap_ctx->parsedAtoms[atom_num].AtomicLength += total_bytes;
         }
     }
     return;
@@ -3367,9 +3399,9 @@ void APar_atom_Binary_Put(short atom_num, const char* binary_data, uint32_t byte
     if (atom_num <= 0) {
         return;
     }
-    if (atomic_data_offset + bytecount + parsedAtoms[atom_num].AtomicLength <= MAXDATA_PAYLOAD) {
-        memcpy(parsedAtoms[atom_num].AtomicData + atomic_data_offset, binary_data, bytecount);
-        parsedAtoms[atom_num].AtomicLength += bytecount;
+    if (atomic_data_offset + bytecount + ap_ctx->parsedAtoms[atom_num].AtomicLength <= MAXDATA_PAYLOAD) {
+        memcpy(ap_ctx->parsedAtoms[atom_num].AtomicData + atomic_data_offset, binary_data, bytecount);
+        ap_ctx->parsedAtoms[atom_num].AtomicLength += bytecount;
     }
     else {
         fprintf(stdout, "AtomicParsley warning: some data was longer than the allotted space and was skipped\n");
@@ -3385,9 +3417,9 @@ void APar_atom_Binary_Put(short atom_num, const char* binary_data, uint32_t byte
 void APar_Verify__udta_meta_hdlr__atom() {
     bool Create__udta_meta_hdlr__atom = false;
 
-    if (metadata_style == ITUNES_STYLE && hdlrAtom == NULL) {
-        hdlrAtom = APar_FindAtom("moov.udta.meta.hdlr", false, VERSIONED_ATOM, 0);
-        if (hdlrAtom == NULL) {
+    if (ap_ctx->metadata_style == ITUNES_STYLE && ap_ctx->hdlrAtom == NULL) {
+        ap_ctx->hdlrAtom = APar_FindAtom("moov.udta.meta.hdlr", false, VERSIONED_ATOM, 0);
+        if (ap_ctx->hdlrAtom == NULL) {
             Create__udta_meta_hdlr__atom = true;
         }
     }
@@ -3397,14 +3429,14 @@ void APar_Verify__udta_meta_hdlr__atom() {
         //this "moov.udta.meta.hdlr" atom (and its data), it refuses to let any information be changed & the dreaded "Album Artwork Not Modifiable"
         //shows up. It's because this atom is missing. Oddly, QT Player can see the info, but this only works for mp4/m4a files.
 
-        hdlrAtom = APar_FindAtom("moov.udta.meta.hdlr", true, VERSIONED_ATOM, 0);
+        ap_ctx->hdlrAtom = APar_FindAtom("moov.udta.meta.hdlr", true, VERSIONED_ATOM, 0);
 
-        APar_MetaData_atom_QuickInit(hdlrAtom->AtomicNumber, 0, 0);
-        APar_Unified_atom_Put(hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0x6D646972, 32); //'mdir'
-        APar_Unified_atom_Put(hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0x6170706C, 32); //'appl'
-        APar_Unified_atom_Put(hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0, 32);
-        APar_Unified_atom_Put(hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0, 32);
-        APar_Unified_atom_Put(hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0, 16);
+        APar_MetaData_atom_QuickInit(ap_ctx->hdlrAtom->AtomicNumber, 0, 0);
+        APar_Unified_atom_Put(ap_ctx->hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0x6D646972, 32); //'mdir'
+        APar_Unified_atom_Put(ap_ctx->hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0x6170706C, 32); //'appl'
+        APar_Unified_atom_Put(ap_ctx->hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0, 32);
+        APar_Unified_atom_Put(ap_ctx->hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0, 32);
+        APar_Unified_atom_Put(ap_ctx->hdlrAtom->AtomicNumber, NULL, UTF8_iTunesStyle_256glyphLimited, 0, 16);
     }
     return;
 }
@@ -3419,7 +3451,7 @@ void APar_Verify__udta_meta_hdlr__atom() {
  create the new genre atom and put the data manually onto the atom.
  ----------------------*/
 void APar_MetaData_atomGenre_Set(const char* atomPayload) {
-    if (metadata_style == ITUNES_STYLE) {
+    if (ap_ctx->metadata_style == ITUNES_STYLE) {
         const char* standard_genre_atom = "moov.udta.meta.ilst.gnre";
         const char* std_genre_data_atom = "moov.udta.meta.ilst.gnre.data";
         const char* custom_genre_atom = "moov.udta.meta.ilst.�gen";
@@ -3435,7 +3467,7 @@ void APar_MetaData_atomGenre_Set(const char* atomPayload) {
             AtomicInfo* genreAtom;
 
             APar_Verify__udta_meta_hdlr__atom();
-            modified_atoms = true;
+            ap_ctx->modified_atoms = true;
 
             if (genre_number != 0) {
                 //first find if a custom genre atom ("�gen") exists; erase the custom-string genre atom in favor of the standard genre atom
@@ -3461,7 +3493,7 @@ void APar_MetaData_atomGenre_Set(const char* atomPayload) {
                 AtomicInfo* verboten_genre_atom = APar_FindAtom(standard_genre_atom, false, SIMPLE_ATOM, 0);
 
                 if (verboten_genre_atom != NULL) {
-                    if (verboten_genre_atom->AtomicNumber > 5 && verboten_genre_atom->AtomicNumber < atom_number) {
+                    if (verboten_genre_atom->AtomicNumber > 5 && verboten_genre_atom->AtomicNumber < ap_ctx->atom_number) {
                         if (strncmp(verboten_genre_atom->AtomicName, "gnre", 4) == 0) {
                             APar_RemoveAtom(std_genre_data_atom, VERSIONED_ATOM, 0);
                         }
@@ -3492,9 +3524,9 @@ void APar_MetaData_atomArtwork_Init(short atom_num, const char* artworkPath) {
     if (picture_size > 0) {
         APar_MetaData_atom_QuickInit(atom_num, APar_TestArtworkBinaryData(artworkPath), 0, (uint32_t) picture_size);
         FILE* artfile = APar_OpenFile(artworkPath, "rb"); //openSomeFile(artworkPath, true);
-        uint32_t bytes_read = APar_ReadFile(parsedAtoms[atom_num].AtomicData + 4, artfile, (uint32_t) picture_size); //+4 for the 4 null bytes
+        uint32_t bytes_read = APar_ReadFile(ap_ctx->parsedAtoms[atom_num].AtomicData + 4, artfile, (uint32_t) picture_size); //+4 for the 4 null bytes
         if (bytes_read > 0)
-            parsedAtoms[atom_num].AtomicLength += bytes_read;
+            ap_ctx->parsedAtoms[atom_num].AtomicLength += bytes_read;
         fclose(artfile);
     }
     return;
@@ -3510,7 +3542,7 @@ void APar_MetaData_atomArtwork_Init(short atom_num, const char* artworkPath) {
  features on the image. The path of the file (either original, modified artwork, or both) are returned to use for possible atom creation
  ----------------------*/
 void APar_MetaData_atomArtwork_Set(const char* artworkPath, char* env_PicOptions) {
-    if (metadata_style == ITUNES_STYLE) {
+    if (ap_ctx->metadata_style == ITUNES_STYLE) {
         const char* artwork_atom = "moov.udta.meta.ilst.covr";
         if (memcmp(artworkPath, "REMOVE_ALL", 10) == 0) {
             APar_RemoveAtom(artwork_atom, SIMPLE_ATOM, 0);
@@ -3519,7 +3551,7 @@ void APar_MetaData_atomArtwork_Set(const char* artworkPath, char* env_PicOptions
         else {
             APar_Verify__udta_meta_hdlr__atom();
 
-            modified_atoms = true;
+            ap_ctx->modified_atoms = true;
             AtomicInfo* desiredAtom = APar_FindAtom(artwork_atom, true, SIMPLE_ATOM, 0);
             AtomicInfo sample_data_atom =
                 { 0 };
@@ -3528,19 +3560,19 @@ void APar_MetaData_atomArtwork_Set(const char* artworkPath, char* env_PicOptions
                     APar_CreateSparseAtom(&sample_data_atom, desiredAtom, APar_FindLastChild_of_ParentAtom(desiredAtom->AtomicNumber));
 
             //determine if any picture preferences will impact the picture file in any way
-            myPicturePrefs = APar_ExtractPicPrefs(env_PicOptions);
+            ap_ctx->myPicturePrefs = APar_ExtractPicPrefs(env_PicOptions);
 
 #if defined (DARWIN_PLATFORM)
             char* resized_filepath = (char*)calloc(1, sizeof(char)*MAXPATHLEN+1);
 
-            if ( ResizeGivenImage(artworkPath , myPicturePrefs, resized_filepath) ) {
+            if ( ResizeGivenImage(artworkPath , ap_ctx->myPicturePrefs, resized_filepath) ) {
                 APar_MetaData_atomArtwork_Init(desiredAtom->AtomicNumber, resized_filepath);
 
-                if (myPicturePrefs.addBOTHpix) {
+                if (ap_ctx->myPicturePrefs.addBOTHpix) {
                     //create another sparse atom to hold the new image data
                     desiredAtom = APar_CreateSparseAtom(&sample_data_atom, desiredAtom, APar_FindLastChild_of_ParentAtom(parent_atom) );
                     APar_MetaData_atomArtwork_Init(desiredAtom->AtomicNumber, artworkPath);
-                    if (myPicturePrefs.removeTempPix) remove(resized_filepath);
+                    if (ap_ctx->myPicturePrefs.removeTempPix) remove(resized_filepath);
                 }
             }
             else {
@@ -3557,6 +3589,42 @@ void APar_MetaData_atomArtwork_Set(const char* artworkPath, char* env_PicOptions
     return;
 }
 
+/*----------------------
+ APar_MetaData_atomArtwork_SetData
+ image_data - a jpg or png picture held in memory
+ image_len - the number of bytes in image_data
+
+ like APar_MetaData_atomArtwork_Set, but the picture is copied onto a new 'data' atom under 'covr' straight from memory instead of
+ being read from a file. No picture preferences are applied. Returns false if the picture is neither a jpg nor a png.
+ ----------------------*/
+bool APar_MetaData_atomArtwork_SetData(const char* image_data, uint32_t image_len) {
+    if (ap_ctx->metadata_style != ITUNES_STYLE || image_data == NULL) {
+        return false;
+    }
+    int artwork_dataType = APar_TestArtworkBinaryBuffer(image_data, image_len);
+    if (artwork_dataType == -1) {
+        return false;
+    }
+
+    const char* artwork_atom = "moov.udta.meta.ilst.covr";
+    APar_Verify__udta_meta_hdlr__atom();
+
+    ap_ctx->modified_atoms = true;
+    AtomicInfo* desiredAtom = APar_FindAtom(artwork_atom, true, SIMPLE_ATOM, 0);
+    AtomicInfo sample_data_atom =
+        { 0 };
+    APar_CreateSurrogateAtom(&sample_data_atom, "data", 6, VERSIONED_ATOM, 0, NULL, 0);
+    desiredAtom = APar_CreateSparseAtom(&sample_data_atom, desiredAtom, APar_FindLastChild_of_ParentAtom(desiredAtom->AtomicNumber));
+
+    APar_MetaData_atom_QuickInit(desiredAtom->AtomicNumber, (uint32_t) artwork_dataType, 0, image_len);
+    if (desiredAtom->AtomicData == NULL) {
+        return false;
+    }
+    memcpy(desiredAtom->AtomicData + 4, image_data, image_len); //+4 for the 4 null bytes
+    desiredAtom->AtomicLength += image_len;
+    return true;
+}
+
 /*----------------------
  APar_3GP_Keyword_atom_Format
  keywords_globbed - the globbed string of keywords ('foo1,foo2,foo_you')
@@ -3663,7 +3731,7 @@ short APar_uuid_atom_Init(const char* atom_path, char* uuidName, const uint32_t
             return -1;
         }
         //uuid atoms won't have 'data' child atoms - they will carry the data directly as opposed to traditional iTunes-style metadata that does store the information on 'data' atoms. But user-defined is user-defined, so that is how it will be defined here.
-        modified_atoms = true;
+        ap_ctx->modified_atoms = true;
 
         desiredAtom = APar_FindAtom(uuid_path, true, EXTENDED_ATOM, 0, true);
         desiredAtom->uuid_ap_atomname = (char*) calloc(1, sizeof(char) * 10); //only useful to print out the atom tree midway through an operation
@@ -3674,7 +3742,7 @@ short APar_uuid_atom_Init(const char* atom_path, char* uuidName, const uint32_t
         //NOTE: setting a file into a uuid atom  (dataType == AtomFlags_Data_uuid_binary) is handled in main.cpp - the length of the file extension, description and file
         //all add up to the amount to malloc AtomicData to, so handle that separately.
 
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicClassification = EXTENDED_ATOM;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicClassification = EXTENDED_ATOM;
     }
     return desiredAtom->AtomicNumber;
 }
@@ -3691,16 +3759,16 @@ short APar_uuid_atom_Init(const char* atom_path, char* uuidName, const uint32_t
 void APar_MetaData_atom_QuickInit(short atom_num, const uint32_t atomFlags, uint32_t supplemental_length, uint32_t allotment) {
     //this will skip the finding of atoms and just malloc the AtomicData; used by genre & artwork
 
-    parsedAtoms[atom_num].AtomicData = (char*) calloc(1, sizeof(char) * allotment + 50);
-    if (parsedAtoms[atom_num].AtomicData == NULL) {
+    ap_ctx->parsedAtoms[atom_num].AtomicData = (char*) calloc(1, sizeof(char) * allotment + 50);
+    if (ap_ctx->parsedAtoms[atom_num].AtomicData == NULL) {
         fprintf(stdout, "AP error: there was insufficient memory available for allocation. Exiting.%c\n", '\a');
         return;
     }
 
-    parsedAtoms[atom_num].AtomicLength = 16 + supplemental_length; // 4bytes atom length, 4 bytes atom length, 4 bytes version/flags, 4 bytes NULL
-    parsedAtoms[atom_num].AtomicVerFlags = atomFlags;
-    parsedAtoms[atom_num].AtomicContainerState = CHILD_ATOM;
-    parsedAtoms[atom_num].AtomicClassification = VERSIONED_ATOM;
+    ap_ctx->parsedAtoms[atom_num].AtomicLength = 16 + supplemental_length; // 4bytes atom length, 4 bytes atom length, 4 bytes version/flags, 4 bytes NULL
+    ap_ctx->parsedAtoms[atom_num].AtomicVerFlags = atomFlags;
+    ap_ctx->parsedAtoms[atom_num].AtomicContainerState = CHILD_ATOM;
+    ap_ctx->parsedAtoms[atom_num].AtomicClassification = VERSIONED_ATOM;
 
     return;
 }
@@ -3716,7 +3784,7 @@ void APar_MetaData_atom_QuickInit(short atom_num, const uint32_t atomFlags, uint
  ----------------------*/
 short APar_MetaData_atom_Init(const char* atom_path, const char* MD_Payload, const uint32_t atomFlags) {
     //this will handle the vanilla iTunes-style metadata atoms; genre will be handled elsewehere because it gets carried on 2 different atoms, and artwork gets special treatment because it can have multiple child data atoms
-    if (metadata_style != ITUNES_STYLE) {
+    if (ap_ctx->metadata_style != ITUNES_STYLE) {
         return 0;
     }
     bool retain_atom = true;
@@ -3732,10 +3800,10 @@ short APar_MetaData_atom_Init(const char* atom_path, const char* MD_Payload, con
     AtomicInfo* desiredAtom = APar_FindAtom(atom_path, retain_atom, VERSIONED_ATOM, 0); //finds the atom; if not present, creates the atom
     if (desiredAtom == NULL)
         return -1;
-    modified_atoms = true;
+    ap_ctx->modified_atoms = true;
 
     if (!retain_atom) {
-        AtomicInfo* parent_atom = &parsedAtoms[APar_FindParentAtom(desiredAtom->AtomicNumber, desiredAtom->AtomicLevel)];
+        AtomicInfo* parent_atom = &ap_ctx->parsedAtoms[APar_FindParentAtom(desiredAtom->AtomicNumber, desiredAtom->AtomicLevel)];
         if (desiredAtom->AtomicNumber > 0 && parent_atom->AtomicNumber > 0) {
             APar_EliminateAtom(parent_atom->AtomicNumber, desiredAtom->NextAtomNumber);
             return -1;
@@ -3743,13 +3811,13 @@ short APar_MetaData_atom_Init(const char* atom_path, const char* MD_Payload, con
 
     }
     else {
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicData = (char*) malloc(sizeof(char) * MAXDATA_PAYLOAD + 1); //puts a hard limit on the length of strings (the spec doesn't)
-        memset(parsedAtoms[desiredAtom->AtomicNumber].AtomicData, 0, sizeof(char) * MAXDATA_PAYLOAD + 1);
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicData = (char*) malloc(sizeof(char) * MAXDATA_PAYLOAD + 1); //puts a hard limit on the length of strings (the spec doesn't)
+        memset(ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicData, 0, sizeof(char) * MAXDATA_PAYLOAD + 1);
 
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicLength = 16; // 4bytes atom length, 4 bytes atom length, 4 bytes version/flags, 4 bytes NULL
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicVerFlags = atomFlags;
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicContainerState = CHILD_ATOM;
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicClassification = VERSIONED_ATOM;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicLength = 16; // 4bytes atom length, 4 bytes atom length, 4 bytes version/flags, 4 bytes NULL
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicVerFlags = atomFlags;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicContainerState = CHILD_ATOM;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicClassification = VERSIONED_ATOM;
     }
     return desiredAtom->AtomicNumber;
 }
@@ -3792,17 +3860,17 @@ short APar_UserData_atom_Init(const char* atom_path, const char* UD_Payload, uin
         return -1;
     }
     else {
-        modified_atoms = true;
+        ap_ctx->modified_atoms = true;
         desiredAtom = APar_FindAtom(atom_path, true, atom_type, UD_lang);
 
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicData = (char*) malloc(sizeof(char) * MAXDATA_PAYLOAD); //puts a hard limit on the length of strings (the spec doesn't)
-        memset(parsedAtoms[desiredAtom->AtomicNumber].AtomicData, 0, sizeof(char) * MAXDATA_PAYLOAD);
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicData = (char*) malloc(sizeof(char) * MAXDATA_PAYLOAD); //puts a hard limit on the length of strings (the spec doesn't)
+        memset(ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicData, 0, sizeof(char) * MAXDATA_PAYLOAD);
 
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicLength = 12; // 4bytes atom length, 4 bytes atom length, 4 bytes version/flags (NULLs)
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicVerFlags = 0;
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicContainerState = CHILD_ATOM;
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicClassification = atom_type;
-        parsedAtoms[desiredAtom->AtomicNumber].AtomicLanguage = UD_lang;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicLength = 12; // 4bytes atom length, 4 bytes atom length, 4 bytes version/flags (NULLs)
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicVerFlags = 0;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicContainerState = CHILD_ATOM;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicClassification = atom_type;
+        ap_ctx->parsedAtoms[desiredAtom->AtomicNumber].AtomicLanguage = UD_lang;
     }
     return desiredAtom->AtomicNumber;
 }
@@ -3877,9 +3945,9 @@ void APar_ISO_UserData_Set(char* iso_atom_name, const char* iso_payload, uint8_t
             APar_RemoveAtom(iso_atom_path, PACKED_LANG_ATOM, packed_lang); //find the atom; don't create if it's "" to remove
         }
         else {
-            modified_atoms = true;
+            ap_ctx->modified_atoms = true;
             if (iso_container != MOVIE_LEVEL_ATOM)
-                prevent_update_using_padding = true; //because updating via padding works off of 'moov.udta', a full rewrite is req for tracks.
+                ap_ctx->prevent_update_using_padding = true; //because updating via padding works off of 'moov.udta', a full rewrite is req for tracks.
 
             desiredAtom = APar_FindAtom(iso_atom_path, true, PACKED_LANG_ATOM, packed_lang);
 
@@ -3910,23 +3978,23 @@ uint32_t APar_DetermineMediaData_AtomPosition() {
     short thisAtomNumber = 0;
 
     //loop through each atom in the struct array (which holds the offset info/data)
-    while (parsedAtoms[thisAtomNumber].NextAtomNumber != 0) {
+    while (ap_ctx->parsedAtoms[thisAtomNumber].NextAtomNumber != 0) {
 
-        if (strncmp(parsedAtoms[thisAtomNumber].AtomicName, "mdat", 4) == 0
-                && parsedAtoms[thisAtomNumber].AtomicLevel == 1) {
-            if (parsedAtoms[thisAtomNumber].AtomicLength <= 1 || parsedAtoms[thisAtomNumber].AtomicLength > 75) {
+        if (strncmp(ap_ctx->parsedAtoms[thisAtomNumber].AtomicName, "mdat", 4) == 0
+                && ap_ctx->parsedAtoms[thisAtomNumber].AtomicLevel == 1) {
+            if (ap_ctx->parsedAtoms[thisAtomNumber].AtomicLength <= 1 || ap_ctx->parsedAtoms[thisAtomNumber].AtomicLength > 75) {
                 break;
             }
         }
-        else if (parsedAtoms[thisAtomNumber].AtomicLevel == 1
-                && parsedAtoms[thisAtomNumber].AtomicLengthExtended == 0) {
-            mdat_position += parsedAtoms[thisAtomNumber].AtomicLength;
+        else if (ap_ctx->parsedAtoms[thisAtomNumber].AtomicLevel == 1
+                && ap_ctx->parsedAtoms[thisAtomNumber].AtomicLengthExtended == 0) {
+            mdat_position += ap_ctx->parsedAtoms[thisAtomNumber].AtomicLength;
         }
         else {
             //part of the pseudo 64-bit support
-            mdat_position += parsedAtoms[thisAtomNumber].AtomicLengthExtended;
+            mdat_position += ap_ctx->parsedAtoms[thisAtomNumber].AtomicLengthExtended;
         }
-        thisAtomNumber = parsedAtoms[thisAtomNumber].NextAtomNumber;
+        thisAtomNumber = ap_ctx->parsedAtoms[thisAtomNumber].NextAtomNumber;
     }
     return mdat_position;
 }
@@ -3935,13 +4003,13 @@ uint32_t APar_SimpleSumAtoms(short stop_atom) {
     uint32_t byte_sum = 0;
     //first, find the first mdat after this initial 'tfhd' atom to get the sum relative to that atom
     while (true) {
-        if (strncmp(parsedAtoms[stop_atom].AtomicName, "mdat", 4) == 0) {
+        if (strncmp(ap_ctx->parsedAtoms[stop_atom].AtomicName, "mdat", 4) == 0) {
             stop_atom--; //don't include the fragment's mdat, just the atoms prior to it
             break;
         }
         else {
-            if (parsedAtoms[stop_atom].NextAtomNumber != 0) {
-                stop_atom = parsedAtoms[stop_atom].NextAtomNumber;
+            if (ap_ctx->parsedAtoms[stop_atom].NextAtomNumber != 0) {
+                stop_atom = ap_ctx->parsedAtoms[stop_atom].NextAtomNumber;
             }
             else {
                 break;
@@ -3950,9 +4018,9 @@ uint32_t APar_SimpleSumAtoms(short stop_atom) {
     }
     byte_sum += 8; //the 'tfhd' points to the byte in mdat where the fragment data is - NOT the atom itself (should always be +8bytes with a fragment)
     while (true) {
-        if (parsedAtoms[stop_atom].AtomicLevel == 1) {
+        if (ap_ctx->parsedAtoms[stop_atom].AtomicLevel == 1) {
             byte_sum +=
-                    (parsedAtoms[stop_atom].AtomicLength == 1 ? (uint32_t) parsedAtoms[stop_atom].AtomicLengthExtended : parsedAtoms[stop_atom].AtomicLength);
+                    (ap_ctx->parsedAtoms[stop_atom].AtomicLength == 1 ? (uint32_t) ap_ctx->parsedAtoms[stop_atom].AtomicLengthExtended : ap_ctx->parsedAtoms[stop_atom].AtomicLength);
         }
         if (stop_atom == 0) {
             break;
@@ -3967,14 +4035,14 @@ uint32_t APar_SimpleSumAtoms(short stop_atom) {
 bool APar_Readjust_CO64_atom(uint32_t mdat_position, short co64_number) {
     bool co64_changed = false;
     APar_AtomicRead(co64_number);
-    parsedAtoms[co64_number].AtomicVerFlags = 0;
+    ap_ctx->parsedAtoms[co64_number].AtomicVerFlags = 0;
     bool deduct = false;
     //readjust
 
     char* co64_entries = (char *) malloc(sizeof(char) * 4 + 1);
     memset(co64_entries, 0, sizeof(char) * 4 + 1);
 
-    memcpy(co64_entries, parsedAtoms[co64_number].AtomicData, 4);
+    memcpy(co64_entries, ap_ctx->parsedAtoms[co64_number].AtomicData, 4);
     uint32_t entries = UInt32FromBigEndian(co64_entries);
 
     char* a_64bit_entry = (char *) malloc(sizeof(char) * 8 + 1);
@@ -3984,42 +4052,42 @@ bool APar_Readjust_CO64_atom(uint32_t mdat_position, short co64_number) {
         //read 8 bytes of the atom into a 8 char uint64_t a_64bit_entry to eval it
         for (int c = 0; c <= 7; c++) {
             //first co64 entry (32-bit uint32_t) is the number of entries; every other one is an actual offset value
-            a_64bit_entry[c] = parsedAtoms[co64_number].AtomicData[4 + (i - 1) * 8 + c];
+            a_64bit_entry[c] = ap_ctx->parsedAtoms[co64_number].AtomicData[4 + (i - 1) * 8 + c];
         }
         uint64_t this_entry = UInt64FromBigEndian(a_64bit_entry);
 
-        if (i == 1 && mdat_supplemental_offset == 0) { //for the first chunk, and only for the first *ever* entry, make the global mdat supplemental offset
-            if (this_entry - removed_bytes_tally > mdat_position) {
-                mdat_supplemental_offset = (uint64_t) mdat_position
-                        - ((uint64_t) this_entry - (uint64_t) removed_bytes_tally);
-                bytes_into_mdat = this_entry - bytes_before_mdat - removed_bytes_tally;
+        if (i == 1 && ap_ctx->mdat_supplemental_offset == 0) { //for the first chunk, and only for the first *ever* entry, make the global mdat supplemental offset
+            if (this_entry - ap_ctx->removed_bytes_tally > mdat_position) {
+                ap_ctx->mdat_supplemental_offset = (uint64_t) mdat_position
+                        - ((uint64_t) this_entry - (uint64_t) ap_ctx->removed_bytes_tally);
+                ap_ctx->bytes_into_mdat = this_entry - ap_ctx->bytes_before_mdat - ap_ctx->removed_bytes_tally;
                 deduct = true;
             }
             else {
-                mdat_supplemental_offset = mdat_position - (this_entry - removed_bytes_tally);
-                bytes_into_mdat = this_entry - bytes_before_mdat - removed_bytes_tally;
+                ap_ctx->mdat_supplemental_offset = mdat_position - (this_entry - ap_ctx->removed_bytes_tally);
+                ap_ctx->bytes_into_mdat = this_entry - ap_ctx->bytes_before_mdat - ap_ctx->removed_bytes_tally;
             }
 
-            if (mdat_supplemental_offset == 0) {
+            if (ap_ctx->mdat_supplemental_offset == 0) {
                 break;
             }
         }
 
-        if (mdat_supplemental_offset != 0) {
+        if (ap_ctx->mdat_supplemental_offset != 0) {
             co64_changed = true;
         }
 
         if (deduct) { //crap, uint32_t's were so nice to flip over by themselves to subtract nicely. going from 32-bit to 64-bit prevents that flipping
-            this_entry += mdat_supplemental_offset - (bytes_into_mdat * -1); // + bytes_into_mdat;
+            this_entry += ap_ctx->mdat_supplemental_offset - (ap_ctx->bytes_into_mdat * -1); // + bytes_into_mdat;
         }
         else {
-            this_entry += mdat_supplemental_offset + bytes_into_mdat; //this is where we add our new mdat offset difference
+            this_entry += ap_ctx->mdat_supplemental_offset + ap_ctx->bytes_into_mdat; //this is where we add our new mdat offset difference
         }
         char8TOuint64(this_entry, a_64bit_entry);
         //and put the data back into AtomicData...
         for (int d = 0; d <= 7; d++) {
             //first stco entry is the number of entries; every other one is an actual offset value
-            parsedAtoms[co64_number].AtomicData[4 + (i - 1) * 8 + d] = a_64bit_entry[d];
+            ap_ctx->parsedAtoms[co64_number].AtomicData[4 + (i - 1) * 8 + d] = a_64bit_entry[d];
         }
     }
 
@@ -4032,45 +4100,41 @@ bool APar_Readjust_CO64_atom(uint32_t mdat_position, short co64_number) {
 }
 
 bool APar_Readjust_TFHD_fragment_atom(uint32_t mdat_position, short tfhd_number) {
-    static bool tfhd_changed = false;
-    static bool determined_offset = false;
-    static uint64_t base_offset = 0;
-
     APar_AtomicRead(tfhd_number);
     char* tfhd_atomFlags_scrap = (char *) malloc(sizeof(char) * 10);
     memset(tfhd_atomFlags_scrap, 0, 10);
     //parsedAtoms[tfhd_number].AtomicVerFlags = APar_read32(tfhd_atomFlags_scrap, source_file, parsedAtoms[tfhd_number].AtomicStart+8);
 
-    if (parsedAtoms[tfhd_number].AtomicVerFlags & 0x01) { //seems the atomflags suggest bitpacking, but the spec doesn't specify it; if the 1st bit is set...
+    if (ap_ctx->parsedAtoms[tfhd_number].AtomicVerFlags & 0x01) { //seems the atomflags suggest bitpacking, but the spec doesn't specify it; if the 1st bit is set...
         memset(tfhd_atomFlags_scrap, 0, 10);
-        memcpy(tfhd_atomFlags_scrap, parsedAtoms[tfhd_number].AtomicData, 4);
+        memcpy(tfhd_atomFlags_scrap, ap_ctx->parsedAtoms[tfhd_number].AtomicData, 4);
 
-        uint64_t tfhd_offset = UInt64FromBigEndian(parsedAtoms[tfhd_number].AtomicData + 4);
+        uint64_t tfhd_offset = UInt64FromBigEndian(ap_ctx->parsedAtoms[tfhd_number].AtomicData + 4);
 
-        if (!determined_offset) {
-            determined_offset = true;
-            base_offset = APar_SimpleSumAtoms(tfhd_number) - tfhd_offset;
-            if (base_offset != 0) {
-                tfhd_changed = true;
+        if (!ap_ctx->tfhd_determined_offset) {
+            ap_ctx->tfhd_determined_offset = true;
+            ap_ctx->tfhd_base_offset = APar_SimpleSumAtoms(tfhd_number) - tfhd_offset;
+            if (ap_ctx->tfhd_base_offset != 0) {
+                ap_ctx->tfhd_changed = true;
             }
         }
 
-        tfhd_offset += base_offset;
-        char8TOuint64(tfhd_offset, parsedAtoms[tfhd_number].AtomicData + 4);
+        tfhd_offset += ap_ctx->tfhd_base_offset;
+        char8TOuint64(tfhd_offset, ap_ctx->parsedAtoms[tfhd_number].AtomicData + 4);
     }
-    return tfhd_changed;
+    return ap_ctx->tfhd_changed;
 }
 
 bool APar_Readjust_STCO_atom(uint32_t mdat_position, short stco_number) {
     bool stco_changed = false;
     APar_AtomicRead(stco_number);
-    parsedAtoms[stco_number].AtomicVerFlags = 0;
+    ap_ctx->parsedAtoms[stco_number].AtomicVerFlags = 0;
     //readjust
 
     char* stco_entries = (char *) malloc(sizeof(char) * 4 + 1);
     memset(stco_entries, 0, sizeof(char) * 4 + 1);
 
-    memcpy(stco_entries, parsedAtoms[stco_number].AtomicData, 4);
+    memcpy(stco_entries, ap_ctx->parsedAtoms[stco_number].AtomicData, 4);
     uint32_t entries = UInt32FromBigEndian(stco_entries);
 
     char* an_entry = (char *) malloc(sizeof(char) * 4 + 1);
@@ -4080,31 +4144,31 @@ bool APar_Readjust_STCO_atom(uint32_t mdat_position, short stco_number) {
         //read 4 bytes of the atom into a 4 char uint32_t an_entry to eval it
         for (int c = 0; c <= 3; c++) {
             //first stco entry is the number of entries; every other one is an actual offset value
-            an_entry[c] = parsedAtoms[stco_number].AtomicData[i * 4 + c];
+            an_entry[c] = ap_ctx->parsedAtoms[stco_number].AtomicData[i * 4 + c];
         }
 
         uint32_t this_entry = UInt32FromBigEndian(an_entry);
 
-        if (i == 1 && mdat_supplemental_offset == 0) { //for the first chunk, and only for the first *ever* entry, make the global mdat supplemental offset
+        if (i == 1 && ap_ctx->mdat_supplemental_offset == 0) { //for the first chunk, and only for the first *ever* entry, make the global mdat supplemental offset
 
-            mdat_supplemental_offset = (uint64_t) (mdat_position - (this_entry - removed_bytes_tally));
-            bytes_into_mdat = this_entry - bytes_before_mdat - removed_bytes_tally;
+            ap_ctx->mdat_supplemental_offset = (uint64_t) (mdat_position - (this_entry - ap_ctx->removed_bytes_tally));
+            ap_ctx->bytes_into_mdat = this_entry - ap_ctx->bytes_before_mdat - ap_ctx->removed_bytes_tally;
 
-            if (mdat_supplemental_offset == 0) {
+            if (ap_ctx->mdat_supplemental_offset == 0) {
                 break;
             }
         }
 
-        if (mdat_supplemental_offset != 0) {
+        if (ap_ctx->mdat_supplemental_offset != 0) {
             stco_changed = true;
         }
 
-        this_entry += mdat_supplemental_offset + bytes_into_mdat;
+        this_entry += ap_ctx->mdat_supplemental_offset + ap_ctx->bytes_into_mdat;
         char4TOuint32(this_entry, an_entry);
         //and put the data back into AtomicData...
         for (int d = 0; d <= 3; d++) {
             //first stco entry is the number of entries; every other one is an actual offset value
-            parsedAtoms[stco_number].AtomicData[i * 4 + d] = an_entry[d];
+            ap_ctx->parsedAtoms[stco_number].AtomicData[i * 4 + d] = an_entry[d];
         }
     }
 
@@ -4121,27 +4185,27 @@ bool APar_Readjust_STCO_atom(uint32_t mdat_position, short stco_number) {
 ///////////////////////////////////////////////////////////////////////////////////////
 
 void APar_ForcePadding(uint32_t padding_amount) {
-    if (tree_display_only || padding_amount == 0) {
+    if (ap_ctx->tree_display_only || padding_amount == 0) {
         return;
     }
 
-    if (udta_dynamics.free_atom_repository) {
-        parsedAtoms[udta_dynamics.free_atom_repository].AtomicLength = padding_amount;
+    if (ap_ctx->udta_dynamics.free_atom_repository) {
+        ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_repository].AtomicLength = padding_amount;
 
-        parsedAtoms[udta_dynamics.free_atom_repository].AtomicData = (char*) malloc(sizeof(char) * padding_amount); //allocate memory to write the NULL space out)
-        memset(parsedAtoms[udta_dynamics.free_atom_repository].AtomicData, 0, sizeof(char) * padding_amount);
+        ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_repository].AtomicData = (char*) malloc(sizeof(char) * padding_amount); //allocate memory to write the NULL space out)
+        memset(ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_repository].AtomicData, 0, sizeof(char) * padding_amount);
     }
-    else if (udta_dynamics.free_atom_secondary_repository) {
-        parsedAtoms[udta_dynamics.free_atom_secondary_repository].AtomicLength = padding_amount;
+    else if (ap_ctx->udta_dynamics.free_atom_secondary_repository) {
+        ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_secondary_repository].AtomicLength = padding_amount;
 
-        parsedAtoms[udta_dynamics.free_atom_secondary_repository].AtomicData = (char*) malloc(sizeof(char)
+        ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_secondary_repository].AtomicData = (char*) malloc(sizeof(char)
                 * padding_amount);
-        memset(parsedAtoms[udta_dynamics.free_atom_secondary_repository].AtomicData, 0, sizeof(char) * padding_amount);
+        memset(ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_secondary_repository].AtomicData, 0, sizeof(char) * padding_amount);
     }
     else {
-        APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, padding_amount, 0, 0, 1, APar_FindLastChild_of_ParentAtom(udta_dynamics.moov_atom));
+        APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, padding_amount, 0, 0, 1, APar_FindLastChild_of_ParentAtom(ap_ctx->udta_dynamics.moov_atom));
     }
-    new_file_size += padding_amount;
+    ap_ctx->new_file_size += padding_amount;
     return;
 }
 
@@ -4154,43 +4218,43 @@ void APar_ForcePadding(uint32_t padding_amount) {
  atom's AtomicData to that length so that when writeout time comes, this 'free' will write from memory - and it will be all nulled out.
  ----------------------*/
 void APar_ConsilidatePadding(uint32_t force_padding_amount) {
-    if (force_padding_amount <= 8 || tree_display_only) { //prevent having an atom of length 0 (which means it goes to EOF)
+    if (force_padding_amount <= 8 || ap_ctx->tree_display_only) { //prevent having an atom of length 0 (which means it goes to EOF)
         return;
     }
     short primary_repository = 0;
-    if (udta_dynamics.free_atom_repository) {
-        primary_repository = udta_dynamics.free_atom_repository;
+    if (ap_ctx->udta_dynamics.free_atom_repository) {
+        primary_repository = ap_ctx->udta_dynamics.free_atom_repository;
     }
-    else if (udta_dynamics.free_atom_secondary_repository) {
-        primary_repository = udta_dynamics.free_atom_secondary_repository;
+    else if (ap_ctx->udta_dynamics.free_atom_secondary_repository) {
+        primary_repository = ap_ctx->udta_dynamics.free_atom_secondary_repository;
     }
     else if (force_padding_amount >= 8) {
-        APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, force_padding_amount, 0, 0, 1, APar_FindLastChild_of_ParentAtom(udta_dynamics.moov_atom));
-        new_file_size += force_padding_amount;
+        APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, force_padding_amount, 0, 0, 1, APar_FindLastChild_of_ParentAtom(ap_ctx->udta_dynamics.moov_atom));
+        ap_ctx->new_file_size += force_padding_amount;
         return;
     }
 
-    short iter = parsedAtoms[udta_dynamics.udta_atom].NextAtomNumber;
+    short iter = ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.udta_atom].NextAtomNumber;
     while (true) {
         //when we eliminate atoms in this loop, the NextAtomNumber becomes -1; next_atom ensures the list is followed
-        short next_atom = parsedAtoms[iter].NextAtomNumber;
+        short next_atom = ap_ctx->parsedAtoms[iter].NextAtomNumber;
 
-        if (memcmp(parsedAtoms[iter].AtomicName, "free", 4) == 0 && iter != primary_repository) {
-            if (iter == udta_dynamics.last_udta_child_atom) {
-                udta_dynamics.last_udta_child_atom = APar_FindPrecedingAtom(iter);
+        if (memcmp(ap_ctx->parsedAtoms[iter].AtomicName, "free", 4) == 0 && iter != primary_repository) {
+            if (iter == ap_ctx->udta_dynamics.last_udta_child_atom) {
+                ap_ctx->udta_dynamics.last_udta_child_atom = APar_FindPrecedingAtom(iter);
             }
-            APar_EliminateAtom(iter, parsedAtoms[iter].NextAtomNumber);
+            APar_EliminateAtom(iter, ap_ctx->parsedAtoms[iter].NextAtomNumber);
         }
 
-        if (iter == udta_dynamics.first_postfree_level1_atom) { //this makes sure that anything in udta is processed...
+        if (iter == ap_ctx->udta_dynamics.first_postfree_level1_atom) { //this makes sure that anything in udta is processed...
             break;
         }
         iter = next_atom;
     }
-    parsedAtoms[primary_repository].AtomicLength = force_padding_amount;
+    ap_ctx->parsedAtoms[primary_repository].AtomicLength = force_padding_amount;
 
-    parsedAtoms[primary_repository].AtomicData = (char*) malloc(sizeof(char) * force_padding_amount);
-    memset(parsedAtoms[primary_repository].AtomicData, 0, sizeof(char) * force_padding_amount);
+    ap_ctx->parsedAtoms[primary_repository].AtomicData = (char*) malloc(sizeof(char) * force_padding_amount);
+    memset(ap_ctx->parsedAtoms[primary_repository].AtomicData, 0, sizeof(char) * force_padding_amount);
 
     return;
 }
@@ -4210,26 +4274,26 @@ void APar_ForcePadding_sans_udta() {
     //scan through all top level atoms; fragmented files won't be optimized
     for (uint8_t i = 1; i <= total_file_level_atoms; i++) {
         eval_atom = APar_ReturnChildrenAtoms(0, i);
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "moov", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "moov", 4) == 0) {
             moov_atom = eval_atom; //note moov atom so that a 'free' or 'skip' after it can be summed
         }
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "mdat", 4) == 0
-                || memcmp(parsedAtoms[eval_atom].AtomicName, "moof", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "mdat", 4) == 0
+                || memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "moof", 4) == 0) {
             significant_atom = eval_atom; //note moov atom so that a 'free' or 'skip' after it *will NOT* be summed
         }
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "free", 4) == 0
-                || memcmp(parsedAtoms[eval_atom].AtomicName, "skip", 4) == 0) {
-            if (moov_atom > 0 && significant_atom == 0 && parsedAtoms[eval_atom].AtomicLength != 1) {
-                free_padding_space += parsedAtoms[eval_atom].AtomicLength;
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "free", 4) == 0
+                || memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "skip", 4) == 0) {
+            if (moov_atom > 0 && significant_atom == 0 && ap_ctx->parsedAtoms[eval_atom].AtomicLength != 1) {
+                free_padding_space += ap_ctx->parsedAtoms[eval_atom].AtomicLength;
             }
-            if (moov_atom > 0 && significant_atom == 0 && parsedAtoms[eval_atom].AtomicLength == 1) {
-                free_padding_space += (uint32_t) parsedAtoms[eval_atom].AtomicLengthExtended;
+            if (moov_atom > 0 && significant_atom == 0 && ap_ctx->parsedAtoms[eval_atom].AtomicLength == 1) {
+                free_padding_space += (uint32_t) ap_ctx->parsedAtoms[eval_atom].AtomicLengthExtended;
             }
         }
     }
-    if (free_padding_space <= pad_prefs.minimum_required_padding_size && pad_prefs.default_padding_size >= 8) {
-        APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, pad_prefs.default_padding_size, 0, 0, 1, APar_FindLastChild_of_ParentAtom(moov_atom));
-        new_file_size += pad_prefs.default_padding_size;
+    if (free_padding_space <= ap_ctx->pad_prefs.minimum_required_padding_size && ap_ctx->pad_prefs.default_padding_size >= 8) {
+        APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, ap_ctx->pad_prefs.default_padding_size, 0, 0, 1, APar_FindLastChild_of_ParentAtom(moov_atom));
+        ap_ctx->new_file_size += ap_ctx->pad_prefs.default_padding_size;
     }
     return;
 }
@@ -4249,86 +4313,86 @@ void APar_ForcePadding_sans_udta() {
  TODO: only 'free' is used here; the free_type is defined as 'free' or 'skip' - 'skip' isn't used as padding here
  ----------------------*/
 void APar_DetermineDynamicUpdate(bool initial_pass) {
-    udtaAtom = APar_FindAtom("moov.udta", false, SIMPLE_ATOM, 0);
+    ap_ctx->udtaAtom = APar_FindAtom("moov.udta", false, SIMPLE_ATOM, 0);
 
     //if there is no 'udta' atom, but we still want any available padding listed - there is none
-    if (udtaAtom == NULL && !modified_atoms) {
-        udta_dynamics.max_usable_free_space = 0;
+    if (ap_ctx->udtaAtom == NULL && !ap_ctx->modified_atoms) {
+        ap_ctx->udta_dynamics.max_usable_free_space = 0;
         return;
     }
-    else if (udtaAtom == NULL) {
+    else if (ap_ctx->udtaAtom == NULL) {
         //TODO: how to handle this so a full rewrite doesn't occur, because a segfault happens a few lines down with udtaAtom->AtomicNumber
-        udta_dynamics.max_usable_free_space = 0; //for now
+        ap_ctx->udta_dynamics.max_usable_free_space = 0; //for now
         APar_ForcePadding_sans_udta(); //useless currently for AP since it can't consider padding without a 'udta' atom present
         return; //for now
     }
 
-    if (!udta_dynamics.dynamic_updating) {
-        udta_dynamics.udta_atom = udtaAtom->AtomicNumber;
-        udta_dynamics.last_udta_child_atom = APar_FindLastChild_of_ParentAtom(udtaAtom->AtomicNumber);
-        udta_dynamics.first_postfree_level1_atom = 0;
-        udta_dynamics.contained_free_space = 0;
-        udta_dynamics.max_usable_free_space = 0;
-        udta_dynamics.free_atom_repository = 0;
+    if (!ap_ctx->udta_dynamics.dynamic_updating) {
+        ap_ctx->udta_dynamics.udta_atom = ap_ctx->udtaAtom->AtomicNumber;
+        ap_ctx->udta_dynamics.last_udta_child_atom = APar_FindLastChild_of_ParentAtom(ap_ctx->udtaAtom->AtomicNumber);
+        ap_ctx->udta_dynamics.first_postfree_level1_atom = 0;
+        ap_ctx->udta_dynamics.contained_free_space = 0;
+        ap_ctx->udta_dynamics.max_usable_free_space = 0;
+        ap_ctx->udta_dynamics.free_atom_repository = 0;
     }
     bool transited_udta_metadata = false;
-    short iter = udtaAtom->NextAtomNumber;
+    short iter = ap_ctx->udtaAtom->NextAtomNumber;
 
-    if (!initial_pass && !psp_brand) {
-        if (udta_dynamics.free_atom_repository == 0) {
+    if (!initial_pass && !ap_ctx->psp_brand) {
+        if (ap_ctx->udta_dynamics.free_atom_repository == 0) {
             //find or create a 'top level 'free' atom after 'udta'
-            udta_dynamics.free_atom_repository =
-                    APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, udta_dynamics.max_usable_free_space
-                            - (udtaAtom->AtomicLength - udta_dynamics.original_udta_size), 0, 0, 1, udta_dynamics.last_udta_child_atom);
+            ap_ctx->udta_dynamics.free_atom_repository =
+                    APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, ap_ctx->udta_dynamics.max_usable_free_space
+                            - (ap_ctx->udtaAtom->AtomicLength - ap_ctx->udta_dynamics.original_udta_size), 0, 0, 1, ap_ctx->udta_dynamics.last_udta_child_atom);
 
         }
         else {
-            parsedAtoms[udta_dynamics.free_atom_repository].AtomicLength += udta_dynamics.contained_free_space
-                    - (udtaAtom->AtomicLength - udta_dynamics.original_udta_size);
+            ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_repository].AtomicLength += ap_ctx->udta_dynamics.contained_free_space
+                    - (ap_ctx->udtaAtom->AtomicLength - ap_ctx->udta_dynamics.original_udta_size);
         }
     }
 
     while (true) {
         //when we eliminate atoms in this loop, the NextAtomNumber becomes -1; next_atom ensures the list is followed
-        short next_atom = parsedAtoms[iter].NextAtomNumber;
+        short next_atom = ap_ctx->parsedAtoms[iter].NextAtomNumber;
 
-        if (memcmp(parsedAtoms[iter].AtomicName, "free", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[iter].AtomicName, "free", 4) == 0) {
 
             if (initial_pass) {
-                udta_dynamics.max_usable_free_space += parsedAtoms[iter].AtomicLength;
+                ap_ctx->udta_dynamics.max_usable_free_space += ap_ctx->parsedAtoms[iter].AtomicLength;
                 //a primary preferred repository is on level 1; this is where all 'free' atoms will eventually wind up in a dynamic update
-                if (parsedAtoms[iter].AtomicLevel == 1 && udta_dynamics.free_atom_repository == 0) {
-                    udta_dynamics.free_atom_repository = iter;
+                if (ap_ctx->parsedAtoms[iter].AtomicLevel == 1 && ap_ctx->udta_dynamics.free_atom_repository == 0) {
+                    ap_ctx->udta_dynamics.free_atom_repository = iter;
 
                     // a tracked secondary respository is a child atom & not file level; track so that if a full rewrite is required this 'free' meets default_padding_size
                 }
-                else if (parsedAtoms[iter].AtomicLevel > 1) {
-                    if (udta_dynamics.free_atom_secondary_repository == 0) {
-                        udta_dynamics.free_atom_secondary_repository = iter;
+                else if (ap_ctx->parsedAtoms[iter].AtomicLevel > 1) {
+                    if (ap_ctx->udta_dynamics.free_atom_secondary_repository == 0) {
+                        ap_ctx->udta_dynamics.free_atom_secondary_repository = iter;
                     }
-                    else if (parsedAtoms[iter].AtomicLength
-                            > parsedAtoms[udta_dynamics.free_atom_secondary_repository].AtomicLength) {
-                        udta_dynamics.free_atom_secondary_repository = iter;
+                    else if (ap_ctx->parsedAtoms[iter].AtomicLength
+                            > ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.free_atom_secondary_repository].AtomicLength) {
+                        ap_ctx->udta_dynamics.free_atom_secondary_repository = iter;
                     }
                 }
             }
             else {
-                if (iter != udta_dynamics.free_atom_repository) {
-                    APar_EliminateAtom(iter, parsedAtoms[iter].NextAtomNumber);
+                if (iter != ap_ctx->udta_dynamics.free_atom_repository) {
+                    APar_EliminateAtom(iter, ap_ctx->parsedAtoms[iter].NextAtomNumber);
                 }
             }
             //udta is already the last atom in moov because of APar_Optimize, only things left are:
             //             mdat(s), fragments, uuid(s), skip/free(s) & possible mpeg7 metadata in a L1 meta
             if (!transited_udta_metadata) {
                 if (initial_pass) {
-                    udta_dynamics.contained_free_space += parsedAtoms[iter].AtomicLength;
+                    ap_ctx->udta_dynamics.contained_free_space += ap_ctx->parsedAtoms[iter].AtomicLength;
                 }
                 else {
                     //since it will be eliminated next, make the last_udta_child_atom the preceding atom to this 'free' atom
-                    if (iter == udta_dynamics.last_udta_child_atom) {
-                        udta_dynamics.last_udta_child_atom = APar_FindPrecedingAtom(iter);
+                    if (iter == ap_ctx->udta_dynamics.last_udta_child_atom) {
+                        ap_ctx->udta_dynamics.last_udta_child_atom = APar_FindPrecedingAtom(iter);
                     }
-                    APar_EliminateAtom(iter, parsedAtoms[iter].NextAtomNumber);
+                    APar_EliminateAtom(iter, ap_ctx->parsedAtoms[iter].NextAtomNumber);
                 }
             }
 
@@ -4336,75 +4400,74 @@ void APar_DetermineDynamicUpdate(bool initial_pass) {
         }
         else {
             if (transited_udta_metadata) {
-                udta_dynamics.first_postfree_level1_atom = parsedAtoms[iter].AtomicNumber;
+                ap_ctx->udta_dynamics.first_postfree_level1_atom = ap_ctx->parsedAtoms[iter].AtomicNumber;
                 break;
             }
         }
-        if (iter == udta_dynamics.last_udta_child_atom || iter == 0) { //this makes sure that anything in udta is processed...
+        if (iter == ap_ctx->udta_dynamics.last_udta_child_atom || iter == 0) { //this makes sure that anything in udta is processed...
             transited_udta_metadata = true;
             if (iter == 0) {
                 break;
             }
         }
         iter = next_atom;
-        if (iter == udta_dynamics.free_atom_repository) {
+        if (iter == ap_ctx->udta_dynamics.free_atom_repository) {
             transited_udta_metadata = true;
         }
     }
 
     if (initial_pass) {
-        int userdata_difference = udtaAtom->AtomicLength - udta_dynamics.original_udta_size; //if metadata became shorter or removed, free space would be created
+        int userdata_difference = ap_ctx->udtaAtom->AtomicLength - ap_ctx->udta_dynamics.original_udta_size; //if metadata became shorter or removed, free space would be created
         //+8 so that 'free' can be accommodated; can't write a 'free' atom of length = 5 - min is 8; OR it disappears entirely
-        if (((int) udta_dynamics.max_usable_free_space >= userdata_difference + 8) || (userdata_difference <= -8)
-                || (((int) udta_dynamics.max_usable_free_space >= 8) && (-8 < userdata_difference)
+        if (((int) ap_ctx->udta_dynamics.max_usable_free_space >= userdata_difference + 8) || (userdata_difference <= -8)
+                || (((int) ap_ctx->udta_dynamics.max_usable_free_space >= 8) && (-8 < userdata_difference)
                         && (userdata_difference < 0))
-                || (int) udta_dynamics.max_usable_free_space == userdata_difference) {
+                || (int) ap_ctx->udta_dynamics.max_usable_free_space == userdata_difference) {
 
-            if (!moov_atom_was_mooved) { //only allow dynamic updating when moov precedes any mdat atoms...
-                udta_dynamics.dynamic_updating = true;
+            if (!ap_ctx->moov_atom_was_mooved) { //only allow dynamic updating when moov precedes any mdat atoms...
+                ap_ctx->udta_dynamics.dynamic_updating = true;
             }
             else {
                 //if there is insufficient padding when moov is rearranged to precede mdat, add default padding
-                if ((pad_prefs.minimum_required_padding_size < udta_dynamics.max_usable_free_space)
-                        && (udta_dynamics.max_usable_free_space < pad_prefs.default_padding_size)) {
-                    APar_ForcePadding(pad_prefs.default_padding_size);
+                if ((ap_ctx->pad_prefs.minimum_required_padding_size < ap_ctx->udta_dynamics.max_usable_free_space)
+                        && (ap_ctx->udta_dynamics.max_usable_free_space < ap_ctx->pad_prefs.default_padding_size)) {
+                    APar_ForcePadding(ap_ctx->pad_prefs.default_padding_size);
                 }
                 APar_DetermineAtomLengths();
                 return;
             }
-            if ((pad_prefs.minimum_required_padding_size < udta_dynamics.max_usable_free_space)
-                    && (udta_dynamics.max_usable_free_space < pad_prefs.default_padding_size)) {
-                APar_ForcePadding(pad_prefs.default_padding_size);
-            }
-            if (pad_prefs.minimum_required_padding_size > udta_dynamics.max_usable_free_space) {
-                APar_ConsilidatePadding(pad_prefs.minimum_required_padding_size);
-                udta_dynamics.dynamic_updating = false;
+            //padding is not grown to default_padding_size here: mdat stays where it is during a dynamic update, so only the
+            //space already present can be used. Growing it would make udta look larger than the space available & underflow
+            //the length of the 'free' atom filling the gap in the 2nd pass. Default padding is added on the next full rewrite.
+            if (ap_ctx->pad_prefs.minimum_required_padding_size > ap_ctx->udta_dynamics.max_usable_free_space) {
+                APar_ConsilidatePadding(ap_ctx->pad_prefs.minimum_required_padding_size);
+                ap_ctx->udta_dynamics.dynamic_updating = false;
             }
             //if 'free' padding space is greater than what we allow, reduce it here (reduce anything over max to default_padding_size)
-            if (udta_dynamics.max_usable_free_space > pad_prefs.maximum_present_padding_size) {
-                udta_dynamics.dynamic_updating = false;
-                APar_ConsilidatePadding(pad_prefs.default_padding_size);
+            if (ap_ctx->udta_dynamics.max_usable_free_space > ap_ctx->pad_prefs.maximum_present_padding_size) {
+                ap_ctx->udta_dynamics.dynamic_updating = false;
+                APar_ConsilidatePadding(ap_ctx->pad_prefs.default_padding_size);
             }
             //say 'covr' is erased yielding 140,000 bytes of 'free' - take care of it here by forcing a rewrite (erasing an atom != conversion to 'free')
-            if (abs(userdata_difference) > pad_prefs.maximum_present_padding_size) {
-                udta_dynamics.dynamic_updating = false;
-                APar_ConsilidatePadding(pad_prefs.default_padding_size);
+            if (abs(userdata_difference) > ap_ctx->pad_prefs.maximum_present_padding_size) {
+                ap_ctx->udta_dynamics.dynamic_updating = false;
+                APar_ConsilidatePadding(ap_ctx->pad_prefs.default_padding_size);
             }
         }
         else {
             //if the file has no functional padding, add a default amount of padding when the file needs to be completely rewritten
-            if (udta_dynamics.max_usable_free_space <= pad_prefs.minimum_required_padding_size) {
-                if (psp_brand) {
-                    udta_dynamics.dynamic_updating = true;
+            if (ap_ctx->udta_dynamics.max_usable_free_space <= ap_ctx->pad_prefs.minimum_required_padding_size) {
+                if (ap_ctx->psp_brand) {
+                    ap_ctx->udta_dynamics.dynamic_updating = true;
                 }
-                else if (pad_prefs.default_padding_size >= 8) {
-                    APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, pad_prefs.default_padding_size, 0, 0, 1, APar_FindLastChild_of_ParentAtom(udta_dynamics.moov_atom));
-                    new_file_size += pad_prefs.default_padding_size; //used in shell progress bar; easier to just outright add it than go through the whole tree
+                else if (ap_ctx->pad_prefs.default_padding_size >= 8) {
+                    APar_InterjectNewAtom("free", CHILD_ATOM, SIMPLE_ATOM, ap_ctx->pad_prefs.default_padding_size, 0, 0, 1, APar_FindLastChild_of_ParentAtom(ap_ctx->udta_dynamics.moov_atom));
+                    ap_ctx->new_file_size += ap_ctx->pad_prefs.default_padding_size; //used in shell progress bar; easier to just outright add it than go through the whole tree
                 }
             }
-            else if (!udta_dynamics.dynamic_updating
-                    && udta_dynamics.max_usable_free_space < pad_prefs.default_padding_size) {
-                APar_ConsilidatePadding(pad_prefs.default_padding_size);
+            else if (!ap_ctx->udta_dynamics.dynamic_updating
+                    && ap_ctx->udta_dynamics.max_usable_free_space < ap_ctx->pad_prefs.default_padding_size) {
+                APar_ConsilidatePadding(ap_ctx->pad_prefs.default_padding_size);
             }
         }
     }
@@ -4413,7 +4476,7 @@ void APar_DetermineDynamicUpdate(bool initial_pass) {
         //	APar_ForcePadding(pad_prefs.default_padding_size);
         //}
     }
-    if (!tree_display_only) { //APar_DetermineAtomLengths doesn't handle the atoms under 'stsd' any more; for atom setting/removal, 'stsd' parsing is skipped
+    if (!ap_ctx->tree_display_only) { //APar_DetermineAtomLengths doesn't handle the atoms under 'stsd' any more; for atom setting/removal, 'stsd' parsing is skipped
         APar_DetermineAtomLengths();
     }
     return;
@@ -4443,31 +4506,31 @@ void APar_Optimize(bool mdat_test_only) {
     //scan through all top level atoms; fragmented files won't be optimized
     for (uint8_t i = 1; i <= total_file_level_atoms; i++) {
         eval_atom = APar_ReturnChildrenAtoms(0, i);
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "moof", 4) == 0
-                || memcmp(parsedAtoms[eval_atom].AtomicName, "mfra", 4) == 0) {
-            move_moov_atom = false; //moov reordering won't be occurring on fragmented files, but it should have moov first anyway (QuickTime does at least)
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "moof", 4) == 0
+                || memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "mfra", 4) == 0) {
+            ap_ctx->move_moov_atom = false; //moov reordering won't be occurring on fragmented files, but it should have moov first anyway (QuickTime does at least)
         }
     }
 
     for (uint8_t iii = 1; iii <= total_file_level_atoms; iii++) {
         eval_atom = APar_ReturnChildrenAtoms(0, iii);
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "mdat", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "mdat", 4) == 0) {
             if (first_mdat_atom == 0) {
                 first_mdat_atom = eval_atom;
             }
         }
 
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "moov", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "moov", 4) == 0) {
             moov_atom = eval_atom;
-            udta_dynamics.moov_atom = eval_atom;
+            ap_ctx->udta_dynamics.moov_atom = eval_atom;
         }
 
         //keep track of any (where any = up to 5) 'free' atoms that come after moov but before anything else; TODO: also 'skip' atoms
-        if (memcmp(parsedAtoms[eval_atom].AtomicName, "free", 4) != 0) {
+        if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "free", 4) != 0) {
             last_noteworthy_atom = eval_atom;
         }
-        if (memcmp(parsedAtoms[last_noteworthy_atom].AtomicName, "moov", 4) == 0
-                && memcmp(parsedAtoms[eval_atom].AtomicName, "free", 4) == 0) {
+        if (memcmp(ap_ctx->parsedAtoms[last_noteworthy_atom].AtomicName, "moov", 4) == 0
+                && memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "free", 4) == 0) {
             if (padding_atoms[0] < 5) {
                 padding_atoms[0]++;
                 padding_atoms[padding_atoms[0]] = eval_atom;
@@ -4476,20 +4539,20 @@ void APar_Optimize(bool mdat_test_only) {
     }
 
     //for each padding 'free' atom after moov (but before anything else significant), increase the AtomicLevel so that it becomes a child to moov (so it follows moov when it gets rearranged)
-    if (move_moov_atom && first_mdat_atom > 0 && moov_atom > 0 && moov_atom > first_mdat_atom) {
+    if (ap_ctx->move_moov_atom && first_mdat_atom > 0 && moov_atom > 0 && moov_atom > first_mdat_atom) {
         if (mdat_test_only) {
-            moov_atom_was_mooved = true; //this is all the interesting info required (during APar_PrintAtomicTree)
+            ap_ctx->moov_atom_was_mooved = true; //this is all the interesting info required (during APar_PrintAtomicTree)
             return;
         }
         else {
             for (uint8_t jj = 1; jj <= padding_atoms[0]; jj++) {
-                parsedAtoms[padding_atoms[jj]].AtomicLevel++;
+                ap_ctx->parsedAtoms[padding_atoms[jj]].AtomicLevel++;
             }
             APar_MoveAtom(moov_atom, first_mdat_atom); //move 'moov' in front of 'mdat'
-            moov_atom_was_mooved = true;
+            ap_ctx->moov_atom_was_mooved = true;
             //reinstate the padding atoms as level 1 'free' atoms now that moov is rearranged.
             for (uint8_t kk = 1; kk <= padding_atoms[0]; kk++) {
-                parsedAtoms[padding_atoms[kk]].AtomicLevel--;
+                ap_ctx->parsedAtoms[padding_atoms[kk]].AtomicLevel--;
             }
         }
     }
@@ -4503,21 +4566,21 @@ void APar_Optimize(bool mdat_test_only) {
 
         for (uint8_t moov_i = 1; moov_i <= total_moov_child_atoms; moov_i++) {
             eval_atom = APar_ReturnChildrenAtoms(moov_atom, moov_i);
-            if (memcmp(parsedAtoms[eval_atom].AtomicName, "udta", 4) == 0 && parsedAtoms[eval_atom].AtomicLevel == 2) {
+            if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "udta", 4) == 0 && ap_ctx->parsedAtoms[eval_atom].AtomicLevel == 2) {
                 udta_atom = eval_atom;
             }
             else {
-                if (memcmp(parsedAtoms[eval_atom].AtomicName, "free", 4) != 0) { //don't reorder just to move udta behind free
+                if (memcmp(ap_ctx->parsedAtoms[eval_atom].AtomicName, "free", 4) != 0) { //don't reorder just to move udta behind free
                     any_child_atom = eval_atom;
                 }
             }
         }
 
-        if (any_child_atom > udta_atom && !tree_display_only && udta_atom > 0) { //memcmp(parsedAtoms[udta_atom].AtomicName, "udta", 4) == 0 works too
+        if (any_child_atom > udta_atom && !ap_ctx->tree_display_only && udta_atom > 0) { //memcmp(parsedAtoms[udta_atom].AtomicName, "udta", 4) == 0 works too
             APar_MoveAtom(udta_atom, any_child_atom);
         }
     }
-    initial_optimize_pass = false;
+    ap_ctx->initial_optimize_pass = false;
     return;
 }
 
@@ -4526,41 +4589,41 @@ void APar_Optimize(bool mdat_test_only) {
 ///////////////////////////////////////////////////////////////////////////////////////
 
 void APar_DetermineNewFileLength() {
-    new_file_size = 0;
+    ap_ctx->new_file_size = 0;
     short thisAtomNumber = 0;
     while (true) {
-        if (parsedAtoms[thisAtomNumber].AtomicLevel == 1) {
-            if (parsedAtoms[thisAtomNumber].AtomicLengthExtended == 0) {
+        if (ap_ctx->parsedAtoms[thisAtomNumber].AtomicLevel == 1) {
+            if (ap_ctx->parsedAtoms[thisAtomNumber].AtomicLengthExtended == 0) {
                 //normal 32-bit number when AtomicLengthExtended == 0 (for run-o-the-mill mdat & mdat.length=0)
-                new_file_size += parsedAtoms[thisAtomNumber].AtomicLength; //used in progressbar
+                ap_ctx->new_file_size += ap_ctx->parsedAtoms[thisAtomNumber].AtomicLength; //used in progressbar
             }
             else {
                 //pseudo 64-bit mdat length
-                new_file_size += parsedAtoms[thisAtomNumber].AtomicLengthExtended; //used in progressbar
+                ap_ctx->new_file_size += ap_ctx->parsedAtoms[thisAtomNumber].AtomicLengthExtended; //used in progressbar
             }
-            if (parsedAtoms[thisAtomNumber].AtomicLength == 0) {
-                new_file_size += (uint32_t) file_size - parsedAtoms[thisAtomNumber].AtomicStart; //used in progressbar; mdat.length = 1
+            if (ap_ctx->parsedAtoms[thisAtomNumber].AtomicLength == 0) {
+                ap_ctx->new_file_size += (uint32_t) ap_ctx->file_size - ap_ctx->parsedAtoms[thisAtomNumber].AtomicStart; //used in progressbar; mdat.length = 1
             }
         }
-        if (parsedAtoms[thisAtomNumber].NextAtomNumber == 0) {
+        if (ap_ctx->parsedAtoms[thisAtomNumber].NextAtomNumber == 0) {
             break;
         }
-        thisAtomNumber = parsedAtoms[thisAtomNumber].NextAtomNumber;
+        thisAtomNumber = ap_ctx->parsedAtoms[thisAtomNumber].NextAtomNumber;
     }
     return;
 }
 
 void APar_DetermineAtomLengths() {
 
-    if (!udta_dynamics.dynamic_updating && !psp_brand && initial_optimize_pass) {
+    if (!ap_ctx->udta_dynamics.dynamic_updating && !ap_ctx->psp_brand && ap_ctx->initial_optimize_pass) {
         APar_Optimize(false);
     }
     else {
         //'moov' & the last child of 'udta' are discovered in APar_Optimize and must be known to do dynamic updating (for PSP files)
-        udta_dynamics.moov_atom = APar_FindAtom("moov", false, SIMPLE_ATOM, 0)->AtomicNumber;
+        ap_ctx->udta_dynamics.moov_atom = APar_FindAtom("moov", false, SIMPLE_ATOM, 0)->AtomicNumber;
         AtomicInfo* udta_atom = APar_FindAtom("moov.udta", false, SIMPLE_ATOM, 0);
         if (udta_atom != NULL) { //its possible it was erased...
-            udta_dynamics.last_udta_child_atom = APar_FindLastChild_of_ParentAtom(udta_atom->AtomicNumber);
+            ap_ctx->udta_dynamics.last_udta_child_atom = APar_FindLastChild_of_ParentAtom(udta_atom->AtomicNumber);
         }
     }
 
@@ -4580,7 +4643,7 @@ void APar_DetermineAtomLengths() {
             break; //we seem to have hit the first atom
         }
 
-        uint32_t _atom_ = UInt32FromBigEndian(parsedAtoms[rev_atom_loop].AtomicName);
+        uint32_t _atom_ = UInt32FromBigEndian(ap_ctx->parsedAtoms[rev_atom_loop].AtomicName);
         switch (_atom_) {
         case 0x6D657461: //'meta'
             atom_size += 12; //meta has 4 bytes length, 4 bytes name & 4 bytes NULL space (...it could be versioned atom...)
@@ -4595,38 +4658,38 @@ void APar_DetermineAtomLengths() {
             break;
         }
 
-        if (parsedAtoms[rev_atom_loop].NextAtomNumber != 0) {
-            next_atom = parsedAtoms[rev_atom_loop].NextAtomNumber;
+        if (ap_ctx->parsedAtoms[rev_atom_loop].NextAtomNumber != 0) {
+            next_atom = ap_ctx->parsedAtoms[rev_atom_loop].NextAtomNumber;
         }
 
-        while (parsedAtoms[next_atom].AtomicLevel > parsedAtoms[rev_atom_loop].AtomicLevel) { // eval all child atoms....
-            if (parsedAtoms[rev_atom_loop].AtomicLevel == (parsedAtoms[next_atom].AtomicLevel - 1)) { // only child atoms 1 level down
-                atom_size += parsedAtoms[next_atom].AtomicLength;
+        while (ap_ctx->parsedAtoms[next_atom].AtomicLevel > ap_ctx->parsedAtoms[rev_atom_loop].AtomicLevel) { // eval all child atoms....
+            if (ap_ctx->parsedAtoms[rev_atom_loop].AtomicLevel == (ap_ctx->parsedAtoms[next_atom].AtomicLevel - 1)) { // only child atoms 1 level down
+                atom_size += ap_ctx->parsedAtoms[next_atom].AtomicLength;
             }
-            else if (parsedAtoms[next_atom].AtomicLevel < parsedAtoms[rev_atom_loop].AtomicLevel) {
+            else if (ap_ctx->parsedAtoms[next_atom].AtomicLevel < ap_ctx->parsedAtoms[rev_atom_loop].AtomicLevel) {
                 break;
             }
-            next_atom = parsedAtoms[next_atom].NextAtomNumber; //increment to eval next atom
-            parsedAtoms[rev_atom_loop].AtomicLength = atom_size;
+            next_atom = ap_ctx->parsedAtoms[next_atom].NextAtomNumber; //increment to eval next atom
+            ap_ctx->parsedAtoms[rev_atom_loop].AtomicLength = atom_size;
         }
 
         if (_atom_ == 0x75647461
-                && parsedAtoms[rev_atom_loop].AtomicLevel
-                        > parsedAtoms[parsedAtoms[rev_atom_loop].NextAtomNumber].AtomicLevel) { //udta with no child atoms; get here by erasing the last asset in a 3gp file, and it won't quite erase because udta thinks its the former AtomicLength
-            parsedAtoms[rev_atom_loop].AtomicLength = 8;
+                && ap_ctx->parsedAtoms[rev_atom_loop].AtomicLevel
+                        > ap_ctx->parsedAtoms[ap_ctx->parsedAtoms[rev_atom_loop].NextAtomNumber].AtomicLevel) { //udta with no child atoms; get here by erasing the last asset in a 3gp file, and it won't quite erase because udta thinks its the former AtomicLength
+            ap_ctx->parsedAtoms[rev_atom_loop].AtomicLength = 8;
         }
         if (_atom_ == 0x6D657461
-                && parsedAtoms[rev_atom_loop].AtomicLevel
-                        != parsedAtoms[parsedAtoms[rev_atom_loop].NextAtomNumber].AtomicLevel - 1) { //meta with no child atoms; get here by erasing the last existing uuid atom.
-            parsedAtoms[rev_atom_loop].AtomicLength = 12;
+                && ap_ctx->parsedAtoms[rev_atom_loop].AtomicLevel
+                        != ap_ctx->parsedAtoms[ap_ctx->parsedAtoms[rev_atom_loop].NextAtomNumber].AtomicLevel - 1) { //meta with no child atoms; get here by erasing the last existing uuid atom.
+            ap_ctx->parsedAtoms[rev_atom_loop].AtomicLength = 12;
         }
         if (_atom_ == 0x696C7374
-                && parsedAtoms[rev_atom_loop].AtomicLevel
-                        != parsedAtoms[parsedAtoms[rev_atom_loop].NextAtomNumber].AtomicLevel - 1) { //ilst with no child atoms; get here by erasing the last piece of iTunes style metadata
-            parsedAtoms[rev_atom_loop].AtomicLength = 8;
+                && ap_ctx->parsedAtoms[rev_atom_loop].AtomicLevel
+                        != ap_ctx->parsedAtoms[ap_ctx->parsedAtoms[rev_atom_loop].NextAtomNumber].AtomicLevel - 1) { //ilst with no child atoms; get here by erasing the last piece of iTunes style metadata
+            ap_ctx->parsedAtoms[rev_atom_loop].AtomicLength = 8;
         }
 
-        rev_atom_loop = APar_FindPrecedingAtom(parsedAtoms[rev_atom_loop].AtomicNumber);
+        rev_atom_loop = APar_FindPrecedingAtom(ap_ctx->parsedAtoms[rev_atom_loop].AtomicNumber);
 
     }
     APar_DetermineNewFileLength();
@@ -4656,62 +4719,62 @@ void APar_ValidateAtoms() {
     short iter = 0;
     uint64_t simple_tally = 0;
 
-    if (atom_number > MAX_ATOMS) {
+    if (ap_ctx->atom_number > MAX_ATOMS) {
         fprintf(stderr, "AtomicParsley error: amount of atoms exceeds internal limit. Aborting.\n");
         return;
     }
 
     while (true) {
         // there are valid atom names that are 0x00000001 - but I haven't seen them in MPEG-4 files, but they could show up, so this isn't a hard error
-        if (strlen(parsedAtoms[iter].AtomicName) < 4) {
+        if (strlen(ap_ctx->parsedAtoms[iter].AtomicName) < 4) {
             atom_name_with_4_characters = false;
         }
 
         //test for atoms that are going to be greater than out current file size; problem is we could be adding a 1MB pix to a 200k 3gp file; only fail for a file > 300k file; otherwise there would have to be more checks (like artwork present, but a zealous tagger could make moov.lengt > filzesize)
-        if (parsedAtoms[iter].AtomicLength > (uint32_t) file_size && file_size > 300000) {
-            if (parsedAtoms[iter].AtomicData == NULL) {
+        if (ap_ctx->parsedAtoms[iter].AtomicLength > (uint32_t) ap_ctx->file_size && ap_ctx->file_size > 300000) {
+            if (ap_ctx->parsedAtoms[iter].AtomicData == NULL) {
                 fprintf(stderr, "AtomicParsley error: an atom was detected that presents as larger than filesize. Aborting. %c\n", '\a');
 #if defined (_MSC_VER) /* apparently, long long is forbidden there*/
-                fprintf(stderr, "atom %s is %u bytes long which is greater than the filesize of %llu\n", parsedAtoms[iter].AtomicName, parsedAtoms[iter].AtomicLength, (long unsigned int)file_size);
+                fprintf(stderr, "atom %s is %u bytes long which is greater than the filesize of %llu\n", ap_ctx->parsedAtoms[iter].AtomicName, ap_ctx->parsedAtoms[iter].AtomicLength, (long unsigned int)ap_ctx->file_size);
 #else
-                fprintf(stderr, "atom %s is %u bytes long which is greater than the filesize of %llu\n", parsedAtoms[iter].AtomicName, parsedAtoms[iter].AtomicLength, (long long unsigned int) file_size);
+                fprintf(stderr, "atom %s is %u bytes long which is greater than the filesize of %llu\n", ap_ctx->parsedAtoms[iter].AtomicName, ap_ctx->parsedAtoms[iter].AtomicLength, (long long unsigned int) ap_ctx->file_size);
 #endif
                 return; //its conceivable to repair such an off length by the surrounding atoms constrained by file_size - just not anytime soon; probly would catch a foobar2000 0.9 tagged file
             }
         }
 
-        if (parsedAtoms[iter].AtomicLevel == 1) {
-            if (parsedAtoms[iter].AtomicLength == 0 && strncmp(parsedAtoms[iter].AtomicName, "mdat", 4) == 0) {
-                simple_tally = (uint64_t) file_size - parsedAtoms[iter].AtomicStart;
+        if (ap_ctx->parsedAtoms[iter].AtomicLevel == 1) {
+            if (ap_ctx->parsedAtoms[iter].AtomicLength == 0 && strncmp(ap_ctx->parsedAtoms[iter].AtomicName, "mdat", 4) == 0) {
+                simple_tally = (uint64_t) ap_ctx->file_size - ap_ctx->parsedAtoms[iter].AtomicStart;
             }
             else {
                 simple_tally +=
-                        parsedAtoms[iter].AtomicLength == 1 ? parsedAtoms[iter].AtomicLengthExtended : parsedAtoms[iter].AtomicLength;
+                        ap_ctx->parsedAtoms[iter].AtomicLength == 1 ? ap_ctx->parsedAtoms[iter].AtomicLengthExtended : ap_ctx->parsedAtoms[iter].AtomicLength;
             }
         }
 
-        if (strncmp(parsedAtoms[iter].AtomicName, "mdat", 4) == 0 && parsedAtoms[iter].AtomicLevel != 1) {
+        if (strncmp(ap_ctx->parsedAtoms[iter].AtomicName, "mdat", 4) == 0 && ap_ctx->parsedAtoms[iter].AtomicLevel != 1) {
             fprintf(stderr, "AtomicParsley error: mdat atom was found at an illegal (not at top level). Aborting. %c\n", '\a');
             return; //the error which forced this was some bad atom length redetermination; probably won't be fixed
         }
 
-        if (memcmp(parsedAtoms[iter].AtomicName, "trak", 4) == 0 && parsedAtoms[iter + 1].NextAtomNumber != 0) { //prevent writing any malformed tracks
-            if (memcmp(parsedAtoms[parsedAtoms[iter].NextAtomNumber].AtomicName, "tkhd", 4) != 0) {
+        if (memcmp(ap_ctx->parsedAtoms[iter].AtomicName, "trak", 4) == 0 && ap_ctx->parsedAtoms[iter + 1].NextAtomNumber != 0) { //prevent writing any malformed tracks
+            if (memcmp(ap_ctx->parsedAtoms[ap_ctx->parsedAtoms[iter].NextAtomNumber].AtomicName, "tkhd", 4) != 0) {
                 fprintf(stderr, "AtomicParsley error: incorrect track structure. %c\n", '\a');
                 return;
             }
         }
 
-        iter = parsedAtoms[iter].NextAtomNumber;
+        iter = ap_ctx->parsedAtoms[iter].NextAtomNumber;
         if (iter == 0) {
             break;
         }
     }
 
-    double perdiff = (float) ((float) ((uint32_t) simple_tally) * 100.0 / (double) (file_size - removed_bytes_tally));
+    double perdiff = (float) ((float) ((uint32_t) simple_tally) * 100.0 / (double) (ap_ctx->file_size - ap_ctx->removed_bytes_tally));
     int percentage_difference = (int) lroundf((float) perdiff);
 
-    if (percentage_difference < 90 && file_size > 300000) { //only kick in when files are over 300k & 90% of the size
+    if (percentage_difference < 90 && ap_ctx->file_size > 300000) { //only kick in when files are over 300k & 90% of the size
         fprintf(stderr, "AtomicParsley error: total existing atoms present as larger than filesize. Aborting. %c\n", '\a');
         //APar_PrintAtomicTree();
         fprintf(stdout, "%i %llu\n", percentage_difference, simple_tally);
@@ -4750,48 +4813,48 @@ void APar_TestTracksForKind() {
             APar_TrackInfo(total_tracks, track_num, codec_atom);
 
             //now test this trak's stsd codec against these 4cc codes:
-            switch(parsedAtoms[codec_atom].stsd_codec) {
+            switch(ap_ctx->parsedAtoms[codec_atom].stsd_codec) {
                 //video types
                 case 0x61766331 :// "avc1"
-                track_codecs.has_avc1 = true;
+                ap_ctx->track_codecs.has_avc1 = true;
                 break;
                 case 0x6D703476 :// "mp4v"
-                track_codecs.has_mp4v = true;
+                ap_ctx->track_codecs.has_mp4v = true;
                 break;
                 case 0x64726D69 :// "drmi"
-                track_codecs.has_drmi = true;
+                ap_ctx->track_codecs.has_drmi = true;
                 break;
 
                 //audio types
                 case 0x616C6163 :// "alac"
-                track_codecs.has_alac = true;
+                ap_ctx->track_codecs.has_alac = true;
                 break;
                 case 0x6D703461 :// "mp4a"
-                track_codecs.has_mp4a = true;
+                ap_ctx->track_codecs.has_mp4a = true;
                 break;
                 case 0x64726D73 :// "drms"
-                track_codecs.has_drms = true;
+                ap_ctx->track_codecs.has_drms = true;
                 break;
 
                 //podcast types
                 case 0x74657874 :// "text"
-                track_codecs.has_timed_text = true;
+                ap_ctx->track_codecs.has_timed_text = true;
                 break;
                 case 0x6A706567 :// "jpeg"
-                track_codecs.has_timed_jpeg = true;
+                ap_ctx->track_codecs.has_timed_jpeg = true;
                 break;
 
                 //either podcast type (audio-only) or a QT-unsupported video file with subtitles
                 case 0x74783367 :// "tx3g"
-                track_codecs.has_timed_tx3g = true;
+                ap_ctx->track_codecs.has_timed_tx3g = true;
                 break;
 
                 //other
                 case 0x6D703473 :// "mp4s"
-                track_codecs.has_mp4s = true;
+                ap_ctx->track_codecs.has_mp4s = true;
                 break;
                 case 0x72747020 :// "rtp "
-                track_codecs.has_rtp_hint = true;
+                ap_ctx->track_codecs.has_rtp_hint = true;
                 break;
             }
         }
@@ -4839,7 +4902,7 @@ void APar_DeriveNewPath(const char *filePath, char* temp_path, int output_type,
         memcpy(temp_path + strlen(temp_path), randstring, strlen(randstring));
     }
 
-    if (forced_suffix_type == FORCE_M4B_TYPE) {
+    if (ap_ctx->forced_suffix_type == FORCE_M4B_TYPE) {
         memcpy(temp_path + strlen(temp_path), ".m4b", 5);
     }
     else {
@@ -4865,8 +4928,8 @@ void APar_MetadataFileDump(const char* m4aFile) {
         if (dump_file != NULL) {
             //body of atom writing here
 
-            fseeko(source_file, userdata_atom->AtomicStart, SEEK_SET);
-            fread(dump_buffer, 1, (size_t) userdata_atom->AtomicLength, source_file);
+            fseeko(ap_ctx->source_file, userdata_atom->AtomicStart, SEEK_SET);
+            fread(dump_buffer, 1, (size_t) userdata_atom->AtomicLength, ap_ctx->source_file);
 
             fwrite(dump_buffer, (size_t) userdata_atom->AtomicLength, 1, dump_file);
             fclose(dump_file);
@@ -4885,37 +4948,37 @@ void APar_MetadataFileDump(const char* m4aFile) {
 }
 
 void APar_ShellProgressBar(uint32_t bytes_written) {
-    if (udta_dynamics.dynamic_updating) {
+    if (ap_ctx->udta_dynamics.dynamic_updating) {
         return;
     }
-    strcpy(file_progress_buffer, " Progress: ");
+    strcpy(ap_ctx->file_progress_buffer, " Progress: ");
 
-    double dispprog = (double) bytes_written / (double) new_file_size * 100.0 * ((double) max_display_width / 100.0);
+    double dispprog = (double) bytes_written / (double) ap_ctx->new_file_size * 100.0 * ((double) max_display_width / 100.0);
     int display_progress = (int) lroundf((float) dispprog);
-    double percomp = 100.0 * (double) ((double) bytes_written / (double) new_file_size);
+    double percomp = 100.0 * (double) ((double) bytes_written / (double) ap_ctx->new_file_size);
     int percentage_complete = (int) lroundf((float) percomp);
 
     for (int i = 0; i <= max_display_width; i++) {
         if (i < display_progress) {
-            strcat(file_progress_buffer, "=");
+            strcat(ap_ctx->file_progress_buffer, "=");
         }
         else if (i == display_progress) {
-            sprintf(file_progress_buffer, "%s>%d%%", file_progress_buffer, percentage_complete);
+            sprintf(ap_ctx->file_progress_buffer, "%s>%d%%", ap_ctx->file_progress_buffer, percentage_complete);
         }
         else {
-            strcat(file_progress_buffer, "-");
+            strcat(ap_ctx->file_progress_buffer, "-");
         }
     }
     if (percentage_complete < 100) {
-        strcat(file_progress_buffer, "-");
+        strcat(ap_ctx->file_progress_buffer, "-");
         if (percentage_complete < 10) {
-            strcat(file_progress_buffer, "-");
+            strcat(ap_ctx->file_progress_buffer, "-");
         }
     }
 
-    strcat(file_progress_buffer, "|");
+    strcat(ap_ctx->file_progress_buffer, "|");
 
-    fprintf(stdout, "%s\r", file_progress_buffer);
+    fprintf(stdout, "%s\r", ap_ctx->file_progress_buffer);
     fflush(stdout);
     return;
 }
@@ -4923,9 +4986,9 @@ void APar_ShellProgressBar(uint32_t bytes_written) {
 void APar_MergeTempFile(FILE* dest_file, FILE *src_file, uint32_t src_file_size, uint32_t dest_position, char* &buffer) {
     uint32_t file_pos = 0;
     while (file_pos <= src_file_size) {
-        if (file_pos + max_buffer <= src_file_size) {
+        if (file_pos + ap_ctx->max_buffer <= src_file_size) {
             fseeko(src_file, file_pos, SEEK_SET);
-            fread(buffer, 1, (size_t) max_buffer, src_file);
+            fread(buffer, 1, (size_t) ap_ctx->max_buffer, src_file);
 
             //fseek(dest_file, dest_position + file_pos, SEEK_SET);
 #if defined(_MSC_VER)
@@ -4938,8 +5001,8 @@ void APar_MergeTempFile(FILE* dest_file, FILE *src_file, uint32_t src_file_size,
             off_t file_offset = dest_position + file_pos;
 #endif
             fsetpos(dest_file, &file_offset);
-            fwrite(buffer, (size_t) max_buffer, 1, dest_file);
-            file_pos += max_buffer;
+            fwrite(buffer, (size_t) ap_ctx->max_buffer, 1, dest_file);
+            file_pos += ap_ctx->max_buffer;
 
         }
         else {
@@ -4966,53 +5029,53 @@ void APar_MergeTempFile(FILE* dest_file, FILE *src_file, uint32_t src_file_size,
 uint32_t APar_WriteAtomically(FILE* source_file, FILE* temp_file, bool from_file, char* &buffer, char* &conv_buffer, uint32_t bytes_written_tally, short this_atom) {
     uint32_t bytes_written = 0;
 
-    if (parsedAtoms[this_atom].AtomicLength > 1 && parsedAtoms[this_atom].AtomicLength < 8) { //prevents any spurious atoms from appearing
+    if (ap_ctx->parsedAtoms[this_atom].AtomicLength > 1 && ap_ctx->parsedAtoms[this_atom].AtomicLength < 8) { //prevents any spurious atoms from appearing
         return bytes_written;
     }
-    if (memcmp(parsedAtoms[this_atom].AtomicName, "free", 4) == 0
-            && (udta_dynamics.dynamic_updating || parsedAtoms[this_atom].AtomicLength == 0)) {
+    if (memcmp(ap_ctx->parsedAtoms[this_atom].AtomicName, "free", 4) == 0
+            && (ap_ctx->udta_dynamics.dynamic_updating || ap_ctx->parsedAtoms[this_atom].AtomicLength == 0)) {
         return bytes_written;
     }
 
     //write the length of the atom first... taken from our tree in memory
-    char4TOuint32(parsedAtoms[this_atom].AtomicLength, conv_buffer);
+    char4TOuint32(ap_ctx->parsedAtoms[this_atom].AtomicLength, conv_buffer);
     fseeko(temp_file, bytes_written_tally, SEEK_SET);
     fwrite(conv_buffer, 4, 1, temp_file);
     bytes_written += 4;
 
     //since we have already writen the length out to the file, it can be changed now with impunity
-    if (parsedAtoms[this_atom].AtomicLength == 0) { //the spec says if an atom has a length of 0, it extends to EOF
-        parsedAtoms[this_atom].AtomicLength = (uint32_t) file_size - parsedAtoms[this_atom].AtomicLength;
+    if (ap_ctx->parsedAtoms[this_atom].AtomicLength == 0) { //the spec says if an atom has a length of 0, it extends to EOF
+        ap_ctx->parsedAtoms[this_atom].AtomicLength = (uint32_t) ap_ctx->file_size - ap_ctx->parsedAtoms[this_atom].AtomicLength;
     }
-    else if (parsedAtoms[this_atom].AtomicLength == 1) {
+    else if (ap_ctx->parsedAtoms[this_atom].AtomicLength == 1) {
         //part of the pseudo 64-bit support
-        parsedAtoms[this_atom].AtomicLength = (uint32_t) parsedAtoms[this_atom].AtomicLengthExtended;
+        ap_ctx->parsedAtoms[this_atom].AtomicLength = (uint32_t) ap_ctx->parsedAtoms[this_atom].AtomicLengthExtended;
     }
 
     if (from_file) {
         // here we read in the original atom into the buffer. If the length is greater than our buffer length,
         // we loop, reading in chunks of the atom's data into the buffer, and immediately write it out, reusing the buffer.
 
-        while (bytes_written <= parsedAtoms[this_atom].AtomicLength) {
-            if (bytes_written + max_buffer <= parsedAtoms[this_atom].AtomicLength) {
+        while (bytes_written <= ap_ctx->parsedAtoms[this_atom].AtomicLength) {
+            if (bytes_written + ap_ctx->max_buffer <= ap_ctx->parsedAtoms[this_atom].AtomicLength) {
                 //read&write occurs from & including atom name through end of atom
-                fseeko(source_file, (bytes_written + parsedAtoms[this_atom].AtomicStart), SEEK_SET);
-                fread(buffer, 1, (size_t) max_buffer, source_file);
+                fseeko(source_file, (bytes_written + ap_ctx->parsedAtoms[this_atom].AtomicStart), SEEK_SET);
+                fread(buffer, 1, (size_t) ap_ctx->max_buffer, source_file);
 
                 fseeko(temp_file, (bytes_written_tally + bytes_written), SEEK_SET);
-                fwrite(buffer, (size_t) max_buffer, 1, temp_file);
-                bytes_written += max_buffer;
+                fwrite(buffer, (size_t) ap_ctx->max_buffer, 1, temp_file);
+                bytes_written += ap_ctx->max_buffer;
 
                 APar_ShellProgressBar(bytes_written_tally + bytes_written);
 
             }
             else { //we either came up on a short atom (most are), or the last bit of a really long atom
-                fseeko(source_file, (bytes_written + parsedAtoms[this_atom].AtomicStart), SEEK_SET);
-                fread(buffer, 1, (size_t) (parsedAtoms[this_atom].AtomicLength - bytes_written), source_file);
+                fseeko(source_file, (bytes_written + ap_ctx->parsedAtoms[this_atom].AtomicStart), SEEK_SET);
+                fread(buffer, 1, (size_t) (ap_ctx->parsedAtoms[this_atom].AtomicLength - bytes_written), source_file);
 
                 fseeko(temp_file, (bytes_written_tally + bytes_written), SEEK_SET);
-                fwrite(buffer, (size_t) (parsedAtoms[this_atom].AtomicLength - bytes_written), 1, temp_file);
-                bytes_written += parsedAtoms[this_atom].AtomicLength - bytes_written;
+                fwrite(buffer, (size_t) (ap_ctx->parsedAtoms[this_atom].AtomicLength - bytes_written), 1, temp_file);
+                bytes_written += ap_ctx->parsedAtoms[this_atom].AtomicLength - bytes_written;
 
                 APar_ShellProgressBar(bytes_written_tally + bytes_written);
 
@@ -5026,34 +5089,34 @@ uint32_t APar_WriteAtomically(FILE* source_file, FILE* temp_file, bool from_file
 
         fseeko(temp_file, (bytes_written_tally + bytes_written), SEEK_SET);
 
-        if (parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
+        if (ap_ctx->parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
             fwrite("uuid", 4, 1, temp_file);
             atom_name_len = 16; //total of 20 bytes for a uuid atom
         }
 
-        fwrite(parsedAtoms[this_atom].AtomicName, atom_name_len, 1, temp_file);
+        fwrite(ap_ctx->parsedAtoms[this_atom].AtomicName, atom_name_len, 1, temp_file);
         bytes_written += atom_name_len;
-        if (parsedAtoms[this_atom].AtomicClassification == VERSIONED_ATOM
-                || parsedAtoms[this_atom].AtomicClassification == PACKED_LANG_ATOM) {
-            char4TOuint32((uint32_t) parsedAtoms[this_atom].AtomicVerFlags, conv_buffer);
+        if (ap_ctx->parsedAtoms[this_atom].AtomicClassification == VERSIONED_ATOM
+                || ap_ctx->parsedAtoms[this_atom].AtomicClassification == PACKED_LANG_ATOM) {
+            char4TOuint32((uint32_t) ap_ctx->parsedAtoms[this_atom].AtomicVerFlags, conv_buffer);
             fwrite(conv_buffer, 4, 1, temp_file);
             bytes_written += 4;
         }
 
         uint32_t atom_data_size = 0;
-        switch (parsedAtoms[this_atom].AtomicContainerState) {
+        switch (ap_ctx->parsedAtoms[this_atom].AtomicContainerState) {
         case PARENT_ATOM:
         case SIMPLE_PARENT_ATOM: {
             atom_data_size = 0;
             break;
         }
         case DUAL_STATE_ATOM: {
-            switch (UInt32FromBigEndian(parsedAtoms[this_atom].AtomicName)) {
+            switch (UInt32FromBigEndian(ap_ctx->parsedAtoms[this_atom].AtomicName)) {
             case 0x6D657461: { //meta
                 break;
             }
             case 0x73747364: { //stsd
-                atom_data_size = parsedAtoms[this_atom].AtomicLength - 12;
+                atom_data_size = ap_ctx->parsedAtoms[this_atom].AtomicLength - 12;
                 break;
             }
                 //no need to accommodate 'schi' here because it only exists inside the monolithic (unparsed) 'stsd'; same for all the codecs under 'stsd'
@@ -5062,36 +5125,36 @@ uint32_t APar_WriteAtomically(FILE* source_file, FILE* temp_file, bool from_file
         }
         case UNKNOWN_ATOM_TYPE:
         case CHILD_ATOM: {
-            if (parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
+            if (ap_ctx->parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
                 //4bytes length, 4 bytes 'uuid', 4bytes name, 4bytes NULL (AP writes its own uuid atoms - not those copied - iTunes style with atom versioning)
-                atom_data_size = parsedAtoms[this_atom].AtomicLength - (16 + 12); //16 uuid; 16 = 4bytes * ('uuid', ap_uuid_name, verflag, 4 NULL bytes)
+                atom_data_size = ap_ctx->parsedAtoms[this_atom].AtomicLength - (16 + 12); //16 uuid; 16 = 4bytes * ('uuid', ap_uuid_name, verflag, 4 NULL bytes)
             }
-            else if (parsedAtoms[this_atom].AtomicClassification == VERSIONED_ATOM
-                    || parsedAtoms[this_atom].AtomicClassification == PACKED_LANG_ATOM) {
+            else if (ap_ctx->parsedAtoms[this_atom].AtomicClassification == VERSIONED_ATOM
+                    || ap_ctx->parsedAtoms[this_atom].AtomicClassification == PACKED_LANG_ATOM) {
                 //4bytes legnth, 4bytes name, 4bytes flag&versioning (language would be 2 bytes, but because its in different places, it gets stored as data)
-                atom_data_size = parsedAtoms[this_atom].AtomicLength - 12;
+                atom_data_size = ap_ctx->parsedAtoms[this_atom].AtomicLength - 12;
             }
             else {
                 //just 4bytes length, 4bytes name and then whatever data
-                atom_data_size = parsedAtoms[this_atom].AtomicLength - 8;
+                atom_data_size = ap_ctx->parsedAtoms[this_atom].AtomicLength - 8;
             }
             break;
         }
         }
 
-        if (parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
+        if (ap_ctx->parsedAtoms[this_atom].AtomicClassification == EXTENDED_ATOM) {
             //AP writes uuid atoms much like iTunes style metadata; with version/flags to connote what type of data is being carried
             //4bytes atom length, 4 bytes 'uuid', 16bytes uuidv5, 4bytes name of uuid in AP namespace, 4bytes versioning, 4bytes NULL, Xbytes data
-            fwrite(parsedAtoms[this_atom].uuid_ap_atomname, 4, 1, temp_file);
+            fwrite(ap_ctx->parsedAtoms[this_atom].uuid_ap_atomname, 4, 1, temp_file);
             bytes_written += 4;
 
-            char4TOuint32((uint32_t) parsedAtoms[this_atom].AtomicVerFlags, conv_buffer);
+            char4TOuint32((uint32_t) ap_ctx->parsedAtoms[this_atom].AtomicVerFlags, conv_buffer);
             fwrite(conv_buffer, 4, 1, temp_file);
             bytes_written += 4;
         }
 
         if (atom_data_size > 0) {
-            fwrite(parsedAtoms[this_atom].AtomicData, atom_data_size, 1, temp_file);
+            fwrite(ap_ctx->parsedAtoms[this_atom].AtomicData, atom_data_size, 1, temp_file);
             bytes_written += atom_data_size;
 
             APar_ShellProgressBar(bytes_written_tally + bytes_written);
@@ -5116,21 +5179,21 @@ uint32_t APar_WriteAtomically(FILE* source_file, FILE* temp_file, bool from_file
  ----------------------*/
 void APar_copy_gapless_padding(FILE* mp4file, uint32_t last_atom_pos, char* buffer) {
     uint32_t gapless_padding_bytes_written = 0;
-    while (gapless_padding_bytes_written < gapless_void_padding) {
-        if (gapless_padding_bytes_written + max_buffer <= gapless_void_padding) {
-            memset(buffer, 0, max_buffer);
+    while (gapless_padding_bytes_written < ap_ctx->gapless_void_padding) {
+        if (gapless_padding_bytes_written + ap_ctx->max_buffer <= ap_ctx->gapless_void_padding) {
+            memset(buffer, 0, ap_ctx->max_buffer);
 
             fseeko(mp4file, (last_atom_pos + gapless_padding_bytes_written), SEEK_SET);
-            fwrite(buffer, (size_t) max_buffer, 1, mp4file);
-            gapless_padding_bytes_written += max_buffer;
+            fwrite(buffer, (size_t) ap_ctx->max_buffer, 1, mp4file);
+            gapless_padding_bytes_written += ap_ctx->max_buffer;
 
         }
         else { //less then 512k of gapless padding (here's hoping we get here always)
-            memset(buffer, 0, (gapless_void_padding - gapless_padding_bytes_written));
+            memset(buffer, 0, (ap_ctx->gapless_void_padding - gapless_padding_bytes_written));
 
             fseeko(mp4file, (last_atom_pos + gapless_padding_bytes_written), SEEK_SET);
-            fwrite(buffer, (size_t) (gapless_void_padding - gapless_padding_bytes_written), 1, mp4file);
-            gapless_padding_bytes_written += (gapless_void_padding - gapless_padding_bytes_written);
+            fwrite(buffer, (size_t) (ap_ctx->gapless_void_padding - gapless_padding_bytes_written), 1, mp4file);
+            gapless_padding_bytes_written += (ap_ctx->gapless_void_padding - gapless_padding_bytes_written);
             break;
         }
     }
@@ -5139,7 +5202,7 @@ void APar_copy_gapless_padding(FILE* mp4file, uint32_t last_atom_pos, char* buff
 
 void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_original) {
     char* temp_file_name = (char*) malloc(sizeof(char) * 3500);
-    char* file_buffer = (char*) malloc(sizeof(char) * max_buffer + 1);
+    char* file_buffer = (char*) malloc(sizeof(char) * ap_ctx->max_buffer + 1);
     char* data = (char*) malloc(sizeof(char) * 4 + 1);
     FILE* temp_file;
     uint32_t temp_file_bytes_written = 0;
@@ -5147,18 +5210,18 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
     char* originating_file = NULL;
     bool free_modified_name = false;
     memset(temp_file_name, 0, sizeof(char) * 3500);
-    memset(file_buffer, 0, sizeof(char) * max_buffer + 1);
+    memset(file_buffer, 0, sizeof(char) * ap_ctx->max_buffer + 1);
     memset(data, 0, sizeof(char) * 4 + 1);
 
-    if (!complete_free_space_erasure) {
+    if (!ap_ctx->complete_free_space_erasure) {
         APar_DetermineDynamicUpdate(true); //test whether it can happen
     }
     else {
         APar_ForcePadding_sans_udta(); //force padding without the logistics of summing 'free' space & that overhead since all 'free' atoms were erased anyway
     }
 
-    if (!rewrite_original || prevent_update_using_padding) {
-        udta_dynamics.dynamic_updating = false;
+    if (!rewrite_original || ap_ctx->prevent_update_using_padding) {
+        ap_ctx->udta_dynamics.dynamic_updating = false;
     }
 
     APar_ValidateAtoms();
@@ -5166,7 +5229,7 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
     //whatever atoms/space comes before mdat has to be added/removed before this point, or chunk offsets (in stco, co64, tfhd) won't be properly determined
     uint32_t mdat_position = APar_DetermineMediaData_AtomPosition();
 
-    if (udta_dynamics.dynamic_updating) {
+    if (ap_ctx->udta_dynamics.dynamic_updating) {
         APar_DeriveNewPath(m4aFile, temp_file_name, -1, "-data-", NULL);
         temp_file = APar_OpenFile(temp_file_name, "wb");
 #if defined (_MSC_VER)
@@ -5197,7 +5260,7 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
         temp_file = APar_OpenFile(temp_file_name, "wb");
 
 #if defined (DARWIN_PLATFORM)
-        APar_SupplySelectiveTypeCreatorCodes(m4aFile, temp_file_name, forced_suffix_type); //provide type/creator codes for ".mp4" for randomly named temp files
+        APar_SupplySelectiveTypeCreatorCodes(m4aFile, temp_file_name, ap_ctx->forced_suffix_type); //provide type/creator codes for ".mp4" for randomly named temp files
 #endif
 
     }
@@ -5210,7 +5273,7 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
             temp_file = APar_OpenFile(temp_file_name, "wb");
 
 #if defined (DARWIN_PLATFORM)
-            APar_SupplySelectiveTypeCreatorCodes(m4aFile, temp_file_name, forced_suffix_type); //provide type/creator codes for ".mp4" for a fall-through randomly named temp files
+            APar_SupplySelectiveTypeCreatorCodes(m4aFile, temp_file_name, ap_ctx->forced_suffix_type); //provide type/creator codes for ".mp4" for a fall-through randomly named temp files
 #endif
 
         }
@@ -5218,7 +5281,7 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
             temp_file = APar_OpenFile(outfile, "wb");
 
 #if defined (DARWIN_PLATFORM)
-            APar_SupplySelectiveTypeCreatorCodes(m4aFile, outfile, forced_suffix_type); //provide type/creator codes for ".mp4" for a user-defined output file
+            APar_SupplySelectiveTypeCreatorCodes(m4aFile, outfile, ap_ctx->forced_suffix_type); //provide type/creator codes for ".mp4" for a user-defined output file
 #endif
 
         }
@@ -5227,8 +5290,8 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
     if (temp_file != NULL) {
         //body of atom writing here
 
-        if (udta_dynamics.dynamic_updating) { //dynamic updating will just start at udta and write out that hierarchy (minus any 'free' atoms); mdat doesn't move, so no stco/co64 changes. Possibly moov's length will change.
-            thisAtomNumber = udta_dynamics.udta_atom;
+        if (ap_ctx->udta_dynamics.dynamic_updating) { //dynamic updating will just start at udta and write out that hierarchy (minus any 'free' atoms); mdat doesn't move, so no stco/co64 changes. Possibly moov's length will change.
+            thisAtomNumber = ap_ctx->udta_dynamics.udta_atom;
             fprintf(stdout, "\n Updating metadata... ");
         }
         else {
@@ -5237,12 +5300,12 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
 
         while (true) {
 
-            AtomicInfo* thisAtom = &parsedAtoms[thisAtomNumber];
+            AtomicInfo* thisAtom = &ap_ctx->parsedAtoms[thisAtomNumber];
             if (thisAtom->AtomicNumber == -1)
                 break;
 
             //the loop where the critical determination is made
-            if (memcmp(thisAtom->AtomicName, "mdat", 4) == 0 && udta_dynamics.dynamic_updating)
+            if (memcmp(thisAtom->AtomicName, "mdat", 4) == 0 && ap_ctx->udta_dynamics.dynamic_updating)
                 break;
             //if (thisAtom->AtomicLevel == 1 && udta_dynamics.dynamic_updating) break; //TODO
 
@@ -5250,44 +5313,44 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
                 bool readjusted_stco = APar_Readjust_STCO_atom(mdat_position, thisAtomNumber);
 
                 temp_file_bytes_written +=
-                        APar_WriteAtomically(source_file, temp_file, !readjusted_stco, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
+                        APar_WriteAtomically(ap_ctx->source_file, temp_file, !readjusted_stco, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
 
             }
             else if (memcmp(thisAtom->AtomicName, "co64", 4) == 0) {
                 bool readjusted_co64 = APar_Readjust_CO64_atom(mdat_position, thisAtomNumber);
 
                 temp_file_bytes_written +=
-                        APar_WriteAtomically(source_file, temp_file, !readjusted_co64, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
+                        APar_WriteAtomically(ap_ctx->source_file, temp_file, !readjusted_co64, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
 
             }
             else if (memcmp(thisAtom->AtomicName, "tfhd", 4) == 0) {
                 bool readjusted_tfhd = APar_Readjust_TFHD_fragment_atom(mdat_position, thisAtomNumber);
 
                 temp_file_bytes_written +=
-                        APar_WriteAtomically(source_file, temp_file, !readjusted_tfhd, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
+                        APar_WriteAtomically(ap_ctx->source_file, temp_file, !readjusted_tfhd, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
 
             }
             else if (thisAtom->AtomicData != NULL || memcmp(thisAtom->AtomicName, "meta", 4) == 0) {
                 temp_file_bytes_written +=
-                        APar_WriteAtomically(source_file, temp_file, false, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
+                        APar_WriteAtomically(ap_ctx->source_file, temp_file, false, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
 
             }
             else {
                 //write out parent atoms (the standard kind that are only offset & name from the tree in memory (total: 8bytes)
                 if (thisAtom->AtomicContainerState <= SIMPLE_PARENT_ATOM) {
                     temp_file_bytes_written +=
-                            APar_WriteAtomically(source_file, temp_file, false, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
+                            APar_WriteAtomically(ap_ctx->source_file, temp_file, false, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
                     //or its a child (they invariably contain some sort of data.
                 }
                 else {
                     temp_file_bytes_written +=
-                            APar_WriteAtomically(source_file, temp_file, true, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
+                            APar_WriteAtomically(ap_ctx->source_file, temp_file, true, file_buffer, data, temp_file_bytes_written, thisAtomNumber);
                 }
             }
             if (thisAtom->NextAtomNumber == 0) { //if (parsedAtoms[thisAtomNumber].NextAtomNumber == 0) {
                 break;
             }
-            if (udta_dynamics.dynamic_updating && thisAtomNumber == udta_dynamics.last_udta_child_atom) {
+            if (ap_ctx->udta_dynamics.dynamic_updating && thisAtomNumber == ap_ctx->udta_dynamics.last_udta_child_atom) {
                 break; //exit writing out atoms if doing a dynamic update in situ - only the full 'udta' hierarchy will be written out
             }
 
@@ -5295,8 +5358,8 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
             thisAtom->AtomicNumber = -1;
             thisAtomNumber = thisAtom->NextAtomNumber;
         }
-        if (!udta_dynamics.dynamic_updating) {
-            if (gapless_void_padding > 0 && pad_prefs.default_padding_size > 0) { //only when some sort of padding is wanted will the gapless null padding be copied
+        if (!ap_ctx->udta_dynamics.dynamic_updating) {
+            if (ap_ctx->gapless_void_padding > 0 && ap_ctx->pad_prefs.default_padding_size > 0) { //only when some sort of padding is wanted will the gapless null padding be copied
                 APar_copy_gapless_padding(temp_file, temp_file_bytes_written, file_buffer);
             }
             fprintf(stdout, "\n Finished writing to temp file.\n");
@@ -5309,48 +5372,48 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
         return;
     }
 
-    if (udta_dynamics.dynamic_updating) {
+    if (ap_ctx->udta_dynamics.dynamic_updating) {
         //copy file into buffer (cyclicly as needed), write into orig file (check for lock status); write a free_padding_size, 'free' & nulls for free_padding_size - 8
         fclose(temp_file);
         temp_file = APar_OpenFile(temp_file_name, "rb");
-        fclose(source_file);
-        source_file = APar_OpenFile(m4aFile, "r+b"); //source_file = APar_OpenFile(m4aFile, "r+");
-        if (source_file == NULL) {
+        fclose(ap_ctx->source_file);
+        ap_ctx->source_file = APar_OpenFile(m4aFile, "r+b"); //source_file = APar_OpenFile(m4aFile, "r+");
+        if (ap_ctx->source_file == NULL) {
             fclose(temp_file);
             remove(temp_file_name);
             return;
         }
 
         //update moov's length
-        char4TOuint32(parsedAtoms[udta_dynamics.moov_atom].AtomicLength, twenty_byte_buffer);
-        fseeko(source_file, parsedAtoms[udta_dynamics.moov_atom].AtomicStart, SEEK_SET);
-        fwrite(twenty_byte_buffer, 4, 1, source_file);
+        char4TOuint32(ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.moov_atom].AtomicLength, ap_ctx->twenty_byte_buffer);
+        fseeko(ap_ctx->source_file, ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.moov_atom].AtomicStart, SEEK_SET);
+        fwrite(ap_ctx->twenty_byte_buffer, 4, 1, ap_ctx->source_file);
 
         //pesky (psp only) files that don't even have 'udta' in them, force appending after file length
-        if (parsedAtoms[udta_dynamics.udta_atom].AtomicStart == 0 && psp_brand) {
-            parsedAtoms[udta_dynamics.udta_atom].AtomicStart = file_size;
+        if (ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.udta_atom].AtomicStart == 0 && ap_ctx->psp_brand) {
+            ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.udta_atom].AtomicStart = ap_ctx->file_size;
         }
 
-        APar_MergeTempFile(source_file, temp_file, temp_file_bytes_written, parsedAtoms[udta_dynamics.udta_atom].AtomicStart, file_buffer);
+        APar_MergeTempFile(ap_ctx->source_file, temp_file, temp_file_bytes_written, ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.udta_atom].AtomicStart, file_buffer);
 
-        if (!psp_brand) {
+        if (!ap_ctx->psp_brand) {
             //psp files with no 'udta' atom will have whacked free_padding_size - which isn't required at EOF in any event
-            fseeko(source_file, parsedAtoms[udta_dynamics.udta_atom].AtomicStart + temp_file_bytes_written, SEEK_SET);
+            fseeko(ap_ctx->source_file, ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.udta_atom].AtomicStart + temp_file_bytes_written, SEEK_SET);
 
-            uint32_t free_padding_size = parsedAtoms[udta_dynamics.first_postfree_level1_atom].AtomicStart
-                    - (parsedAtoms[udta_dynamics.udta_atom].AtomicStart + temp_file_bytes_written);
+            uint32_t free_padding_size = ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.first_postfree_level1_atom].AtomicStart
+                    - (ap_ctx->parsedAtoms[ap_ctx->udta_dynamics.udta_atom].AtomicStart + temp_file_bytes_written);
 
             if (free_padding_size >= 8) {
-                char4TOuint32(free_padding_size, twenty_byte_buffer);
-                fwrite(twenty_byte_buffer, 4, 1, source_file);
-                fwrite("free", 4, 1, source_file);
-                memset(file_buffer, 0, max_buffer);
-                fwrite(file_buffer, 1, free_padding_size - 8, source_file);
+                char4TOuint32(free_padding_size, ap_ctx->twenty_byte_buffer);
+                fwrite(ap_ctx->twenty_byte_buffer, 4, 1, ap_ctx->source_file);
+                fwrite("free", 4, 1, ap_ctx->source_file);
+                memset(file_buffer, 0, ap_ctx->max_buffer);
+                fwrite(file_buffer, 1, free_padding_size - 8, ap_ctx->source_file);
             }
         }
 
-        fclose(source_file);
-        file_opened = false;
+        fclose(ap_ctx->source_file);
+        ap_ctx->file_opened = false;
 
         fclose(temp_file);
         remove(temp_file_name);
@@ -5358,8 +5421,8 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
 
     }
     else if (rewrite_original && !outfile) { //disable overWrite when writing out to a specifically named file; presumably the enumerated output file was meant to be the final destination
-        fclose(source_file);
-        file_opened = false;
+        fclose(ap_ctx->source_file);
+        ap_ctx->file_opened = false;
 
         if (IsUnicodeWinOS() && UnicodeOutputStatus == WIN32_UTF16) {
 #if defined (_MSC_VER) /* native windows seems to require removing the file first; rename() on Mac OS X does the removing automatically as needed */
@@ -5377,10 +5440,10 @@ void APar_WriteFile(const char* m4aFile, const char* outfile, bool rewrite_origi
 
         int err = 0;
 
-        if (forced_suffix_type != NO_TYPE_FORCING) {
+        if (ap_ctx->forced_suffix_type != NO_TYPE_FORCING) {
             originating_file = (char*) calloc(1, sizeof(char) * 3500);
             free_modified_name = true;
-            if (forced_suffix_type == FORCE_M4B_TYPE) { //using --stik Audiobook with --overWrite will change the original file's extension
+            if (ap_ctx->forced_suffix_type == FORCE_M4B_TYPE) { //using --stik Audiobook with --overWrite will change the original file's extension
                 uint16_t filename_len = strlen(m4aFile);
                 const char* suffix = strrchr(m4aFile, '.');
                 memcpy(originating_file, m4aFile, filename_len + 1);
@@ -211,19 +211,85 @@ enum {
 #define MAX_ATOMS 1024
 #define MAXDATA_PAYLOAD 1256
 
-#define DEFAULT_PADDING_LENGTH          2048;
-#define MINIMUM_REQUIRED_PADDING_LENGTH 0;
-#define MAXIMUM_REQUIRED_PADDING_LENGTH 5000;
+#define DEFAULT_PADDING_LENGTH          2048
+#define MINIMUM_REQUIRED_PADDING_LENGTH 0
+#define MAXIMUM_REQUIRED_PADDING_LENGTH 5000
 
 //==========================================================//
 
-extern int metadata_style;
+#if defined (_MSC_VER)
+#define AP_THREAD_LOCAL __declspec(thread)
+#else
+#define AP_THREAD_LOCAL __thread
+#endif
+
+// The state of the file being parsed/written. Every thread works on
+// the context attached with APar_AttachContext(), so several files can
+// be processed at the same time as long as each thread has its own.
+struct AtomicContext {
+    bool inited;
+
+    int metadata_style;
+    uint32_t mdatData; //used in bitrate calcs
+
+    // (most I've seen is 144 for an untagged mp4)
+    AtomicInfo parsedAtoms[MAX_ATOMS];
+
+    bool modified_atoms;
+    bool alter_original;
+
+    FILE* source_file;
+    uint32_t file_size;
+
+    short atom_number;
+    uint8_t generalAtomicLevel;
+
+    bool file_opened;
+    bool parsedfile;
+    bool move_moov_atom;
+    bool moov_atom_was_mooved;
+    AtomicInfo* hdlrAtom;
+    AtomicInfo* udtaAtom;
+    bool complete_free_space_erasure;
+    bool initial_optimize_pass;
+    bool psp_brand;
+    bool prevent_update_using_padding;
+    bool tree_display_only;
+
+    uint32_t max_buffer;
 
-//now global, used in bitrate calcs
-extern uint32_t mdatData;
+    uint32_t bytes_before_mdat;
+    uint32_t bytes_into_mdat;
+    uint64_t mdat_supplemental_offset;
+    uint32_t removed_bytes_tally;
+    uint32_t new_file_size; //used for the progressbar
+    uint32_t brand;
 
-// (most I've seen is 144 for an untagged mp4)
-extern AtomicInfo parsedAtoms[MAX_ATOMS];
+    uint32_t gapless_void_padding; //possibly used in the context of gapless playback support by Apple
+
+    struct udta_stats udta_dynamics;
+    struct padding_preferences pad_prefs;
+
+    bool contains_unsupported_64_bit_atom; //reminder that there are some 64-bit files that aren't yet supported (and where that limit is set)
+
+    char* file_progress_buffer;
+
+    struct PicPrefs myPicturePrefs;
+    bool parsed_prefs;
+    char* twenty_byte_buffer;
+
+    EmployedCodecs track_codecs;
+
+    uint8_t forced_suffix_type;
+
+    bool passed_mdat; //APar_AtomizeFileInfo
+
+    bool tfhd_changed; //APar_Readjust_TFHD_fragment_atom
+    bool tfhd_determined_offset;
+    uint64_t tfhd_base_offset;
+};
+
+extern AP_THREAD_LOCAL AtomicContext *ap_ctx;
 
 //--------------------------------------------------------------------------------------------------------------------------------//
 //--------------------------------------------------------------------------------------------------------------------------------//
@@ -237,11 +303,16 @@ FILE* openSomeFile(const char* file, bool open);
 void TestFileExistence(const char *filePath, bool errorOut);
 uint32_t APar_ReadFile(char* destination_buffer, FILE* a_file, uint32_t bytes_to_read);
 
+AtomicContext* APar_NewContext();
+void APar_FreeContext(AtomicContext* context);
+AtomicContext* APar_AttachContext(AtomicContext* context);
+
 void APar_FreeMemory();
 
 AtomicInfo* APar_FindAtom(const char* atom_name, bool createMissing, uint8_t atom_type, uint16_t atom_lang, bool match_full_uuids =
         false);
 char* APar_ExtractDataAtom(int this_atom_number);
+char* APar_ExtractAAC_ArtworkData(short this_atom_num, uint32_t* image_len);
 char* APar_ExtractAAC_Artwork(short this_atom_num, char* pic_output_path, short artwork_count);
 
 #if defined (_MSC_VER)
@@ -263,6 +334,8 @@ void APar_atom_Binary_Put(short atom_num, const char* binary_data, uint32_t byte
 
 /* iTunes-style metadata */
 void APar_MetaData_atomArtwork_Set(const char* artworkPath, char* env_PicOptions);
+bool APar_MetaData_atomArtwork_SetData(const char* image_data, uint32_t image_len);
+int APar_TestArtworkBinaryBuffer(const char* pic_data, uint32_t pic_len);
 void APar_MetaData_atomGenre_Set(const char* atomPayload);
 void APar_MetaData_atom_QuickInit(short atom_num, const uint32_t atomFlags, uint32_t supplemental_length, uint32_t allotment =
         MAXDATA_PAYLOAD + 1);
@@ -80,6 +80,13 @@ extern "C" {
 #define SORT_ALBUM "soal"
 #define SORT_TV_SHOW "sosn"
 
+/* Free space reserved in front of mdat whenever a file has to be
+ * rewritten, so that later tag edits fit into it and the file can be
+ * updated in place instead of being copied. */
+#define PADDING_DEFAULT (32 * 1024)
+/* Padding above this is considered wasted and trimmed on rewrite */
+#define PADDING_MAXIMUM (1024 * 1024)
+
 static guint32 mediaTypeTagToMediaType(guint8 media_type) {
     switch (media_type) {
     case 0: /* Movie */
@@ -122,6 +129,29 @@ static guint8 mediaTypeToMediaTypeTag(guint32 media_type) {
     return 0;
 }
 
+/*
+ * Every AP_* function parses its file into a fresh AtomicContext which
+ * is attached to the calling thread for the duration of the call, so
+ * tags of different files can be read and written from several
+ * threads at once.
+ */
+class ContextScope {
+public:
+    ContextScope() {
+        context = APar_NewContext();
+        previous = APar_AttachContext(context);
+    }
+
+    ~ContextScope() {
+        APar_AttachContext(previous);
+        APar_FreeContext(context);
+    }
+
+private:
+    AtomicContext *context;
+    AtomicContext *previous;
+};
+
 static AtomicInfo *find_atom(const char *meta) {
     char atomName[100];
 
@@ -151,6 +181,7 @@ void AP_read_metadata(const char *filePath, Track *track) {
     gboolean audio_or_video_found = FALSE;
     gboolean has_quicktime_chaps = FALSE;
     uint32_t timescale = 0;
+    ContextScope scope;
 
     APar_ScanAtoms(filePath, true);
     mp4File = openSomeFile(filePath, true);
@@ -541,30 +572,19 @@ void AP_read_metadata(const char *filePath, Track *track) {
         }
 
         if (prefs_get_int("coverart_apic")) {
-            gchar *tmp_file_prefix = g_build_filename(g_get_tmp_dir(), "ttt", NULL);
-            gchar *tmp_file;
-
-            AtomicInfo *info = find_atom("covr");
+            AtomicInfo *info = find_atom(ARTWORK);
             if (info) {
-
-                // Extract the data to a temporary file
-                tmp_file = APar_ExtractAAC_Artwork(info->AtomicNumber, tmp_file_prefix, 1);
-                g_free(tmp_file_prefix);
-
-                if (tmp_file && g_file_test(tmp_file, G_FILE_TEST_EXISTS)) {
-
-                    // Set the thumbnail using the tmp file
-                    GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file(tmp_file, NULL);
-                    if (pixbuf) {
-                        itdb_track_set_thumbnails_from_pixbuf(track, pixbuf);
-                        g_object_unref(pixbuf);
+                uint32_t image_len;
+                char *image_data = APar_ExtractAAC_ArtworkData(info->AtomicNumber, &image_len);
+
+                if (image_data) {
+                    // Hand the embedded picture to libgpod as it is
+                    if (gp_track_set_thumbnails_from_data(track, (guchar *) image_data, image_len)) {
+                        ExtraTrackData *etr = (ExtraTrackData *) track->userdata;
+                        etr->artwork_from_file = TRUE;
                     }
-
-                    g_remove(tmp_file);
+                    free(image_data);
                 }
-
-                if (tmp_file)
-                    g_free(tmp_file);
             }
         }
     }
@@ -577,6 +597,8 @@ void AP_read_metadata(const char *filePath, Track *track) {
  * Read any lyrics from the given file
  */
 char *AP_read_lyrics(const char *filePath, GError **error) {
+    ContextScope scope;
+
     APar_ScanAtoms(filePath, true);
     openSomeFile(filePath, true);
 
@@ -601,6 +623,8 @@ static void write_lyrics_internal(const char* lyrics, const char *filePath, GErr
 }
 
 void AP_write_lyrics(const char *lyrics, const char *filePath, GError **error) {
+    ContextScope scope;
+
     APar_ScanAtoms(filePath);
     write_lyrics_internal(lyrics, filePath, error);
 }
@@ -618,6 +642,56 @@ static void set_limited_text_atom_value(const char *meta, const char *value) {
     }
 }
 
+/*
+ * Replace the artwork of the scanned file with the thumbnail of
+ * @track.
+ *
+ * The picture is embedded straight from memory, preferring the
+ * original image bytes over encoding the thumbnail again: the image
+ * file the thumbnail was set from if it is a jpeg or png, or else the
+ * picture already embedded in the file if the thumbnail was read from
+ * it and has not been changed since. Otherwise the thumbnail is
+ * encoded as jpeg, or the artwork removed if there is none.
+ */
+static gboolean set_artwork(Track *track) {
+    ExtraTrackData *etr = (ExtraTrackData *) track->userdata;
+    gchar *image_data = NULL;
+    gsize image_len = 0;
+    gboolean result;
+
+    if (etr && etr->thumb_path_locale && *etr->thumb_path_locale) {
+        if (!g_file_get_contents(etr->thumb_path_locale, &image_data, &image_len, NULL)
+                || (image_len > G_MAXUINT32)
+                || (APar_TestArtworkBinaryBuffer(image_data, (uint32_t) image_len) == -1)) {
+            g_free(image_data);
+            image_data = NULL;
+        }
+    }
+    else if (etr && etr->artwork_from_file && itdb_track_has_thumbnails(track) && find_atom(ARTWORK)) {
+        // The thumbnail is the embedded picture -- keep it untouched
+        return TRUE;
+    }
+
+    if (!image_data) {
+        GdkPixbuf *pixbuf = (GdkPixbuf*) itdb_artwork_get_pixbuf(track->itdb->device, track->artwork, -1, -1);
+        if (!pixbuf) {
+            // Destroy any existing artwork if any
+            APar_MetaData_atomArtwork_Set("REMOVE_ALL", NULL);
+            return TRUE;
+        }
+
+        result = gdk_pixbuf_save_to_buffer(pixbuf, &image_data, &image_len, "jpeg", NULL, "quality", "100", NULL);
+        g_object_unref(pixbuf);
+        if (!result)
+            return FALSE;
+    }
+
+    APar_MetaData_atomArtwork_Set("REMOVE_ALL", NULL);
+    result = APar_MetaData_atomArtwork_SetData(image_data, (uint32_t) image_len);
+    g_free(image_data);
+    return result;
+}
+
 /**
  * Using the given track, set the metadata of the target
  * file
@@ -629,15 +703,21 @@ void AP_write_metadata(Track *track, const char *filePath, GError **error) {
 
     g_return_if_fail(track);
 
+    ContextScope scope;
+
     APar_ScanAtoms(filePath);
 
-    if (metadata_style != ITUNES_STYLE) {
+    if (ap_ctx->metadata_style != ITUNES_STYLE) {
         gchar *fbuf = charset_to_utf8(filePath);
         gtkpod_log_error(error, g_strdup_printf(_("ERROR %s is not itunes style."), fbuf));
         g_free(fbuf);
         return;
     }
 
+    ap_ctx->pad_prefs.default_padding_size = PADDING_DEFAULT;
+    ap_ctx->pad_prefs.minimum_required_padding_size = 0;
+    ap_ctx->pad_prefs.maximum_present_padding_size = PADDING_MAXIMUM;
+
     // Title
     set_limited_text_atom_value(TITLE, track->title);
 
@@ -834,29 +914,13 @@ void AP_write_metadata(Track *track, const char *filePath, GError **error) {
     set_limited_text_atom_value(SORT_TV_SHOW, track->sort_tvshow);
 
     if (prefs_get_int("coverart_apic")) {
-        GdkPixbuf *pixbuf = (GdkPixbuf*) itdb_artwork_get_pixbuf(track->itdb->device, track->artwork, -1, -1);
-        if (!pixbuf) {
+        if (!itdb_track_has_thumbnails(track)) {
             // Destroy any existing artwork if any
             APar_MetaData_atomArtwork_Set("REMOVE_ALL", NULL);
         }
-        else {
-            gchar *tmp_file = g_build_filename(g_get_tmp_dir(), "ttt.jpg", NULL);
-            GError *pixbuf_err = NULL;
-
-            gdk_pixbuf_save(pixbuf, tmp_file, "jpeg", &pixbuf_err, "quality", "100", NULL);
-
-            if (!pixbuf_err) {
-                APar_MetaData_atomArtwork_Set(tmp_file, NULL);
-                g_remove(tmp_file);
-            }
-            else {
-                gtkpod_log_error(error, g_strdup_printf(_("ERROR failed to change track file's artwork.") ));
-                g_error_free(pixbuf_err);
-                return;
-            }
-
-            g_free(tmp_file);
-            g_object_unref(pixbuf);
+        else if (!set_artwork(track)) {
+            gtkpod_log_error(error, g_strdup_printf(_("ERROR failed to change track file's artwork.") ));
+            return;
         }
     }
 
@@ -323,7 +323,7 @@ void album_model_foreach (AlbumModel *model, AMFunc func, gpointer user_data) {
     }
 }
 
-void album_model_init_coverart(AlbumModel *model, AlbumItem *item) {
+void album_model_init_coverart(AlbumModel *model, AlbumItem *item, ThumbnailCacheFunc func, gpointer user_data) {
     g_return_if_fail(item);
 
     Track *track = g_list_nth_data(item->tracks, 0);
@@ -333,7 +333,7 @@ void album_model_init_coverart(AlbumModel *model, AlbumItem *item) {
         item->albumart = NULL;
     }
 
-    item->albumart = clarity_util_get_track_image(track);
+    item->albumart = clarity_util_get_track_image(track, func, user_data);
 }
 
 AlbumItem *album_model_get_item_with_index(AlbumModel *model, gint index) {
@@ -351,7 +351,10 @@ AlbumItem *album_model_get_item_with_track(AlbumModel *model, Track *track) {
     AlbumModelPrivate *priv = ALBUM_MODEL_GET_PRIVATE (model);
 
     gchar *album_key = _create_key_from_track(track);
-    return g_hash_table_lookup(priv->album_hash, album_key);
+    AlbumItem *item = g_hash_table_lookup(priv->album_hash, album_key);
+    g_free(album_key);
+
+    return item;
 }
 
 static gint _get_index(AlbumModelPrivate *priv, gchar *trk_key) {
@@ -31,6 +31,7 @@
 
 #include <gtk/gtk.h>
 #include "libgtkpod/itdb.h"
+#include "libgtkpod/thumbnail_cache.h"
 
 
 G_BEGIN_DECLS
@@ -105,7 +106,11 @@ gboolean album_model_add_track(AlbumModel *model, Track *track);
  */
 gboolean album_model_remove_track(AlbumModel *model, AlbumItem *item, Track *track);
 
-void album_model_init_coverart(AlbumModel *model, AlbumItem *item);
+/**
+ * Set the albumart of the item to the artwork of its first track, or
+ * to the default image until @func is called with the artwork.
+ */
+void album_model_init_coverart(AlbumModel *model, AlbumItem *item, ThumbnailCacheFunc func, gpointer user_data);
 
 AlbumItem *album_model_get_item_with_index(AlbumModel *model, gint index);
 
@@ -77,9 +77,13 @@ enum DIRECTION {
     MOVE_RIGHT = 1
 };
 
+static void _on_thumbnail_loaded(Track *track, GdkPixbuf *pixbuf, gpointer user_data);
+
 static void clarity_canvas_finalize(GObject *gobject) {
     ClarityCanvasPrivate *priv = CLARITY_CANVAS(gobject)->priv;
 
+    thumbnail_cache_cancel(_on_thumbnail_loaded, gobject);
+
     //FIXME
 //    g_list_free_full(priv->covers, clarity_cover_destroy);
 
@@ -401,6 +405,8 @@ void clarity_canvas_clear(ClarityCanvas *self) {
     g_return_if_fail(self);
     ClarityCanvasPrivate *priv = CLARITY_CANVAS_GET_PRIVATE(self);
 
+    thumbnail_cache_cancel(_on_thumbnail_loaded, self);
+
     if (CLUTTER_IS_ACTOR(priv->container)) {
         GList *iter = priv->covers;
         while(iter) {
@@ -593,7 +599,7 @@ void _init_album_item(gpointer value, gint index, gpointer user_data) {
     ClarityCanvas *self = CLARITY_CANVAS(user_data);
     ClarityCanvasPrivate *priv = CLARITY_CANVAS_GET_PRIVATE(self);
 
-    album_model_init_coverart(priv->model, item);
+    album_model_init_coverart(priv->model, item, _on_thumbnail_loaded, self);
 
     clarity_canvas_block_change(self, TRUE);
     _create_cover_actors(priv, item, index);
@@ -855,11 +861,13 @@ void clarity_canvas_update(ClarityCanvas *self, AlbumItem *item) {
 
     clarity_canvas_block_change(self, TRUE);
 
-    album_model_init_coverart(priv->model, item);
+    album_model_init_coverart(priv->model, item, _on_thumbnail_loaded, self);
 
     ClarityCover *ccover = (ClarityCover *) g_list_nth_data(priv->covers, index);
-    if (!ccover)
+    if (!ccover) {
+        clarity_canvas_block_change(self, FALSE);
         return;
+    }
 
     clarity_cover_set_album_item(ccover, item);
 
@@ -870,6 +878,24 @@ void clarity_canvas_update(ClarityCanvas *self, AlbumItem *item) {
     clarity_canvas_block_change(self, FALSE);
 }
 
+/*
+ * Called by the thumbnail cache once the artwork of an album's track
+ * has been decoded, replacing the default image shown meanwhile.
+ */
+static void _on_thumbnail_loaded(Track *track, GdkPixbuf *pixbuf, gpointer user_data) {
+    ClarityCanvas *self = CLARITY_CANVAS(user_data);
+    ClarityCanvasPrivate *priv = CLARITY_CANVAS_GET_PRIVATE(self);
+
+    if (!pixbuf || !priv->model)
+        return;
+
+    AlbumItem *item = album_model_get_item_with_track(priv->model, track);
+    if (!item || g_list_index(item->tracks, track) != 0)
+        return;
+
+    clarity_canvas_update(self, item);
+}
+
 static void _set_cover_from_file(ClarityCanvas *self) {
     g_return_if_fail(self);
 
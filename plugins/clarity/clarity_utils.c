@@ -57,16 +57,14 @@ GdkPixbuf *clarity_util_get_default_track_image(gint default_img_size) {
     return scaled;
 }
 
-GdkPixbuf *clarity_util_get_track_image(Track *track) {
+GdkPixbuf *clarity_util_get_track_image(Track *track, ThumbnailCacheFunc func, gpointer user_data) {
     GdkPixbuf *pixbuf = NULL;
     ExtraTrackData *etd;
 
     etd = track->userdata;
     g_return_val_if_fail(etd, NULL);
 
-    if (itdb_track_has_thumbnails(track)) {
-        pixbuf = itdb_track_get_thumbnail(track, DEFAULT_IMG_SIZE, DEFAULT_IMG_SIZE);
-    }
+    pixbuf = thumbnail_cache_get(track, DEFAULT_IMG_SIZE, func, user_data);
 
     if (!pixbuf) {
         /* Could not get a viable thumbnail so get default pixbuf */
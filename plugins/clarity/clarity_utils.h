@@ -31,6 +31,7 @@
 
 #include <gtk/gtk.h>
 #include "libgtkpod/gp_itdb.h"
+#include "libgtkpod/thumbnail_cache.h"
 
 #define DEFAULT_COVER_ICON "clarity-default-cover"
 #define DEFAULT_COVER_ICON_STOCK_ID "clarity-default-cover-icon"
@@ -51,10 +52,13 @@ GdkPixbuf *clarity_util_get_default_track_image(gint default_img_size);
  *
  * Retrieve the artwork pixbuf from the given track.
  *
+ * If the artwork has not been decoded yet, the default image is
+ * returned and @func is called once the artwork is available.
+ *
  * Returns:
  * pixbuf of the artwork of the track.
  */
-GdkPixbuf *clarity_util_get_track_image(Track *track);
+GdkPixbuf *clarity_util_get_track_image(Track *track, ThumbnailCacheFunc func, gpointer user_data);
 
 /**
  * clarity_util_update_coverart
@@ -621,20 +621,31 @@ void clarity_widget_tracks_selected_cb(GtkPodApp *app, gpointer tks, gpointer da
     _clarity_widget_select_tracks(cw, tracks);
 }
 
-static void _add_track(ClarityWidgetPrivate *priv, Track *track) {
-    g_return_if_fail(priv->draw_area);
-    g_return_if_fail(priv->album_model);
+/**
+ * Add the track to the album model and the canvas. Returns TRUE if
+ * a new album item was created and the slider range needs updating.
+ */
+static gboolean _add_track_item(ClarityWidgetPrivate *priv, Track *track) {
+    g_return_val_if_fail(priv->draw_area, FALSE);
+    g_return_val_if_fail(priv->album_model, FALSE);
 
     ClarityCanvas *ccanvas = CLARITY_CANVAS(priv->draw_area);
 
     if (clarity_canvas_is_blocked(ccanvas))
-        return;
+        return FALSE;
 
     if (album_model_add_track(priv->album_model, track)) {
         AlbumItem *item = album_model_get_item_with_track(priv->album_model, track);
         clarity_canvas_add_album_item(CLARITY_CANVAS(priv->draw_area), item);
-        _init_slider_range(priv);
+        return TRUE;
     }
+
+    return FALSE;
+}
+
+static void _add_track(ClarityWidgetPrivate *priv, Track *track) {
+    if (_add_track_item(priv, track))
+        _init_slider_range(priv);
 }
 
 void clarity_widget_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data) {
@@ -659,6 +670,42 @@ void clarity_widget_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data) {
     _add_track(priv, track);
 }
 
+void clarity_widget_tracks_added_cb(GtkPodApp *app, gpointer tks, gpointer data) {
+    g_return_if_fail(CLARITY_IS_WIDGET(data));
+
+    ClarityWidget *cw = CLARITY_WIDGET(data);
+    ClarityWidgetPrivate *priv = CLARITY_WIDGET_GET_PRIVATE(cw);
+    GList *tracks = tks;
+    GHashTable *added;
+    GList *gl;
+    gboolean new_items = FALSE;
+
+    if (!tracks)
+        return;
+
+    if (! gtk_widget_get_realized(GTK_WIDGET(cw)))
+        return;
+
+    if (!cw->current_playlist)
+        return;
+
+    /* Walk the playlist once rather than searching it for each track */
+    added = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (gl = tracks; gl; gl = gl->next)
+        g_hash_table_insert(added, gl->data, gl->data);
+
+    for (gl = cw->current_playlist->members; gl; gl = gl->next) {
+        Track *track = gl->data;
+        if (g_hash_table_remove(added, track))
+            new_items |= _add_track_item(priv, track);
+    }
+
+    g_hash_table_destroy(added);
+
+    if (new_items)
+        _init_slider_range(priv);
+}
+
 static void _remove_track(ClarityWidgetPrivate *priv, AlbumItem *item, Track *track) {
     g_return_if_fail(priv);
     g_return_if_fail(priv->draw_area);
@@ -86,6 +86,7 @@ void clarity_widget_track_removed_cb(GtkPodApp *app, gpointer tk, gpointer data)
 void clarity_widget_tracks_selected_cb(GtkPodApp *app, gpointer tks, gpointer data);
 void clarity_widget_track_updated_cb(GtkPodApp *app, gpointer tk, gpointer data);
 void clarity_widget_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data);
+void clarity_widget_tracks_added_cb(GtkPodApp *app, gpointer tks, gpointer data);
 
 
 G_END_DECLS
@@ -33,11 +33,13 @@
 #include <gdk/gdk.h>
 #include <pango/pangocairo.h>
 #include <math.h>
+#include <string.h>
 #include "libgtkpod/gp_private.h"
 #include "libgtkpod/misc.h"
 #include "libgtkpod/gtkpod_app_iface.h"
 #include "libgtkpod/prefs.h"
 #include "libgtkpod/fileselection.h"
+#include "libgtkpod/thumbnail_cache.h"
 #include "display_coverart.h"
 #include "plugin.h"
 #include "fetchcover.h"
@@ -51,9 +53,10 @@ static gint compare_album_keys(gchar *a, gchar *b);
 static void set_display_window_dimensions();
 static void set_highlight(Cover_Item *cover, gint index, cairo_t *cr);
 static void set_shadow_reflection(Cover_Item *cover, cairo_t *cr);
-static void remove_track_from_album(Album_Item *album, Track *track, gchar *key, gint index, GList *keylistitem);
+static void remove_track_from_album(Album_Item *album, Track *track);
 static GdkPixbuf *coverart_get_default_track_thumb(gint default_img_size);
-static GdkPixbuf *coverart_get_track_thumb(Track *track, Itdb_Device *device, gint default_img_size);
+static GdkPixbuf *coverart_get_track_thumb(Track *track, gint default_img_size);
+static void on_thumbnail_loaded(Track *track, GdkPixbuf *pixbuf, gpointer data);
 
 /* callback declarations */
 static void on_cover_display_button_clicked(GtkWidget *widget, gpointer data);
@@ -83,9 +86,9 @@ const gchar *KEY_DISPLAY_COVERART = "display_coverart";
 
 /* The structure that holds values used throughout all the functions */
 static CD_Widget *cdwidget = NULL;
-/* The backing hash for the albums and its associated key list */
+/* The backing hash for the albums and the albums in display order */
 static GHashTable *album_hash;
-static GList *album_key_list;
+static GPtrArray *album_array;
 /* Dimensions used for the canvas */
 static gint MIN_WIDTH;
 static gint MIN_HEIGHT;
@@ -113,19 +116,12 @@ static void debug_albums ()
     gint i;
     Cover_Item *cover;
     Album_Item *album;
-    gchar *key;
 
     printf("Album list\n");
-    for(i = 0; i < g_list_length(album_key_list); ++i)
+    for(i = 0; i < album_array->len; ++i)
     {
-        key = g_list_nth_data(album_key_list, i);
-        if (key == NULL)
-        printf("Album key is null\n");
-        else
-        {
-            album = g_hash_table_lookup (album_hash, key);
-            printf("Index = %d -> Album Details: Artist = %s, Album = %s, No. Tracks = %d\n", i, album->artist, album->albumname, g_list_length (album->tracks));
-        }
+        album = g_ptr_array_index(album_array, i);
+        printf("Index = %d -> Album Details: Artist = %s, Album = %s, No. Tracks = %d\n", i, album->artist, album->albumname, g_list_length (album->tracks));
     }
 
     printf("Cover List\n");
@@ -153,6 +149,158 @@ static gboolean coverart_window_valid() {
     return TRUE;
 }
 
+/**
+ * get_album_key:
+ *
+ * Key under which the album of @track is stored in the album hash.
+ * Must be freed.
+ */
+static gchar *get_album_key(Track *track) {
+    return g_strconcat(track->artist ? track->artist : "", "_", track->album, NULL);
+}
+
+/**
+ * get_display_total:
+ *
+ * Number of positions the covers are scrolled through: the albums
+ * plus IMG_MAIN empty positions either side, so that the first and
+ * the last album can be displayed as the main cover.
+ */
+static gint get_display_total() {
+    return album_array->len + (IMG_MAIN * 2);
+}
+
+/**
+ * get_album_at:
+ *
+ * Album displayed at @index, which counts the empty positions before
+ * the first album. Returns NULL for an empty position.
+ */
+static Album_Item *get_album_at(gint index) {
+    index -= IMG_MAIN;
+    if (index < 0 || index >= (gint) album_array->len)
+        return NULL;
+
+    return g_ptr_array_index(album_array, index);
+}
+
+/**
+ * reindex_albums:
+ *
+ * Update the positions stored in the albums from @start onwards
+ * after the album array has been changed.
+ */
+static void reindex_albums(guint start) {
+    guint i;
+
+    for (i = start; i < album_array->len; ++i) {
+        Album_Item *album = g_ptr_array_index(album_array, i);
+        album->index = i;
+    }
+}
+
+/**
+ * compare_albums:
+ *
+ * Sort function for the album array, comparing the album keys.
+ */
+static gint compare_albums(gconstpointer a, gconstpointer b) {
+    const Album_Item *album_a = *((Album_Item **) a);
+    const Album_Item *album_b = *((Album_Item **) b);
+
+    return compare_album_keys(album_a->key, album_b->key);
+}
+
+static gint compare_albums_descending(gconstpointer a, gconstpointer b) {
+    return compare_albums(b, a);
+}
+
+/**
+ * insert_album:
+ *
+ * Add a new album to the hash and insert it into the album array at
+ * the position given by the sort order preference.
+ *
+ * @album: album item, whose key is taken over by the hash
+ */
+static void insert_album(Album_Item *album) {
+    gint order = prefs_get_int("cad_sort");
+    guint low = 0, high = album_array->len;
+
+    g_hash_table_insert(album_hash, album->key, album);
+
+    if (order == SORT_NONE) {
+        low = high;
+    }
+    else {
+        /* Find the first album that sorts after the new one */
+        while (low < high) {
+            guint mid = (low + high) / 2;
+            Album_Item *other = g_ptr_array_index(album_array, mid);
+            gint cmp = compare_album_keys(album->key, other->key);
+
+            if (order == SORT_DESCENDING)
+                cmp = -cmp;
+
+            if (cmp > 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+    }
+
+    g_ptr_array_add(album_array, NULL);
+    memmove(&album_array->pdata[low + 1], &album_array->pdata[low], (album_array->len - low - 1) * sizeof(gpointer));
+    album_array->pdata[low] = album;
+    reindex_albums(low);
+}
+
+/**
+ * remove_album:
+ *
+ * Remove @album from the album array and the hash, which frees it.
+ */
+static void remove_album(Album_Item *album) {
+    guint index = album->index;
+
+    g_ptr_array_remove_index(album_array, index);
+    reindex_albums(index);
+
+    if (!g_hash_table_remove(album_hash, album->key))
+        gtkpod_warning(_("Failed to remove the album from the album hash store."));
+}
+
+/**
+ * add_track_to_album:
+ *
+ * Append @track to the album item of its artist and album. If there
+ * is none yet a new one is created and inserted according to the
+ * sort order.
+ *
+ * Returns the album item of @track.
+ */
+static Album_Item *add_track_to_album(Track *track) {
+    gchar *trk_key = get_album_key(track);
+    Album_Item *album = g_hash_table_lookup(album_hash, trk_key);
+
+    if (album == NULL) {
+        album = g_new0 (Album_Item, 1);
+        album->albumart = NULL;
+        album->scaled_art = NULL;
+        album->albumname = g_strdup(track->album);
+        album->artist = g_strdup(track->artist);
+        album->tracks = g_list_append(NULL, track);
+        album->key = trk_key;
+
+        insert_album(album);
+    }
+    else {
+        g_free(trk_key);
+        album->tracks = g_list_append(album->tracks, track);
+    }
+    return album;
+}
+
 /**
  * coverart_init_display:
  *
@@ -193,7 +341,7 @@ void coverart_init_display(GtkWidget *parent, gchar *gladepath) {
 
     /* Initialise the album hash backing store */
     album_hash = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify) g_free, (GDestroyNotify) free_album);
-    album_key_list = NULL;
+    album_array = g_ptr_array_new();
     set_display_window_dimensions();
 
     gint i;
@@ -345,7 +493,7 @@ static void redraw(gboolean force_pixbuf_update) {
     gdk_window_process_updates(gtk_widget_get_window(GTK_WIDGET(cdwidget->draw_area)), TRUE);
     cairo_region_destroy(region);
 
-    if (g_list_length(album_key_list) <= 1) {
+    if (album_array->len <= 1) {
         gtk_widget_set_sensitive(GTK_WIDGET(cdwidget->cdslider), FALSE);
         gtk_widget_set_sensitive(GTK_WIDGET(cdwidget->leftbutton), FALSE);
         gtk_widget_set_sensitive(GTK_WIDGET(cdwidget->rightbutton), FALSE);
@@ -379,22 +527,19 @@ static void draw(cairo_t *cairo_context) {
     Album_Item *album;
     gint i, album_index;
     Cover_Item *cover;
-    gchar *key;
 
     for (i = 0; i < IMG_TOTAL; ++i) {
         cover = g_ptr_array_index(cdwidget->cdcovers, cover_index[i]);
         album_index = cdwidget->first_imgindex + cover_index[i];
 
-        /* Get the key from the key list appropriate to the index
-         * provided by the first image index property
+        /* Get the album appropriate to the index provided by
+         * the first image index property
          */
-        key = g_list_nth_data(album_key_list, album_index);
+        album = get_album_at(album_index);
 
-        if (key == NULL)
+        if (album == NULL)
             continue;
 
-        /* Find the Album Item appropriate to the key */
-        album = g_hash_table_lookup(album_hash, key);
         cover->album = album;
 
         if (force_pixbuf_covers) {
@@ -412,7 +557,7 @@ static void draw(cairo_t *cairo_context) {
         Track *track;
         if (album->albumart == NULL) {
             track = g_list_nth_data(album->tracks, 0);
-            album->albumart = coverart_get_track_thumb(track, track->itdb->device, DEFAULT_IMG_SIZE);
+            album->albumart = coverart_get_track_thumb(track, DEFAULT_IMG_SIZE);
         }
 
         /* Set the x, y, height and width of the CD cover */
@@ -465,21 +610,26 @@ static void draw(cairo_t *cairo_context) {
 
     force_pixbuf_covers = FALSE;
 
+    /* Have the covers either side of the display decoded in advance */
+    for (i = -IMG_TOTAL; i < (IMG_TOTAL * 2); ++i) {
+        album = get_album_at(cdwidget->first_imgindex + i);
+        if (album && !album->albumart)
+            thumbnail_cache_prefetch(g_list_nth_data(album->tracks, 0), DEFAULT_IMG_SIZE);
+    }
+
     /* free the scaled pixbufs from the non visible covers either side of the current display.
      * Experimental feature that should save on memory.
      */
-    key = g_list_nth_data(album_key_list, cdwidget->first_imgindex - 1);
-    if (key != NULL) {
-        album = g_hash_table_lookup(album_hash, key);
+    album = get_album_at(cdwidget->first_imgindex - 1);
+    if (album != NULL) {
         if (album->scaled_art) {
             g_object_unref(album->scaled_art);
             album->scaled_art = NULL;
         }
     }
 
-    key = g_list_nth_data(album_key_list, cdwidget->first_imgindex + IMG_TOTAL + 1);
-    if (key != NULL) {
-        album = g_hash_table_lookup(album_hash, key);
+    album = get_album_at(cdwidget->first_imgindex + IMG_TOTAL + 1);
+    if (album != NULL) {
         if (album->scaled_art) {
             g_object_unref(album->scaled_art);
             album->scaled_art = NULL;
@@ -500,7 +650,6 @@ static void draw(cairo_t *cairo_context) {
  *
  */
 void coverart_display_update(gboolean clear_track_list) {
-    gint i;
     GList *tracks;
     Track *track;
     Album_Item *album;
@@ -515,10 +664,9 @@ void coverart_display_update(gboolean clear_track_list) {
         return;
 
     if (clear_track_list) {
-        /* Free up the hash table and the key list */
+        /* Free up the album array and the hash table */
+        g_ptr_array_set_size(album_array, 0);
         g_hash_table_foreach_remove(album_hash, (GHRFunc) gtk_true, NULL);
-        g_list_free(album_key_list);
-        album_key_list = NULL;
 
         /* Find the selected playlist */
         Playlist *pl = gtkpod_get_current_playlist();
@@ -533,11 +681,9 @@ void coverart_display_update(gboolean clear_track_list) {
 
         while (tracks) {
             gchar *album_key;
-            gchar *artist_name;
             track = tracks->data;
 
-            artist_name = track->artist? track->artist : "";
-            album_key = g_strconcat(artist_name, "_", track->album, NULL);
+            album_key = get_album_key(track);
             /* Check whether an album item has already been created in connection
              * with the track's artist and album
              */
@@ -551,11 +697,12 @@ void coverart_display_update(gboolean clear_track_list) {
                 album->artist = g_strdup(track->artist);
                 album->tracks = NULL;
                 album->tracks = g_list_prepend(album->tracks, track);
+                album->key = album_key;
 
                 /* Insert the new Album Item into the hash */
                 g_hash_table_insert(album_hash, album_key, album);
-                /* Add the key to the list for sorting and other functions */
-                album_key_list = g_list_prepend(album_key_list, album_key);
+                /* Add the album to the array for sorting and other functions */
+                g_ptr_array_add(album_array, album);
             }
             else {
                 /* Album Item found in the album hash so
@@ -571,19 +718,9 @@ void coverart_display_update(gboolean clear_track_list) {
         cdwidget->first_imgindex = 0;
     }
 
-    /* Remove all null tracks before any sorting should take place */
-    album_key_list = g_list_remove_all(album_key_list, NULL);
-
-    /* Sort the tracks to the order set in the preference */
+    /* Sort the albums to the order set in the preference */
     coverart_sort_images(prefs_get_int("cad_sort"));
-
-    /* Add 4 null tracks to the end of the track list for padding */
-    for (i = 0; i < IMG_MAIN; ++i)
-        album_key_list = g_list_append(album_key_list, NULL);
-
-    /* Add 4 null tracks to the start of the track list for padding */
-    for (i = 0; i < IMG_MAIN; ++i)
-        album_key_list = g_list_prepend(album_key_list, NULL);
+    reindex_albums(0);
 
     if (clear_track_list)
         set_slider_range(0);
@@ -813,11 +950,11 @@ static void set_shadow_reflection(Cover_Item *cover, cairo_t *cr) {
  * @signal: flag indicating the type of track change that has occurred.
  */
 void coverart_track_changed(Track *track, gint signal) {
-    GList *keypos;
     gchar *trk_key;
     Album_Item *album;
     gint index;
     gboolean findremove;
+    guint i;
 
     if (!coverart_window_valid())
         return;
@@ -830,86 +967,36 @@ void coverart_track_changed(Track *track, gint signal) {
      * e) A track has been created and its artist and album are not in the displaylist
      */
 
-    trk_key = g_strconcat(track->artist, "_", track->album, NULL);
-    /* Determine the index of the found album */
-    keypos = g_list_find_custom(album_key_list, trk_key, (GCompareFunc) compare_album_keys);
+    trk_key = get_album_key(track);
+    /* Find the album of the track */
+    album = g_hash_table_lookup(album_hash, trk_key);
 
     switch (signal) {
     case COVERART_REMOVE_SIGNAL:
         g_free(trk_key);
-        if (! keypos)
+        if (!album)
             return;
 
-        /* Reassign trk_key to the key from the list */
-        trk_key = keypos->data;
-        index = g_list_position(album_key_list, keypos);
-
-        album = g_hash_table_lookup(album_hash, trk_key);
+        index = album->index;
 
         /* Remove the track from the album item */
-        remove_track_from_album(album, track, trk_key, index, keypos);
+        remove_track_from_album(album, track);
 
-        /* Size of key list may have changed so reset the slider
+        /* Size of album array may have changed so reset the slider
          * to appropriate range and index.
          */
-        set_slider_range(index - IMG_MAIN);
+        set_slider_range(index);
         break;
     case COVERART_CREATE_SIGNAL:
-        /* Check whether an album item has already been created in connection
-         * with the track's artist and album
-         */
-        album = g_hash_table_lookup(album_hash, trk_key);
+        g_free(trk_key);
         if (album == NULL) {
-            /* Album item not found so create a new one and populate */
-            album = g_new0 (Album_Item, 1);
-            album->albumart = NULL;
-            album->scaled_art = NULL;
-            album->albumname = g_strdup(track->album);
-            album->artist = g_strdup(track->artist);
-            album->tracks = NULL;
-            album->tracks = g_list_append(album->tracks, track);
-
-            /* Insert the new Album Item into the hash */
-            g_hash_table_insert(album_hash, trk_key, album);
-
-            /* Add the key to the list for sorting and other functions */
-            /* But first ... */
-            /* Remove all null tracks before any sorting should take place */
-            album_key_list = g_list_remove_all(album_key_list, NULL);
-
-            if (prefs_get_int("cad_sort") == SORT_ASCENDING) {
-                album_key_list = g_list_insert_sorted(album_key_list, trk_key, (GCompareFunc) compare_album_keys);
-            }
-            else if (prefs_get_int("cad_sort") == SORT_DESCENDING) {
-                /* Already in descending order so reverse into ascending order */
-                album_key_list = g_list_reverse(album_key_list);
-                /* Insert the track */
-                album_key_list = g_list_insert_sorted(album_key_list, trk_key, (GCompareFunc) compare_album_keys);
-                /* Reverse again */
-                album_key_list = g_list_reverse(album_key_list);
-            }
-            else {
-                /* NO SORT */
-                album_key_list = g_list_append(album_key_list, trk_key);
-            }
-
-            /* Readd in the null tracks */
-            /* Add 4 null tracks to the end of the track list for padding */
-            gint i;
-            for (i = 0; i < IMG_MAIN; ++i)
-                album_key_list = g_list_append(album_key_list, NULL);
-
-            /* Add 4 null tracks to the start of the track list for padding */
-            for (i = 0; i < IMG_MAIN; ++i)
-                album_key_list = g_list_prepend(album_key_list, NULL);
-
+            /* Album item not found so a new one is inserted */
+            album = add_track_to_album(track);
             redraw(FALSE);
         }
         else {
-            /* Album Item found in the album hash so append the track to
-             * the end of the track list
-             */
-            album->tracks = g_list_append(album->tracks, track);
+            /* append the track to the end of the track list */
+            album = add_track_to_album(track);
         }
 
         /* Set the slider to the newly inserted track.
@@ -917,15 +1004,14 @@ void coverart_track_changed(Track *track, gint signal) {
          * to newly inserted album to ensure this album is
          * the main middle one.
          */
-        keypos = g_list_find_custom(album_key_list, trk_key, (GCompareFunc) compare_album_keys);
-        index = g_list_position(album_key_list, keypos);
-        set_slider_range(index - IMG_MAIN);
+        set_slider_range(album->index);
 
         break;
     case COVERART_CHANGE_SIGNAL:
         /* A track is declaring itself as changed so what to do? */
+        g_free(trk_key);
         findremove = FALSE;
-        if (!keypos) {
+        if (!album) {
             /* The track could not be found according to the key!
              * The ONLY way this could happen is if the user changed the
              * artist or album of the track. Well it should be rare but the only
@@ -943,9 +1029,6 @@ void coverart_track_changed(Track *track, gint signal) {
             /* To determine if a) is the case need to determine whether track exists in the
              * album items track list. If it does then b) is true and nothing more is required.
              */
-            album = g_hash_table_lookup(album_hash, trk_key);
-            g_return_if_fail (album);
-
             index = g_list_index(album->tracks, track);
             if (index != -1) {
                 /* Track exists in the album list so ignore the change and return */
@@ -969,27 +1052,16 @@ void coverart_track_changed(Track *track, gint signal) {
              * that the track belonged to, remove it then add the track to the new
              * album.
              */
-            GList *klist;
-            gchar *key;
-            klist = g_list_first(album_key_list);
-            while (klist != NULL) {
-                key = (gchar *) klist->data;
-                index = g_list_index(album_key_list, key);
-                if (key != NULL) {
-                    album = g_hash_table_lookup(album_hash, key);
-
-                    gint album_trk_index;
-                    album_trk_index = g_list_index(album->tracks, track);
-                    if (album_trk_index != -1) {
-                        /* The track is in this album so remove it in preparation for readding
-                         * under the new album key
-                         */
-                        remove_track_from_album(album, track, key, index, klist);
-                        /* Found the album and removed so no need to continue the loop */
-                        break;
-                    }
+            for (i = 0; i < album_array->len; ++i) {
+                album = g_ptr_array_index(album_array, i);
+                if (g_list_index(album->tracks, track) != -1) {
+                    /* The track is in this album so remove it in preparation for readding
+                     * under the new album key
+                     */
+                    remove_track_from_album(album, track);
+                    /* Found the album and removed so no need to continue the loop */
+                    break;
                 }
-                klist = klist->next;
             }
 
             /* Create a new album item or find existing album to house the "brand new" track */
@@ -1039,7 +1111,7 @@ static gboolean on_contentpanel_scroll_wheel_turned(GtkWidget *widget, GdkEventS
     else
         cdwidget->first_imgindex--;
 
-    displaytotal = g_list_length(album_key_list) - 8;
+    displaytotal = album_array->len;
 
     if (displaytotal <= 0)
         return TRUE;
@@ -1079,7 +1151,7 @@ static void on_cover_display_button_clicked(GtkWidget *widget, gpointer data) {
     else
         cdwidget->first_imgindex--;
 
-    displaytotal = g_list_length(album_key_list) - 8;
+    displaytotal = album_array->len;
 
     if (displaytotal <= 0)
         return;
@@ -1114,12 +1186,12 @@ static void on_cover_display_slider_value_changed(GtkRange *range, gpointer user
     if (cdwidget->block_display_change)
         return;
 
-    index = gtk_range_get_value(range);
-    displaytotal = g_list_length(album_key_list);
-
-    if (displaytotal <= 0)
+    if (album_array->len == 0)
         return;
 
+    index = gtk_range_get_value(range);
+    displaytotal = get_display_total();
+
     /* Use the index value from the slider for the main image index */
     cdwidget->first_imgindex = index;
 
@@ -1199,58 +1271,23 @@ static gint on_main_cover_image_clicked(GtkWidget *widget, GdkEvent *event, gpoi
  * Retrieve the artwork pixbuf from the given track.
  *
  * @track: Track from where the pixbuf is obtained.
- * @device: Reference to the device upon which the track is located
- * @default_img_size: If the default image must be used then this may contain a default value
- * 		for its size.
+ * @default_img_size: Size the artwork is scaled to fit into, also used
+ *      for the default image.
  *
  * Returns:
  * pixbuf referenced by the provided track or the pixbuf of the
- * default file if track has no cover art.
+ * default file if track has no cover art. If the artwork has not been
+ * decoded yet, the default pixbuf is returned for the time being and
+ * replaced by on_thumbnail_loaded().
  */
-static GdkPixbuf *coverart_get_track_thumb(Track *track, Itdb_Device *device, gint default_size) {
+static GdkPixbuf *coverart_get_track_thumb(Track *track, gint default_size) {
     GdkPixbuf *pixbuf = NULL;
-    GdkPixbuf *image = NULL;
     ExtraTrackData *etd;
-    gint w, h;
-    float ratio;
 
     etd = track->userdata;
     g_return_val_if_fail (etd, NULL);
 
-    image = itdb_track_get_thumbnail(track, 200, 200);
-    if (image) {
-        w = gdk_pixbuf_get_width(image);
-        h = gdk_pixbuf_get_height(image);
-
-        if (default_size > 0) {
-            if (w > default_size || h > default_size) {
-                /* need to scale the image back down to size */
-                if (w == h) {
-                    w = default_size;
-                    h = default_size;
-                }
-                else if (h > w) {
-                    ratio = h / w;
-                    h = default_size;
-                    w = (gint) (default_size / ratio);
-                }
-                else {
-                    ratio = w / h;
-                    w = default_size;
-                    h = (gint) (default_size / ratio);
-                }
-                pixbuf = gdk_pixbuf_scale_simple(image, w, h, GDK_INTERP_BILINEAR);
-            }
-            else
-                pixbuf = gdk_pixbuf_copy(image);
-
-            g_object_unref(image);
-        }
-        else {
-            pixbuf = gdk_pixbuf_scale_simple(image, DEFAULT_IMG_SIZE, DEFAULT_IMG_SIZE, GDK_INTERP_BILINEAR);
-            g_object_unref(image);
-        }
-    }
+    pixbuf = thumbnail_cache_get(track, default_size, on_thumbnail_loaded, NULL);
 
     if (pixbuf == NULL) {
         /* Could not get a viable thumbnail so get default pixbuf */
@@ -1260,6 +1297,38 @@ static GdkPixbuf *coverart_get_track_thumb(Track *track, Itdb_Device *device, gi
     return pixbuf;
 }
 
+/**
+ * on_thumbnail_loaded:
+ *
+ * Callback of the thumbnail cache once the artwork of @track has
+ * been decoded. Replaces the default cover of its album.
+ */
+static void on_thumbnail_loaded(Track *track, GdkPixbuf *pixbuf, gpointer data) {
+    Album_Item *album;
+    gchar *key;
+
+    if (!pixbuf || !coverart_window_valid())
+        return;
+
+    key = get_album_key(track);
+    album = g_hash_table_lookup(album_hash, key);
+    g_free(key);
+
+    if (!album || (g_list_index(album->tracks, track) == -1))
+        return;
+
+    if (album->albumart)
+        g_object_unref(album->albumart);
+    album->albumart = g_object_ref(pixbuf);
+
+    if (album->scaled_art != NULL) {
+        g_object_unref(album->scaled_art);
+        album->scaled_art = NULL;
+    }
+
+    gtk_widget_queue_draw(cdwidget->draw_area);
+}
+
 /**
  * coverart_get_displayed_tracks:
  *
@@ -1318,7 +1387,7 @@ static GdkPixbuf *coverart_get_default_track_thumb(gint default_img_size) {
 static void set_slider_range(gint index) {
     g_signal_handler_block(G_OBJECT(cdwidget->cdslider), slide_signal_id);
 
-    gint slider_ubound = g_list_length(album_key_list) - IMG_TOTAL;
+    gint slider_ubound = get_display_total() - IMG_TOTAL;
     if (slider_ubound < 1) {
         /* If only one album cover is displayed then slider_ubbound returns
          * 0 and causes a slider assertion error. Avoid this by disabling the
@@ -1364,26 +1433,28 @@ void coverart_select_cover(Track *track) {
     if (cdwidget->block_display_change)
         return;
 
-    displaytotal = g_list_length(album_key_list);
-    if (displaytotal <= 0)
+    if (album_array->len == 0)
         return;
 
+    displaytotal = get_display_total();
+
     gchar *trk_key;
-    trk_key = g_strconcat(track->artist, "_", track->album, NULL);
+    Album_Item *album;
+    trk_key = get_album_key(track);
 
-    /* Determine the index of the found track */
-    GList *key = g_list_find_custom(album_key_list, trk_key, (GCompareFunc) compare_album_keys);
-    g_return_if_fail (key);
-    index = g_list_position(album_key_list, key);
+    /* Determine the index of the album of the track */
+    album = g_hash_table_lookup(album_hash, trk_key);
     g_free(trk_key);
+    g_return_if_fail (album);
+    index = album->index;
 
     /*
      * Use the index value for the main image index.
-     * The index extracted from the album_key_list is
-     * taking into account the 4 nulls at the start of the
-     * list so this removes that inaccuracy.
+     * The album index does not count the 4 empty positions
+     * before the first album, so it is the first image index
+     * that places the album in the middle.
      */
-    cdwidget->first_imgindex = index - IMG_MAIN;
+    cdwidget->first_imgindex = index;
     if (cdwidget->first_imgindex < 0)
         cdwidget->first_imgindex = 0;
     else if ((cdwidget->first_imgindex + IMG_TOTAL) >= displaytotal)
@@ -1562,7 +1633,8 @@ static gint compare_album_keys(gchar *a, gchar *b) {
  * When the alphabetize function is initiated this will
  * sort the covers in the same way. Used at any point to
  * sort the covers BUT must be called after an initial coverart_display_update
- * as the latter initialises the album_key_list list
+ * as the latter initialises the album array. The album indexes have to
+ * be updated afterwards.
  *
  * @order: order type
  *
@@ -1575,12 +1647,11 @@ static void coverart_sort_images(enum GtkPodSortTypes order) {
          */
         return;
     }
-    else {
-        album_key_list = g_list_sort(album_key_list, (GCompareFunc) compare_album_keys);
+    else if (order == SORT_DESCENDING) {
+        g_ptr_array_sort(album_array, compare_albums_descending);
     }
-
-    if (order == SORT_DESCENDING) {
-        album_key_list = g_list_reverse(album_key_list);
+    else {
+        g_ptr_array_sort(album_array, compare_albums);
     }
 }
 
@@ -1593,21 +1664,15 @@ static void coverart_sort_images(enum GtkPodSortTypes order) {
  *
  * @album: album to be checked for removal.
  * @track: track to be removed from the Album_Item
- * @key: string concatentation of the artist_album of track. Key for hash
- * @index: position of the key in the album key list
- * @keylistitem: the actual GList item in the album key list
  */
-static void remove_track_from_album(Album_Item *album, Track *track, gchar *key, gint index, GList *keylistitem) {
+static void remove_track_from_album(Album_Item *album, Track *track) {
     album->tracks = g_list_remove(album->tracks, track);
-    if (g_list_length(album->tracks) == 0) {
+    if (album->tracks == NULL) {
+        /* Display position of the album, counting the empty ones at the start */
+        gint index = album->index + IMG_MAIN;
+
         /* No more tracks related to this album item so delete it */
-        gboolean delstatus = g_hash_table_remove(album_hash, key);
-        if (!delstatus)
-            gtkpod_warning(_("Failed to remove the album from the album hash store."));
-        /*else
-         printf("Successfully removed album\n");
-         */
-        album_key_list = g_list_remove_link(album_key_list, keylistitem);
+        remove_album(album);
 
         if (index < (cdwidget->first_imgindex + IMG_MAIN) && index > IMG_MAIN) {
             /* index of track is less than visible cover's indexes so subtract 1 from
@@ -1677,7 +1742,7 @@ GdkRGBA *coverart_get_background_display_color() {
     gchar *hex_string;
     GdkRGBA *color;
 
-    if (album_key_list == NULL)
+    if (!album_array || album_array->len == 0)
         hex_string = "#FFFFFF";
     else if (!prefs_get_string_value("coverart_display_bg_color", NULL))
         hex_string = "#000000";
@@ -1700,7 +1765,7 @@ GdkRGBA *coverart_get_foreground_display_color() {
     gchar *hex_string;
     GdkRGBA *color;
 
-    if (album_key_list == NULL)
+    if (!album_array || album_array->len == 0)
         hex_string = "#000000";
     else if (!prefs_get_string_value("coverart_display_fg_color", NULL))
         hex_string = "#FFFFFF";
@@ -1749,6 +1814,7 @@ static gboolean on_parent_delete_event(GtkWidget *widget, GdkEvent *event, gpoin
  */
 void destroy_coverart_display() {
     gint i;
+    thumbnail_cache_cancel(on_thumbnail_loaded, NULL);
     g_signal_handler_disconnect(cdwidget->leftbutton, lbutton_signal_id);
     g_signal_handler_disconnect(cdwidget->rightbutton, rbutton_signal_id);
     g_signal_handler_disconnect(cdwidget->cdslider, slide_signal_id);
@@ -1780,11 +1846,10 @@ void destroy_coverart_display() {
     /* Destroying canvas should destroy the background and cvrtext */
     gtk_widget_destroy(GTK_WIDGET(cdwidget->draw_area));
 
-    /* Remove all null tracks before using it to destroy the hash table */
-    album_key_list = g_list_remove_all(album_key_list, NULL);
+    g_ptr_array_free(album_array, TRUE);
+    album_array = NULL;
     g_hash_table_foreach_remove(album_hash, (GHRFunc) gtk_true, NULL);
     g_hash_table_destroy(album_hash);
-    g_list_free(album_key_list);
 
     g_free(cdwidget);
     cdwidget = NULL;
@@ -2075,3 +2140,32 @@ void coverart_display_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data)
     redraw(FALSE);
 }
 
+void coverart_display_tracks_added_cb(GtkPodApp *app, gpointer tks, gpointer data) {
+    Playlist *pl = gtkpod_get_current_playlist();
+    Album_Item *album = NULL;
+    GHashTable *added;
+    GList *gl;
+
+    if (!cdwidget || !cdwidget->draw_area || !gtk_widget_get_window(GTK_WIDGET(cdwidget->draw_area)))
+        return;
+    if (!coverart_window_valid() || !pl || !tks)
+        return;
+
+    /* Insert the tracks of the batch shown by the current playlist
+     * into their albums, then update the slider and redraw once */
+    added = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (gl = tks; gl; gl = gl->next)
+        g_hash_table_insert(added, gl->data, gl->data);
+
+    for (gl = pl->members; gl; gl = gl->next) {
+        if (g_hash_table_lookup(added, gl->data))
+            album = add_track_to_album(gl->data);
+    }
+    g_hash_table_destroy(added);
+
+    if (album) {
+        set_slider_range(album->index);
+        redraw(FALSE);
+    }
+}
+
@@ -50,6 +50,10 @@ typedef struct {
 	gchar *artist;
 	GdkPixbuf *albumart;
 	GdkPixbuf *scaled_art;
+	/* Key of the album in the album hash (owned by the hash) */
+	gchar *key;
+	/* Position of the album in the display order */
+	guint index;
 } Album_Item;
 
 typedef struct {
@@ -213,5 +217,6 @@ void coverart_display_track_removed_cb(GtkPodApp *app, gpointer tk, gpointer dat
 void coverart_display_set_tracks_cb(GtkPodApp *app, gpointer tks, gpointer data);
 void coverart_display_track_updated_cb(GtkPodApp *app, gpointer tk, gpointer data);
 void coverart_display_track_added_cb(GtkPodApp *app, gpointer tk, gpointer data);
+void coverart_display_tracks_added_cb(GtkPodApp *app, gpointer tks, gpointer data);
 
 #endif
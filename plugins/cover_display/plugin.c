@@ -97,6 +97,7 @@ static gboolean activate_plugin(AnjutaPlugin *plugin) {
     g_signal_connect (gtkpod_app, SIGNAL_TRACKS_SELECTED, G_CALLBACK (coverart_display_set_tracks_cb), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_TRACK_UPDATED, G_CALLBACK (coverart_display_track_updated_cb), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_TRACK_ADDED, G_CALLBACK (coverart_display_track_added_cb), NULL);
+    g_signal_connect (gtkpod_app, SIGNAL_TRACKS_ADDED, G_CALLBACK (coverart_display_tracks_added_cb), NULL);
 
     coverart_init_display(cover_display_plugin->cover_window, cover_display_plugin->gladepath);
     anjuta_shell_add_widget(plugin->shell, cover_display_plugin->cover_window, "CoverDisplayPlugin", _("  Cover Artwork"), NULL, ANJUTA_SHELL_PLACEMENT_CENTER, NULL);
@@ -118,6 +119,7 @@ static gboolean deactivate_plugin(AnjutaPlugin *plugin) {
     g_signal_handlers_disconnect_by_func(plugin->shell, G_CALLBACK (coverart_display_set_tracks_cb), NULL);
     g_signal_handlers_disconnect_by_func(plugin->shell, G_CALLBACK (coverart_display_track_updated_cb), NULL);
     g_signal_handlers_disconnect_by_func(plugin->shell, G_CALLBACK (coverart_display_track_added_cb), NULL);
+    g_signal_handlers_disconnect_by_func(plugin->shell, G_CALLBACK (coverart_display_tracks_added_cb), NULL);
 
     cover_display_plugin = (CoverDisplayPlugin*) plugin;
     ui = anjuta_shell_get_ui(plugin->shell, NULL);
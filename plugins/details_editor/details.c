@@ -39,6 +39,7 @@
 #include "libgtkpod/misc_track.h"
 #include "libgtkpod/prefs.h"
 #include "libgtkpod/directories.h"
+#include "libgtkpod/thumbnail_cache.h"
 #include "plugin.h"
 #include "details.h"
 #include "fetchcover.h"
@@ -446,6 +447,7 @@ static gboolean details_copy_artwork(Track *frtrack, Track *totrack) {
     g_return_val_if_fail (toetr->thumb_path_locale, FALSE);
 
     if (strcmp(fretr->thumb_path_locale, toetr->thumb_path_locale) != 0 || fretr->tartwork_changed == TRUE) {
+        thumbnail_cache_invalidate_track(totrack);
         itdb_artwork_free(totrack->artwork);
         totrack->artwork = itdb_artwork_duplicate(frtrack->artwork);
         totrack->artwork_size = frtrack->artwork_size;
@@ -455,6 +457,7 @@ static gboolean details_copy_artwork(Track *frtrack, Track *totrack) {
         g_free(toetr->thumb_path_utf8);
         toetr->thumb_path_locale = g_strdup(fretr->thumb_path_locale);
         toetr->thumb_path_utf8 = g_strdup(fretr->thumb_path_utf8);
+        toetr->artwork_from_file = FALSE;
         toetr->tartwork_changed = TRUE;
         changed = TRUE;
     }
@@ -1222,7 +1225,7 @@ static void details_update_thumbnail() {
     if (details_view->track) {
         details_view->artwork_ok = TRUE;
         /* Get large cover */
-        GdkPixbuf *pixbuf = itdb_artwork_get_pixbuf(details_view->itdb->device, details_view->track->artwork, 200, 200);
+        GdkPixbuf *pixbuf = thumbnail_cache_get_sync(details_view->track, details_view->itdb->device, 200);
         if (pixbuf) {
             gtk_image_set_from_pixbuf(img, pixbuf);
             g_object_unref(pixbuf);
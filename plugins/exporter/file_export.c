@@ -34,6 +34,7 @@
 #include "file_export.h"
 #include "libgtkpod/charset.h"
 #include "libgtkpod/file.h"
+#include "libgtkpod/file_copy.h"
 #include "libgtkpod/sha1.h"
 #include "libgtkpod/misc.h"
 #include "libgtkpod/misc_track.h"
@@ -57,6 +58,7 @@ struct fcd {
     Track *track; /* current track to export */
     gchar *filename; /* filename for the current track to export */
     GString *errors; /* Errors generated during the export */
+    FileCopyBatch *batch; /* files exported but not yet synced */
 };
 
 /*------------------------------------------------------------------
@@ -100,11 +102,6 @@ const gchar *EXPORT_PLAYLIST_FILE_TPL_DFLT = "%a - %t";
 
  ------------------------------------------------------------------*/
 
-/**
- * READ_WRITE_BLOCKSIZE - how many bytes we read per fread/fwrite call
- */
-#define READ_WRITE_BLOCKSIZE 65536
-
 #ifdef G_THREADS_ENABLED
 /* Thread specific */
 static GMutex mutex; /* shared lock */
@@ -144,50 +141,6 @@ static void export_fcd_cleanup(struct fcd *fcd) {
     release_widgets();
 }
 
-/**
- * copy_file_fd_sync - given two open file descriptors, read from one
- * 	and write the data to the other, fsync() before returning.
- * @from - the file descriptor we're reading from
- * @to - the file descriptor we're writing to
- * Returns TRUE on write success, FALSE on write failure
- */
-static gboolean copy_file_fd_sync(FILE *from, FILE *to) {
-    gboolean result = FALSE;
-    gchar data[READ_WRITE_BLOCKSIZE];
-
-    if ((from) && (to)) {
-        int read_bytes = 0, write_bytes = 0;
-
-        do {
-            if ((read_bytes = fread(data, sizeof(char), READ_WRITE_BLOCKSIZE, from))) {
-                if ((write_bytes = fwrite(data, sizeof(char), read_bytes, to))) {
-                    result = TRUE;
-                }
-                else {
-                    if ((ferror(to) != 0)) {
-                        /*			fprintf(stderr, "%d is errno writing\n", errno);*/
-                        result = FALSE;
-                    }
-                    break;
-                }
-            }
-            else {
-                if (!feof(from))
-                    result = FALSE;
-                else
-                    result = TRUE;
-                break;
-
-            }
-
-        }
-        while (!(feof(from)));
-    }
-    if (!result)
-        result = fsync(fileno(to));
-    return (result);
-}
-
 /* Return TRUE if the file @dest exists and is of same size as @from */
 static gboolean file_is_ok(gchar *from, gchar *dest) {
     struct stat st_from, st_dest;
@@ -208,11 +161,12 @@ static gboolean file_is_ok(gchar *from, gchar *dest) {
  * the destination file dest.  Both names are FULL pathnames to the file
  * @file - the filename to copy
  * @dest - the filename we copy to
+ * @batch - the batch the copy is synced to disk with
  * Returns TRUE on successful copying
  */
-static gboolean copy_file(gchar *file, gchar *dest, GError **error) {
+static gboolean copy_file(gchar *file, gchar *dest, FileCopyBatch *batch, GError **error) {
     gboolean result = FALSE;
-    FILE *from = NULL, *to = NULL;
+    GError *copy_error = NULL;
     gboolean check_existing;
     gchar *buf = NULL;
 
@@ -232,24 +186,17 @@ static gboolean copy_file(gchar *file, gchar *dest, GError **error) {
         buf = NULL;
     }
 
-    if ((from = fopen(file, "r"))) {
-        if ((to = fopen(dest, "w"))) {
-            result = copy_file_fd_sync(from, to);
-            fclose(to);
-        }
-        else {
-            switch (errno) {
-            case EPERM:
-                buf = g_strdup_printf(_("Error copying '%s' to '%s': Permission Error (%s)\n"), file, dest, g_strerror(errno));
-                break;
-            default:
-                buf = g_strdup_printf(_("Error copying '%s' to '%s' (%s)\n"), file, dest, g_strerror(errno));
-            }
+    result = file_copy(file, dest, batch, &copy_error);
+    if (!result) {
+        switch (copy_error->code) {
+        case G_FILE_ERROR_PERM:
+        case G_FILE_ERROR_ACCES:
+            buf = g_strdup_printf(_("Error copying '%s' to '%s': Permission Error (%s)\n"), file, dest, copy_error->message);
+            break;
+        default:
+            buf = g_strdup_printf(_("Error copying '%s' to '%s' (%s)\n"), file, dest, copy_error->message);
         }
-        fclose(from);
-    }
-    else {
-        buf = g_strdup_printf(_("Could not open '%s' for reading.\n"), file);
+        g_error_free(copy_error);
     }
 
     if (buf) {
@@ -324,7 +271,7 @@ static gboolean write_track(struct fcd *fcd) {
 
             if (mkdirhierfile(filename)) {
                 GError *error = NULL;
-                if (copy_file(from_file, filename, &error)) {
+                if (copy_file(from_file, filename, fcd->batch, &error)) {
                     result = TRUE;
                     if (fcd->filenames) { /* append filename to list */
                         *fcd->filenames = g_list_append(*fcd->filenames, filename);
@@ -399,6 +346,23 @@ static gpointer th_write_track(gpointer fcd) {
 }
 #endif
 
+/* Add the files @fcd->batch could not sync to disk to @fcd->errors.
+ * Returns FALSE if there were any. */
+static gboolean export_files_check_synced(struct fcd *fcd) {
+    GList *failed, *gl;
+    gboolean result;
+
+    file_copy_batch_take_results(fcd->batch, NULL, &failed);
+    result = (failed == NULL);
+    for (gl = failed; gl; gl = gl->next) {
+        gchar *msg = g_strdup_printf(_("Could not sync '%s' to disk\n\n"), (gchar *) gl->data);
+        fcd->errors = g_string_append(fcd->errors, msg);
+        g_free(msg);
+    }
+    g_list_free_full(failed, g_free);
+    return result;
+}
+
 /******************************************************************
  export_files_write - copy the specified tracks to the selected
  directory.
@@ -435,6 +399,7 @@ static void export_files_write(struct fcd *fcd) {
 
         gtkpod_statusbar_reset_progress(100);
         start = time(NULL);
+        fcd->batch = file_copy_batch_new();
         for (l = fcd->tracks; l; l = l->next) {
             gboolean resultWrite = TRUE;
             Track *tr = (Track*) l->data;
@@ -490,6 +455,9 @@ static void export_files_write(struct fcd *fcd) {
                 g_free(msg);
             }
 
+            /* files synced automatically while copying this track */
+            result &= export_files_check_synced(fcd);
+
             ++count;
             fraction = copied / total;
 
@@ -502,7 +470,7 @@ static void export_files_write(struct fcd *fcd) {
             /*	      left = ((mins < left) || (100*mins >= 110*left)) ? mins : left;*/
 
             progtext
-                    = g_strdup_printf(_("%d%% (%d:%02d:%02d left)"), (int) (100 * fraction), (int) hrs, (int) mins, (int) secs);
+                    = g_strdup_printf(_("%d%% (%d:%02d:%02d left, %.1f MB/s)"), (int) (100 * fraction), (int) hrs, (int) mins, (int) secs, file_copy_batch_get_rate(fcd->batch) / (1024 * 1024));
             gdouble ticks = fraction - old_fraction;
             gtkpod_statusbar_increment_progress_ticks(ticks * 100, progtext);
 
@@ -517,6 +485,13 @@ static void export_files_write(struct fcd *fcd) {
             while (widgets_blocked && gtk_events_pending())
                 gtk_main_iteration();
         }
+
+        /* sync the files not yet written to disk */
+        file_copy_batch_flush(fcd->batch, NULL);
+        result &= export_files_check_synced(fcd);
+        file_copy_batch_free(fcd->batch);
+        fcd->batch = NULL;
+
         if (!result) {
             export_report_errors(fcd->errors);
             gtkpod_statusbar_message(_("Some tracks were not exported."));
@@ -34,6 +34,7 @@
 #include "libgtkpod/gp_itdb.h"
 #include "libgtkpod/prefs.h"
 #include "libgtkpod/gp_private.h"
+#include "libgtkpod/loudness.h"
 #include "plugin.h"
 #include "flacfile.h"
 
@@ -45,6 +46,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <FLAC/metadata.h>
+#include <FLAC/stream_decoder.h>
 
 Track *flac_get_file_info(const gchar *flacFileName, GError **error) {
     Track *track = NULL;
@@ -167,3 +169,102 @@ gboolean flac_can_convert() {
 gchar *flac_get_conversion_cmd() {
     return prefs_get_string("path_conv_flac");
 }
+
+/* ------------------------------------------------------------
+
+ Decoding for the loudness analyzer
+
+ ------------------------------------------------------------ */
+
+typedef struct {
+    FLAC__StreamDecoder *decoder;
+    LoudnessAnalyzer *analyzer; /* set while a frame is decoded */
+    guint channels;
+    guint rate;
+} FlacDecoder;
+
+static FLAC__StreamDecoderWriteStatus flac_decoder_write(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame,
+        const FLAC__int32 * const buffer[], void *client_data) {
+    FlacDecoder *fd = client_data;
+
+    if (fd->analyzer && (frame->header.channels == fd->channels))
+        loudness_analyzer_add_planar_int(fd->analyzer, (const gint32 * const *) buffer, frame->header.blocksize,
+                frame->header.bits_per_sample);
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void flac_decoder_metadata(const FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *metadata,
+        void *client_data) {
+    FlacDecoder *fd = client_data;
+
+    if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO) {
+        fd->channels = metadata->data.stream_info.channels;
+        fd->rate = metadata->data.stream_info.sample_rate;
+    }
+}
+
+static void flac_decoder_error(const FLAC__StreamDecoder *decoder, FLAC__StreamDecoderErrorStatus status,
+        void *client_data) {
+    /* the decoder resynchronizes by itself, a damaged frame is skipped */
+}
+
+static void flac_decoder_close(gpointer handle) {
+    FlacDecoder *fd = handle;
+
+    if (fd) {
+        if (fd->decoder) {
+            FLAC__stream_decoder_finish(fd->decoder);
+            FLAC__stream_decoder_delete(fd->decoder);
+        }
+        g_free(fd);
+    }
+}
+
+static gpointer flac_decoder_open(const gchar *filename, guint *channels, guint *rate, GError **error) {
+    FlacDecoder *fd = g_new0 (FlacDecoder, 1);
+
+    fd->decoder = FLAC__stream_decoder_new();
+    if (!fd->decoder || (FLAC__stream_decoder_init_file(fd->decoder, filename, flac_decoder_write,
+            flac_decoder_metadata, flac_decoder_error, fd) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+            || !FLAC__stream_decoder_process_until_end_of_metadata(fd->decoder) || (fd->channels == 0)) {
+        gchar *fn = charset_to_utf8(filename);
+        gtkpod_log_error_printf(error, _("'%s' does not appear to be a FLAC audio file.\n"), fn);
+        g_free(fn);
+        flac_decoder_close(fd);
+        return NULL;
+    }
+
+    *channels = fd->channels;
+    *rate = fd->rate;
+    return fd;
+}
+
+static gint flac_decoder_decode(gpointer handle, LoudnessAnalyzer *analyzer, GError **error) {
+    FlacDecoder *fd = handle;
+    FLAC__bool ok;
+
+    fd->analyzer = analyzer;
+    ok = FLAC__stream_decoder_process_single(fd->decoder);
+    fd->analyzer = NULL;
+
+    if (!ok) {
+        gtkpod_log_error_printf(error, _("Decoding the FLAC file failed: %s\n"),
+                FLAC__stream_decoder_get_resolved_state_string(fd->decoder));
+        return -1;
+    }
+    if (FLAC__stream_decoder_get_state(fd->decoder) == FLAC__STREAM_DECODER_END_OF_STREAM)
+        return 0;
+    return 1;
+}
+
+static const LoudnessDecoder flac_decoder = {
+    flac_decoder_open,
+    flac_decoder_decode,
+    flac_decoder_close
+};
+
+/* Set the soundcheck value of @track by measuring the loudness of
+ * @filename */
+gboolean flac_read_soundcheck(const gchar *filename, Track *track, GError **error) {
+    return loudness_read_soundcheck(&flac_decoder, filename, track, error);
+}
@@ -32,6 +32,7 @@
 #include "libgtkpod/itdb.h"
 
 Track *flac_get_file_info (const gchar *flacFileName, GError **error);
+gboolean flac_read_soundcheck (const gchar *filename, Track *track, GError **error);
 gboolean flac_can_convert();
 gchar *flac_get_conversion_cmd();
 
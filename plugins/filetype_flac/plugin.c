@@ -88,13 +88,14 @@ static void flac_filetype_plugin_class_init(GObjectClass *klass) {
 
 static void flac_filetype_iface_init(FileTypeInterface *iface) {
     iface->category = AUDIO;
+    iface->reentrant = TRUE;
     iface->description = _("Flac audio file type");
     iface->name = "flac";
     iface->suffixes = g_list_append(iface->suffixes, "flac");
 
     iface->get_file_info = flac_get_file_info;
     iface->write_file_info = filetype_no_write_file_info; /* FIXME */
-    iface->read_soundcheck = filetype_no_soundcheck; /* FIXME */
+    iface->read_soundcheck = flac_read_soundcheck;
     iface->read_lyrics = filetype_no_read_lyrics; /* FIXME */
     iface->write_lyrics = filetype_no_write_lyrics; /* FIXME */
     iface->read_gapless = filetype_no_read_gapless; /* FIXME ?? */
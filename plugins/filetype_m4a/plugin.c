@@ -76,6 +76,7 @@ static void m4a_filetype_plugin_class_init(GObjectClass *klass) {
 
 static void m4a_filetype_iface_init(FileTypeInterface *iface) {
     iface->category = AUDIO;
+    iface->reentrant = TRUE;
     iface->description = _("M4A audio file type");
     iface->name = "m4a";
     iface->suffixes = g_list_append(iface->suffixes, "m4a");
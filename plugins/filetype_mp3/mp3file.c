@@ -223,19 +223,24 @@ typedef struct {
     guint emphasis;
 } MP3Header;
 
+/* Result of a single pass over the mapped file: everything needed
+ * for playlength, bitrate, LAME tag and gapless information */
 typedef struct {
-    const gchar *filename;
-    FILE *file;
-    off_t datasize;
-    gint header_isvalid;
-    MP3Header header;
-    gint id3_isvalid;
+    const guchar *data; /* mapped file contents */
+    gsize audio_start; /* offset of the first frame */
+    gsize audio_end; /* end of audio data (trailing tags excluded) */
+    MP3Header header; /* first frame header, bitrate set to the median */
+    gint first_length; /* length of the first frame */
     gint vbr;
     float vbr_average;
     gint milliseconds;
     gint frames;
-    gint badframes;
-} MP3Info;
+    gboolean lame_valid; /* LAME tag found and CRC matches */
+    LameTag lame;
+    gboolean gapless_valid; /* music_frames and gapless_data are set */
+    guint64 music_frames; /* number of frames following the first frame */
+    guint32 gapless_data; /* bytes from the first frame to the 8th to last frame */
+} MP3FrameIndex;
 
 /* This is for xmms code */
 static guint get_track_time(const gchar *path);
@@ -243,13 +248,14 @@ static guint get_track_time(const gchar *path);
 /* This is for soundcheck code */
 gboolean mp3_read_lame_tag(const gchar *path, LameTag *lt);
 
+/* This is for the frame index */
+static gboolean mp3_frame_index_scan(const gchar *path, MP3FrameIndex *idx, gboolean headers_only, GError **error);
+
 /* ------------------------------------------------------------
 
  start of first section
 
  ------------------------------------------------------------ */
-void get_mp3_info(MP3Info *mp3);
-
 gint frequencies[3][4] =
     {
         { 22050, 24000, 16000, 50000 }, /* MPEG 2.0 */
@@ -294,19 +300,15 @@ gint frame_length(MP3Header *header) {
             * mp3file_header_bitrate(header) / (float) mp3file_header_frequency(header)) + header->padding : 1;
 }
 
-/* Get next MP3 frame header.
+/* Decode the MP3 frame header at @buffer (at least FRAME_HEADER_SIZE
+ bytes).
  Return codes:
  positive value = Frame Length of this header
  0 = No, we did not retrieve a valid frame header
  */
-gint get_header(FILE *file, MP3Header *header) {
-    guchar buffer[FRAME_HEADER_SIZE];
+static gint parse_header(const guchar *buffer, MP3Header *header) {
     gint fl;
 
-    if (fread(&buffer, FRAME_HEADER_SIZE, 1, file) < 1) {
-        header->sync = 0;
-        return 0;
-    }
     header->sync = (((gint) buffer[0] << 4) | ((gint) (buffer[1] & 0xE0) >> 4));
     if (buffer[1] & 0x10)
         header->version = (buffer[1] >> 3) & 1;
@@ -346,115 +348,72 @@ gint sameConstant(MP3Header *h1, MP3Header *h2) {
         return 0;
 }
 
-gint get_first_header(MP3Info *mp3, long startpos) {
-    gint k, l = 0, c;
+/* Find the first frame at or after @startpos that is followed by
+ MIN_CONSEC_GOOD_FRAMES - 1 frames with the same constant header
+ fields. Fills in idx->audio_start, idx->header and idx->first_length. */
+static gint get_first_header(MP3FrameIndex *idx, gsize startpos) {
+    const guchar *data = idx->data;
+    gsize end = idx->audio_end;
+    gsize pos = startpos;
+    gsize next;
+    gint k, l, l2;
     MP3Header h, h2;
-    long valid_start = 0;
-
-    fseek(mp3->file, startpos, SEEK_SET);
-    while (1) {
-        while ((c = fgetc(mp3->file)) != 255 && (c != EOF))
-            ;
-        if (c == 255) {
-            ungetc(c, mp3->file);
-            valid_start = ftell(mp3->file);
-            if ((l = get_header(mp3->file, &h))) {
-                fseek(mp3->file, l - FRAME_HEADER_SIZE, SEEK_CUR);
-                for (k = 1; (k < MIN_CONSEC_GOOD_FRAMES) && (mp3->datasize - ftell(mp3->file) >= FRAME_HEADER_SIZE); k++) {
-                    if (!(l = get_header(mp3->file, &h2)))
-                        break;
-                    if (!sameConstant(&h, &h2))
-                        break;
-                    fseek(mp3->file, l - FRAME_HEADER_SIZE, SEEK_CUR);
-                }
-                if (k == MIN_CONSEC_GOOD_FRAMES) {
-                    fseek(mp3->file, valid_start, SEEK_SET);
-                    memcpy(&(mp3->header), &h2, sizeof(MP3Header));
-                    mp3->header_isvalid = 1;
-                    return 1;
-                }
-            }
-        }
-        else {
-            return 0;
-        }
-    }
-
-    return 0;
-}
-
-/* get_next_header() - read header at current position or look for
- the next valid header if there isn't one at the current position
- */
-gint get_next_header(MP3Info *mp3) {
-    gint l = 0, c, skip_bytes = 0;
-    MP3Header h;
 
-    while (1) {
-        while ((c = fgetc(mp3->file)) != 255 && (ftell(mp3->file) < mp3->datasize))
-            skip_bytes++;
-        if (c == 255) {
-            ungetc(c, mp3->file);
-            if ((l = get_header(mp3->file, &h))) {
-                if (skip_bytes)
-                    mp3->badframes++;
-                fseek(mp3->file, l - FRAME_HEADER_SIZE, SEEK_CUR);
-                return 15 - h.bitrate;
+    while (pos + FRAME_HEADER_SIZE <= end) {
+        const guchar *c = memchr(data + pos, 255, end - pos);
+        if (!c)
+            return 0;
+        pos = c - data;
+        if ((pos + FRAME_HEADER_SIZE <= end) && (l = parse_header(data + pos, &h))) {
+            next = pos + l;
+            for (k = 1; (k < MIN_CONSEC_GOOD_FRAMES) && (next + FRAME_HEADER_SIZE <= end); k++) {
+                if (!(l2 = parse_header(data + next, &h2)))
+                    break;
+                if (!sameConstant(&h, &h2))
+                    break;
+                next += l2;
             }
-            else {
-                skip_bytes += FRAME_HEADER_SIZE;
+            if (k == MIN_CONSEC_GOOD_FRAMES) {
+                idx->audio_start = pos;
+                idx->header = h;
+                idx->first_length = l;
+                return 1;
             }
         }
-        else {
-            if (skip_bytes)
-                mp3->badframes++;
-            return 0;
-        }
+        pos++;
     }
+    return 0;
 }
 
-void get_mp3_info(MP3Info *mp3) {
-    gint frame_type[15] =
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+/* Derive playlength, average and median bitrate from the histogram
+ of bitrate indices collected while walking all frames */
+static void get_mp3_info(MP3FrameIndex *idx, const gint frame_type[15]) {
     double milliseconds = 0, total_rate = 0;
-    gint frames = 0, frame_types = 0, frames_so_far = 0;
+    gint frame_types = 0, frames_so_far = 0;
     gint vbr_median = -1;
-    guint bitrate;
     gint counter = 0;
     MP3Header header;
-    struct stat filestat;
-
-    stat(mp3->filename, &filestat);
-    mp3->datasize = filestat.st_size;
-
-    if (get_first_header(mp3, 0L)) {
-        while ((bitrate = get_next_header(mp3))) {
-            if (bitrate < 15) /* sanity added by JCS */
-                frame_type[15 - bitrate]++;
-            frames++;
-        }
-        memcpy(&header, &(mp3->header), sizeof(MP3Header));
-        for (counter = 0; counter < 15; counter++) {
-            if (frame_type[counter]) {
-                float header_bitrate; /* introduced by JCS to speed up */
-                frame_types++;
-                header.bitrate = counter;
-                frames_so_far += frame_type[counter];
-                header_bitrate = mp3file_header_bitrate(&header);
-                if (header_bitrate != 0)
-                    milliseconds += 8 * (double) frame_length(&header) * (double) frame_type[counter] / header_bitrate;
-                total_rate += header_bitrate * frame_type[counter];
-                if ((vbr_median == -1) && (frames_so_far >= frames / 2))
-                    vbr_median = counter;
-            }
-        }
-        mp3->milliseconds = (gint) (milliseconds + 0.5);
-        mp3->header.bitrate = vbr_median;
-        mp3->vbr_average = total_rate / (float) frames;
-        mp3->frames = frames;
-        if (frame_types > 1) {
-            mp3->vbr = 1;
-        }
+
+    memcpy(&header, &(idx->header), sizeof(MP3Header));
+    for (counter = 0; counter < 15; counter++) {
+        if (frame_type[counter]) {
+            float header_bitrate; /* introduced by JCS to speed up */
+            frame_types++;
+            header.bitrate = counter;
+            frames_so_far += frame_type[counter];
+            header_bitrate = mp3file_header_bitrate(&header);
+            if (header_bitrate != 0)
+                milliseconds += 8 * (double) frame_length(&header) * (double) frame_type[counter] / header_bitrate;
+            total_rate += header_bitrate * frame_type[counter];
+            if ((vbr_median == -1) && (frames_so_far >= idx->frames / 2))
+                vbr_median = counter;
+        }
+    }
+    idx->milliseconds = (gint) (milliseconds + 0.5);
+    idx->header.bitrate = vbr_median;
+    idx->vbr_average = idx->frames ? total_rate / (float) idx->frames : 0;
+    if (frame_types > 1) {
+        idx->vbr = 1;
     }
 }
 
@@ -2300,90 +2259,139 @@ int samplesperframe[2][3] =
         384, 1152, 1152 /* layer 1, layer 2, layer 3 */
         } };
 
-/*
- * mp3_read_lame_tag - read the data from the lame tag (if it exists)
- *
- * @path: location of the file
- * @lt: pointer to structure to be filled
- */
-gboolean mp3_read_lame_tag(const gchar *path, LameTag *lt) {
-    MP3Info *mp3i = NULL;
-    MP3Header h;
-    guint32 flags, peak_amplitude;
-    gint toskip = 0;
-    FILE *file;
-    guchar ubuf[LAME_TAG_SIZE];
-    gint sideinfo;
-    guchar full_info_tag[INFO_TAG_CRC_SIZE];
-
-    g_return_val_if_fail (path, FALSE);
+/* number of trailing frames excluded from gapless_data */
+#define MP3_FRAME_RING 8
+/* how far from the end of the audio data we look for the last frames */
+#define MP3_TAIL_WINDOW ((MP3_FRAME_RING + 4) * MAXFRAMESIZE)
 
-    /* Attempt to open the file */
-    file = fopen(path, "r");
-    if (!file)
-        goto lt_fail;
+/* Return the offset of the first byte following an ID3v2 tag at the
+ * beginning of @data, or 0 if there is no (sane) tag */
+static gsize mp3_skip_id3v2(const guchar *data, gsize size) {
+    gsize len;
 
-    mp3i = g_malloc0(sizeof(MP3Info));
-    mp3i->filename = path;
-    mp3i->file = file;
-    get_mp3_info(mp3i);
+    if ((size < 10) || strncmp((const gchar *) data, "ID3", 3))
+        return 0;
+    if ((data[6] | data[7] | data[8] | data[9]) & 0x80)
+        return 0;
+    len = 10 + ((data[6] << 21) | (data[7] << 14) | (data[8] << 7) | data[9]);
+    if (data[5] & 0x10) /* footer present */
+        len += 10;
+    return (len < size) ? len : 0;
+}
 
-    /* use get_first_header() to seek to the first mp3 header */
-    get_first_header(mp3i, 0);
+/* Return the end of the audio data, excluding a trailing ID3v1 tag
+ * and APEv2 tag */
+static gsize mp3_audio_end(const guchar *data, gsize size) {
+    gsize end = size;
+
+    if ((end >= ID3V1_SIZE) && !strncmp((const gchar *) data + end - ID3V1_SIZE, "TAG", 3))
+        end -= ID3V1_SIZE;
+    if ((end >= APE_FOOTER_SIZE) && !strncmp((const gchar *) data + end - APE_FOOTER_SIZE, "APETAGEX", 8)) {
+        gchar *footer = (gchar *) data + end - APE_FOOTER_SIZE;
+        guint32 tagsize = parse_ape_uint32(footer + 12);
+        if (parse_ape_uint32(footer + 20) & 0x80000000) /* header present */
+            tagsize += APE_FOOTER_SIZE;
+        if (tagsize <= end)
+            end -= tagsize;
+    }
+    return end;
+}
 
-    if (fread(full_info_tag, 1, INFO_TAG_CRC_SIZE, mp3i->file) != INFO_TAG_CRC_SIZE)
-        goto lt_fail;
-    fseek(mp3i->file, -INFO_TAG_CRC_SIZE, SEEK_CUR);
+/*
+ * mp3_parse_vbr_header - look for a Xing/Info or VBRI header in the
+ * first frame
+ *
+ * @idx: frame index with the first frame located
+ * @frames: set to the number of frames stored in the header (0 if none)
+ * @bytes: set to the number of bytes stored in the header (0 if none)
+ * @vbr: set to TRUE for Xing and VBRI headers, FALSE for Info headers
+ *
+ * Returns the offset of the LAME tag relative to the start of the
+ * first frame if a Xing/Info header was found, 0 otherwise.
+ */
+static gsize mp3_parse_vbr_header(const MP3FrameIndex *idx, guint32 *frames, guint32 *bytes, gboolean *vbr) {
+    const gchar *frame = (const gchar *) idx->data + idx->audio_start;
+    gsize avail = idx->audio_end - idx->audio_start;
+    gsize offset;
+    guint32 flags;
 
-    if (!get_header(mp3i->file, &h))
-        goto lt_fail;
+    *frames = 0;
+    *bytes = 0;
+    *vbr = FALSE;
 
     /* Determine offset of Xing header based on sideinfo size */
-    if (h.version & 0x1) {
-        sideinfo = (h.mode & 0x2) ? SIDEINFO_MPEG1_MONO : SIDEINFO_MPEG1_MULTI;
+    if (idx->header.version & 0x1) {
+        offset = (idx->header.mode == 3) ? SIDEINFO_MPEG1_MONO : SIDEINFO_MPEG1_MULTI;
     }
     else {
-        sideinfo = (h.mode & 0x2) ? SIDEINFO_MPEG2_MONO : SIDEINFO_MPEG2_MULTI;
+        offset = (idx->header.mode == 3) ? SIDEINFO_MPEG2_MONO : SIDEINFO_MPEG2_MULTI;
     }
+    offset += FRAME_HEADER_SIZE;
 
-    if (fseek(mp3i->file, sideinfo, SEEK_CUR) || (fread(&ubuf[0], 1, 4, mp3i->file) != 4))
-        goto lt_fail;
-
-    /* Is this really a Xing or Info Header?
-     * FIXME: Apparently (according to madplay sources) there is a different
-     * possible location for the Xing header ("due to an unfortunate
-     * historical event"). I do not thing we need to care though since
-     * ReplayGain information is only contained in recent files.  */
-    if (strncmp(ubuf, "Xing", 4) && strncmp(ubuf, "Info", 4))
-        goto lt_fail;
+    if ((offset + 8 <= avail) && (!strncmp(frame + offset, "Xing", 4) || !strncmp(frame + offset, "Info", 4))) {
+        *vbr = !strncmp(frame + offset, "Xing", 4);
+        flags = parse_lame_uint32((gchar *) frame + offset + 4);
+        offset += 8;
 
-    /* Determine the offset of the LAME tag based on contents of the Xing header */
-    fread(ubuf, 4, 1, mp3i->file);
-    flags = (ubuf[0] << 24) | (ubuf[1] << 16) | (ubuf[2] << 8) | ubuf[3];
-
-    if (flags & FRAMES_FLAG) { /* frames field is set */
-        toskip += 4;
-    }
-    if (flags & BYTES_FLAG) { /* bytes field is set */
-        toskip += 4;
-    }
-    if (flags & TOC_FLAG) { /* TOC field is set */
-        toskip += 100;
+        if (flags & FRAMES_FLAG) {
+            if (offset + 4 > avail)
+                return 0;
+            *frames = parse_lame_uint32((gchar *) frame + offset);
+            offset += 4;
+        }
+        if (flags & BYTES_FLAG) {
+            if (offset + 4 > avail)
+                return 0;
+            *bytes = parse_lame_uint32((gchar *) frame + offset);
+            offset += 4;
+        }
+        if (flags & TOC_FLAG) {
+            offset += 100;
+        }
+        if (flags & VBR_SCALE_FLAG) {
+            offset += 4;
+        }
+        return offset;
     }
-    if (flags & VBR_SCALE_FLAG) { /* quality field is set */
-        toskip += 4;
+
+    /* Fraunhofer encoders write a VBRI header 32 bytes after the
+     * frame header instead */
+    offset = FRAME_HEADER_SIZE + 32;
+    if ((offset + 18 <= avail) && !strncmp(frame + offset, "VBRI", 4)) {
+        *vbr = TRUE;
+        *bytes = parse_lame_uint32((gchar *) frame + offset + 10);
+        *frames = parse_lame_uint32((gchar *) frame + offset + 14);
     }
+    return 0;
+}
+
+/*
+ * mp3_parse_lame_tag - parse the LAME tag following the Xing/Info
+ * header in the first frame
+ *
+ * @idx: frame index with the first frame located
+ * @offset: offset of the LAME tag as returned by mp3_parse_vbr_header()
+ * @lt: pointer to structure to be filled
+ *
+ * Returns TRUE if a LAME tag was found and its CRC matches.
+ */
+static gboolean mp3_parse_lame_tag(const MP3FrameIndex *idx, gsize offset, LameTag *lt) {
+    const gchar *frame = (const gchar *) idx->data + idx->audio_start;
+    gsize avail = idx->audio_end - idx->audio_start;
+    const guchar *ubuf;
+    guint32 peak_amplitude;
+
+    if ((avail < INFO_TAG_CRC_SIZE) || (offset + LAME_TAG_SIZE > avail))
+        return FALSE;
 
     /* Check for LAME Tag */
-    if (fseek(mp3i->file, toskip, SEEK_CUR) || (fread(ubuf, 1, LAME_TAG_SIZE, mp3i->file) != LAME_TAG_SIZE))
-        goto lt_fail;
-    if (strncmp(ubuf, "LAME", 4)) {
-        goto lt_fail;
-    }
+    ubuf = (const guchar *) frame + offset;
+    if (strncmp((const gchar *) ubuf, "LAME", 4))
+        return FALSE;
 
-    strncpy(lt->encoder, &ubuf[0x0], 4);
+    strncpy(lt->encoder, (const gchar *) &ubuf[0x0], 4);
 
-    strncpy(lt->version_string, &ubuf[0x4], 5);
+    strncpy(lt->version_string, (const gchar *) &ubuf[0x4], 5);
 
     lt->info_tag_revision = (ubuf[0x9] >> 4);
     lt->vbr_method = (ubuf[0x9] & 0xf);
@@ -2413,100 +2421,320 @@ gboolean mp3_read_lame_tag(const gchar *path, LameTag *lt) {
     lt->surround_info = (ubuf[0x1a] >> 3) & 0x7;
     lt->preset = ((ubuf[0x1a] & 0x7) << 8) + ubuf[0x1b];
 
-    lt->music_length = parse_lame_uint32(&ubuf[0x1c]);
+    lt->music_length = parse_lame_uint32((gchar *) &ubuf[0x1c]);
 
-    lt->music_crc = parse_lame_uint16(&ubuf[0x20]);
-    lt->info_tag_crc = parse_lame_uint16(&ubuf[0x22]);
+    lt->music_crc = parse_lame_uint16((gchar *) &ubuf[0x20]);
+    lt->info_tag_crc = parse_lame_uint16((gchar *) &ubuf[0x22]);
 
-    lt->calculated_info_tag_crc = crc_compute(full_info_tag, INFO_TAG_CRC_SIZE, 0x0000);
+    lt->calculated_info_tag_crc = crc_compute(frame, INFO_TAG_CRC_SIZE, 0x0000);
 
-    fclose(file);
-    g_free(mp3i);
     return (lt->calculated_info_tag_crc == lt->info_tag_crc);
+}
 
-    lt_fail: if (file)
-        fclose(file);
-    g_free(mp3i);
+/*
+ * mp3_scan_tail - locate the last MP3_FRAME_RING frames without
+ * walking the whole file
+ *
+ * Searches the last MP3_TAIL_WINDOW bytes for a chain of frames that
+ * ends exactly at the end of the audio data and sets gapless_data
+ * from it. The music length stored in the LAME tag, if any, is used
+ * to verify the result.
+ *
+ * Returns TRUE if gapless_data could be determined.
+ */
+static gboolean mp3_scan_tail(MP3FrameIndex *idx) {
+    const guchar *data = idx->data;
+    gsize end = idx->audio_end;
+    gsize first = idx->audio_start + idx->first_length;
+    gsize pos, next;
+    guint32 ring[MP3_FRAME_RING];
+    guint32 finaleight;
+    gint i, l, n;
+    MP3Header h;
+
+    if (first >= end)
+        return FALSE;
+
+    if (idx->lame.music_length && (idx->lame.music_length != end - idx->audio_start))
+        return FALSE;
+
+    pos = (end - first > MP3_TAIL_WINDOW) ? end - MP3_TAIL_WINDOW : first;
+    for (; pos + FRAME_HEADER_SIZE <= end; pos++) {
+        if (data[pos] != 255)
+            continue;
+        next = pos;
+        n = 0;
+        while ((next + FRAME_HEADER_SIZE <= end) && (l = parse_header(data + next, &h)) && sameConstant(&idx->header, &h)) {
+            ring[n % MP3_FRAME_RING] = l;
+            n++;
+            next += l;
+        }
+        /* require more than MP3_FRAME_RING frames so that a false
+         * sync at the start of the chain cannot end up in the ring */
+        if ((next == end) && (n > MP3_FRAME_RING)) {
+            finaleight = 0;
+            for (i = 0; i < MP3_FRAME_RING; i++) {
+                finaleight += ring[i];
+            }
+            idx->gapless_data = (end - idx->audio_start) - finaleight;
+            idx->gapless_valid = TRUE;
+            return TRUE;
+        }
+    }
     return FALSE;
+}
+
+/*
+ * mp3_walk_frames - visit every frame header between the first frame
+ * and the end of the audio data
+ *
+ * Collects the bitrate histogram for get_mp3_info() and, as long as
+ * the frames form an unbroken chain, the frame count and the sizes
+ * of the last MP3_FRAME_RING frames needed for gapless playback.
+ */
+static void mp3_walk_frames(MP3FrameIndex *idx) {
+    const guchar *data = idx->data;
+    gsize end = idx->audio_end;
+    gsize pos = idx->audio_start;
+    gint frame_type[15] =
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    guint32 lastframes[MP3_FRAME_RING] =
+        { 0, 0, 0, 0, 0, 0, 0, 0 };
+    guint32 totaldatasize = 0;
+    guint32 finaleight;
+    guint64 totalframes = 0;
+    gboolean chain = TRUE;
+    MP3Header h;
+    gint i, l;
+
+    while (pos + FRAME_HEADER_SIZE <= end) {
+        if (data[pos] != 255) {
+            const guchar *c = memchr(data + pos, 255, end - pos);
+            if (!c)
+                break;
+            pos = c - data;
+            chain = FALSE;
+            continue;
+        }
+        if (!(l = parse_header(data + pos, &h))) {
+            pos += FRAME_HEADER_SIZE;
+            chain = FALSE;
+            continue;
+        }
+        if (h.bitrate > 0)
+            frame_type[h.bitrate]++;
+        idx->frames++;
+        if (chain) {
+            /* the first frame (Xing/Info frame) is not a music frame */
+            if (idx->frames > 1) {
+                lastframes[totalframes % MP3_FRAME_RING] = l;
+                totalframes++;
+            }
+            totaldatasize += l;
+        }
+        pos += l;
+    }
+
+    get_mp3_info(idx, frame_type);
 
+    finaleight = 0;
+    for (i = 0; i < MP3_FRAME_RING; i++) {
+        finaleight += lastframes[i];
+    }
+    idx->music_frames = totalframes;
+    idx->gapless_data = totaldatasize - finaleight;
+    idx->gapless_valid = TRUE;
 }
 
 /*
- * mp3_get_track_gapless - read the specified file and calculate gapless
- * information: totalsamples and gapless_data
+ * mp3_frame_index_scan - map @path and collect all frame related
+ * information in a single pass
  *
- * @mp3i: MP3Info of the file; should already have run get_mp3_info() on it
- * @gd: structure holding gapless information; should have pregap and
- * 	postgap already filled
+ * @path: location of the file
+ * @idx: structure to be filled
+ * @headers_only: only locate the first frame and parse the
+ * Xing/Info/VBRI header and LAME tag
+ * @error: return location for a #GError, or NULL
+ *
+ * If the first frame carries a frame count (Xing/Info or VBRI
+ * header) playlength and bitrate are calculated from it and only the
+ * last few frames are inspected for gapless information. Otherwise
+ * every frame header is visited once.
+ *
+ * Returns FALSE if the file could not be mapped.
  */
+static gboolean mp3_frame_index_scan(const gchar *path, MP3FrameIndex *idx, gboolean headers_only, GError **error) {
+    GMappedFile *map;
+    guint32 xing_frames, xing_bytes;
+    gboolean xing_vbr;
+    gsize lame_offset;
 
-gboolean mp3_get_track_gapless(MP3Info *mp3i, GaplessData *gd) {
-    int i;
-    int xing_header_offset;
-    int mysamplesperframe;
-    int totaldatasize;
-    int lastframes[8];
-    int totalframes;
-    int finaleight;
-    int l;
-
-    g_return_val_if_fail (mp3i, FALSE);
-    g_return_val_if_fail (gd, FALSE);
+    g_return_val_if_fail (path, FALSE);
+    g_return_val_if_fail (idx, FALSE);
+
+    memset(idx, 0, sizeof(MP3FrameIndex));
 
-    /* use get_first_header() to seek to the first mp3 header */
-    get_first_header(mp3i, 0);
+    map = g_mapped_file_new(path, FALSE, error);
+    if (!map)
+        return FALSE;
+
+    idx->data = (const guchar *) g_mapped_file_get_contents(map);
+    if (!idx->data) { /* empty file */
+        g_mapped_file_unref(map);
+        return TRUE;
+    }
+    idx->audio_end = mp3_audio_end(idx->data, g_mapped_file_get_length(map));
+
+    if (get_first_header(idx, mp3_skip_id3v2(idx->data, idx->audio_end)) || get_first_header(idx, 0)) {
+        lame_offset = mp3_parse_vbr_header(idx, &xing_frames, &xing_bytes, &xing_vbr);
+        if (lame_offset)
+            idx->lame_valid = mp3_parse_lame_tag(idx, lame_offset, &idx->lame);
+
+        if (!headers_only) {
+            gint spf = samplesperframe[idx->header.version & 1][3 - idx->header.layer];
+            gint freq = mp3file_header_frequency(&idx->header);
+
+            /* gapless information is only used together with a
+             * valid LAME tag */
+            if (xing_frames && freq && (!idx->lame_valid || mp3_scan_tail(idx))) {
+                gsize stream_bytes = xing_bytes ? xing_bytes : idx->audio_end - idx->audio_start;
+
+                idx->frames = xing_frames;
+                idx->music_frames = xing_frames;
+                idx->milliseconds = (gint) ((gdouble) xing_frames * spf * 1000 / freq + 0.5);
+                if (idx->milliseconds)
+                    idx->vbr_average = (float) stream_bytes * 8 / idx->milliseconds;
+                else
+                    idx->vbr_average = mp3file_header_bitrate(&idx->header);
+                idx->vbr = xing_vbr;
+            }
+            else {
+                mp3_walk_frames(idx);
+            }
+        }
+    }
 
-    xing_header_offset = ftell(mp3i->file);
+    idx->data = NULL;
+    g_mapped_file_unref(map);
+    return TRUE;
+}
+
+/*
+ * mp3_read_lame_tag - read the data from the lame tag (if it exists)
+ *
+ * @path: location of the file
+ * @lt: pointer to structure to be filled
+ */
+gboolean mp3_read_lame_tag(const gchar *path, LameTag *lt) {
+    MP3FrameIndex idx;
 
-    get_header(mp3i->file, &(mp3i->header));
+    g_return_val_if_fail (path, FALSE);
+    g_return_val_if_fail (lt, FALSE);
 
-    mysamplesperframe = samplesperframe[mp3i->header.version & 1][3 - mp3i->header.layer];
+    if (!mp3_frame_index_scan(path, &idx, TRUE, NULL))
+        return FALSE;
+    if (!idx.lame_valid)
+        return FALSE;
 
-    /* jump to the end of the frame with the xing header */
-    if (fseek(mp3i->file, xing_header_offset + frame_length(&(mp3i->header)), SEEK_SET))
-        goto gp_fail;
+    memcpy(lt, &idx.lame, sizeof(LameTag));
+    return TRUE;
+}
 
-    /* counts bytes from the start of the 1st sync frame */
-    totaldatasize = frame_length(&(mp3i->header));
+/*
+ * mp3_get_track_gapless - calculate gapless information:
+ * totalsamples and gapless_data
+ *
+ * @idx: frame index of the file as filled in by mp3_frame_index_scan()
+ * @gd: structure holding gapless information; should have pregap and
+ * 	postgap already filled
+ */
 
-    /* lastframes keeps track of the last 8 frame sizes */
+static gboolean mp3_get_track_gapless(MP3FrameIndex *idx, GaplessData *gd) {
+    gint mysamplesperframe;
+    guint64 totalframes;
 
-    /* counts number of music frames */
-    totalframes = 0;
+    g_return_val_if_fail (idx, FALSE);
+    g_return_val_if_fail (gd, FALSE);
 
-    /* quickly parse the file, reading only frame headers */
-    l = 0;
-    while ((l = get_header(mp3i->file, &(mp3i->header))) != 0) {
-        lastframes[totalframes % 8] = l;
-        totaldatasize += l;
-        totalframes++;
+    if (!idx->gapless_valid)
+        return FALSE;
 
-        if (fseek(mp3i->file, l - FRAME_HEADER_SIZE, SEEK_CUR))
-            goto gp_fail;
-    }
+    mysamplesperframe = samplesperframe[idx->header.version & 1][3 - idx->header.layer];
 
-    finaleight = 0;
-    for (i = 0; i < 8; i++) {
-        finaleight += lastframes[i];
-    }
+    /* counts number of music frames */
+    totalframes = idx->music_frames;
 
     /* For some reason, iTunes appears to add an extra frames worth of
      * samples to the samplecount for CBR files.  CBR files don't currently
      * (2 Jul 07) play gaplessly whether uploaded from iTunes or gtkpod,
      * even with apparently correct values, but we will attempt to emulate
      * iTunes' behavior */
-    if (mp3i->vbr == 0) // CBR
+    if (idx->vbr == 0) // CBR
         totalframes++;
 
     /* all but last eight frames */
-    gd->gapless_data = totaldatasize - finaleight;
+    gd->gapless_data = idx->gapless_data;
     /* total samples minus pre/postgap */
     gd->samplecount = totalframes * mysamplesperframe - gd->pregap - gd->postgap;
 
     return TRUE;
+}
 
-    gp_fail: return FALSE;
+/*
+ * mp3_set_track_gapless - set the track's gapless fields from a frame
+ * index. See mp3_read_gapless().
+ */
+static gboolean mp3_set_track_gapless(MP3FrameIndex *idx, Track *track) {
+    GaplessData gd;
+    ExtraTrackData *etr;
+
+    g_return_val_if_fail (track, FALSE);
+
+    etr = track->userdata;
+
+    g_return_val_if_fail (etr, FALSE);
+
+    memset(&gd, 0, sizeof(GaplessData));
+
+    /* Try the LAME tag for pregap and postgap */
+    if (idx->lame_valid) {
+        gd.pregap = idx->lame.delay;
+        gd.postgap = idx->lame.padding;
+    }
+    else {
+        /* insert non-LAME methods of finding pregap and postgap */
+        return FALSE;
+    }
 
+    mp3_get_track_gapless(idx, &gd);
+
+    etr->tchanged = FALSE;
+
+    if ((gd.pregap) && (gd.samplecount) && (gd.postgap) && (gd.gapless_data)) {
+        if ((track->pregap != gd.pregap) || (track->samplecount != gd.samplecount)
+                || (track->postgap != gd.postgap) || (track->gapless_data != gd.gapless_data)
+                || (track->gapless_track_flag == FALSE)) {
+            etr->tchanged = TRUE;
+            track->pregap = gd.pregap;
+            track->samplecount = gd.samplecount;
+            track->postgap = gd.postgap;
+            track->gapless_data = gd.gapless_data;
+            track->gapless_track_flag = TRUE;
+        }
+    }
+    else { /* remove gapless data which doesn't seem to be valid any
+     * more */
+        if (track->gapless_track_flag == TRUE) {
+            etr->tchanged = TRUE;
+        }
+        track->pregap = 0;
+        track->samplecount = 0;
+        track->postgap = 0;
+        track->gapless_data = 0;
+        track->gapless_track_flag = FALSE;
+    }
+
+    return TRUE;
 }
 
 /**
@@ -2527,76 +2755,15 @@ gboolean mp3_get_track_gapless(MP3Info *mp3i, GaplessData *gd) {
  */
 
 gboolean mp3_read_gapless(const gchar *path, Track *track, GError **error) {
-    MP3Info *mp3i = NULL;
-    FILE *file;
-
-    GaplessData gd;
-    ExtraTrackData *etr;
+    MP3FrameIndex idx;
 
     g_return_val_if_fail (track, FALSE);
-
-    etr = track->userdata;
-
-    g_return_val_if_fail (etr, FALSE);
-
-    memset(&gd, 0, sizeof(GaplessData));
-
     g_return_val_if_fail (path, FALSE);
 
-    /* Attempt to open the file */
-    file = fopen(path, "r");
-    if (file) {
-        mp3i = g_malloc0(sizeof(MP3Info));
-        mp3i->filename = path;
-        mp3i->file = file;
-        get_mp3_info(mp3i);
-
-        /* Try the LAME tag for pregap and postgap */
-        LameTag lt;
-        if (mp3_read_lame_tag(path, &lt)) {
-            gd.pregap = lt.delay;
-            gd.postgap = lt.padding;
-        }
-        else {
-            /* insert non-LAME methods of finding pregap and postgap */
-            fclose(file);
-            g_free(mp3i);
-            return FALSE;
-        }
-
-        mp3_get_track_gapless(mp3i, &gd);
-
-        etr->tchanged = FALSE;
-
-        if ((gd.pregap) && (gd.samplecount) && (gd.postgap) && (gd.gapless_data)) {
-            if ((track->pregap != gd.pregap) || (track->samplecount != gd.samplecount)
-                    || (track->postgap != gd.postgap) || (track->gapless_data != gd.gapless_data)
-                    || (track->gapless_track_flag == FALSE)) {
-                etr->tchanged = TRUE;
-                track->pregap = gd.pregap;
-                track->samplecount = gd.samplecount;
-                track->postgap = gd.postgap;
-                track->gapless_data = gd.gapless_data;
-                track->gapless_track_flag = TRUE;
-            }
-        }
-        else { /* remove gapless data which doesn't seem to be valid any
-         * more */
-            if (track->gapless_track_flag == TRUE) {
-                etr->tchanged = TRUE;
-            }
-            track->pregap = 0;
-            track->samplecount = 0;
-            track->postgap = 0;
-            track->gapless_data = 0;
-            track->gapless_track_flag = FALSE;
-        }
+    if (!mp3_frame_index_scan(path, &idx, FALSE, NULL))
+        return FALSE;
 
-        fclose(file);
-        g_free(mp3i);
-        return TRUE;
-    }
-    return FALSE;
+    return mp3_set_track_gapless(&idx, track);
 }
 
 /* Read ID3 tags of filename @name into track structure @track */
@@ -2760,26 +2927,18 @@ gboolean id3_read_tags(const gchar *name, Track *track) {
  file filled in */
 Track *mp3_get_file_info(const gchar *name, GError **error) {
     Track *track = NULL;
-    MP3Info *mp3i = NULL;
-    FILE *file;
+    MP3FrameIndex idx;
+    GError *map_error = NULL;
 
     g_return_val_if_fail (name, NULL);
 
-    /* Attempt to open the file */
-    file = fopen(name, "r");
-    if (file) {
-        mp3i = g_malloc0(sizeof(MP3Info));
-        mp3i->filename = name;
-        mp3i->file = file;
-        get_mp3_info(mp3i);
-        mp3i->file = NULL;
-        fclose(file);
-    }
-    else {
+    /* Map the file and collect frame information in one pass */
+    if (!mp3_frame_index_scan(name, &idx, FALSE, &map_error)) {
         gchar *fbuf = charset_to_utf8(name);
         gtkpod_log_error(error,
-                g_strdup_printf(_("ERROR while opening file: '%s' (%s).\n"), fbuf, g_strerror(errno)));
+                g_strdup_printf(_("ERROR while opening file: '%s' (%s).\n"), fbuf, map_error->message));
         g_free(fbuf);
+        g_error_free(map_error);
         return NULL;
     }
 
@@ -2792,15 +2951,13 @@ Track *mp3_get_file_info(const gchar *name, GError **error) {
 
     mp3_read_soundcheck(name, track, error);
 
-    mp3_read_gapless(name, track, error);
+    mp3_set_track_gapless(&idx, track);
 
     /* Get additional info (play time and bitrate */
-    if (mp3i) {
-        track->tracklen = mp3i->milliseconds;
-        track->bitrate = (gint) (mp3i->vbr_average);
-        track->samplerate = mp3file_header_frequency(&mp3i->header);
-        g_free(mp3i);
-    }
+    track->tracklen = idx.milliseconds;
+    track->bitrate = (gint) (idx.vbr_average);
+    track->samplerate = mp3file_header_frequency(&idx.header);
+
     /* Fall back to xmms code if tracklen is 0 */
     if (track->tracklen == 0) {
         track->tracklen = get_track_time(name);
@@ -75,6 +75,7 @@ static void mp3_filetype_plugin_class_init(GObjectClass *klass) {
 
 static void mp3_filetype_iface_init(FileTypeInterface *iface) {
     iface->category = AUDIO;
+    iface->reentrant = TRUE;
     iface->description = _("MP3 audio file type");
     iface->name = "mp3";
     iface->suffixes = g_list_append(iface->suffixes, "mp3");
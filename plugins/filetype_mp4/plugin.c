@@ -75,6 +75,7 @@ static void mp4_filetype_plugin_class_init(GObjectClass *klass) {
 
 static void mp4_filetype_iface_init(FileTypeInterface *iface) {
     iface->category = VIDEO;
+    iface->reentrant = TRUE;
     iface->description = _("MP4 video file type");
     iface->name = "mp4";
     iface->suffixes = g_list_append(iface->suffixes, "mp4");
@@ -35,6 +35,7 @@
 #include "libgtkpod/gp_itdb.h"
 #include "libgtkpod/prefs.h"
 #include "libgtkpod/gp_private.h"
+#include "libgtkpod/loudness.h"
 #include "plugin.h"
 #include "oggfile.h"
 
@@ -154,3 +155,114 @@ gboolean ogg_can_convert() {
 gchar *ogg_get_conversion_cmd() {
     return prefs_get_string("path_conv_ogg");
 }
+
+/* ------------------------------------------------------------
+
+ Decoding for the loudness analyzer
+
+ ------------------------------------------------------------ */
+
+/* number of frames decoded at a time */
+#define OGG_DECODE_FRAMES 4096
+
+typedef struct {
+    OggVorbis_File vf;
+    guint channels;
+    gboolean weights_set;
+} OggDecoder;
+
+static gpointer ogg_decoder_open(const gchar *filename, guint *channels, guint *rate, GError **error) {
+    OggDecoder *od;
+    vorbis_info *vi;
+    FILE *file;
+    gchar *fn;
+
+    file = fopen(filename, "rb");
+    if (file) {
+        od = g_new0 (OggDecoder, 1);
+        if (ov_open(file, &od->vf, NULL, 0) == 0) {
+            vi = ov_info(&od->vf, -1);
+            if (vi) {
+                od->channels = vi->channels;
+                *channels = vi->channels;
+                *rate = vi->rate;
+                return od;
+            }
+            ov_clear(&od->vf); /* performs the fclose(file); */
+        }
+        else {
+            fclose(file);
+        }
+        g_free(od);
+        fn = charset_to_utf8(filename);
+        gtkpod_log_error_printf(error, _("'%s' does not appear to be an Ogg audio file.\n"), fn);
+    }
+    else {
+        fn = charset_to_utf8(filename);
+        gtkpod_log_error_printf(error, _("Could not open '%s' for reading.\n"), fn);
+    }
+    g_free(fn);
+    return NULL;
+}
+
+/* Vorbis orders surround channels as L C R Ls Rs (...) LFE */
+static void ogg_decoder_set_weights(OggDecoder *od, LoudnessAnalyzer *analyzer) {
+    guint i;
+
+    if (od->channels < 5)
+        return;
+    for (i = 3; i < od->channels; ++i)
+        loudness_analyzer_set_channel_weight(analyzer, i, 1.41);
+    if (od->channels >= 6)
+        loudness_analyzer_set_channel_weight(analyzer, od->channels - 1, 0.0);
+}
+
+static gint ogg_decoder_decode(gpointer handle, LoudnessAnalyzer *analyzer, GError **error) {
+    OggDecoder *od = handle;
+    vorbis_info *vi;
+    float **pcm;
+    int section;
+    long frames;
+
+    if (!od->weights_set) {
+        ogg_decoder_set_weights(od, analyzer);
+        od->weights_set = TRUE;
+    }
+
+    frames = ov_read_float(&od->vf, &pcm, OGG_DECODE_FRAMES, &section);
+    if (frames == 0)
+        return 0;
+    if (frames == OV_HOLE) /* damaged data is skipped */
+        return 1;
+    if (frames < 0) {
+        gtkpod_log_error(error, _("Decoding the Ogg file failed.\n"));
+        return -1;
+    }
+
+    /* chained streams may change the number of channels */
+    vi = ov_info(&od->vf, section);
+    if (vi && ((guint) vi->channels == od->channels))
+        loudness_analyzer_add_planar_float(analyzer, pcm, frames);
+    return 1;
+}
+
+static void ogg_decoder_close(gpointer handle) {
+    OggDecoder *od = handle;
+
+    if (od) {
+        ov_clear(&od->vf); /* performs the fclose(file); */
+        g_free(od);
+    }
+}
+
+static const LoudnessDecoder ogg_decoder = {
+    ogg_decoder_open,
+    ogg_decoder_decode,
+    ogg_decoder_close
+};
+
+/* Set the soundcheck value of @track by measuring the loudness of
+ * @filename */
+gboolean ogg_read_soundcheck(const gchar *filename, Track *track, GError **error) {
+    return loudness_read_soundcheck(&ogg_decoder, filename, track, error);
+}
@@ -32,6 +32,7 @@
 #include "libgtkpod/itdb.h"
 
 Track *ogg_get_file_info (const gchar *name, GError **error);
+gboolean ogg_read_soundcheck (const gchar *filename, Track *track, GError **error);
 gboolean ogg_can_convert();
 gchar *ogg_get_conversion_cmd();
 
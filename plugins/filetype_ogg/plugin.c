@@ -87,6 +87,7 @@ static void ogg_filetype_plugin_class_init(GObjectClass *klass) {
 
 static void ogg_filetype_iface_init(FileTypeInterface *iface) {
     iface->category = AUDIO;
+    iface->reentrant = TRUE;
     iface->description = _("Ogg audio file type");
     iface->name = "ogg";
 
@@ -97,7 +98,7 @@ static void ogg_filetype_iface_init(FileTypeInterface *iface) {
 
     iface->get_file_info = ogg_get_file_info;
     iface->write_file_info = filetype_no_write_file_info; /* FIXME */
-    iface->read_soundcheck = filetype_no_soundcheck; /* FIXME */
+    iface->read_soundcheck = ogg_read_soundcheck;
     iface->read_lyrics = filetype_no_read_lyrics; /* FIXME */
     iface->write_lyrics = filetype_no_write_lyrics; /* FIXME */
     iface->read_gapless = filetype_no_read_gapless; /* FIXME ?? */
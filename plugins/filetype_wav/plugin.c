@@ -87,13 +87,14 @@ static void wav_filetype_plugin_class_init(GObjectClass *klass) {
 
 static void wav_filetype_iface_init(FileTypeInterface *iface) {
     iface->category = AUDIO;
+    iface->reentrant = TRUE;
     iface->description = _("Wav audio file type");
     iface->name = "wav";
     iface->suffixes = g_list_append(iface->suffixes, "wav");
 
     iface->get_file_info = wav_get_file_info;
     iface->write_file_info = filetype_no_write_file_info; /* FIXME */
-    iface->read_soundcheck = filetype_no_soundcheck; /* FIXME */
+    iface->read_soundcheck = wav_read_soundcheck;
     iface->read_lyrics = filetype_no_read_lyrics; /* FIXME */
     iface->write_lyrics = filetype_no_write_lyrics; /* FIXME */
     iface->read_gapless = filetype_no_read_gapless; /* FIXME ?? */
@@ -36,6 +36,7 @@
 #include "libgtkpod/gp_itdb.h"
 #include "libgtkpod/prefs.h"
 #include "libgtkpod/gp_private.h"
+#include "libgtkpod/loudness.h"
 #include "plugin.h"
 #include "wavfile.h"
 
@@ -58,6 +59,8 @@
 #define	IBM_FORMAT_MULAW	(0x0101)
 #define	IBM_FORMAT_ALAW			(0x0102)
 #define	IBM_FORMAT_ADPCM	(0x0103)
+#define	WAVE_FORMAT_IEEE_FLOAT		(0x0003)
+#define	WAVE_FORMAT_EXTENSIBLE		(0xFFFE)
 
 typedef struct {
     FILE *file;
@@ -186,3 +189,188 @@ gboolean wav_can_convert() {
 gchar *wav_get_conversion_cmd() {
     return prefs_get_string("path_conv_wav");
 }
+
+/* ------------------------------------------------------------
+
+ Decoding for the loudness analyzer
+
+ ------------------------------------------------------------ */
+
+/* number of frames read at a time */
+#define WAV_DECODE_FRAMES 4096
+
+typedef struct {
+    FILE *file;
+    guint16 format_tag; /* PCM or IEEE_FLOAT */
+    guint channels;
+    guint rate;
+    guint bytes_per_sample;
+    guint block_align;
+    gulong data_left; /* bytes of sample data not read yet */
+    guchar *buf;
+    gint32 *samples; /* converted samples (also used as gfloat) */
+} WavDecoder;
+
+static guint16 wav_le16(const guchar *buf) {
+    return (buf[1] << 8) | buf[0];
+}
+
+static guint32 wav_le32(const guchar *buf) {
+    return ((guint32) buf[3] << 24) | (buf[2] << 16) | (buf[1] << 8) | buf[0];
+}
+
+static void wav_decoder_close(gpointer handle) {
+    WavDecoder *wd = handle;
+
+    if (wd) {
+        if (wd->file)
+            fclose(wd->file);
+        g_free(wd->buf);
+        g_free(wd->samples);
+        g_free(wd);
+    }
+}
+
+/* Read the "fmt " chunk and position @wd->file at the start of the
+ * "data" chunk */
+static gboolean wav_decoder_read_header(WavDecoder *wd) {
+    guchar hdr[40];
+    gchar magic[4];
+    guint32 len;
+    guint bits;
+    gboolean have_fmt = FALSE;
+
+    if ((fread(hdr, 1, 12, wd->file) != 12) || (strncmp((gchar *) hdr, "RIFF", 4) != 0) || (strncmp((gchar *) hdr
+            + 8, "WAVE", 4) != 0))
+        return FALSE;
+
+    for (;;) {
+        if (fread(hdr, 1, 8, wd->file) != 8)
+            return FALSE;
+        memcpy(magic, hdr, 4);
+        len = wav_le32(hdr + 4);
+
+        if (strncmp(magic, "data", 4) == 0) {
+            wd->data_left = len;
+            break;
+        }
+
+        if ((strncmp(magic, "fmt ", 4) == 0) && (len >= 16)) {
+            guint32 read_len = MIN (len, sizeof(hdr));
+            if (fread(hdr, 1, read_len, wd->file) != read_len)
+                return FALSE;
+            wd->format_tag = wav_le16(hdr);
+            wd->channels = wav_le16(hdr + 2);
+            wd->rate = wav_le32(hdr + 4);
+            wd->block_align = wav_le16(hdr + 12);
+            bits = wav_le16(hdr + 14);
+            if ((wd->format_tag == WAVE_FORMAT_EXTENSIBLE) && (read_len >= 26))
+                wd->format_tag = wav_le16(hdr + 24); /* first bytes of the SubFormat GUID */
+            wd->bytes_per_sample = (bits + 7) / 8;
+            have_fmt = TRUE;
+            len -= read_len;
+        }
+        /* chunks are padded to an even length */
+        if (fseek(wd->file, len + (len & 1), SEEK_CUR) != 0)
+            return FALSE;
+    }
+
+    if (!have_fmt || (wd->channels == 0) || (wd->block_align != wd->channels * wd->bytes_per_sample))
+        return FALSE;
+    if (wd->format_tag == WAVE_FORMAT_PCM)
+        return (wd->bytes_per_sample >= 1) && (wd->bytes_per_sample <= 4);
+    if (wd->format_tag == WAVE_FORMAT_IEEE_FLOAT)
+        return wd->bytes_per_sample == 4;
+    return FALSE;
+}
+
+static gpointer wav_decoder_open(const gchar *filename, guint *channels, guint *rate, GError **error) {
+    WavDecoder *wd = g_new0 (WavDecoder, 1);
+
+    wd->file = fopen(filename, "rb");
+    if (!wd->file) {
+        gchar *fn = charset_to_utf8(filename);
+        gtkpod_log_error_printf(error, _("Could not open '%s' for reading.\n"), fn);
+        g_free(fn);
+        wav_decoder_close(wd);
+        return NULL;
+    }
+
+    if (!wav_decoder_read_header(wd)) {
+        gchar *fn = charset_to_utf8(filename);
+        gtkpod_log_error_printf(error, _("%s does not appear to be a supported wav file.\n"), fn);
+        g_free(fn);
+        wav_decoder_close(wd);
+        return NULL;
+    }
+    wd->buf = g_malloc((gsize) WAV_DECODE_FRAMES * wd->block_align);
+    wd->samples = g_new (gint32, (gsize) WAV_DECODE_FRAMES * wd->channels);
+    *channels = wd->channels;
+    *rate = wd->rate;
+    return wd;
+}
+
+static gint wav_decoder_decode(gpointer handle, LoudnessAnalyzer *analyzer, GError **error) {
+    WavDecoder *wd = handle;
+    gsize frames, n, i;
+    const guchar *in;
+
+    frames = MIN (WAV_DECODE_FRAMES, wd->data_left / wd->block_align);
+    if (frames == 0)
+        return 0;
+
+    /* a truncated file ends early */
+    frames = fread(wd->buf, wd->block_align, frames, wd->file);
+    if (frames == 0)
+        return 0;
+    wd->data_left -= frames * wd->block_align;
+
+    n = frames * wd->channels;
+    in = wd->buf;
+    if (wd->format_tag == WAVE_FORMAT_IEEE_FLOAT) {
+        gfloat *out = (gfloat *) wd->samples;
+        for (i = 0; i < n; ++i, in += 4) {
+            union {
+                guint32 i;
+                gfloat f;
+            } u;
+            u.i = wav_le32(in);
+            out[i] = u.f;
+        }
+        loudness_analyzer_add_float(analyzer, out, frames);
+        return 1;
+    }
+
+    switch (wd->bytes_per_sample) {
+    case 1: /* unsigned */
+        for (i = 0; i < n; ++i)
+            wd->samples[i] = (gint32) in[i] - 128;
+        break;
+    case 2:
+        for (i = 0; i < n; ++i, in += 2)
+            wd->samples[i] = (gint16) wav_le16(in);
+        break;
+    case 3:
+        for (i = 0; i < n; ++i, in += 3)
+            wd->samples[i] = ((gint32) (((guint32) in[2] << 24) | (in[1] << 16) | (in[0] << 8))) >> 8;
+        break;
+    case 4:
+        for (i = 0; i < n; ++i, in += 4)
+            wd->samples[i] = (gint32) wav_le32(in);
+        break;
+    }
+    loudness_analyzer_add_int(analyzer, wd->samples, frames, wd->bytes_per_sample * 8);
+    return 1;
+}
+
+static const LoudnessDecoder wav_decoder = {
+    wav_decoder_open,
+    wav_decoder_decode,
+    wav_decoder_close
+};
+
+/* Set the soundcheck value of @track by measuring the loudness of
+ * @filename */
+gboolean wav_read_soundcheck(const gchar *filename, Track *track, GError **error) {
+    return loudness_read_soundcheck(&wav_decoder, filename, track, error);
+}
@@ -313,6 +313,37 @@ void sorttab_display_select_playlist_cb(GtkPodApp *app, gpointer pl, gpointer da
     }
 }
 
+/**
+ * Callback for the tracks added signal
+ *
+ * The tracks of the batch that were added to the current playlist are
+ * inserted into the sort tabs, keeping their selection. Those shown
+ * by the selection are passed on to the track view in one go.
+ */
+void sorttab_display_tracks_added_cb(GtkPodApp *app, gpointer tks, gpointer data) {
+    Playlist *playlist = gtkpod_get_current_playlist();
+    GHashTable *added;
+    GList *gl, *tracks = NULL;
+
+    if (!playlist || !tks)
+        return;
+
+    added = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (gl = tks; gl; gl = gl->next)
+        g_hash_table_insert(added, gl->data, gl->data);
+
+    /* keep the order of the playlist */
+    for (gl = playlist->members; gl; gl = gl->next) {
+        if (g_hash_table_lookup(added, gl->data))
+            tracks = g_list_prepend(tracks, gl->data);
+    }
+    g_hash_table_destroy(added);
+
+    tracks = g_list_reverse(tracks);
+    sort_tab_widget_insert_tracks(first_sort_tab_widget, tracks);
+    g_list_free(tracks);
+}
+
 /**
  * Callback for the track removed signal
  */
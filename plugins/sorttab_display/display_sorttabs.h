@@ -48,6 +48,7 @@ void sorttab_display_remove_widget();
 
 /* Callbacks for signals received from core gtkpod */
 void sorttab_display_select_playlist_cb(GtkPodApp *app, gpointer pl, gpointer data);
+void sorttab_display_tracks_added_cb(GtkPodApp *app, gpointer tks, gpointer data);
 void sorttab_display_track_removed_cb(GtkPodApp *app, gpointer tk, gint32 pos, gpointer data);
 void sorttab_display_track_updated_cb(GtkPodApp *app, gpointer tk, gpointer data);
 void sorttab_display_preference_changed_cb(GtkPodApp *app, gpointer pfname, gpointer value, gpointer data);
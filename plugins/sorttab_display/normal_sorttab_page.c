@@ -289,7 +289,13 @@ static void _st_build_sortkeys(TabEntry *entry) {
     if (entry->name_fuzzy_sortkey)
         C_FREE (entry->name_fuzzy_sortkey);
 
-    gint case_sensitive = prefs_get_int("st_case_sensitive");
+    static PrefsKey *case_sensitive_key = NULL;
+    gint case_sensitive;
+
+    if (!case_sensitive_key)
+        case_sensitive_key = prefs_key_intern("st_case_sensitive");
+    case_sensitive = prefs_key_get_int(case_sensitive_key);
+
     entry->name_sortkey = make_sortkey(entry->name, case_sensitive);
     if (entry->name != fuzzy_skip_prefix(entry->name)) {
         entry->name_fuzzy_sortkey = make_sortkey(fuzzy_skip_prefix(entry->name), case_sensitive);
@@ -946,11 +952,15 @@ void normal_sort_tab_page_add_track(NormalSortTabPage *self, Track *track, gbool
     GtkTreeIter iter;
     GtkTreeModel *model;
     GtkTreeSelection *selection;
+    static PrefsKey *group_compilations_key = NULL;
 
     NormalSortTabPagePrivate *priv = NORMAL_SORT_TAB_PAGE_GET_PRIVATE(self);
     SortTabWidget *st_parent_widget = priv->st_widget_parent;
     SortTabWidget *st_next = sort_tab_widget_get_next(st_parent_widget);
 
+    if (!group_compilations_key)
+        group_compilations_key = prefs_key_intern("group_compilations");
+
     model = gtk_tree_view_get_model(GTK_TREE_VIEW(self));
 
     sort_tab_widget_set_all_tracks_added(st_parent_widget, final);
@@ -973,7 +983,7 @@ void normal_sort_tab_page_add_track(NormalSortTabPage *self, Track *track, gbool
         master_entry->members = g_list_prepend(master_entry->members, track);
         /* Check if this track should go in the compilation artist group */
         guint current_category = sort_tab_widget_get_category(st_parent_widget);
-        group_track = (prefs_get_int("group_compilations") && (track->compilation == TRUE) && (current_category
+        group_track = (prefs_key_get_int(group_compilations_key) && (track->compilation == TRUE) && (current_category
                 == ST_CAT_ARTIST));
 
         /* Check whether entry of same name already exists */
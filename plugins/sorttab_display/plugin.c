@@ -185,6 +185,7 @@ static gboolean activate_sorttab_display_plugin(AnjutaPlugin *plugin) {
     gtk_widget_show(sorttab_display_plugin->sort_tab_widget_parent);
 
     g_signal_connect (gtkpod_app, SIGNAL_PLAYLIST_SELECTED, G_CALLBACK (sorttab_display_select_playlist_cb), NULL);
+    g_signal_connect (gtkpod_app, SIGNAL_TRACKS_ADDED, G_CALLBACK (sorttab_display_tracks_added_cb), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_TRACK_REMOVED, G_CALLBACK (sorttab_display_track_removed_cb), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_TRACK_UPDATED, G_CALLBACK (sorttab_display_track_updated_cb), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_PREFERENCE_CHANGE, G_CALLBACK (sorttab_display_preference_changed_cb), NULL);
@@ -43,6 +43,10 @@
 
 G_DEFINE_TYPE( SortTabWidget, sort_tab_widget, GTK_TYPE_NOTEBOOK);
 
+/* Tracks that passed all sort tabs during sort_tab_widget_insert_tracks() */
+static gboolean inserting_tracks = FALSE;
+static GList *inserted_tracks = NULL;
+
 #define SORT_TAB_WIDGET_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SORT_TAB_TYPE_WIDGET, SortTabWidgetPrivate))
 
@@ -553,6 +557,8 @@ void sort_tab_widget_add_track(SortTabWidget *self, Track *track, gboolean final
 
     if (! SORT_TAB_IS_WIDGET(self)) {
         /* just add to track model */
+        if (track && display && inserting_tracks)
+            inserted_tracks = g_list_prepend(inserted_tracks, track);
         if (final)
             gtkpod_tracks_statusbar_update();
 
@@ -580,6 +586,37 @@ void sort_tab_widget_add_track(SortTabWidget *self, Track *track, gboolean final
     }
 }
 
+/**
+ * Insert @tracks, which were added to the playlist shown, into the
+ * sort tabs starting with @self without rebuilding them, so the
+ * current selection is kept. The tracks passing the selections of all
+ * sort tabs are then announced with gtkpod_add_displayed_tracks().
+ */
+void sort_tab_widget_insert_tracks(SortTabWidget *self, GList *tracks) {
+    GList *gl;
+
+    if (!tracks)
+        return;
+
+    g_return_if_fail (!inserting_tracks);
+    inserting_tracks = TRUE;
+
+    sort_tab_widget_set_sort_enablement(self, FALSE);
+    for (gl = tracks; gl; gl = gl->next)
+        sort_tab_widget_add_track(self, gl->data, FALSE, TRUE);
+    sort_tab_widget_set_sort_enablement(self, TRUE);
+    sort_tab_widget_add_track(self, NULL, TRUE, TRUE);
+
+    inserting_tracks = FALSE;
+
+    if (inserted_tracks) {
+        GList *displayed = g_list_reverse(inserted_tracks);
+        inserted_tracks = NULL;
+        gtkpod_add_displayed_tracks(displayed);
+        g_list_free(displayed);
+    }
+}
+
 void sort_tab_widget_remove_track(SortTabWidget *self, Track *track) {
     if (!SORT_TAB_IS_WIDGET(self))
         return;
@@ -102,6 +102,8 @@ GtkTreeModel *sort_tab_widget_get_normal_model(SortTabWidget *self);
 
 void sort_tab_widget_add_track(SortTabWidget *self, Track *track, gboolean final, gboolean display);
 
+void sort_tab_widget_insert_tracks(SortTabWidget *self, GList *tracks);
+
 void sort_tab_widget_remove_track(SortTabWidget *self, Track *track);
 
 void sort_tab_widget_track_changed(SortTabWidget *self, Track *track, gboolean removed);
@@ -42,6 +42,26 @@ G_DEFINE_TYPE( SpecialSortTabPage, special_sort_tab_page, GTK_TYPE_SCROLLED_WIND
 #define SPECIAL_SORT_TAB_PAGE_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), SPECIAL_SORT_TAB_TYPE_PAGE, SpecialSortTabPagePrivate))
 
+/* Interned prefs keys of the conditions, which are read for every
+ * track checked */
+typedef struct {
+    PrefsKey *sp_or;
+    PrefsKey *rating_cond;
+    PrefsKey *rating_state;
+    PrefsKey *playcount_cond;
+    PrefsKey *playcount_low;
+    PrefsKey *playcount_high;
+    PrefsKey *played_cond;
+    PrefsKey *modified_cond;
+    PrefsKey *added_cond;
+    PrefsKey *played_state;
+    PrefsKey *modified_state;
+    PrefsKey *added_state;
+    gulong played_state_id;
+    gulong modified_state_id;
+    gulong added_state_id;
+} SpPrefsKeys;
+
 struct _SpecialSortTabPagePrivate {
 
     /* path to glade xml */
@@ -67,6 +87,15 @@ struct _SpecialSortTabPagePrivate {
 
     /* TimeInfo "played" (sp)        */
     TimeInfo ti_played;
+
+    /* TRUE while the TimeInfo matches its "sp_*_state" pref, cleared
+     by _sp_state_changed() */
+    gint ti_added_current;
+    gint ti_modified_current;
+    gint ti_played_current;
+
+    /* prefs keys of this instance, see _sp_get_keys() */
+    SpPrefsKeys keys;
 };
 
 typedef enum {
@@ -104,6 +133,52 @@ static guint32 _get_sort_tab_widget_instance(SpecialSortTabPage *self) {
     return sort_tab_widget_get_instance(priv->st_widget_parent);
 }
 
+/**
+ * Called when one of the "sp_*_state" interval strings of @data has
+ * changed, possibly in another thread
+ */
+static void _sp_state_changed(PrefsKey *pkey, gpointer data) {
+    SpecialSortTabPagePrivate *priv = SPECIAL_SORT_TAB_PAGE_GET_PRIVATE(data);
+    SpPrefsKeys *keys = &priv->keys;
+
+    if (pkey == keys->played_state)
+        g_atomic_int_set(&priv->ti_played_current, FALSE);
+    else if (pkey == keys->modified_state)
+        g_atomic_int_set(&priv->ti_modified_current, FALSE);
+    else if (pkey == keys->added_state)
+        g_atomic_int_set(&priv->ti_added_current, FALSE);
+}
+
+/**
+ * Get the prefs keys of the conditions, interning them on first use
+ */
+static SpPrefsKeys *_sp_get_keys(SpecialSortTabPage *self) {
+    SpecialSortTabPagePrivate *priv = SPECIAL_SORT_TAB_PAGE_GET_PRIVATE(self);
+    SpPrefsKeys *keys = &priv->keys;
+
+    if (!keys->sp_or) {
+        guint32 inst = _get_sort_tab_widget_instance(self);
+
+        keys->rating_cond = prefs_key_intern_index("sp_rating_cond", inst);
+        keys->rating_state = prefs_key_intern_index("sp_rating_state", inst);
+        keys->playcount_cond = prefs_key_intern_index("sp_playcount_cond", inst);
+        keys->playcount_low = prefs_key_intern_index("sp_playcount_low", inst);
+        keys->playcount_high = prefs_key_intern_index("sp_playcount_high", inst);
+        keys->played_cond = prefs_key_intern_index("sp_played_cond", inst);
+        keys->modified_cond = prefs_key_intern_index("sp_modified_cond", inst);
+        keys->added_cond = prefs_key_intern_index("sp_added_cond", inst);
+        keys->played_state = prefs_key_intern_index("sp_played_state", inst);
+        keys->modified_state = prefs_key_intern_index("sp_modified_state", inst);
+        keys->added_state = prefs_key_intern_index("sp_added_state", inst);
+        keys->played_state_id = prefs_key_add_notify(keys->played_state, _sp_state_changed, self);
+        keys->modified_state_id = prefs_key_add_notify(keys->modified_state, _sp_state_changed, self);
+        keys->added_state_id = prefs_key_add_notify(keys->added_state, _sp_state_changed, self);
+        keys->sp_or = prefs_key_intern_index("sp_or", inst);
+    }
+
+    return keys;
+}
+
 /**
  * Called when the user changed the sort conditions in the special
  * sort tab
@@ -141,10 +216,9 @@ static void _set_sp_rating_n(SpecialSortTabPage *self, gint n, gboolean state) {
 
 static gboolean _get_sp_rating_n(SpecialSortTabPage *self, gint n) {
     guint32 rating;
-    guint32 inst = _get_sort_tab_widget_instance(self);
 
     if (SPECIAL_SORT_TAB_IS_PAGE(self) && (n <= RATING_MAX)) {
-        rating = (guint32) prefs_get_int_index("sp_rating_state", inst);
+        rating = (guint32) prefs_key_get_int(_sp_get_keys(self)->rating_state);
 
         if ((rating & (1 << n)) != 0)
             return TRUE;
@@ -201,8 +275,8 @@ static IntervalState _sp_check_time(SpecialSortTabPage *self, T_item item, Track
  * Return value:  TRUE: satisfies, FALSE: does not satisfy
  */
 static gboolean _sp_check_track(SpecialSortTabPage *self, Track *track) {
-    guint32 inst = _get_sort_tab_widget_instance(self);
-    gboolean sp_or = prefs_get_int_index("sp_or", inst);
+    SpPrefsKeys *keys = _sp_get_keys(self);
+    gboolean sp_or = prefs_key_get_int(keys->sp_or);
     gboolean result, cond, checked = FALSE;
 
     if (!track)
@@ -215,7 +289,7 @@ static gboolean _sp_check_track(SpecialSortTabPage *self, Track *track) {
         result = TRUE; /* AND */
 
     /* RATING */
-    if (prefs_get_int_index("sp_rating_cond", inst)) {
+    if (prefs_key_get_int(keys->rating_cond)) {
         /* checked = TRUE: at least one condition was checked */
         checked = TRUE;
         cond = _get_sp_rating_n(self, track->rating / ITDB_RATING_STEP);
@@ -230,12 +304,12 @@ static gboolean _sp_check_track(SpecialSortTabPage *self, Track *track) {
     }
 
     /* PLAYCOUNT */
-    if (prefs_get_int_index("sp_playcount_cond", inst)) {
-        guint32 low = prefs_get_int_index("sp_playcount_low", inst);
+    if (prefs_key_get_int(keys->playcount_cond)) {
+        guint32 low = prefs_key_get_int(keys->playcount_low);
         /* "-1" will translate into about 4 billion because I use
          guint32 instead of gint32. Since 4 billion means "no upper
          limit" the logic works fine */
-        guint32 high = prefs_get_int_index("sp_playcount_high", inst);
+        guint32 high = prefs_key_get_int(keys->playcount_high);
         checked = TRUE;
         if ((low <= track->playcount) && (track->playcount <= high))
             cond = TRUE;
@@ -247,7 +321,7 @@ static gboolean _sp_check_track(SpecialSortTabPage *self, Track *track) {
             return FALSE;
     }
     /* time played */
-    if (prefs_get_int_index("sp_played_cond", inst)) {
+    if (prefs_key_get_int(keys->played_cond)) {
         IntervalState result = _sp_check_time(self, T_TIME_PLAYED, track);
         if (sp_or && (result == IS_INSIDE))
             return TRUE;
@@ -257,7 +331,7 @@ static gboolean _sp_check_track(SpecialSortTabPage *self, Track *track) {
             checked = TRUE;
     }
     /* time modified */
-    if (prefs_get_int_index("sp_modified_cond", inst)) {
+    if (prefs_key_get_int(keys->modified_cond)) {
         IntervalState result = _sp_check_time(self, T_TIME_MODIFIED, track);
         if (sp_or && (result == IS_INSIDE))
             return TRUE;
@@ -267,7 +341,7 @@ static gboolean _sp_check_track(SpecialSortTabPage *self, Track *track) {
             checked = TRUE;
     }
     /* time added */
-    if (prefs_get_int_index("sp_added_cond", inst)) {
+    if (prefs_key_get_int(keys->added_cond)) {
         IntervalState result = _sp_check_time(self, T_TIME_ADDED, track);
         g_message("time added result %d for track %s", result, track->title);
         if (sp_or && (result == IS_INSIDE))
@@ -461,6 +535,16 @@ static void _on_sp_playcount_high_value_changed(GtkSpinButton *spinbutton, gpoin
 }
 
 static void special_sort_tab_page_dispose(GObject *gobject) {
+    SpecialSortTabPagePrivate *priv = SPECIAL_SORT_TAB_PAGE_GET_PRIVATE(gobject);
+    SpPrefsKeys *keys = &priv->keys;
+
+    if (keys->sp_or) {
+        prefs_key_remove_notify(keys->played_state, keys->played_state_id);
+        prefs_key_remove_notify(keys->modified_state, keys->modified_state_id);
+        prefs_key_remove_notify(keys->added_state, keys->added_state_id);
+        memset(keys, 0, sizeof(SpPrefsKeys));
+    }
+
     /* call the parent class' dispose() method */
     G_OBJECT_CLASS(special_sort_tab_page_parent_class)->dispose(gobject);
 }
@@ -737,7 +821,36 @@ TimeInfo *special_sort_tab_page_update_date_interval(SpecialSortTabPage *self, T
     inst = _get_sort_tab_widget_instance(self);
 
     if (ti) {
+        SpecialSortTabPagePrivate *priv = SPECIAL_SORT_TAB_PAGE_GET_PRIVATE(self);
+        gint *current = NULL;
         gchar *new_string = NULL;
+
+        /* make sure the notifications are set up */
+        _sp_get_keys(self);
+
+        switch (item) {
+        case T_TIME_PLAYED:
+            current = &priv->ti_played_current;
+            break;
+        case T_TIME_MODIFIED:
+            current = &priv->ti_modified_current;
+            break;
+        case T_TIME_ADDED:
+            current = &priv->ti_added_current;
+            break;
+        default:
+            break;
+        }
+
+        /* this is called for every track checked -- skip looking up
+         the string unless it has changed since it was parsed */
+        if (!force_update && ti->int_str && current && g_atomic_int_get(current))
+            return ti;
+        /* mark current before reading, so that a change happening
+         meanwhile is not lost */
+        if (current)
+            g_atomic_int_set(current, TRUE);
+
         switch (item) {
         case T_TIME_PLAYED:
             new_string = prefs_get_string_index("sp_played_state", inst);
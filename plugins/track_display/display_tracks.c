@@ -103,43 +103,93 @@ static GtkBuilder *get_track_builder() {
     return trackbuilder;
 }
 
+/* casefolded search keys of the displayed tracks, built on demand
+ * from the visible columns listed in filter_columns */
+static GHashTable *filter_keys = NULL;
+static gboolean filter_columns[TM_NUM_COLUMNS];
+/* casefolded text of the current search and the tracks it matched */
+static gchar *filter_text = NULL;
+static GHashTable *filter_matches = NULL;
+/* tracks matched by the previous search while refiltering for a search
+ * that narrows it down, NULL otherwise */
+static GHashTable *filter_candidates = NULL;
+
+static void filter_reset_keys() {
+    if (filter_keys)
+        g_hash_table_remove_all(filter_keys);
+    /* the matches of the current search are no longer a safe base
+     * for narrowing down the next one */
+    g_free(filter_text);
+    filter_text = NULL;
+}
+
+static void filter_forget_track(Track *track) {
+    if (filter_keys)
+        g_hash_table_remove(filter_keys, track);
+    if (filter_matches)
+        g_hash_table_remove(filter_matches, track);
+}
+
+/* Return the casefolded search key of @tr: the text of all visible
+ * columns, separated by newlines so a search cannot match across
+ * columns */
+static const gchar *filter_get_key(Track *tr) {
+    GString *key;
+    gint i;
+
+    if (!filter_keys)
+        filter_keys = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+    gchar *ukey = g_hash_table_lookup(filter_keys, tr);
+    if (ukey)
+        return ukey;
+
+    key = g_string_new("");
+    for (i = 0; i < TM_NUM_COLUMNS; i++) {
+        gchar *data;
+
+        if (!filter_columns[i])
+            continue;
+
+        data = track_get_text(tr, TM_to_T(i));
+        if (data) {
+            g_string_append(key, data);
+            g_free(data);
+        }
+        g_string_append_c(key, '\n');
+    }
+
+    ukey = g_utf8_casefold(key->str, key->len);
+    g_string_free(key, TRUE);
+
+    g_hash_table_insert(filter_keys, tr, ukey);
+    return ukey;
+}
+
 /* Convenience functions */
 static gboolean filter_tracks(GtkTreeModel *model, GtkTreeIter *iter, gpointer entry) {
     Track *tr;
-    gboolean result = FALSE;
-    const gchar *text = gtk_entry_get_text(GTK_ENTRY (entry));
-    gchar *utext =  g_utf8_casefold(text, -1);
-    int i;
-
-    gtk_tree_model_get(model, iter, READOUT_COL, &tr, -1);
 
-    if (tr) {
-        if (text[0] == 0x0)
-            return TRUE;
-        for (i = 0; i < TM_NUM_COLUMNS; i++) {
-            gint visible = prefs_get_int_index("col_visible", i);
-            gchar *data = NULL;
-            gchar *udata =  NULL;
+    if (!filter_text || filter_text[0] == 0x0)
+        return TRUE;
 
-            if (!visible)
-                continue;
+    gtk_tree_model_get(model, iter, READOUT_COL, &tr, -1);
 
-            data = track_get_text(tr, TM_to_T(i));
-            if (data)
-                udata = g_utf8_casefold(data, -1);
+    if (!tr)
+        return FALSE;
 
-            if (udata && utf8_strcasestr(udata, utext)) {
-                g_free(udata);
-                result = TRUE;
-                break;
-            }
+    /* a track that did not match the previous search cannot match
+     * a search which contains it */
+    if (filter_candidates && !g_hash_table_lookup(filter_candidates, tr))
+        return FALSE;
 
-            if (data)
-                g_free(data);
-        }
-    }
+    /* both strings are casefolded UTF-8 so a bytewise search cannot
+     * produce a match in the middle of a character */
+    if (!strstr(filter_get_key(tr), filter_text))
+        return FALSE;
 
-    return result;
+    g_hash_table_insert(filter_matches, tr, tr);
+    return TRUE;
 }
 
 static gboolean _is_auto_sort_on() {
@@ -213,7 +263,37 @@ static GtkTreeModelFilter *get_filter(GtkTreeView *tree) {
 }
 
 void on_search_entry_changed(GtkEditable *editable, gpointer user_data) {
+    const gchar *text = gtk_entry_get_text(GTK_ENTRY (search_entry));
+    gchar *utext = g_utf8_casefold(text, -1);
+    gboolean narrowing;
+    gint i;
+
+    /* the search keys depend on the set of visible columns */
+    for (i = 0; i < TM_NUM_COLUMNS; i++) {
+        gboolean visible = prefs_get_int_index("col_visible", i) ? TRUE : FALSE;
+        if (visible != filter_columns[i]) {
+            filter_columns[i] = visible;
+            filter_reset_keys();
+        }
+    }
+
+    narrowing = filter_text && filter_text[0] && strstr(utext, filter_text);
+
+    if (narrowing)
+        filter_candidates = filter_matches;
+    else if (filter_matches)
+        g_hash_table_destroy(filter_matches);
+    filter_matches = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    g_free(filter_text);
+    filter_text = utext;
+
     gtk_tree_model_filter_refilter(get_filter(track_treeview));
+
+    if (filter_candidates) {
+        g_hash_table_destroy(filter_candidates);
+        filter_candidates = NULL;
+    }
 }
 
 /* ---------------------------------------------------------------- */
@@ -692,6 +772,8 @@ static gboolean tm_delete_track(GtkTreeModel *model, GtkTreePath *path, GtkTreeI
 void tm_remove_track(Track *track) {
     GtkTreeModel *model = gtk_tree_view_get_model(track_treeview);
 
+    filter_forget_track(track);
+
     if (model) {
         gtk_tree_model_foreach(model, tm_delete_track, track);
         /*        update_model_view (model); -- not needed */
@@ -709,6 +791,9 @@ void tm_remove_all_tracks() {
      * activated, a lot of time is needed */
     gtk_entry_set_text(GTK_ENTRY (search_entry), "");
 
+    /* the search keys are only kept for the displayed tracks */
+    filter_reset_keys();
+
     tm_store_col_order();
     tm_update_default_sizes();
 }
@@ -759,6 +844,9 @@ static gboolean tm_model_track_changed(GtkTreeModel *model, GtkTreePath *path, G
  iTunesDB is read and some IDs are renumbered */
 void tm_track_changed(Track *track) {
     GtkTreeModel *model = gtk_tree_view_get_model(track_treeview);
+
+    /* recompute the search key when the row is filtered again */
+    filter_forget_track(track);
     if (model != NULL)
         gtk_tree_model_foreach(model, tm_model_track_changed, track);
 }
@@ -1372,7 +1460,13 @@ static gint tm_data_compare(Track *track1, Track *track2, TM_item tm_item) {
     /* string_compare_func is set to either compare_string_fuzzy or
      compare_string in tm_sort_column_changed() which is called
      once before the comparing begins. */
-    gint case_sensitive = prefs_get_int("tm_case_sensitive");
+    static PrefsKey *case_sensitive_key = NULL;
+    gint case_sensitive;
+
+    if (!case_sensitive_key)
+        case_sensitive_key = prefs_key_intern("tm_case_sensitive");
+    case_sensitive = prefs_key_get_int(case_sensitive_key);
+
     switch (tm_item) {
     case TM_COLUMN_TITLE:
         cmp = string_compare_func(track1->title, track2->title, case_sensitive);
@@ -2174,6 +2268,8 @@ void tm_destroy_widgets(void) {
     if (GTK_IS_WIDGET(track_container))
         gtk_widget_destroy(track_container);
 
+    filter_reset_keys();
+
     track_treeview = NULL;
     search_entry = NULL;
     current_playlist_label = NULL;
@@ -2420,6 +2516,25 @@ void track_display_set_tracks_cb(GtkPodApp *app, gpointer tks, gpointer data) {
     }
 }
 
+/*
+ * Tracks were added to the ones displayed: insert them into the model
+ * instead of rebuilding it. If the view is sorted they end up in
+ * their sorted position.
+ */
+void track_display_add_tracks_cb(GtkPodApp *app, gpointer tks, gpointer data) {
+    GtkTreeModel *model;
+    GList *gl;
+
+    if (!track_treeview)
+        return;
+
+    model = gtk_tree_view_get_model(track_treeview);
+    g_return_if_fail (model);
+
+    for (gl = tks; gl; gl = gl->next)
+        gtk_list_store_insert_with_values(get_model_as_store(model), NULL, -1, READOUT_COL, gl->data, -1);
+}
+
 void track_display_set_playlist_cb(GtkPodApp *app, gpointer pl, gpointer data) {
     Playlist *playlist = pl;
     gchar *label_text;
@@ -45,6 +45,7 @@ GList *tm_get_selected_tracks(void);
 void tm_select_all_tracks(void);
 
 void track_display_set_tracks_cb(GtkPodApp *app, gpointer tks, gpointer data);
+void track_display_add_tracks_cb(GtkPodApp *app, gpointer tks, gpointer data);
 void track_display_set_playlist_cb(GtkPodApp *app, gpointer pl, gpointer data);
 void track_display_set_sort_enablement(GtkPodApp *app, gboolean flag, gpointer data);
 void track_display_track_removed_cb(GtkPodApp *app, gpointer tk, gint32 pos, gpointer data);
@@ -124,6 +124,7 @@ static gboolean activate_track_display_plugin(AnjutaPlugin *plugin) {
     tm_create_track_display(track_display_plugin->track_window);
 
     g_signal_connect (gtkpod_app, SIGNAL_TRACKS_DISPLAYED, G_CALLBACK (track_display_set_tracks_cb), NULL);
+    g_signal_connect (gtkpod_app, SIGNAL_DISPLAYED_TRACKS_ADDED, G_CALLBACK (track_display_add_tracks_cb), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_PLAYLIST_SELECTED, G_CALLBACK (track_display_set_playlist_cb), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_SORT_ENABLEMENT, G_CALLBACK (track_display_set_sort_enablement), NULL);
     g_signal_connect (gtkpod_app, SIGNAL_TRACK_REMOVED, G_CALLBACK (track_display_track_removed_cb), NULL);
@@ -448,6 +448,11 @@ static void anjuta_window_finalize(GObject *widget) {
     G_OBJECT_CLASS(parent_class)->finalize(widget);
 }
 
+static void on_progress_stop_clicked(GtkButton *button, gpointer user_data) {
+    gtkpod_statusbar_cancel_progress();
+    gtk_widget_set_sensitive(GTK_WIDGET (button), FALSE);
+}
+
 static void anjuta_window_instance_init(AnjutaWindow *win) {
     GtkWidget *menubar, *about_menu;
     GtkWidget *view_menu, *hbox;
@@ -477,10 +482,23 @@ static void anjuta_window_instance_init(AnjutaWindow *win) {
     win->settings = g_settings_new (PREF_SCHEMA);
 
     /* Status bar */
+    hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+    gtk_widget_show(hbox);
+    gtk_box_pack_end(GTK_BOX (main_box), hbox, FALSE, TRUE, 0);
     win->status = ANJUTA_STATUS(anjuta_status_new());
     anjuta_status_set_title_window(win->status, GTK_WIDGET (win));
     gtk_widget_show(GTK_WIDGET (win->status));
-    gtk_box_pack_end(GTK_BOX (main_box), GTK_WIDGET (win->status), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX (hbox), GTK_WIDGET (win->status), TRUE, TRUE, 0);
+
+    /* Stop button for operations that can be cancelled, only shown
+     while one is running */
+    win->progress_stop = gtk_button_new();
+    gtk_button_set_image(GTK_BUTTON (win->progress_stop), gtk_image_new_from_stock(GTK_STOCK_STOP, GTK_ICON_SIZE_MENU));
+    gtk_button_set_relief(GTK_BUTTON (win->progress_stop), GTK_RELIEF_NONE);
+    gtk_widget_set_tooltip_text(win->progress_stop, _("Stop the current operation"));
+    gtk_widget_set_no_show_all(win->progress_stop, TRUE);
+    g_signal_connect (win->progress_stop, "clicked", G_CALLBACK (on_progress_stop_clicked), NULL);
+    gtk_box_pack_end(GTK_BOX (hbox), win->progress_stop, FALSE, FALSE, 0);
     g_object_ref(G_OBJECT (win->status));
     g_object_add_weak_pointer(G_OBJECT (win->status), (gpointer) &win->status);
 
@@ -1146,6 +1164,15 @@ static void anjuta_gtkpod_statusbar_increment_progress_ticks(GtkPodApp *obj, gin
     anjuta_status_progress_increment_ticks(status, ticks, text);
 }
 
+static void anjuta_gtkpod_statusbar_set_cancellable(GtkPodApp *obj, gboolean cancellable) {
+    g_return_if_fail(ANJUTA_IS_WINDOW(gtkpod_app));
+    AnjutaWindow *win = ANJUTA_WINDOW(gtkpod_app);
+    if (!win->progress_stop)
+        return;
+    gtk_widget_set_sensitive(win->progress_stop, TRUE);
+    gtk_widget_set_visible(win->progress_stop, cancellable);
+}
+
 static void anjuta_gtkpod_app_statusbar_message(GtkPodApp *gtkpod_app, gchar* message, ...) {
     g_return_if_fail(ANJUTA_IS_WINDOW(gtkpod_app));
 
@@ -1624,6 +1651,7 @@ static void anjuta_gtkpod_app_display_widget(GtkPodApp *obj, GtkWidget *widget)
 static void gtkpod_app_iface_init(GtkPodAppInterface *iface) {
     iface->statusbar_reset_progress = anjuta_gtkpod_statusbar_reset_progress;
     iface->statusbar_increment_progress_ticks = anjuta_gtkpod_statusbar_increment_progress_ticks;
+    iface->statusbar_set_cancellable = anjuta_gtkpod_statusbar_set_cancellable;
     iface->statusbar_message = anjuta_gtkpod_app_statusbar_message;
     iface->statusbar_busy_push = anjuta_gtkpod_app_statusbar_busy_push;
     iface->statusbar_busy_pop = anjuta_gtkpod_app_statusbar_busy_pop;
@@ -57,6 +57,7 @@ struct _AnjutaWindow
 	GtkAccelGroup *accel_group;
 
 	AnjutaStatus *status;
+	GtkWidget *progress_stop;
 	AnjutaUI *ui;
 	AnjutaPreferences *preferences;
 	GSettings* settings;